@@ -1,6 +1,7 @@
 import IUser from '../../../src/business-logic/model/IUser';
 import UserType from '../../../src/business-logic/model/enums/UserType';
 import APIService from '../../../src/business-logic/services/APIService';
+import { loadIsolated } from '../../helpers/loadIsolated';
 
 describe('APIService', () => {
   describe('get', () => {
@@ -192,4 +193,97 @@ describe('APIService', () => {
       await expect(APIService.put('endpoint', data, token)).rejects.toThrowError('HTTP error! Status: 404');
     });
   });
+
+  describe('native client', () => {
+    // APIService with Platform.OS set to windows and a mocked NativeHttp module
+    function loadModules(): { NativeHttp: { request: jest.Mock }; APIService: typeof APIService } {
+      return loadIsolated(
+        () => ({
+          NativeHttp: require('../../../src/business-logic/modules/NativeHttp').default,
+          APIService: require('../../../src/business-logic/services/APIService').default,
+        }),
+        () => {
+          jest.doMock('react-native', () => ({
+            Platform: { OS: 'windows' },
+          }));
+          jest.doMock('../../../src/business-logic/modules/NativeHttp', () => ({
+            __esModule: true,
+            default: { request: jest.fn() },
+          }));
+        },
+      );
+    }
+
+    afterEach(() => {
+      jest.dontMock('react-native');
+      jest.dontMock('../../../src/business-logic/modules/NativeHttp');
+      jest.restoreAllMocks();
+    });
+
+    it('should send GETs through the native module and return its parsed body', async () => {
+      const { NativeHttp, APIService: Service } = loadModules();
+      const fetchSpy = jest.spyOn(global, 'fetch');
+      NativeHttp.request.mockResolvedValueOnce({
+        status: 200,
+        ok: true,
+        contentType: 'application/json; charset=utf-8',
+        body: [{ id: '1' }],
+        coalesced: true,
+      });
+
+      const users = await Service.get('users', 'mockToken');
+
+      expect(NativeHttp.request).toHaveBeenCalledWith(expect.stringMatching(/^http-\d+$/), {
+        method: 'GET',
+        url: 'http://localhost:8080/api/users',
+        headers: {
+          'Content-Type': 'application/json',
+          'Authorization': 'Bearer mockToken',
+        },
+        responseType: 'json',
+      });
+      expect(users).toEqual([{ id: '1' }]);
+      expect(fetchSpy).not.toHaveBeenCalled();
+    });
+
+    it('should report the reason of a failed native POST', async () => {
+      const { NativeHttp, APIService: Service } = loadModules();
+      NativeHttp.request.mockResolvedValueOnce({
+        status: 400,
+        ok: false,
+        contentType: 'application/json',
+        body: { reason: 'Invalid path' },
+        coalesced: false,
+      });
+
+      await expect(Service.post('documents/paginated/path', { value: '/a' }, 'mockToken')).rejects.toThrowError('Invalid path');
+      expect(NativeHttp.request.mock.calls[0][1].body).toBe(JSON.stringify({ value: '/a' }));
+    });
+
+    it('should parse answers the native module left as text', async () => {
+      const { NativeHttp, APIService: Service } = loadModules();
+      NativeHttp.request.mockResolvedValueOnce({
+        status: 200,
+        ok: true,
+        contentType: 'text/plain',
+        body: '{"value":"abc"}',
+        coalesced: false,
+      });
+
+      await expect(Service.put('endpoint', {}, 'mockToken')).resolves.toEqual({ value: 'abc' });
+    });
+
+    it('should report the status of an answer whose JSON did not parse natively', async () => {
+      const { NativeHttp, APIService: Service } = loadModules();
+      NativeHttp.request.mockResolvedValueOnce({
+        status: 502,
+        ok: false,
+        contentType: 'application/json',
+        body: '<html><body>Bad Gateway</body></html>',
+        coalesced: false,
+      });
+
+      await expect(Service.get('endpoint', 'mockToken')).rejects.toThrowError('HTTP error! Status: 502');
+    });
+  });
 });
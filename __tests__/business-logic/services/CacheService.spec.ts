@@ -1,5 +1,32 @@
 import AsyncStorage from '@react-native-async-storage/async-storage';
+import FileOpenPicker from '../../../src/business-logic/modules/FileOpenPicker';
 import CacheService from '../../../src/business-logic/services/CacheService';
+import { loadIsolated } from '../../helpers/loadIsolated';
+
+jest.mock('react-native', () => ({
+  Platform: { OS: 'windows' },
+}));
+
+jest.mock('../../../src/business-logic/modules/CacheStore', () => ({
+  __esModule: true,
+  default: {
+    get: jest.fn(),
+    set: jest.fn(),
+    setMany: jest.fn(),
+    remove: jest.fn(),
+    clear: jest.fn(),
+  },
+}));
+
+jest.mock('../../../src/business-logic/modules/FileOpenPicker', () => ({
+  __esModule: true,
+  default: {
+    storeContent: jest.fn(),
+    readContent: jest.fn(),
+    indexDocument: jest.fn().mockResolvedValue(true),
+    searchDocuments: jest.fn(),
+  },
+}));
 
 describe('CacheService', () => {
   afterEach(() => {
@@ -64,6 +91,124 @@ describe('CacheService', () => {
     });
   });
 
+  describe('storeDocumentData', () => {
+    it('should cache a digest reference instead of the data on Windows', async () => {
+      const setItemSpy = jest.spyOn(AsyncStorage, 'setItem').mockResolvedValueOnce(undefined);
+      (FileOpenPicker!.storeContent as jest.Mock).mockResolvedValueOnce('abc123');
+
+      await CacheService.getInstance().storeDocumentData('docId', 'data:application/pdf;base64,JVBERi0=');
+
+      expect(FileOpenPicker!.storeContent).toHaveBeenCalledWith('JVBERi0=');
+      expect(setItemSpy).toHaveBeenCalledWith(
+        'docId',
+        JSON.stringify({ contentDigest: 'abc123', prefix: 'data:application/pdf;base64,' }),
+      );
+    });
+
+    it('should fall back to caching the data when the content store fails', async () => {
+      const setItemSpy = jest.spyOn(AsyncStorage, 'setItem').mockResolvedValueOnce(undefined);
+      jest.spyOn(console, 'log').mockImplementation();
+      (FileOpenPicker!.storeContent as jest.Mock).mockRejectedValueOnce('Invalid base64 data');
+
+      await CacheService.getInstance().storeDocumentData('docId', 'JVBERi0=');
+
+      expect(setItemSpy).toHaveBeenCalledWith('docId', JSON.stringify('JVBERi0='));
+    });
+  });
+
+  describe('storeDocumentReference', () => {
+    it('should cache a reference that retrieveDocumentData resolves', async () => {
+      const setItemSpy = jest.spyOn(AsyncStorage, 'setItem').mockResolvedValueOnce(undefined);
+
+      await CacheService.getInstance().storeDocumentReference('docId', 'abc123', 'data:application/pdf;base64,');
+
+      expect(FileOpenPicker!.storeContent).not.toHaveBeenCalled();
+      expect(setItemSpy).toHaveBeenCalledWith(
+        'docId',
+        JSON.stringify({ contentDigest: 'abc123', prefix: 'data:application/pdf;base64,' }),
+      );
+    });
+
+    it('should index the text of a cached PDF', async () => {
+      jest.spyOn(AsyncStorage, 'setItem').mockResolvedValueOnce(undefined);
+
+      await CacheService.getInstance().storeDocumentReference('docId', 'abc123', 'data:application/pdf;base64,');
+
+      expect(FileOpenPicker!.indexDocument).toHaveBeenCalledWith('docId', 'abc123');
+    });
+
+    it('should not index other content', async () => {
+      jest.spyOn(AsyncStorage, 'setItem').mockResolvedValueOnce(undefined);
+
+      await CacheService.getInstance().storeDocumentReference('logoId', 'def456', 'data:image/png;base64,');
+
+      expect(FileOpenPicker!.indexDocument).not.toHaveBeenCalled();
+    });
+  });
+
+  describe('searchCachedDocuments', () => {
+    it('should resolve with the native search results', async () => {
+      const hits = [{ documentId: 'docId', score: 3.2, matchedTerms: 2 }];
+      (FileOpenPicker!.searchDocuments as jest.Mock).mockResolvedValueOnce(hits);
+
+      const result = await CacheService.getInstance().searchCachedDocuments('procédure qualité', 10);
+
+      expect(FileOpenPicker!.searchDocuments).toHaveBeenCalledWith('procédure qualité', 10);
+      expect(result).toEqual(hits);
+    });
+
+    it('should resolve with no results when the search fails', async () => {
+      jest.spyOn(console, 'log').mockImplementation();
+      (FileOpenPicker!.searchDocuments as jest.Mock).mockRejectedValueOnce('Error searching documents');
+
+      const result = await CacheService.getInstance().searchCachedDocuments('audit');
+
+      expect(result).toEqual([]);
+    });
+
+    it('should not search for an empty query', async () => {
+      const result = await CacheService.getInstance().searchCachedDocuments('  ');
+
+      expect(result).toEqual([]);
+      expect(FileOpenPicker!.searchDocuments).not.toHaveBeenCalled();
+    });
+  });
+
+  describe('retrieveDocumentData', () => {
+    it('should resolve a digest reference through the content store', async () => {
+      AsyncStorage.getItem = jest.fn().mockResolvedValueOnce(
+        JSON.stringify({ contentDigest: 'abc123', prefix: 'data:application/pdf;base64,' }),
+      );
+      (FileOpenPicker!.readContent as jest.Mock).mockResolvedValueOnce('JVBERi0=');
+
+      const result = await CacheService.getInstance().retrieveDocumentData('docId');
+
+      expect(FileOpenPicker!.readContent).toHaveBeenCalledWith('abc123');
+      expect(result).toEqual('data:application/pdf;base64,JVBERi0=');
+    });
+
+    it('should forget the reference when the content was evicted', async () => {
+      AsyncStorage.getItem = jest.fn().mockResolvedValueOnce(
+        JSON.stringify({ contentDigest: 'abc123', prefix: '' }),
+      );
+      const removeItemSpy = jest.spyOn(AsyncStorage, 'removeItem').mockResolvedValueOnce(undefined);
+      (FileOpenPicker!.readContent as jest.Mock).mockResolvedValueOnce(null);
+
+      const result = await CacheService.getInstance().retrieveDocumentData('docId');
+
+      expect(result).toBeNull();
+      expect(removeItemSpy).toHaveBeenCalledWith('docId');
+    });
+
+    it('should return plain cached data unchanged', async () => {
+      AsyncStorage.getItem = jest.fn().mockResolvedValueOnce(JSON.stringify('JVBERi0='));
+
+      const result = await CacheService.getInstance().retrieveDocumentData('docId');
+
+      expect(result).toEqual('JVBERi0=');
+    });
+  });
+
   describe('removeValueAt', () => {
     it('should remove a value from AsyncStorage', async () => {
       const removeItemSpy = jest.spyOn(AsyncStorage, 'removeItem').mockResolvedValueOnce(undefined);
@@ -109,4 +254,70 @@ describe('CacheService', () => {
       expect(consoleErrorSpy).toHaveBeenCalledWith('Error clearing cache', error);
     });
   });
+
+  describe('native store', () => {
+    // A fresh CacheService for each test, so switching stores does not leak into the tests above
+    function loadModules(): { AsyncStorage: typeof AsyncStorage; CacheStore: { [method: string]: jest.Mock }; CacheService: typeof CacheService } {
+      return loadIsolated(() => ({
+        AsyncStorage: require('@react-native-async-storage/async-storage').default,
+        CacheStore: require('../../../src/business-logic/modules/CacheStore').default,
+        CacheService: require('../../../src/business-logic/services/CacheService').default,
+      }));
+    }
+
+    it('should move AsyncStorage contents to the native store', async () => {
+      const { AsyncStorage: storage, CacheStore, CacheService: Service } = loadModules();
+      jest.spyOn(storage, 'getAllKeys').mockResolvedValueOnce(['a', 'b']);
+      jest.spyOn(storage, 'multiGet').mockResolvedValueOnce([['a', '"1"'], ['b', null]]);
+      const multiRemoveSpy = jest.spyOn(storage, 'multiRemove').mockResolvedValueOnce(undefined);
+      CacheStore.setMany.mockResolvedValueOnce(true);
+
+      const moved = await Service.getInstance().useNativeStore();
+
+      expect(moved).toBe(true);
+      expect(CacheStore.setMany).toHaveBeenCalledWith([{ key: 'a', value: '"1"', ttlMs: 0 }]);
+      expect(multiRemoveSpy).toHaveBeenCalledWith(['a', 'b']);
+    });
+
+    it('should read, write and remove through the native store once moved', async () => {
+      const { AsyncStorage: storage, CacheStore, CacheService: Service } = loadModules();
+      jest.spyOn(storage, 'getAllKeys').mockResolvedValueOnce([]);
+      const setItemSpy = jest.spyOn(storage, 'setItem');
+      const cacheService = Service.getInstance();
+      await cacheService.useNativeStore();
+
+      CacheStore.set.mockResolvedValueOnce(true);
+      await cacheService.storeValue('token', { value: 'abc' }, 60000);
+      CacheStore.get.mockResolvedValueOnce(JSON.stringify({ value: 'abc' }));
+      const result = await cacheService.retrieveValue('token');
+      CacheStore.remove.mockResolvedValueOnce(true);
+      await cacheService.removeValueAt('token');
+      CacheStore.clear.mockResolvedValueOnce(true);
+      await cacheService.clearStorage();
+
+      expect(CacheStore.set).toHaveBeenCalledWith('token', JSON.stringify({ value: 'abc' }), 60000);
+      expect(result).toEqual({ value: 'abc' });
+      expect(CacheStore.remove).toHaveBeenCalledWith('token');
+      expect(CacheStore.clear).toHaveBeenCalled();
+      expect(setItemSpy).not.toHaveBeenCalled();
+    });
+
+    it('should stay on AsyncStorage when the move fails', async () => {
+      const { AsyncStorage: storage, CacheStore, CacheService: Service } = loadModules();
+      jest.spyOn(storage, 'getAllKeys').mockResolvedValueOnce(['a']);
+      jest.spyOn(storage, 'multiGet').mockResolvedValueOnce([['a', '"1"']]);
+      const multiRemoveSpy = jest.spyOn(storage, 'multiRemove');
+      const setItemSpy = jest.spyOn(storage, 'setItem').mockResolvedValueOnce(undefined);
+      jest.spyOn(console, 'log').mockImplementation();
+      CacheStore.setMany.mockRejectedValueOnce('Error writing cache');
+      const cacheService = Service.getInstance();
+
+      const moved = await cacheService.useNativeStore();
+      await cacheService.storeValue('a', 2);
+
+      expect(moved).toBe(false);
+      expect(multiRemoveSpy).not.toHaveBeenCalled();
+      expect(setItemSpy).toHaveBeenCalledWith('a', '2');
+    });
+  });
 });
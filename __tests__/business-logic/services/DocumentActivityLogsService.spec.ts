@@ -0,0 +1,109 @@
+import IDocumentActivityLog from '../../../src/business-logic/model/IDocumentActivityLog';
+import DocumentLogAction from '../../../src/business-logic/model/enums/DocumentLogAction';
+import FileSavePicker from '../../../src/business-logic/modules/FileSavePicker';
+import APIService from '../../../src/business-logic/services/APIService';
+import DocumentActivityLogsService from '../../../src/business-logic/services/DocumentActivityLogsService';
+
+jest.mock('react-native', () => ({
+  Platform: { OS: 'windows' },
+}));
+
+jest.mock('../../../src/business-logic/services/APIService');
+
+jest.mock('../../../src/business-logic/modules/FileSavePicker', () => ({
+  __esModule: true,
+  default: {
+    beginExport: jest.fn(),
+    writeExportRows: jest.fn(),
+    finishExport: jest.fn(),
+    cancelExport: jest.fn(),
+  },
+}));
+
+const savePicker = FileSavePicker as jest.Mocked<NonNullable<typeof FileSavePicker>>;
+const apiGet = APIService.get as jest.MockedFunction<typeof APIService.get>;
+
+function makeLog(index: number): IDocumentActivityLog {
+  return {
+    name: `document ${index}`,
+    actorUsername: 'john.doe',
+    actionDate: `2024-01-${String(index).padStart(2, '0')}`,
+    documentID: { id: `doc${index}` },
+    clientID: { id: 'client1' },
+    action: DocumentLogAction.Creation,
+    actorIsAdmin: index % 2 === 0,
+  };
+}
+
+describe('DocumentActivityLogsService', () => {
+  beforeEach(() => {
+    jest.clearAllMocks();
+    savePicker.beginExport.mockResolvedValue(true);
+    savePicker.writeExportRows.mockResolvedValue(true);
+    savePicker.cancelExport.mockResolvedValue(true);
+  });
+
+  describe('exportLogsForClient', () => {
+    it('should write the header then one batch per page until the last page', async () => {
+      const pages = [[makeLog(1), makeLog(2)], [makeLog(3), makeLog(4)], [makeLog(5)]];
+      for (const logs of pages) {
+        apiGet.mockResolvedValueOnce({ logs, pageCount: pages.length });
+      }
+      const exportResult = { fileName: 'activity-logs.csv', path: 'C:\\activity-logs.csv', rows: 6, bytes: 512 };
+      savePicker.finishExport.mockResolvedValue(exportResult);
+
+      const result = await DocumentActivityLogsService.getInstance().exportLogsForClient('client1', { value: 'mockToken' } as any, 'csv', 2);
+
+      expect(result).toEqual(exportResult);
+      expect(apiGet).toHaveBeenCalledTimes(3);
+      expect(apiGet).toHaveBeenNthCalledWith(1, 'documentActivityLogs/client1/paginate?page=1&perPage=2', 'mockToken');
+      expect(apiGet).toHaveBeenNthCalledWith(3, 'documentActivityLogs/client1/paginate?page=3&perPage=2', 'mockToken');
+      const batches = savePicker.writeExportRows.mock.calls.map(call => call[1]);
+      expect(batches).toHaveLength(4);
+      expect(batches[0]).toEqual([['name', 'actorUsername', 'actionDate', 'action', 'actorIsAdmin', 'documentID', 'formID']]);
+      expect(batches[1][0]).toEqual(['document 1', 'john.doe', '2024-01-01', DocumentLogAction.Creation, false, 'doc1', null]);
+      expect(batches[3]).toHaveLength(1);
+      // Every batch goes to the export that was opened
+      const requestId = savePicker.beginExport.mock.calls[0][0];
+      expect(savePicker.writeExportRows.mock.calls.every(call => call[0] === requestId)).toBe(true);
+      expect(savePicker.finishExport).toHaveBeenCalledWith(requestId);
+      expect(savePicker.cancelExport).not.toHaveBeenCalled();
+    });
+
+    it('should cancel the export and rethrow when a page fails to load', async () => {
+      const error = new Error('Failed to load logs');
+      apiGet.mockResolvedValueOnce({ logs: [makeLog(1)], pageCount: 3 });
+      apiGet.mockRejectedValueOnce(error);
+
+      await expect(DocumentActivityLogsService.getInstance().exportLogsForClient('client1', null, 'xlsx', 1)).rejects.toThrow(error);
+
+      const requestId = savePicker.beginExport.mock.calls[0][0];
+      expect(savePicker.beginExport).toHaveBeenCalledWith(requestId, 'xlsx', 'activity-logs', ',');
+      expect(savePicker.cancelExport).toHaveBeenCalledWith(requestId);
+      expect(savePicker.finishExport).not.toHaveBeenCalled();
+      expect(apiGet).toHaveBeenCalledTimes(2);
+    });
+
+    it('should cancel the export when a batch cannot be written', async () => {
+      const error = new Error('Disk full');
+      apiGet.mockResolvedValue({ logs: [makeLog(1)], pageCount: 2 });
+      savePicker.writeExportRows.mockResolvedValueOnce(true).mockRejectedValueOnce(error);
+
+      await expect(DocumentActivityLogsService.getInstance().exportLogsForClient('client1', null, 'csv')).rejects.toThrow(error);
+
+      expect(savePicker.cancelExport).toHaveBeenCalledWith(savePicker.beginExport.mock.calls[0][0]);
+      expect(savePicker.finishExport).not.toHaveBeenCalled();
+    });
+
+    it('should not fetch any log when the save dialog is dismissed', async () => {
+      savePicker.beginExport.mockResolvedValue('Export cancelled');
+
+      const result = await DocumentActivityLogsService.getInstance().exportLogsForClient('client1', null, 'csv');
+
+      expect(result).toBeNull();
+      expect(apiGet).not.toHaveBeenCalled();
+      expect(savePicker.writeExportRows).not.toHaveBeenCalled();
+      expect(savePicker.cancelExport).not.toHaveBeenCalled();
+    });
+  });
+});
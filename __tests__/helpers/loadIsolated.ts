@@ -0,0 +1,15 @@
+/**
+ * Requires modules in a fresh module registry, so state kept at module level, such as a
+ * singleton or the platform a service detected on import, starts over for each test.
+ * @param load - Requires and returns the modules under test.
+ * @param setup - Sets up jest.doMock factories that apply to this registry only.
+ * @returns What `load` returned.
+ */
+export function loadIsolated<T>(load: () => T, setup?: () => void): T {
+  let modules: T | undefined;
+  jest.isolateModules(() => {
+    setup?.();
+    modules = load();
+  });
+  return modules as T;
+}
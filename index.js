@@ -5,5 +5,9 @@
 import {AppRegistry} from 'react-native';
 import App from './App';
 import {name as appName} from './app.json';
+import CacheService from './src/business-logic/services/CacheService';
+
+// Before anything reads the cache, so no read or write races the move out of AsyncStorage
+CacheService.getInstance().useNativeStore();
 
 AppRegistry.registerComponent(appName, () => App);
@@ -124,9 +124,12 @@ class FormEditionManager {
   /**
    * Loads and sets the grid from a form
    * @param form The form to load the grid from
+   * @param grid An already parsed grid, used instead of the form value when provided
    */
-  async loadGrid(form: IForm | undefined) {
-    if (form) {
+  async loadGrid(form: IForm | undefined, grid?: IFormCell[][]) {
+    if (grid) {
+      this.setGrid(grid);
+    } else if (form) {
       const gridFromCSV = DataUtils.csvToGrid(form.value);
       this.setGrid(gridFromCSV);
     }
@@ -125,6 +125,34 @@ class DocumentScreenManager {
     }
   }
 
+  /**
+   * Picks a PDF on Windows and streams it to the API as form data.
+   * @param requestId - The id used to cancel the upload.
+   * @param fileName - The name to assign to the uploaded file.
+   * @param destinationPath - The path where the file should be uploaded.
+   * @param token - An optional authentication token for the upload request.
+   * @returns A promise that resolves to the uploaded document, or undefined if no file was picked.
+   * @throws If an error occurs during the upload process.
+   */
+  async pickAndUploadWindowsFile(
+    requestId: string,
+    fileName: string,
+    destinationPath: string,
+    token: IToken | null,
+  ): Promise<IDocument | undefined> {
+    try {
+      const doc = await DocumentServicePost.uploadViaNativeStream(
+        requestId,
+        fileName,
+        destinationPath,
+        token,
+      );
+      return doc;
+    } catch (error) {
+      throw error;
+    }
+  }
+
   /**
    * Records an activity log for a document, tracking user actions such as viewing, editing, or sharing a document.
    * The log contains details such as the action performed, the user acting, and whether the user is an admin.
@@ -116,7 +116,8 @@ class PDFScreenManager {
       const cachedData = await CacheService.getInstance().retrieveValue(
         documentInput.id as string,
       );
-      return (cachedData as string[]) || null;
+      // The documents screens cache the raw download under the same id, only pages are usable here
+      return Array.isArray(cachedData) ? (cachedData as string[]) : null;
     } catch (error) {
       throw error;
     }
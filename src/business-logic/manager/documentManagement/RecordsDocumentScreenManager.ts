@@ -1,4 +1,9 @@
-import { NativeModules, PermissionsAndroid, Platform } from 'react-native';
+import {
+  DeviceEventEmitter,
+  NativeModules,
+  PermissionsAndroid,
+  Platform,
+} from 'react-native';
 // Enums
 import DocumentLogAction from '../../model/enums/DocumentLogAction';
 import MimeType from '../../model/enums/MimeType';
@@ -6,16 +11,31 @@ import PlatformName from '../../model/enums/PlatformName';
 // Model
 import IDocument from '../../model/IDocument';
 import { IDocumentActivityLogInput } from '../../model/IDocumentActivityLog';
-import IFile from '../../model/IFile';
 import IToken from '../../model/IToken';
 import IUser from '../../model/IUser';
 // Modules
-import FileOpenPicker from '../../modules/FileOpenPicker';
+import FileOpenPicker, {
+  FileOpenPickerEvent,
+  IFileUploadBatchResult,
+} from '../../modules/FileOpenPicker';
 import FinderModule from '../../modules/FinderModule';
 const { FilePickerModule } = NativeModules;
 // Services
 import DocumentActivityLogsService from '../../services/DocumentActivityLogsService';
 import DocumentServicePost from '../../services/DocumentService/DocumentService.post';
+// Utils
+import Utils from '../../utils/Utils';
+
+// A picked file that was not uploaded, and why
+export interface IFileUploadFailure {
+  fileName: string;
+  error: string;
+}
+
+export interface IWindowsFilesUpload {
+  documents: IDocument[];
+  failures: IFileUploadFailure[];
+}
 
 class RecordsDocumentScreenManager {
   private static instance: RecordsDocumentScreenManager;
@@ -80,7 +100,9 @@ class RecordsDocumentScreenManager {
         const file = await FilePickerModule.pickSingleFile([MimeType.pdf]);
         originPath = file.uri;
       } else if (Platform.OS === PlatformName.Windows) {
-        const filePath = await FileOpenPicker?.readPDFFileData();
+        const filePath = await FileOpenPicker?.readPDFFileData(
+          Utils.generateUUID(),
+        );
         if (filePath) {
           originPath = filePath;
         }
@@ -92,13 +114,59 @@ class RecordsDocumentScreenManager {
   }
 
   /**
-   * Prompts the user to pick a PDF file specifically for Windows and returns the file's data.
-   * @returns A promise that resolves to a string representing the path of the selected file, or undefined if no file is selected.
+   * Prompts the user to pick one or more PDF files on Windows and uploads each one natively,
+   * streamed from disk, rather than one dialog and one upload per file.
+   * The first file is named `fileName`, the next ones get an index suffix.
+   * A file that cannot be read or that the server refuses does not stop the others.
+   * @param fileName - The name of the file to be uploaded.
+   * @param documentDestinationPath - The destination path on the server where the documents will be stored.
+   * @param token - An optional token for authentication.
+   * @returns A promise that resolves to the created documents and the files that failed, both empty if no file is selected.
+   * @throws If an error occurs while starting the uploads.
    */
-  async pickWindowsFile(): Promise<string | undefined> {
-    let data: string | undefined;
-    data = await FileOpenPicker?.readPDFFileData();
-    return data;
+  async pickAndUploadWindowsFiles(
+    fileName: string,
+    documentDestinationPath: string,
+    token: IToken | null,
+  ): Promise<IWindowsFilesUpload> {
+    const requestId = Utils.generateUUID();
+    const upload: IWindowsFilesUpload = { documents: [], failures: [] };
+    const subscription = DeviceEventEmitter.addListener(
+      FileOpenPickerEvent.fileResult,
+      (result: IFileUploadBatchResult) => {
+        if (result.requestId !== requestId) {
+          return;
+        }
+        if (result.error || !result.body) {
+          upload.failures.push({
+            fileName: result.fileName,
+            error: result.error ?? 'Empty response',
+          });
+          return;
+        }
+        try {
+          upload.documents.push(JSON.parse(result.body) as IDocument);
+        } catch (error) {
+          upload.failures.push({
+            fileName: result.fileName,
+            error: (error as Error).message,
+          });
+        }
+      },
+    );
+    try {
+      await DocumentServicePost.uploadMultipleViaNativeStream(
+        requestId,
+        fileName,
+        documentDestinationPath,
+        token,
+      );
+      return upload;
+    } catch (error) {
+      throw error;
+    } finally {
+      subscription.remove();
+    }
   }
 
   /**
@@ -131,41 +199,6 @@ class RecordsDocumentScreenManager {
     }
   }
 
-  /**
-   * Uploads file data in Base64 format to the API.
-   *
-   * @param data - The Base64 encoded file data to be uploaded. Can be undefined.
-   * @param fileName - The name of the file to be uploaded.
-   * @param destinationPath - The destination path on the server where the document will be stored.
-   * @param token - An optional token for authentication.
-   *
-   * @returns A promise that resolves to an IDocument object representing the uploaded document, or undefined if no data was provided.
-   */
-  async uploadFileDataToAPI(
-    data: string | undefined,
-    fileName: string,
-    destinationPath: string,
-    token: IToken | null,
-  ): Promise<IDocument | undefined> {
-    if (data) {
-      try {
-        const file: IFile = {
-          data,
-          filename: fileName,
-        };
-        const doc = await DocumentServicePost.uploadViaBase64Data(
-          file,
-          fileName,
-          destinationPath,
-          token,
-        );
-        return doc;
-      } catch (error) {
-        throw error;
-      }
-    }
-  }
-
   /**
    * Records a log entry for a document activity.
    *
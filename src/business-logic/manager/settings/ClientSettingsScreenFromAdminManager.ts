@@ -6,13 +6,17 @@ import PlatformName from '../../model/enums/PlatformName';
 import IDocument from '../../model/IDocument';
 import IFile from '../../model/IFile';
 import IUser from '../../model/IUser';
-import FileOpenPicker from '../../modules/FileOpenPicker';
+import FileOpenPicker, {
+  LogoImageOptions,
+} from '../../modules/FileOpenPicker';
 import FinderModule from '../../modules/FinderModule';
 // Modules
 const { FilePickerModule } = NativeModules;
 // Services
 import CacheService from '../../services/CacheService';
 import DocumentServicePost from '../../services/DocumentService/DocumentService.post';
+// Utils
+import Utils from '../../utils/Utils';
 
 /**
  * A class to handle client settings screen from admin logic
@@ -54,7 +58,8 @@ class ClientSettingsScreenFromAdminManager {
   /**
    * Prompts the user to pick an image file for use as a logo on Windows.
    *
-   * This method uses the FileOpenPicker to allow the user to select an image file.
+   * This method uses the FileOpenPicker to allow the user to select an image file,
+   * which is scaled down natively to logo size before it is encoded.
    *
    * @returns A promise that resolves with the file path of the selected image file.
    *          If no file is selected, undefined is returned.
@@ -62,7 +67,13 @@ class ClientSettingsScreenFromAdminManager {
    */
   async pickLogoForWindows(): Promise<string | undefined> {
     let data: string | undefined;
-    data = await FileOpenPicker?.readImageFileData();
+    data = await FileOpenPicker?.readResizedImageFileData(
+      Utils.generateUUID(),
+      LogoImageOptions.maxWidth,
+      LogoImageOptions.maxHeight,
+      LogoImageOptions.quality,
+      LogoImageOptions.format,
+    );
     return data;
   }
 
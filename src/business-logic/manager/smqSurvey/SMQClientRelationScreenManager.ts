@@ -16,6 +16,8 @@ const { FilePickerModule } = NativeModules;
 // Services
 import DocumentActivityLogsService from '../../services/DocumentActivityLogsService';
 import DocumentServicePost from '../../services/DocumentService/DocumentService.post';
+// Utils
+import Utils from '../../utils/Utils';
 
 class SMQClientRelationScreenManager {
   private static instance: SMQClientRelationScreenManager;
@@ -65,7 +67,7 @@ class SMQClientRelationScreenManager {
    */
   async pickWindowsFile(): Promise<string | undefined> {
     let data: string | undefined;
-    data = await FileOpenPicker?.readPDFFileData();
+    data = await FileOpenPicker?.readPDFFileData(Utils.generateUUID());
     return data;
   }
 
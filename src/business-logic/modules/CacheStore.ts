@@ -0,0 +1,46 @@
+import { TurboModuleRegistry } from 'react-native';
+import type { TurboModule } from 'react-native/Libraries/TurboModule/RCTExport';
+
+// One write of a setMany batch. ttlMs of 0 keeps the entry until it is evicted.
+export interface ICacheStoreEntry {
+  key: string;
+  value: string;
+  ttlMs: number;
+}
+
+// Counters of the native store since it was opened. recoveredRecords and truncatedBytes are
+// non-zero when the app did not close cleanly and the index was rebuilt from the log.
+export interface ICacheStoreStats {
+  count: number;
+  liveBytes: number;
+  logBytes: number;
+  gets: number;
+  hits: number;
+  expired: number;
+  puts: number;
+  removes: number;
+  evictions: number;
+  commits: number;
+  committedRecords: number;
+  compactions: number;
+  recoveredRecords: number;
+  truncatedBytes: number;
+}
+
+export interface Spec extends TurboModule {
+  // Resolves with null when the key is unknown, expired or was evicted
+  get(key: string): Promise<string | null>;
+  set(key: string, value: string, ttlMs: number): Promise<boolean>;
+  // Written in order with a single commit
+  setMany(entries: ICacheStoreEntry[]): Promise<boolean>;
+  remove(key: string): Promise<boolean>;
+  clear(): Promise<boolean>;
+  // Rewrites the log without overwritten, removed and expired entries
+  compact(): Promise<boolean>;
+  // Syncs the log to disk so the next launch opens without a rebuild
+  flush(): Promise<boolean>;
+  getStats(): Promise<ICacheStoreStats>;
+}
+
+// Native log-structured key-value store, registered on Windows only
+export default TurboModuleRegistry.get<Spec>('CacheStore') as Spec | null;
@@ -1,13 +1,330 @@
 import { TurboModuleRegistry } from 'react-native';
 import type { TurboModule } from 'react-native/Libraries/TurboModule/RCTExport';
+import { IFormCell } from '../model/IForm';
+
+export type FileOpenPickerFileType = 'pdf' | 'image' | 'csv';
+
+// 'auto' keeps the format of the picked image
+export type FileOpenPickerImageFormat = 'jpeg' | 'png' | 'auto';
+
+export interface IImageResizeOptions {
+  maxWidth: number;
+  maxHeight: number;
+  // 0 to 1, only used for JPEG output
+  quality: number;
+  format: FileOpenPickerImageFormat;
+}
+
+// Logos are only ever displayed as small icons, no need to upload the full photo
+export const LogoImageOptions: IImageResizeOptions = {
+  maxWidth: 512,
+  maxHeight: 512,
+  quality: 0.85,
+  format: 'auto',
+};
+
+// Content-Encoding of an uploaded file: 'auto' gzips CSV and PDFs whose first 128 KiB
+// compress well and leaves JPEG and PNG alone, 'gzip' always compresses. Only the file part of
+// the multipart body is encoded, with its own Content-Encoding header, so the backend has to
+// decode it; a backend that refuses it with 415 gets the file again as is, but one that ignores
+// the header stores the gzip bytes as the document.
+export type FileOpenPickerCompression = 'none' | 'auto' | 'gzip';
+
+// The /documents route stores the file part as it arrives, so uploads go out uncompressed until
+// the backend decodes a gzip part
+export const NativeUploadCompression: FileOpenPickerCompression = 'none';
+
+// Events emitted through DeviceEventEmitter while a file is streamed
+export enum FileOpenPickerEvent {
+  chunk = 'fileOpenPickerChunk',
+  progress = 'fileOpenPickerProgress',
+  uploadProgress = 'fileOpenPickerUploadProgress',
+  fileResult = 'fileOpenPickerFileResult',
+}
+
+export interface IFileStreamChunk {
+  requestId: string;
+  index: number;
+  offset: number;
+  data: string;
+}
+
+export interface IFileStreamProgress {
+  requestId: string;
+  bytesRead: number;
+  totalBytes: number;
+}
+
+export interface IFileUploadProgress {
+  requestId: string;
+  // Position of the file in an uploadMultiplePDFFiles batch
+  index?: number;
+  bytesSent: number;
+  // -1 when the body is sent with chunked transfer encoding
+  totalBytes: number;
+}
+
+// One file of a readMultipleFileData batch, emitted in completion order
+export interface IFileBatchResult {
+  requestId: string;
+  index: number;
+  fileName: string;
+  data?: string;
+  digest?: string;
+  mimeType?: string;
+  error?: string;
+}
+
+export interface IFileBatchSummary {
+  requestId: string;
+  fileCount: number;
+  failedCount: number;
+}
+
+export interface IFileUploadResult {
+  statusCode: number;
+  body: string;
+  // 'gzip' when the file part was sent compressed, with its size on disk and on the wire
+  contentEncoding: 'identity' | 'gzip';
+  fileBytes: number;
+  encodedBytes: number;
+}
+
+// One file of an uploadMultiplePDFFiles batch, emitted in completion order. name is the
+// name it was uploaded under; error is set when it was rejected or the server refused it.
+export interface IFileUploadBatchResult extends Partial<IFileUploadResult> {
+  requestId: string;
+  index: number;
+  fileName: string;
+  name: string;
+  error?: string;
+}
+
+// Result of uploadPDFFileDelta. manifest is the hex digest naming this version, to pass as
+// baseManifest when its next version is uploaded; sentBytes counts the manifest and the chunks sent.
+export interface IFileDeltaUploadResult {
+  statusCode: number;
+  body: string;
+  manifest: string;
+  fileBytes: number;
+  sentBytes: number;
+  chunkCount: number;
+  sentChunks: number;
+}
+
+// Result of downloadFile. The file is in the content store under digest; resumedBytes were
+// already on disk from an earlier attempt, and verified tells whether a digest was checked.
+export interface IFileDownloadResult {
+  digest: string;
+  bytes: number;
+  resumedBytes: number;
+  fetchedBytes: number;
+  requests: number;
+  retries: number;
+  ranged: boolean;
+  verified: boolean;
+}
+
+// One result of searchDocuments. matchedTerms counts the query words the document contains;
+// score is the BM25 relevance that orders documents matching as many words.
+export interface IDocumentSearchHit {
+  documentId: string;
+  score: number;
+  matchedTerms: number;
+}
+
+export interface IDocumentIndexStats {
+  documents: number;
+  segments: number;
+  terms: number;
+  diskBytes: number;
+  commits: number;
+  merges: number;
+  searches: number;
+}
+
+export interface IFileStreamSummary {
+  requestId: string;
+  fileName: string;
+  totalBytes: number;
+  encodedLength: number;
+  chunkCount: number;
+}
+
+// Returned by openFile; the file stays open natively until closeFile
+export interface IFileHandle {
+  handle: number;
+  name: string;
+  mimeType: string;
+  size: number;
+}
+
+// From readPDFStructure. Dates are ISO 8601 when the file's are well formed. permissions is the
+// raw /P value, -1 when the file has none.
+export interface IPdfEncryption {
+  filter: string;
+  revision: number;
+  keyBits: number;
+  permissions: number;
+  canPrint: boolean;
+  canModify: boolean;
+  canCopy: boolean;
+}
+
+export interface IPdfMetadata {
+  title?: string;
+  author?: string;
+  subject?: string;
+  keywords?: string;
+  creator?: string;
+  producer?: string;
+  creationDate?: string;
+  modificationDate?: string;
+}
+
+// repaired is true when the cross-reference data was unusable and the file was scanned whole;
+// problems lists each thing found wrong, in the order found
+export interface IPdfStructure {
+  version: string;
+  fileSize: number;
+  pageCount: number | null;
+  linearized: boolean;
+  xrefSections: number;
+  xrefStreams: boolean;
+  encryption: IPdfEncryption | null;
+  metadata: IPdfMetadata;
+  hasXmpMetadata: boolean;
+  repaired: boolean;
+  problems: string[];
+  bytesRead: number;
+}
+
+// Per-stage counters from getStats. histogram maps a size class such as "<1MiB" to event
+// counts per latency bucket: bucket 0 is under 1 us, bucket k under 2^k us.
+export interface IFileStageStats {
+  count: number;
+  failures: number;
+  bytes: number;
+  totalMs: number;
+  maxMs: number;
+  histogram: { [sizeClass: string]: number[] };
+}
+
+// In-flight read memory: the budget every read reserves from, and the buffer pool behind it
+export interface IFileMemoryStats {
+  budget: {
+    limit: number;
+    bytesInUse: number;
+    peakBytesInUse: number;
+    admitted: number;
+    waited: number;
+    rejected: number;
+    waiting: number;
+  };
+  pool: {
+    allocations: number;
+    reuses: number;
+    discards: number;
+    bytesInUse: number;
+    peakBytesInUse: number;
+    bytesRetained: number;
+  };
+}
+
+export interface IFileOpenPickerStats {
+  recordedEvents: number;
+  stages: { [stage: string]: IFileStageStats };
+  memory: IFileMemoryStats;
+}
 
 export interface Spec extends TurboModule {
   pickPDFFile(): Promise<string>;
   pickImageFile(): Promise<string>;
   pickCSVFile(): Promise<string>;
-  readPDFFileData(): Promise<string>
-  readImageFileData(): Promise<string>;
-  readCSVFileData(): Promise<string>
+  readPDFFileData(requestId: string): Promise<string>
+  readImageFileData(requestId: string): Promise<string>;
+  // Scaled down to fit within maxWidth x maxHeight and re-encoded without metadata
+  readResizedImageFileData(
+    requestId: string,
+    maxWidth: number,
+    maxHeight: number,
+    quality: number,
+    format: FileOpenPickerImageFormat,
+  ): Promise<string>;
+  readCSVFileData(requestId: string): Promise<string>
+  readCSVFileGrid(requestId: string): Promise<IFormCell[][] | string>;
+  pickMultiplePDFFiles(): Promise<string[] | string>;
+  readMultipleFileData(
+    requestId: string,
+    fileType: FileOpenPickerFileType,
+  ): Promise<IFileBatchSummary | string>;
+  readFileDataStream(
+    requestId: string,
+    fileType: FileOpenPickerFileType,
+    chunkSize: number,
+  ): Promise<IFileStreamSummary | string>;
+  uploadPDFFile(
+    requestId: string,
+    url: string,
+    token: string,
+    fileName: string,
+    destinationPath: string,
+    compression: FileOpenPickerCompression,
+  ): Promise<IFileUploadResult | string>;
+  // Uploads each picked PDF as uploadPDFFile does, reporting every file through a fileResult
+  // event; the first keeps fileName and the next ones get _2, _3... before the extension
+  uploadMultiplePDFFiles(
+    requestId: string,
+    url: string,
+    token: string,
+    fileName: string,
+    destinationPath: string,
+    compression: FileOpenPickerCompression,
+  ): Promise<IFileBatchSummary | string>;
+  // Sends only the content-defined chunks missing from the version named by baseManifest,
+  // '' to send them all
+  uploadPDFFileDelta(
+    requestId: string,
+    url: string,
+    token: string,
+    fileName: string,
+    destinationPath: string,
+    baseManifest: string,
+  ): Promise<IFileDeltaUploadResult | string>;
+  // Downloads url into the content store over parallel Range requests, resuming an earlier
+  // attempt. expectedDigest is a hex SHA-256, or '' to check the server's Repr-Digest if any.
+  downloadFile(
+    requestId: string,
+    url: string,
+    token: string,
+    expectedDigest: string,
+  ): Promise<IFileDownloadResult>;
+  // Content-addressed store, digests are hex SHA-256 of the decoded bytes
+  storeContent(data: string): Promise<string>;
+  readContent(digest: string): Promise<string | null>;
+  hasContent(digest: string): Promise<boolean>;
+  // Full-text index of PDFs in the content store. indexDocument resolves with false when the
+  // digest is unknown or its content is not a readable PDF. Queries ignore case, accents and
+  // plurals; the last word also matches as a prefix unless the query ends with a space.
+  indexDocument(documentId: string, digest: string): Promise<boolean>;
+  removeIndexedDocument(documentId: string): Promise<boolean>;
+  searchDocuments(query: string, limit: number): Promise<IDocumentSearchHit[]>;
+  getIndexStats(): Promise<IDocumentIndexStats>;
+  // Random access without loading the whole file. readFileRange resolves with the base64
+  // bytes of [offset, offset + length), clipped to the end of the file, 16 MiB at most.
+  openFile(fileType: FileOpenPickerFileType): Promise<IFileHandle | string>;
+  readFileRange(handle: number, offset: number, length: number): Promise<string>;
+  closeFile(handle: number): Promise<boolean>;
+  // Page count, metadata and validity of an open PDF, from its tail and the objects it
+  // points to rather than the whole file
+  readPDFStructure(handle: number): Promise<IPdfStructure>;
+  // Diagnostics: stage counters since launch, and recent events as Chrome trace JSON
+  getStats(): Promise<IFileOpenPickerStats>;
+  getTrace(): Promise<string>;
+  // Bytes all reads may hold at once. Reads that would go over it wait their turn, and a file
+  // that can never fit is rejected with an explicit error.
+  setMemoryBudget(bytes: number): Promise<boolean>;
+  cancel(requestId: string): Promise<boolean>;
 }
 
 // Lier le module natif appelé "Estudies" (le nom défini dans le module C++)
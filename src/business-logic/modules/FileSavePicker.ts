@@ -0,0 +1,33 @@
+import { TurboModuleRegistry } from 'react-native';
+import type { TurboModule } from 'react-native/Libraries/TurboModule/RCTExport';
+
+export type FileSavePickerFormat = 'csv' | 'xlsx';
+
+// One exported row; null leaves the cell empty
+export type FileSavePickerCell = string | number | boolean | null;
+
+export interface IFileExportResult {
+  fileName: string;
+  path: string;
+  rows: number;
+  bytes: number;
+}
+
+export interface Spec extends TurboModule {
+  // Resolves with true once the picked file is open, or with a message when the dialog is dismissed.
+  // delimiter is ',' or ';' and only used for CSV.
+  beginExport(
+    requestId: string,
+    format: FileSavePickerFormat,
+    suggestedName: string,
+    delimiter: string,
+  ): Promise<boolean | string>;
+  // Await each batch before sending the next: a batch sent while one is still written is rejected
+  writeExportRows(requestId: string, rows: FileSavePickerCell[][]): Promise<boolean>;
+  finishExport(requestId: string): Promise<IFileExportResult>;
+  // Deletes the partial file
+  cancelExport(requestId: string): Promise<boolean>;
+}
+
+// Native streaming export, registered on Windows only
+export default TurboModuleRegistry.get<Spec>('FileSavePicker') as Spec | null;
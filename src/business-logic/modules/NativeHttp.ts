@@ -0,0 +1,41 @@
+import { TurboModuleRegistry } from 'react-native';
+import type { TurboModule } from 'react-native/Libraries/TurboModule/RCTExport';
+
+export interface INativeHttpRequest {
+  method: string;
+  url: string;
+  headers: Record<string, string>;
+  body?: string;
+  // 'json' parses JSON answers natively, off the JS thread; 'text' leaves the body as a string
+  responseType: 'json' | 'text';
+}
+
+// Settles for any status, as fetch does. body is the parsed value when the request asked for
+// json and the answer is JSON, and the raw text otherwise. coalesced is true when the answer
+// came from an identical GET that was already in flight.
+export interface INativeHttpResponse {
+  status: number;
+  ok: boolean;
+  contentType: string;
+  body: any;
+  coalesced: boolean;
+}
+
+// Counters since the module was created. requests reached the server; coalesced did not.
+export interface INativeHttpStats {
+  requests: number;
+  coalesced: number;
+  inFlight: number;
+  failures: number;
+  parsedBytes: number;
+}
+
+export interface Spec extends TurboModule {
+  request(requestId: string, options: INativeHttpRequest): Promise<INativeHttpResponse>;
+  // Resolves with false when the request is unknown or already finished
+  cancel(requestId: string): Promise<boolean>;
+  getStats(): Promise<INativeHttpStats>;
+}
+
+// Pooled HTTP client with per-host limits and coalescing of identical GETs, Windows only
+export default TurboModuleRegistry.get<Spec>('NativeHttp') as Spec | null;
@@ -1,10 +1,24 @@
 import AsyncStorage from '@react-native-async-storage/async-storage';
+import { Platform } from 'react-native';
+import PlatformName from '../model/enums/PlatformName';
+import CacheStore from '../modules/CacheStore';
+import FileOpenPicker, { IDocumentSearchHit } from '../modules/FileOpenPicker';
+
+/**
+ * Cached reference to document data kept in the native content store on Windows.
+ */
+interface IContentReference {
+  contentDigest: string;
+  prefix: string;
+}
 
 /**
  * Represents a cache service that provides methods for storing, retrieving, and removing values from cache.
  */
 class CacheService {
   private static instance: CacheService | null = null;
+  // Resolves with true once values live in the native CacheStore instead of AsyncStorage
+  private nativeStore: Promise<boolean> = Promise.resolve(false);
 
   private constructor() {}
 
@@ -19,14 +33,50 @@ class CacheService {
     return CacheService.instance;
   }
 
+  /**
+   * Moves the cache to the native CacheStore module when it is registered (Windows only).
+   * Everything in AsyncStorage is copied over in one batch and then removed from AsyncStorage,
+   * so both stores never hold the same key. Call it once at startup, before the first read;
+   * calls made meanwhile wait for the move. On failure the cache stays on AsyncStorage.
+   * @returns A promise that resolves to true if the native store is now in use.
+   */
+  useNativeStore(): Promise<boolean> {
+    this.nativeStore = this.nativeStore.then(async (alreadyNative) => {
+      if (alreadyNative || Platform.OS !== PlatformName.Windows || !CacheStore) {
+        return alreadyNative;
+      }
+      try {
+        const keys = await AsyncStorage.getAllKeys();
+        if (keys.length > 0) {
+          const pairs = await AsyncStorage.multiGet(keys);
+          const entries = pairs
+            .filter(([, value]) => value !== null)
+            .map(([key, value]) => ({ key, value: value as string, ttlMs: 0 }));
+          await CacheStore.setMany(entries);
+          await AsyncStorage.multiRemove(keys);
+        }
+        return true;
+      } catch (error) {
+        console.log('Error moving cache to the native store', error);
+        return false;
+      }
+    });
+    return this.nativeStore;
+  }
+
   /**
    * Stores a value in the cache.
    * @param key - The key under which the value will be stored.
    * @param value - The value to be stored.
+   * @param ttlMs - Milliseconds after which the value expires, 0 for never. Only the native store expires values.
    */
-  async storeValue<T>(key: string, value: T) {
+  async storeValue<T>(key: string, value: T, ttlMs: number = 0) {
     try {
-      await AsyncStorage.setItem(key, JSON.stringify(value))
+      if (await this.nativeStore) {
+        await CacheStore!.set(key, JSON.stringify(value), ttlMs);
+      } else {
+        await AsyncStorage.setItem(key, JSON.stringify(value));
+      }
     } catch (error) {
       console.log('Error when trying to cache data for key:', key, 'with:', value, error);
     }
@@ -40,7 +90,7 @@ class CacheService {
   async retrieveValue<T>(key: string): Promise<string | T | null> {
     let item: T | string | null = null;
     try {
-      const storedItem = await AsyncStorage.getItem(key);
+      const storedItem = (await this.nativeStore) ? await CacheStore!.get(key) : await AsyncStorage.getItem(key);
       if (storedItem) {
         item = JSON.parse(storedItem);
       }
@@ -50,13 +100,92 @@ class CacheService {
     return item;
   }
 
+  /**
+   * Stores base64 document data in the cache.
+   * On Windows the bytes go to the native content-addressed store and only their digest is cached,
+   * so a document downloaded several times, or under several ids, is kept on disk once.
+   * @param key - The key under which the data will be stored.
+   * @param data - The document data, with or without its data URL prefix.
+   */
+  async storeDocumentData(key: string, data: string) {
+    if (Platform.OS === PlatformName.Windows && FileOpenPicker) {
+      try {
+        const [, prefix, base64] = data.match(/^(data:[^,]*,)?([\s\S]*)$/) as RegExpMatchArray;
+        const contentDigest = await FileOpenPicker.storeContent(base64);
+        await this.storeDocumentReference(key, contentDigest, prefix ?? '');
+        return;
+      } catch (error) {
+        console.log('Error storing content for key:', key, error);
+      }
+    }
+    await this.storeValue(key, data);
+  }
+
+  /**
+   * Caches a reference to bytes already in the native content store, e.g. a document fetched
+   * with FileOpenPicker.downloadFile, so that retrieveDocumentData reads them back as data.
+   * @param key - The key under which the reference will be stored.
+   * @param contentDigest - The hex SHA-256 the content store knows the bytes by.
+   * @param prefix - The data URL prefix put back in front of the base64 data, '' for none.
+   */
+  async storeDocumentReference(key: string, contentDigest: string, prefix: string) {
+    const reference: IContentReference = { contentDigest, prefix };
+    await this.storeValue(key, reference);
+    if ((prefix === '' || prefix.includes('pdf')) && FileOpenPicker) {
+      // Indexing runs in the background, a document that cannot be indexed is still cached
+      FileOpenPicker.indexDocument(key, contentDigest).catch((error) => {
+        console.log('Error indexing document:', key, error);
+      });
+    }
+  }
+
+  /**
+   * Searches the text of the PDF documents cached on this device (Windows only).
+   * @param query - Words to look for; case, accents and plurals are ignored.
+   * @param limit - The most results to return.
+   * @returns A promise that resolves to the matching documents, best first, or [] elsewhere.
+   */
+  async searchCachedDocuments(query: string, limit: number = 20): Promise<IDocumentSearchHit[]> {
+    if (Platform.OS !== PlatformName.Windows || !FileOpenPicker || query.trim() === '') {
+      return [];
+    }
+    try {
+      return await FileOpenPicker.searchDocuments(query, limit);
+    } catch (error) {
+      console.log('Error searching cached documents:', query, error);
+      return [];
+    }
+  }
+
+  /**
+   * Retrieves document data stored with storeDocumentData.
+   * @param key - The key of the data to be retrieved.
+   * @returns A promise that resolves to the base64 data, or null if it is not cached or was evicted.
+   */
+  async retrieveDocumentData(key: string): Promise<string | null> {
+    const item = await this.retrieveValue<string | IContentReference>(key);
+    if (item === null || typeof item === 'string') {
+      return item;
+    }
+    const base64 = FileOpenPicker ? await FileOpenPicker.readContent(item.contentDigest) : null;
+    if (base64 === null) {
+      await this.removeValueAt(key);
+      return null;
+    }
+    return `${item.prefix}${base64}`;
+  }
+
   /**
    * Removes a value from the cache.
    * @param key - The key of the value to be removed.
    */
   async removeValueAt(key: string) {
     try {
-      await AsyncStorage.removeItem(key);
+      if (await this.nativeStore) {
+        await CacheStore!.remove(key);
+      } else {
+        await AsyncStorage.removeItem(key);
+      }
     } catch (error) {
       console.log('Error removing cached value at:', key, error);
     }
@@ -67,7 +196,11 @@ class CacheService {
    */
   async clearStorage() {
     try {
-      await AsyncStorage.clear()
+      if (await this.nativeStore) {
+        await CacheStore!.clear();
+      } else {
+        await AsyncStorage.clear();
+      }
     } catch (error) {
       console.log('Error clearing cache', error);
     }
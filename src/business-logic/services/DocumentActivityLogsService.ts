@@ -1,5 +1,7 @@
 import IDocumentActivityLog, { IDocumentActivityLogInput, IDocumentActivityLogPaginatedOutput } from '../model/IDocumentActivityLog';
 import IToken from '../model/IToken';
+import { FileSavePickerFormat, IFileExportResult } from '../modules/FileSavePicker';
+import DataUtils from '../utils/DataUtils';
 import APIService from './APIService';
 
 /**
@@ -67,6 +69,41 @@ class DocumentActivityLogsService {
       throw error;
     }
   }
+
+  /**
+   * Exports all the document activity logs of a client to a file, one page at a time.
+   * @param clientID - The ID of the client.
+   * @param token - The authentication token.
+   * @param format - 'csv' or 'xlsx'.
+   * @param perPage - The number of logs fetched and written per batch.
+   * @returns The export result, or null if the export was dismissed.
+   */
+  async exportLogsForClient(clientID: string | undefined, token: IToken | null, format: FileSavePickerFormat, perPage: number = 500): Promise<IFileExportResult | null> {
+    let page = 1;
+    let pageCount = 1;
+    return DataUtils.exportTable(
+      'activity-logs',
+      format,
+      ['name', 'actorUsername', 'actionDate', 'action', 'actorIsAdmin', 'documentID', 'formID'],
+      async () => {
+        if (page > pageCount) {
+          return null;
+        }
+        const output = await this.getPaginatedLogsForClient(clientID, token, page, perPage);
+        pageCount = output.pageCount;
+        page += 1;
+        return output.logs.map(log => [
+          log.name,
+          log.actorUsername,
+          log.actionDate,
+          log.action,
+          log.actorIsAdmin,
+          log.documentID?.id ?? null,
+          log.formID?.id ?? null,
+        ]);
+      },
+    );
+  }
 }
 
 export default DocumentActivityLogsService;
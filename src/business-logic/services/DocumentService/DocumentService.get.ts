@@ -1,10 +1,19 @@
+import { Platform } from 'react-native';
+import PlatformName from '../../model/enums/PlatformName';
 import IDocument from '../../model/IDocument';
 import IToken from '../../model/IToken';
+import FileOpenPicker from '../../modules/FileOpenPicker';
+import DataUtils from '../../utils/DataUtils';
+import { API_BASE_URL } from '../../utils/envConfig';
 import APIService from '../APIService';
+import CacheService from '../CacheService';
 import DocumentService from './DocumentService';
 
 class DocumentServiceGet extends DocumentService {
   static baseRoute = 'documents';
+  // Native downloads in flight by document ID, so a second request for a document joins the
+  // first instead of writing to the same partial file
+  private static pendingDownloads = new Map<string, Promise<void>>();
 
   /**
    * Downloads the document with the specified ID.
@@ -23,6 +32,43 @@ class DocumentServiceGet extends DocumentService {
     }
   }
 
+  /**
+   * Downloads a PDF document into the document cache, where CacheService.retrieveDocumentData finds it.
+   * On Windows the native module fetches it in parallel ranges straight to disk, resumes an
+   * interrupted download and checks its digest; elsewhere it is downloaded through JS.
+   * @param id - The ID of the document to download.
+   * @param token - The authentication token.
+   * @returns A promise that resolves once the document is cached.
+   * @throws If an error occurs while downloading the document.
+   */
+  static async downloadToCache(id: string, token: IToken | null): Promise<void> {
+    try {
+      if (Platform.OS === PlatformName.Windows && FileOpenPicker) {
+        let pending = this.pendingDownloads.get(id);
+        if (!pending) {
+          pending = this.downloadNatively(FileOpenPicker, id, token).finally(() => this.pendingDownloads.delete(id));
+          this.pendingDownloads.set(id, pending);
+        }
+        await pending;
+        return;
+      }
+      const data = await this.download(id, token);
+      await CacheService.getInstance().storeDocumentData(id, DataUtils.changeMimeType(data, 'application/pdf'));
+    } catch (error) {
+      throw error;
+    }
+  }
+
+  private static async downloadNatively(picker: NonNullable<typeof FileOpenPicker>, id: string, token: IToken | null): Promise<void> {
+    const result = await picker.downloadFile(
+      `download-${id}`,
+      `${API_BASE_URL}/${this.baseRoute}/download/${id}`,
+      token?.value ?? '',
+      '',
+    );
+    await CacheService.getInstance().storeDocumentReference(id, result.digest, 'data:application/pdf;base64,');
+  }
+
   /**
    * Get all documents
    * @param token - The authentication token.
@@ -3,8 +3,17 @@ import MimeType from '../../model/enums/MimeType';
 import IDocument, { IDocumentPaginatedOutput } from '../../model/IDocument';
 import IFile from '../../model/IFile';
 import IToken from '../../model/IToken';
+// Modules
+import FileOpenPicker, {
+  FileOpenPickerCompression,
+  IFileBatchSummary,
+  NativeUploadCompression,
+} from '../../modules/FileOpenPicker';
+// Utils
+import { API_BASE_URL } from '../../utils/envConfig';
 // Services
 import APIService from '../APIService';
+import CacheService from '../CacheService';
 import DocumentService from './DocumentService';
 
 class DocumentServicePost extends DocumentService {
@@ -164,6 +173,119 @@ class DocumentServicePost extends DocumentService {
     }
   }
 
+  /**
+   * Picks a PDF and uploads it as form data through the native module ( for Windows ).
+   * The file is streamed from disk by the native side instead of going through base64 in JS.
+   * @param requestId - The id used to cancel the upload with FileOpenPicker.cancel.
+   * @param name - The name of the document.
+   * @param path - The path to upload the document to.
+   * @param token - The authentication token (optional).
+   * @param compression - Whether the file part may be sent gzip-encoded, NativeUploadCompression unless given.
+   * @returns A promise that resolves to the uploaded document, or undefined if no file was picked.
+   * @throws If an error occurs while uploading the document.
+   */
+  static async uploadViaNativeStream(
+    requestId: string,
+    name: string,
+    path: string,
+    token: IToken | null,
+    compression: FileOpenPickerCompression = NativeUploadCompression,
+  ): Promise<IDocument | undefined> {
+    try {
+      const result = await FileOpenPicker?.uploadPDFFile(
+        requestId,
+        `${API_BASE_URL}/${this.baseRoute}`,
+        token?.value ?? '',
+        name,
+        path,
+        compression,
+      );
+      if (!result || typeof result === 'string') {
+        return undefined;
+      }
+      return JSON.parse(result.body) as IDocument;
+    } catch (error) {
+      throw error;
+    }
+  }
+
+  /**
+   * Picks one or more PDFs and uploads each one as form data through the native module ( for Windows ).
+   * Every file is streamed from disk like in uploadViaNativeStream; its outcome is delivered as a
+   * FileOpenPickerEvent.fileResult event carrying the requestId.
+   * @param requestId - The id used to cancel the uploads with FileOpenPicker.cancel.
+   * @param name - The name of the first document, the next ones get an index suffix.
+   * @param path - The path to upload the documents to.
+   * @param token - The authentication token (optional).
+   * @param compression - Whether the file parts may be sent gzip-encoded, NativeUploadCompression unless given.
+   * @returns A promise that resolves to the batch summary once every file is done, or undefined if no file was picked.
+   * @throws If an error occurs while starting the uploads.
+   */
+  static async uploadMultipleViaNativeStream(
+    requestId: string,
+    name: string,
+    path: string,
+    token: IToken | null,
+    compression: FileOpenPickerCompression = NativeUploadCompression,
+  ): Promise<IFileBatchSummary | undefined> {
+    try {
+      const summary = await FileOpenPicker?.uploadMultiplePDFFiles(
+        requestId,
+        `${API_BASE_URL}/${this.baseRoute}`,
+        token?.value ?? '',
+        name,
+        path,
+        compression,
+      );
+      if (!summary || typeof summary === 'string') {
+        return undefined;
+      }
+      return summary;
+    } catch (error) {
+      throw error;
+    }
+  }
+
+  /**
+   * Picks a new version of a PDF and uploads only the parts that changed since the last version
+   * uploaded from this device ( for Windows ). The native module cuts the file into chunks and
+   * sends those missing from the previous version's manifest, whose digest is cached per document.
+   * Not used by any screen yet: the backend has no `/delta` route and the app has no flow that
+   * uploads a new version of an existing document. Call it from that flow once both exist.
+   * @param requestId - The id used to cancel the upload with FileOpenPicker.cancel.
+   * @param name - The name of the document.
+   * @param path - The path to upload the document to.
+   * @param token - The authentication token (optional).
+   * @returns A promise that resolves to the uploaded document, or undefined if no file was picked.
+   * @throws If an error occurs while uploading the document.
+   */
+  static async uploadViaNativeDelta(
+    requestId: string,
+    name: string,
+    path: string,
+    token: IToken | null,
+  ): Promise<IDocument | undefined> {
+    try {
+      const manifestKey = `documentManifest/${path}/${name}`;
+      const baseManifest = await CacheService.getInstance().retrieveValue<string>(manifestKey);
+      const result = await FileOpenPicker?.uploadPDFFileDelta(
+        requestId,
+        `${API_BASE_URL}/${this.baseRoute}/delta`,
+        token?.value ?? '',
+        name,
+        path,
+        typeof baseManifest === 'string' ? baseManifest : '',
+      );
+      if (!result || typeof result === 'string') {
+        return undefined;
+      }
+      await CacheService.getInstance().storeValue(manifestKey, result.manifest);
+      return JSON.parse(result.body) as IDocument;
+    } catch (error) {
+      throw error;
+    }
+  }
+
   /**
    * Uploads an image to a specified path using base64-encoded data.
    * @param file - An `IFile` object containing base64 image data and the filename.
@@ -1,4 +1,5 @@
 import { Platform } from 'react-native';
+import FileSavePicker, { FileSavePickerCell, FileSavePickerFormat, IFileExportResult } from '../modules/FileSavePicker';
 import PlatformName from '../model/enums/PlatformName';
 import { IFormCell } from '../model/IForm';
 import Utils from './Utils';
@@ -61,6 +62,41 @@ class DataUtils {
     return csv;
   }
 
+  /**
+   * Streams a table to a file the user picks, serialized natively batch by batch.
+   * @param suggestedName - The file name offered in the save dialog, without extension.
+   * @param format - 'csv' or 'xlsx'.
+   * @param header - The column titles, written as the first row.
+   * @param nextBatch - Returns the rows of the next batch, or null once there are none left.
+   * @returns The export result, or null if the dialog was dismissed or the module is unavailable.
+   */
+  static async exportTable(
+    suggestedName: string,
+    format: FileSavePickerFormat,
+    header: string[],
+    nextBatch: () => Promise<FileSavePickerCell[][] | null>,
+  ): Promise<IFileExportResult | null> {
+    if (!FileSavePicker) {
+      return null;
+    }
+    const requestId = Utils.generateUUID();
+    const opened = await FileSavePicker.beginExport(requestId, format, suggestedName, ',');
+    if (opened !== true) {
+      return null;
+    }
+    try {
+      await FileSavePicker.writeExportRows(requestId, [header]);
+      // Waiting on each batch keeps a single one in flight
+      for (let rows = await nextBatch(); rows; rows = await nextBatch()) {
+        await FileSavePicker.writeExportRows(requestId, rows);
+      }
+      return await FileSavePicker.finishExport(requestId);
+    } catch (error) {
+      await FileSavePicker.cancelExport(requestId).catch(() => false);
+      throw error;
+    }
+  }
+
   /**
    * Converts a CSV string to a grid.
    * @param value - The CSV string to convert.
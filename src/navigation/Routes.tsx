@@ -7,7 +7,7 @@ import React, { useEffect, useState } from 'react';
 import IArea from '../business-logic/model/IArea';
 import IDocument from '../business-logic/model/IDocument';
 import IFolder from '../business-logic/model/IFolder';
-import IForm from '../business-logic/model/IForm';
+import IForm, { IFormCell } from '../business-logic/model/IForm';
 import IPendingUser from '../business-logic/model/IPendingUser';
 import CacheKeys from '../business-logic/model/enums/CacheKeys';
 import NavigationRoutes from '../business-logic/model/enums/NavigationRoutes';
@@ -109,7 +109,11 @@ export type IRootStackParams = {
   SurveysScreen: undefined;
   // Forms
   FormsDocumentScreen: { documentPath: string; currentFolder: IFolder };
-  FormEditionScreen: { form?: IForm; documentPath: string };
+  FormEditionScreen: {
+    form?: IForm;
+    documentPath: string;
+    grid?: IFormCell[][];
+  };
   // Records
   RecordsDocumentScreen: {
     currentFolder: IFolder;
@@ -21,7 +21,9 @@ import MimeType from '../../../business-logic/model/enums/MimeType';
 import NavigationRoutes from '../../../business-logic/model/enums/NavigationRoutes';
 import PendingUserStatus from '../../../business-logic/model/enums/PendingUserStatus';
 import PlatformName from '../../../business-logic/model/enums/PlatformName';
-import FileOpenPicker from '../../../business-logic/modules/FileOpenPicker';
+import FileOpenPicker, {
+  LogoImageOptions,
+} from '../../../business-logic/modules/FileOpenPicker';
 import FinderModule from '../../../business-logic/modules/FinderModule';
 import ModuleService from '../../../business-logic/services/ModuleService';
 import PendingUserServicePost from '../../../business-logic/services/PendingUserService/PendingUserService.post';
@@ -187,7 +189,13 @@ function SignUpScreen(props: SignUpScreenProps): React.JSX.Element {
       }
       setLogoURI(filePath);
     } else if (Platform.OS === PlatformName.Windows) {
-      const data = await FileOpenPicker?.readImageFileData();
+      const data = await FileOpenPicker?.readResizedImageFileData(
+        Utils.generateUUID(),
+        LogoImageOptions.maxWidth,
+        LogoImageOptions.maxHeight,
+        LogoImageOptions.quality,
+        LogoImageOptions.format,
+      );
       if (data) {
         setLogoData(data);
       }
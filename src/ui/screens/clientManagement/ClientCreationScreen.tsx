@@ -18,7 +18,9 @@ import IUser from '../../../business-logic/model/IUser';
 import NavigationRoutes from '../../../business-logic/model/enums/NavigationRoutes';
 import PendingUserStatus from '../../../business-logic/model/enums/PendingUserStatus';
 import PlatformName from '../../../business-logic/model/enums/PlatformName';
-import FileOpenPicker from '../../../business-logic/modules/FileOpenPicker';
+import FileOpenPicker, {
+  LogoImageOptions,
+} from '../../../business-logic/modules/FileOpenPicker';
 import FinderModule from '../../../business-logic/modules/FinderModule';
 import DocumentServiceGet from '../../../business-logic/services/DocumentService/DocumentService.get';
 import DocumentServicePost from '../../../business-logic/services/DocumentService/DocumentService.post';
@@ -324,7 +326,13 @@ function ClientCreationScreen(
       }
       setLogoURI(filePath);
     } else if (Platform.OS === PlatformName.Windows) {
-      const data = await FileOpenPicker?.readImageFileData();
+      const data = await FileOpenPicker?.readResizedImageFileData(
+        Utils.generateUUID(),
+        LogoImageOptions.maxWidth,
+        LogoImageOptions.maxHeight,
+        LogoImageOptions.quality,
+        LogoImageOptions.format,
+      );
       if (data) {
         setLogoData(data);
       }
@@ -1,5 +1,5 @@
 import { NativeStackScreenProps } from '@react-navigation/native-stack';
-import React, { useEffect, useState } from 'react';
+import React, { useEffect, useRef, useState } from 'react';
 import { useTranslation } from 'react-i18next';
 import {
   ActivityIndicator,
@@ -42,7 +42,6 @@ import {
   setSMQScreenSource,
 } from '../../../../business-logic/store/slices/smqReducer';
 import { RootState } from '../../../../business-logic/store/store';
-import DataUtils from '../../../../business-logic/utils/DataUtils';
 import Utils from '../../../../business-logic/utils/Utils';
 
 import UploadingActivityIndicator from '../../../components/ActivityIndicator/UploadingActivityIndicator';
@@ -78,6 +77,8 @@ function DocumentsScreen(props: DocumentsScreenProps): React.JSX.Element {
   const [documents, setDocuments] = useState<IDocument[]>([]);
   const [documentName, setDocumentName] = useState<string>('');
   const [selectedDocument, setSelectedDocument] = useState<IDocument>();
+  // Pending native upload, cancelled if the user leaves the screen
+  const uploadRequestId = useRef<string | null>(null);
   // Toast
   const [showToast, setShowToast] = useState<boolean>(false);
   const [toastIsShowingError, setToastIsShowingError] =
@@ -252,16 +253,17 @@ function DocumentsScreen(props: DocumentsScreenProps): React.JSX.Element {
         const file = await FilePickerModule.pickSingleFile([MimeType.pdf]);
         originPath = file.uri;
       } else if (Platform.OS === PlatformName.Windows) {
-        const data = await FileOpenPicker?.readPDFFileData();
-        if (data) {
-          await DocumentScreenManager.getInstance().uploadViaBase64Data(
-            data,
+        // Picked and streamed to the API natively, without a base64 copy in JS
+        uploadRequestId.current = Utils.generateUUID();
+        try {
+          await DocumentScreenManager.getInstance().pickAndUploadWindowsFile(
+            uploadRequestId.current,
             fileName,
             documentDestinationPath,
             token,
           );
-        } else {
-          throw new Error('Error decoding data from Windows file library');
+        } finally {
+          uploadRequestId.current = null;
         }
       }
 
@@ -289,16 +291,11 @@ function DocumentsScreen(props: DocumentsScreenProps): React.JSX.Element {
 
   async function download(document: IDocument) {
     try {
-      const cachedData = await CacheService.getInstance().retrieveValue<string>(
+      const cachedData = await CacheService.getInstance().retrieveDocumentData(
         document.id as string,
       );
       if (cachedData === null || cachedData == undefined) {
-        let docData = await DocumentServiceGet.download(document.id, token);
-        docData = DataUtils.changeMimeType(docData, 'application/pdf');
-        await CacheService.getInstance().storeValue(
-          document.id as string,
-          docData,
-        );
+        await DocumentServiceGet.downloadToCache(document.id as string, token);
         DocumentScreenManager.getInstance().recordDocumentActivity(
           DocumentLogAction.Loaded,
           currentUser,
@@ -427,6 +424,14 @@ function DocumentsScreen(props: DocumentsScreenProps): React.JSX.Element {
     return () => {};
   }, []);
 
+  useEffect(() => {
+    return () => {
+      if (uploadRequestId.current) {
+        FileOpenPicker?.cancel(uploadRequestId.current);
+      }
+    };
+  }, []);
+
   // Components
   function ToastContent() {
     return (
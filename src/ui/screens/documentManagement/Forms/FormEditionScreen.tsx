@@ -35,7 +35,7 @@ type FormEditionScreenProps = NativeStackScreenProps<
 
 function FormEditionScreen(props: FormEditionScreenProps): React.JSX.Element {
   const { navigation } = props;
-  const { form, documentPath } = props.route.params;
+  const { form, documentPath, grid: importedGrid } = props.route.params;
   const { t, i18n } = useTranslation();
   const { token } = useAppSelector((state: RootState) => state.tokens);
   const { currentUser, currentClient } = useAppSelector(
@@ -282,7 +282,7 @@ function FormEditionScreen(props: FormEditionScreenProps): React.JSX.Element {
   }
 
   async function loadGrid() {
-    await FormEditionManager.getInstance().loadGrid(form);
+    await FormEditionManager.getInstance().loadGrid(form, importedGrid);
     const grid = FormEditionManager.getInstance().getGrid();
     setGrid(grid);
   }
@@ -12,7 +12,7 @@ import FormManager, {
   IResult,
 } from '../../../../business-logic/manager/FormManager';
 import IAction from '../../../../business-logic/model/IAction';
-import IForm from '../../../../business-logic/model/IForm';
+import IForm, { IFormCell } from '../../../../business-logic/model/IForm';
 import DocumentLogAction from '../../../../business-logic/model/enums/DocumentLogAction';
 import MimeType from '../../../../business-logic/model/enums/MimeType';
 import PlatformName from '../../../../business-logic/model/enums/PlatformName';
@@ -176,12 +176,13 @@ function FormsDocumentScreen(
     setShowDialog(true);
   }
 
-  function openForm(form: IForm) {
+  function openForm(form: IForm, grid?: IFormCell[][]) {
     setShowDialog(false);
     setShowRemoveConfirmationDialog(false);
     navigation.navigate(NavigationRoutes.FormEditionScreen, {
       form,
       documentPath,
+      grid,
     });
   }
 
@@ -308,6 +309,7 @@ function FormsDocumentScreen(
 
   async function pickAFile() {
     let data: string = '';
+    let grid: IFormCell[][] | undefined;
     if (Platform.OS === PlatformName.Mac) {
       data = await FinderModule.getInstance().pickCSV();
       data = Utils.replaceAllOccurrences(data, ';', ',');
@@ -315,9 +317,12 @@ function FormsDocumentScreen(
       const filePath = await FilePickerModule.pickSingleFile([MimeType.csv]);
       data = (await DataUtils.getCSVFromFile(filePath)) as string;
     } else if (Platform.OS === PlatformName.Windows) {
-      const filePath = await FileOpenPicker?.pickCSVFile();
-      if (filePath) {
-        data = (await DataUtils.getCSVFromFile(filePath)) as string;
+      // Parsed natively, straight into grid cells
+      const result = await FileOpenPicker?.readCSVFileGrid(
+        Utils.generateUUID(),
+      );
+      if (Array.isArray(result)) {
+        grid = result;
       }
     }
     const form: IForm = {
@@ -328,7 +333,7 @@ function FormsDocumentScreen(
       approvedByClient: false,
       clientID: currentClient?.id as string as string,
     };
-    openForm(form);
+    openForm(form, grid);
     return data;
   }
 
@@ -12,7 +12,9 @@ import {
 } from 'react-native';
 
 import DocumentRowManager from '../../../../business-logic/manager/documentManagement/DocumentRowManager';
-import RecordsDocumentScreenManager from '../../../../business-logic/manager/documentManagement/RecordsDocumentScreenManager';
+import RecordsDocumentScreenManager, {
+  IFileUploadFailure,
+} from '../../../../business-logic/manager/documentManagement/RecordsDocumentScreenManager';
 import DocumentLogAction from '../../../../business-logic/model/enums/DocumentLogAction';
 import NavigationRoutes from '../../../../business-logic/model/enums/NavigationRoutes';
 import PlatformName from '../../../../business-logic/model/enums/PlatformName';
@@ -43,7 +45,6 @@ import {
   setSMQScreenSource,
 } from '../../../../business-logic/store/slices/smqReducer';
 import { RootState } from '../../../../business-logic/store/store';
-import DataUtils from '../../../../business-logic/utils/DataUtils';
 import Utils from '../../../../business-logic/utils/Utils';
 
 import { IRootStackParams } from '../../../../navigation/Routes';
@@ -267,16 +268,11 @@ function RecordsDocumentScreen(
 
   async function download(document: IDocument) {
     try {
-      const cachedData = await CacheService.getInstance().retrieveValue<string>(
+      const cachedData = await CacheService.getInstance().retrieveDocumentData(
         document.id as string,
       );
       if (cachedData === null || cachedData == undefined) {
-        let docData = await DocumentServiceGet.download(document.id, token);
-        docData = DataUtils.changeMimeType(docData, 'application/pdf');
-        await CacheService.getInstance().storeValue(
-          document.id as string,
-          docData,
-        );
+        await DocumentServiceGet.downloadToCache(document.id as string, token);
         const logInput: IDocumentActivityLogInput = {
           action: DocumentLogAction.Loaded,
           actorIsAdmin: true,
@@ -352,42 +348,60 @@ function RecordsDocumentScreen(
       // Pick file
       const fileName = `${documentName.replace(/\s/g, '_')}.pdf`;
       let originPath: string = '';
-      let fileData: string | undefined;
-      let createdDocument: IDocument | undefined;
-      if (Platform.OS === PlatformName.Windows) {
-        fileData =
-          await RecordsDocumentScreenManager.getInstance().pickWindowsFile();
-      } else {
+      let createdDocuments: IDocument[] = [];
+      let failures: IFileUploadFailure[] = [];
+      if (Platform.OS !== PlatformName.Windows) {
         originPath =
           await RecordsDocumentScreenManager.getInstance().pickFile();
       }
       setIsUploading(true);
       // Upload
       if (Platform.OS === PlatformName.Windows) {
-        createdDocument =
-          await RecordsDocumentScreenManager.getInstance().uploadFileDataToAPI(
-            fileData,
+        // Several records can be picked at once, each one is streamed natively
+        const upload =
+          await RecordsDocumentScreenManager.getInstance().pickAndUploadWindowsFiles(
             fileName,
             documentDestinationPath,
             token,
           );
+        createdDocuments = upload.documents;
+        failures = upload.failures;
       } else {
-        createdDocument =
+        createdDocuments = [
           await RecordsDocumentScreenManager.getInstance().uploadFileToAPI(
             fileName,
             originPath,
             documentDestinationPath,
             token,
-          );
+          ),
+        ];
       }
 
-      // Record log
-      if (createdDocument) {
-        await RecordsDocumentScreenManager.getInstance().recordLog(
-          currentUser,
-          currentClient,
-          createdDocument,
-          token,
+      // Record log, a failed log entry does not skip the others
+      const logs = await Promise.allSettled(
+        createdDocuments.map(createdDocument =>
+          RecordsDocumentScreenManager.getInstance().recordLog(
+            currentUser,
+            currentClient,
+            createdDocument,
+            token,
+          ),
+        ),
+      );
+      for (const log of logs) {
+        if (log.status === 'rejected') {
+          console.log('Error recording log:', log.reason);
+        }
+      }
+      if (failures.length !== 0) {
+        for (const failure of failures) {
+          console.log('Error uploading file:', failure.fileName, failure.error);
+        }
+        displayToast(
+          t('documentsScreen.uploadFailed', {
+            files: failures.map(failure => failure.fileName).join(', '),
+          }),
+          true,
         );
       }
 
@@ -8,12 +8,14 @@ import { IRootStackParams } from '../../../navigation/Routes';
 import IAction from '../../../business-logic/model/IAction';
 import IDocumentActivityLog from '../../../business-logic/model/IDocumentActivityLog';
 import NavigationRoutes from '../../../business-logic/model/enums/NavigationRoutes';
+import FileSavePicker from '../../../business-logic/modules/FileSavePicker';
 import DocumentActivityLogsService from '../../../business-logic/services/DocumentActivityLogsService';
 import { useAppSelector } from '../../../business-logic/store/hooks';
 import { RootState } from '../../../business-logic/store/store';
 import Utils from '../../../business-logic/utils/Utils';
 
 import AppContainer from '../../components/AppContainer/AppContainer';
+import IconButton from '../../components/Buttons/IconButton';
 import ContentUnavailableView from '../../components/ContentUnavailableView';
 import Grid from '../../components/Grid/Grid';
 import Pagination from '../../components/Pagination';
@@ -34,6 +36,7 @@ function TrackingScreen(props: TrackingScreenProps): React.JSX.Element {
   const [toastMessage, setToastMessage] = useState<string>('');
   const [toastIsShowingError, setToastIsShowingError] = useState<boolean>(false);
   const [logs, setLogs] = useState<IDocumentActivityLog[]>([]);
+  const [isExporting, setIsExporting] = useState<boolean>(false);
 
   const numberOfLogsPerPage = 8;
   
@@ -44,6 +47,7 @@ function TrackingScreen(props: TrackingScreenProps): React.JSX.Element {
   const { token } = useAppSelector((state: RootState) => state.tokens);
 
   const clipboardIcon = require('../../assets/images/list.clipboard.png');
+  const exportIcon = require('../../assets/images/arrow.up.right.png');
 
   
   const logsFiltered = logs.filter(log =>
@@ -81,6 +85,24 @@ function TrackingScreen(props: TrackingScreenProps): React.JSX.Element {
     }
   }
 
+  // Writes every log of the client, not only the current page, to a CSV the user picks
+  async function exportLogs() {
+    if (isExporting) {
+      return;
+    }
+    setIsExporting(true);
+    try {
+      const result = await DocumentActivityLogsService.getInstance().exportLogsForClient(currentClient?.id, token, 'csv');
+      if (result) {
+        displayToast(t('tracking.export.success', { fileName: result.fileName }));
+      }
+    } catch (error) {
+      const errorMessage = (error as Error).message;
+      displayToast(t(`errors.api.${errorMessage}`), true);
+    }
+    setIsExporting(false);
+  }
+
   // Lifecycle Methods
   useEffect(() => {
     async function init() {
@@ -114,6 +136,23 @@ function TrackingScreen(props: TrackingScreenProps): React.JSX.Element {
     )
   }
 
+  // The streaming export is a Windows native module, other platforms have no button
+  function ExportButton() {
+    return (
+      <>
+        {
+          FileSavePicker && (
+            <IconButton
+              title={isExporting ? t('tracking.export.inProgress') : t('tracking.export.button')}
+              icon={exportIcon}
+              onPress={exportLogs}
+            />
+          )
+        }
+      </>
+    )
+  }
+
   function LogGridItem(item: IDocumentActivityLog) {
     const actorName = item.actorIsAdmin ? 'MD Consulting' : item.actorUsername;
     const itemDate = new Date(item.actionDate)
@@ -179,6 +218,7 @@ function TrackingScreen(props: TrackingScreenProps): React.JSX.Element {
             onPageChange={(page: number) => setCurrentPage(page)}
           />
         }
+        adminButton={ExportButton()}
       >
         <>
           {
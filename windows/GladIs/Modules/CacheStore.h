@@ -0,0 +1,199 @@
+#pragma once
+
+#include "pch.h"
+#include <winrt/Windows.Storage.h>
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Microsoft.ReactNative.h>
+#include "FileIngest/IoExecutor.h"
+#include "FileIngest/KeyValueStore.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CacheStoreModule
+{
+  // Backs CacheService on Windows with FileIngest::KeyValueStore. Values cross the bridge as the
+  // JSON strings CacheService already writes and are stored as their UTF-8 bytes. Every call runs
+  // on a worker, so a commit or a compaction never blocks the JS thread.
+  REACT_MODULE(CacheStore);
+  struct CacheStore final
+  {
+    REACT_METHOD(Get, L"get");
+    void Get(std::string key, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        GetAsync(std::move(key), promise);
+    }
+
+    REACT_METHOD(Set, L"set");
+    void Set(std::string key, std::string value, int64_t ttlMs, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        std::vector<Entry> entries;
+        entries.push_back({ std::move(key), std::move(value), ttlMs });
+        WriteAsync(std::move(entries), promise);
+    }
+
+    // [{ key, value, ttlMs }], written in order with a single commit
+    REACT_METHOD(SetMany, L"setMany");
+    void SetMany(winrt::Microsoft::ReactNative::JSValueArray entries, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        std::vector<Entry> parsed;
+        parsed.reserve(entries.size());
+        for (auto const& entry : entries) {
+            parsed.push_back({ entry["key"].AsString(), entry["value"].AsString(), entry["ttlMs"].AsInt64() });
+        }
+        WriteAsync(std::move(parsed), promise);
+    }
+
+    REACT_METHOD(Remove, L"remove");
+    void Remove(std::string key, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        std::vector<Entry> entries;
+        entries.push_back({ std::move(key), {}, 0, true });
+        WriteAsync(std::move(entries), promise);
+    }
+
+    REACT_METHOD(Clear, L"clear");
+    void Clear(winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        RunAsync([](FileIngest::KeyValueStore& store) { store.Clear(); }, "Error clearing cache", promise);
+    }
+
+    REACT_METHOD(Compact, L"compact");
+    void Compact(winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        RunAsync([](FileIngest::KeyValueStore& store) { store.Compact(); }, "Error compacting cache", promise);
+    }
+
+    // The index is only trusted after a clean close, which the module does when it is destroyed;
+    // after a crash it is rebuilt from the log. Flushing earlier keeps the next launch fast.
+    REACT_METHOD(Flush, L"flush");
+    void Flush(winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        RunAsync([](FileIngest::KeyValueStore& store) { store.Flush(); }, "Error flushing cache", promise);
+    }
+
+    REACT_METHOD(GetStats, L"getStats");
+    void GetStats(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        GetStatsAsync(promise);
+    }
+
+  private:
+    // Two workers so a read never waits behind a commit, and writes queued during a commit
+    // share the next one
+    static constexpr size_t kWorkerCount = 2;
+    static constexpr size_t kMaxPendingCalls = 256;
+    // Cached documents live in the content store; this holds tokens, ids and small JSON values
+    static constexpr uint64_t kMaxLiveBytes = 32ull * 1024 * 1024;
+
+    struct Entry
+    {
+        std::string key;
+        std::string value;
+        int64_t ttlMs = 0;
+        bool remove = false;
+    };
+
+    // Declared first so the workers are joined before the store is closed
+    std::once_flag m_storeOnce;
+    std::unique_ptr<FileIngest::KeyValueStore> m_store;
+    FileIngest::IoExecutor m_executor{ kWorkerCount, kMaxPendingCalls };
+
+    // Opened on first use under LocalCacheFolder, next to the content store
+    FileIngest::KeyValueStore& Store() {
+        std::call_once(m_storeOnce, [this]() {
+            std::filesystem::path root(winrt::Windows::Storage::ApplicationData::Current().LocalCacheFolder().Path().c_str());
+            FileIngest::KeyValueOptions options;
+            options.maxLiveBytes = kMaxLiveBytes;
+            m_store = std::make_unique<FileIngest::KeyValueStore>(root / L"CacheStore", options);
+        });
+        return *m_store;
+    }
+
+    static std::string DescribeFailure(std::string_view fallback) noexcept {
+        std::string message(fallback);
+        try {
+            throw;
+        } catch (const winrt::hresult_error& e) {
+            message += ": " + winrt::to_string(e.message());
+        } catch (const std::exception& e) {
+            message += ": ";
+            message += e.what();
+        } catch (...) {
+        }
+        return message;
+    }
+
+    winrt::fire_and_forget GetAsync(std::string key, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            std::vector<uint8_t> value;
+            if (!Store().Get(key, value)) {
+                promise.Resolve(winrt::Microsoft::ReactNative::JSValue());
+                co_return;
+            }
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::string(value.begin(), value.end())));
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading cache").c_str());
+        }
+    }
+
+    winrt::fire_and_forget WriteAsync(std::vector<Entry> entries, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            std::vector<FileIngest::KeyValueWrite> writes;
+            writes.reserve(entries.size());
+            for (Entry const& entry : entries) {
+                auto value = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(entry.value.data()), entry.value.size());
+                writes.push_back({ entry.key, value, entry.ttlMs > 0 ? static_cast<uint64_t>(entry.ttlMs) : 0, entry.remove });
+            }
+            Store().Write(writes);
+            promise.Resolve(true);
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::KeyValueError& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error writing cache").c_str());
+        }
+    }
+
+    template <typename Operation>
+    winrt::fire_and_forget RunAsync(Operation operation, const char* failure, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            operation(Store());
+            promise.Resolve(true);
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure(failure).c_str());
+        }
+    }
+
+    winrt::fire_and_forget GetStatsAsync(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            FileIngest::KeyValueStats stats = Store().Stats();
+            winrt::Microsoft::ReactNative::JSValueObject result;
+            result["count"] = static_cast<int64_t>(stats.count);
+            result["liveBytes"] = static_cast<int64_t>(stats.liveBytes);
+            result["logBytes"] = static_cast<int64_t>(stats.logBytes);
+            result["gets"] = static_cast<int64_t>(stats.gets);
+            result["hits"] = static_cast<int64_t>(stats.hits);
+            result["expired"] = static_cast<int64_t>(stats.expired);
+            result["puts"] = static_cast<int64_t>(stats.puts);
+            result["removes"] = static_cast<int64_t>(stats.removes);
+            result["evictions"] = static_cast<int64_t>(stats.evictions);
+            result["commits"] = static_cast<int64_t>(stats.commits);
+            result["committedRecords"] = static_cast<int64_t>(stats.committedRecords);
+            result["compactions"] = static_cast<int64_t>(stats.compactions);
+            result["recoveredRecords"] = static_cast<int64_t>(stats.recoveredRecords);
+            result["truncatedBytes"] = static_cast<int64_t>(stats.truncatedBytes);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading cache stats").c_str());
+        }
+    }
+  };
+}
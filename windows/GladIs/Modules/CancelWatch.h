@@ -0,0 +1,47 @@
+#pragma once
+
+#include "pch.h"
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.System.Threading.h>
+#include "FileIngest/IoExecutor.h"
+#include <chrono>
+
+namespace ModuleSupport
+{
+  // Cancels a WinRT operation once its token is cancelled or past its deadline, for as long as
+  // the watch lives. Progress handlers only fire while bytes move, so a server that accepts a
+  // call and then stalls would never reach a check made there. Scope one around each co_await:
+  //
+  //   auto operation = client.SendRequestAsync(request);
+  //   {
+  //       CancelWatch watch(operation, cancellation);
+  //       response = co_await operation;
+  //   }
+  class CancelWatch
+  {
+  public:
+      // How soon a cancelled or expired operation is stopped
+      static constexpr std::chrono::milliseconds kPollInterval{ 250 };
+
+      template <typename Operation>
+      CancelWatch(Operation const& operation, FileIngest::CancellationToken cancellation)
+          : m_timer(winrt::Windows::System::Threading::ThreadPoolTimer::CreatePeriodicTimer(
+              [operation, cancellation](winrt::Windows::System::Threading::ThreadPoolTimer const& timer) {
+                  if (cancellation.IsCancelled()) {
+                      timer.Cancel();
+                      operation.Cancel();
+                  }
+              },
+              kPollInterval)) {}
+
+      ~CancelWatch() {
+          m_timer.Cancel();
+      }
+
+      CancelWatch(CancelWatch const&) = delete;
+      CancelWatch& operator=(CancelWatch const&) = delete;
+
+  private:
+      winrt::Windows::System::Threading::ThreadPoolTimer m_timer;
+  };
+}
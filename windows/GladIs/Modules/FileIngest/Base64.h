@@ -0,0 +1,352 @@
+#pragma once
+
+#include "CpuFeatures.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace FileIngest
+{
+  namespace Base64
+  {
+    inline constexpr char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    inline constexpr size_t kInvalid = static_cast<size_t>(-1);
+
+    enum class Kernel
+    {
+        Scalar,
+        Ssse3,
+        Avx2,
+    };
+
+    // Number of characters needed to encode `length` bytes, padding included
+    constexpr size_t EncodedLength(size_t length) noexcept {
+        return ((length + 2) / 3) * 4;
+    }
+
+    // Upper bound of the decoded size; the exact size depends on the padding
+    constexpr size_t MaxDecodedLength(size_t length) noexcept {
+        return (length / 4) * 3;
+    }
+
+    namespace detail
+    {
+      struct DecodeTable
+      {
+          int8_t values[256];
+
+          constexpr DecodeTable() : values() {
+              for (int i = 0; i < 256; i++) {
+                  values[i] = -1;
+              }
+              for (int i = 0; i < 64; i++) {
+                  values[static_cast<uint8_t>(kAlphabet[i])] = static_cast<int8_t>(i);
+              }
+          }
+      };
+
+      inline constexpr DecodeTable kDecodeTable{};
+
+      inline size_t EncodeScalar(const uint8_t* data, size_t length, char* out) noexcept {
+          char* cursor = out;
+          size_t i = 0;
+          for (; i + 3 <= length; i += 3) {
+              uint32_t triple = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+              *cursor++ = kAlphabet[(triple >> 18) & 0x3F];
+              *cursor++ = kAlphabet[(triple >> 12) & 0x3F];
+              *cursor++ = kAlphabet[(triple >> 6) & 0x3F];
+              *cursor++ = kAlphabet[triple & 0x3F];
+          }
+
+          size_t remaining = length - i;
+          if (remaining > 0) {
+              uint32_t triple = uint32_t(data[i]) << 16;
+              if (remaining == 2) {
+                  triple |= uint32_t(data[i + 1]) << 8;
+              }
+              *cursor++ = kAlphabet[(triple >> 18) & 0x3F];
+              *cursor++ = kAlphabet[(triple >> 12) & 0x3F];
+              *cursor++ = remaining == 2 ? kAlphabet[(triple >> 6) & 0x3F] : '=';
+              *cursor++ = '=';
+          }
+          return static_cast<size_t>(cursor - out);
+      }
+
+      // Decodes complete quads, padding only allowed in the last one. Returns kInvalid on bad input.
+      inline size_t DecodeScalar(const char* text, size_t length, uint8_t* out) noexcept {
+          if (length % 4 != 0) {
+              return kInvalid;
+          }
+
+          uint8_t* cursor = out;
+          for (size_t i = 0; i < length; i += 4) {
+              bool last = i + 4 == length;
+              size_t padding = 0;
+              if (last && text[i + 3] == '=') {
+                  padding = text[i + 2] == '=' ? 2 : 1;
+              }
+
+              uint32_t quad = 0;
+              for (size_t j = 0; j < 4 - padding; j++) {
+                  int8_t value = kDecodeTable.values[static_cast<uint8_t>(text[i + j])];
+                  if (value < 0) {
+                      return kInvalid;
+                  }
+                  quad |= uint32_t(value) << (18 - 6 * j);
+              }
+
+              *cursor++ = static_cast<uint8_t>(quad >> 16);
+              if (padding < 2) {
+                  *cursor++ = static_cast<uint8_t>(quad >> 8);
+              }
+              if (padding < 1) {
+                  *cursor++ = static_cast<uint8_t>(quad);
+              }
+          }
+          return static_cast<size_t>(cursor - out);
+      }
+
+#if defined(FILEINGEST_X86)
+      // Vector kernels after W. Muła and D. Lemire, "Faster Base64 Encoding and Decoding Using AVX2 Instructions".
+      // They only process whole blocks and return how much input they consumed; the scalar code finishes the tail.
+
+      FILEINGEST_TARGET("ssse3")
+      inline __m128i EncodeBlockSsse3(__m128i input) noexcept {
+          // Spread 12 bytes into 16 lanes of 6-bit indices
+          input = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+          const __m128i t0 = _mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00));
+          const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+          const __m128i t2 = _mm_and_si128(input, _mm_set1_epi32(0x003f03f0));
+          const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+          const __m128i indices = _mm_or_si128(t1, t3);
+
+          // Map indices to ASCII by adding a per-range offset
+          __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+          const __m128i isUpper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+          range = _mm_or_si128(range, _mm_and_si128(isUpper, _mm_set1_epi8(13)));
+          const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+          return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+      }
+
+      FILEINGEST_TARGET("ssse3")
+      inline size_t EncodeSsse3(const uint8_t* data, size_t length, char* out) noexcept {
+          size_t i = 0;
+          // Each load reads 16 bytes but only consumes 12
+          for (; i + 16 <= length; i += 12) {
+              __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+              _mm_storeu_si128(reinterpret_cast<__m128i*>(out), EncodeBlockSsse3(input));
+              out += 16;
+          }
+          return i;
+      }
+
+      FILEINGEST_TARGET("avx2")
+      inline size_t EncodeAvx2(const uint8_t* data, size_t length, char* out) noexcept {
+          const __m256i spread = _mm256_setr_epi8(
+              1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+              1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+          const __m256i offsets = _mm256_setr_epi8(
+              'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+              'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+          size_t i = 0;
+          // Two 12-byte groups per iteration, one per 128-bit lane
+          for (; i + 28 <= length; i += 24) {
+              __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+              __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12));
+              __m256i input = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+
+              input = _mm256_shuffle_epi8(input, spread);
+              const __m256i t0 = _mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00));
+              const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+              const __m256i t2 = _mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0));
+              const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+              const __m256i indices = _mm256_or_si256(t1, t3);
+
+              __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+              const __m256i isUpper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+              range = _mm256_or_si256(range, _mm256_and_si256(isUpper, _mm256_set1_epi8(13)));
+              __m256i encoded = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+
+              _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), encoded);
+              out += 32;
+          }
+          return i;
+      }
+
+      // Translates 16 ASCII chars to 6-bit values, returning false if any char is outside the alphabet
+      FILEINGEST_TARGET("ssse3")
+      inline bool TranslateSsse3(__m128i& text) noexcept {
+          const __m128i lowLut = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+          const __m128i highLut = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+          const __m128i rollLut = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+          const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+
+          const __m128i highNibble = _mm_and_si128(_mm_srli_epi32(text, 4), nibbleMask);
+          const __m128i lowNibble = _mm_and_si128(text, nibbleMask);
+          const __m128i low = _mm_shuffle_epi8(lowLut, lowNibble);
+          const __m128i high = _mm_shuffle_epi8(highLut, highNibble);
+          if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(low, high), _mm_setzero_si128())) != 0) {
+              return false;
+          }
+
+          const __m128i isSlash = _mm_cmpeq_epi8(text, _mm_set1_epi8('/'));
+          const __m128i roll = _mm_shuffle_epi8(rollLut, _mm_add_epi8(isSlash, highNibble));
+          text = _mm_add_epi8(text, roll);
+          return true;
+      }
+
+      FILEINGEST_TARGET("ssse3")
+      inline __m128i PackSsse3(__m128i values) noexcept {
+          const __m128i mergedPairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+          const __m128i merged = _mm_madd_epi16(mergedPairs, _mm_set1_epi32(0x00011000));
+          return _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+      }
+
+      // Stops 8 chars early so the padded final quad is always left to the scalar code,
+      // which also gives the 4 bytes of slack the 16-byte store needs.
+      FILEINGEST_TARGET("ssse3")
+      inline size_t DecodeSsse3(const char* text, size_t length, uint8_t* out, size_t& written) noexcept {
+          size_t i = 0;
+          written = 0;
+          for (; i + 24 <= length; i += 16) {
+              __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+              if (!TranslateSsse3(block)) {
+                  break;
+              }
+              _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), PackSsse3(block));
+              written += 12;
+          }
+          return i;
+      }
+
+      FILEINGEST_TARGET("avx2")
+      inline size_t DecodeAvx2(const char* text, size_t length, uint8_t* out, size_t& written) noexcept {
+          const __m256i lowLut = _mm256_setr_epi8(
+              0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+              0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+          const __m256i highLut = _mm256_setr_epi8(
+              0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+              0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+          const __m256i rollLut = _mm256_setr_epi8(
+              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+          const __m256i pack = _mm256_setr_epi8(
+              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+          const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+
+          size_t i = 0;
+          written = 0;
+          // 32 chars in, 24 bytes out through a 32-byte store: keep 16 chars of slack
+          for (; i + 48 <= length; i += 32) {
+              __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+
+              const __m256i highNibble = _mm256_and_si256(_mm256_srli_epi32(block, 4), nibbleMask);
+              const __m256i lowNibble = _mm256_and_si256(block, nibbleMask);
+              const __m256i low = _mm256_shuffle_epi8(lowLut, lowNibble);
+              const __m256i high = _mm256_shuffle_epi8(highLut, highNibble);
+              if (!_mm256_testz_si256(low, high)) {
+                  break;
+              }
+
+              const __m256i isSlash = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('/'));
+              block = _mm256_add_epi8(block, _mm256_shuffle_epi8(rollLut, _mm256_add_epi8(isSlash, highNibble)));
+
+              const __m256i mergedPairs = _mm256_maddubs_epi16(block, _mm256_set1_epi32(0x01400140));
+              __m256i merged = _mm256_madd_epi16(mergedPairs, _mm256_set1_epi32(0x00011000));
+              merged = _mm256_shuffle_epi8(merged, pack);
+              merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+
+              _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + written), merged);
+              written += 24;
+          }
+
+          size_t tailWritten = 0;
+          size_t tailConsumed = DecodeSsse3(text + i, length - i, out + written, tailWritten);
+          written += tailWritten;
+          return i + tailConsumed;
+      }
+#endif
+
+      inline Kernel SelectKernel() noexcept {
+          const CpuFeatures& cpu = DetectCpuFeatures();
+          if (cpu.avx2) {
+              return Kernel::Avx2;
+          }
+          if (cpu.ssse3) {
+              return Kernel::Ssse3;
+          }
+          return Kernel::Scalar;
+      }
+    }
+
+    // Best kernel for this machine, resolved once
+    inline Kernel ActiveKernel() noexcept {
+        static const Kernel kernel = detail::SelectKernel();
+        return kernel;
+    }
+
+    // Encodes `length` bytes into `out`, which must hold EncodedLength(length) chars.
+    // Returns the number of characters written.
+    inline size_t Encode(const uint8_t* data, size_t length, char* out, Kernel kernel = ActiveKernel()) noexcept {
+        size_t consumed = 0;
+#if defined(FILEINGEST_X86)
+        if (kernel == Kernel::Avx2) {
+            consumed = detail::EncodeAvx2(data, length, out);
+        }
+        if (kernel != Kernel::Scalar) {
+            consumed += detail::EncodeSsse3(data + consumed, length - consumed, out + consumed / 3 * 4);
+        }
+#else
+        (void)kernel;
+#endif
+        size_t written = consumed / 3 * 4;
+        return written + detail::EncodeScalar(data + consumed, length - consumed, out + written);
+    }
+
+    // Encodes into `out`, reusing its capacity
+    inline void EncodeTo(const uint8_t* data, size_t length, std::string& out) {
+        out.resize(EncodedLength(length));
+        Encode(data, length, out.data());
+    }
+
+    inline std::string Encode(const uint8_t* data, size_t length) {
+        std::string out;
+        EncodeTo(data, length, out);
+        return out;
+    }
+
+    // Decodes padded base64 into `out`, which must hold MaxDecodedLength(length) bytes.
+    // Returns the number of bytes written, or kInvalid if the input is malformed.
+    inline size_t Decode(const char* text, size_t length, uint8_t* out, Kernel kernel = ActiveKernel()) noexcept {
+        size_t consumed = 0;
+        size_t written = 0;
+#if defined(FILEINGEST_X86)
+        if (kernel == Kernel::Avx2) {
+            consumed = detail::DecodeAvx2(text, length, out, written);
+        } else if (kernel == Kernel::Ssse3) {
+            consumed = detail::DecodeSsse3(text, length, out, written);
+        }
+#else
+        (void)kernel;
+#endif
+        size_t tail = detail::DecodeScalar(text + consumed, length - consumed, out + written);
+        return tail == kInvalid ? kInvalid : written + tail;
+    }
+
+    // Decodes into `out`, returning false if the input is malformed
+    inline bool DecodeTo(const char* text, size_t length, std::vector<uint8_t>& out) {
+        out.resize(MaxDecodedLength(length));
+        size_t written = Decode(text, length, out.data());
+        if (written == kInvalid) {
+            out.clear();
+            return false;
+        }
+        out.resize(written);
+        return true;
+    }
+  }
+}
@@ -0,0 +1,166 @@
+// Correctness of every base64 kernel this machine can run: encodes random buffers of every length
+// from 0 to 2000 bytes, compares the text with a bit-by-bit reference encoder, decodes it back
+// through every kernel and checks that corrupted input (a bad character anywhere, padding in the
+// wrong place, a truncated length) is rejected. Exits non-zero when a check fails:
+//
+//   g++ -std=c++20 -O2 -I.. Base64Check.cpp -o base64-check
+//   ./base64-check [max length]
+
+#include "Base64.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  using FileIngest::Base64::Kernel;
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what, const char* kernel, size_t length) {
+      if (!condition) {
+          // Only the first few are printed, a broken kernel would otherwise flood the log
+          if (failures < 20) {
+              std::printf("FAILED: %s (%s, %zu bytes)\n", what, kernel, length);
+          }
+          failures++;
+      }
+  }
+
+  const char* KernelName(Kernel kernel) {
+      switch (kernel) {
+      case Kernel::Avx2: return "avx2";
+      case Kernel::Ssse3: return "ssse3";
+      default: return "scalar";
+      }
+  }
+
+  // RFC 4648 read literally, six bits at a time, so it shares nothing with the kernels under test
+  std::string ReferenceEncode(std::vector<uint8_t> const& data) {
+      std::string text;
+      uint32_t bits = 0;
+      int pending = 0;
+      for (uint8_t byte : data) {
+          bits = (bits << 8) | byte;
+          pending += 8;
+          while (pending >= 6) {
+              pending -= 6;
+              text.push_back(FileIngest::Base64::kAlphabet[(bits >> pending) & 0x3F]);
+          }
+      }
+      if (pending > 0) {
+          text.push_back(FileIngest::Base64::kAlphabet[(bits << (6 - pending)) & 0x3F]);
+      }
+      while (text.size() % 4 != 0) {
+          text.push_back('=');
+      }
+      return text;
+  }
+
+  size_t Decode(std::string const& text, std::vector<uint8_t>& out, Kernel kernel) {
+      out.assign(FileIngest::Base64::MaxDecodedLength(text.size()) + 1, 0);
+      return FileIngest::Base64::Decode(text.data(), text.size(), out.data(), kernel);
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t maxLength = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+
+  std::vector<Kernel> kernels = { Kernel::Scalar };
+  const FileIngest::CpuFeatures& cpu = FileIngest::DetectCpuFeatures();
+  if (cpu.ssse3) {
+      kernels.push_back(Kernel::Ssse3);
+  }
+  if (cpu.avx2) {
+      kernels.push_back(Kernel::Avx2);
+  }
+  std::printf("kernels:");
+  for (Kernel kernel : kernels) {
+      std::printf(" %s", KernelName(kernel));
+  }
+  std::printf("\n");
+
+  // Characters outside the alphabet, including the ones next to its ranges and a high byte
+  const char invalid[] = { '*', '-', '_', '@', '[', '`', '{', '.', ' ', '\n', '\0', '\x80', '\xff' };
+  std::mt19937 random(20240601);
+  std::vector<uint8_t> data;
+  std::vector<uint8_t> decoded;
+  uint64_t checkedLengths = 0;
+  for (size_t length = 0; length <= maxLength; length++) {
+      data.resize(length);
+      for (uint8_t& byte : data) {
+          byte = static_cast<uint8_t>(random());
+      }
+      std::string expected = ReferenceEncode(data);
+
+      for (Kernel kernel : kernels) {
+          const char* name = KernelName(kernel);
+          std::string text(FileIngest::Base64::EncodedLength(length) + 1, '#');
+          size_t written = FileIngest::Base64::Encode(data.data(), length, text.data(), kernel);
+          Check(written == expected.size(), "the encoded length matches the reference", name, length);
+          Check(text.compare(0, expected.size(), expected) == 0, "the encoded text matches the reference", name, length);
+          Check(text.back() == '#', "nothing is written past the encoded length", name, length);
+
+          size_t read = Decode(expected, decoded, kernel);
+          Check(read == length, "the decoded length is the input length", name, length);
+          Check(read == length && std::equal(data.begin(), data.end(), decoded.begin()), "the text decodes back to the input", name, length);
+          Check(decoded[FileIngest::Base64::MaxDecodedLength(expected.size())] == 0, "nothing is decoded past the buffer", name, length);
+
+          if (expected.empty()) {
+              continue;
+          }
+
+          // One bad character somewhere: every position for short texts, which covers the whole
+          // first vector blocks and the scalar tail, and a few random ones beyond
+          std::vector<size_t> positions;
+          if (expected.size() <= 160) {
+              for (size_t i = 0; i < expected.size(); i++) {
+                  positions.push_back(i);
+              }
+          } else {
+              for (int i = 0; i < 16; i++) {
+                  positions.push_back(random() % expected.size());
+              }
+              positions.push_back(expected.size() - 1);
+          }
+          for (size_t position : positions) {
+              std::string corrupted = expected;
+              // Padding is the one place where '=' is valid, a bad character there stays bad
+              corrupted[position] = invalid[random() % sizeof(invalid)];
+              Check(Decode(corrupted, decoded, kernel) == FileIngest::Base64::kInvalid, "a character outside the alphabet is rejected", name, length);
+          }
+
+          // '=' before the last quad, or in the third place without the fourth
+          if (expected.size() > 4) {
+              std::string corrupted = expected;
+              corrupted[random() % (expected.size() - 4)] = '=';
+              Check(Decode(corrupted, decoded, kernel) == FileIngest::Base64::kInvalid, "padding before the last quad is rejected", name, length);
+          }
+          std::string misplaced = expected;
+          misplaced[misplaced.size() - 2] = '=';
+          misplaced[misplaced.size() - 1] = 'A';
+          Check(Decode(misplaced, decoded, kernel) == FileIngest::Base64::kInvalid, "padding followed by data is rejected", name, length);
+          Check(Decode("====", decoded, kernel) == FileIngest::Base64::kInvalid, "a quad of padding is rejected", name, length);
+
+          for (size_t cut = 1; cut < 4; cut++) {
+              std::string truncated = expected.substr(0, expected.size() - cut);
+              Check(Decode(truncated, decoded, kernel) == FileIngest::Base64::kInvalid, "a truncated text is rejected", name, length);
+          }
+      }
+      checkedLengths++;
+  }
+
+  std::printf("%-28s %8llu lengths x %zu kernels\n", "checked", static_cast<unsigned long long>(checkedLengths), kernels.size());
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,254 @@
+// Back-to-back whole-file reads from several screens at once, the load behind the memory spikes on
+// low-RAM machines. Every read reserves its raw and base64 bytes from a MemoryBudget, loads into a
+// pooled buffer and encodes it, like LoadFileAsync. The same load then runs with fresh
+// vectors and no budget for comparison. Exits non-zero when the budget is exceeded, admission
+// control misbehaves or a buffer leaks:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. BufferPoolBenchmark.cpp -o buffer-pool-benchmark
+//   ./buffer-pool-benchmark [reads] [budget megabytes]
+
+#include "Base64.h"
+#include "BufferPool.h"
+#include "MemoryBudget.h"
+#include "Pipeline.h"
+#include "Task.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  struct Detached
+  {
+      struct promise_type
+      {
+          Detached get_return_object() const noexcept {
+              return {};
+          }
+          std::suspend_never initial_suspend() const noexcept {
+              return {};
+          }
+          std::suspend_never final_suspend() const noexcept {
+              return {};
+          }
+          void return_void() const noexcept {}
+          void unhandled_exception() const noexcept {
+              std::terminate();
+          }
+      };
+  };
+
+  void Check(bool condition, const char* message) {
+      if (!condition) {
+          std::fprintf(stderr, "FAILED: %s\n", message);
+          std::exit(1);
+      }
+  }
+
+  // Peak resident set since the last ResetPeakRss(), from the kernel's high-water mark
+  void ResetPeakRss() {
+      std::ofstream("/proc/self/clear_refs") << "5";
+  }
+
+  uint64_t PeakRss() {
+      std::ifstream status("/proc/self/status");
+      std::string line;
+      while (std::getline(status, line)) {
+          if (line.rfind("VmHWM:", 0) == 0) {
+              return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+          }
+      }
+      return 0;
+  }
+
+  // Sizes of logos, scanned PDFs and CSV exports, mostly small with a tail of large files
+  std::vector<size_t> ReadSizes(size_t count) {
+      std::mt19937_64 engine(5);
+      std::vector<size_t> sizes(count);
+      for (size_t& size : sizes) {
+          uint64_t roll = engine() % 100;
+          size = roll < 60 ? 16 * 1024 + engine() % (512 * 1024) : roll < 90 ? 1024 * 1024 + engine() % (4 * 1024 * 1024) : 8 * 1024 * 1024 + engine() % (24 * 1024 * 1024);
+      }
+      return sizes;
+  }
+
+  // Reads started and not finished are capped like the module's kMaxPendingReads
+  struct Load
+  {
+      static constexpr size_t kMaxOutstanding = 32;
+
+      explicit Load(size_t readCount) : countdown(readCount) {}
+
+      FileIngest::BatchCountdown countdown;
+      std::mutex mutex;
+      std::condition_variable changed;
+      size_t outstanding = 0;
+      bool finished = false;
+      std::atomic<uint64_t> encodedBytes{ 0 };
+      std::atomic<uint64_t> failures{ 0 };
+
+      void Begin() {
+          std::unique_lock<std::mutex> lock(mutex);
+          changed.wait(lock, [this]() { return outstanding < kMaxOutstanding; });
+          outstanding++;
+      }
+
+      void Complete() {
+          bool last = countdown.Complete();
+          std::lock_guard<std::mutex> lock(mutex);
+          outstanding--;
+          finished = finished || last;
+          changed.notify_all();
+      }
+
+      void Wait() {
+          std::unique_lock<std::mutex> lock(mutex);
+          changed.wait(lock, [this]() { return finished; });
+      }
+  };
+
+  void FillAndEncode(uint8_t* data, size_t size, Load& load) {
+      for (size_t i = 0; i < size; i += 4096) {
+          data[i] = static_cast<uint8_t>(i >> 12);
+      }
+      std::string encoded;
+      FileIngest::Base64::EncodeTo(data, size, encoded);
+      load.encodedBytes += encoded.size();
+  }
+
+  // The buffer is taken as soon as the size is known and filled once the loads complete, so it
+  // is alive while the read waits for a worker, as in LoadFileAsync
+  Detached PooledRead(FileIngest::IoExecutor& executor, FileIngest::MemoryBudget& budget, FileIngest::BufferPool& pool, size_t size, Load& load) {
+      try {
+          auto reservation = co_await budget.Reserve(size + FileIngest::Base64::EncodedLength(size));
+          FileIngest::PooledBuffer buffer = pool.Acquire(size);
+          co_await executor.Schedule();
+          FillAndEncode(buffer.Data(), buffer.Size(), load);
+      } catch (...) {
+          load.failures++;
+      }
+      load.Complete();
+  }
+
+  Detached UnpooledRead(FileIngest::IoExecutor& executor, size_t size, Load& load) {
+      std::vector<uint8_t> buffer(size);
+      co_await executor.Schedule();
+      FillAndEncode(buffer.data(), buffer.size(), load);
+      load.Complete();
+  }
+
+  // Issues the reads from `screens` threads, as components mounting one after the other would
+  template <typename StartRead>
+  double RunLoad(std::vector<size_t> const& sizes, size_t screens, Load& load, StartRead&& startRead) {
+      auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (size_t screen = 0; screen < screens; screen++) {
+          threads.emplace_back([&, screen]() {
+              for (size_t i = screen; i < sizes.size(); i += screens) {
+                  load.Begin();
+                  startRead(sizes[i]);
+              }
+          });
+      }
+      for (auto& thread : threads) {
+          thread.join();
+      }
+      load.Wait();
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  Detached ExpectRefused(FileIngest::MemoryBudget& budget, uint64_t bytes, FileIngest::Admission admission, std::atomic<int>& refused, Load& load) {
+      try {
+          auto reservation = co_await budget.Reserve(bytes, admission);
+      } catch (const FileIngest::MemoryBudgetExceeded&) {
+          refused++;
+      }
+      load.Complete();
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t readCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+  uint64_t budgetBytes = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 128) * 1024 * 1024;
+  const size_t workers = 2;
+  const size_t screens = 4;
+  std::vector<size_t> sizes = ReadSizes(readCount);
+  uint64_t totalBytes = 0;
+  for (size_t size : sizes) {
+      totalBytes += size;
+  }
+
+  FileIngest::IoExecutor executor(workers, readCount * 2);
+  FileIngest::MemoryBudget budget(executor, budgetBytes);
+  FileIngest::BufferPool pool(64 * 1024, 128 * 1024 * 1024, 64 * 1024 * 1024);
+
+  // Admission control on its own, before the load. A reservation larger than the budget never
+  // fits; FailFast refuses while memory is taken; lowering the limit refuses queued waiters.
+  {
+      std::atomic<int> refused{ 0 };
+      Load checks(3);
+      for (int i = 0; i < 3; i++) {
+          checks.Begin();
+      }
+      auto held = budget.TryReserve(budgetBytes / 2);
+      ExpectRefused(budget, budgetBytes + 1, FileIngest::Admission::Wait, refused, checks);
+      ExpectRefused(budget, budgetBytes / 2 + 1, FileIngest::Admission::FailFast, refused, checks);
+      ExpectRefused(budget, budgetBytes / 2 + 1, FileIngest::Admission::Wait, refused, checks);
+      Check(budget.Stats().waiting == 1, "a reservation that does not fit yet waits");
+      budget.SetLimit(budgetBytes / 2);
+      checks.Wait();
+      Check(refused == 3, "oversized, fail-fast and no-longer-fitting reservations are refused");
+      budget.SetLimit(budgetBytes);
+      bool threw = false;
+      try {
+          budget.TryReserve(budgetBytes / 2 + 1);
+      } catch (const FileIngest::MemoryBudgetExceeded& e) {
+          threw = true;
+          std::printf("refusal message       %s\n", e.what());
+      }
+      Check(threw, "TryReserve refuses when the memory is taken");
+  }
+  Check(budget.Stats().bytesInUse == 0, "refused and released reservations give every byte back");
+
+  Load pooledLoad(readCount);
+  ResetPeakRss();
+  double pooledSeconds = RunLoad(sizes, screens, pooledLoad, [&](size_t size) {
+      PooledRead(executor, budget, pool, size, pooledLoad);
+  });
+  uint64_t pooledRss = PeakRss();
+
+  FileIngest::MemoryBudgetStats budgetStats = budget.Stats();
+  FileIngest::BufferPoolStats poolStats = pool.Stats();
+  Check(pooledLoad.failures == 0, "every read within the budget is admitted");
+  Check(budgetStats.peakBytesInUse <= budgetBytes, "reads never hold more than the budget");
+  Check(budgetStats.bytesInUse == 0 && poolStats.bytesInUse == 0, "every reservation and buffer is given back");
+  Check(poolStats.reuses > poolStats.allocations, "most reads reuse a pooled buffer");
+
+  Load unpooledLoad(readCount);
+  ResetPeakRss();
+  double unpooledSeconds = RunLoad(sizes, screens, unpooledLoad, [&](size_t size) {
+      UnpooledRead(executor, size, unpooledLoad);
+  });
+  uint64_t unpooledRss = PeakRss();
+  Check(pooledLoad.encodedBytes == unpooledLoad.encodedBytes, "both runs encode the same bytes");
+
+  std::printf("reads                 %zu, %.1f MiB, %zu screens, %zu workers\n", readCount, totalBytes / 1048576.0, screens, workers);
+  std::printf("budget                %.1f MiB, peak in use %.1f MiB, %llu admitted, %llu waited, %llu refused\n", budgetBytes / 1048576.0, budgetStats.peakBytesInUse / 1048576.0,
+      static_cast<unsigned long long>(budgetStats.admitted), static_cast<unsigned long long>(budgetStats.waited), static_cast<unsigned long long>(budgetStats.rejected));
+  std::printf("pool                  %llu allocations, %llu reuses, %llu discards, peak %.1f MiB in use, %.1f MiB idle\n", static_cast<unsigned long long>(poolStats.allocations),
+      static_cast<unsigned long long>(poolStats.reuses), static_cast<unsigned long long>(poolStats.discards), poolStats.peakBytesInUse / 1048576.0, poolStats.bytesRetained / 1048576.0);
+  std::printf("pooled with budget    %.0f ms, peak RSS %.1f MiB\n", pooledSeconds * 1e3, pooledRss / 1048576.0);
+  std::printf("fresh vectors         %.0f ms, peak RSS %.1f MiB, %zu allocations\n", unpooledSeconds * 1e3, unpooledRss / 1048576.0, readCount);
+  std::printf("ok\n");
+  return 0;
+}
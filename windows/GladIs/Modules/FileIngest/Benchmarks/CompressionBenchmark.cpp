@@ -0,0 +1,283 @@
+// Ratio and throughput of the upload compression stage for each kind of file the app uploads,
+// with the encoding ChooseContentCoding picks for it from the first 128 KiB. Every output is
+// checked to decode, byte for byte, by a local stand-in of the backend when a port is given;
+// upload_stand_in_server.py starts one and runs this program against it. Exits non-zero when a
+// file is coded the wrong way, compresses worse than expected or does not round-trip:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. CompressionBenchmark.cpp -o compression-benchmark
+//   ./compression-benchmark [megabytes per file]
+//   python3 upload_stand_in_server.py ./compression-benchmark [megabytes per file]
+
+#include "Compression.h"
+#include "Sha256.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  void Check(bool condition, const char* message) {
+      if (!condition) {
+          std::fprintf(stderr, "FAILED: %s\n", message);
+          std::exit(1);
+      }
+  }
+
+  struct Sample
+  {
+      const char* name;
+      const char* fileName;
+      std::string_view mimeType;
+      std::vector<uint8_t> bytes;
+      FileIngest::ContentCoding expected;
+      // Lowest acceptable ratio at the Fast level, 0 for data that cannot compress
+      double minRatio;
+  };
+
+  void Append(std::vector<uint8_t>& out, std::string_view text) {
+      out.insert(out.end(), text.begin(), text.end());
+  }
+
+  void AppendRandom(std::vector<uint8_t>& out, size_t length, std::mt19937_64& engine) {
+      for (size_t i = 0; i < length; i++) {
+          out.push_back(static_cast<uint8_t>(engine()));
+      }
+  }
+
+  std::string RandomWords(std::mt19937_64& engine, size_t count) {
+      static constexpr const char* kWords[] = { "audit", "procedure", "quality", "document", "revision", "approved", "pending", "supplier", "record", "training", "incident",
+          "corrective", "action", "review", "manager", "process", "control", "deviation", "calibration", "signature" };
+      std::string text;
+      for (size_t i = 0; i < count; i++) {
+          text += kWords[engine() % std::size(kWords)];
+          text += ' ';
+      }
+      return text;
+  }
+
+  // Form exports: ids, dates, user names and short free text, as the CSV screens produce
+  std::vector<uint8_t> CsvFile(size_t size, std::mt19937_64& engine) {
+      std::vector<uint8_t> out;
+      Append(out, "id;title;date;user;status;comment\r\n");
+      for (uint64_t row = 1; out.size() < size; row++) {
+          std::string line = std::to_string(row) + ";Form " + std::to_string(engine() % 400) + ";2024-" + std::to_string(1 + engine() % 12) + "-" + std::to_string(1 + engine() % 28) + ";user" +
+              std::to_string(engine() % 60) + "@example.com;" + (engine() % 3 == 0 ? "pending" : "approved") + ";" + RandomWords(engine, engine() % 8) + "\r\n";
+          Append(out, line);
+      }
+      out.resize(size);
+      return out;
+  }
+
+  // A generated report: text content streams left uncompressed, as many exporters write them
+  std::vector<uint8_t> TextPdfFile(size_t size, std::mt19937_64& engine) {
+      std::vector<uint8_t> out;
+      Append(out, "%PDF-1.7\n%\xE2\xE3\xCF\xD3\n");
+      for (int object = 4; out.size() < size; object++) {
+          std::string content;
+          for (int y = 760; y > 60; y -= 14) {
+              content += "BT /F1 10 Tf 56 " + std::to_string(y) + " Td (" + RandomWords(engine, 6 + engine() % 6) + ") Tj ET\n";
+          }
+          Append(out, std::to_string(object) + " 0 obj\n<< /Length " + std::to_string(content.size()) + " >>\nstream\n" + content + "endstream\nendobj\n");
+      }
+      out.resize(size);
+      return out;
+  }
+
+  // A scanned document: one DCT-coded page image per object, which deflate cannot shrink
+  std::vector<uint8_t> ScannedPdfFile(size_t size, std::mt19937_64& engine) {
+      std::vector<uint8_t> out;
+      Append(out, "%PDF-1.4\n");
+      for (int object = 4; out.size() < size; object++) {
+          size_t length = 400 * 1024 + engine() % (200 * 1024);
+          Append(out, std::to_string(object) + " 0 obj\n<< /Type /XObject /Subtype /Image /Width 2480 /Height 3508 /ColorSpace /DeviceGray /BitsPerComponent 8 /Filter /DCTDecode /Length " +
+              std::to_string(length) + " >>\nstream\n");
+          AppendRandom(out, length, engine);
+          Append(out, "\nendstream\nendobj\n");
+      }
+      out.resize(size);
+      return out;
+  }
+
+  std::vector<uint8_t> ImageFile(std::string_view magic, size_t size, std::mt19937_64& engine) {
+      std::vector<uint8_t> out;
+      Append(out, magic);
+      AppendRandom(out, size - out.size(), engine);
+      return out;
+  }
+
+  template <typename OnOutput>
+  void Compress(std::vector<uint8_t> const& bytes, FileIngest::Deflate::Level level, OnOutput&& onOutput) {
+      // Fed in the 64 KiB reads the upload stream makes
+      FileIngest::Deflate::GzipEncoder encoder(level);
+      for (size_t offset = 0; offset < bytes.size(); offset += 64 * 1024) {
+          encoder.Write(bytes.data() + offset, std::min<size_t>(64 * 1024, bytes.size() - offset), onOutput);
+      }
+      encoder.Finish(onOutput);
+  }
+
+  struct Measure
+  {
+      uint64_t outputBytes = 0;
+      double seconds = 0;
+  };
+
+  Measure Run(std::vector<uint8_t> const& bytes, FileIngest::Deflate::Level level) {
+      Measure measure;
+      auto start = std::chrono::steady_clock::now();
+      Compress(bytes, level, [&](const uint8_t*, size_t length) { measure.outputBytes += length; });
+      measure.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return measure;
+  }
+
+  void SendAll(int socket, const void* data, size_t length) {
+      auto bytes = static_cast<const char*>(data);
+      while (length > 0) {
+          ssize_t sent = send(socket, bytes, length, MSG_NOSIGNAL);
+          Check(sent > 0, "the stand-in server accepts the upload");
+          bytes += sent;
+          length -= static_cast<size_t>(sent);
+      }
+  }
+
+  void SendChunk(int socket, const void* data, size_t length) {
+      if (length == 0) {
+          return;
+      }
+      char size[20];
+      int sizeLength = std::snprintf(size, sizeof(size), "%zx\r\n", length);
+      SendAll(socket, size, static_cast<size_t>(sizeLength));
+      SendAll(socket, data, length);
+      SendAll(socket, "\r\n", 2);
+  }
+
+  void SendChunk(int socket, std::string_view text) {
+      SendChunk(socket, text.data(), text.size());
+  }
+
+  // Where the uploads claim the file was picked from and is filed to, echoed back by the stand-in
+  std::string PickedUri(Sample const& sample) {
+      return std::string("file:///C:/Users/Public/Documents/") + sample.fileName;
+  }
+
+  std::string DestinationPath(Sample const& sample) {
+      return "records/" + std::string(sample.name) + "/" + sample.fileName;
+  }
+
+  // Posts the file as the module does: multipart/form-data sent with chunked transfer encoding,
+  // the file part first, gzipped on the fly and labelled with Content-Encoding when `coding` asks
+  // for it and sent as is otherwise, then the uri, name and path fields of createFormData.
+  // Returns the response.
+  std::string Upload(uint16_t port, Sample const& sample, FileIngest::ContentCoding coding) {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      Check(fd >= 0, "a socket can be created");
+      sockaddr_in address{};
+      address.sin_family = AF_INET;
+      address.sin_port = htons(port);
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      Check(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0, "the stand-in server is listening");
+
+      const std::string boundary = "----FileIngestBoundary7MA4YWxkTrZu0gW";
+      std::string request = "POST /documents HTTP/1.1\r\nHost: 127.0.0.1:" + std::to_string(port) + "\r\nContent-Type: multipart/form-data; boundary=" + boundary +
+          "\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+      SendAll(fd, request.data(), request.size());
+      std::string partHeader = "--" + boundary + "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"" + sample.fileName + "\"\r\nContent-Type: " + std::string(sample.mimeType) + "\r\n";
+      if (coding == FileIngest::ContentCoding::Gzip) {
+          partHeader += "Content-Encoding: gzip\r\n";
+      }
+      SendChunk(fd, partHeader + "\r\n");
+      if (coding == FileIngest::ContentCoding::Gzip) {
+          Compress(sample.bytes, FileIngest::Deflate::Level::Fast, [&](const uint8_t* data, size_t length) { SendChunk(fd, data, length); });
+      } else {
+          SendChunk(fd, sample.bytes.data(), sample.bytes.size());
+      }
+      std::string fields;
+      for (auto const& [name, value] : { std::pair<const char*, std::string>{ "uri", PickedUri(sample) }, { "name", sample.fileName }, { "path", DestinationPath(sample) } }) {
+          fields += "\r\n--" + boundary + "\r\nContent-Disposition: form-data; name=\"" + name + "\"\r\nContent-Type: text/plain; charset=UTF-8\r\n\r\n" + value;
+      }
+      SendChunk(fd, fields + "\r\n--" + boundary + "--\r\n");
+      SendAll(fd, "0\r\n\r\n", 5);
+
+      std::string response;
+      char buffer[4096];
+      for (ssize_t received; (received = recv(fd, buffer, sizeof(buffer), 0)) > 0;) {
+          response.append(buffer, static_cast<size_t>(received));
+      }
+      close(fd);
+      return response;
+  }
+
+  // The stand-in answers with flat JSON, e.g. {"sha256": "...", "bytes": 123, "contentEncoding": "gzip"}
+  std::string JsonField(std::string const& response, std::string const& name) {
+      size_t key = response.find("\"" + name + "\": ");
+      if (key == std::string::npos) {
+          return {};
+      }
+      size_t start = key + name.size() + 4;
+      if (response[start] == '"') {
+          return response.substr(start + 1, response.find('"', start + 1) - start - 1);
+      }
+      return response.substr(start, response.find_first_of(",}", start) - start);
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+  uint16_t port = argc > 2 ? static_cast<uint16_t>(std::strtoul(argv[2], nullptr, 10)) : 0;
+  size_t size = std::max<size_t>(megabytes, 1) * 1024 * 1024;
+  std::mt19937_64 engine(14);
+
+  using FileIngest::ContentCoding;
+  std::vector<Sample> samples;
+  samples.push_back({ "csv", "forms.csv", "text/csv", CsvFile(size, engine), ContentCoding::Gzip, 3.0 });
+  samples.push_back({ "pdf-text", "report.pdf", "application/pdf", TextPdfFile(size, engine), ContentCoding::Gzip, 2.0 });
+  samples.push_back({ "pdf-scan", "scan.pdf", "application/pdf", ScannedPdfFile(size, engine), ContentCoding::Identity, 0 });
+  samples.push_back({ "jpeg", "logo.jpg", "image/jpeg", ImageFile("\xFF\xD8\xFF\xE0", size, engine), ContentCoding::Identity, 0 });
+  samples.push_back({ "png", "logo.png", "image/png", ImageFile("\x89PNG\r\n\x1A\n", size, engine), ContentCoding::Identity, 0 });
+
+  std::printf("%-9s %8s %8s %-9s %14s %14s\n", "type", "MiB", "sample", "auto", "fast", "default");
+  for (Sample const& sample : samples) {
+      size_t sampleLength = std::min(sample.bytes.size(), FileIngest::kCompressionSampleLength);
+      double sampleRatio = FileIngest::NeedsCompressionSample(FileIngest::CompressionMode::Auto, sample.mimeType) ? FileIngest::EstimateCompressionRatio(sample.bytes.data(), sampleLength) : 1.0;
+      ContentCoding coding = FileIngest::ChooseContentCoding(FileIngest::CompressionMode::Auto, sample.mimeType, sample.bytes.data(), sampleLength);
+      Measure fast = Run(sample.bytes, FileIngest::Deflate::Level::Fast);
+      Measure best = Run(sample.bytes, FileIngest::Deflate::Level::Default);
+      double fastRatio = static_cast<double>(sample.bytes.size()) / fast.outputBytes;
+      double bestRatio = static_cast<double>(sample.bytes.size()) / best.outputBytes;
+      double mib = sample.bytes.size() / 1048576.0;
+      std::printf("%-9s %8.1f %7.2fx %-9s %5.2fx %4.0f MB/s %5.2fx %4.0f MB/s\n", sample.name, mib, sampleRatio, std::string(FileIngest::ContentCodingName(coding)).c_str(), fastRatio,
+          sample.bytes.size() / 1e6 / fast.seconds, bestRatio, sample.bytes.size() / 1e6 / best.seconds);
+
+      Check(coding == sample.expected, "auto picks gzip for text and identity for compressed content");
+      Check(fastRatio >= sample.minRatio, "text compresses at least as well as expected");
+      // Stored blocks cap the growth of incompressible data at 5 bytes per 64 KiB plus the framing
+      Check(fast.outputBytes <= sample.bytes.size() + sample.bytes.size() / 65535 * 5 + 64, "incompressible data barely grows");
+      Check(best.outputBytes <= fast.outputBytes + fast.outputBytes / 100, "the default level is not worse than the fast one");
+
+      if (port != 0) {
+          std::string expected = FileIngest::ToHex(FileIngest::Sha256::Hash(sample.bytes.data(), sample.bytes.size()));
+          for (ContentCoding sent : { ContentCoding::Gzip, ContentCoding::Identity }) {
+              std::string response = Upload(port, sample, sent);
+              Check(response.rfind("HTTP/1.0 201", 0) == 0 || response.rfind("HTTP/1.1 201", 0) == 0, "the stand-in server accepts the upload");
+              Check(JsonField(response, "contentEncoding") == FileIngest::ContentCodingName(sent), "the server sees the Content-Encoding of the file part");
+              Check(JsonField(response, "sha256") == expected && JsonField(response, "bytes") == std::to_string(sample.bytes.size()), "the server decodes the file exactly");
+              Check(JsonField(response, "fileName") == sample.fileName && JsonField(response, "mimeType") == sample.mimeType, "the file part carries its filename and type");
+              Check(JsonField(response, "uri") == PickedUri(sample) && JsonField(response, "name") == sample.fileName && JsonField(response, "path") == DestinationPath(sample), "the uri, name and path fields arrive");
+          }
+      }
+  }
+  if (port != 0) {
+      std::printf("every form and file decoded by the stand-in server on port %u, gzip and plain\n", port);
+  }
+  std::printf("ok\n");
+  return 0;
+}
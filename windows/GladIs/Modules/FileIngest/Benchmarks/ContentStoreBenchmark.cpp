@@ -0,0 +1,216 @@
+// Insert and lookup rates of the content-addressed store over a 100k-entry index, then
+// concurrent stores, reads and evictions checked for torn blobs, a budget overshoot or files
+// left behind. The FileIngest headers are portable, so this builds and runs on Linux:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. ContentStoreBenchmark.cpp -o content-store-benchmark
+//   ./content-store-benchmark [directory] [entries]
+
+#include "ContentStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  using FileIngest::Sha256Digest;
+
+  std::vector<Sha256Digest> RandomDigests(size_t count, uint64_t seed) {
+      std::mt19937_64 engine(seed);
+      std::vector<Sha256Digest> digests(count);
+      for (Sha256Digest& digest : digests) {
+          for (size_t i = 0; i < digest.size(); i += 8) {
+              uint64_t value = engine();
+              std::memcpy(digest.data() + i, &value, 8);
+          }
+      }
+      return digests;
+  }
+
+  void Require(bool condition, const char* message) {
+      if (!condition) {
+          std::fprintf(stderr, "FAILED: %s\n", message);
+          std::abort();
+      }
+  }
+
+  // Content derived from its number, so a reader can tell which blob it got back
+  std::vector<uint8_t> Blob(size_t number, size_t size) {
+      std::vector<uint8_t> bytes(size);
+      std::mt19937_64 engine(number);
+      for (uint8_t& byte : bytes) {
+          byte = static_cast<uint8_t>(engine());
+      }
+      return bytes;
+  }
+
+  size_t BlobFiles(std::filesystem::path const& root) {
+      size_t count = 0;
+      for (auto const& entry : std::filesystem::recursive_directory_iterator(root / "blobs")) {
+          count += entry.is_regular_file();
+      }
+      return count;
+  }
+
+  template <typename Body>
+  void Measure(const char* name, size_t operations, Body&& body) {
+      auto start = std::chrono::steady_clock::now();
+      body();
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::printf("%-28s %10zu ops %9.3f ms %12.0f ops/s\n", name, operations, seconds * 1e3, operations / seconds);
+  }
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path directory = argc > 1 ? argv[1] : std::filesystem::temp_directory_path() / "content-store-benchmark";
+  size_t entries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  std::vector<Sha256Digest> present = RandomDigests(entries, 1);
+  std::vector<Sha256Digest> absent = RandomDigests(entries, 2);
+
+  {
+      FileIngest::ContentIndex index(directory / "index.bin");
+      Measure("index insert (growing)", entries, [&]() {
+          for (size_t i = 0; i < entries; i++) {
+              index.Insert(present[i], 4096);
+          }
+      });
+      Measure("index lookup (hit)", entries, [&]() {
+          size_t found = 0;
+          for (auto const& digest : present) {
+              found += index.Find(digest);
+          }
+          if (found != entries) {
+              std::abort();
+          }
+      });
+      Measure("index lookup (miss)", entries, [&]() {
+          size_t found = 0;
+          for (auto const& digest : absent) {
+              found += index.Find(digest);
+          }
+          if (found != 0) {
+              std::abort();
+          }
+      });
+      Measure("index touch", entries, [&]() {
+          for (auto const& digest : present) {
+              index.Touch(digest);
+          }
+      });
+      index.Flush();
+  }
+
+  Measure("index reopen + lookup", entries, [&]() {
+      FileIngest::ContentIndex index(directory / "index.bin");
+      size_t found = 0;
+      for (auto const& digest : present) {
+          found += index.Find(digest);
+      }
+      if (found != entries) {
+          std::abort();
+      }
+  });
+
+  // Whole-store rates include hashing and one file per blob, so use a smaller sample
+  size_t blobs = std::min<size_t>(entries, 10000);
+  std::vector<uint8_t> payload(4096);
+  std::filesystem::path storeRoot = directory / "store";
+  {
+      FileIngest::ContentStore store(storeRoot, uint64_t(blobs) * payload.size());
+      std::vector<Sha256Digest> stored(blobs);
+      Measure("store put 4 KiB (new)", blobs, [&]() {
+          for (size_t i = 0; i < blobs; i++) {
+              std::memcpy(payload.data(), &i, sizeof(i));
+              stored[i] = store.Put(payload.data(), payload.size());
+          }
+      });
+      Measure("store put 4 KiB (duplicate)", blobs, [&]() {
+          for (size_t i = 0; i < blobs; i++) {
+              std::memcpy(payload.data(), &i, sizeof(i));
+              store.Put(payload.data(), payload.size());
+          }
+      });
+      std::vector<uint8_t> out;
+      Measure("store get 4 KiB", blobs, [&]() {
+          for (auto const& digest : stored) {
+              store.Get(digest, out);
+          }
+      });
+      Measure("store put with eviction", blobs, [&]() {
+          for (size_t i = blobs; i < blobs * 2; i++) {
+              std::memcpy(payload.data(), &i, sizeof(i));
+              store.Put(payload.data(), payload.size());
+          }
+      });
+      std::printf("store holds %zu blobs, %llu bytes\n", store.Count(), static_cast<unsigned long long>(store.TotalBytes()));
+  }
+
+  // Readers, writers and evictions on overlapping content at once. The budget holds about a
+  // third of the blobs, so writes keep evicting what others are reading.
+  {
+      const size_t distinct = 96;
+      const size_t blobSize = 64 * 1024;
+      const size_t threads = 4;
+      std::vector<std::vector<uint8_t>> contents;
+      std::vector<Sha256Digest> digests;
+      for (size_t i = 0; i < distinct; i++) {
+          contents.push_back(Blob(i, blobSize + i));
+          digests.push_back(FileIngest::Sha256::Hash(contents.back().data(), contents.back().size()));
+      }
+      std::filesystem::path root = directory / "concurrent";
+      FileIngest::ContentStore store(root, uint64_t(distinct / 3) * blobSize);
+      std::atomic<size_t> hits{ 0 };
+      std::atomic<size_t> torn{ 0 };
+      size_t operations = std::min<size_t>(entries, 4000);
+      Measure("store put/get, 4 threads", operations * threads, [&]() {
+          std::vector<std::thread> workers;
+          for (size_t t = 0; t < threads; t++) {
+              workers.emplace_back([&, t]() {
+                  std::mt19937_64 engine(t);
+                  std::vector<uint8_t> out;
+                  for (size_t i = 0; i < operations; i++) {
+                      size_t n = engine() % distinct;
+                      uint64_t roll = engine() % 10;
+                      if (roll < 4) {
+                          store.Put(digests[n], contents[n].data(), contents[n].size());
+                      } else if (roll < 9) {
+                          if (store.Get(digests[n], out)) {
+                              hits++;
+                              torn += out != contents[n];
+                          }
+                      } else {
+                          store.Remove(digests[n]);
+                      }
+                  }
+              });
+          }
+          for (auto& worker : workers) {
+              worker.join();
+          }
+      });
+      std::printf("concurrent store %zu reads hit, %zu blobs kept\n", hits.load(), store.Count());
+      Require(hits > 0, "concurrent reads find stored blobs");
+      Require(torn == 0, "every read returns the bytes that were stored");
+      Require(store.TotalBytes() <= store.Budget(), "concurrent stores stay within the budget");
+      Require(BlobFiles(root) == store.Count(), "every indexed blob has its file and no other file is left");
+      std::vector<uint8_t> out;
+      for (size_t n = 0; n < distinct; n++) {
+          if (store.Contains(digests[n])) {
+              Require(store.Get(digests[n], out) && out == contents[n], "every blob left in the index reads back intact");
+          }
+      }
+  }
+
+  std::filesystem::remove_all(directory);
+  return 0;
+}
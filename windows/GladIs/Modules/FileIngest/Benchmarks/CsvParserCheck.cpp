@@ -0,0 +1,205 @@
+// Correctness of the streaming CSV parser behind parseCSVFile: hand-written cases for quoting,
+// doubled quotes, line endings, the BOM and delimiter detection, then random grids written with
+// every combination of delimiter, line ending and BOM, fed to the parser in pieces cut at random
+// boundaries (one byte at a time included) and compared field by field. Exits non-zero when a
+// check fails:
+//
+//   g++ -std=c++20 -O2 -I.. CsvParserCheck.cpp -o csv-parser-check
+//   ./csv-parser-check [grids]
+
+#include "CsvParser.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  using Grid = std::vector<std::vector<std::string>>;
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          // Only the first few are printed, a broken parser would otherwise flood the log
+          if (failures < 20) {
+              std::printf("FAILED: %s\n", what);
+          }
+          failures++;
+      }
+  }
+
+  // Feeds `text` in pieces ending at `cuts` and returns the rows with the detected delimiter
+  Grid Parse(std::string const& text, std::vector<size_t> const& cuts, char delimiter = 0, char* detected = nullptr) {
+      FileIngest::CsvParser parser(delimiter);
+      Grid rows;
+      auto onRow = [&](std::vector<std::string> const& row) {
+          rows.push_back(row);
+      };
+      size_t start = 0;
+      for (size_t cut : cuts) {
+          parser.Feed(text.data() + start, cut - start, onRow);
+          start = cut;
+      }
+      parser.Feed(text.data() + start, text.size() - start, onRow);
+      parser.Finish(onRow);
+      if (detected != nullptr) {
+          *detected = parser.Delimiter();
+      }
+      Check(parser.RowCount() == rows.size(), "RowCount counts the rows handed out");
+      return rows;
+  }
+
+  Grid Parse(std::string const& text, char delimiter = 0, char* detected = nullptr) {
+      return Parse(text, {}, delimiter, detected);
+  }
+
+  // Every split of `text` in two pieces, and one byte at a time
+  void CheckEverySplit(std::string const& text, Grid const& expected, const char* what) {
+      for (size_t cut = 0; cut <= text.size(); cut++) {
+          Check(Parse(text, std::vector<size_t>{ cut }) == expected, what);
+      }
+      std::vector<size_t> bytes;
+      for (size_t cut = 1; cut < text.size(); cut++) {
+          bytes.push_back(cut);
+      }
+      Check(Parse(text, bytes) == expected, what);
+  }
+
+  void CheckHandWritten() {
+      CheckEverySplit("a,b,c\n1,2,3\n", { { "a", "b", "c" }, { "1", "2", "3" } }, "plain rows");
+      CheckEverySplit("a,b\n1,2", { { "a", "b" }, { "1", "2" } }, "a last row without a newline");
+      CheckEverySplit("name,note\n\"Dupont, Martin\",\"said \"\"hi\"\"\"\n", { { "name", "note" }, { "Dupont, Martin", "said \"hi\"" } }, "quoted delimiters and doubled quotes");
+      CheckEverySplit("a,b\n\"line one\nline two\",\"x\r\ny\"\n", { { "a", "b" }, { "line one\nline two", "x\r\ny" } }, "newlines inside quotes");
+      CheckEverySplit("a,b\n\"\",\n,\"\"\n", { { "a", "b" }, { "", "" }, { "", "" } }, "empty quoted and unquoted fields");
+      CheckEverySplit("a,b\nab\"c,d\"\n", { { "a", "b" }, { "ab\"c", "d\"" } }, "stray quotes in unquoted fields stay literal");
+      CheckEverySplit("a,b\n\"x\"y,z\n", { { "a", "b" }, { "xy", "z" } }, "text after a closing quote is kept");
+
+      Grid twoRows = { { "a", "b" }, { "1", "2" } };
+      CheckEverySplit("a,b\r\n1,2\r\n", twoRows, "CRLF line endings");
+      CheckEverySplit("a,b\r1,2\r", twoRows, "CR line endings");
+      CheckEverySplit("a,b\n1,2\n", twoRows, "LF line endings");
+      CheckEverySplit("a,b\r\n1,2\n", twoRows, "mixed line endings");
+      CheckEverySplit("\n\na,b\r\n\r\n\n1,2\n\n", twoRows, "blank lines are skipped");
+      CheckEverySplit("\xEF\xBB\xBF" "a,b\n1,2\n", twoRows, "the BOM is stripped");
+      CheckEverySplit("a,\xEF\xBB\xBF" "b\n", { { "a", "\xEF\xBB\xBF" "b" } }, "a BOM past the start is data");
+
+      char detected = 0;
+      Check(Parse("a;b;c\n1;2;3\n", 0, &detected) == Grid{ { "a", "b", "c" }, { "1", "2", "3" } } && detected == ';', "semicolons are detected");
+      Check(Parse("a,b,c\n1;2;3;4;5\n", 0, &detected).front().size() == 3 && detected == ',', "the delimiter comes from the first line only");
+      Check(Parse("\"x,y,z\";b;c\n", 0, &detected).front() == std::vector<std::string>{ "x,y,z", "b", "c" } && detected == ';', "quoted delimiters do not count");
+      Check(Parse("a;b,c;d\n", 0, &detected).size() == 1 && detected == ';', "the more frequent delimiter wins");
+      Check(Parse("single\n", 0, &detected).front() == std::vector<std::string>{ "single" } && detected == ',', "a single column falls back to commas");
+      Check(Parse("a;b\n", ',').front() == std::vector<std::string>{ "a;b" }, "an explicit delimiter is not overridden");
+      Check(Parse("").empty(), "empty input has no rows");
+      Check(Parse("\xEF\xBB\xBF").empty(), "a lone BOM has no rows");
+
+      // A first line split over many pieces is still sniffed as a whole
+      std::string wide = "\xEF\xBB\xBF";
+      for (int i = 0; i < 200; i++) {
+          wide += "field" + std::to_string(i) + ";";
+      }
+      wide += "end\n1;2\n";
+      std::vector<size_t> pieces;
+      for (size_t cut = 1; cut < wide.size(); cut += 7) {
+          pieces.push_back(cut);
+      }
+      Grid wideRows = Parse(wide, pieces, 0, &detected);
+      Check(detected == ';' && wideRows.size() == 2 && wideRows[0].size() == 201 && wideRows[0][0] == "field0", "a first line fed in small pieces is sniffed whole");
+  }
+
+  std::string RandomField(std::mt19937& random) {
+      static const char* const kPieces[] = { "a", "Z", "42", " ", ",", ";", "\"", "\"\"", "\n", "\r", "\r\n", "\xC3\xA9", "x y", "" };
+      std::string field;
+      size_t count = random() % 5;
+      for (size_t i = 0; i < count; i++) {
+          field += kPieces[random() % (sizeof(kPieces) / sizeof(kPieces[0]))];
+      }
+      return field;
+  }
+
+  // Quotes a field when it holds either delimiter, a quote or a line break, so the other
+  // delimiter never appears bare on the first line and detection is decided by the grid
+  std::string WriteCsv(Grid const& grid, char delimiter, const char* newline, bool bom, bool trailingNewline) {
+      std::string text = bom ? "\xEF\xBB\xBF" : "";
+      for (size_t r = 0; r < grid.size(); r++) {
+          for (size_t c = 0; c < grid[r].size(); c++) {
+              if (c > 0) {
+                  text += delimiter;
+              }
+              std::string const& field = grid[r][c];
+              // A lone empty field would be a blank line, which the parser skips
+              bool quote = field.find_first_of(",;\"\r\n") != std::string::npos || (grid[r].size() == 1 && field.empty());
+              if (!quote) {
+                  text += field;
+                  continue;
+              }
+              text += '"';
+              for (char value : field) {
+                  text += value;
+                  if (value == '"') {
+                      text += '"';
+                  }
+              }
+              text += '"';
+          }
+          if (r + 1 < grid.size() || trailingNewline) {
+              text += newline;
+          }
+      }
+      return text;
+  }
+}
+
+int main(int argc, char** argv) {
+  int gridCount = argc > 1 ? std::atoi(argv[1]) : 3000;
+
+  CheckHandWritten();
+
+  std::mt19937 random(4180);
+  const char* const newlines[] = { "\n", "\r\n", "\r" };
+  for (int g = 0; g < gridCount; g++) {
+      char delimiter = random() % 2 == 0 ? ',' : ';';
+      const char* newline = newlines[random() % 3];
+      bool bom = random() % 2 == 0;
+      bool trailingNewline = random() % 4 != 0;
+
+      // The header row has at least two columns so the delimiter shows on the first line
+      Grid grid(1 + random() % 12);
+      size_t columns = 2 + random() % 6;
+      for (size_t r = 0; r < grid.size(); r++) {
+          size_t width = r == 0 || random() % 4 != 0 ? columns : 1 + random() % 8;
+          for (size_t c = 0; c < width; c++) {
+              grid[r].push_back(RandomField(random));
+          }
+      }
+      std::string text = WriteCsv(grid, delimiter, newline, bom, trailingNewline);
+
+      std::vector<size_t> cuts;
+      size_t cut = 0;
+      for (;;) {
+          // Mostly short pieces, so boundaries land inside quotes, CRLFs and the BOM
+          cut += random() % 4 == 0 ? 1 : 1 + random() % 24;
+          if (cut >= text.size()) {
+              break;
+          }
+          cuts.push_back(cut);
+      }
+
+      char detected = 0;
+      Check(Parse(text, 0, &detected) == grid, "a random grid parses back whole");
+      Check(detected == delimiter, "the delimiter of a random grid is detected");
+      Check(Parse(text, cuts) == grid, "a random grid parses back from random pieces");
+      Check(Parse(text, cuts, delimiter) == grid, "a random grid parses back with its delimiter given");
+  }
+
+  std::printf("%-28s %8d grids\n", "checked", gridCount);
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
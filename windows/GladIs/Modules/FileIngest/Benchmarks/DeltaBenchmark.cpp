@@ -0,0 +1,327 @@
+// Delta uploads of new document versions: chunks a synthetic PDF and edited versions of it,
+// uploads only the chunks the server lacks, reassembles each version the way the backend does
+// and checks it comes back byte for byte. Reports the bytes sent for each edit, against whole
+// files and against fixed-size blocks. The FileIngest headers are portable, so this builds and
+// runs on Linux:
+//
+//   g++ -std=c++20 -O2 -I.. DeltaBenchmark.cpp -o delta-benchmark
+//   ./delta-benchmark [file size in MiB] [directory]
+
+#include "ChunkManifest.h"
+#include "RangeSource.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  using Bytes = std::vector<uint8_t>;
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  // Objects of a PDF saved in full: content streams, which are compressed and so look random,
+  // small dictionaries, and the cross-reference table of every object's offset at the end
+  struct SyntheticPdf
+  {
+      std::vector<Bytes> objects;
+
+      static Bytes Stream(std::mt19937_64& engine, size_t length) {
+          Bytes bytes(length);
+          for (uint8_t& byte : bytes) {
+              byte = static_cast<uint8_t>(engine());
+          }
+          return bytes;
+      }
+
+      static Bytes Object(size_t number, Bytes const& body) {
+          std::string head = std::to_string(number) + " 0 obj\n<< /Length " + std::to_string(body.size()) + " /Filter /FlateDecode >>\nstream\n";
+          std::string tail = "\nendstream\nendobj\n";
+          Bytes object(head.begin(), head.end());
+          object.insert(object.end(), body.begin(), body.end());
+          object.insert(object.end(), tail.begin(), tail.end());
+          return object;
+      }
+
+      Bytes Save(std::string_view modified) const {
+          std::string header = "%PDF-1.7\n%\xE2\xE3\xCF\xD3\n1 0 obj\n<< /Producer (GladIs) /ModDate (D:" + std::string(modified) + ") >>\nendobj\n";
+          Bytes file(header.begin(), header.end());
+          std::vector<size_t> offsets;
+          for (Bytes const& object : objects) {
+              offsets.push_back(file.size());
+              file.insert(file.end(), object.begin(), object.end());
+          }
+          std::string xref = "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+          char entry[32];
+          for (size_t offset : offsets) {
+              std::snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+              xref += entry;
+          }
+          xref += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Info 1 0 R >>\nstartxref\n" + std::to_string(file.size()) + "\n%%EOF\n";
+          file.insert(file.end(), xref.begin(), xref.end());
+          return file;
+      }
+  };
+
+  void WriteFile(std::filesystem::path const& path, Bytes const& bytes) {
+      std::ofstream output(path, std::ios::binary | std::ios::trunc);
+      output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  }
+
+  // The backend's chunk store, keyed by digest
+  struct ChunkServer
+  {
+      std::map<FileIngest::Sha256Digest, Bytes> chunks;
+
+      void Receive(Bytes const& payload) {
+          FileIngest::ReadDeltaPayload(payload.data(), payload.size(), [&](FileIngest::Sha256Digest const& digest, const uint8_t* data, size_t length) {
+              chunks.emplace(digest, Bytes(data, data + length));
+          });
+      }
+
+      Bytes Reassemble(FileIngest::ChunkManifest const& manifest) const {
+          Bytes file;
+          FileIngest::ReassembleFile(manifest,
+              [&](FileIngest::Sha256Digest const& digest) -> const Bytes* {
+                  auto it = chunks.find(digest);
+                  return it == chunks.end() ? nullptr : &it->second;
+              },
+              [&](const uint8_t* data, size_t length) { file.insert(file.end(), data, data + length); });
+          return file;
+      }
+  };
+
+  struct Upload
+  {
+      FileIngest::ChunkManifest manifest;
+      uint64_t sentBytes = 0;
+  };
+
+  // What the module does: chunk the file on disk, plan against the base manifest, send the manifest
+  // and the payload read back from the file
+  Upload UploadVersion(std::filesystem::path const& path, FileIngest::ChunkManifest const* base, ChunkServer& server, std::vector<uint8_t>& buffer) {
+      FileIngest::NativeFileSource source(path);
+      Upload upload;
+      upload.manifest = FileIngest::BuildManifest(source, buffer.data(), buffer.size());
+      FileIngest::DeltaPlan plan = FileIngest::PlanDelta(upload.manifest, base);
+      FileIngest::DeltaPayload payload(source, upload.manifest, plan);
+      Bytes body(static_cast<size_t>(payload.Size()));
+      size_t filled = 0;
+      // Small reads, the way HttpStreamContent pulls the body
+      for (size_t read; (read = payload.Read(body.data() + filled, std::min<size_t>(16 * 1024, body.size() - filled))) != 0;) {
+          filled += read;
+      }
+      Check(filled == body.size(), "the payload is exactly the planned size");
+      server.Receive(body);
+      // The manifest travels next to the payload
+      FileIngest::ChunkManifest received = FileIngest::ChunkManifest::Parse(upload.manifest.Serialize());
+      upload.sentBytes = body.size() + upload.manifest.Serialize().size();
+      Bytes rebuilt = server.Reassemble(received);
+      Bytes original(static_cast<size_t>(source.Size()));
+      source.ReadAt(0, original.data(), original.size());
+      Check(rebuilt == original, "the server rebuilds the version byte for byte");
+      return upload;
+  }
+
+  // Bytes a dedupe on fixed 8 KiB blocks would send, for comparison
+  uint64_t FixedBlockBytes(Bytes const& base, Bytes const& next) {
+      constexpr size_t kBlock = 8 * 1024;
+      FileIngest::DigestSet known;
+      for (size_t i = 0; i < base.size(); i += kBlock) {
+          known.insert(FileIngest::Sha256::Hash(base.data() + i, std::min(kBlock, base.size() - i)));
+      }
+      uint64_t sent = 0;
+      for (size_t i = 0; i < next.size(); i += kBlock) {
+          size_t length = std::min(kBlock, next.size() - i);
+          if (known.insert(FileIngest::Sha256::Hash(next.data() + i, length)).second) {
+              sent += length;
+          }
+      }
+      return sent;
+  }
+
+  // The same boundaries whatever the read size, including reads that split the 64-byte window
+  void StreamingMatchesOneShot(Bytes const& file) {
+      FileIngest::ContentChunker chunker;
+      std::vector<size_t> expected;
+      for (size_t offset = 0; offset < file.size();) {
+          size_t cut = chunker.FindBoundary(file.data() + offset, file.size() - offset, true);
+          expected.push_back(cut);
+          offset += cut;
+      }
+      bool sizesOk = true;
+      for (size_t i = 0; i + 1 < expected.size(); i++) {
+          sizesOk = sizesOk && expected[i] >= chunker.Params().minSize && expected[i] <= chunker.Params().maxSize;
+      }
+      Check(sizesOk, "chunks stay within the minimum and maximum sizes");
+      for (size_t step : { size_t(1) << 20, size_t(4096), size_t(977), size_t(63) }) {
+          FileIngest::ContentChunker streaming;
+          std::vector<size_t> actual;
+          auto onChunk = [&](const uint8_t*, size_t length) { actual.push_back(length); };
+          for (size_t offset = 0; offset < file.size(); offset += step) {
+              streaming.Update(file.data() + offset, std::min(step, file.size() - offset), onChunk);
+          }
+          streaming.Finish(onChunk);
+          Check(actual == expected, "streamed chunking finds the one-shot boundaries");
+      }
+  }
+
+  void RejectsDamage(Bytes const& file) {
+      FileIngest::ChunkManifest manifest;
+      {
+          FileIngest::ManifestBuilder builder;
+          builder.Update(file.data(), file.size());
+          manifest = builder.Finish();
+      }
+      Bytes serialized = manifest.Serialize();
+      bool rejected = false;
+      try {
+          FileIngest::ChunkManifest::Parse(serialized.data(), serialized.size() - 1);
+      } catch (FileIngest::ManifestError const&) {
+          rejected = true;
+      }
+      Check(rejected, "a truncated manifest is rejected");
+
+      Bytes record(FileIngest::DeltaPayload::kRecordHeaderSize + manifest.chunks[0].length);
+      std::memcpy(record.data(), manifest.chunks[0].digest.data(), 32);
+      for (int i = 0; i < 4; i++) {
+          record[32 + i] = static_cast<uint8_t>(manifest.chunks[0].length >> (8 * i));
+      }
+      std::memcpy(record.data() + FileIngest::DeltaPayload::kRecordHeaderSize, file.data(), manifest.chunks[0].length);
+      record.back() ^= 1;
+      rejected = false;
+      try {
+          ChunkServer().Receive(record);
+      } catch (FileIngest::ManifestError const&) {
+          rejected = true;
+      }
+      Check(rejected, "a chunk that does not match its digest is rejected");
+
+      rejected = false;
+      try {
+          ChunkServer().Reassemble(manifest);
+      } catch (FileIngest::ManifestError const&) {
+          rejected = true;
+      }
+      Check(rejected, "reassembly fails when a chunk is missing");
+  }
+
+  void Throughput(Bytes const& file) {
+      FileIngest::ContentChunker chunker;
+      auto start = std::chrono::steady_clock::now();
+      size_t chunks = 0;
+      for (size_t offset = 0; offset < file.size(); chunks++) {
+          offset += chunker.FindBoundary(file.data() + offset, file.size() - offset, true);
+      }
+      double chunking = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      start = std::chrono::steady_clock::now();
+      FileIngest::ManifestBuilder builder;
+      builder.Update(file.data(), file.size());
+      FileIngest::ChunkManifest manifest = builder.Finish();
+      double hashing = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::printf("chunking %8.0f MB/s, chunking and SHA-256 %6.0f MB/s, %zu chunks of %zu bytes on average\n",
+          file.size() / 1e6 / chunking, file.size() / 1e6 / hashing, chunks, file.size() / std::max<size_t>(manifest.chunks.size(), 1));
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t mebibytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+  std::filesystem::path directory = argc > 2 ? argv[2] : std::filesystem::temp_directory_path() / "delta-benchmark";
+  std::filesystem::create_directories(directory);
+
+  // Pages of 20 to 80 KiB until the file reaches the requested size
+  std::mt19937_64 engine(42);
+  SyntheticPdf pdf;
+  size_t total = 0;
+  while (total < mebibytes << 20) {
+      Bytes body = SyntheticPdf::Stream(engine, 20 * 1024 + engine() % (60 * 1024));
+      total += body.size();
+      pdf.objects.push_back(SyntheticPdf::Object(pdf.objects.size() + 2, body));
+  }
+  Bytes original = pdf.Save("20240101120000");
+
+  StreamingMatchesOneShot(original);
+  RejectsDamage(original);
+  Throughput(original);
+
+  std::vector<uint8_t> buffer(1 << 20);
+  ChunkServer server;
+  WriteFile(directory / "v1.pdf", original);
+  Upload first = UploadVersion(directory / "v1.pdf", nullptr, server, buffer);
+  Check(first.sentBytes >= original.size(), "the first version is sent in full");
+
+  size_t middle = pdf.objects.size() / 2;
+  struct Edit
+  {
+      const char* name;
+      Bytes file;
+      // Bytes of new content in the version, what any delta has to send at least
+      size_t changed;
+  };
+  std::vector<Edit> edits;
+  edits.push_back({ "metadata only", pdf.Save("20240102093000"), 0 });
+  {
+      SyntheticPdf edited = pdf;
+      Bytes page = SyntheticPdf::Stream(engine, 45 * 1024);
+      edited.objects[middle] = SyntheticPdf::Object(middle + 2, page);
+      edits.push_back({ "page rewritten", edited.Save("20240102093000"), page.size() });
+  }
+  {
+      SyntheticPdf edited = pdf;
+      Bytes page = SyntheticPdf::Stream(engine, 30 * 1024);
+      edited.objects.insert(edited.objects.begin() + static_cast<std::ptrdiff_t>(middle), SyntheticPdf::Object(9999, page));
+      edits.push_back({ "page inserted", edited.Save("20240102093000"), page.size() });
+  }
+  {
+      SyntheticPdf edited = pdf;
+      edited.objects.erase(edited.objects.begin() + static_cast<std::ptrdiff_t>(middle));
+      edits.push_back({ "page removed", edited.Save("20240102093000"), 0 });
+  }
+  {
+      // Incremental save: the original bytes untouched, an update section appended
+      Bytes appended = original;
+      Bytes annotation = SyntheticPdf::Object(pdf.objects.size() + 2, SyntheticPdf::Stream(engine, 12 * 1024));
+      appended.insert(appended.end(), annotation.begin(), annotation.end());
+      std::string xref = "xref\n0 1\n0000000000 65535 f \ntrailer\n<< /Prev 0 >>\n%%EOF\n";
+      appended.insert(appended.end(), xref.begin(), xref.end());
+      edits.push_back({ "annotation appended", appended, annotation.size() });
+  }
+  edits.push_back({ "unrelated file", SyntheticPdf::Stream(engine, original.size()), original.size() });
+
+  std::printf("%-20s %10s %12s %8s %12s %8s\n", "edit", "file", "delta sent", "saved", "8 KiB blocks", "saved");
+  for (Edit const& edit : edits) {
+      std::filesystem::path path = directory / "v2.pdf";
+      WriteFile(path, edit.file);
+      Upload upload = UploadVersion(path, &first.manifest, server, buffer);
+      uint64_t fixed = FixedBlockBytes(original, edit.file);
+      std::printf("%-20s %8.2f MB %9.1f KiB %7.1f%% %9.1f KiB %7.1f%%\n", edit.name, edit.file.size() / 1e6,
+          upload.sentBytes / 1024.0, 100.0 * (1.0 - double(upload.sentBytes) / edit.file.size()),
+          fixed / 1024.0, 100.0 * (1.0 - double(fixed) / edit.file.size()));
+      // Beyond the new bytes themselves: the manifest, the xref table and a few chunks either
+      // side of each edit
+      if (edit.changed < original.size()) {
+          Check(upload.sentBytes < edit.changed + original.size() / 20 + 256 * 1024, "an edit sends little more than what changed");
+      }
+  }
+
+  std::filesystem::remove_all(directory);
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,574 @@
+// Parallel ranged downloads: fetches a file from a local stand-in of the backend as Range
+// requests over a pool of keep-alive connections, writing each chunk at its offset, and
+// verifies the assembled file against the server's Repr-Digest before moving it into a
+// ContentStore. Reports throughput for one connection and for several over a paced link, then
+// checks a download killed halfway resumes from its saved bitmap, a flaky server is retried
+// through, a file changed on the server starts over, corruption is caught by the digest and a
+// server without Range support still works. Without a port only the offline checks of the
+// parsers and the saved progress run. Exits non-zero when a check fails:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. DownloadBenchmark.cpp -o download-benchmark
+//   ./download-benchmark [file size in MiB] [directory]
+//   python3 range_stand_in_server.py ./download-benchmark [file size in MiB] [directory]
+
+#include "ContentStore.h"
+#include "RangeDownload.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  using FileIngest::DownloadError;
+  using FileIngest::DownloadRange;
+  using FileIngest::RangeDownload;
+  using FileIngest::Sha256Digest;
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  // A dropped connection or a short answer: the chunk is worth asking for again
+  struct TransportError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  // One keep-alive HTTP/1.1 connection, as HttpClient keeps them under the module. Answers must
+  // carry a Content-Length, which the stand-in always sends.
+  class HttpConnection
+  {
+  public:
+      explicit HttpConnection(uint16_t port) {
+          m_socket = socket(AF_INET, SOCK_STREAM, 0);
+          sockaddr_in address{};
+          address.sin_family = AF_INET;
+          address.sin_port = htons(port);
+          address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+          int on = 1;
+          setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+          if (m_socket < 0 || connect(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+              close(m_socket);
+              throw TransportError("Cannot connect to the stand-in server");
+          }
+      }
+
+      ~HttpConnection() {
+          close(m_socket);
+      }
+
+      HttpConnection(HttpConnection const&) = delete;
+      HttpConnection& operator=(HttpConnection const&) = delete;
+
+      struct Response
+      {
+          int status = 0;
+          std::map<std::string, std::string> headers;
+          uint64_t contentLength = 0;
+
+          std::string Header(std::string const& name) const {
+              auto found = headers.find(name);
+              return found == headers.end() ? std::string() : found->second;
+          }
+      };
+
+      // Sends a GET and reads the answer's head; the body follows through ReadBody
+      Response Get(std::string const& target, std::vector<std::pair<std::string, std::string>> const& headers) {
+          std::string request = "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+          for (auto const& [name, value] : headers) {
+              request += name + ": " + value + "\r\n";
+          }
+          request += "\r\n";
+          for (size_t sent = 0; sent < request.size();) {
+              ssize_t written = send(m_socket, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+              if (written <= 0) {
+                  throw TransportError("Connection lost while sending");
+              }
+              sent += static_cast<size_t>(written);
+          }
+
+          size_t end;
+          while ((end = m_buffer.find("\r\n\r\n", m_start)) == std::string::npos) {
+              Fill();
+          }
+          std::string head = m_buffer.substr(m_start, end - m_start);
+          m_start = end + 4;
+          Response response;
+          size_t line = head.find("\r\n");
+          std::string status = head.substr(0, line);
+          if (status.size() < 12 || status.compare(0, 5, "HTTP/") != 0) {
+              throw TransportError("Malformed status line");
+          }
+          response.status = std::atoi(status.c_str() + 9);
+          while (line != std::string::npos) {
+              size_t next = head.find("\r\n", line + 2);
+              std::string field = head.substr(line + 2, next == std::string::npos ? std::string::npos : next - line - 2);
+              size_t colon = field.find(':');
+              if (colon != std::string::npos) {
+                  std::string name = field.substr(0, colon);
+                  std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                  response.headers[name] = std::string(FileIngest::detail::TrimHeader(std::string_view(field).substr(colon + 1)));
+              }
+              line = next;
+          }
+          response.contentLength = std::strtoull(response.Header("content-length").c_str(), nullptr, 10);
+          m_remaining = response.contentLength;
+          return response;
+      }
+
+      // Reads up to `capacity` bytes of the current body; 0 once it was read in full
+      size_t ReadBody(uint8_t* out, size_t capacity) {
+          if (m_remaining == 0) {
+              return 0;
+          }
+          if (m_start == m_buffer.size()) {
+              Fill();
+          }
+          size_t take = static_cast<size_t>(std::min<uint64_t>({ capacity, m_remaining, m_buffer.size() - m_start }));
+          std::copy_n(m_buffer.data() + m_start, take, out);
+          m_start += take;
+          m_remaining -= take;
+          return take;
+      }
+
+  private:
+      void Fill() {
+          if (m_start == m_buffer.size()) {
+              m_buffer.clear();
+              m_start = 0;
+          }
+          char chunk[64 * 1024];
+          ssize_t received = recv(m_socket, chunk, sizeof(chunk), 0);
+          if (received <= 0) {
+              throw TransportError("Connection closed early");
+          }
+          m_buffer.append(chunk, static_cast<size_t>(received));
+      }
+
+      int m_socket = -1;
+      std::string m_buffer;
+      size_t m_start = 0;
+      uint64_t m_remaining = 0;
+  };
+
+  struct Options
+  {
+      size_t connections = 4;
+      uint32_t chunkSize = 128 * 1024;
+      // Kills the process once this many chunks are done, as a crash or a closed app would
+      uint32_t killAfter = 0;
+  };
+
+  struct Result
+  {
+      Sha256Digest digest{};
+      uint64_t size = 0;
+      uint64_t resumedBytes = 0;
+      std::atomic<uint64_t> fetchedBytes{ 0 };
+      std::atomic<uint32_t> requests{ 0 };
+      std::atomic<uint32_t> retries{ 0 };
+      bool ranged = false;
+  };
+
+  // Streams one answer's body into a claimed chunk, which must arrive exactly
+  void ReceiveChunk(HttpConnection& connection, HttpConnection::Response const& response, RangeDownload& download, DownloadRange const& range, Result& result) {
+      if (response.contentLength != range.length) {
+          throw DownloadError("Server answered a different range");
+      }
+      uint8_t buffer[64 * 1024];
+      uint64_t at = 0;
+      for (size_t read; (read = connection.ReadBody(buffer, sizeof(buffer))) > 0; at += read) {
+          download.Write(range, at, buffer, read);
+          result.fetchedBytes += read;
+      }
+  }
+
+  void Discard(HttpConnection& connection, Result& result) {
+      uint8_t buffer[64 * 1024];
+      for (size_t read; (read = connection.ReadBody(buffer, sizeof(buffer))) > 0;) {
+          result.fetchedBytes += read;
+      }
+  }
+
+  // Downloads `target` into `path` the way the module does: the first request asks for chunk 0
+  // and learns the size, validator and digest from the answer, then `connections` connections
+  // take chunks in turn. A failed chunk goes back to the others; the digest is checked at the end.
+  void Download(uint16_t port, std::string const& target, std::filesystem::path const& path, Options const& options, Result& result) {
+      std::unique_ptr<HttpConnection> probe;
+      HttpConnection::Response response;
+      for (uint32_t attempt = 1;; attempt++) {
+          try {
+              probe = std::make_unique<HttpConnection>(port);
+              result.requests++;
+              response = probe->Get(target, { { "Range", "bytes=0-" + std::to_string(options.chunkSize - 1) } });
+              break;
+          } catch (TransportError const&) {
+              result.retries++;
+              if (attempt == RangeDownload::kMaxAttempts) {
+                  throw;
+              }
+          }
+      }
+      Sha256Digest expected{};
+      bool hasExpected = FileIngest::ParseDigestHeader(response.Header("repr-digest"), expected) || FileIngest::ParseDigestHeader(response.Header("digest"), expected);
+
+      std::optional<RangeDownload> download;
+      std::string validator = FileIngest::ChooseValidator(response.Header("etag"), response.Header("last-modified"));
+      uint64_t total = 0;
+      if (FileIngest::IsRangedFirstAnswer(response.status, response.Header("content-range"), total)) {
+          result.ranged = true;
+          download.emplace(path, total, options.chunkSize, validator);
+      } else {
+          // No Range support: the whole file arrives on this connection as one chunk, and a
+          // download cut short has to start over
+          if (response.contentLength > UINT32_MAX) {
+              throw DownloadError("File too large to download without ranges");
+          }
+          download.emplace(path, response.contentLength, static_cast<uint32_t>(std::max<uint64_t>(response.contentLength, 1)), std::string());
+      }
+      result.size = download->Size();
+      result.resumedBytes = download->ResumedBytes();
+
+      std::atomic<uint32_t> completed{ 0 };
+      auto complete = [&](DownloadRange const& range) {
+          download->Complete(range);
+          if (options.killAfter != 0 && ++completed == options.killAfter) {
+              kill(getpid(), SIGKILL);
+          }
+      };
+      DownloadRange range;
+      bool claimed = download->Claim(0, range);
+      try {
+          if (claimed) {
+              ReceiveChunk(*probe, response, *download, range, result);
+              complete(range);
+          } else {
+              Discard(*probe, result);
+          }
+      } catch (TransportError const&) {
+          result.retries++;
+          if (claimed) {
+              download->Fail(range);
+          }
+          probe.reset();
+      }
+
+      std::atomic<bool> stop{ false };
+      std::exception_ptr error;
+      std::mutex errorMutex;
+      auto worker = [&](std::unique_ptr<HttpConnection> connection) {
+          DownloadRange range;
+          uint64_t first = 0, last = 0, total = 0;
+          while (!stop && download->Next(range)) {
+              try {
+                  if (!connection) {
+                      connection = std::make_unique<HttpConnection>(port);
+                  }
+                  result.requests++;
+                  HttpConnection::Response answer = connection->Get(target, { { "Range", FileIngest::RangeHeader(range) }, { "If-Range", validator } });
+                  if (answer.status != 206 || !FileIngest::ParseContentRange(answer.Header("content-range"), first, last, total)) {
+                      // A 200 here is the whole file again: it changed since the first request
+                      throw DownloadError("File changed on the server");
+                  }
+                  ReceiveChunk(*connection, answer, *download, range, result);
+                  complete(range);
+              } catch (TransportError const&) {
+                  result.retries++;
+                  connection.reset();
+                  if (!download->Fail(range)) {
+                      std::lock_guard<std::mutex> lock(errorMutex);
+                      error = std::make_exception_ptr(DownloadError("Download failed after retries"));
+                      stop = true;
+                  }
+              } catch (...) {
+                  download->Fail(range);
+                  std::lock_guard<std::mutex> lock(errorMutex);
+                  error = std::current_exception();
+                  stop = true;
+              }
+          }
+      };
+      std::vector<std::thread> threads;
+      for (size_t i = 1; i < options.connections; i++) {
+          threads.emplace_back(worker, nullptr);
+      }
+      worker(std::move(probe));
+      for (std::thread& thread : threads) {
+          thread.join();
+      }
+      if (error) {
+          download->Checkpoint();
+          std::rethrow_exception(error);
+      }
+
+      std::vector<uint8_t> buffer(1024 * 1024);
+      result.digest = download->Digest(buffer.data(), buffer.size());
+      if (hasExpected && result.digest != expected) {
+          download->Discard();
+          throw DownloadError("Downloaded file does not match its digest");
+      }
+      download->Finish();
+  }
+
+  std::string FileTarget(uint64_t size, int seed, std::string const& extra = {}) {
+      return "/files/manual.pdf?size=" + std::to_string(size) + "&seed=" + std::to_string(seed) + extra;
+  }
+
+  // The stand-in's digest of a file, fetched whole on a connection of its own
+  Sha256Digest ServerDigest(uint16_t port, std::string const& target) {
+      HttpConnection connection(port);
+      HttpConnection::Response response = connection.Get(target, { { "Range", "bytes=0-0" } });
+      Sha256Digest digest{};
+      FileIngest::ParseDigestHeader(response.Header("repr-digest"), digest);
+      return digest;
+  }
+
+  double Timed(std::function<void()> const& run) {
+      auto start = std::chrono::steady_clock::now();
+      run();
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // Runs a download in a child process killed after `killAfter` chunks
+  void DownloadAndKill(uint16_t port, std::string const& target, std::filesystem::path const& path, Options options, uint32_t killAfter) {
+      options.killAfter = killAfter;
+      pid_t child = fork();
+      if (child == 0) {
+          Result result;
+          try {
+              Download(port, target, path, options, result);
+          } catch (...) {
+          }
+          _exit(0);
+      }
+      int status = 0;
+      waitpid(child, &status, 0);
+      Check(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL, "the download is killed halfway");
+  }
+
+  void OfflineChecks(std::filesystem::path const& directory) {
+      uint64_t first = 0, last = 0, total = 0;
+      Check(FileIngest::ParseContentRange("bytes 0-1023/4096", first, last, total) && first == 0 && last == 1023 && total == 4096, "Content-Range parses");
+      Check(FileIngest::ParseContentRange(" Bytes 10-10/11 ", first, last, total) && first == 10 && last == 10, "Content-Range is case-insensitive");
+      Check(!FileIngest::ParseContentRange("bytes */4096", first, last, total), "a 416 range is rejected");
+      Check(!FileIngest::ParseContentRange("bytes 0-99/*", first, last, total), "an unknown total is rejected");
+      Check(!FileIngest::ParseContentRange("bytes 5-4/10", first, last, total) && !FileIngest::ParseContentRange("bytes 0-10/10", first, last, total), "an impossible range is rejected");
+      Check(FileIngest::RangeHeader({ 3, 3072, 1024 }) == "bytes=3072-4095", "Range asks for the chunk");
+
+      auto firstAnswer = [](int status, std::string_view contentRange) {
+          uint64_t size = 0;
+          try {
+              return FileIngest::IsRangedFirstAnswer(status, contentRange, size) ? static_cast<int64_t>(size) : 0;
+          } catch (DownloadError const&) {
+              return int64_t(-1);
+          }
+      };
+      Check(firstAnswer(206, "bytes 0-1023/5000") == 5000 && firstAnswer(200, "") == 0, "a first answer is ranged on a 206 and whole on a 200");
+      Check(firstAnswer(206, "") == -1 && firstAnswer(206, "bytes */5000") == -1, "a 206 without a Content-Range is refused");
+      Check(firstAnswer(206, "bytes 1024-2047/5000") == -1, "a 206 that does not start at 0 is refused");
+      Check(firstAnswer(204, "") == -1 && firstAnswer(203, "") == -1, "other successes are not taken as the whole file");
+
+      Sha256Digest expected = FileIngest::Sha256::Hash(reinterpret_cast<const uint8_t*>("abc"), 3);
+      std::string encoded = FileIngest::Base64::Encode(expected.data(), expected.size());
+      Sha256Digest digest{};
+      Check(FileIngest::ParseDigestHeader("sha-512=:AAAA:, sha-256=:" + encoded + ":", digest) && digest == expected, "Repr-Digest yields the SHA-256");
+      Check(FileIngest::ParseDigestHeader("SHA-256=" + encoded, digest) && digest == expected, "the older Digest header works too");
+      Check(!FileIngest::ParseDigestHeader("md5=:AAAA:", digest), "no SHA-256, no digest");
+      Check(FileIngest::ChooseValidator("\"abc\"", "date") == "\"abc\"" && FileIngest::ChooseValidator("W/\"abc\"", "date") == "date", "weak ETags are not used in If-Range");
+
+      std::filesystem::path path = directory / "offline.pdf";
+      std::vector<uint8_t> chunk(1000, 7);
+      {
+          RangeDownload download(path, 10500, 1000, "\"v1\"");
+          Check(download.ChunkCount() == 11 && download.ResumedBytes() == 0, "a new download starts empty");
+          DownloadRange range;
+          for (int i = 0; i < 10 && download.Next(range); i++) {
+              download.Write(range, 0, chunk.data(), static_cast<size_t>(range.length));
+              download.Complete(range);
+          }
+          // Eight of ten completions were saved; the last two are lost with the process
+      }
+      {
+          RangeDownload download(path, 10500, 1000, "\"v1\"");
+          Check(download.ResumedBytes() == 8000, "progress up to the last checkpoint resumes");
+          DownloadRange range;
+          Check(download.Next(range) && range.index == 8, "the first missing chunk comes next");
+          bool thrown = false;
+          try {
+              download.Write(range, 500, chunk.data(), chunk.size());
+          } catch (DownloadError const&) {
+              thrown = true;
+          }
+          Check(thrown, "bytes past the chunk are refused");
+          uint32_t attempts = 1;
+          while (download.Fail(range) && download.Claim(8, range)) {
+              attempts++;
+          }
+          Check(attempts == RangeDownload::kMaxAttempts, "a chunk is given up after kMaxAttempts");
+          download.Checkpoint();
+      }
+      Check(RangeDownload(path, 10500, 1000, "\"v2\"").ResumedBytes() == 0, "another validator starts over");
+      Check(RangeDownload(path, 10500, 1000, "").ResumedBytes() == 0 && !std::filesystem::exists(RangeDownload::StatePath(path)), "without a validator nothing is saved");
+      {
+          RangeDownload download(path, 2500, 1000, "\"v1\"");
+          DownloadRange range;
+          while (download.Next(range)) {
+              download.Write(range, 0, chunk.data(), static_cast<size_t>(range.length));
+              download.Complete(range);
+          }
+          std::vector<uint8_t> buffer(4096);
+          std::vector<uint8_t> whole(2500, 7);
+          Check(download.IsComplete() && download.Digest(buffer.data(), buffer.size()) == FileIngest::Sha256::Hash(whole.data(), whole.size()), "the digest covers the whole file");
+          download.Finish();
+      }
+      Check(std::filesystem::file_size(path) == 2500 && !std::filesystem::exists(RangeDownload::StatePath(path)), "a finished download leaves the file alone");
+  }
+}
+
+int main(int argc, char** argv) {
+  uint64_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+  std::filesystem::path directory = argc > 2 ? std::filesystem::path(argv[2]) : std::filesystem::temp_directory_path() / "download-benchmark";
+  uint16_t port = argc > 3 ? static_cast<uint16_t>(std::strtoul(argv[3], nullptr, 10)) : 0;
+  uint64_t size = std::max<uint64_t>(megabytes, 1) * 1024 * 1024 + 12345;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  OfflineChecks(directory);
+  if (port == 0) {
+      std::printf(failures == 0 ? "ok\n" : "%d checks failed\n", failures);
+      return failures == 0 ? 0 : 1;
+  }
+
+  // A paced link: each connection gets 4 MB/s and every answer waits 20 ms, so parallel
+  // connections pay off as they would over a slow VPN to the backend
+  std::string link = "&rate=4000000&latency=20";
+  Options options;
+  std::filesystem::path path = directory / "manual.pdf";
+  std::string target = FileTarget(size, 1, link);
+  Sha256Digest expected = ServerDigest(port, target);
+
+  std::printf("%-24s %8s %10s %9s %8s %8s\n", "run", "MiB", "MB/s", "fetched", "requests", "retries");
+  auto report = [&](const char* name, Result const& result, double seconds) {
+      std::printf("%-24s %8.1f %10.1f %8.1f%% %8u %8u\n", name, result.size / 1048576.0, (result.size - result.resumedBytes) / 1e6 / seconds,
+          100.0 * result.fetchedBytes / std::max<uint64_t>(result.size, 1), result.requests.load(), result.retries.load());
+  };
+
+  double sequential = 0;
+  {
+      Options single = options;
+      single.connections = 1;
+      Result result;
+      sequential = Timed([&] { Download(port, target, path, single, result); });
+      report("1 connection", result, sequential);
+      Check(result.ranged && result.digest == expected, "a single connection downloads the file intact");
+  }
+  {
+      Result result;
+      double seconds = Timed([&] { Download(port, target, path, options, result); });
+      report("4 connections", result, seconds);
+      Check(result.digest == expected, "parallel ranges assemble the file intact");
+      Check(sequential / seconds > 2.0, "four connections are at least twice as fast over a paced link");
+
+      // Handed to the content store as the module does, without copying the file
+      FileIngest::ContentStore store(directory / "store", 1ull << 30);
+      std::vector<uint8_t> stored;
+      Check(store.PutFile(result.digest, path) && !std::filesystem::exists(path), "the download moves into the content store");
+      Check(store.Get(result.digest, stored) && stored.size() == size, "the stored download reads back intact");
+      Result again;
+      Download(port, target, path, options, again);
+      Check(!store.PutFile(again.digest, path) && !std::filesystem::exists(path) && store.Count() == 1, "the same document is stored once");
+  }
+  {
+      std::filesystem::remove(path);
+      uint32_t chunks = static_cast<uint32_t>((size + options.chunkSize - 1) / options.chunkSize);
+      uint32_t killAfter = chunks * 3 / 4;
+      DownloadAndKill(port, target, path, options, killAfter);
+      Result result;
+      double seconds = Timed([&] { Download(port, target, path, options, result); });
+      report("resumed after a kill", result, seconds);
+      Check(result.digest == expected, "a resumed download is intact");
+      // Chunks completed by other connections may still be saving when the process dies
+      uint32_t saved = (killAfter - static_cast<uint32_t>(options.connections)) / RangeDownload::kCheckpointInterval * RangeDownload::kCheckpointInterval;
+      Check(result.resumedBytes > 0 && result.resumedBytes >= uint64_t(saved) * options.chunkSize, "everything up to the last checkpoint is kept");
+      Check(result.fetchedBytes <= size - result.resumedBytes + options.chunkSize, "only missing chunks are fetched again, plus the first request's");
+  }
+  {
+      std::filesystem::remove(path);
+      Result result;
+      double seconds = Timed([&] { Download(port, FileTarget(size, 1, link + "&fail=5"), path, options, result); });
+      report("every 5th answer cut", result, seconds);
+      Check(result.digest == expected && result.retries > 0, "dropped connections are retried through");
+  }
+  {
+      std::filesystem::remove(path);
+      uint32_t chunks = static_cast<uint32_t>((size + options.chunkSize - 1) / options.chunkSize);
+      DownloadAndKill(port, target, path, options, chunks * 3 / 4);
+      std::string changed = FileTarget(size, 2, link);
+      Result result;
+      double seconds = Timed([&] { Download(port, changed, path, options, result); });
+      report("changed on the server", result, seconds);
+      Check(result.resumedBytes == 0 && result.digest == ServerDigest(port, changed), "a file changed on the server starts over");
+  }
+  {
+      std::filesystem::remove(path);
+      Result result;
+      bool mismatch = false;
+      try {
+          Download(port, FileTarget(size, 1, link + "&corrupt=1"), path, options, result);
+      } catch (DownloadError const&) {
+          mismatch = true;
+      }
+      std::printf("%-24s %8.1f %10s\n", "corrupted", size / 1048576.0, mismatch ? "rejected" : "ACCEPTED");
+      Check(mismatch && !std::filesystem::exists(path) && !std::filesystem::exists(RangeDownload::StatePath(path)), "a corrupted file fails its digest and is deleted");
+  }
+  {
+      std::filesystem::remove(path);
+      Result result;
+      double seconds = Timed([&] { Download(port, FileTarget(size, 1, link + "&ranges=0"), path, options, result); });
+      report("no Range support", result, seconds);
+      Check(!result.ranged && result.digest == expected, "a server without ranges is read sequentially");
+  }
+  {
+      std::filesystem::remove(path);
+      Result result;
+      bool refused = false;
+      try {
+          Download(port, FileTarget(size, 1, link + "&ranges=broken"), path, options, result);
+      } catch (DownloadError const&) {
+          refused = true;
+      }
+      std::printf("%-24s %8.1f %10s\n", "206 without range", size / 1048576.0, refused ? "rejected" : "ACCEPTED");
+      Check(refused && !std::filesystem::exists(path), "a 206 without Content-Range is not saved as the whole file");
+  }
+
+  std::filesystem::remove_all(directory);
+  std::printf(failures == 0 ? "ok\n" : "%d checks failed\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// Streams a million activity-log rows through the CSV and XLSX table writers, draining their
+// output to disk every 256 KiB the way the FileSavePicker module does, and reports throughput
+// and peak memory. The FileIngest headers are portable, so this builds and runs on Linux:
+//
+//   g++ -std=c++20 -O2 -I.. ExportBenchmark.cpp -o export-benchmark
+//   ./export-benchmark [rows] [directory to keep export.csv and export.xlsx in]
+
+#include "CsvParser.h"
+#include "TableWriter.h"
+#include "XlsxWriter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace
+{
+  // Same threshold as the module: larger writes to the file, no larger buffer
+  constexpr size_t kDrainSize = 256 * 1024;
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  long PeakResidentKiB() {
+      rusage usage{};
+      getrusage(RUSAGE_SELF, &usage);
+      return usage.ru_maxrss;
+  }
+
+  // Columns of a document activity log, with the odd comma, quote, line break and accent
+  struct RowGenerator
+  {
+      std::string name;
+      std::string actor;
+      std::string date;
+      std::vector<FileIngest::TableCell> cells;
+
+      std::vector<FileIngest::TableCell> const& Row(size_t i) {
+          name = "Procédure qualité " + std::to_string(i % 977);
+          if (i % 50 == 0) {
+              name += ", révision \"B\"";
+          }
+          if (i % 100 == 0) {
+              name += "\r\nnote <interne> & suivi";
+          }
+          actor = "utilisateur" + std::to_string(i % 131);
+          char buffer[32];
+          std::snprintf(buffer, sizeof(buffer), "2024-%02zu-%02zuT%02zu:%02zu:00Z", i % 12 + 1, i % 28 + 1, i % 24, i % 60);
+          date = buffer;
+          cells.clear();
+          cells.push_back(FileIngest::TableCell::Text(name));
+          cells.push_back(FileIngest::TableCell::Text(actor));
+          cells.push_back(FileIngest::TableCell::Text(date));
+          cells.push_back(FileIngest::TableCell::Text(i % 3 == 0 ? "approbation" : "consultation"));
+          cells.push_back(FileIngest::TableCell::Number(static_cast<double>(i % 7) * 1.25));
+          cells.push_back(i % 9 == 0 ? FileIngest::TableCell{} : FileIngest::TableCell::Text(i % 2 ? "true" : "false"));
+          return cells;
+      }
+  };
+
+  void Export(FileIngest::TableWriter& writer, size_t rows, std::filesystem::path const& path, const char* label) {
+      std::FILE* file = std::fopen(path.string().c_str(), "wb");
+      if (file == nullptr) {
+          std::perror("fopen");
+          std::exit(1);
+      }
+      RowGenerator generator;
+      std::vector<FileIngest::TableCell> header = {
+          FileIngest::TableCell::Text("name"), FileIngest::TableCell::Text("actorUsername"), FileIngest::TableCell::Text("actionDate"),
+          FileIngest::TableCell::Text("action"), FileIngest::TableCell::Text("weight"), FileIngest::TableCell::Text("actorIsAdmin"),
+      };
+      size_t peakBuffer = 0;
+      uint64_t bytes = 0;
+      auto drain = [&](bool force) {
+          std::vector<uint8_t>& output = writer.Output();
+          peakBuffer = std::max(peakBuffer, output.capacity());
+          if (output.size() >= kDrainSize || (force && !output.empty())) {
+              std::fwrite(output.data(), 1, output.size(), file);
+              bytes += output.size();
+              output.clear();
+          }
+      };
+      long residentBefore = PeakResidentKiB();
+      auto start = std::chrono::steady_clock::now();
+      writer.WriteRow(header);
+      for (size_t i = 0; i < rows; i++) {
+          writer.WriteRow(generator.Row(i));
+          drain(false);
+      }
+      writer.Finish();
+      drain(true);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::fclose(file);
+      long residentGrowth = PeakResidentKiB() - residentBefore;
+      std::printf("%-5s %9zu rows %10.1f MB %8.3f s %10.0f rows/s %7.1f MB/s  buffer peak %4zu KiB  rss growth %6ld KiB\n",
+          label, rows, bytes / 1e6, seconds, rows / seconds, bytes / 1e6 / seconds, peakBuffer / 1024, residentGrowth);
+      Check(writer.Rows() == rows + 1, "every row is written");
+      Check(peakBuffer < 4 * kDrainSize, "the output buffer stays bounded by the drain size");
+      Check(residentGrowth < 32 * 1024, "memory stays flat whatever the row count");
+  }
+
+  // Tricky fields survive CsvWriter -> CsvParser unchanged
+  void CsvRoundTrip() {
+      std::vector<std::string> fields = { "plain", "a,b", "say \"hi\"", "two\r\nlines", "", " spaced ", "\"", "ünïcödé;" };
+      std::vector<FileIngest::TableCell> cells;
+      for (std::string const& field : fields) {
+          cells.push_back(FileIngest::TableCell::Text(field));
+      }
+      cells.push_back(FileIngest::TableCell::Number(0.1));
+      cells.push_back(FileIngest::TableCell::Number(-42));
+      FileIngest::CsvWriter writer;
+      writer.WriteRow(cells);
+      writer.WriteRow(cells);
+      writer.Finish();
+      std::vector<std::vector<std::string>> parsed;
+      FileIngest::CsvParser parser(',');
+      auto onRow = [&](std::vector<std::string> const& row) { parsed.push_back(row); };
+      parser.Feed(reinterpret_cast<const char*>(writer.Output().data()), writer.Output().size(), onRow);
+      parser.Finish(onRow);
+      std::vector<std::string> expected = fields;
+      expected.push_back("0.1");
+      expected.push_back("-42");
+      Check(parsed.size() == 2 && parsed[0] == expected && parsed[1] == expected, "CSV fields round-trip through the parser");
+  }
+
+  void XlsxLimits() {
+      FileIngest::XlsxWriter writer("Logs: 2024/Q1 [export] with a very long name");
+      std::string longText(FileIngest::XlsxWriter::kMaxCellLength + 10, 'x');
+      longText.replace(FileIngest::XlsxWriter::kMaxCellLength - 1, 2, "\xC3\xA9");
+      std::vector<FileIngest::TableCell> cells = { FileIngest::TableCell::Text(longText) };
+      writer.WriteRow(cells);
+      writer.Finish();
+      Check(writer.Output().size() > 0 && writer.Rows() == 1, "an overlong cell is written");
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  bool keep = argc > 2;
+  std::filesystem::path directory = keep ? argv[2] : std::filesystem::temp_directory_path() / "export-benchmark";
+  std::filesystem::create_directories(directory);
+
+  CsvRoundTrip();
+  XlsxLimits();
+  {
+      FileIngest::CsvWriter writer;
+      Export(writer, rows, directory / "export.csv", "csv");
+  }
+  {
+      FileIngest::XlsxWriter writer("Activity");
+      Export(writer, std::min<size_t>(rows, FileIngest::XlsxWriter::kMaxRows - 1), directory / "export.xlsx", "xlsx");
+  }
+  if (!keep) {
+      std::filesystem::remove_all(directory);
+  }
+
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
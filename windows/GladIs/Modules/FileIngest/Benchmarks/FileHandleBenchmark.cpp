@@ -0,0 +1,181 @@
+// Memory and latency of the handle API behind openFile/readFileRange/closeFile. Opens thousands of
+// handles on one large file, reads ranges from all of them on several threads and checks that the
+// resident set grows with the number of handles, not with the file size. Exits non-zero on failure.
+// Linux only, it reads its RSS from /proc:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. FileHandleBenchmark.cpp -o file-handle-benchmark
+//   ./file-handle-benchmark [handles] [file megabytes]
+
+#include "FileHandles.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  // Resident set in bytes, from /proc/self/statm
+  size_t ResidentBytes() {
+      std::ifstream statm("/proc/self/statm");
+      size_t pages = 0;
+      size_t resident = 0;
+      statm >> pages >> resident;
+      return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  }
+
+  // Byte at `offset` of the test file, so any range can be checked without keeping the file around
+  uint8_t Expected(uint64_t offset) {
+      return static_cast<uint8_t>((offset * 2654435761u) >> 13);
+  }
+
+  void Check(bool condition, const char* message) {
+      if (!condition) {
+          std::fprintf(stderr, "FAILED: %s\n", message);
+          std::exit(1);
+      }
+  }
+
+  template <typename Body>
+  double Seconds(Body&& body) {
+      auto start = std::chrono::steady_clock::now();
+      body();
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t handleCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4096;
+  size_t megabytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+  const size_t rangeLength = 64 * 1024;
+
+  // Every handle is a descriptor, lift the soft limit as far as allowed
+  rlimit limit{};
+  ::getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  ::setrlimit(RLIMIT_NOFILE, &limit);
+  handleCount = std::min<size_t>(handleCount, limit.rlim_cur - 64);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "file-handle-benchmark.bin";
+  uint64_t fileSize = uint64_t(megabytes) * 1024 * 1024;
+  {
+      std::ofstream out(path, std::ios::binary);
+      std::vector<uint8_t> block(1 << 20);
+      for (uint64_t offset = 0; offset < fileSize; offset += block.size()) {
+          for (size_t i = 0; i < block.size(); i++) {
+              block[i] = Expected(offset + i);
+          }
+          out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+      }
+  }
+
+  FileIngest::FileHandleTable table(handleCount, std::chrono::minutes(10));
+  std::vector<uint32_t> handles(handleCount);
+  size_t baseline = ResidentBytes();
+
+  double openSeconds = Seconds([&]() {
+      for (size_t i = 0; i < handleCount; i++) {
+          handles[i] = table.Open(std::make_unique<FileIngest::NativeFileSource>(path), "file.bin", "application/octet-stream").handle;
+      }
+  });
+  Check(table.Count() == handleCount, "every handle is open");
+
+  bool refused = false;
+  try {
+      table.Open(std::make_unique<FileIngest::NativeFileSource>(path), "file.bin", "application/octet-stream");
+  } catch (const FileIngest::HandleLimitReached&) {
+      refused = true;
+  }
+  Check(refused, "opening past the limit is refused");
+
+  // Random ranges across every handle from several threads, each verified byte for byte
+  size_t threadCount = std::max(2u, std::thread::hardware_concurrency());
+  size_t readsPerThread = std::max<size_t>(handleCount, 2000);
+  std::atomic<bool> mismatch{ false };
+  double readSeconds = Seconds([&]() {
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < threadCount; t++) {
+          threads.emplace_back([&, t]() {
+              std::mt19937_64 engine(t + 1);
+              std::vector<uint8_t> range;
+              for (size_t i = 0; i < readsPerThread; i++) {
+                  uint32_t handle = handles[engine() % handleCount];
+                  uint64_t offset = engine() % fileSize;
+                  table.ReadRange(handle, offset, rangeLength, rangeLength, range);
+                  if (range.size() != std::min<uint64_t>(rangeLength, fileSize - offset)) {
+                      mismatch = true;
+                  }
+                  for (size_t j = 0; j < range.size(); j += 997) {
+                      if (range[j] != Expected(offset + j)) {
+                          mismatch = true;
+                      }
+                  }
+              }
+          });
+      }
+      for (auto& thread : threads) {
+          thread.join();
+      }
+  });
+  size_t peakDuringReads = ResidentBytes();
+  Check(!mismatch, "ranges hold the bytes at their offset");
+
+  // Reading at the very end is short, past it is an error, and oversized ranges are refused
+  std::vector<uint8_t> range;
+  table.ReadRange(handles[0], fileSize - 10, rangeLength, rangeLength, range);
+  Check(range.size() == 10, "a range at the end of the file is clipped");
+  table.ReadRange(handles[0], fileSize, rangeLength, rangeLength, range);
+  Check(range.empty(), "a range at the end of the file is empty");
+  bool rejected = false;
+  try {
+      table.ReadRange(handles[0], fileSize + 1, 1, rangeLength, range);
+  } catch (const FileIngest::InvalidRange&) {
+      rejected = true;
+  }
+  Check(rejected, "a range past the end of the file is refused");
+  rejected = false;
+  try {
+      table.ReadRange(handles[0], 0, rangeLength + 1, rangeLength, range);
+  } catch (const FileIngest::InvalidRange&) {
+      rejected = true;
+  }
+  Check(rejected, "an oversized range is refused");
+
+  double closeSeconds = Seconds([&]() {
+      for (uint32_t handle : handles) {
+          table.Close(handle);
+      }
+  });
+  Check(table.Count() == 0, "every handle is closed");
+  Check(!table.Close(handles[0]), "closing twice reports the handle as unknown");
+  bool invalid = false;
+  try {
+      table.ReadRange(handles[0], 0, 1, rangeLength, range);
+  } catch (const FileIngest::InvalidHandle&) {
+      invalid = true;
+  }
+  Check(invalid, "a closed handle cannot be read");
+
+  // Whole-file loads of the same handles would need handles x file size; the table needs a few
+  // hundred bytes per handle plus one range buffer per reading thread
+  size_t growth = peakDuringReads > baseline ? peakDuringReads - baseline : 0;
+  size_t budget = handleCount * 1024 + threadCount * rangeLength * 2 + 8 * 1024 * 1024;
+  std::printf("handles              %zu on a %zu MiB file\n", handleCount, megabytes);
+  std::printf("open                 %.1f us/handle\n", openSeconds * 1e6 / handleCount);
+  std::printf("readRange 64 KiB     %.1f us/read, %zu threads\n", readSeconds * 1e6 / readsPerThread, threadCount);
+  std::printf("close                %.1f us/handle\n", closeSeconds * 1e6 / handleCount);
+  std::printf("RSS growth           %.1f KiB total, %.0f bytes/handle (budget %.1f KiB)\n", growth / 1024.0, double(growth) / handleCount, budget / 1024.0);
+  Check(growth <= budget, "resident memory stays bounded with many open handles");
+
+  std::filesystem::remove(path);
+  std::printf("ok\n");
+  return 0;
+}
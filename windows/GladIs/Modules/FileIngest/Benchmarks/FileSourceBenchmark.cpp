@@ -0,0 +1,350 @@
+// Throughput of hashing, base64 encoding and CSV parsing a file read in place through
+// MappedFileSource, against the buffered path that copies each chunk into a buffer first, with
+// the file in the page cache (warm) and dropped from it (cold). Also checks that both paths
+// produce the same digest, chunks and rows, and that MappedFileSource serves the same bytes as
+// NativeFileSource. Exits non-zero when a check fails. Linux only, it drops the file's pages
+// with posix_fadvise and verifies the drop with mincore:
+//
+//   g++ -std=c++20 -O2 -I.. FileSourceBenchmark.cpp -o file-source-benchmark -pthread
+//   ./file-source-benchmark [directory] [megabytes] [rounds]
+
+#include "Crc32.h"
+#include "CsvParser.h"
+#include "RangeSource.h"
+#include "Sha256.h"
+#include "StreamEncoder.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  constexpr size_t kChunkSize = FileIngest::kDefaultChunkSize;
+
+  // What a workload made of the file, compared between the two paths
+  struct Outcome
+  {
+      FileIngest::Sha256Digest digest{};
+      // Of the base64 chunks, cheap enough not to hide the reads
+      uint32_t encodedCrc = 0;
+      uint64_t bytes = 0;
+      uint64_t rows = 0;
+      uint32_t chunks = 0;
+
+      bool operator==(Outcome const&) const = default;
+  };
+
+  enum class Workload
+  {
+      Hash,
+      Encode,
+      Parse,
+  };
+
+  constexpr const char* kWorkloadNames[] = { "sha256", "base64 chunks", "csv parse" };
+
+  // Consumes the file one range at a time, as each module path does
+  class Consumer
+  {
+  public:
+      explicit Consumer(Workload workload) : m_workload(workload), m_encoder(kChunkSize) {}
+
+      // Called with each range in order
+      void Consume(const uint8_t* data, size_t length) {
+          switch (m_workload) {
+          case Workload::Hash:
+              m_hasher.Update(data, length);
+              break;
+          case Workload::Encode:
+              m_encoder.Append(data, length, m_onChunk);
+              break;
+          case Workload::Parse:
+              m_parser.Feed(reinterpret_cast<const char*>(data), length, m_onRow);
+              break;
+          }
+          m_outcome.bytes += length;
+      }
+
+      // The buffered encode reads straight into the encoder's buffer, like the stream path does
+      FileIngest::ChunkedStreamEncoder& Encoder() noexcept {
+          return m_encoder;
+      }
+
+      void CountCommitted(size_t length) noexcept {
+          m_outcome.bytes += length;
+      }
+
+      std::function<void(FileIngest::EncodedChunk const&)>& OnChunk() noexcept {
+          return m_onChunk;
+      }
+
+      Outcome Finish() {
+          switch (m_workload) {
+          case Workload::Hash:
+              m_outcome.digest = m_hasher.Final();
+              break;
+          case Workload::Encode:
+              m_outcome.chunks = m_encoder.Finish(m_onChunk).chunkCount;
+              break;
+          case Workload::Parse:
+              m_parser.Finish(m_onRow);
+              break;
+          }
+          return m_outcome;
+      }
+
+  private:
+      Workload m_workload;
+      FileIngest::Sha256 m_hasher;
+      FileIngest::ChunkedStreamEncoder m_encoder;
+      FileIngest::CsvParser m_parser;
+      Outcome m_outcome;
+      std::function<void(FileIngest::EncodedChunk const&)> m_onChunk = [this](FileIngest::EncodedChunk const& chunk) {
+          m_outcome.encodedCrc = FileIngest::Crc32(m_outcome.encodedCrc, reinterpret_cast<const uint8_t*>(chunk.data.data()), chunk.data.size());
+      };
+      std::function<void(std::vector<std::string>&)> m_onRow = [this](std::vector<std::string>&) { m_outcome.rows++; };
+  };
+
+  Outcome ReadBuffered(std::filesystem::path const& path, Workload workload) {
+      FileIngest::NativeFileSource source(path);
+      Consumer consumer(workload);
+      if (workload == Workload::Encode) {
+          FileIngest::ChunkedStreamEncoder& encoder = consumer.Encoder();
+          for (uint64_t offset = 0;;) {
+              size_t read = source.ReadAt(offset, encoder.WritePointer(), encoder.WritableBytes());
+              if (read == 0) {
+                  break;
+              }
+              encoder.Commit(read, consumer.OnChunk());
+              consumer.CountCommitted(read);
+              offset += read;
+          }
+          return consumer.Finish();
+      }
+      std::vector<uint8_t> buffer(kChunkSize);
+      for (uint64_t offset = 0;;) {
+          size_t read = source.ReadAt(offset, buffer.data(), buffer.size());
+          if (read == 0) {
+              break;
+          }
+          consumer.Consume(buffer.data(), read);
+          offset += read;
+      }
+      return consumer.Finish();
+  }
+
+  Outcome ReadMapped(std::filesystem::path const& path, Workload workload) {
+      FileIngest::MappedFileSource source(path);
+      Consumer consumer(workload);
+      for (uint64_t offset = 0; offset < source.Size(); offset += kChunkSize) {
+          size_t length = static_cast<size_t>(std::min<uint64_t>(source.Size() - offset, kChunkSize));
+          source.Prefetch(offset + length, kChunkSize);
+          consumer.Consume(source.Data() + offset, length);
+      }
+      return consumer.Finish();
+  }
+
+  // Writes back and drops the file's cached pages, then returns the fraction still resident
+  double DropFromCache(std::filesystem::path const& path) {
+      int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (file < 0) {
+          return 1;
+      }
+      ::fdatasync(file);
+      ::posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+      size_t size = static_cast<size_t>(std::filesystem::file_size(path));
+      double resident = 1;
+      void* address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+      if (address != MAP_FAILED) {
+          size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+          std::vector<unsigned char> pages((size + pageSize - 1) / pageSize);
+          if (::mincore(address, size, pages.data()) == 0) {
+              resident = static_cast<double>(std::count_if(pages.begin(), pages.end(), [](unsigned char page) { return (page & 1) != 0; })) / static_cast<double>(pages.size());
+          }
+          ::munmap(address, size);
+      }
+      ::close(file);
+      return resident;
+  }
+
+  // Semicolon-separated rows with a quoted field now and then, as exported forms are
+  void WriteCsv(std::filesystem::path const& path, uint64_t bytes) {
+      std::ofstream out(path, std::ios::binary);
+      std::mt19937_64 engine(7);
+      std::string row;
+      for (uint64_t written = 0, line = 0; written < bytes; line++) {
+          row = std::to_string(line) + ";Document " + std::to_string(engine() % 100000) + ";";
+          row += engine() % 8 == 0 ? "\"Révision; \"\"urgente\"\"\"" : "Procédure";
+          row += ";" + std::to_string(engine() % 1000000) + "\n";
+          out.write(row.data(), static_cast<std::streamsize>(row.size()));
+          written += row.size();
+      }
+  }
+
+  void SourceChecks(std::filesystem::path const& directory) {
+      std::filesystem::path path = directory / "source.bin";
+      {
+          std::vector<uint8_t> bytes(3 * 1024 * 1024 + 17);
+          std::mt19937_64 engine(3);
+          for (uint8_t& byte : bytes) {
+              byte = static_cast<uint8_t>(engine());
+          }
+          std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+      }
+      FileIngest::NativeFileSource native(path);
+      FileIngest::MappedFileSource mapped(path);
+      Check(mapped.Size() == native.Size() && mapped.Data() != nullptr, "a mapped file has the file's size");
+      std::mt19937_64 engine(11);
+      bool same = true;
+      std::vector<uint8_t> a(300000);
+      std::vector<uint8_t> b(300000);
+      for (int i = 0; i < 200; i++) {
+          uint64_t offset = engine() % (native.Size() + 1000);
+          size_t length = static_cast<size_t>(engine() % a.size());
+          size_t readNative = native.ReadAt(offset, a.data(), length);
+          size_t readMapped = mapped.ReadAt(offset, b.data(), length);
+          same = same && readNative == readMapped && std::memcmp(a.data(), b.data(), readNative) == 0;
+          same = same && (readMapped == 0 || std::memcmp(mapped.Data() + offset, b.data(), readMapped) == 0);
+      }
+      Check(same, "mapped ranges match positional reads, up to and past the end");
+
+      int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      FileIngest::MappedFileSource adopted(file);
+      Check(adopted.Size() == native.Size() && std::memcmp(adopted.Data(), mapped.Data(), 4096) == 0, "an open descriptor is mapped");
+
+      std::filesystem::path empty = directory / "empty.bin";
+      std::ofstream(empty, std::ios::binary).close();
+      FileIngest::MappedFileSource none(empty);
+      Check(none.Size() == 0 && none.Data() == nullptr && none.ReadAt(0, a.data(), 10) == 0, "an empty file maps to nothing");
+
+      bool missing = false;
+      try {
+          FileIngest::MappedFileSource absent(directory / "absent.bin");
+      } catch (FileIngest::MappedFileError const&) {
+          missing = true;
+      }
+      Check(missing, "a missing file throws MappedFileError");
+      bool invalid = false;
+      try {
+          FileIngest::MappedFileSource closed(-1);
+      } catch (FileIngest::MappedFileError const&) {
+          invalid = true;
+      }
+      Check(invalid, "an invalid descriptor throws MappedFileError");
+  }
+
+  // Appending ranges of any size gives the chunks that committing reads would
+  void AppendChecks() {
+      std::vector<uint8_t> data(5 * kChunkSize + 1234);
+      std::mt19937_64 engine(5);
+      for (uint8_t& byte : data) {
+          byte = static_cast<uint8_t>(engine());
+      }
+      auto encode = [&data](bool append, std::vector<size_t> const& slices) {
+          std::vector<std::pair<uint64_t, std::string>> chunks;
+          auto onChunk = [&chunks](FileIngest::EncodedChunk const& chunk) { chunks.emplace_back(chunk.offset, chunk.data); };
+          FileIngest::ChunkedStreamEncoder encoder(kChunkSize);
+          size_t offset = 0;
+          for (size_t i = 0; offset < data.size(); i++) {
+              size_t length = std::min(slices[i % slices.size()], data.size() - offset);
+              if (append) {
+                  encoder.Append(data.data() + offset, length, onChunk);
+              } else {
+                  for (size_t done = 0; done < length;) {
+                      size_t take = std::min(length - done, encoder.WritableBytes());
+                      std::memcpy(encoder.WritePointer(), data.data() + offset + done, take);
+                      encoder.Commit(take, onChunk);
+                      done += take;
+                  }
+              }
+              offset += length;
+          }
+          encoder.Finish(onChunk);
+          return chunks;
+      };
+      auto expected = encode(false, { kChunkSize });
+      Check(encode(true, { kChunkSize }) == expected, "appending whole chunks matches committing them");
+      Check(encode(true, { 1, 3, kChunkSize - 1, 2 * kChunkSize + 5 }) == expected, "appending uneven ranges matches committing them");
+      Check(encode(true, { data.size() }) == expected, "appending everything at once matches committing it");
+  }
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path directory = argc > 1 ? argv[1] : std::filesystem::temp_directory_path() / "file-source-benchmark";
+  uint64_t megabytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+  int rounds = argc > 3 ? std::atoi(argv[3]) : 3;
+  std::filesystem::create_directories(directory);
+
+  SourceChecks(directory);
+  AppendChecks();
+
+  std::filesystem::path path = directory / "forms.csv";
+  WriteCsv(path, std::max<uint64_t>(megabytes, 1) * 1024 * 1024);
+  double mib = static_cast<double>(std::filesystem::file_size(path)) / (1024 * 1024);
+  bool canDrop = DropFromCache(path) < 0.05;
+  if (!canDrop) {
+      std::printf("the page cache cannot be dropped here, cold reads are skipped\n");
+  }
+
+  std::printf("%-16s %-6s %14s %14s %9s\n", "workload", "cache", "buffered MiB/s", "mapped MiB/s", "speedup");
+  for (int w = 0; w < 3; w++) {
+      Workload workload = static_cast<Workload>(w);
+      for (bool cold : { false, true }) {
+          if (cold && !canDrop) {
+              continue;
+          }
+          // Best of the rounds for each path, alternating so both see the same machine state
+          double buffered = 1e30;
+          double mapped = 1e30;
+          Outcome bufferedOutcome;
+          Outcome mappedOutcome;
+          for (int round = 0; round < std::max(rounds, 1); round++) {
+              for (bool useMapping : { false, true }) {
+                  if (cold) {
+                      DropFromCache(path);
+                  } else {
+                      ReadMapped(path, Workload::Hash);
+                  }
+                  auto start = std::chrono::steady_clock::now();
+                  Outcome outcome = useMapping ? ReadMapped(path, workload) : ReadBuffered(path, workload);
+                  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                  (useMapping ? mapped : buffered) = std::min(useMapping ? mapped : buffered, seconds);
+                  (useMapping ? mappedOutcome : bufferedOutcome) = outcome;
+              }
+          }
+          Check(mappedOutcome == bufferedOutcome, "both paths make the same output of the file");
+          Check(mappedOutcome.bytes == std::filesystem::file_size(path), "the whole file is consumed");
+          std::printf("%-16s %-6s %14.0f %14.0f %8.2fx\n", kWorkloadNames[w], cold ? "cold" : "warm", mib / buffered, mib / mapped, buffered / mapped);
+      }
+  }
+
+  std::filesystem::remove_all(directory);
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,123 @@
+// The size and content check every picked file goes through before it is read, over a corpus
+// of the files users actually pick by mistake: truncated headers, an MP4 or a zip renamed to a
+// document type, a UTF-16 export, an empty file, and the valid variants that must still pass.
+// Exits non-zero when a file is let through or refused with the wrong message:
+//
+//   g++ -std=c++20 -O2 -I.. FileTypesCheck.cpp -o file-types-check
+//   ./file-types-check
+
+#include "FileTypes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace
+{
+  using namespace std::string_literals;
+
+  int failures = 0;
+  int cases = 0;
+
+  // What CheckFile gives for `bytes` picked as `type`: the MIME type, or the rejection message
+  std::string Outcome(std::string_view type, std::string const& bytes, uint64_t size) {
+      const FileIngest::FileTypeDescriptor* descriptor = FileIngest::FindFileType(type);
+      // The module sniffs at most kSniffLength bytes, however long the file
+      size_t headLength = std::min(bytes.size(), FileIngest::kSniffLength);
+      try {
+          return std::string(FileIngest::CheckFile(*descriptor, size, reinterpret_cast<const uint8_t*>(bytes.data()), headLength));
+      } catch (const FileIngest::FileRejected& e) {
+          return e.what();
+      }
+  }
+
+  void Expect(const char* name, std::string_view type, std::string const& bytes, std::string const& expected, uint64_t size = 0) {
+      cases++;
+      std::string outcome = Outcome(type, bytes, size != 0 ? size : bytes.size());
+      if (outcome != expected) {
+          std::printf("FAILED: %s as %s: got \"%s\", expected \"%s\"\n", name, std::string(type).c_str(), outcome.c_str(), expected.c_str());
+          failures++;
+      }
+  }
+
+  std::string Padded(std::string head, size_t length, char fill) {
+      head.resize(length, fill);
+      return head;
+  }
+
+  // UTF-16LE with its BOM, as Excel's "Unicode text" and some Windows tools write it
+  std::string Utf16(std::string_view text) {
+      std::string bytes = "\xFF\xFE";
+      for (char c : text) {
+          bytes += c;
+          bytes += '\0';
+      }
+      return bytes;
+  }
+}
+
+int main() {
+  const std::string mismatch = "File content does not match its type";
+  const std::string empty = "File is empty";
+  const std::string tooLarge = "File is too large";
+
+  const std::string pdf = "%PDF-1.7\n%\xE2\xE3\xCF\xD3\n1 0 obj\n<< /Type /Catalog >>\nendobj\n";
+  const std::string png = "\x89PNG\r\n\x1A\n\0\0\0\rIHDR"s;
+  const std::string jpeg = "\xFF\xD8\xFF\xE0\0\x10JFIF\0"s;
+  // An ISO Base Media header: size, 'ftyp', brand, and the start of a moov box
+  const std::string mp4 = "\0\0\0\x20" "ftypisom\0\0\x02\0isomiso2avc1mp41\0\0\x08\0moov"s;
+  // A zip local file header, e.g. an .xlsx export renamed to .csv
+  const std::string zip = "PK\x03\x04\x14\0\x06\0\x08\0\0\0!\0"s + "[Content_Types].xml";
+
+  // Valid files
+  Expect("a PDF", "pdf", pdf, "application/pdf");
+  Expect("a PDF after junk within the first kilobyte", "pdf", Padded("\r\n", 1019, ' ') + pdf, "application/pdf");
+  Expect("a PNG", "image", png, "image/png");
+  Expect("a JPEG", "image", jpeg, "image/jpeg");
+  Expect("a PNG with a .jpg extension", "image", png, "image/png");
+  Expect("a semicolon CSV", "csv", "id;name\r\n1;Dupont\r\n", "text/csv");
+  Expect("a CSV with a UTF-8 BOM", "csv", "\xEF\xBB\xBF" "id,nom\n1,\xC3\xA9t\xC3\xA9\n", "text/csv");
+  Expect("a Latin-1 CSV", "csv", "id;nom\n1;\xE9t\xE9\n", "text/csv");
+  Expect("a one-byte CSV", "csv", "a", "text/csv");
+
+  // Truncated headers
+  Expect("a PDF cut inside its header", "pdf", "%PDF", mismatch);
+  Expect("a PDF cut to one byte", "pdf", "%", mismatch);
+  Expect("a PNG cut inside its signature", "image", png.substr(0, 6), mismatch);
+  Expect("a JPEG cut inside its marker", "image", jpeg.substr(0, 2), mismatch);
+  Expect("a PDF header past the first kilobyte", "pdf", Padded("", 1020, ' ') + pdf, mismatch);
+
+  // Other formats renamed to an accepted extension
+  Expect("an MP4 renamed to .pdf", "pdf", Padded(mp4, 4096, '\x01'), mismatch);
+  Expect("an MP4 renamed to .jpg", "image", mp4, mismatch);
+  Expect("an MP4 renamed to .csv", "csv", mp4, mismatch);
+  Expect("a zip renamed to .csv", "csv", zip, mismatch);
+  Expect("a zip renamed to .pdf", "pdf", zip, mismatch);
+  Expect("a PDF renamed to .png", "image", pdf, mismatch);
+  Expect("a JPEG renamed to .pdf", "pdf", jpeg, mismatch);
+
+  // The parser reads 8-bit text only, a UTF-16 export would come out as a grid of NULs
+  Expect("a UTF-16 CSV", "csv", Utf16("id;name\r\n1;Dupont\r\n"), mismatch);
+  Expect("a UTF-16 CSV without a BOM", "csv", Utf16("id;name\r\n").substr(2), mismatch);
+
+  // Sizes
+  for (std::string_view type : { "pdf", "image", "csv" }) {
+      Expect("an empty file", type, "", empty);
+      const FileIngest::FileTypeDescriptor* descriptor = FileIngest::FindFileType(type);
+      std::string const& valid = type == "pdf" ? pdf : type == "image" ? png : std::string("a;b\n");
+      Expect("a file at the size limit", type, valid, type == "pdf" ? "application/pdf" : type == "image" ? "image/png" : "text/csv", descriptor->maxBytes);
+      Expect("a file one byte over the size limit", type, valid, tooLarge, descriptor->maxBytes + 1);
+  }
+  // The size is checked before the content, so an oversized file is refused without a sniff
+  Expect("an oversized MP4 renamed to .pdf", "pdf", mp4, tooLarge, 200ull * 1024 * 1024);
+
+  std::printf("%-28s %8d files\n", "checked", cases);
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
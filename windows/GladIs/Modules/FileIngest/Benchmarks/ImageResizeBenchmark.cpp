@@ -0,0 +1,239 @@
+// Downscale latency of the image stage on camera-sized sources, per kernel, and how many raw pixel
+// bytes are left for the encoder afterwards; the encoded JPEG or PNG is smaller still and its size
+// is not measured here, since decoding and encoding go through the platform codecs in the module.
+// Before timing, the kernels are checked against each other on random sizes and row strides, along
+// with the axis weights and the edge pixels. Exits non-zero when a check fails:
+//
+//   g++ -std=c++20 -O2 -I.. ImageResizeBenchmark.cpp -o image-resize-benchmark
+//   ./image-resize-benchmark [max side] [iterations]
+
+#include "ImageResize.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+  using FileIngest::ImageSize;
+  namespace ImageResize = FileIngest::ImageResize;
+
+  // Smooth gradients with noise, closer to a photo than white noise
+  std::vector<uint8_t> SyntheticPhoto(ImageSize size) {
+      std::vector<uint8_t> pixels(size_t(size.width) * size.height * ImageResize::kChannels);
+      std::mt19937 engine(11);
+      for (uint32_t y = 0; y < size.height; y++) {
+          for (uint32_t x = 0; x < size.width; x++) {
+              uint8_t* pixel = pixels.data() + (size_t(y) * size.width + x) * ImageResize::kChannels;
+              uint32_t noise = engine() & 0x0F;
+              pixel[0] = static_cast<uint8_t>((x * 255 / size.width + noise) & 0xFF);
+              pixel[1] = static_cast<uint8_t>((y * 255 / size.height + noise) & 0xFF);
+              pixel[2] = static_cast<uint8_t>(((x + y) & 0xFF) ^ noise);
+              pixel[3] = 255;
+          }
+      }
+      return pixels;
+  }
+
+  const char* KernelName(ImageResize::Kernel kernel) {
+      return kernel == ImageResize::Kernel::Sse41 ? "sse4.1" : "scalar";
+  }
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          // Only the first few are printed, a broken kernel would otherwise flood the log
+          if (failures < 20) {
+              std::printf("FAILED: %s\n", what);
+          }
+          failures++;
+      }
+  }
+
+  // Rows of `stride` bytes whose padding past the pixels is filled with a marker, so a write past
+  // the end of a row shows up
+  struct Image
+  {
+      ImageSize size;
+      size_t stride;
+      std::vector<uint8_t> bytes;
+
+      Image(ImageSize size, size_t padding, uint8_t fill) : size(size), stride(size_t(size.width) * ImageResize::kChannels + padding), bytes(stride * size.height, fill) {}
+
+      uint8_t* Pixel(uint32_t x, uint32_t y) {
+          return bytes.data() + y * stride + size_t(x) * ImageResize::kChannels;
+      }
+  };
+
+  constexpr uint8_t kPaddingMarker = 0xA5;
+
+  bool PaddingIntact(Image const& image) {
+      size_t rowLength = size_t(image.size.width) * ImageResize::kChannels;
+      for (uint32_t y = 0; y < image.size.height; y++) {
+          for (size_t i = rowLength; i < image.stride; i++) {
+              if (image.bytes[y * image.stride + i] != kPaddingMarker) {
+                  return false;
+              }
+          }
+      }
+      return true;
+  }
+
+  Image Resized(Image const& source, ImageSize target, size_t padding, ImageResize::Kernel kernel) {
+      Image out(target, padding, kPaddingMarker);
+      ImageResize::Resize(source.bytes.data(), source.size, source.stride, out.bytes.data(), target, out.stride, kernel);
+      return out;
+  }
+
+  // Every sample's span lies within the source, spans follow each other without gaps, and the
+  // weights of a sample sum to one, so no edge pixel is dropped or counted twice
+  void CheckAxisWeights(std::mt19937& engine) {
+      for (int i = 0; i < 500; i++) {
+          uint32_t sourceLength = 1 + engine() % 5000;
+          uint32_t targetLength = 1 + engine() % sourceLength;
+          auto axis = ImageResize::detail::ComputeAxisWeights(sourceLength, targetLength);
+          bool valid = axis.first.size() == targetLength && axis.first.front() == 0;
+          for (uint32_t t = 0; t < targetLength && valid; t++) {
+              double sum = 0;
+              for (uint32_t k = 0; k < axis.count[t]; k++) {
+                  sum += axis.weights[axis.offset[t] + k];
+              }
+              valid = axis.count[t] != 0 && axis.first[t] + axis.count[t] <= sourceLength && std::abs(sum - 1.0) < 1e-5;
+              if (t + 1 < targetLength) {
+                  uint32_t end = axis.first[t] + axis.count[t];
+                  valid = valid && (axis.first[t + 1] == end || axis.first[t + 1] + 1 == end);
+              }
+          }
+          valid = valid && axis.first.back() + axis.count.back() == sourceLength;
+          Check(valid, "the weights of every sample cover the source and sum to one");
+      }
+  }
+
+  void CheckEdges(std::vector<ImageResize::Kernel> const& kernels) {
+      for (ImageResize::Kernel kernel : kernels) {
+          // A flat colour stays that colour to the last row and column
+          Image flat({ 203, 157 }, 12, kPaddingMarker);
+          for (uint32_t y = 0; y < flat.size.height; y++) {
+              for (uint32_t x = 0; x < flat.size.width; x++) {
+                  uint8_t* pixel = flat.Pixel(x, y);
+                  pixel[0] = 17, pixel[1] = 128, pixel[2] = 250, pixel[3] = 255;
+              }
+          }
+          Image out = Resized(flat, { 61, 29 }, 4, kernel);
+          bool uniform = true;
+          for (uint32_t y = 0; y < out.size.height; y++) {
+              for (uint32_t x = 0; x < out.size.width; x++) {
+                  uint8_t* pixel = out.Pixel(x, y);
+                  uniform = uniform && pixel[0] == 17 && pixel[1] == 128 && pixel[2] == 250 && pixel[3] == 255;
+              }
+          }
+          Check(uniform, "a flat colour is kept up to the edges");
+          Check(PaddingIntact(out), "nothing is written past the end of a row");
+
+          // A white border one pixel wide on a black 400x200 image, scaled by four: each border
+          // pixel covers a quarter of its output pixel, so the edges are 255 / 4 rounded and the
+          // corners a quarter of that plus the other edge
+          Image border({ 400, 200 }, 0, 0);
+          for (uint32_t y = 0; y < border.size.height; y++) {
+              for (uint32_t x = 0; x < border.size.width; x++) {
+                  bool edge = x == 0 || y == 0 || x + 1 == border.size.width || y + 1 == border.size.height;
+                  std::fill_n(border.Pixel(x, y), ImageResize::kChannels, edge ? 255 : 0);
+              }
+          }
+          out = Resized(border, { 100, 50 }, 0, kernel);
+          bool edges = true;
+          for (uint32_t y = 0; y < out.size.height; y++) {
+              for (uint32_t x = 0; x < out.size.width; x++) {
+                  int sides = (x == 0 || x + 1 == out.size.width) + (y == 0 || y + 1 == out.size.height);
+                  // 4 of 16 source pixels on one edge, 7 of 16 in a corner
+                  uint8_t expected = sides == 0 ? 0 : sides == 1 ? 64 : 112;
+                  edges = edges && out.Pixel(x, y)[0] == expected && out.Pixel(x, y)[3] == expected;
+              }
+          }
+          Check(edges, "the first and last rows and columns are weighted like the others");
+
+          // Same size is a copy, through a wider source stride
+          Image copy = Resized(flat, flat.size, 0, kernel);
+          bool same = true;
+          for (uint32_t y = 0; y < flat.size.height; y++) {
+              same = same && std::equal(copy.Pixel(0, y), copy.Pixel(0, y) + copy.size.width * ImageResize::kChannels, flat.Pixel(0, y));
+          }
+          Check(same, "resizing to the same size copies the pixels");
+      }
+  }
+
+  // Both kernels round half to even and add in the same order, so they must agree to the byte
+  void CheckKernelsAgree(std::mt19937& engine, std::vector<ImageResize::Kernel> const& kernels) {
+      for (int i = 0; i < 300; i++) {
+          ImageSize sourceSize{ 1 + static_cast<uint32_t>(engine() % 300), 1 + static_cast<uint32_t>(engine() % 300) };
+          ImageSize target{ 1 + static_cast<uint32_t>(engine() % sourceSize.width), 1 + static_cast<uint32_t>(engine() % sourceSize.height) };
+          Image source(sourceSize, engine() % 3 * 4 + engine() % 4, kPaddingMarker);
+          for (uint32_t y = 0; y < sourceSize.height; y++) {
+              for (uint32_t x = 0; x < sourceSize.width; x++) {
+                  uint8_t* pixel = source.Pixel(x, y);
+                  for (size_t c = 0; c < ImageResize::kChannels; c++) {
+                      pixel[c] = static_cast<uint8_t>(engine());
+                  }
+              }
+          }
+          size_t padding = engine() % 3 == 0 ? 0 : engine() % 64;
+          Image reference = Resized(source, target, padding, ImageResize::Kernel::Scalar);
+          Check(PaddingIntact(reference), "the scalar kernel writes nothing past the end of a row");
+          for (ImageResize::Kernel kernel : kernels) {
+              Image out = Resized(source, target, padding, kernel);
+              Check(out.bytes == reference.bytes, "every kernel gives the scalar kernel's output");
+          }
+      }
+  }
+}
+
+int main(int argc, char** argv) {
+  uint32_t maxSide = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 512;
+  size_t iterations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+
+  // 12 MP phone photo, 24 MP camera, and a portrait to exercise the height bound
+  const ImageSize sources[] = { { 4032, 3024 }, { 6000, 4000 }, { 3024, 4032 } };
+  std::vector<ImageResize::Kernel> kernels = { ImageResize::Kernel::Scalar };
+  if (ImageResize::ActiveKernel() != ImageResize::Kernel::Scalar) {
+      kernels.push_back(ImageResize::ActiveKernel());
+  }
+
+  std::mt19937 engine(29);
+  CheckAxisWeights(engine);
+  CheckEdges(kernels);
+  CheckKernelsAgree(engine, kernels);
+
+  // Raw pixel bytes before and after the resize, not the size of the encoded file
+  std::printf("%-11s %-10s %-7s %9s %10s %12s %9s\n", "source", "target", "kernel", "ms", "MP/s", "raw bytes", "raw ratio");
+  for (ImageSize source : sources) {
+      std::vector<uint8_t> pixels = SyntheticPhoto(source);
+      ImageSize target = ImageResize::FitWithin(source, maxSide, maxSide);
+      std::vector<uint8_t> out(size_t(target.width) * target.height * ImageResize::kChannels);
+      for (ImageResize::Kernel kernel : kernels) {
+          double best = 1e30;
+          for (size_t i = 0; i < iterations; i++) {
+              auto start = std::chrono::steady_clock::now();
+              ImageResize::Resize(pixels.data(), source, size_t(source.width) * ImageResize::kChannels, out.data(), target, size_t(target.width) * ImageResize::kChannels, kernel);
+              best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+          }
+          char sourceName[32];
+          char targetName[32];
+          std::snprintf(sourceName, sizeof(sourceName), "%ux%u", source.width, source.height);
+          std::snprintf(targetName, sizeof(targetName), "%ux%u", target.width, target.height);
+          double megapixels = double(source.width) * source.height / 1e6;
+          std::printf("%-11s %-10s %-7s %9.2f %10.1f %12zu %8.1fx\n", sourceName, targetName, KernelName(kernel), best * 1e3, megapixels / best, out.size(), double(pixels.size()) / out.size());
+      }
+  }
+
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
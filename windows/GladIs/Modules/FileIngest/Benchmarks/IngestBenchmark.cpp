@@ -0,0 +1,348 @@
+// Read, base64 encode, CSV parse and SHA-256 throughput of the file-ingest core on files from 1 KiB
+// to 2 GiB, with the peak resident set of every run. Files are read the way the module streams
+// them, one kDefaultChunkSize chunk at a time, so every stage but Read includes the read. The
+// files are written once per run and stay in the page cache, this measures the CPU side only.
+// Each run also checks its output: every byte read, the encoded length, one CSV row per line,
+// and a resident set growth under kEncodePeakGrowth while encoding, whatever the file size.
+// The program exits non-zero when a check fails.
+//
+//   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build
+//   ./build/ingest-benchmark [--ingest_max_size=256M] [Google Benchmark flags]
+//
+// Sizes above --ingest_max_size (256M unless given, 2G at most) are skipped. Results go to JSON
+// with --benchmark_out=results.json; two runs compare with tools/compare.py from Google Benchmark:
+//
+//   compare.py benchmarks before.json after.json
+
+#include "Base64.h"
+#include "CpuFeatures.h"
+#include "CsvParser.h"
+#include "RangeSource.h"
+#include "Sha256.h"
+#include "StreamEncoder.h"
+
+#include <benchmark/benchmark.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  const uint64_t kFileSizes[] = { 1ull << 10, 64ull << 10, 1ull << 20, 16ull << 20, 256ull << 20, 2ull << 30 };
+
+  // The streaming encode holds one raw and one encoded chunk, about 1.8 MiB; the rest is slack for
+  // the allocator and the benchmark library. A stage that buffered the file would pass it at 16 MiB.
+  constexpr uint64_t kEncodePeakGrowth = 8ull << 20;
+
+  int failures = 0;
+
+  // Marks the run as failed in the report and the exit status
+  void Check(benchmark::State& state, bool condition, const char* what) {
+      if (!condition) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          state.SkipWithError(what);
+          failures++;
+      }
+  }
+
+  // Parses "2G", "256M", "64K" or a plain byte count; 0 if malformed
+  uint64_t ParseSize(std::string_view text) {
+      char* end = nullptr;
+      std::string value(text);
+      uint64_t size = std::strtoull(value.c_str(), &end, 10);
+      switch (*end) {
+      case 'G': case 'g': size <<= 30; end++; break;
+      case 'M': case 'm': size <<= 20; end++; break;
+      case 'K': case 'k': size <<= 10; end++; break;
+      default: break;
+      }
+      return *end == '\0' ? size : 0;
+  }
+
+  std::string SizeName(uint64_t size) {
+      if (size >= (1ull << 30)) return std::to_string(size >> 30) + "GiB";
+      if (size >= (1ull << 20)) return std::to_string(size >> 20) + "MiB";
+      return std::to_string(size >> 10) + "KiB";
+  }
+
+  // Peak resident set since the last Reset(). Linux lets a process reset its high-water mark
+  // through clear_refs; where that fails the peak is the process-wide one from getrusage, and
+  // Reset() returns false since the growth of one run cannot be told apart.
+  struct PeakRss
+  {
+      static bool Reset() {
+          std::ofstream clear("/proc/self/clear_refs");
+          clear << "5";
+          clear.flush();
+          return clear.good() && Status("VmHWM:") != 0;
+      }
+
+      static uint64_t Bytes() {
+          if (uint64_t peak = Status("VmHWM:")) {
+              return peak;
+          }
+          rusage usage{};
+          ::getrusage(RUSAGE_SELF, &usage);
+          return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+      }
+
+      static uint64_t Current() {
+          return Status("VmRSS:");
+      }
+
+  private:
+      // A field of /proc/self/status in bytes, 0 when missing
+      static uint64_t Status(std::string_view field) {
+          std::ifstream status("/proc/self/status");
+          std::string line;
+          while (std::getline(status, line)) {
+              if (line.rfind(field, 0) == 0) {
+                  return std::strtoull(line.c_str() + field.size(), nullptr, 10) * 1024;
+              }
+          }
+          return 0;
+      }
+  };
+
+  // Semicolon CSV like the exports the app reads, with a quoted field on every fourth row
+  std::vector<char> CsvBlock() {
+      std::string text;
+      for (int row = 0; text.size() < (1u << 20); row++) {
+          char line[160];
+          int length = std::snprintf(line, sizeof(line), row % 4 == 0 ? "%d;\"Dupont; Martin\";2024-%02d-%02d;%d.%02d;\"note \"\"%d\"\"\"\n" : "%d;Client %d;2024-%02d-%02d;%d.%02d\n",
+              row, row % 4 == 0 ? row % 12 + 1 : row, row % 4 == 0 ? row % 28 + 1 : row % 12 + 1, row % 4 == 0 ? row * 7 % 10000 : row % 28 + 1, row % 4 == 0 ? row % 100 : row * 7 % 10000, row % 100);
+          text.append(line, static_cast<size_t>(length));
+      }
+      return std::vector<char>(text.begin(), text.end());
+  }
+
+  struct BenchmarkFile
+  {
+      std::filesystem::path path;
+      // Lines in the file, the last one possibly cut short, so the rows a parser must find
+      uint64_t lines = 0;
+  };
+
+  // One file per size, written on first use and removed at exit
+  class BenchmarkFiles
+  {
+  public:
+      ~BenchmarkFiles() {
+          for (auto const& [size, file] : m_files) {
+              std::error_code ignored;
+              std::filesystem::remove(file.path, ignored);
+          }
+      }
+
+      BenchmarkFile const& Get(uint64_t size) {
+          auto it = m_files.find(size);
+          if (it != m_files.end()) {
+              return it->second;
+          }
+          BenchmarkFile file{ std::filesystem::temp_directory_path() / ("ingest-benchmark-" + SizeName(size) + ".csv") };
+          static const std::vector<char> block = CsvBlock();
+          static const uint64_t blockLines = static_cast<uint64_t>(std::count(block.begin(), block.end(), '\n'));
+          std::ofstream out(file.path, std::ios::binary);
+          for (uint64_t written = 0; written < size;) {
+              size_t length = static_cast<size_t>(std::min<uint64_t>(block.size(), size - written));
+              out.write(block.data(), static_cast<std::streamsize>(length));
+              file.lines += length == block.size() ? blockLines : static_cast<uint64_t>(std::count(block.begin(), block.begin() + length, '\n')) + (block[length - 1] != '\n');
+              written += length;
+          }
+          return m_files.emplace(size, std::move(file)).first->second;
+      }
+
+  private:
+      std::map<uint64_t, BenchmarkFile> m_files;
+  };
+
+  BenchmarkFiles& Files() {
+      static BenchmarkFiles files;
+      return files;
+  }
+
+  // Reads the whole file in kDefaultChunkSize pieces and hands each one to `stage`
+  template <typename Stage>
+  void ReadChunks(FileIngest::RangeSource& source, std::vector<uint8_t>& buffer, Stage&& stage) {
+      for (uint64_t offset = 0;;) {
+          size_t read = source.ReadAt(offset, buffer.data(), buffer.size());
+          if (read == 0) {
+              break;
+          }
+          stage(buffer.data(), read);
+          offset += read;
+      }
+  }
+
+  // Returns how far the resident set grew over its level at the start, 0 when that is unknown
+  template <typename Body>
+  uint64_t RunFileBenchmark(benchmark::State& state, Body&& body) {
+      uint64_t size = static_cast<uint64_t>(state.range(0));
+      FileIngest::NativeFileSource source(Files().Get(size).path);
+      std::vector<uint8_t> buffer(FileIngest::kDefaultChunkSize);
+      bool measured = PeakRss::Reset();
+      uint64_t baseline = PeakRss::Current();
+      for (auto _ : state) {
+          body(source, buffer);
+      }
+      uint64_t peak = PeakRss::Bytes();
+      state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+      state.counters["peak_rss"] = benchmark::Counter(static_cast<double>(peak), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+      return measured && peak > baseline ? peak - baseline : 0;
+  }
+
+  void Read(benchmark::State& state) {
+      uint64_t total = 0;
+      RunFileBenchmark(state, [&](FileIngest::RangeSource& source, std::vector<uint8_t>& buffer) {
+          total = 0;
+          ReadChunks(source, buffer, [&](const uint8_t* data, size_t length) {
+              benchmark::DoNotOptimize(data);
+              total += length;
+          });
+      });
+      Check(state, total == static_cast<uint64_t>(state.range(0)), "every byte of the file is read");
+  }
+
+  // The streaming path of readFileDataStream: one raw and one encoded chunk alive at a time
+  void Encode(benchmark::State& state) {
+      uint64_t size = static_cast<uint64_t>(state.range(0));
+      FileIngest::StreamSummary summary;
+      uint64_t growth = RunFileBenchmark(state, [&](FileIngest::RangeSource& source, std::vector<uint8_t>&) {
+          uint64_t offset = 0;
+          summary = FileIngest::StreamEncode(
+              [&](uint8_t* out, size_t capacity) {
+                  size_t read = source.ReadAt(offset, out, capacity);
+                  offset += read;
+                  return read;
+              },
+              FileIngest::kDefaultChunkSize,
+              [](FileIngest::EncodedChunk const& chunk) {
+                  benchmark::DoNotOptimize(chunk.data.data());
+              });
+          benchmark::DoNotOptimize(summary);
+      });
+      Check(state, summary.totalBytes == size && summary.encodedLength == FileIngest::Base64::EncodedLength(size), "the whole file is encoded");
+      state.counters["rss_growth"] = benchmark::Counter(static_cast<double>(growth), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+      Check(state, growth <= kEncodePeakGrowth, "the resident set stays within kEncodePeakGrowth while encoding");
+  }
+
+  void Hash(benchmark::State& state) {
+      RunFileBenchmark(state, [](FileIngest::RangeSource& source, std::vector<uint8_t>& buffer) {
+          FileIngest::Sha256 hasher;
+          ReadChunks(source, buffer, [&](const uint8_t* data, size_t length) {
+              hasher.Update(data, length);
+          });
+          FileIngest::Sha256Digest digest = hasher.Final();
+          benchmark::DoNotOptimize(digest);
+      });
+  }
+
+  void ParseCsv(benchmark::State& state) {
+      uint64_t rows = 0;
+      RunFileBenchmark(state, [&](FileIngest::RangeSource& source, std::vector<uint8_t>& buffer) {
+          FileIngest::CsvParser parser;
+          auto onRow = [](std::vector<std::string> const& row) {
+              benchmark::DoNotOptimize(row.data());
+          };
+          ReadChunks(source, buffer, [&](const uint8_t* data, size_t length) {
+              parser.Feed(reinterpret_cast<const char*>(data), length, onRow);
+          });
+          parser.Finish(onRow);
+          rows = parser.RowCount();
+      });
+      state.counters["rows"] = static_cast<double>(rows);
+      Check(state, rows == Files().Get(static_cast<uint64_t>(state.range(0))).lines, "one row per line of the file");
+  }
+
+  // In-memory encode per kernel, to see the SIMD gain without the read around it
+  void EncodeKernel(benchmark::State& state, FileIngest::Base64::Kernel kernel) {
+      std::vector<uint8_t> input(static_cast<size_t>(state.range(0)));
+      for (size_t i = 0; i < input.size(); i++) {
+          input[i] = static_cast<uint8_t>(i * 2654435761u >> 13);
+      }
+      std::string output(FileIngest::Base64::EncodedLength(input.size()), '\0');
+      for (auto _ : state) {
+          benchmark::DoNotOptimize(FileIngest::Base64::Encode(input.data(), input.size(), output.data(), kernel));
+      }
+      state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+  }
+
+  const char* KernelName(FileIngest::Base64::Kernel kernel) {
+      switch (kernel) {
+      case FileIngest::Base64::Kernel::Avx2: return "avx2";
+      case FileIngest::Base64::Kernel::Ssse3: return "ssse3";
+      default: return "scalar";
+      }
+  }
+}
+
+int main(int argc, char** argv) {
+  // Our own flag is taken out before Google Benchmark sees the rest
+  uint64_t maxSize = 256ull << 20;
+  int kept = 1;
+  for (int i = 1; i < argc; i++) {
+      std::string_view argument(argv[i]);
+      if (argument.rfind("--ingest_max_size=", 0) == 0) {
+          maxSize = ParseSize(argument.substr(std::string_view("--ingest_max_size=").size()));
+          if (maxSize == 0) {
+              std::fprintf(stderr, "Invalid --ingest_max_size: %s\n", argv[i]);
+              return 1;
+          }
+      } else {
+          argv[kept++] = argv[i];
+      }
+  }
+  argc = kept;
+
+  using Stage = void (*)(benchmark::State&);
+  const std::pair<const char*, Stage> stages[] = { { "Read", Read }, { "Encode", Encode }, { "Hash", Hash }, { "ParseCsv", ParseCsv } };
+  for (auto const& [name, stage] : stages) {
+      benchmark::internal::Benchmark* registered = benchmark::RegisterBenchmark(name, stage);
+      for (uint64_t size : kFileSizes) {
+          if (size <= maxSize) {
+              registered->Arg(static_cast<int64_t>(size));
+          }
+      }
+      registered->UseRealTime()->Unit(benchmark::kMicrosecond);
+  }
+
+  std::vector<FileIngest::Base64::Kernel> kernels = { FileIngest::Base64::Kernel::Scalar };
+  const FileIngest::CpuFeatures& cpu = FileIngest::DetectCpuFeatures();
+  if (cpu.ssse3) {
+      kernels.push_back(FileIngest::Base64::Kernel::Ssse3);
+  }
+  if (cpu.avx2) {
+      kernels.push_back(FileIngest::Base64::Kernel::Avx2);
+  }
+  for (FileIngest::Base64::Kernel kernel : kernels) {
+      benchmark::RegisterBenchmark((std::string("EncodeKernel/") + KernelName(kernel)).c_str(), EncodeKernel, kernel)->Arg(static_cast<int64_t>(FileIngest::kDefaultChunkSize));
+  }
+
+  // Recorded in the JSON context so runs from different machines are not compared blindly
+  benchmark::AddCustomContext("base64_kernel", KernelName(FileIngest::Base64::ActiveKernel()));
+  benchmark::AddCustomContext("cpu_features", std::string(cpu.ssse3 ? "ssse3 " : "") + (cpu.sse41 ? "sse4.1 " : "") + (cpu.sse42 ? "sse4.2 " : "") + (cpu.avx2 ? "avx2" : ""));
+  benchmark::AddCustomContext("chunk_size", std::to_string(FileIngest::kDefaultChunkSize));
+  benchmark::AddCustomContext("ingest_max_size", SizeName(maxSize));
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+      return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  if (failures != 0) {
+      std::fprintf(stderr, "%d check(s) failed\n", failures);
+      return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,221 @@
+// Behaviour of the worker pool and the cancellation plumbing every file read goes through: work
+// that would overflow the queue is refused with ExecutorBusy, a token's deadline cancels the read
+// at the next chunk, a cancel from JS lands between two chunks, and the registry refuses a request
+// id that is still in use. Exits non-zero when a check fails:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. IoExecutorCheck.cpp -o io-executor-check
+//   ./io-executor-check
+
+#include "IoExecutor.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+
+namespace
+{
+  struct Detached
+  {
+      struct promise_type
+      {
+          Detached get_return_object() const noexcept {
+              return {};
+          }
+          std::suspend_never initial_suspend() const noexcept {
+              return {};
+          }
+          std::suspend_never final_suspend() const noexcept {
+              return {};
+          }
+          void return_void() const noexcept {}
+          void unhandled_exception() const noexcept {
+              std::terminate();
+          }
+      };
+  };
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  // How a read coroutine ended, filled in before `done` is set
+  struct Outcome
+  {
+      std::string error;
+      bool busy = false;
+      bool cancelled = false;
+      int chunks = 0;
+      std::promise<void> done;
+  };
+
+  Detached ScheduleOnce(FileIngest::IoExecutor& executor, FileIngest::CancellationToken token, Outcome& outcome) {
+      try {
+          co_await executor.Schedule(token);
+          outcome.chunks++;
+      } catch (const FileIngest::ExecutorBusy& e) {
+          outcome.busy = true;
+          outcome.error = e.what();
+      } catch (const FileIngest::OperationCancelled& e) {
+          outcome.cancelled = true;
+          outcome.error = e.what();
+      }
+      outcome.done.set_value();
+  }
+
+  // The shape of the module's streaming reads: one hop onto a worker per chunk, the token checked
+  // on every hop. `onChunk` runs as each chunk is processed.
+  template <typename OnChunk>
+  Detached ReadChunks(FileIngest::IoExecutor& executor, FileIngest::CancellationToken token, int chunkCount, OnChunk onChunk, Outcome& outcome) {
+      try {
+          for (int chunk = 0; chunk < chunkCount; chunk++) {
+              co_await executor.Schedule(token);
+              onChunk(chunk);
+              outcome.chunks++;
+          }
+      } catch (const FileIngest::OperationCancelled& e) {
+          outcome.cancelled = true;
+          outcome.error = e.what();
+      } catch (const FileIngest::ExecutorBusy& e) {
+          outcome.busy = true;
+          outcome.error = e.what();
+      }
+      outcome.done.set_value();
+  }
+
+  void Wait(Outcome& outcome) {
+      Check(outcome.done.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready, "the read finishes");
+  }
+
+  void CheckQueueFull() {
+      FileIngest::IoExecutor executor(1, 2);
+      std::promise<void> started;
+      std::promise<void> unblock;
+      std::shared_future<void> unblocked = unblock.get_future().share();
+      std::atomic<int> ran{ 0 };
+
+      // Holds the only worker so the queue fills up behind it
+      Check(executor.TryPost([&]() { started.set_value(); unblocked.wait(); }), "the first job is accepted");
+      started.get_future().wait();
+      Check(executor.TryPost([&]() { ran++; }), "a job fits in the queue");
+      Check(executor.TryPost([&]() { ran++; }), "a second job fits in the queue");
+      Check(executor.PendingCount() == 2, "both jobs are pending");
+      Check(!executor.TryPost([&]() { ran++; }), "a job past the limit is refused");
+
+      Outcome refused;
+      ScheduleOnce(executor, {}, refused);
+      Wait(refused);
+      Check(refused.busy, "a read scheduled on a full queue fails with ExecutorBusy");
+      Check(refused.chunks == 0, "the refused read does not run");
+
+      // Continuations of admitted work are never dropped, even past the limit
+      executor.Post([&]() { ran++; });
+      Check(executor.PendingCount() == 3, "Post queues past the limit");
+
+      unblock.set_value();
+      Outcome admitted;
+      while (executor.PendingCount() != 0) {
+          std::this_thread::yield();
+      }
+      ScheduleOnce(executor, {}, admitted);
+      Wait(admitted);
+      Check(admitted.chunks == 1 && !admitted.busy, "reads are admitted again once the queue drains");
+      Check(ran == 3, "every accepted job ran");
+  }
+
+  void CheckDeadline() {
+      FileIngest::IoExecutor executor(1, 16);
+      FileIngest::CancellationToken never;
+      Check(!never.IsCancelled(), "a default token is never cancelled");
+
+      auto timeout = std::chrono::milliseconds(100);
+      FileIngest::CancellationSource source(timeout);
+      FileIngest::Clock::time_point deadline = FileIngest::Clock::now() + timeout;
+      FileIngest::CancellationToken token = source.Token();
+      Check(!token.IsCancelled() && !token.IsExpired(), "a token is live before its deadline");
+
+      // Each chunk takes 10 ms, so the deadline passes a few chunks before the end of the file
+      FileIngest::Clock::time_point lastStart;
+      Outcome outcome;
+      ReadChunks(executor, token, 100, [&](int) {
+          lastStart = FileIngest::Clock::now();
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }, outcome);
+      Wait(outcome);
+      Check(outcome.cancelled, "the read fails once its deadline passes");
+      Check(outcome.error == "Read timed out", "an expired read reports a timeout");
+      Check(outcome.chunks < 100, "the read stops before the end of the file");
+      Check(outcome.chunks == 0 || lastStart <= deadline + std::chrono::milliseconds(5), "no chunk starts after the deadline");
+      Check(token.IsExpired() && token.IsCancelled(), "an expired token counts as cancelled");
+  }
+
+  void CheckCancelBetweenChunks() {
+      FileIngest::IoExecutor executor(2, 16);
+      FileIngest::CancellationRegistry registry;
+      FileIngest::CancellationToken token = registry.Register("read-1", std::chrono::minutes(1));
+
+      // The cancel arrives from JS while chunk 3 is being processed; that chunk completes and the
+      // read stops before chunk 4
+      std::promise<void> inChunk;
+      std::promise<void> cancelled;
+      std::shared_future<void> cancelSent = cancelled.get_future().share();
+      Outcome outcome;
+      ReadChunks(executor, token, 10, [&](int chunk) {
+          if (chunk == 3) {
+              inChunk.set_value();
+              cancelSent.wait();
+          }
+      }, outcome);
+      inChunk.get_future().wait();
+      Check(registry.Cancel("read-1"), "a running request can be cancelled");
+      cancelled.set_value();
+      Wait(outcome);
+      Check(outcome.cancelled, "the read fails after a cancel");
+      Check(outcome.error == "Read cancelled", "a cancelled read reports the cancel");
+      Check(outcome.chunks == 4, "the chunk in progress completes and no further one starts");
+      registry.Release("read-1");
+      Check(!registry.Cancel("read-1"), "a released request can no longer be cancelled");
+      Check(!registry.Cancel("unknown"), "an unknown request cannot be cancelled");
+  }
+
+  void CheckDuplicateIds() {
+      FileIngest::CancellationRegistry registry;
+      FileIngest::CancellationToken first = registry.Register("download-7", std::chrono::minutes(1));
+      bool refused = false;
+      try {
+          registry.Register("download-7", std::chrono::minutes(1));
+      } catch (const FileIngest::DuplicateRequest& e) {
+          refused = std::strstr(e.what(), "download-7") != nullptr;
+      }
+      Check(refused, "a request id still in use is refused, naming the id");
+      Check(registry.Cancel("download-7") && first.IsCancelled(), "the cancel reaches the first request");
+
+      registry.Release("download-7");
+      FileIngest::CancellationToken second = registry.Register("download-7", std::chrono::minutes(1));
+      Check(!second.IsCancelled(), "the id can be registered again once released");
+      Check(registry.Cancel("download-7") && second.IsCancelled(), "the cancel reaches the new request");
+      registry.Release("download-7");
+  }
+}
+
+int main() {
+  CheckQueueFull();
+  CheckDeadline();
+  CheckCancelBetweenChunks();
+  CheckDuplicateIds();
+
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,357 @@
+// Get/put latency, group commit throughput and compaction time of the key-value store behind the
+// CacheStore module, then crash-recovery checks: a writer killed mid-write, a torn log tail, a
+// lost index and a compaction interrupted between its two renames. Linux only (fork/kill):
+//
+//   g++ -std=c++20 -O2 -I.. KeyValueStoreBenchmark.cpp -o key-value-store-benchmark -pthread
+//   ./key-value-store-benchmark [directory] [entries]
+
+#include "KeyValueStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+  using FileIngest::KeyValueOptions;
+  using FileIngest::KeyValueStore;
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  std::string KeyFor(size_t i) {
+      return "documents/" + std::to_string(i) + "/metadata";
+  }
+
+  // Deterministic value for key i at write `version`, so a reader can tell which write it sees
+  std::vector<uint8_t> ValueFor(size_t i, size_t version, size_t length) {
+      std::vector<uint8_t> value(length);
+      uint64_t state = (i + 1) * 0x9E3779B97F4A7C15ull + version;
+      for (uint8_t& byte : value) {
+          state = state * 6364136223846793005ull + 1442695040888963407ull;
+          byte = static_cast<uint8_t>(state >> 56);
+      }
+      return value;
+  }
+
+  bool Holds(KeyValueStore& store, size_t i, size_t version, size_t length) {
+      std::vector<uint8_t> value;
+      return store.Get(KeyFor(i), value) && value == ValueFor(i, version, length);
+  }
+
+  double Percentile(std::vector<double>& samples, double fraction) {
+      size_t at = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+      std::nth_element(samples.begin(), samples.begin() + static_cast<ptrdiff_t>(at), samples.end());
+      return samples[at];
+  }
+
+  template <typename Body>
+  void MeasureLatency(const char* name, size_t operations, Body&& body) {
+      std::vector<double> samples(operations);
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < operations; i++) {
+          auto before = std::chrono::steady_clock::now();
+          body(i);
+          samples[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - before).count();
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      double p50 = Percentile(samples, 0.50);
+      double p99 = Percentile(samples, 0.99);
+      std::printf("%-30s %8zu ops  p50 %8.2f us  p99 %8.2f us %10.0f ops/s\n", name, operations, p50, p99, operations / seconds);
+  }
+
+  void Latency(std::filesystem::path const& directory, size_t entries) {
+      for (size_t length : { size_t(100), size_t(4096), size_t(64 * 1024) }) {
+          size_t count = length > 4096 ? std::max<size_t>(entries / 16, 16) : entries;
+          std::filesystem::remove_all(directory);
+          KeyValueOptions options;
+          options.maxLiveBytes = uint64_t(count) * (length + 64) * 2;
+          KeyValueStore store(directory, options);
+          std::vector<std::vector<uint8_t>> values(count);
+          for (size_t i = 0; i < count; i++) {
+              values[i] = ValueFor(i, 0, length);
+          }
+          std::string label = std::to_string(length) + " B";
+          MeasureLatency(("put " + label).c_str(), count, [&](size_t i) { store.Put(KeyFor(i), values[i]); });
+          std::vector<uint8_t> value;
+          size_t found = 0;
+          MeasureLatency(("get " + label).c_str(), count, [&](size_t i) { found += store.Get(KeyFor(i), value); });
+          Check(found == count, "every key written is read back");
+          MeasureLatency(("get miss " + label).c_str(), count, [&](size_t i) { found += store.Get(KeyFor(i + count), value); });
+          Check(found == count, "keys never written are missing");
+      }
+  }
+
+  // Synced writes from several threads share each sync, so the commits stay well under the records
+  void GroupCommit(std::filesystem::path const& directory, size_t entries) {
+      size_t perThread = std::max<size_t>(entries / 20, 16);
+      for (size_t threads : { size_t(1), size_t(4), size_t(16) }) {
+          std::filesystem::remove_all(directory);
+          KeyValueOptions options;
+          options.durability = FileIngest::Durability::Synced;
+          KeyValueStore store(directory, options);
+          std::vector<uint8_t> value = ValueFor(0, 0, 512);
+          auto start = std::chrono::steady_clock::now();
+          std::vector<std::thread> writers;
+          for (size_t t = 0; t < threads; t++) {
+              writers.emplace_back([&, t]() {
+                  for (size_t i = 0; i < perThread; i++) {
+                      store.Put(KeyFor(t * perThread + i), value);
+                  }
+              });
+          }
+          for (std::thread& writer : writers) {
+              writer.join();
+          }
+          double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+          FileIngest::KeyValueStats stats = store.Stats();
+          std::printf("synced put, %2zu threads        %8llu records %6llu commits %10.0f puts/s\n", threads, static_cast<unsigned long long>(stats.committedRecords), static_cast<unsigned long long>(stats.commits), stats.committedRecords / seconds);
+          Check(stats.count == threads * perThread, "every synced put is indexed");
+          Check(stats.commits <= stats.committedRecords, "no more commits than records");
+      }
+  }
+
+  void Compaction(std::filesystem::path const& directory, size_t entries) {
+      std::filesystem::remove_all(directory);
+      KeyValueOptions options;
+      options.minCompactionBytes = UINT64_MAX;
+      KeyValueStore store(directory, options);
+      for (size_t version = 0; version < 4; version++) {
+          for (size_t i = 0; i < entries; i++) {
+              store.Put(KeyFor(i), ValueFor(i, version, 200));
+          }
+      }
+      for (size_t i = 0; i < entries; i += 2) {
+          store.Remove(KeyFor(i));
+      }
+      uint64_t before = store.Stats().logBytes;
+      auto start = std::chrono::steady_clock::now();
+      store.Compact();
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      FileIngest::KeyValueStats stats = store.Stats();
+      std::printf("compact %llu -> %llu log bytes  %8.2f ms\n", static_cast<unsigned long long>(before), static_cast<unsigned long long>(stats.logBytes), seconds * 1e3);
+      Check(stats.logBytes < before / 4, "compaction drops overwritten and removed records");
+      bool intact = true;
+      for (size_t i = 0; i < entries; i++) {
+          std::vector<uint8_t> value;
+          intact = intact && (i % 2 == 0 ? !store.Get(KeyFor(i), value) : Holds(store, i, 3, 200));
+      }
+      Check(intact, "compaction keeps the latest value of each live key");
+  }
+
+  void AutomaticCompactionAndEviction(std::filesystem::path const& directory) {
+      std::filesystem::remove_all(directory);
+      KeyValueOptions options;
+      options.maxLiveBytes = 1024 * 1024;
+      options.minCompactionBytes = 256 * 1024;
+      KeyValueStore store(directory, options);
+      for (size_t i = 0; i < 4000; i++) {
+          store.Put(KeyFor(i), ValueFor(i, 0, 1000));
+      }
+      FileIngest::KeyValueStats stats = store.Stats();
+      Check(stats.liveBytes <= options.maxLiveBytes, "eviction keeps live bytes under the budget");
+      Check(stats.evictions > 0 && stats.compactions > 0, "overflowing the budget evicts and compacts");
+      Check(stats.logBytes < 3 * options.maxLiveBytes, "compaction bounds the log");
+      Check(Holds(store, 3999, 0, 1000), "the most recent entry survives eviction");
+      Check(!Holds(store, 0, 0, 1000), "the oldest entry is evicted");
+
+      store.Put("short-lived", ValueFor(0, 0, 10), 1);
+      store.Put("long-lived", ValueFor(0, 0, 10), 60 * 60 * 1000);
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      std::vector<uint8_t> value;
+      Check(!store.Get("short-lived", value), "an expired entry reads as missing");
+      Check(store.Get("long-lived", value), "an unexpired entry is still there");
+  }
+
+  // The child writes until killed and reports each acknowledged write down a pipe. Buffered
+  // writes are in the OS once Put returns, so all of them must be there after the kill.
+  void KilledWriter(std::filesystem::path const& directory) {
+      std::filesystem::remove_all(directory);
+      int report[2];
+      if (::pipe(report) != 0) {
+          std::abort();
+      }
+      pid_t child = ::fork();
+      if (child == 0) {
+          ::close(report[0]);
+          KeyValueStore store(directory);
+          for (size_t i = 0;; i++) {
+              store.Put(KeyFor(i % 5000), ValueFor(i % 5000, i / 5000, 300 + i % 700));
+              uint64_t acknowledged = i;
+              if (::write(report[1], &acknowledged, sizeof(acknowledged)) != sizeof(acknowledged)) {
+                  ::_exit(1);
+              }
+          }
+      }
+      ::close(report[1]);
+      uint64_t last = 0;
+      uint64_t acknowledged = 0;
+      while (::read(report[0], &acknowledged, sizeof(acknowledged)) == sizeof(acknowledged)) {
+          last = acknowledged;
+          if (last >= 12000) {
+              ::kill(child, SIGKILL);
+              break;
+          }
+      }
+      ::waitpid(child, nullptr, 0);
+      // Writes acknowledged after the parent stopped reading are fine to ignore
+      while (::read(report[0], &acknowledged, sizeof(acknowledged)) == sizeof(acknowledged)) {
+          last = acknowledged;
+      }
+      ::close(report[0]);
+
+      KeyValueStore store(directory);
+      FileIngest::KeyValueStats stats = store.Stats();
+      std::printf("killed writer: %llu writes acknowledged, %llu records recovered, %llu torn bytes dropped\n", static_cast<unsigned long long>(last + 1), static_cast<unsigned long long>(stats.recoveredRecords), static_cast<unsigned long long>(stats.truncatedBytes));
+      Check(stats.recoveredRecords > 0, "the index is rebuilt after the kill");
+      bool intact = true;
+      // The latest acknowledged write of each key, less the key that the next, unacknowledged
+      // write may have overwritten before the kill
+      for (uint64_t i = last + 2 >= 5000 ? last + 2 - 5000 : 0; i <= last; i++) {
+          intact = intact && Holds(store, i % 5000, i / 5000, 300 + i % 700);
+      }
+      Check(intact, "every acknowledged write survives the kill");
+  }
+
+  void TornTail(std::filesystem::path const& directory) {
+      std::filesystem::remove_all(directory);
+      {
+          KeyValueStore store(directory);
+          for (size_t i = 0; i < 100; i++) {
+              store.Put(KeyFor(i), ValueFor(i, 0, 100));
+          }
+      }
+      uintmax_t clean = std::filesystem::file_size(directory / "cache.log");
+      {
+          // Half a record, as a crash mid-write leaves it
+          KeyValueStore store(directory);
+          store.Put(KeyFor(100), ValueFor(100, 0, 100));
+      }
+      uintmax_t written = std::filesystem::file_size(directory / "cache.log");
+      std::filesystem::resize_file(directory / "cache.log", clean + (written - clean) / 2);
+      {
+          KeyValueStore store(directory);
+          FileIngest::KeyValueStats stats = store.Stats();
+          Check(stats.truncatedBytes == (written - clean) / 2, "a torn record is cut off the log");
+          Check(stats.count == 100 && Holds(store, 99, 0, 100), "records before the torn one survive");
+          Check(!Holds(store, 100, 0, 100), "the torn record is gone");
+          store.Put(KeyFor(100), ValueFor(100, 1, 100));
+      }
+      KeyValueStore store(directory);
+      Check(Holds(store, 100, 1, 100) && store.Stats().recoveredRecords == 0, "writes after recovery reopen cleanly");
+  }
+
+  void CorruptedRecord(std::filesystem::path const& directory) {
+      std::filesystem::remove_all(directory);
+      {
+          KeyValueStore store(directory);
+          for (size_t i = 0; i < 10; i++) {
+              store.Put(KeyFor(i), ValueFor(i, 0, 100));
+          }
+      }
+      {
+          // Flip a byte in the value of the last record and lose the index
+          std::fstream log(directory / "cache.log", std::ios::in | std::ios::out | std::ios::binary);
+          log.seekg(-5, std::ios::end);
+          char byte = static_cast<char>(log.get() ^ 0xFF);
+          log.seekp(-5, std::ios::end);
+          log.put(byte);
+      }
+      std::filesystem::remove(directory / "cache.idx");
+      KeyValueStore store(directory);
+      Check(store.Stats().count == 9 && !Holds(store, 9, 0, 100), "a record failing its checksum is dropped");
+  }
+
+  void LostIndex(std::filesystem::path const& directory) {
+      std::filesystem::remove_all(directory);
+      {
+          KeyValueStore store(directory);
+          for (size_t i = 0; i < 1000; i++) {
+              store.Put(KeyFor(i), ValueFor(i, 0, 100));
+          }
+          for (size_t i = 0; i < 1000; i += 3) {
+              store.Remove(KeyFor(i));
+          }
+      }
+      {
+          std::ofstream index(directory / "cache.idx", std::ios::binary | std::ios::trunc);
+          index << "not an index";
+      }
+      KeyValueStore store(directory);
+      bool intact = true;
+      for (size_t i = 0; i < 1000; i++) {
+          std::vector<uint8_t> value;
+          intact = intact && (i % 3 == 0 ? !store.Get(KeyFor(i), value) : Holds(store, i, 0, 100));
+      }
+      Check(intact && store.Stats().count == 666, "a garbled index is rebuilt, removals included");
+  }
+
+  void InterruptedCompaction(std::filesystem::path const& directory) {
+      std::filesystem::remove_all(directory);
+      std::filesystem::path saved = directory.string() + ".saved-index";
+      {
+          KeyValueOptions options;
+          options.minCompactionBytes = UINT64_MAX;
+          KeyValueStore store(directory, options);
+          for (size_t version = 0; version < 3; version++) {
+              for (size_t i = 0; i < 500; i++) {
+                  store.Put(KeyFor(i), ValueFor(i, version, 100));
+              }
+          }
+          store.Flush();
+          std::filesystem::copy_file(directory / "cache.idx", saved, std::filesystem::copy_options::overwrite_existing);
+          store.Compact();
+      }
+      // As if the crash came after the log rename and before the index one, with leftovers
+      std::filesystem::copy_file(saved, directory / "cache.idx", std::filesystem::copy_options::overwrite_existing);
+      std::filesystem::copy_file(saved, directory / "cache.idx.compact");
+      std::filesystem::remove(saved);
+      KeyValueStore store(directory);
+      bool intact = true;
+      for (size_t i = 0; i < 500; i++) {
+          intact = intact && Holds(store, i, 2, 100);
+      }
+      Check(intact && store.Stats().recoveredRecords == 500, "an index left from before compaction is rebuilt");
+      Check(!std::filesystem::exists(directory / "cache.idx.compact"), "leftover compaction files are removed");
+  }
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path directory = argc > 1 ? argv[1] : std::filesystem::temp_directory_path() / "key-value-store-benchmark";
+  size_t entries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000;
+
+  Latency(directory, entries);
+  GroupCommit(directory, entries);
+  Compaction(directory, entries);
+  AutomaticCompactionAndEviction(directory);
+  KilledWriter(directory);
+  TornTail(directory);
+  CorruptedRecord(directory);
+  LostIndex(directory);
+  InterruptedCompaction(directory);
+
+  std::filesystem::remove_all(directory);
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
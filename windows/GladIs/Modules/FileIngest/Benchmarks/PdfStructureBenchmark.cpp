@@ -0,0 +1,543 @@
+// Time and bytes read to get the page count, metadata and encryption of a PDF through
+// readPDFStructure, for files from 1 MiB up to the given size, which should stay flat where the
+// file has a cross-reference table; then checks of every structure the reader follows (classic
+// tables, cross-reference streams with PNG predictors, object streams, hybrid files, incremental
+// updates, linearized files), of the damage it reports and repairs, and a fuzz run over mutated
+// files that must never crash, hang or throw anything but PdfError. Exits non-zero when a check
+// fails:
+//
+//   g++ -std=c++20 -O2 -I.. PdfStructureBenchmark.cpp -o pdf-structure-benchmark -pthread
+//   ./pdf-structure-benchmark [directory] [largest MiB] [fuzz iterations]
+
+#include "Deflate.h"
+#include "PdfStructure.h"
+#include "RangeSource.h"
+#include "TextIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  using FileIngest::PdfStructure;
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  class MemorySource final : public FileIngest::RangeSource
+  {
+  public:
+      explicit MemorySource(std::string_view data) : m_data(data) {}
+
+      uint64_t Size() const noexcept override {
+          return m_data.size();
+      }
+
+      size_t ReadAt(uint64_t offset, uint8_t* out, size_t length) override {
+          if (offset >= m_data.size()) {
+              return 0;
+          }
+          size_t take = std::min<size_t>(length, m_data.size() - offset);
+          std::memcpy(out, m_data.data() + offset, take);
+          return take;
+      }
+
+  private:
+      std::string_view m_data;
+  };
+
+  PdfStructure Read(std::string const& file) {
+      MemorySource source(file);
+      return FileIngest::ReadPdfStructure(source);
+  }
+
+  std::string Deflated(std::string const& data) {
+      FileIngest::Deflate::DeflateEncoder encoder(FileIngest::Deflate::Level::Fast, FileIngest::Deflate::Framing::Zlib);
+      std::string out;
+      auto collect = [&out](const uint8_t* bytes, size_t length) { out.append(reinterpret_cast<const char*>(bytes), length); };
+      encoder.Write(reinterpret_cast<const uint8_t*>(data.data()), data.size(), collect);
+      encoder.Finish(collect);
+      return out;
+  }
+
+  std::string Stream(std::string dictionary, std::string const& data) {
+      return "<< " + dictionary + " /Length " + std::to_string(data.size()) + " >>\nstream\n" + data + "\nendstream";
+  }
+
+  struct Layout
+  {
+      size_t pages = 10;
+      // Incompressible image streams between the pages, to grow the file
+      uint64_t fillerBytes = 0;
+      bool xrefStream = false;
+      // Pages, page tree nodes, catalog and info packed in object streams (needs xrefStream or hybrid)
+      bool objectStreams = false;
+      // Classic table for the objects in the file, plus an /XRefStm for the packed ones
+      bool hybrid = false;
+      bool linearized = false;
+      // Incremental updates, each replacing the /Info dictionary with a new title
+      size_t updates = 0;
+      bool encrypted = false;
+      bool xmp = false;
+  };
+
+  constexpr const char* kTitle = "Procédure qualité – révision ✓";
+
+  std::string Utf16Title() {
+      std::string out = "<FEFF";
+      std::string_view title = kTitle;
+      for (size_t i = 0; i < title.size();) {
+          uint32_t c = FileIngest::detail::NextCodePoint(title, i);
+          char unit[8];
+          std::snprintf(unit, sizeof(unit), "%04X", c);
+          out += unit;
+      }
+      return out + ">";
+  }
+
+  // Builds a file the way writers lay them out, with objects numbered:
+  //   1 catalog, 2 page tree root, 3 info, 4 metadata, 5 encryption, then the page tree nodes,
+  //   the pages and the fillers
+  std::string MakePdf(Layout const& layout, uint64_t seed = 1) {
+      std::vector<std::string> bodies(5);
+      auto add = [&bodies](std::string body) {
+          bodies.push_back(std::move(body));
+          return bodies.size();
+      };
+      size_t nodeCount = (layout.pages + 127) / 128;
+      size_t firstNode = bodies.size() + 1;
+      for (size_t i = 0; i < nodeCount; i++) {
+          add("");
+      }
+      std::string rootKids;
+      for (size_t node = 0; node < nodeCount; node++) {
+          size_t count = std::min<size_t>(128, layout.pages - node * 128);
+          std::string kids;
+          for (size_t p = 0; p < count; p++) {
+              size_t page = add("<< /Type /Page /Parent " + std::to_string(firstNode + node) + " 0 R /MediaBox [0 0 612 792] >>");
+              kids += std::to_string(page) + " 0 R ";
+          }
+          bodies[firstNode + node - 1] = "<< /Type /Pages /Parent 2 0 R /Kids [" + kids + "] /Count " + std::to_string(count) + " >>";
+          rootKids += std::to_string(firstNode + node) + " 0 R ";
+      }
+      size_t packedEnd = bodies.size();
+      std::mt19937_64 engine(seed);
+      for (uint64_t filled = 0; filled < layout.fillerBytes; filled += 1024 * 1024) {
+          std::string data(static_cast<size_t>(std::min<uint64_t>(1024 * 1024, layout.fillerBytes - filled)), '\0');
+          for (size_t i = 0; i + 8 <= data.size(); i += 8) {
+              uint64_t value = engine();
+              std::memcpy(data.data() + i, &value, 8);
+          }
+          add(Stream("/Type /XObject /Subtype /Image /Width 512 /Height 512 /ColorSpace /DeviceGray /BitsPerComponent 8 /Filter /DCTDecode", data));
+      }
+      bodies[0] = "<< /Type /Catalog /Pages 2 0 R" + std::string(layout.xmp ? " /Metadata 4 0 R" : "") + " >>";
+      bodies[1] = "<< /Type /Pages /Kids [" + rootKids + "] /Count " + std::to_string(layout.pages) + " >>";
+      if (layout.encrypted) {
+          bodies[2] = "<< /Title <8D3A11F09C> /Producer <77AA01> >>";
+          bodies[4] = "<< /Filter /Standard /V 2 /R 3 /Length 128 /P -3904 /O <00> /U <00> >>";
+      } else {
+          bodies[2] = "<< /Title " + Utf16Title() + (layout.xmp ? "" : " /Author (Service Qualit\\351)") + " /Producer (GladIs \\(tests\\)) /CreationDate (D:20240315093000+01'00') /ModDate (D:20240402) >>";
+      }
+      if (layout.xmp) {
+          std::string packet = "<?xpacket begin=\"\xEF\xBB\xBF\" id=\"W5M0MpCehiHzreSzNTczkc9d\"?>\n<x:xmpmeta xmlns:x=\"adobe:ns:meta/\"><rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\">"
+              "<rdf:Description rdf:about=\"\" xmlns:dc=\"http://purl.org/dc/elements/1.1/\" xmlns:xmp=\"http://ns.adobe.com/xap/1.0/\" xmp:CreatorTool=\"Word &amp; Co\">"
+              "<dc:title><rdf:Alt><rdf:li xml:lang=\"x-default\">Titre XMP</rdf:li></rdf:Alt></dc:title>"
+              "<dc:creator><rdf:Seq><rdf:li>Alice Martin</rdf:li><rdf:li>Bob L&#233;ger</rdf:li></rdf:Seq></dc:creator>"
+              "</rdf:Description></rdf:RDF></x:xmpmeta>\n<?xpacket end=\"w\"?>";
+          bodies[3] = Stream("/Type /Metadata /Subtype /XML", packet);
+      }
+
+      bool packing = layout.objectStreams && (layout.xrefStream || layout.hybrid);
+      // Objects inside an object stream: which stream, and where in it
+      std::vector<std::pair<size_t, size_t>> packedIn(bodies.size() + 1, { 0, 0 });
+      if (packing) {
+          std::vector<size_t> candidates = { 1, 2, 3 };
+          for (size_t number = 6; number <= packedEnd; number++) {
+              candidates.push_back(number);
+          }
+          for (size_t first = 0; first < candidates.size(); first += 200) {
+              std::string header;
+              std::string objects;
+              size_t count = std::min<size_t>(200, candidates.size() - first);
+              size_t streamNumber = bodies.size() + 1;
+              for (size_t i = 0; i < count; i++) {
+                  size_t number = candidates[first + i];
+                  header += std::to_string(number) + " " + std::to_string(objects.size()) + " ";
+                  objects += bodies[number - 1] + "\n";
+                  packedIn[number] = { streamNumber, i };
+              }
+              add(Stream("/Type /ObjStm /N " + std::to_string(count) + " /First " + std::to_string(header.size()) + " /Filter /FlateDecode", Deflated(header + objects)));
+              packedIn.resize(bodies.size() + 1, { 0, 0 });
+          }
+      }
+
+      std::string file = "%PDF-1.7\n%\xE2\xE3\xCF\xD3\n";
+      size_t linearizationNumber = bodies.size() + 1;
+      size_t lengthAt = 0;
+      size_t firstPagePrevAt = 0;
+      size_t firstPageXref = 0;
+      if (layout.linearized) {
+          file += std::to_string(linearizationNumber) + " 0 obj\n<< /Linearized 1 /L ";
+          lengthAt = file.size();
+          file += "0000000000 /N " + std::to_string(layout.pages) + " /O 6 /E 0 /T 0 /H [0 0] >>\nendobj\n";
+          firstPageXref = file.size();
+          file += "xref\n" + std::to_string(linearizationNumber) + " 1\n0000000017 00000 n \ntrailer\n<< /Size " + std::to_string(linearizationNumber + 1) + " /Root 1 0 R /Info 3 0 R /Prev ";
+          firstPagePrevAt = file.size();
+          file += "0000000000 >>\nstartxref\n0\n%%EOF\n";
+      }
+      std::vector<size_t> offsets(bodies.size() + 1, 0);
+      for (size_t number = 1; number <= bodies.size(); number++) {
+          if (bodies[number - 1].empty() || packedIn[number].first != 0) {
+              continue;
+          }
+          offsets[number] = file.size();
+          file += std::to_string(number) + " 0 obj\n" + bodies[number - 1] + "\nendobj\n";
+      }
+      std::string trailerKeys = " /Root 1 0 R /Info 3 0 R" + std::string(layout.encrypted ? " /Encrypt 5 0 R /ID [<0123456789ABCDEF> <0123456789ABCDEF>]" : "");
+      auto table = [&](size_t from, size_t to, bool markPacked) {
+          std::string out = "xref\n" + std::to_string(from) + " " + std::to_string(to - from) + "\n";
+          for (size_t number = from; number < to; number++) {
+              char line[32];
+              if (number == 0 || offsets[number] == 0 || (markPacked && packedIn[number].first != 0)) {
+                  std::snprintf(line, sizeof(line), "%010d %05d f \n", 0, number == 0 ? 65535 : 1);
+              } else {
+                  std::snprintf(line, sizeof(line), "%010zu %05d n \n", offsets[number], 0);
+              }
+              out += line;
+          }
+          return out;
+      };
+      // A cross-reference stream over objects [0, count) with rows of /W [1 4 2], PNG Up rows
+      auto xrefStream = [&](size_t count, size_t selfNumber, std::string dictionaryTail) {
+          std::string rows;
+          std::string previous(7, '\0');
+          for (size_t number = 0; number < count; number++) {
+              uint8_t type = 0;
+              uint64_t field2 = 0;
+              uint64_t field3 = number == 0 ? 65535 : 0;
+              if (packedIn.size() > number && packedIn[number].first != 0) {
+                  type = 2;
+                  field2 = packedIn[number].first;
+                  field3 = packedIn[number].second;
+              } else if (number < offsets.size() && offsets[number] != 0) {
+                  type = 1;
+                  field2 = offsets[number];
+              } else if (number == selfNumber) {
+                  type = 1;
+                  field2 = file.size();
+              }
+              std::string row = { static_cast<char>(type), static_cast<char>(field2 >> 24), static_cast<char>(field2 >> 16), static_cast<char>(field2 >> 8), static_cast<char>(field2),
+                  static_cast<char>(field3 >> 8), static_cast<char>(field3) };
+              rows.push_back('\x02');
+              for (size_t i = 0; i < 7; i++) {
+                  rows.push_back(static_cast<char>(row[i] - previous[i]));
+              }
+              previous = row;
+          }
+          return std::to_string(selfNumber) + " 0 obj\n" + Stream("/Type /XRef /Size " + std::to_string(count) + " /W [1 4 2] /Filter /FlateDecode /DecodeParms << /Predictor 12 /Columns 7 >>" + dictionaryTail, Deflated(rows)) + "\nendobj\n";
+      };
+
+      size_t xref = file.size();
+      if (layout.xrefStream) {
+          size_t selfNumber = bodies.size() + (layout.linearized ? 2 : 1);
+          file += xrefStream(selfNumber + 1, selfNumber, trailerKeys);
+      } else if (layout.hybrid) {
+          size_t streamNumber = bodies.size() + 1;
+          size_t streamAt = file.size();
+          file += xrefStream(streamNumber + 1, streamNumber, "");
+          offsets.push_back(streamAt);
+          xref = file.size();
+          file += table(0, streamNumber + 1, true) + "trailer\n<< /Size " + std::to_string(streamNumber + 1) + trailerKeys + " /XRefStm " + std::to_string(streamAt) + " >>\n";
+      } else {
+          file += table(0, bodies.size() + 1, false) + "trailer\n<< /Size " + std::to_string(bodies.size() + (layout.linearized ? 2 : 1)) + trailerKeys + " >>\n";
+      }
+      file += "startxref\n" + std::to_string(layout.linearized ? firstPageXref : xref) + "\n%%EOF\n";
+      if (layout.linearized) {
+          char patched[16];
+          std::snprintf(patched, sizeof(patched), "%010zu", xref);
+          file.replace(firstPagePrevAt, 10, patched);
+      }
+
+      size_t previousXref = layout.linearized ? firstPageXref : xref;
+      for (size_t update = 1; update <= layout.updates; update++) {
+          size_t infoAt = file.size();
+          file += "3 0 obj\n<< /Title (Update " + std::to_string(update) + ") /Author (Service Qualit\\351) >>\nendobj\n";
+          size_t updateXref = file.size();
+          char entry[32];
+          std::snprintf(entry, sizeof(entry), "%010zu %05d n \n", infoAt, 0);
+          file += "xref\n0 1\n0000000000 65535 f \n3 1\n" + std::string(entry) + "trailer\n<< /Size " + std::to_string(bodies.size() + 1) + trailerKeys + " /Prev " + std::to_string(previousXref) + " >>\nstartxref\n" + std::to_string(updateXref) + "\n%%EOF\n";
+          previousXref = updateXref;
+      }
+      if (layout.linearized) {
+          char patched[16];
+          std::snprintf(patched, sizeof(patched), "%010zu", file.size());
+          file.replace(lengthAt, 10, patched);
+      }
+      return file;
+  }
+
+  bool Sound(PdfStructure const& structure) {
+      for (std::string const& problem : structure.problems) {
+          std::printf("  problem: %s\n", problem.c_str());
+      }
+      return structure.problems.empty() && !structure.repaired;
+  }
+
+  void LayoutChecks() {
+      Layout classic;
+      PdfStructure plain = Read(MakePdf(classic));
+      Check(Sound(plain) && plain.pageCount == 10 && plain.version == "1.7" && plain.xrefSections == 1 && !plain.xrefStreams && !plain.linearized, "a classic table is followed");
+      Check(plain.title == kTitle && plain.author == "Service Qualité" && plain.producer == "GladIs (tests)", "info strings are decoded from UTF-16 and PDFDocEncoding");
+      Check(plain.creationDate == "2024-03-15T09:30:00+01:00" && plain.modificationDate == "2024-04-02", "dates are converted to ISO 8601");
+
+      Layout streams;
+      streams.pages = 1000;
+      streams.xrefStream = true;
+      streams.objectStreams = true;
+      PdfStructure packed = Read(MakePdf(streams));
+      Check(Sound(packed) && packed.pageCount == 1000 && packed.xrefStreams && packed.title == kTitle, "a cross-reference stream with a PNG predictor and object streams is followed");
+
+      Layout hybrid;
+      hybrid.pages = 300;
+      hybrid.hybrid = true;
+      hybrid.objectStreams = true;
+      PdfStructure mixed = Read(MakePdf(hybrid));
+      Check(Sound(mixed) && mixed.pageCount == 300 && mixed.xrefSections == 2 && mixed.title == kTitle, "a hybrid file finds packed objects through /XRefStm");
+
+      Layout updated;
+      updated.updates = 3;
+      PdfStructure incremental = Read(MakePdf(updated));
+      Check(Sound(incremental) && incremental.xrefSections == 4 && incremental.title == "Update 3" && incremental.pageCount == 10, "incremental updates are followed and the newest object wins");
+
+      Layout linearized;
+      linearized.linearized = true;
+      linearized.pages = 40;
+      PdfStructure fast = Read(MakePdf(linearized));
+      Check(Sound(fast) && fast.linearized && fast.pageCount == 40 && fast.xrefSections == 2 && fast.title == kTitle, "a linearized file is followed from its first-page table");
+      linearized.updates = 1;
+      PdfStructure fastUpdated = Read(MakePdf(linearized));
+      Check(Sound(fastUpdated) && fastUpdated.linearized && fastUpdated.xrefSections == 3 && fastUpdated.title == "Update 1", "a linearized file with an update is followed");
+
+      Layout encrypted;
+      encrypted.encrypted = true;
+      PdfStructure locked = Read(MakePdf(encrypted));
+      Check(Sound(locked) && locked.encrypted && locked.encryptionFilter == "Standard" && locked.encryptionRevision == 3 && locked.encryptionKeyBits == 128, "encryption is reported");
+      Check(locked.permissions == -3904 && locked.canPrint == false && locked.canModify == false && locked.canCopy == false && locked.title.empty() && locked.pageCount == 10,
+          "permissions are decoded and encrypted strings are not");
+
+      Layout xmp;
+      xmp.xmp = true;
+      xmp.xrefStream = true;
+      PdfStructure described = Read(MakePdf(xmp));
+      Check(Sound(described) && described.hasXmpMetadata && described.title == kTitle && described.author == "Alice Martin, Bob Léger" && described.creator == "Word & Co", "XMP metadata fills what /Info lacks");
+  }
+
+  void DamageChecks() {
+      Layout layout;
+      layout.pages = 50;
+      layout.fillerBytes = 200 * 1024;
+      std::string sound = MakePdf(layout);
+
+      std::string truncated = sound.substr(0, sound.size() * 2 / 3);
+      PdfStructure cut = Read(truncated);
+      Check(cut.repaired && !cut.problems.empty() && cut.pageCount == 50, "a truncated file is repaired by scanning");
+
+      std::string noEof = sound.substr(0, sound.rfind("%%EOF"));
+      PdfStructure open = Read(noEof);
+      Check(!open.repaired && open.problems.size() == 1 && open.pageCount == 50, "a missing %%EOF is reported");
+
+      std::string shifted = sound;
+      size_t startxref = shifted.rfind("startxref\n") + 10;
+      shifted.replace(startxref, shifted.find('\n', startxref) - startxref, "1234");
+      PdfStructure moved = Read(shifted);
+      Check(moved.repaired && moved.pageCount == 50 && moved.title == kTitle, "a wrong startxref is repaired");
+
+      // Moves object 1's entry onto object 2
+      std::string wrongEntry = sound;
+      size_t tableAt = wrongEntry.rfind("xref\n0 ");
+      size_t entries = wrongEntry.find('\n', tableAt + 5) + 1;
+      wrongEntry.replace(entries + 20, 10, wrongEntry.substr(entries + 40, 10));
+      PdfStructure misplaced = Read(wrongEntry);
+      Check(misplaced.repaired && misplaced.pageCount == 50, "an entry pointing at the wrong object is repaired");
+
+      // Same width, so the offsets after it stay right
+      layout.xmp = true;
+      std::string xmp = MakePdf(layout);
+      size_t lengthAt = xmp.find("/Subtype /XML /Length ") + 22;
+      size_t digits = xmp.find(' ', lengthAt) - lengthAt;
+      xmp.replace(lengthAt, digits, std::string(digits, '9'));
+      PdfStructure wrongLength = Read(xmp);
+      Check(!wrongLength.repaired && wrongLength.hasXmpMetadata && wrongLength.problems.size() == 1, "a wrong stream /Length is reported and read around");
+
+      std::string eolEntries = sound;
+      for (size_t at = eolEntries.find(" n \n"); at != std::string::npos; at = eolEntries.find(" n \n", at)) {
+          eolEntries.replace(at, 4, " n\n");
+      }
+      for (size_t at = eolEntries.find(" f \n"); at != std::string::npos; at = eolEntries.find(" f \n", at)) {
+          eolEntries.replace(at, 4, " f\n");
+      }
+      size_t xrefAt = eolEntries.rfind("xref\n0 ");
+      size_t declared = eolEntries.rfind("startxref\n") + 10;
+      eolEntries.replace(declared, eolEntries.find('\n', declared) - declared, std::to_string(xrefAt));
+      PdfStructure nineteen = Read(eolEntries);
+      Check(Sound(nineteen) && nineteen.pageCount == 50, "19-byte table entries are read");
+
+      bool rejected = false;
+      try {
+          Read("GIF89a not a pdf");
+      } catch (FileIngest::PdfError const&) {
+          rejected = true;
+      }
+      Check(rejected, "a file that is not a PDF is rejected");
+  }
+
+  void Fuzz(size_t iterations) {
+      std::mt19937_64 engine(99);
+      std::vector<std::string> seeds;
+      for (int variant = 0; variant < 6; variant++) {
+          Layout layout;
+          layout.pages = 20 + variant * 30;
+          layout.xrefStream = variant == 1 || variant == 4;
+          layout.objectStreams = variant == 1 || variant == 2;
+          layout.hybrid = variant == 2;
+          layout.linearized = variant == 3;
+          layout.updates = variant == 3 || variant == 5 ? 2 : 0;
+          layout.encrypted = variant == 5;
+          layout.xmp = variant == 4;
+          layout.fillerBytes = 8192;
+          seeds.push_back(MakePdf(layout, variant));
+      }
+      static constexpr const char* kTokens[] = { "xref", "trailer", "startxref", "obj", "endobj", "stream", "endstream", "<<", ">>", "[", "]", "R", "/Prev 0", "/Length 99999999",
+          "/XRefStm 9", "/W [9 9 9]", "/Index [0 4294967295]", "/Predictor 15", "/Count -1", "0 0 R", "1 0 R", "%%EOF", "(", ")", "<FEFF", "/Type /ObjStm /N 999999" };
+      size_t rejected = 0;
+      size_t repaired = 0;
+      double slowest = 0;
+      for (size_t i = 0; i < iterations; i++) {
+          std::string file = seeds[engine() % seeds.size()];
+          size_t mutations = 1 + engine() % 6;
+          for (size_t m = 0; m < mutations && !file.empty(); m++) {
+              size_t at = engine() % file.size();
+              switch (engine() % 6) {
+              case 0:
+                  file[at] = static_cast<char>(engine());
+                  break;
+              case 1:
+                  file.resize(at);
+                  break;
+              case 2:
+                  file.insert(at, kTokens[engine() % std::size(kTokens)]);
+                  break;
+              case 3:
+                  file.replace(at, std::min<size_t>(file.size() - at, engine() % 16), std::to_string(engine() % 100000));
+                  break;
+              case 4:
+                  file.erase(at, engine() % 64);
+                  break;
+              default:
+                  file.insert(at, file.substr(engine() % file.size(), engine() % 256));
+                  break;
+              }
+          }
+          auto start = std::chrono::steady_clock::now();
+          try {
+              PdfStructure structure = Read(file);
+              repaired += structure.repaired ? 1 : 0;
+          } catch (FileIngest::PdfError const&) {
+              rejected++;
+          } catch (std::exception const& e) {
+              std::printf("unexpected exception: %s\n", e.what());
+              Check(false, "damaged files only ever throw PdfError");
+          }
+          slowest = std::max(slowest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+      }
+      std::printf("%-28s %8zu files  %6zu repaired %6zu rejected   slowest %8.2f ms\n", "fuzz", iterations, repaired, rejected, slowest);
+      Check(slowest < 2000, "no damaged file takes long to read");
+  }
+
+  void Scaling(std::filesystem::path const& directory, uint64_t largestMiB) {
+      std::filesystem::create_directories(directory);
+      std::vector<uint64_t> sizes;
+      for (uint64_t mib = 1; mib <= largestMiB; mib *= 8) {
+          sizes.push_back(mib);
+      }
+      if (sizes.back() != largestMiB) {
+          sizes.push_back(largestMiB);
+      }
+      struct Row
+      {
+          double micros;
+          uint64_t bytesRead;
+      };
+      for (int variant = 0; variant < 3; variant++) {
+          const char* names[] = { "classic table", "xref + object streams", "linearized" };
+          std::vector<Row> rows;
+          for (uint64_t mib : sizes) {
+              Layout layout;
+              layout.pages = static_cast<size_t>(std::min<uint64_t>(100000, mib * 400));
+              layout.fillerBytes = mib * 1024 * 1024;
+              layout.xrefStream = variant == 1;
+              layout.objectStreams = variant == 1;
+              layout.linearized = variant == 2;
+              std::filesystem::path path = directory / ("structure-" + std::to_string(variant) + "-" + std::to_string(mib) + ".pdf");
+              {
+                  std::string file = MakePdf(layout);
+                  std::ofstream(path, std::ios::binary).write(file.data(), static_cast<std::streamsize>(file.size()));
+              }
+              // Best of several opens: the file is in the page cache, so this is the parsing cost
+              double best = 1e30;
+              PdfStructure structure;
+              for (int round = 0; round < 20; round++) {
+                  auto start = std::chrono::steady_clock::now();
+                  FileIngest::NativeFileSource source(path);
+                  structure = FileIngest::ReadPdfStructure(source);
+                  best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+              }
+              Check(Sound(structure) && structure.pageCount == static_cast<int64_t>(layout.pages), "large files are read correctly");
+              std::printf("%-28s %8llu MiB %8zu pages %10.1f us %8.1f KiB read\n", names[variant], static_cast<unsigned long long>(mib), layout.pages, best, structure.bytesRead / 1024.0);
+              rows.push_back({ best, structure.bytesRead });
+              std::filesystem::remove(path);
+          }
+          // A cross-reference stream is compressed as a whole, so it is read and inflated whole and
+          // its cost follows the object count; tables are read by the entry
+          if (variant != 1) {
+              Check(rows.back().bytesRead <= rows.front().bytesRead + 64 * 1024, "bytes read do not grow with the file");
+              Check(rows.back().micros < std::max(5000.0, rows.front().micros * 20), "time to read stays near constant");
+          }
+          Check(sizes.back() < 8 || rows.back().bytesRead * 100 < sizes.back() * 1024 * 1024, "under 1% of the file is read");
+      }
+  }
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path directory = argc > 1 ? argv[1] : std::filesystem::temp_directory_path() / "pdf-structure-benchmark";
+  uint64_t largestMiB = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+  size_t iterations = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20000;
+
+  LayoutChecks();
+  DamageChecks();
+  Fuzz(iterations);
+  Scaling(directory, std::max<uint64_t>(largestMiB, 1));
+  std::filesystem::remove_all(directory);
+
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
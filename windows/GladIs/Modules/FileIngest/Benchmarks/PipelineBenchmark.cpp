@@ -0,0 +1,177 @@
+// Throughput of the batch read pipeline (read, hash, base64) as executor workers are added.
+// Every file goes through the same stages as FileOpenPicker.readMultipleFileData, with
+// blocking reads standing in for DataReader.LoadAsync. Every run checks each file's digest and
+// encoded length, that no more files than the semaphore allows are in flight, and that the batch
+// completes once; the program exits non-zero when a check fails:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. PipelineBenchmark.cpp -o pipeline-benchmark
+//   ./pipeline-benchmark [files] [megabytes per file] [max workers]
+
+#include "Base64.h"
+#include "Pipeline.h"
+#include "Sha256.h"
+#include "StreamEncoder.h"
+#include "Task.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  // Starts a task and lets it run to completion on its own
+  struct Detached
+  {
+      struct promise_type
+      {
+          Detached get_return_object() const noexcept {
+              return {};
+          }
+          std::suspend_never initial_suspend() const noexcept {
+              return {};
+          }
+          std::suspend_never final_suspend() const noexcept {
+              return {};
+          }
+          void return_void() const noexcept {}
+          void unhandled_exception() const noexcept {
+              std::terminate();
+          }
+      };
+  };
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  struct Batch
+  {
+      Batch(FileIngest::IoExecutor& executor, size_t inFlight, size_t fileCount)
+          : executor(executor), semaphore(executor, inFlight), countdown(fileCount), digests(fileCount), encodedLengths(fileCount) {}
+
+      FileIngest::IoExecutor& executor;
+      FileIngest::AsyncSemaphore semaphore;
+      FileIngest::BatchCountdown countdown;
+      std::mutex mutex;
+      std::condition_variable done;
+      bool finished = false;
+      std::atomic<uint64_t> encodedBytes{ 0 };
+      // Written by the file's own coroutine only, read once the batch has finished
+      std::vector<FileIngest::Sha256Digest> digests;
+      std::vector<size_t> encodedLengths;
+      std::atomic<size_t> inFlight{ 0 };
+      std::atomic<size_t> peakInFlight{ 0 };
+      std::atomic<size_t> completions{ 0 };
+  };
+
+  FileIngest::Task<std::vector<uint8_t>> LoadFile(std::filesystem::path path, FileIngest::Sha256& hasher) {
+      std::ifstream input(path, std::ios::binary);
+      std::vector<uint8_t> bytes(static_cast<size_t>(std::filesystem::file_size(path)));
+      size_t filled = 0;
+      while (filled < bytes.size()) {
+          size_t toLoad = std::min(bytes.size() - filled, FileIngest::kDefaultChunkSize);
+          input.read(reinterpret_cast<char*>(bytes.data() + filled), static_cast<std::streamsize>(toLoad));
+          hasher.Update(bytes.data() + filled, toLoad);
+          filled += toLoad;
+      }
+      co_return bytes;
+  }
+
+  Detached ProcessFile(Batch& batch, std::filesystem::path path, size_t index) {
+      {
+          auto permit = co_await batch.semaphore.Acquire();
+          size_t inFlight = ++batch.inFlight;
+          size_t peak = batch.peakInFlight.load();
+          while (inFlight > peak && !batch.peakInFlight.compare_exchange_weak(peak, inFlight)) {
+          }
+          co_await batch.executor.Schedule();
+          FileIngest::Sha256 hasher;
+          std::vector<uint8_t> bytes = co_await LoadFile(path, hasher);
+          batch.digests[index] = hasher.Final();
+          std::string encoded;
+          FileIngest::Base64::EncodeTo(bytes.data(), bytes.size(), encoded);
+          batch.encodedLengths[index] = encoded.size();
+          batch.encodedBytes += encoded.size();
+          batch.inFlight--;
+      }
+
+      batch.completions++;
+      if (batch.countdown.Complete()) {
+          std::lock_guard<std::mutex> lock(batch.mutex);
+          batch.finished = true;
+          batch.done.notify_one();
+      }
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t fileCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+  size_t megabytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8;
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "pipeline-benchmark";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  std::vector<std::filesystem::path> files;
+  std::vector<FileIngest::Sha256Digest> expected;
+  std::mt19937_64 engine(7);
+  std::vector<uint64_t> content(megabytes * 1024 * 1024 / sizeof(uint64_t));
+  for (size_t i = 0; i < fileCount; i++) {
+      std::generate(content.begin(), content.end(), engine);
+      expected.push_back(FileIngest::Sha256::Hash(reinterpret_cast<const uint8_t*>(content.data()), content.size() * sizeof(uint64_t)));
+      files.push_back(directory / ("file" + std::to_string(i) + ".bin"));
+      std::ofstream(files.back(), std::ios::binary).write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size() * sizeof(uint64_t)));
+  }
+
+  size_t maxWorkers = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+  double baseline = 0;
+  std::printf("%8s %10s %12s %8s\n", "workers", "ms", "MB/s", "speedup");
+  for (size_t workers = 1; workers <= maxWorkers; workers *= 2) {
+      FileIngest::IoExecutor executor(workers, fileCount);
+      // Same ratio as the module: two files in flight per worker, so reads overlap encodes
+      Batch batch(executor, workers * 2, fileCount);
+
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < files.size(); i++) {
+          ProcessFile(batch, files[i], i);
+      }
+      {
+          std::unique_lock<std::mutex> lock(batch.mutex);
+          batch.done.wait(lock, [&]() { return batch.finished; });
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      double throughput = double(fileCount * megabytes) / seconds;
+      if (baseline == 0) {
+          baseline = throughput;
+      }
+      std::printf("%8zu %10.1f %12.1f %7.2fx\n", workers, seconds * 1e3, throughput, throughput / baseline);
+
+      Check(batch.digests == expected, "every file hashes to the digest of what was written");
+      size_t encodedLength = FileIngest::Base64::EncodedLength(content.size() * sizeof(uint64_t));
+      Check(std::all_of(batch.encodedLengths.begin(), batch.encodedLengths.end(), [&](size_t length) { return length == encodedLength; }), "every file is encoded whole");
+      Check(batch.encodedBytes == fileCount * encodedLength, "the batch encodes every file once");
+      Check(batch.peakInFlight <= workers * 2, "no more files are in flight than the semaphore allows");
+      Check(batch.completions == fileCount && batch.inFlight == 0, "the batch finishes after its last file");
+  }
+
+  std::filesystem::remove_all(directory);
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
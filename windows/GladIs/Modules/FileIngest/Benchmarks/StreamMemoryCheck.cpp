@@ -0,0 +1,139 @@
+// Bounded memory of the readFileDataStream path: streams a sparse file of several GiB through
+// StreamEncode, reading it with NativeFileSource one chunk at a time as the module does, and
+// checks that the peak resident set grows by no more than a couple of chunks over the whole run.
+// Also checks the summary and that every chunk decodes on its own. Exits non-zero when a check
+// fails. Linux only, it reads VmHWM from /proc and resets it through clear_refs:
+//
+//   g++ -std=c++20 -O2 -I.. StreamMemoryCheck.cpp -o stream-memory-check -pthread
+//   ./stream-memory-check [directory] [GiB] [chunk kilobytes]
+
+#include "Base64.h"
+#include "RangeSource.h"
+#include "StreamEncoder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  // Peak resident set since the last ResetPeak(), in bytes
+  uint64_t PeakResident() {
+      std::ifstream status("/proc/self/status");
+      std::string line;
+      while (std::getline(status, line)) {
+          if (line.rfind("VmHWM:", 0) == 0) {
+              return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+          }
+      }
+      return 0;
+  }
+
+  bool ResetPeak() {
+      std::ofstream clear("/proc/self/clear_refs");
+      clear << "5";
+      clear.flush();
+      return clear.good();
+  }
+
+  // A hole of `bytes` with a few written bytes spread over it, so reads are not all zeros
+  void WriteSparseFile(std::filesystem::path const& path, uint64_t bytes) {
+      int file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      Check(file >= 0, "the test file is created");
+      if (file < 0) {
+          return;
+      }
+      Check(::ftruncate(file, static_cast<off_t>(bytes)) == 0, "the test file is extended");
+      for (uint64_t offset = 0; offset < bytes; offset += 64ull * 1024 * 1024) {
+          char marker[32];
+          int length = std::snprintf(marker, sizeof(marker), "offset %llu", static_cast<unsigned long long>(offset));
+          Check(::pwrite(file, marker, static_cast<size_t>(length), static_cast<off_t>(offset)) == length, "markers are written");
+      }
+      ::close(file);
+  }
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path directory = argc > 1 ? argv[1] : std::filesystem::temp_directory_path() / "stream-memory-check";
+  uint64_t gibibytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2;
+  size_t chunkSize = FileIngest::NormalizeChunkSize(argc > 3 ? std::strtoull(argv[3], nullptr, 10) * 1024 : FileIngest::kDefaultChunkSize);
+  uint64_t fileSize = std::max<uint64_t>(gibibytes, 1) << 30;
+
+  std::filesystem::create_directories(directory);
+  std::filesystem::path path = directory / "sparse.bin";
+  WriteSparseFile(path, fileSize);
+
+  FileIngest::NativeFileSource source(path);
+  std::vector<uint8_t> decoded(chunkSize);
+  uint64_t expectedOffset = 0;
+  bool chunksDecode = true;
+  bool chunksInOrder = true;
+
+  // Warms up the allocator with one chunk's worth before measuring, so the ceiling is on the
+  // stream itself and not on the first-touch of malloc's arenas
+  {
+      std::string warm;
+      std::vector<uint8_t> block(chunkSize);
+      FileIngest::Base64::EncodeTo(block.data(), block.size(), warm);
+  }
+  bool resettable = ResetPeak();
+  uint64_t before = PeakResident();
+  auto start = std::chrono::steady_clock::now();
+  uint64_t offset = 0;
+  FileIngest::StreamSummary summary = FileIngest::StreamEncode(
+      [&](uint8_t* out, size_t capacity) {
+          size_t read = source.ReadAt(offset, out, capacity);
+          offset += read;
+          return read;
+      },
+      chunkSize,
+      [&](FileIngest::EncodedChunk const& chunk) {
+          chunksInOrder = chunksInOrder && chunk.offset == expectedOffset;
+          expectedOffset += chunk.byteLength;
+          // Sampled, decoding every chunk would double the run time and prove nothing more
+          if (chunk.index % 64 == 0) {
+              size_t length = FileIngest::Base64::Decode(chunk.data.data(), chunk.data.size(), decoded.data());
+              chunksDecode = chunksDecode && length == chunk.byteLength;
+          }
+      });
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  uint64_t after = PeakResident();
+  uint64_t growth = after > before ? after - before : 0;
+  // One raw and one encoded chunk, twice over for slack in the allocator
+  uint64_t ceiling = 2 * (chunkSize + FileIngest::Base64::EncodedLength(chunkSize));
+
+  std::printf("%-28s %8.2f GiB %10.1f MiB/s\n", "streamed", static_cast<double>(fileSize) / (1 << 30), static_cast<double>(fileSize) / (1 << 20) / seconds);
+  std::printf("%-28s %8.2f MiB (ceiling %.2f MiB)\n", "peak resident growth", static_cast<double>(growth) / (1 << 20), static_cast<double>(ceiling) / (1 << 20));
+  Check(resettable, "the peak resident set can be reset");
+  Check(summary.totalBytes == fileSize, "every byte is streamed");
+  Check(summary.encodedLength == FileIngest::Base64::EncodedLength(static_cast<size_t>(fileSize)), "the encoded length is that of the whole file");
+  Check(summary.chunkCount == (fileSize + chunkSize - 1) / chunkSize, "the file is cut in whole chunks");
+  Check(chunksInOrder, "chunks come in order without gaps");
+  Check(chunksDecode, "sampled chunks decode on their own");
+  Check(growth <= ceiling, "the peak resident set grows by no more than two chunks");
+
+  std::filesystem::remove_all(directory);
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
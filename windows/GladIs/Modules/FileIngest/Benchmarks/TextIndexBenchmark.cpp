@@ -0,0 +1,653 @@
+// Indexing throughput and query latency of the local full-text search behind searchDocuments,
+// over generated French and English PDFs: Flate content streams drawn with Tj and TJ in WinAnsi
+// fonts, composite fonts with ToUnicode maps, and pages packed in object streams behind a
+// cross-reference stream. Also checks inflate against the encoder in every framing, the
+// tokenizer's folding, text extraction, ranking, removal, reopening, merging and detection of
+// a damaged segment, and exits non-zero when one fails:
+//
+//   g++ -std=c++20 -O2 -I.. TextIndexBenchmark.cpp -o text-index-benchmark -pthread
+//   ./text-index-benchmark [directory] [documents]
+
+#include "Deflate.h"
+#include "Inflate.h"
+#include "PdfText.h"
+#include "TextIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+  using FileIngest::TextIndex;
+  using FileIngest::TextSearchHit;
+
+  int failures = 0;
+
+  void Check(bool condition, const char* what) {
+      if (!condition) {
+          std::printf("FAILED: %s\n", what);
+          failures++;
+      }
+  }
+
+  double Percentile(std::vector<double>& samples, double fraction) {
+      size_t at = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+      std::nth_element(samples.begin(), samples.begin() + static_cast<ptrdiff_t>(at), samples.end());
+      return samples[at];
+  }
+
+  std::vector<uint8_t> Compress(std::vector<uint8_t> const& input, FileIngest::Deflate::Level level, FileIngest::Deflate::Framing framing) {
+      FileIngest::Deflate::DeflateEncoder encoder(level, framing);
+      std::vector<uint8_t> out;
+      auto collect = [&out](const uint8_t* data, size_t length) { out.insert(out.end(), data, data + length); };
+      encoder.Write(input.data(), input.size(), collect);
+      encoder.Finish(collect);
+      return out;
+  }
+
+  template <typename Body>
+  bool Throws(Body&& body) {
+      try {
+          body();
+      } catch (FileIngest::InflateError const&) {
+          return true;
+      }
+      return false;
+  }
+
+  void InflateChecks() {
+      using namespace FileIngest::Deflate;
+      std::mt19937_64 engine(7);
+      std::vector<std::vector<uint8_t>> inputs(4);
+      for (size_t i = 0; i < 300000; i++) {
+          inputs[0].push_back(static_cast<uint8_t>("procédure qualité audit "[i % 26]));
+      }
+      for (size_t i = 0; i < 200000; i++) {
+          inputs[1].push_back(static_cast<uint8_t>(engine()));
+      }
+      for (size_t i = 0; i < 500000; i++) {
+          inputs[2].push_back(static_cast<uint8_t>(engine() % 7 == 0 ? engine() : i / 300));
+      }
+      bool roundTrips = true;
+      for (auto const& input : inputs) {
+          for (Level level : { Level::Fast, Level::Default }) {
+              for (Framing framing : { Framing::Raw, Framing::Gzip, Framing::Zlib }) {
+                  std::vector<uint8_t> compressed = Compress(input, level, framing);
+                  std::vector<uint8_t> output;
+                  try {
+                      Inflate(compressed.data(), compressed.size(), framing, output);
+                  } catch (FileIngest::InflateError const&) {
+                      roundTrips = false;
+                  }
+                  roundTrips = roundTrips && output == input;
+              }
+          }
+      }
+      Check(roundTrips, "inflate reads back what the encoder wrote, in every framing and level");
+
+      std::vector<uint8_t> zlib = Compress(inputs[2], Level::Fast, Framing::Zlib);
+      Check(zlib[0] == 0x78 && ((zlib[0] << 8) | zlib[1]) % 31 == 0, "zlib framing writes a valid RFC 1950 header");
+      std::vector<uint8_t> damaged = zlib;
+      damaged[damaged.size() / 2] ^= 0x10;
+      std::vector<uint8_t> output;
+      Check(Throws([&]() { Inflate(damaged.data(), damaged.size(), Framing::Zlib, output); }), "a damaged zlib stream is rejected");
+      damaged = zlib;
+      damaged[damaged.size() - 1] ^= 1;
+      output.clear();
+      Check(Throws([&]() { Inflate(damaged.data(), damaged.size(), Framing::Zlib, output); }) && output == inputs[2], "a bad Adler-32 is rejected after a full decode");
+      output.clear();
+      Check(Throws([&]() { Inflate(zlib.data(), zlib.size() / 3, Framing::Zlib, output); }) && !output.empty(), "a truncated stream throws and keeps what it decoded");
+      output.clear();
+      Check(Throws([&]() { Inflate(zlib.data(), zlib.size(), Framing::Zlib, output, 1000); }) && output.size() <= 1000, "output beyond the limit is refused");
+      std::vector<uint8_t> gzip = Compress(inputs[0], Level::Default, Framing::Gzip);
+      gzip[gzip.size() - 5] ^= 0xFF;
+      output.clear();
+      Check(Throws([&]() { Inflate(gzip.data(), gzip.size(), Framing::Gzip, output); }), "a bad gzip CRC is rejected");
+      std::vector<uint8_t> noise(4096);
+      for (uint8_t& byte : noise) {
+          byte = static_cast<uint8_t>(engine());
+      }
+      size_t survived = 0;
+      for (size_t start = 0; start < 512; start++) {
+          output.clear();
+          try {
+              Inflate(noise.data() + start, noise.size() - start, Framing::Raw, output, 1 << 20);
+              survived++;
+          } catch (FileIngest::InflateError const&) {
+          }
+      }
+      Check(survived < 512, "random bytes are mostly rejected as deflate");
+
+      auto start = std::chrono::steady_clock::now();
+      size_t bytes = 0;
+      std::vector<uint8_t> text = Compress(inputs[2], Level::Default, Framing::Zlib);
+      for (int round = 0; round < 20; round++) {
+          output.clear();
+          Inflate(text.data(), text.size(), Framing::Zlib, output);
+          bytes += output.size();
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::printf("%-30s %8.1f MB/s\n", "inflate", bytes / seconds / 1e6);
+  }
+
+  void TokenizerChecks() {
+      auto terms = [](std::string_view text) {
+          std::vector<std::string> out;
+          FileIngest::TokenizeText(text, [&out](std::string const& term) { out.push_back(term); });
+          return out;
+      };
+      Check(terms("L'Œuvre d’art des Procédures QUALITÉ") == std::vector<std::string>{ "oeuvre", "art", "procedure", "qualite" }, "accents, case, elisions, stop words and plurals are normalised");
+      Check(terms("jusqu'à l'audit qu'il a fait") == std::vector<std::string>{ "audit", "fait" }, "French elisions are dropped with their apostrophe");
+      Check(terms("The company's policies and the bateaux journaux") == std::vector<std::string>{ "company", "policy", "bateau", "journal" }, "English and French plurals reduce to the singular");
+      Check(terms("e\xcc\x81tude ﬁchier Straße v2 2024-05") == std::vector<std::string>{ "etude", "fichier", "strasse", "v2", "2024", "05" }, "combining marks, ligatures and digits are handled");
+      Check(terms("Rapport \xF0\x9F\x93\x84 d'audit") == std::vector<std::string>{ "rapport", "audit" }, "emoji separate words");
+  }
+
+  // ---- Generated PDFs ----
+
+  struct Vocabulary
+  {
+      std::vector<std::string> words;
+      std::vector<double> cumulative;
+
+      Vocabulary(size_t size, std::mt19937_64& engine) {
+          static constexpr const char* kCommon[] = { "procédure", "qualité", "audit", "réclamation", "fournisseur", "contrôle", "sécurité", "formation",
+              "document", "révision", "approuvé", "manuel", "responsable", "œuvre", "écart", "mesure", "process", "quality", "supplier", "training",
+              "incident", "corrective", "review", "calibration", "signature", "employee", "règlement", "hygiène", "équipement", "traçabilité" };
+          static constexpr const char* kSyllables[] = { "pro", "cé", "du", "re", "qua", "li", "té", "au", "dit", "ma", "nu", "el", "ges", "tion", "con",
+              "for", "mi", "sé", "cu", "ri", "po", "lac", "ver", "è", "an", "mé", "tro", "ca", "bel", "fi", "ch", "ô", "na", "zo", "ku", "ba" };
+          for (const char* word : kCommon) {
+              words.push_back(word);
+          }
+          while (words.size() < size) {
+              std::string word;
+              size_t parts = 2 + engine() % 3;
+              for (size_t i = 0; i < parts; i++) {
+                  word += kSyllables[engine() % std::size(kSyllables)];
+              }
+              words.push_back(word);
+          }
+          double total = 0;
+          for (size_t i = 0; i < words.size(); i++) {
+              total += 1.0 / (i + 1);
+              cumulative.push_back(total);
+          }
+      }
+
+      // Zipf-distributed, so a few words are in every document and most in few
+      std::string const& Pick(std::mt19937_64& engine) const {
+          double point = std::uniform_real_distribution<double>(0, cumulative.back())(engine);
+          return words[std::lower_bound(cumulative.begin(), cumulative.end(), point) - cumulative.begin()];
+      }
+  };
+
+  // Decodes UTF-8 that is known to be valid
+  std::vector<uint32_t> CodePoints(std::string_view text) {
+      std::vector<uint32_t> out;
+      for (size_t i = 0; i < text.size();) {
+          out.push_back(FileIngest::detail::NextCodePoint(text, i));
+      }
+      return out;
+  }
+
+  enum class PdfFlavour
+  {
+      // Simple font, literal strings with text bytes as they are
+      WinAnsi,
+      // Simple font, literal strings with octal escapes above ASCII
+      WinAnsiOctal,
+      // Type0 font with two-byte codes, hex strings and a ToUnicode map
+      Composite,
+      // WinAnsi, with the page and font packed in an object stream and a cross-reference stream
+      ObjectStream,
+  };
+
+  class PdfWriter
+  {
+  public:
+      size_t Add(std::string body) {
+          m_bodies.push_back(std::move(body));
+          return m_bodies.size();
+      }
+
+      void Set(size_t number, std::string body) {
+          m_bodies[number - 1] = std::move(body);
+      }
+
+      static std::string Stream(std::string dictionary, std::vector<uint8_t> const& data) {
+          std::string body = "<< " + dictionary + " /Length " + std::to_string(data.size()) + " >>\nstream\n";
+          body.append(data.begin(), data.end());
+          body += "\nendstream";
+          return body;
+      }
+
+      // Classic xref table and trailer, or with `packed` objects inside object stream
+      // `objectStream` and a cross-reference stream instead
+      std::vector<uint8_t> Finish(size_t root, std::vector<size_t> const& packed = {}, size_t objectStream = 0) {
+          std::string file = "%PDF-1.5\n%\xE2\xE3\xCF\xD3\n";
+          std::vector<size_t> offsets(m_bodies.size() + 1, 0);
+          for (size_t i = 0; i < m_bodies.size(); i++) {
+              if (m_bodies[i].empty()) {
+                  continue;
+              }
+              offsets[i + 1] = file.size();
+              file += std::to_string(i + 1) + " 0 obj\n" + m_bodies[i] + "\nendobj\n";
+          }
+          if (packed.empty()) {
+              size_t xref = file.size();
+              file += "xref\n0 " + std::to_string(m_bodies.size() + 1) + "\n0000000000 65535 f \n";
+              for (size_t i = 1; i <= m_bodies.size(); i++) {
+                  char line[32];
+                  std::snprintf(line, sizeof(line), "%010zu 00000 n \n", offsets[i]);
+                  file += line;
+              }
+              file += "trailer\n<< /Size " + std::to_string(m_bodies.size() + 1) + " /Root " + std::to_string(root) + " 0 R >>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+          } else {
+              size_t xrefNumber = m_bodies.size() + 1;
+              size_t xref = file.size();
+              std::vector<uint8_t> entries;
+              auto entry = [&entries](uint8_t type, uint32_t field2, uint16_t field3) {
+                  entries.push_back(type);
+                  for (int shift = 24; shift >= 0; shift -= 8) {
+                      entries.push_back(static_cast<uint8_t>(field2 >> shift));
+                  }
+                  entries.push_back(static_cast<uint8_t>(field3 >> 8));
+                  entries.push_back(static_cast<uint8_t>(field3));
+              };
+              entry(0, 0, 65535);
+              for (size_t i = 1; i <= m_bodies.size(); i++) {
+                  auto found = std::find(packed.begin(), packed.end(), i);
+                  if (found != packed.end()) {
+                      entry(2, static_cast<uint32_t>(objectStream), static_cast<uint16_t>(found - packed.begin()));
+                  } else {
+                      entry(1, static_cast<uint32_t>(offsets[i]), 0);
+                  }
+              }
+              entry(1, static_cast<uint32_t>(xref), 0);
+              std::string dictionary = "/Type /XRef /Size " + std::to_string(xrefNumber + 1) + " /W [1 4 2] /Root " + std::to_string(root) + " 0 R";
+              file += std::to_string(xrefNumber) + " 0 obj\n" + Stream(dictionary, entries) + "\nendobj\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+          }
+          return std::vector<uint8_t>(file.begin(), file.end());
+      }
+
+  private:
+      std::vector<std::string> m_bodies;
+  };
+
+  std::string LiteralString(std::vector<uint32_t> const& text, bool octal) {
+      std::string out = "(";
+      for (uint32_t c : text) {
+          uint8_t byte = c == 0x0153 ? 0x9C : c == 0x2019 ? 0x92 : c < 256 ? static_cast<uint8_t>(c) : '?';
+          if (byte == '(' || byte == ')' || byte == '\\') {
+              out.push_back('\\');
+              out.push_back(static_cast<char>(byte));
+          } else if (byte >= 0x80 && octal) {
+              char escaped[8];
+              std::snprintf(escaped, sizeof(escaped), "\\%03o", byte);
+              out += escaped;
+          } else {
+              out.push_back(static_cast<char>(byte));
+          }
+      }
+      return out + ")";
+  }
+
+  // Glyph ids of the composite font: a-z as one range, anything else numbered as it appears
+  struct GlyphMap
+  {
+      std::vector<uint32_t> others;
+
+      uint32_t Glyph(uint32_t c) {
+          if (c >= 'a' && c <= 'z') {
+              return 0x100 + (c - 'a');
+          }
+          auto found = std::find(others.begin(), others.end(), c);
+          if (found == others.end()) {
+              others.push_back(c);
+              found = others.end() - 1;
+          }
+          return 1 + static_cast<uint32_t>(found - others.begin());
+      }
+
+      std::string HexString(std::vector<uint32_t> const& text) {
+          std::string out = "<";
+          for (uint32_t c : text) {
+              char code[8];
+              std::snprintf(code, sizeof(code), "%04X", Glyph(c));
+              out += code;
+          }
+          return out + ">";
+      }
+
+      std::string ToUnicode() const {
+          std::string cmap = "/CIDInit /ProcSet findresource begin 12 dict begin begincmap\n/CMapName /Generated def\n"
+              "1 begincodespacerange <0000> <FFFF> endcodespacerange\n";
+          cmap += std::to_string(others.size()) + " beginbfchar\n";
+          for (size_t i = 0; i < others.size(); i++) {
+              char line[64];
+              if (others[i] >= 0x10000) {
+                  uint32_t v = others[i] - 0x10000;
+                  std::snprintf(line, sizeof(line), "<%04zX> <%04X%04X>\n", i + 1, 0xD800 + (v >> 10), 0xDC00 + (v & 0x3FF));
+              } else {
+                  std::snprintf(line, sizeof(line), "<%04zX> <%04X>\n", i + 1, others[i]);
+              }
+              cmap += line;
+          }
+          cmap += "endbfchar\n1 beginbfrange\n<0100> <0119> <0061>\nendbfrange\nendcmap CMapName currentdict /CMap defineresource pop end end\n";
+          return cmap;
+      }
+  };
+
+  std::vector<uint8_t> Deflated(std::string const& text) {
+      std::vector<uint8_t> input(text.begin(), text.end());
+      return Compress(input, FileIngest::Deflate::Level::Fast, FileIngest::Deflate::Framing::Zlib);
+  }
+
+  // One page per 40 lines of ten words; even lines are drawn with Tj, odd ones with TJ and
+  // kerned gaps between the words
+  std::vector<uint8_t> MakePdf(std::vector<std::string> const& words, PdfFlavour flavour) {
+      GlyphMap glyphs;
+      bool composite = flavour == PdfFlavour::Composite;
+      auto show = [&](std::string const& text) {
+          std::vector<uint32_t> codePoints = CodePoints(text);
+          return composite ? glyphs.HexString(codePoints) : LiteralString(codePoints, flavour == PdfFlavour::WinAnsiOctal);
+      };
+      std::vector<std::string> pages;
+      for (size_t first = 0; first < words.size(); first += 400) {
+          std::string content = "BT\n/F1 11 Tf 14 TL 72 760 Td\n";
+          for (size_t line = first; line < std::min(words.size(), first + 400); line += 10) {
+              size_t end = std::min(words.size(), line + 10);
+              if ((line / 10) % 2 == 0) {
+                  std::string text;
+                  for (size_t i = line; i < end; i++) {
+                      text += (i > line ? " " : "") + words[i];
+                  }
+                  content += show(text) + " Tj\n0 -14 Td\n";
+              } else {
+                  content += "[";
+                  for (size_t i = line; i < end; i++) {
+                      content += show(words[i]) + (i + 1 < end ? " -250 " : "");
+                  }
+                  content += "] TJ\nT*\n";
+              }
+          }
+          content += "ET\n";
+          pages.push_back(std::move(content));
+      }
+
+      PdfWriter writer;
+      size_t catalog = writer.Add("");
+      size_t tree = writer.Add("");
+      size_t font = writer.Add("");
+      std::vector<size_t> pageNumbers;
+      std::string kids;
+      for (std::string const& content : pages) {
+          size_t contents = writer.Add(PdfWriter::Stream("/Filter /FlateDecode", Deflated(content)));
+          size_t page = writer.Add("<< /Type /Page /Parent " + std::to_string(tree) + " 0 R /MediaBox [0 0 612 792] /Resources << /Font << /F1 " + std::to_string(font) + " 0 R >> >> /Contents " + std::to_string(contents) + " 0 R >>");
+          pageNumbers.push_back(page);
+          kids += std::to_string(page) + " 0 R ";
+      }
+      writer.Set(catalog, "<< /Type /Catalog /Pages " + std::to_string(tree) + " 0 R >>");
+      writer.Set(tree, "<< /Type /Pages /Kids [" + kids + "] /Count " + std::to_string(pages.size()) + " >>");
+      if (composite) {
+          size_t toUnicode = writer.Add(PdfWriter::Stream("/Filter /FlateDecode", Deflated(glyphs.ToUnicode())));
+          writer.Set(font, "<< /Type /Font /Subtype /Type0 /BaseFont /Generated /Encoding /Identity-H /DescendantFonts [] /ToUnicode " + std::to_string(toUnicode) + " 0 R >>");
+      } else {
+          writer.Set(font, "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>");
+      }
+      if (flavour != PdfFlavour::ObjectStream) {
+          return writer.Finish(catalog);
+      }
+
+      // Moves the font and pages into an object stream
+      std::vector<size_t> packed = { font };
+      packed.insert(packed.end(), pageNumbers.begin(), pageNumbers.end());
+      std::string header;
+      std::string objects;
+      std::vector<std::string> bodies = { "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>" };
+      for (size_t page : pageNumbers) {
+          size_t contents = page - 1;
+          bodies.push_back("<< /Type /Page /Parent " + std::to_string(tree) + " 0 R /Resources << /Font << /F1 " + std::to_string(font) + " 0 R >> >> /Contents " + std::to_string(contents) + " 0 R >>");
+      }
+      for (size_t i = 0; i < packed.size(); i++) {
+          header += std::to_string(packed[i]) + " " + std::to_string(objects.size()) + " ";
+          objects += bodies[i] + "\n";
+          writer.Set(packed[i], "");
+      }
+      size_t objectStream = writer.Add(PdfWriter::Stream("/Type /ObjStm /N " + std::to_string(packed.size()) + " /First " + std::to_string(header.size()) + " /Filter /FlateDecode", Deflated(header + objects)));
+      return writer.Finish(catalog, packed, objectStream);
+  }
+
+  struct Corpus
+  {
+      std::vector<std::vector<uint8_t>> files;
+      std::vector<std::vector<std::string>> words;
+      uint64_t bytes = 0;
+  };
+
+  // Document i holds its own marker word "ref<i>" among Zipf-distributed words
+  Corpus MakeCorpus(size_t count, Vocabulary const& vocabulary, std::mt19937_64& engine) {
+      Corpus corpus;
+      for (size_t i = 0; i < count; i++) {
+          size_t length = 150 + engine() % 700;
+          std::vector<std::string> words;
+          for (size_t w = 0; w < length; w++) {
+              words.push_back(vocabulary.Pick(engine));
+          }
+          words[engine() % length] = "ref" + std::to_string(i);
+          corpus.files.push_back(MakePdf(words, static_cast<PdfFlavour>(i % 4)));
+          corpus.bytes += corpus.files.back().size();
+          corpus.words.push_back(std::move(words));
+      }
+      return corpus;
+  }
+
+  std::string Key(size_t i) {
+      return "document-" + std::to_string(i);
+  }
+
+  bool TopHit(TextIndex& index, std::string const& query, std::string const& key) {
+      std::vector<TextSearchHit> hits = index.Search(query, 5, false);
+      return !hits.empty() && hits[0].key == key;
+  }
+
+  void ExtractionChecks(Vocabulary const& vocabulary, std::mt19937_64& engine) {
+      std::vector<std::string> words = { "Procédure", "qualité", "l’œuvre", "contrôle", "d'audit", "Straße", "(parenthèses)", "back\\slash" };
+      for (size_t i = 0; i < 500; i++) {
+          words.push_back(vocabulary.Pick(engine));
+      }
+      std::string expected;
+      for (std::string const& word : words) {
+          expected += (expected.empty() ? "" : " ") + word;
+      }
+      std::vector<std::string> terms;
+      FileIngest::TokenizeText(expected, [&terms](std::string const& term) { terms.push_back(term); });
+      const char* names[] = { "text of WinAnsi pages is extracted", "text of octal-escaped pages is extracted", "text of ToUnicode composite fonts is extracted", "text of pages in object streams is extracted" };
+      for (int flavour = 0; flavour < 4; flavour++) {
+          std::vector<uint8_t> pdf = MakePdf(words, static_cast<PdfFlavour>(flavour));
+          std::vector<std::string> extracted;
+          try {
+              std::string text = FileIngest::ExtractPdfText(pdf.data(), pdf.size());
+              FileIngest::TokenizeText(text, [&extracted](std::string const& term) { extracted.push_back(term); });
+          } catch (FileIngest::PdfError const& e) {
+              std::printf("%s\n", e.what());
+          }
+          Check(extracted == terms, names[flavour]);
+      }
+
+      std::vector<uint8_t> pdf = MakePdf(words, PdfFlavour::WinAnsi);
+      // Cut inside the last content stream, losing the last page, the xref table and the trailer
+      std::string_view whole(reinterpret_cast<const char*>(pdf.data()), pdf.size());
+      std::vector<uint8_t> truncated(pdf.begin(), pdf.begin() + static_cast<ptrdiff_t>(whole.rfind("stream\n") + 20));
+      bool partial = false;
+      try {
+          partial = !FileIngest::ExtractPdfText(truncated.data(), truncated.size()).empty();
+      } catch (FileIngest::PdfError const&) {
+      }
+      Check(partial, "a truncated PDF yields the text that survived");
+      std::string notPdf = "PK\x03\x04 not a pdf";
+      bool rejected = false;
+      try {
+          FileIngest::ExtractPdfText(reinterpret_cast<const uint8_t*>(notPdf.data()), notPdf.size());
+      } catch (FileIngest::PdfError const&) {
+          rejected = true;
+      }
+      Check(rejected, "data that is not a PDF is rejected");
+      // Damage anywhere must never crash or hang extraction
+      size_t survived = 0;
+      for (size_t round = 0; round < 200; round++) {
+          std::vector<uint8_t> damaged = MakePdf(std::vector<std::string>(words.begin(), words.begin() + 60), static_cast<PdfFlavour>(round % 4));
+          for (int flips = 0; flips < 8; flips++) {
+              damaged[engine() % damaged.size()] = static_cast<uint8_t>(engine());
+          }
+          try {
+              FileIngest::ExtractPdfText(damaged.data(), damaged.size());
+              survived++;
+          } catch (FileIngest::PdfError const&) {
+          }
+      }
+      std::printf("%-30s %zu of 200 damaged files read\n", "damaged extraction", survived);
+  }
+
+  void IndexChecks(std::filesystem::path const& directory, size_t documents) {
+      std::filesystem::remove_all(directory);
+      std::mt19937_64 engine(42);
+      Vocabulary vocabulary(4000, engine);
+      ExtractionChecks(vocabulary, engine);
+      Corpus corpus = MakeCorpus(documents, vocabulary, engine);
+
+      // Indexing: extraction, tokenizing and a commit every 250 documents, as a sync would
+      size_t batch = 250;
+      auto start = std::chrono::steady_clock::now();
+      double extractSeconds = 0;
+      {
+          TextIndex index(directory);
+          for (size_t i = 0; i < documents; i++) {
+              auto before = std::chrono::steady_clock::now();
+              std::string text = FileIngest::ExtractPdfText(corpus.files[i].data(), corpus.files[i].size());
+              extractSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+              index.Add(Key(i), text);
+              if ((i + 1) % batch == 0) {
+                  index.Commit();
+              }
+          }
+          index.Commit();
+          double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+          FileIngest::TextIndexStats stats = index.Stats();
+          std::printf("%-30s %8zu docs %8.1f MB  %8.0f docs/s %8.1f MB/s (extraction %.1f MB/s)\n", "indexing", documents, corpus.bytes / 1e6, documents / seconds,
+              corpus.bytes / seconds / 1e6, corpus.bytes / extractSeconds / 1e6);
+          std::printf("%-30s %8llu docs %8llu segments %8llu terms %8.1f MB on disk, %llu merges\n", "index", static_cast<unsigned long long>(stats.documents),
+              static_cast<unsigned long long>(stats.segments), static_cast<unsigned long long>(stats.terms), stats.diskBytes / 1e6, static_cast<unsigned long long>(stats.merges));
+          Check(stats.documents == documents, "every document is live");
+          Check(stats.segments <= TextIndex::kMaxSegments, "segments are merged once there are too many");
+          Check(documents < batch * (TextIndex::kMaxSegments + 1) || stats.merges > 0, "a merge ran");
+
+          bool markers = true;
+          for (size_t i = 0; i < documents; i += std::max<size_t>(1, documents / 200)) {
+              markers = markers && TopHit(index, "ref" + std::to_string(i), Key(i));
+          }
+          Check(markers, "a document's own marker word ranks it first");
+          std::string const& rare = corpus.words[1][0];
+          Check(TopHit(index, "ref1 " + rare, Key(1)), "the document with every query term ranks first");
+
+          std::vector<TextSearchHit> folded = index.Search("PROCÉDURES Qualité", 20);
+          std::vector<TextSearchHit> plain = index.Search("procedure qualite", 20);
+          bool same = folded.size() == plain.size() && !folded.empty();
+          for (size_t i = 0; same && i < folded.size(); i++) {
+              same = folded[i].key == plain[i].key;
+          }
+          Check(same, "accents, case and plurals do not change results");
+          Check(!index.Search("ref12", 50, true).empty() && index.Search("ref12", 50, true).size() > index.Search("ref12", 50, false).size() - (documents > 120 ? 0 : 1),
+              "the last query term matches as a prefix while typing");
+
+          // Query latency over one to three Zipf-distributed words
+          std::vector<double> samples;
+          for (size_t q = 0; q < 2000; q++) {
+              std::string query;
+              size_t terms = 1 + engine() % 3;
+              for (size_t t = 0; t < terms; t++) {
+                  query += vocabulary.Pick(engine) + " ";
+              }
+              if (q % 2 == 0) {
+                  query.pop_back();
+              }
+              auto before = std::chrono::steady_clock::now();
+              index.Search(query, 20);
+              samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count());
+          }
+          double p50 = Percentile(samples, 0.50);
+          double p99 = Percentile(samples, 0.99);
+          std::printf("%-30s %8zu queries  p50 %8.3f ms  p99 %8.3f ms\n", "search", samples.size(), p50, p99);
+          Check(p99 < 50, "queries answer within milliseconds");
+
+          index.Remove(Key(3));
+          index.Add(Key(4), "remplacé par une nouvelle version");
+          index.Commit();
+          Check(index.Search("ref3", 5, false).empty(), "a removed document is not found");
+          Check(index.Search("ref4", 5, false).empty() && TopHit(index, "nouvelle version", Key(4)), "a re-added document replaces its earlier text");
+          Check(index.Stats().documents == documents - 1, "removal and replacement keep the live count right");
+      }
+
+      {
+          TextIndex index(directory);
+          Check(index.Stats().documents == documents - 1 && TopHit(index, "ref7", Key(7)) && index.Search("ref3", 5, false).empty(), "a reopened index answers as before");
+          index.Add("late", "document ajouté après réouverture");
+          index.Commit();
+          Check(TopHit(index, "ajoute reouverture", "late"), "documents added after reopening are found");
+          std::vector<TextSearchHit> before = index.Search("qualité audit", 50);
+          index.Merge();
+          std::vector<TextSearchHit> after = index.Search("qualité audit", 50);
+          bool same = before.size() == after.size() && index.Stats().segments == 1;
+          for (size_t i = 0; same && i < before.size(); i++) {
+              same = before[i].key == after[i].key;
+          }
+          Check(same, "a merge keeps the results");
+          Check(index.Search("ref3", 5, false).empty() && index.Stats().documents == documents, "a merge drops removed documents");
+      }
+
+      // Damage in a segment is caught when the index opens
+      std::filesystem::path segment;
+      for (auto const& entry : std::filesystem::directory_iterator(directory)) {
+          if (entry.path().extension() == ".seg") {
+              segment = entry.path();
+          }
+      }
+      {
+          std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+          file.seekp(static_cast<std::streamoff>(std::filesystem::file_size(segment) / 2));
+          file.put('\x5A');
+      }
+      bool detected = false;
+      try {
+          TextIndex index(directory);
+      } catch (FileIngest::TextIndexError const&) {
+          detected = true;
+      }
+      Check(detected, "a damaged segment is detected");
+      std::filesystem::remove_all(directory);
+  }
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path directory = argc > 1 ? argv[1] : std::filesystem::temp_directory_path() / "text-index-benchmark";
+  size_t documents = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5000;
+
+  InflateChecks();
+  TokenizerChecks();
+  IndexChecks(directory, std::max<size_t>(documents, 20));
+
+  if (failures != 0) {
+      std::printf("%d check(s) failed\n", failures);
+      return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,134 @@
+// Cost of the FileOpenPicker tracing on the base64 encode hot path, plus a consistency check of
+// the event ring under concurrent writers and readers. The module times one encode per file or
+// per streamed chunk, so the default chunk is kDefaultChunkSize. Exits non-zero when tracing
+// costs 1% or more of an encode, or when a torn event is read back:
+//
+//   g++ -std=c++20 -O2 -pthread -I.. TraceBenchmark.cpp -o trace-benchmark
+//   ./trace-benchmark [chunk kilobytes] [chunks]
+
+#include "Base64.h"
+#include "StreamEncoder.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  void Check(bool condition, const char* message) {
+      if (!condition) {
+          std::fprintf(stderr, "FAILED: %s\n", message);
+          std::exit(1);
+      }
+  }
+
+  template <typename Body>
+  double BestSeconds(size_t rounds, Body&& body) {
+      double best = 1e30;
+      for (size_t round = 0; round < rounds; round++) {
+          auto start = std::chrono::steady_clock::now();
+          body();
+          best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      }
+      return best;
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t chunkBytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) * 1024 : FileIngest::kDefaultChunkSize;
+  size_t chunks = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 128;
+
+  std::vector<uint8_t> data(chunkBytes);
+  std::mt19937_64 engine(5);
+  std::generate(data.begin(), data.end(), [&]() { return static_cast<uint8_t>(engine()); });
+  std::string encoded;
+
+  // Timer cost on its own, against an encode of one chunk
+  FileIngest::Tracer tracer;
+  const size_t timerIterations = 1000000;
+  double timerSeconds = BestSeconds(5, [&]() {
+      for (size_t i = 0; i < timerIterations; i++) {
+          FileIngest::StageTimer timer(tracer, FileIngest::TraceStage::Encode, 1, chunkBytes);
+          timer.Stop();
+      }
+  });
+  double encodeSeconds = BestSeconds(5, [&]() {
+      for (size_t i = 0; i < chunks; i++) {
+          FileIngest::Base64::EncodeTo(data.data(), data.size(), encoded);
+      }
+  });
+  double tracedSeconds = BestSeconds(5, [&]() {
+      for (size_t i = 0; i < chunks; i++) {
+          FileIngest::StageTimer timer(tracer, FileIngest::TraceStage::Encode, 1, chunkBytes);
+          FileIngest::Base64::EncodeTo(data.data(), data.size(), encoded);
+          timer.Stop();
+      }
+  });
+
+  double timerNanos = timerSeconds * 1e9 / timerIterations;
+  double encodeNanos = encodeSeconds * 1e9 / chunks;
+  double overhead = timerNanos / encodeNanos * 100;
+  std::printf("stage timer              %8.1f ns\n", timerNanos);
+  std::printf("encode %4zu KiB chunk     %8.1f us\n", chunkBytes / 1024, encodeNanos / 1e3);
+  std::printf("timer / encode           %8.3f %%\n", overhead);
+  std::printf("measured traced encode   %+8.3f %% (noise included)\n", (tracedSeconds / encodeSeconds - 1) * 100);
+  Check(overhead < 1.0, "tracing costs under 1% of an encode");
+
+  // Writers record events whose fields are derived from one another; a reader must never see
+  // a mix of two events
+  FileIngest::Tracer ring(1024);
+  const size_t writerCount = 4;
+  const size_t eventsPerWriter = 200000;
+  std::atomic<bool> writing{ true };
+  std::atomic<bool> torn{ false };
+  std::atomic<size_t> eventsRead{ 0 };
+  std::thread reader([&]() {
+      while (writing.load()) {
+          for (FileIngest::TraceEvent const& event : ring.RecentEvents()) {
+              if (event.durationNanos != event.startNanos * 3 + 1 || event.bytes != (event.startNanos ^ event.requestTag) || event.stage != FileIngest::TraceStage::Load) {
+                  torn = true;
+              }
+              eventsRead++;
+          }
+      }
+  });
+  std::vector<std::thread> writers;
+  for (size_t w = 0; w < writerCount; w++) {
+      writers.emplace_back([&, w]() {
+          for (uint64_t i = 0; i < eventsPerWriter; i++) {
+              uint64_t start = (w << 40) | i;
+              uint32_t tag = static_cast<uint32_t>(w * 7919 + 1);
+              ring.Record(FileIngest::TraceStage::Load, tag, start, start * 3 + 1, start ^ tag, false);
+          }
+      });
+  }
+  for (auto& writer : writers) {
+      writer.join();
+  }
+  writing = false;
+  reader.join();
+  Check(!torn, "no torn event is read back");
+  FileIngest::StageStats stats = ring.Stats(FileIngest::TraceStage::Load);
+  Check(stats.count == writerCount * eventsPerWriter, "every event is counted");
+  uint64_t histogramTotal = 0;
+  for (auto const& sizeClass : stats.histogram) {
+      for (uint64_t bucket : sizeClass) {
+          histogramTotal += bucket;
+      }
+  }
+  Check(histogramTotal == stats.count, "every event lands in one histogram bucket");
+  Check(ring.RecentEvents().size() == 1024, "the ring keeps the most recent events");
+  std::printf("ring check               %zu events read back by a concurrent reader\n", eventsRead.load());
+
+  std::string json = tracer.ToChromeTraceJson();
+  Check(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[{\"name\":\"encode\"", 0) == 0 && json.back() == '}', "trace JSON has the Chrome trace-event shape");
+  std::printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Stand-in for the backend's JSON API, as APIService calls it.
+
+Answers over HTTP/1.1 keep-alive connections, or closes after each answer when the client asks
+with Connection: close:
+    POST /documents/paginated/path?page=<n>&perPage=<n>  with {"value": <path>}
+        a page of the folder's documents, {"documents": [...], "pageCount": <n>}
+    GET /documents/<id>
+        one document
+    GET /users/<id>
+        one user
+
+Document and user names carry accents and emoji, which json.dumps escapes as \\u sequences and
+surrogate pairs, so a client's JSON parser has to decode them.
+
+Query parameters shape the network and the server:
+    latency=<milliseconds>    delay before each answer, as a round trip adds
+    handshake=<milliseconds>  extra delay before the first answer on a connection, standing in
+                              for the TCP and TLS round trips of opening it over a real link
+
+GET /stats answers {"requests": ..., "connections": ...} counted since the start, without
+counting itself.
+
+    python3 api_stand_in_server.py --serve 8080
+        serves until interrupted, e.g. for the Windows app pointed at http://<host>:8080
+    python3 api_stand_in_server.py ./http-client-benchmark [args...]
+        serves on a free port, runs the command with the port appended and exits with its status
+"""
+
+import json
+import http.server
+import subprocess
+import sys
+import threading
+import time
+import urllib.parse
+
+STATUSES = ["draft", "pendingReview", "underReview", "approved", "rejected", "archived"]
+NAMES = ["Procédure qualité", "Rapport d'audit \U0001F4C4", "Fiche de poste", "Plan d’action ✓", "Manuel \"MQ\" v2"]
+PAGE_COUNT = 40
+
+stats = {"requests": 0, "connections": 0}
+stats_lock = threading.Lock()
+
+
+def document(number, path):
+    return {
+        "id": "%08x-0000-4000-8000-%012x" % (number, number * 7919),
+        "name": "%s %d" % (NAMES[number % len(NAMES)], number),
+        "path": path,
+        "lastModified": "2024-%02d-%02dT10:%02d:00Z" % (number % 12 + 1, number % 28 + 1, number % 60),
+        "status": STATUSES[number % len(STATUSES)],
+        "size": number * 1531 % 5000000,
+        "score": number / 7,
+    }
+
+
+def user(number):
+    return {
+        "id": "%08x-1111-4000-8000-%012x" % (number, number * 104729),
+        "firstName": "Zoé",
+        "lastName": "Müller-%d" % number,
+        "email": "user%d@example.com" % number,
+        "userType": ["admin", "client", "employee"][number % 3],
+        "isBlocked": number % 5 == 0,
+        "companyName": None if number % 2 else "Société %d \U0001F3E2" % number,
+    }
+
+
+class ApiHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    # The head and the body go out in two writes; with Nagle the body would wait for the
+    # client's delayed ACK on a kept-alive connection
+    disable_nagle_algorithm = True
+
+    def setup(self):
+        super().setup()
+        self.answered = 0
+        with stats_lock:
+            stats["connections"] += 1
+
+    def do_GET(self):
+        self.handle_request(None)
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", "0"))
+        body = self.rfile.read(length) if length > 0 else b""
+        try:
+            self.handle_request(json.loads(body) if body else {})
+        except ValueError:
+            self.reply(400, {"reason": "Invalid JSON body"})
+
+    def handle_request(self, body):
+        url = urllib.parse.urlsplit(self.path)
+        query = {name: values[-1] for name, values in urllib.parse.parse_qs(url.query).items()}
+        if url.path == "/stats":
+            with stats_lock:
+                return self.reply(200, stats)
+        with stats_lock:
+            stats["requests"] += 1
+        delay = float(query.get("latency", "0"))
+        if self.answered == 0:
+            delay += float(query.get("handshake", "0"))
+        time.sleep(delay / 1000)
+
+        parts = url.path.strip("/").split("/")
+        if body is not None and url.path == "/documents/paginated/path":
+            page = int(query.get("page", "1"))
+            per_page = int(query.get("perPage", "20"))
+            first = (page - 1) * per_page
+            payload = {
+                "documents": [document(first + i, body.get("value", "")) for i in range(per_page)],
+                "pageCount": PAGE_COUNT,
+            }
+            return self.reply(200, payload)
+        if body is None and len(parts) == 2 and parts[0] == "documents" and parts[1].isdigit():
+            return self.reply(200, document(int(parts[1]), "/documents"))
+        if body is None and len(parts) == 2 and parts[0] == "users" and parts[1].isdigit():
+            return self.reply(200, user(int(parts[1])))
+        return self.reply(404, {"reason": "Not found"})
+
+    def reply(self, status, payload):
+        body = json.dumps(payload).encode("ascii")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json; charset=utf-8")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+        self.answered += 1
+
+    def log_message(self, format, *args):
+        pass
+
+
+class Server(http.server.ThreadingHTTPServer):
+    daemon_threads = True
+    request_queue_size = 128
+
+    def handle_error(self, request, client_address):
+        pass
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    if argv[1] == "--serve":
+        server = Server(("", int(argv[2]) if len(argv) > 2 else 8080), ApiHandler)
+        server.serve_forever()
+        return 0
+    server = Server(("127.0.0.1", 0), ApiHandler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        return subprocess.call(argv[1:] + [str(server.server_address[1])])
+    finally:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
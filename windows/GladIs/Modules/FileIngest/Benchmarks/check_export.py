@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""Cross-checks the two exports of export-benchmark against independent readers.
+
+The XLSX must be a zip whose CRCs hold, with a worksheet that parses as XML, and its cells must
+read back as exactly the fields Python's csv module reads from the CSV export.
+
+    python3 check_export.py ./export-benchmark [rows]
+"""
+
+import csv
+import io
+import os
+import subprocess
+import sys
+import tempfile
+import xml.etree.ElementTree as ElementTree
+import zipfile
+
+NAMESPACE = "{http://schemas.openxmlformats.org/spreadsheetml/2006/main}"
+
+
+def xlsx_rows(path):
+    with zipfile.ZipFile(path) as archive:
+        broken = archive.testzip()
+        if broken is not None:
+            raise AssertionError("bad CRC in " + broken)
+        for name in ("[Content_Types].xml", "_rels/.rels", "xl/workbook.xml", "xl/_rels/workbook.xml.rels"):
+            ElementTree.fromstring(archive.read(name))
+        with archive.open("xl/worksheets/sheet1.xml") as sheet:
+            for _, element in ElementTree.iterparse(sheet):
+                if element.tag != NAMESPACE + "row":
+                    continue
+                row = []
+                for cell in element:
+                    value = cell.find(NAMESPACE + "v")
+                    text = cell.find(NAMESPACE + "is/" + NAMESPACE + "t")
+                    if value is not None:
+                        row.append(value.text)
+                    else:
+                        row.append((text.text or "") if text is not None else "")
+                element.clear()
+                yield row
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    rows = argv[2] if len(argv) > 2 else "20000"
+    with tempfile.TemporaryDirectory() as directory:
+        subprocess.run([argv[1], rows, directory], check=True, stdout=subprocess.DEVNULL)
+        with open(os.path.join(directory, "export.csv"), encoding="utf-8-sig", newline="") as file:
+            csv_rows = list(csv.reader(file))
+        count = 0
+        for expected, actual in zip(csv_rows, xlsx_rows(os.path.join(directory, "export.xlsx"))):
+            if expected != actual:
+                print("row %d differs:\n  csv  %r\n  xlsx %r" % (count, expected, actual))
+                return 1
+            count += 1
+        if count != len(csv_rows) or count != int(rows) + 1:
+            print("expected %d rows, csv has %d, xlsx %d" % (int(rows) + 1, len(csv_rows), count))
+            return 1
+    print("csv and xlsx agree on %d rows" % count)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
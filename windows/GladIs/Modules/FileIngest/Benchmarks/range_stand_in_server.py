@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""Stand-in for the backend's document download endpoint, with the faults real networks have.
+
+Serves GET /files/<name>?size=<bytes>&seed=<n> as <size> pseudo-random bytes drawn from <seed>,
+over HTTP/1.1 keep-alive connections. Range requests of a single range are answered 206 with
+Content-Range, and If-Range is honoured against the file's strong ETag. Every answer carries
+Repr-Digest with the SHA-256 of the whole file, so a client can verify what it assembled.
+
+Query parameters shape the network and the server:
+    rate=<bytes per second>  per-connection bandwidth, paced while the body is written
+    latency=<milliseconds>   delay before each answer, as a round trip adds
+    ranges=0                 ignore Range and always send the whole file, as some servers do
+    ranges=broken            answer 206 to a Range request but leave out Content-Range
+    fail=<n>                 cut every n-th answer off halfway through and drop the connection
+    corrupt=1                flip the byte in the middle of the file in every answer
+
+GET /stats answers {"requests": ..., "bytes": ...} counted over all files since the start.
+
+    python3 range_stand_in_server.py --serve 8080
+        serves until interrupted, e.g. for the Windows app pointed at http://<host>:8080
+    python3 range_stand_in_server.py ./download-benchmark [args...]
+        serves on a free port, runs the command with the port appended and exits with its status
+"""
+
+import base64
+import email.utils
+import hashlib
+import http.server
+import json
+import random
+import re
+import subprocess
+import sys
+import threading
+import time
+import urllib.parse
+
+SLICE = 16 * 1024
+
+files = {}
+files_lock = threading.Lock()
+stats = {"requests": 0, "bytes": 0}
+stats_lock = threading.Lock()
+
+
+def load(size, seed):
+    with files_lock:
+        key = (size, seed)
+        if key not in files:
+            content = random.Random(seed).randbytes(size)
+            digest = hashlib.sha256(content).digest()
+            files[key] = (content, '"%s"' % digest.hex()[:32], base64.b64encode(digest).decode("ascii"))
+        return files[key]
+
+
+def parse_range(header, size):
+    """Returns (first, last) of a single satisfiable byte range, None to send the whole file,
+    or False when the range cannot be satisfied."""
+    match = re.fullmatch(r"\s*bytes\s*=\s*(\d*)\s*-\s*(\d*)\s*", header or "")
+    if match is None or (match.group(1) == "" and match.group(2) == ""):
+        return None
+    if match.group(1) == "":
+        length = int(match.group(2))
+        return (max(size - length, 0), size - 1) if length > 0 and size > 0 else False
+    first = int(match.group(1))
+    last = min(int(match.group(2)), size - 1) if match.group(2) else size - 1
+    return (first, last) if first <= last else False
+
+
+class RangeHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def do_GET(self):
+        url = urllib.parse.urlsplit(self.path)
+        query = {name: values[-1] for name, values in urllib.parse.parse_qs(url.query).items()}
+        if url.path == "/stats":
+            with stats_lock:
+                return self.reply_json(200, stats)
+        if not url.path.startswith("/files/"):
+            return self.reply_json(404, {"error": "not found"})
+        content, etag, digest = load(int(query.get("size", "1048576")), int(query.get("seed", "1")))
+        rate = float(query.get("rate", "0"))
+        time.sleep(float(query.get("latency", "0")) / 1000)
+        with stats_lock:
+            stats["requests"] += 1
+            answer = stats["requests"]
+
+        span = None
+        if query.get("ranges", "1") != "0":
+            if_range = self.headers.get("If-Range")
+            if if_range is None or if_range == etag:
+                span = parse_range(self.headers.get("Range"), len(content))
+        if span is False:
+            self.send_response(416)
+            self.send_header("Content-Range", "bytes */%d" % len(content))
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return
+        first, last = span if span else (0, len(content) - 1)
+        body = bytearray(content[first:last + 1])
+        middle = len(content) // 2
+        if query.get("corrupt") == "1" and first <= middle <= last:
+            body[middle - first] ^= 0xFF
+
+        self.send_response(206 if span else 200)
+        self.send_header("Content-Type", "application/pdf")
+        self.send_header("Content-Length", str(len(body)))
+        if span and query.get("ranges") != "broken":
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (first, last, len(content)))
+        if query.get("ranges", "1") != "0":
+            self.send_header("Accept-Ranges", "bytes")
+        self.send_header("ETag", etag)
+        self.send_header("Last-Modified", email.utils.formatdate(0, usegmt=True))
+        self.send_header("Repr-Digest", "sha-256=:%s:" % digest)
+        self.end_headers()
+
+        fail = int(query.get("fail", "0"))
+        if fail > 0 and answer % fail == 0:
+            body = body[:len(body) // 2]
+            self.close_connection = True
+        start = time.monotonic()
+        for offset in range(0, len(body), SLICE):
+            piece = body[offset:offset + SLICE]
+            self.wfile.write(piece)
+            with stats_lock:
+                stats["bytes"] += len(piece)
+            if rate > 0:
+                ahead = (offset + len(piece)) / rate - (time.monotonic() - start)
+                if ahead > 0:
+                    time.sleep(ahead)
+
+    def reply_json(self, status, payload):
+        body = json.dumps(payload).encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        pass
+
+
+class Server(http.server.ThreadingHTTPServer):
+    daemon_threads = True
+
+    def handle_error(self, request, client_address):
+        # Clients hang up mid-answer on purpose, e.g. when a download is killed
+        pass
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    if argv[1] == "--serve":
+        server = Server(("", int(argv[2]) if len(argv) > 2 else 8080), RangeHandler)
+        server.serve_forever()
+        return 0
+    server = Server(("127.0.0.1", 0), RangeHandler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        return subprocess.call(argv[1:] + [str(server.server_address[1])])
+    finally:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Stand-in for the backend's document upload endpoint.
+
+Accepts multipart/form-data POSTs, sent with chunked transfer encoding or a Content-Length, and
+decodes a file part labelled Content-Encoding: gzip the way the backend has to. The form must
+carry the fields DocumentServicePost.createFormData sends: the file part with its filename, then
+uri, name and path. It answers 201 with the SHA-256 and size of the decoded file and echoes the
+fields, so a client can check the bytes and the form arrived intact, or 400 naming what is missing.
+
+    python3 upload_stand_in_server.py --serve 8080
+        serves until interrupted, e.g. for the Windows app pointed at http://<host>:8080
+    python3 upload_stand_in_server.py ./compression-benchmark [args...]
+        serves on a free port, runs the command with the port appended and exits with its status
+"""
+
+import hashlib
+import http.server
+import json
+import re
+import subprocess
+import sys
+import threading
+import zlib
+
+
+def read_body(handler):
+    if handler.headers.get("Transfer-Encoding", "").lower() == "chunked":
+        body = bytearray()
+        while True:
+            size = int(handler.rfile.readline().split(b";")[0], 16)
+            if size == 0:
+                # Trailer fields, if any, end with an empty line
+                while handler.rfile.readline() not in (b"\r\n", b"\n", b""):
+                    pass
+                return bytes(body)
+            body += handler.rfile.read(size)
+            handler.rfile.readline()
+    return handler.rfile.read(int(handler.headers.get("Content-Length", "0")))
+
+
+def parse_multipart(body, boundary):
+    parts = []
+    delimiter = b"--" + boundary
+    for chunk in body.split(delimiter)[1:]:
+        if chunk.startswith(b"--"):
+            break
+        head, _, content = chunk.partition(b"\r\n\r\n")
+        headers = {}
+        for line in head.strip(b"\r\n").split(b"\r\n"):
+            name, _, value = line.decode("latin-1").partition(":")
+            headers[name.strip().lower()] = value.strip()
+        parts.append((headers, content[:-2] if content.endswith(b"\r\n") else content))
+    return parts
+
+
+# The text fields of DocumentServicePost.createFormData, sent after the file part
+FORM_FIELDS = ("uri", "name", "path")
+
+
+class UploadHandler(http.server.BaseHTTPRequestHandler):
+    def do_POST(self):
+        content_type = self.headers.get("Content-Type", "")
+        if "boundary=" not in content_type:
+            return self.reply(400, {"error": "expected multipart/form-data"})
+        boundary = content_type.split("boundary=", 1)[1].strip('"').encode("latin-1")
+        fields = {}
+        file_part = None
+        for headers, content in parse_multipart(read_body(self), boundary):
+            disposition = dict(re.findall(r'(\w+)="([^"]*)"', headers.get("content-disposition", "")))
+            if disposition.get("name") == "file":
+                file_part = (headers, disposition, content)
+            elif "name" in disposition:
+                fields[disposition["name"]] = content.decode("utf-8")
+        if file_part is None:
+            return self.reply(400, {"error": "no file part"})
+        missing = [name for name in FORM_FIELDS if name not in fields]
+        if missing:
+            return self.reply(400, {"error": "missing form fields: " + ", ".join(missing)})
+
+        headers, disposition, content = file_part
+        if not disposition.get("filename"):
+            return self.reply(400, {"error": "the file part has no filename"})
+        encoding = headers.get("content-encoding", "identity").lower()
+        if encoding == "gzip":
+            try:
+                content = zlib.decompress(content, 16 + zlib.MAX_WBITS)
+            except zlib.error as error:
+                return self.reply(400, {"error": "bad gzip data: %s" % error})
+        elif encoding != "identity":
+            return self.reply(415, {"error": "unsupported Content-Encoding " + encoding})
+        return self.reply(201, {
+            "sha256": hashlib.sha256(content).hexdigest(),
+            "bytes": len(content),
+            "contentEncoding": encoding,
+            "fileName": disposition["filename"],
+            "mimeType": headers.get("content-type", ""),
+            "uri": fields["uri"],
+            "name": fields["name"],
+            "path": fields["path"],
+        })
+
+    def reply(self, status, payload):
+        body = json.dumps(payload).encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        pass
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    if argv[1] == "--serve":
+        server = http.server.ThreadingHTTPServer(("", int(argv[2]) if len(argv) > 2 else 8080), UploadHandler)
+        server.serve_forever()
+        return 0
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), UploadHandler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        return subprocess.call(argv[1:] + [str(server.server_address[1])])
+    finally:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
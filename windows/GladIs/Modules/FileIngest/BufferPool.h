@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  class BufferPool;
+
+  // Byte buffer that goes back to its pool when destroyed. The contents are not cleared on reuse,
+  // callers overwrite what they read. A default or size-constructed buffer belongs to no pool.
+  class PooledBuffer
+  {
+  public:
+      PooledBuffer() noexcept = default;
+
+      explicit PooledBuffer(size_t size) : m_storage(new uint8_t[size]), m_capacity(size), m_size(size) {}
+
+      PooledBuffer(PooledBuffer&& other) noexcept
+          : m_pool(std::exchange(other.m_pool, nullptr)), m_storage(std::move(other.m_storage)), m_capacity(std::exchange(other.m_capacity, 0)), m_size(std::exchange(other.m_size, 0)) {}
+
+      PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+          if (this != &other) {
+              Release();
+              m_pool = std::exchange(other.m_pool, nullptr);
+              m_storage = std::move(other.m_storage);
+              m_capacity = std::exchange(other.m_capacity, 0);
+              m_size = std::exchange(other.m_size, 0);
+          }
+          return *this;
+      }
+
+      PooledBuffer(PooledBuffer const&) = delete;
+      PooledBuffer& operator=(PooledBuffer const&) = delete;
+
+      ~PooledBuffer() {
+          Release();
+      }
+
+      uint8_t* Data() noexcept {
+          return m_storage.get();
+      }
+
+      const uint8_t* Data() const noexcept {
+          return m_storage.get();
+      }
+
+      size_t Size() const noexcept {
+          return m_size;
+      }
+
+      size_t Capacity() const noexcept {
+          return m_capacity;
+      }
+
+      bool Empty() const noexcept {
+          return m_size == 0;
+      }
+
+      // Keeps the first min(old, new) bytes. Growing past the capacity moves the contents to a
+      // new allocation outside the pool and gives the old one back.
+      void Resize(size_t size) {
+          if (size > m_capacity) {
+              PooledBuffer larger(size);
+              if (m_size > 0) {
+                  std::memcpy(larger.Data(), Data(), m_size);
+              }
+              *this = std::move(larger);
+          }
+          m_size = size;
+      }
+
+      // Hands the storage back now instead of at destruction
+      void Release() noexcept;
+
+  private:
+      friend class BufferPool;
+
+      PooledBuffer(BufferPool* pool, std::unique_ptr<uint8_t[]> storage, size_t capacity, size_t size) noexcept
+          : m_pool(pool), m_storage(std::move(storage)), m_capacity(capacity), m_size(size) {}
+
+      BufferPool* m_pool = nullptr;
+      std::unique_ptr<uint8_t[]> m_storage;
+      size_t m_capacity = 0;
+      size_t m_size = 0;
+  };
+
+  struct BufferPoolStats
+  {
+      // Buffers that had to come from the heap, and those served from the free lists
+      uint64_t allocations = 0;
+      uint64_t reuses = 0;
+      // Buffers freed on return because they were oversized or the pool was full
+      uint64_t discards = 0;
+      uint64_t bytesInUse = 0;
+      uint64_t peakBytesInUse = 0;
+      uint64_t bytesRetained = 0;
+  };
+
+  // Size-classed free lists of byte buffers, shared by every read path so back-to-back reads
+  // reuse the same few large blocks instead of fragmenting the heap. Classes are four steps per
+  // power of two, so a buffer is at most 25% larger than asked. Requests above the largest class
+  // are allocated exactly and freed on return; at most `maxRetainedBytes` are kept idle.
+  class BufferPool
+  {
+  public:
+      BufferPool(size_t minClassSize, size_t maxClassSize, size_t maxRetainedBytes)
+          : m_minClassSize(std::bit_ceil(std::max<size_t>(minClassSize, 64))),
+            m_maxClassSize(ClassCapacityFor(std::max(maxClassSize, m_minClassSize), m_minClassSize)),
+            m_maxRetainedBytes(maxRetainedBytes),
+            m_freeLists(ClassIndex(m_maxClassSize) + 1) {}
+
+      BufferPool(BufferPool const&) = delete;
+      BufferPool& operator=(BufferPool const&) = delete;
+
+      // A buffer of exactly `size` bytes, with whatever spare capacity its class has
+      PooledBuffer Acquire(size_t size) {
+          size_t capacity = size > m_maxClassSize ? size : ClassCapacityFor(size, m_minClassSize);
+          std::unique_ptr<uint8_t[]> storage;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              if (capacity <= m_maxClassSize) {
+                  auto& freeList = m_freeLists[ClassIndex(capacity)];
+                  if (!freeList.empty()) {
+                      storage = std::move(freeList.back());
+                      freeList.pop_back();
+                      m_stats.bytesRetained -= capacity;
+                      m_stats.reuses++;
+                  }
+              }
+              if (!storage) {
+                  m_stats.allocations++;
+              }
+              m_stats.bytesInUse += capacity;
+              m_stats.peakBytesInUse = std::max(m_stats.peakBytesInUse, m_stats.bytesInUse);
+          }
+          if (!storage) {
+              try {
+                  storage.reset(new uint8_t[capacity]);
+              } catch (...) {
+                  std::lock_guard<std::mutex> lock(m_mutex);
+                  m_stats.bytesInUse -= capacity;
+                  throw;
+              }
+          }
+          return PooledBuffer(this, std::move(storage), capacity, size);
+      }
+
+      BufferPoolStats Stats() const {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_stats;
+      }
+
+      // Frees every idle buffer, e.g. when the app is told memory is low
+      void Trim() {
+          std::vector<std::vector<std::unique_ptr<uint8_t[]>>> released(m_freeLists.size());
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              released.swap(m_freeLists);
+              m_stats.bytesRetained = 0;
+          }
+      }
+
+      // Capacity handed out for a request of `size` bytes: a power of two, or a quarter step
+      // between two powers of two, never below the smallest class
+      static constexpr size_t ClassCapacityFor(size_t size, size_t minClassSize) noexcept {
+          if (size <= minClassSize) {
+              return minClassSize;
+          }
+          size_t step = std::bit_floor(size - 1) / 4;
+          return (size + step - 1) / step * step;
+      }
+
+  private:
+      friend class PooledBuffer;
+
+      size_t ClassIndex(size_t capacity) const noexcept {
+          if (capacity <= m_minClassSize) {
+              return 0;
+          }
+          size_t floor = std::bit_floor(capacity - 1);
+          size_t doublings = static_cast<size_t>(std::countr_zero(floor) - std::countr_zero(m_minClassSize));
+          return doublings * 4 + (capacity - floor) / (floor / 4);
+      }
+
+      void Return(std::unique_ptr<uint8_t[]> storage, size_t capacity) noexcept {
+          std::unique_ptr<uint8_t[]> discarded;
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_stats.bytesInUse -= capacity;
+          if (capacity > m_maxClassSize || m_stats.bytesRetained + capacity > m_maxRetainedBytes) {
+              m_stats.discards++;
+              discarded = std::move(storage);
+              return;
+          }
+          auto& freeList = m_freeLists[ClassIndex(capacity)];
+          try {
+              freeList.push_back(std::move(storage));
+              m_stats.bytesRetained += capacity;
+          } catch (...) {
+              m_stats.discards++;
+          }
+      }
+
+      const size_t m_minClassSize;
+      const size_t m_maxClassSize;
+      const size_t m_maxRetainedBytes;
+      mutable std::mutex m_mutex;
+      std::vector<std::vector<std::unique_ptr<uint8_t[]>>> m_freeLists;
+      BufferPoolStats m_stats;
+  };
+
+  static_assert(BufferPool::ClassCapacityFor(1, 64 * 1024) == 64 * 1024);
+  static_assert(BufferPool::ClassCapacityFor(64 * 1024 + 1, 64 * 1024) == 80 * 1024);
+  static_assert(BufferPool::ClassCapacityFor(9 * 1024 * 1024, 64 * 1024) == 10 * 1024 * 1024);
+  static_assert(BufferPool::ClassCapacityFor(16 * 1024 * 1024, 64 * 1024) == 16 * 1024 * 1024);
+
+  inline void PooledBuffer::Release() noexcept {
+      if (m_pool != nullptr && m_storage) {
+          m_pool->Return(std::move(m_storage), m_capacity);
+      }
+      m_pool = nullptr;
+      m_storage.reset();
+      m_capacity = 0;
+      m_size = 0;
+  }
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "Chunking.h"
+#include "RangeSource.h"
+#include "Sha256.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace FileIngest
+{
+  struct ManifestError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  struct ManifestChunk
+  {
+      Sha256Digest digest{};
+      uint64_t offset = 0;
+      uint32_t length = 0;
+  };
+
+  namespace detail
+  {
+    struct DigestHash
+    {
+        // A SHA-256 digest is already uniformly spread, its first eight bytes will do
+        size_t operator()(Sha256Digest const& digest) const noexcept {
+            uint64_t value;
+            std::memcpy(&value, digest.data(), sizeof(value));
+            return static_cast<size_t>(value);
+        }
+    };
+
+    inline void PutLittleEndian(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    inline uint64_t GetLittleEndian(const uint8_t* data, int bytes) noexcept {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= uint64_t(data[i]) << (8 * i);
+        }
+        return value;
+    }
+  }
+
+  using DigestSet = std::unordered_set<Sha256Digest, detail::DigestHash>;
+
+  // One version of a file as the list of its content-defined chunks. The serialized manifest is
+  // little-endian: a 32-byte header ("CDCM", version, chunk sizes, chunk count, file size) then
+  // 36 bytes per chunk, its SHA-256 and its length. Offsets follow from the lengths. The SHA-256
+  // of the serialized manifest names the version.
+  struct ChunkManifest
+  {
+      static constexpr uint32_t kMagic = 0x4D434443;
+      static constexpr uint16_t kVersion = 1;
+      static constexpr size_t kHeaderSize = 32;
+      static constexpr size_t kEntrySize = 36;
+
+      ChunkingParams params;
+      uint64_t fileSize = 0;
+      std::vector<ManifestChunk> chunks;
+
+      std::vector<uint8_t> Serialize() const {
+          std::vector<uint8_t> out;
+          out.reserve(kHeaderSize + chunks.size() * kEntrySize);
+          detail::PutLittleEndian(out, kMagic, 4);
+          detail::PutLittleEndian(out, kVersion, 2);
+          detail::PutLittleEndian(out, 0, 2);
+          detail::PutLittleEndian(out, params.minSize, 4);
+          detail::PutLittleEndian(out, params.averageSize, 4);
+          detail::PutLittleEndian(out, params.maxSize, 4);
+          detail::PutLittleEndian(out, chunks.size(), 4);
+          detail::PutLittleEndian(out, fileSize, 8);
+          for (ManifestChunk const& chunk : chunks) {
+              out.insert(out.end(), chunk.digest.begin(), chunk.digest.end());
+              detail::PutLittleEndian(out, chunk.length, 4);
+          }
+          return out;
+      }
+
+      static ChunkManifest Parse(const uint8_t* data, size_t length) {
+          if (length < kHeaderSize || detail::GetLittleEndian(data, 4) != kMagic) {
+              throw ManifestError("Not a chunk manifest");
+          }
+          if (detail::GetLittleEndian(data + 4, 2) != kVersion) {
+              throw ManifestError("Unsupported chunk manifest version");
+          }
+          ChunkManifest manifest;
+          manifest.params.minSize = static_cast<uint32_t>(detail::GetLittleEndian(data + 8, 4));
+          manifest.params.averageSize = static_cast<uint32_t>(detail::GetLittleEndian(data + 12, 4));
+          manifest.params.maxSize = static_cast<uint32_t>(detail::GetLittleEndian(data + 16, 4));
+          uint64_t count = detail::GetLittleEndian(data + 20, 4);
+          manifest.fileSize = detail::GetLittleEndian(data + 24, 8);
+          if ((length - kHeaderSize) / kEntrySize != count || (length - kHeaderSize) % kEntrySize != 0) {
+              throw ManifestError("Truncated chunk manifest");
+          }
+          manifest.chunks.resize(static_cast<size_t>(count));
+          uint64_t offset = 0;
+          const uint8_t* entry = data + kHeaderSize;
+          for (ManifestChunk& chunk : manifest.chunks) {
+              std::memcpy(chunk.digest.data(), entry, chunk.digest.size());
+              chunk.offset = offset;
+              chunk.length = static_cast<uint32_t>(detail::GetLittleEndian(entry + 32, 4));
+              offset += chunk.length;
+              entry += kEntrySize;
+          }
+          if (offset != manifest.fileSize) {
+              throw ManifestError("Chunk manifest does not add up to the file size");
+          }
+          return manifest;
+      }
+
+      static ChunkManifest Parse(std::vector<uint8_t> const& bytes) {
+          return Parse(bytes.data(), bytes.size());
+      }
+
+      Sha256Digest Digest() const {
+          std::vector<uint8_t> bytes = Serialize();
+          return Sha256::Hash(bytes.data(), bytes.size());
+      }
+
+      DigestSet Digests() const {
+          DigestSet digests;
+          digests.reserve(chunks.size());
+          for (ManifestChunk const& chunk : chunks) {
+              digests.insert(chunk.digest);
+          }
+          return digests;
+      }
+  };
+
+  // Chunks and hashes a file as it is read, in blocks of any size
+  class ManifestBuilder
+  {
+  public:
+      explicit ManifestBuilder(ChunkingParams params = {}) : m_chunker(params) {
+          m_manifest.params = params;
+      }
+
+      void Update(const uint8_t* data, size_t length) {
+          m_chunker.Update(data, length, [this](const uint8_t* chunk, size_t chunkLength) { Add(chunk, chunkLength); });
+      }
+
+      ChunkManifest Finish() {
+          m_chunker.Finish([this](const uint8_t* chunk, size_t chunkLength) { Add(chunk, chunkLength); });
+          return std::move(m_manifest);
+      }
+
+  private:
+      void Add(const uint8_t* chunk, size_t length) {
+          ManifestChunk entry;
+          entry.digest = Sha256::Hash(chunk, length);
+          entry.offset = m_manifest.fileSize;
+          entry.length = static_cast<uint32_t>(length);
+          m_manifest.chunks.push_back(entry);
+          m_manifest.fileSize += length;
+      }
+
+      ContentChunker m_chunker;
+      ChunkManifest m_manifest;
+  };
+
+  // Reads the whole source through `buffer`, whose length sets the read size
+  inline ChunkManifest BuildManifest(RangeSource& source, uint8_t* buffer, size_t bufferLength, ChunkingParams params = {}) {
+      ManifestBuilder builder(params);
+      uint64_t offset = 0;
+      while (offset < source.Size()) {
+          size_t read = source.ReadAt(offset, buffer, bufferLength);
+          if (read == 0) {
+              throw RangeReadError("File ended early");
+          }
+          builder.Update(buffer, read);
+          offset += read;
+      }
+      return builder.Finish();
+  }
+
+  // Which chunks of a new version the server lacks: those found neither in the base version nor
+  // earlier in the new one
+  struct DeltaPlan
+  {
+      std::vector<size_t> send;
+      uint64_t sendBytes = 0;
+      uint64_t reusedBytes = 0;
+  };
+
+  inline DeltaPlan PlanDelta(ChunkManifest const& next, ChunkManifest const* base) {
+      DeltaPlan plan;
+      DigestSet known;
+      if (base != nullptr) {
+          known = base->Digests();
+      }
+      for (size_t i = 0; i < next.chunks.size(); i++) {
+          ManifestChunk const& chunk = next.chunks[i];
+          if (known.insert(chunk.digest).second) {
+              plan.send.push_back(i);
+              plan.sendBytes += chunk.length;
+          } else {
+              plan.reusedBytes += chunk.length;
+          }
+      }
+      return plan;
+  }
+
+  // Body of the planned chunks, read from the file on demand: each chunk is a 36-byte record
+  // header, its SHA-256 and its length as little-endian uint32, followed by its bytes. Only the
+  // chunk being sent is ever in memory.
+  class DeltaPayload
+  {
+  public:
+      static constexpr size_t kRecordHeaderSize = 36;
+
+      DeltaPayload(RangeSource& source, ChunkManifest const& manifest, DeltaPlan const& plan)
+          : m_source(source), m_manifest(manifest), m_plan(plan) {}
+
+      uint64_t Size() const noexcept {
+          return m_plan.sendBytes + m_plan.send.size() * kRecordHeaderSize;
+      }
+
+      // Fills up to `capacity` bytes and returns how many; 0 once everything was read
+      size_t Read(uint8_t* out, size_t capacity) {
+          size_t written = 0;
+          while (written < capacity && m_next < m_plan.send.size()) {
+              ManifestChunk const& chunk = m_manifest.chunks[m_plan.send[m_next]];
+              if (m_position < kRecordHeaderSize) {
+                  uint8_t header[kRecordHeaderSize];
+                  std::memcpy(header, chunk.digest.data(), chunk.digest.size());
+                  for (int i = 0; i < 4; i++) {
+                      header[32 + i] = static_cast<uint8_t>(chunk.length >> (8 * i));
+                  }
+                  size_t take = std::min(capacity - written, kRecordHeaderSize - m_position);
+                  std::memcpy(out + written, header + m_position, take);
+                  written += take;
+                  m_position += take;
+                  continue;
+              }
+              size_t done = m_position - kRecordHeaderSize;
+              size_t take = std::min<size_t>(capacity - written, chunk.length - done);
+              size_t read = m_source.ReadAt(chunk.offset + done, out + written, take);
+              if (read != take) {
+                  throw RangeReadError("File changed while it was uploaded");
+              }
+              written += take;
+              m_position += take;
+              if (m_position == kRecordHeaderSize + chunk.length) {
+                  m_next++;
+                  m_position = 0;
+              }
+          }
+          return written;
+      }
+
+  private:
+      RangeSource& m_source;
+      ChunkManifest const& m_manifest;
+      DeltaPlan const& m_plan;
+      size_t m_next = 0;
+      size_t m_position = 0;
+  };
+
+  // The receiving side of a delta upload, as the backend implements it: splits a payload into
+  // chunks, checking each against its digest
+  template <typename OnChunk>
+  void ReadDeltaPayload(const uint8_t* data, size_t length, OnChunk&& onChunk) {
+      while (length > 0) {
+          if (length < DeltaPayload::kRecordHeaderSize) {
+              throw ManifestError("Truncated chunk record");
+          }
+          Sha256Digest digest;
+          std::memcpy(digest.data(), data, digest.size());
+          size_t chunkLength = static_cast<size_t>(detail::GetLittleEndian(data + 32, 4));
+          data += DeltaPayload::kRecordHeaderSize;
+          length -= DeltaPayload::kRecordHeaderSize;
+          if (chunkLength > length) {
+              throw ManifestError("Truncated chunk record");
+          }
+          if (Sha256::Hash(data, chunkLength) != digest) {
+              throw ManifestError("Chunk does not match its digest");
+          }
+          onChunk(digest, data, chunkLength);
+          data += chunkLength;
+          length -= chunkLength;
+      }
+  }
+
+  // Rebuilds a version from stored chunks. `find(digest)` returns a pointer to the chunk's
+  // bytes, or null when it is missing, which is an error: the upload has to be repeated in full.
+  template <typename Find, typename Write>
+  void ReassembleFile(ChunkManifest const& manifest, Find&& find, Write&& write) {
+      for (ManifestChunk const& chunk : manifest.chunks) {
+          const std::vector<uint8_t>* bytes = find(chunk.digest);
+          if (bytes == nullptr) {
+              throw ManifestError("Missing chunk " + ToHex(chunk.digest));
+          }
+          if (bytes->size() != chunk.length) {
+              throw ManifestError("Chunk " + ToHex(chunk.digest) + " has the wrong length");
+          }
+          write(bytes->data(), bytes->size());
+      }
+  }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace FileIngest
+{
+  struct ChunkingError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  // Chunk sizes in bytes. averageSize must be a power of two, and minSize at least the 64 bytes
+  // the gear hash looks back over.
+  struct ChunkingParams
+  {
+      uint32_t minSize = 2 * 1024;
+      uint32_t averageSize = 8 * 1024;
+      uint32_t maxSize = 64 * 1024;
+  };
+
+  namespace detail
+  {
+    // 256 random 64-bit values, from splitmix64 so the table is the same on every build and
+    // every platform: chunk boundaries have to agree between versions and machines
+    struct GearTable
+    {
+        uint64_t values[256];
+
+        constexpr GearTable() : values() {
+            uint64_t state = 0;
+            for (int i = 0; i < 256; i++) {
+                state += 0x9E3779B97F4A7C15ull;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                values[i] = z ^ (z >> 31);
+            }
+        }
+    };
+
+    inline constexpr GearTable kGearTable{};
+
+    // Bit k of the gear hash depends on the last k + 1 bytes only, so masks test the top bits
+    constexpr uint64_t TopBits(unsigned count) noexcept {
+        return count == 0 ? 0 : ~uint64_t(0) << (64 - count);
+    }
+
+    constexpr unsigned Log2(uint32_t value) noexcept {
+        unsigned bits = 0;
+        while (value > 1) {
+            value >>= 1;
+            bits++;
+        }
+        return bits;
+    }
+  }
+
+  // Content-defined chunking after FastCDC: a chunk ends where the gear hash of the last 64 bytes
+  // has its top bits clear, with a stricter mask before averageSize and a looser one after it so
+  // sizes gather around the average. An edit only moves the boundaries next to it, the chunks
+  // before and after keep their bytes and so their digests.
+  //
+  // Unlike FastCDC, which restarts the hash at minSize, the hash is warmed over the 64 bytes
+  // before it. A boundary then depends on the window alone and not on where the chunk started,
+  // which makes boundaries fall back in step right after an insertion.
+  class ContentChunker
+  {
+  public:
+      explicit ContentChunker(ChunkingParams params = {}) : m_params(params) {
+          unsigned bits = detail::Log2(params.averageSize);
+          if (params.minSize < 64 || bits < 4 || (1u << bits) != params.averageSize
+              || params.minSize >= params.averageSize || params.averageSize >= params.maxSize) {
+              throw ChunkingError("Invalid chunk sizes");
+          }
+          m_strictMask = detail::TopBits(bits + 2);
+          m_looseMask = detail::TopBits(bits - 2);
+      }
+
+      ChunkingParams const& Params() const noexcept {
+          return m_params;
+      }
+
+      // Length of the chunk that starts at `data`. Returns 0 when more bytes are needed to tell,
+      // which only happens for fewer than maxSize bytes that are not the end of the input.
+      size_t FindBoundary(const uint8_t* data, size_t length, bool final) const noexcept {
+          if (length <= m_params.minSize) {
+              return final ? length : 0;
+          }
+          const uint64_t* gear = detail::kGearTable.values;
+          size_t end = length < m_params.maxSize ? length : m_params.maxSize;
+          size_t normal = end < m_params.averageSize ? end : m_params.averageSize;
+          size_t i = m_params.minSize - 64;
+          uint64_t hash = 0;
+          for (; i < m_params.minSize - 1; i++) {
+              hash = (hash << 1) + gear[data[i]];
+          }
+          for (; i < normal; i++) {
+              hash = (hash << 1) + gear[data[i]];
+              if ((hash & m_strictMask) == 0) {
+                  return i + 1;
+              }
+          }
+          for (; i < end; i++) {
+              hash = (hash << 1) + gear[data[i]];
+              if ((hash & m_looseMask) == 0) {
+                  return i + 1;
+              }
+          }
+          if (end == m_params.maxSize || final) {
+              return end;
+          }
+          return 0;
+      }
+
+      // Calls onChunk(data, length) for every chunk completed by these bytes. Chunks are passed
+      // straight from `data` where possible; only a chunk spanning calls is copied, and the
+      // chunker never holds more than maxSize bytes.
+      template <typename OnChunk>
+      void Update(const uint8_t* data, size_t length, OnChunk&& onChunk) {
+          if (!m_pending.empty()) {
+              size_t take = std::min(length, static_cast<size_t>(m_params.maxSize) - m_pending.size());
+              m_pending.insert(m_pending.end(), data, data + take);
+              size_t cut = FindBoundary(m_pending.data(), m_pending.size(), false);
+              if (cut == 0) {
+                  return;
+              }
+              onChunk(m_pending.data(), cut);
+              // No boundary fell in the bytes held before, so the cut is past them and whatever
+              // follows it came from `data`
+              size_t consumed = take - (m_pending.size() - cut);
+              data += consumed;
+              length -= consumed;
+              m_pending.clear();
+          }
+          for (size_t cut; (cut = FindBoundary(data, length, false)) != 0; data += cut, length -= cut) {
+              onChunk(data, cut);
+          }
+          m_pending.assign(data, data + length);
+      }
+
+      // Ends the input, emitting what is left as the last chunks
+      template <typename OnChunk>
+      void Finish(OnChunk&& onChunk) {
+          const uint8_t* data = m_pending.data();
+          size_t length = m_pending.size();
+          while (length > 0) {
+              size_t cut = FindBoundary(data, length, true);
+              onChunk(data, cut);
+              data += cut;
+              length -= cut;
+          }
+          m_pending.clear();
+      }
+
+  private:
+      ChunkingParams m_params;
+      uint64_t m_strictMask = 0;
+      uint64_t m_looseMask = 0;
+      std::vector<uint8_t> m_pending;
+  };
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Deflate.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace FileIngest
+{
+  // Values of the HTTP Content-Encoding header an upload is sent with
+  enum class ContentCoding
+  {
+      Identity,
+      Gzip,
+  };
+
+  constexpr std::string_view ContentCodingName(ContentCoding coding) noexcept {
+      return coding == ContentCoding::Gzip ? "gzip" : "identity";
+  }
+
+  // What the JS side asks for: no compression, a choice from the file's content, or always gzip
+  enum class CompressionMode
+  {
+      None,
+      Auto,
+      Gzip,
+  };
+
+  constexpr bool ParseCompressionMode(std::string_view name, CompressionMode& mode) noexcept {
+      if (name.empty() || name == "none") {
+          mode = CompressionMode::None;
+      } else if (name == "auto") {
+          mode = CompressionMode::Auto;
+      } else if (name == "gzip") {
+          mode = CompressionMode::Gzip;
+      } else {
+          return false;
+      }
+      return true;
+  }
+
+  // Bytes from the start of a file compressed to estimate the ratio of the whole
+  inline constexpr size_t kCompressionSampleLength = 128 * 1024;
+
+  // Below this estimated ratio the CPU time and the gzip framing are not worth the bytes saved
+  inline constexpr double kMinCompressionRatio = 1.15;
+
+  // Formats whose content is already entropy coded; sampling them only costs time
+  inline constexpr std::string_view kPrecompressedMimeTypes[] = { "image/jpeg", "image/png" };
+
+  constexpr bool IsPrecompressed(std::string_view mimeType) noexcept {
+      return std::find(std::begin(kPrecompressedMimeTypes), std::end(kPrecompressedMimeTypes), mimeType) != std::end(kPrecompressedMimeTypes);
+  }
+
+  // Whether ChooseContentCoding needs the file's first kCompressionSampleLength bytes
+  constexpr bool NeedsCompressionSample(CompressionMode mode, std::string_view mimeType) noexcept {
+      return mode == CompressionMode::Auto && !IsPrecompressed(mimeType);
+  }
+
+  static_assert(NeedsCompressionSample(CompressionMode::Auto, "application/pdf") && !NeedsCompressionSample(CompressionMode::Auto, "image/jpeg"));
+  static_assert(!NeedsCompressionSample(CompressionMode::Gzip, "text/csv"));
+
+  // Original size over gzip size of `sample`, at the level uploads are compressed with
+  inline double EstimateCompressionRatio(const uint8_t* sample, size_t length) {
+      if (length == 0) {
+          return 1.0;
+      }
+      Deflate::GzipEncoder encoder(Deflate::Level::Fast);
+      auto discard = [](const uint8_t*, size_t) {};
+      encoder.Write(sample, length, discard);
+      encoder.Finish(discard);
+      return static_cast<double>(length) / static_cast<double>(encoder.OutputBytes());
+  }
+
+  // Picks the upload encoding of a file from its sniffed MIME type and its first bytes. CSV
+  // compresses several times over; PDFs range from text that shrinks by half to scans whose
+  // image streams are already compressed, so the sample decides.
+  inline ContentCoding ChooseContentCoding(CompressionMode mode, std::string_view mimeType, const uint8_t* sample, size_t length) {
+      if (mode != CompressionMode::Auto) {
+          return mode == CompressionMode::Gzip ? ContentCoding::Gzip : ContentCoding::Identity;
+      }
+      if (IsPrecompressed(mimeType)) {
+          return ContentCoding::Identity;
+      }
+      double ratio = EstimateCompressionRatio(sample, std::min(length, kCompressionSampleLength));
+      return ratio >= kMinCompressionRatio ? ContentCoding::Gzip : ContentCoding::Identity;
+  }
+}
@@ -0,0 +1,518 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Sha256.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  namespace detail
+  {
+    struct ContentIndexHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+        uint64_t count;
+        uint64_t tombstones;
+        uint64_t totalBytes;
+        uint64_t clock;
+        uint8_t reserved[16];
+    };
+
+    struct ContentIndexSlot
+    {
+        uint8_t digest[32];
+        uint64_t size;
+        uint64_t lastAccess;
+        uint32_t state;
+        uint8_t reserved[12];
+    };
+
+    static_assert(sizeof(ContentIndexHeader) == 64);
+    static_assert(sizeof(ContentIndexSlot) == 64);
+  }
+
+  // Open-addressing hash table of digest -> { size, lastAccess } living in a memory-mapped
+  // file, so a restart reuses the index without rescanning the blobs. Digests are already
+  // uniformly distributed, their first 8 bytes are used as the probe hash. Not thread-safe.
+  class ContentIndex
+  {
+  public:
+      struct Entry
+      {
+          Sha256Digest digest;
+          uint64_t size;
+          uint64_t lastAccess;
+      };
+
+      explicit ContentIndex(std::filesystem::path path, uint64_t initialCapacity = 1024) : m_path(std::move(path)) {
+          m_file = MappedFile(m_path, MappedFile::Mode::ReadWrite, FileSizeFor(kMinCapacity));
+          if (!IsValid()) {
+              m_file.Close();
+              std::filesystem::remove(m_path);
+              Create(m_path, RoundCapacity(initialCapacity));
+              m_file = MappedFile(m_path, MappedFile::Mode::ReadWrite);
+          }
+      }
+
+      size_t Count() const noexcept {
+          return static_cast<size_t>(Header().count);
+      }
+
+      uint64_t Capacity() const noexcept {
+          return Header().capacity;
+      }
+
+      uint64_t TotalBytes() const noexcept {
+          return Header().totalBytes;
+      }
+
+      bool Find(Sha256Digest const& digest, Entry* entry = nullptr) const noexcept {
+          const detail::ContentIndexSlot* slot = Lookup(digest);
+          if (slot == nullptr) {
+              return false;
+          }
+          if (entry != nullptr) {
+              *entry = ToEntry(*slot);
+          }
+          return true;
+      }
+
+      // Marks the entry as most recently used, returns false when it is unknown
+      bool Touch(Sha256Digest const& digest) noexcept {
+          detail::ContentIndexSlot* slot = Lookup(digest);
+          if (slot == nullptr) {
+              return false;
+          }
+          slot->lastAccess = ++Header().clock;
+          return true;
+      }
+
+      // Returns false and only touches the entry when the digest is already indexed
+      bool Insert(Sha256Digest const& digest, uint64_t size) {
+          if (Touch(digest)) {
+              return false;
+          }
+          detail::ContentIndexHeader& header = Header();
+          if ((header.count + header.tombstones + 1) * 10 > header.capacity * 7) {
+              Rehash(std::max(header.capacity, RoundCapacity((header.count + 1) * 2)));
+          }
+
+          detail::ContentIndexSlot* slots = Slots();
+          uint64_t mask = Header().capacity - 1;
+          for (uint64_t i = ProbeStart(digest) & mask;; i = (i + 1) & mask) {
+              if (slots[i].state != kOccupied) {
+                  if (slots[i].state == kTombstone) {
+                      Header().tombstones--;
+                  }
+                  std::memcpy(slots[i].digest, digest.data(), digest.size());
+                  slots[i].size = size;
+                  slots[i].lastAccess = ++Header().clock;
+                  slots[i].state = kOccupied;
+                  Header().count++;
+                  Header().totalBytes += size;
+                  return true;
+              }
+          }
+      }
+
+      bool Erase(Sha256Digest const& digest) noexcept {
+          detail::ContentIndexSlot* slot = Lookup(digest);
+          if (slot == nullptr) {
+              return false;
+          }
+          slot->state = kTombstone;
+          detail::ContentIndexHeader& header = Header();
+          header.count--;
+          header.tombstones++;
+          header.totalBytes -= slot->size;
+          return true;
+      }
+
+      std::vector<Entry> Entries() const {
+          std::vector<Entry> entries;
+          entries.reserve(Count());
+          const detail::ContentIndexSlot* slots = Slots();
+          for (uint64_t i = 0; i < Header().capacity; i++) {
+              if (slots[i].state == kOccupied) {
+                  entries.push_back(ToEntry(slots[i]));
+              }
+          }
+          return entries;
+      }
+
+      void Flush() {
+          m_file.Flush();
+      }
+
+  private:
+      static constexpr uint32_t kMagic = 0x58444943; // "CIDX"
+      static constexpr uint32_t kVersion = 1;
+      static constexpr uint64_t kMinCapacity = 64;
+      static constexpr uint32_t kEmpty = 0;
+      static constexpr uint32_t kOccupied = 1;
+      static constexpr uint32_t kTombstone = 2;
+
+      static constexpr uint64_t FileSizeFor(uint64_t capacity) noexcept {
+          return sizeof(detail::ContentIndexHeader) + capacity * sizeof(detail::ContentIndexSlot);
+      }
+
+      static uint64_t RoundCapacity(uint64_t capacity) noexcept {
+          uint64_t rounded = kMinCapacity;
+          while (rounded < capacity) {
+              rounded *= 2;
+          }
+          return rounded;
+      }
+
+      static uint64_t ProbeStart(Sha256Digest const& digest) noexcept {
+          uint64_t hash;
+          std::memcpy(&hash, digest.data(), sizeof(hash));
+          return hash;
+      }
+
+      static Entry ToEntry(detail::ContentIndexSlot const& slot) noexcept {
+          Entry entry;
+          std::memcpy(entry.digest.data(), slot.digest, entry.digest.size());
+          entry.size = slot.size;
+          entry.lastAccess = slot.lastAccess;
+          return entry;
+      }
+
+      static void Create(std::filesystem::path const& path, uint64_t capacity) {
+          MappedFile file(path, MappedFile::Mode::ReadWrite, FileSizeFor(capacity));
+          auto* header = reinterpret_cast<detail::ContentIndexHeader*>(file.Data());
+          std::memset(header, 0, sizeof(*header));
+          header->magic = kMagic;
+          header->version = kVersion;
+          header->capacity = capacity;
+          file.Flush();
+      }
+
+      bool IsValid() const noexcept {
+          const detail::ContentIndexHeader& header = Header();
+          return header.magic == kMagic
+              && header.version == kVersion
+              && header.capacity >= kMinCapacity
+              && (header.capacity & (header.capacity - 1)) == 0
+              && m_file.Size() == FileSizeFor(header.capacity);
+      }
+
+      detail::ContentIndexHeader& Header() noexcept {
+          return *reinterpret_cast<detail::ContentIndexHeader*>(m_file.Data());
+      }
+
+      const detail::ContentIndexHeader& Header() const noexcept {
+          return *reinterpret_cast<const detail::ContentIndexHeader*>(m_file.Data());
+      }
+
+      detail::ContentIndexSlot* Slots() noexcept {
+          return reinterpret_cast<detail::ContentIndexSlot*>(m_file.Data() + sizeof(detail::ContentIndexHeader));
+      }
+
+      const detail::ContentIndexSlot* Slots() const noexcept {
+          return reinterpret_cast<const detail::ContentIndexSlot*>(m_file.Data() + sizeof(detail::ContentIndexHeader));
+      }
+
+      detail::ContentIndexSlot* Lookup(Sha256Digest const& digest) noexcept {
+          return const_cast<detail::ContentIndexSlot*>(std::as_const(*this).Lookup(digest));
+      }
+
+      const detail::ContentIndexSlot* Lookup(Sha256Digest const& digest) const noexcept {
+          const detail::ContentIndexSlot* slots = Slots();
+          uint64_t mask = Header().capacity - 1;
+          for (uint64_t i = ProbeStart(digest) & mask;; i = (i + 1) & mask) {
+              if (slots[i].state == kEmpty) {
+                  return nullptr;
+              }
+              if (slots[i].state == kOccupied && std::memcmp(slots[i].digest, digest.data(), digest.size()) == 0) {
+                  return &slots[i];
+              }
+          }
+      }
+
+      // Rebuilds the table into a new file and swaps it in with a rename, dropping tombstones
+      void Rehash(uint64_t capacity) {
+          std::filesystem::path temporary = m_path;
+          temporary += ".rehash";
+          std::filesystem::remove(temporary);
+          Create(temporary, capacity);
+          {
+              MappedFile next(temporary, MappedFile::Mode::ReadWrite);
+              auto* header = reinterpret_cast<detail::ContentIndexHeader*>(next.Data());
+              auto* slots = reinterpret_cast<detail::ContentIndexSlot*>(next.Data() + sizeof(detail::ContentIndexHeader));
+              const detail::ContentIndexHeader& current = Header();
+              const detail::ContentIndexSlot* currentSlots = Slots();
+              uint64_t mask = capacity - 1;
+              for (uint64_t i = 0; i < current.capacity; i++) {
+                  if (currentSlots[i].state != kOccupied) {
+                      continue;
+                  }
+                  Sha256Digest digest;
+                  std::memcpy(digest.data(), currentSlots[i].digest, digest.size());
+                  uint64_t j = ProbeStart(digest) & mask;
+                  while (slots[j].state == kOccupied) {
+                      j = (j + 1) & mask;
+                  }
+                  slots[j] = currentSlots[i];
+              }
+              header->count = current.count;
+              header->totalBytes = current.totalBytes;
+              header->clock = current.clock;
+              next.Flush();
+          }
+          m_file.Close();
+          std::filesystem::rename(temporary, m_path);
+          m_file = MappedFile(m_path, MappedFile::Mode::ReadWrite);
+      }
+
+      std::filesystem::path m_path;
+      MappedFile m_file;
+  };
+
+  // Blobs keyed by their SHA-256, stored as <root>/blobs/<first two hex digits>/<hex>. Identical
+  // content is written once however many documents refer to it. When the stored bytes exceed
+  // the budget, least recently used blobs are evicted down to 90% of it.
+  class ContentStore
+  {
+  public:
+      ContentStore(std::filesystem::path root, uint64_t budgetBytes)
+          : m_root(std::move(root)), m_budget(budgetBytes), m_index(PrepareRoot(m_root)) {}
+
+      uint64_t Budget() const noexcept {
+          return m_budget;
+      }
+
+      size_t Count() {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_index.Count();
+      }
+
+      uint64_t TotalBytes() {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_index.TotalBytes();
+      }
+
+      bool Contains(Sha256Digest const& digest) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_index.Find(digest);
+      }
+
+      // Hashes the data and stores it unless the same content is already present
+      Sha256Digest Put(const uint8_t* data, size_t length) {
+          Sha256Digest digest = Sha256::Hash(data, length);
+          Put(digest, data, length);
+          return digest;
+      }
+
+      // Stores data whose digest the caller already computed, e.g. while reading it.
+      // Returns false when it was already present or does not fit in the budget. The blob is
+      // written outside the lock, so reads and stores of other content are not held up by it.
+      bool Put(Sha256Digest const& digest, const uint8_t* data, size_t length) {
+          if (!Reserve(digest, length)) {
+              return false;
+          }
+
+          std::filesystem::path path = BlobPath(digest);
+          std::filesystem::path partial = path;
+          partial += ".partial";
+          std::error_code error;
+          std::filesystem::create_directories(path.parent_path(), error);
+          {
+              std::ofstream output(partial, std::ios::binary | std::ios::trunc);
+              output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(length));
+              if (!output) {
+                  error = std::make_error_code(std::errc::io_error);
+              }
+          }
+          if (!error) {
+              std::filesystem::rename(partial, path, error);
+          }
+          if (error) {
+              std::error_code ignored;
+              std::filesystem::remove(partial, ignored);
+          }
+          return Publish(digest, length, !error);
+      }
+
+      // Moves in a finished file whose digest the caller already verified, e.g. a download, so
+      // it is neither copied nor read into memory. The store takes the file either way: it is
+      // deleted when the content was already present or does not fit in the budget.
+      bool PutFile(Sha256Digest const& digest, std::filesystem::path const& file) {
+          uint64_t length = std::filesystem::file_size(file);
+          std::error_code ignored;
+          if (!Reserve(digest, length)) {
+              std::filesystem::remove(file, ignored);
+              return false;
+          }
+
+          std::filesystem::path path = BlobPath(digest);
+          std::error_code error;
+          std::filesystem::create_directories(path.parent_path(), error);
+          std::filesystem::rename(file, path, error);
+          if (error) {
+              // Another volume: copied beside the blob, then renamed into place like Put does
+              std::filesystem::path partial = path;
+              partial += ".partial";
+              error.clear();
+              if (std::filesystem::copy_file(file, partial, std::filesystem::copy_options::overwrite_existing, error)) {
+                  std::filesystem::rename(partial, path, error);
+              }
+              if (error) {
+                  std::filesystem::remove(partial, ignored);
+              }
+              std::filesystem::remove(file, ignored);
+          }
+          return Publish(digest, length, !error);
+      }
+
+      // Reads a blob back and checks it still hashes to its digest; a missing or
+      // corrupted blob is dropped from the index and reported as absent. The blob is pinned
+      // while it is read outside the lock, so an eviction meanwhile leaves the file alone.
+      bool Get(Sha256Digest const& digest, std::vector<uint8_t>& out) {
+          ContentIndex::Entry entry;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              if (!m_index.Find(digest, &entry)) {
+                  return false;
+              }
+              m_index.Touch(digest);
+              m_readers[digest]++;
+          }
+
+          bool intact = false;
+          try {
+              std::ifstream input(BlobPath(digest), std::ios::binary);
+              out.resize(static_cast<size_t>(entry.size));
+              input.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(out.size()));
+              intact = input && input.gcount() == static_cast<std::streamsize>(out.size()) && Sha256::Hash(out.data(), out.size()) == digest;
+          } catch (...) {
+              Unpin(digest, false);
+              throw;
+          }
+          if (!intact) {
+              out.clear();
+          }
+          Unpin(digest, !intact);
+          return intact;
+      }
+
+      bool Remove(Sha256Digest const& digest) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return RemoveLocked(digest);
+      }
+
+      void Flush() {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_index.Flush();
+      }
+
+  private:
+      // Creates the directory layout and returns the index path
+      static std::filesystem::path PrepareRoot(std::filesystem::path const& root) {
+          std::filesystem::create_directories(root / "blobs");
+          return root / "index.bin";
+      }
+
+      std::filesystem::path BlobPath(Sha256Digest const& digest) const {
+          std::string hex = ToHex(digest);
+          return m_root / "blobs" / hex.substr(0, 2) / hex;
+      }
+
+      // Takes the digest out of the index. A blob being read is only deleted by its last reader.
+      bool RemoveLocked(Sha256Digest const& digest) {
+          if (!m_index.Erase(digest)) {
+              return false;
+          }
+          if (m_readers.count(digest) != 0) {
+              m_doomed.insert(digest);
+              return true;
+          }
+          std::error_code ignored;
+          std::filesystem::remove(BlobPath(digest), ignored);
+          return true;
+      }
+
+      // Claims the digest for one writer and makes room for it, counting the bytes of every
+      // write still in flight so concurrent stores cannot overshoot the budget together
+      bool Reserve(Sha256Digest const& digest, uint64_t length) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (m_index.Touch(digest) || m_writing.count(digest) != 0 || length > m_budget) {
+              return false;
+          }
+          EvictLocked(m_writingBytes + length);
+          m_writing.insert(digest);
+          m_writingBytes += length;
+          // The new blob replaces the file a reader still holds, which must no longer be deleted
+          m_doomed.erase(digest);
+          return true;
+      }
+
+      bool Publish(Sha256Digest const& digest, uint64_t length, bool written) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_writing.erase(digest);
+          m_writingBytes -= length;
+          if (written) {
+              m_index.Insert(digest, length);
+          }
+          return written;
+      }
+
+      void Unpin(Sha256Digest const& digest, bool corrupted) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto reader = m_readers.find(digest);
+          if (--reader->second == 0) {
+              m_readers.erase(reader);
+          }
+          if (corrupted) {
+              RemoveLocked(digest);
+          }
+          if (m_readers.count(digest) == 0 && m_doomed.erase(digest) != 0) {
+              std::error_code ignored;
+              std::filesystem::remove(BlobPath(digest), ignored);
+          }
+      }
+
+      // Makes room for `incoming` bytes, evicting in one pass rather than one blob at a time
+      void EvictLocked(uint64_t incoming) {
+          if (m_index.TotalBytes() + incoming <= m_budget) {
+              return;
+          }
+          uint64_t target = m_budget / 10 * 9;
+          target = target > incoming ? target - incoming : 0;
+
+          std::vector<ContentIndex::Entry> entries = m_index.Entries();
+          std::sort(entries.begin(), entries.end(), [](auto const& a, auto const& b) { return a.lastAccess < b.lastAccess; });
+          for (auto const& entry : entries) {
+              if (m_index.TotalBytes() <= target) {
+                  break;
+              }
+              RemoveLocked(entry.digest);
+          }
+      }
+
+      const std::filesystem::path m_root;
+      const uint64_t m_budget;
+      std::mutex m_mutex;
+      ContentIndex m_index;
+      // Digests being written, being read, and removed while read
+      std::set<Sha256Digest> m_writing;
+      uint64_t m_writingBytes = 0;
+      std::map<Sha256Digest, uint32_t> m_readers;
+      std::set<Sha256Digest> m_doomed;
+  };
+}
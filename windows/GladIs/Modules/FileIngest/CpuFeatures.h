@@ -0,0 +1,61 @@
+#pragma once
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define FILEINGEST_X86 1
+#endif
+
+#if defined(FILEINGEST_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// MSVC accepts every intrinsic unconditionally, GCC and Clang need the ISA enabled per function
+#if defined(FILEINGEST_X86) && (defined(__GNUC__) || defined(__clang__))
+#define FILEINGEST_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FILEINGEST_TARGET(isa)
+#endif
+
+namespace FileIngest
+{
+  struct CpuFeatures
+  {
+      bool sse41 = false;
+      bool sse42 = false;
+      bool ssse3 = false;
+      bool avx2 = false;
+  };
+
+  // Queries the CPU once; the result is cached for the lifetime of the process
+  inline const CpuFeatures& DetectCpuFeatures() noexcept {
+      static const CpuFeatures features = []() {
+          CpuFeatures detected;
+#if defined(FILEINGEST_X86) && defined(_MSC_VER)
+          int info[4] = {};
+          __cpuid(info, 0);
+          int maxLeaf = info[0];
+
+          __cpuid(info, 1);
+          detected.ssse3 = (info[2] & (1 << 9)) != 0;
+          detected.sse41 = (info[2] & (1 << 19)) != 0;
+          detected.sse42 = (info[2] & (1 << 20)) != 0;
+          bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+          if (maxLeaf >= 7 && osSavesYmm) {
+              __cpuidex(info, 7, 0);
+              detected.avx2 = (info[1] & (1 << 5)) != 0;
+          }
+#elif defined(FILEINGEST_X86)
+          __builtin_cpu_init();
+          detected.ssse3 = __builtin_cpu_supports("ssse3");
+          detected.sse41 = __builtin_cpu_supports("sse4.1");
+          detected.sse42 = __builtin_cpu_supports("sse4.2");
+          detected.avx2 = __builtin_cpu_supports("avx2");
+#endif
+          return detected;
+      }();
+      return features;
+  }
+}
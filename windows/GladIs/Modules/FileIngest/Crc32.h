@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FileIngest
+{
+  namespace detail
+  {
+    struct Crc32Tables
+    {
+        uint32_t values[8][256];
+
+        constexpr Crc32Tables() : values() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+                }
+                values[0][i] = crc;
+            }
+            for (uint32_t i = 0; i < 256; i++) {
+                for (int slice = 1; slice < 8; slice++) {
+                    values[slice][i] = (values[slice - 1][i] >> 8) ^ values[0][values[slice - 1][i] & 0xFF];
+                }
+            }
+        }
+    };
+
+    inline constexpr Crc32Tables kCrc32Tables{};
+  }
+
+  // CRC-32 as used by gzip, zip and the key-value log, continued from `crc` (0 to start). Slicing by 8 bytes.
+  inline uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t length) noexcept {
+      auto const& t = detail::kCrc32Tables.values;
+      crc = ~crc;
+      for (; length >= 8; data += 8, length -= 8) {
+          uint32_t low = crc ^ (uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24);
+          crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+      }
+      for (; length > 0; data++, length--) {
+          crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+      }
+      return ~crc;
+  }
+}
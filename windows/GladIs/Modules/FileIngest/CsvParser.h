@@ -0,0 +1,245 @@
+#pragma once
+
+#include "CpuFeatures.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace FileIngest
+{
+  namespace detail
+  {
+    // Returns the first byte equal to one of the four markers, or `end`
+    inline const char* FindAnyOfScalar(const char* cursor, const char* end, char a, char b, char c, char d) noexcept {
+        for (; cursor < end; cursor++) {
+            char value = *cursor;
+            if (value == a || value == b || value == c || value == d) {
+                break;
+            }
+        }
+        return cursor;
+    }
+
+#if defined(FILEINGEST_X86)
+    // SSE2 is part of the x86-64 baseline, so this needs no runtime dispatch
+    FILEINGEST_TARGET("sse2")
+    inline const char* FindAnyOf(const char* cursor, const char* end, char a, char b, char c, char d) noexcept {
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        const __m128i vc = _mm_set1_epi8(c);
+        const __m128i vd = _mm_set1_epi8(d);
+        for (; end - cursor >= 16; cursor += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+            __m128i hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, va), _mm_cmpeq_epi8(block, vb)),
+                _mm_or_si128(_mm_cmpeq_epi8(block, vc), _mm_cmpeq_epi8(block, vd)));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+            if (mask != 0) {
+                return cursor + std::countr_zero(mask);
+            }
+        }
+        return FindAnyOfScalar(cursor, end, a, b, c, d);
+    }
+#else
+    inline const char* FindAnyOf(const char* cursor, const char* end, char a, char b, char c, char d) noexcept {
+        return FindAnyOfScalar(cursor, end, a, b, c, d);
+    }
+#endif
+  }
+
+  // Picks ',' or ';' from whichever appears more often outside quotes on the first line
+  inline char DetectCsvDelimiter(const char* data, size_t length) noexcept {
+      size_t commas = 0;
+      size_t semicolons = 0;
+      bool inQuotes = false;
+      for (size_t i = 0; i < length; i++) {
+          char value = data[i];
+          if (value == '"') {
+              inQuotes = !inQuotes;
+          } else if (!inQuotes) {
+              if (value == '\n' || value == '\r') {
+                  break;
+              }
+              commas += value == ',';
+              semicolons += value == ';';
+          }
+      }
+      return semicolons > commas ? ';' : ',';
+  }
+
+  // Incremental RFC 4180 parser. Input can be fed in arbitrary pieces; every complete
+  // record is handed to `onRow` as a vector of unquoted fields. Blank lines are skipped
+  // and malformed quoting is kept as literal text rather than rejected.
+  class CsvParser
+  {
+  public:
+      // A delimiter of 0 is detected from the first line of input
+      explicit CsvParser(char delimiter = 0) noexcept : m_delimiter(delimiter) {}
+
+      char Delimiter() const noexcept {
+          return m_delimiter;
+      }
+
+      uint64_t RowCount() const noexcept {
+          return m_rowCount;
+      }
+
+      template <typename OnRow>
+      void Feed(const char* data, size_t length, OnRow&& onRow) {
+          if (m_started) {
+              Parse(data, data + length, onRow);
+              return;
+          }
+
+          // The BOM and the delimiter are decided on the whole first line, which can span pieces
+          m_head.append(data, length);
+          if (HeadComplete()) {
+              Start(onRow);
+          }
+      }
+
+      // Flushes the last record when the input does not end with a newline
+      template <typename OnRow>
+      void Finish(OnRow&& onRow) {
+          if (!m_started) {
+              Start(onRow);
+          }
+          m_inQuotes = false;
+          m_quoteSeen = false;
+          m_pendingCarriageReturn = false;
+          if (!m_row.empty() || !m_field.empty() || m_fieldQuoted) {
+              EndRow(onRow);
+          }
+      }
+
+  private:
+      // A first line longer than this is sniffed from its beginning only
+      static constexpr size_t kMaxHeadLength = 64 * 1024;
+
+      // Scans only what was appended since the last call, so tiny pieces stay linear
+      bool HeadComplete() noexcept {
+          if (m_delimiter != 0 && m_head.size() >= 3) {
+              return true;
+          }
+          for (; m_headScanned < m_head.size(); m_headScanned++) {
+              char value = m_head[m_headScanned];
+              if (value == '"') {
+                  m_headInQuotes = !m_headInQuotes;
+              } else if (!m_headInQuotes && (value == '\n' || value == '\r')) {
+                  return m_head.size() >= 3;
+              }
+          }
+          return m_head.size() >= kMaxHeadLength;
+      }
+
+      template <typename OnRow>
+      void Start(OnRow& onRow) {
+          m_started = true;
+          std::string head = std::move(m_head);
+          m_head.clear();
+          const char* cursor = head.data();
+          const char* end = head.data() + head.size();
+          if (head.size() >= 3 && std::memcmp(cursor, "\xEF\xBB\xBF", 3) == 0) {
+              cursor += 3;
+          }
+          if (m_delimiter == 0) {
+              m_delimiter = DetectCsvDelimiter(cursor, static_cast<size_t>(end - cursor));
+          }
+          Parse(cursor, end, onRow);
+      }
+
+      template <typename OnRow>
+      void Parse(const char* cursor, const char* end, OnRow& onRow) {
+          while (cursor < end) {
+              if (m_inQuotes) {
+                  if (m_quoteSeen) {
+                      m_quoteSeen = false;
+                      if (*cursor == '"') {
+                          // Doubled quote inside a quoted field
+                          m_field.push_back('"');
+                          cursor++;
+                          continue;
+                      }
+                      // The previous quote closed the field, handle this byte as unquoted
+                      m_inQuotes = false;
+                  } else {
+                      const char* quote = static_cast<const char*>(std::memchr(cursor, '"', static_cast<size_t>(end - cursor)));
+                      if (quote == nullptr) {
+                          m_field.append(cursor, end);
+                          break;
+                      }
+                      m_field.append(cursor, quote);
+                      m_quoteSeen = true;
+                      cursor = quote + 1;
+                      continue;
+                  }
+              }
+
+              if (m_pendingCarriageReturn) {
+                  m_pendingCarriageReturn = false;
+                  if (*cursor == '\n') {
+                      cursor++;
+                      continue;
+                  }
+              }
+
+              const char* special = detail::FindAnyOf(cursor, end, m_delimiter, '"', '\n', '\r');
+              m_field.append(cursor, special);
+              if (special == end) {
+                  break;
+              }
+
+              char value = *special;
+              cursor = special + 1;
+              if (value == m_delimiter) {
+                  EndField();
+              } else if (value == '"') {
+                  if (m_field.empty() && !m_fieldQuoted) {
+                      m_inQuotes = true;
+                      m_fieldQuoted = true;
+                  } else {
+                      // Stray quote in an unquoted field
+                      m_field.push_back('"');
+                  }
+              } else {
+                  EndRow(onRow);
+                  m_pendingCarriageReturn = value == '\r';
+              }
+          }
+      }
+
+      void EndField() {
+          m_row.push_back(std::move(m_field));
+          m_field.clear();
+          m_fieldQuoted = false;
+      }
+
+      template <typename OnRow>
+      void EndRow(OnRow& onRow) {
+          bool blank = m_row.empty() && m_field.empty() && !m_fieldQuoted;
+          EndField();
+          if (!blank) {
+              onRow(m_row);
+              m_rowCount++;
+          }
+          m_row.clear();
+      }
+
+      char m_delimiter;
+      bool m_started = false;
+      bool m_inQuotes = false;
+      bool m_quoteSeen = false;
+      bool m_fieldQuoted = false;
+      bool m_pendingCarriageReturn = false;
+      bool m_headInQuotes = false;
+      size_t m_headScanned = 0;
+      uint64_t m_rowCount = 0;
+      std::string m_head;
+      std::string m_field;
+      std::vector<std::string> m_row;
+  };
+}
@@ -0,0 +1,729 @@
+#pragma once
+
+#include "Crc32.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace FileIngest
+{
+  namespace Deflate
+  {
+    // Fast favours throughput and is what uploads use; Default searches longer and looks one
+    // byte ahead before taking a match, for about 5-10% smaller output at half the speed
+    enum class Level
+    {
+        Fast,
+        Default,
+    };
+
+    // Gzip wraps the deflate stream in the RFC 1952 header and trailer. Raw is the bare stream,
+    // as stored in zip entries, whose CRC and sizes live in the zip headers instead. Zlib is the
+    // RFC 1950 wrapper with an Adler-32 trailer, as PDF FlateDecode streams are stored.
+    enum class Framing
+    {
+        Gzip,
+        Raw,
+        Zlib,
+    };
+
+    // Adler-32 as used by the zlib trailer, continued from `adler` (1 to start)
+    inline uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t length) noexcept {
+        uint32_t a = adler & 0xFFFF;
+        uint32_t b = adler >> 16;
+        while (length > 0) {
+            // The largest run whose sums cannot overflow before the modulo
+            size_t run = std::min<size_t>(length, 5552);
+            length -= run;
+            for (; run > 0; run--) {
+                a += *data++;
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    namespace detail
+    {
+      inline constexpr size_t kWindowSize = 32768;
+      // Largest stored block, so incompressible input costs one 5-byte block header per block
+      inline constexpr size_t kBlockSize = 65535;
+      inline constexpr size_t kMinMatch = 3;
+      inline constexpr size_t kMaxMatch = 258;
+      inline constexpr int kHashBits = 15;
+      inline constexpr uint16_t kEndOfBlock = 256;
+      inline constexpr size_t kLiteralCodes = 286;
+      inline constexpr size_t kDistanceCodes = 30;
+      inline constexpr size_t kCodeLengthCodes = 19;
+      inline constexpr uint8_t kCodeLengthOrder[kCodeLengthCodes] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+      struct Symbol
+      {
+          // A literal byte when distance is 0, otherwise a match of `value` bytes
+          uint16_t value;
+          uint16_t distance;
+      };
+
+      struct LengthCode
+      {
+          uint16_t code;
+          uint8_t extraBits;
+          uint16_t extraValue;
+      };
+
+      // Length 3..258 to its code 257..285 and extra bits (RFC 1951, 3.2.5)
+      constexpr LengthCode CodeForLength(size_t length) noexcept {
+          size_t value = length - kMinMatch;
+          if (value < 8) {
+              return { static_cast<uint16_t>(257 + value), 0, 0 };
+          }
+          if (value == 255) {
+              return { 285, 0, 0 };
+          }
+          int floorLog = std::bit_width(value) - 1;
+          int extra = floorLog - 2;
+          return { static_cast<uint16_t>(257 + 4 * (floorLog - 1) + ((value >> extra) & 3)), static_cast<uint8_t>(extra), static_cast<uint16_t>(value & ((1u << extra) - 1)) };
+      }
+
+      // Distance 1..32768 to its code 0..29 and extra bits
+      constexpr LengthCode CodeForDistance(size_t distance) noexcept {
+          size_t value = distance - 1;
+          if (value < 4) {
+              return { static_cast<uint16_t>(value), 0, 0 };
+          }
+          int floorLog = std::bit_width(value) - 1;
+          int extra = floorLog - 1;
+          return { static_cast<uint16_t>(2 * floorLog + ((value >> extra) & 1)), static_cast<uint8_t>(extra), static_cast<uint16_t>(value & ((1u << extra) - 1)) };
+      }
+
+      static_assert(CodeForLength(3).code == 257 && CodeForLength(11).code == 265 && CodeForLength(13).code == 266 && CodeForLength(257).code == 284 && CodeForLength(257).extraValue == 30 && CodeForLength(258).code == 285);
+      static_assert(CodeForDistance(1).code == 0 && CodeForDistance(5).code == 4 && CodeForDistance(7).code == 5 && CodeForDistance(9).code == 6 && CodeForDistance(32768).code == 29);
+
+      constexpr uint8_t ExtraBitsForCodeLengthSymbol(size_t symbol) noexcept {
+          return symbol == 16 ? 2 : symbol == 17 ? 3 : symbol == 18 ? 7 : 0;
+      }
+
+      // Length-limited Huffman code lengths for `count` symbols; unused symbols get length 0.
+      // Minimum-redundancy lengths are computed in place (Moffat and Katajainen), then codes
+      // longer than `maxLength` are folded back while keeping the Kraft sum exact.
+      inline void BuildCodeLengths(const uint32_t* frequencies, size_t count, int maxLength, uint8_t* lengths) {
+          std::fill(lengths, lengths + count, uint8_t(0));
+          std::vector<uint16_t> symbols;
+          for (size_t i = 0; i < count; i++) {
+              if (frequencies[i] != 0) {
+                  symbols.push_back(static_cast<uint16_t>(i));
+              }
+          }
+          size_t n = symbols.size();
+          if (n == 0) {
+              return;
+          }
+          if (n == 1) {
+              lengths[symbols[0]] = 1;
+              return;
+          }
+          std::stable_sort(symbols.begin(), symbols.end(), [&](uint16_t a, uint16_t b) { return frequencies[a] < frequencies[b]; });
+
+          std::vector<uint32_t> a(n);
+          for (size_t i = 0; i < n; i++) {
+              a[i] = frequencies[symbols[i]];
+          }
+          a[0] += a[1];
+          size_t root = 0;
+          size_t leaf = 2;
+          for (size_t next = 1; next < n - 1; next++) {
+              if (leaf >= n || a[root] < a[leaf]) {
+                  a[next] = a[root];
+                  a[root++] = static_cast<uint32_t>(next);
+              } else {
+                  a[next] = a[leaf++];
+              }
+              if (leaf >= n || (root < next && a[root] < a[leaf])) {
+                  a[next] += a[root];
+                  a[root++] = static_cast<uint32_t>(next);
+              } else {
+                  a[next] += a[leaf++];
+              }
+          }
+          a[n - 2] = 0;
+          for (size_t next = n - 2; next-- > 0;) {
+              a[next] = a[a[next]] + 1;
+          }
+          size_t available = 1;
+          size_t used = 0;
+          uint32_t depth = 0;
+          ptrdiff_t internal = static_cast<ptrdiff_t>(n) - 2;
+          ptrdiff_t next = static_cast<ptrdiff_t>(n) - 1;
+          while (available > 0) {
+              while (internal >= 0 && a[internal] == depth) {
+                  used++;
+                  internal--;
+              }
+              while (available > used) {
+                  a[next--] = depth;
+                  available--;
+              }
+              available = 2 * used;
+              depth++;
+              used = 0;
+          }
+
+          // a[i] is now the length of symbols[i], longest first
+          std::array<uint32_t, 33> lengthCounts{};
+          for (size_t i = 0; i < n; i++) {
+              lengthCounts[std::min<uint32_t>(a[i], static_cast<uint32_t>(maxLength))]++;
+          }
+          uint64_t kraft = 0;
+          for (int length = 1; length <= maxLength; length++) {
+              kraft += uint64_t(lengthCounts[length]) << (maxLength - length);
+          }
+          while (kraft > (uint64_t(1) << maxLength)) {
+              lengthCounts[maxLength]--;
+              for (int length = maxLength - 1; length > 0; length--) {
+                  if (lengthCounts[length] != 0) {
+                      lengthCounts[length]--;
+                      lengthCounts[length + 1] += 2;
+                      break;
+                  }
+              }
+              kraft--;
+          }
+          size_t index = 0;
+          for (int length = maxLength; length > 0; length--) {
+              for (uint32_t i = 0; i < lengthCounts[length]; i++) {
+                  lengths[symbols[index++]] = static_cast<uint8_t>(length);
+              }
+          }
+      }
+
+      // Canonical codes for `lengths`, bit-reversed because deflate sends Huffman codes from
+      // their most significant bit into a least-significant-first bit stream
+      inline void BuildCodes(const uint8_t* lengths, size_t count, uint16_t* codes) noexcept {
+          uint16_t lengthCounts[16] = {};
+          for (size_t i = 0; i < count; i++) {
+              lengthCounts[lengths[i]]++;
+          }
+          lengthCounts[0] = 0;
+          uint16_t nextCode[16] = {};
+          uint16_t code = 0;
+          for (int length = 1; length < 16; length++) {
+              code = static_cast<uint16_t>((code + lengthCounts[length - 1]) << 1);
+              nextCode[length] = code;
+          }
+          for (size_t i = 0; i < count; i++) {
+              int length = lengths[i];
+              if (length == 0) {
+                  codes[i] = 0;
+                  continue;
+              }
+              uint16_t value = nextCode[length]++;
+              uint16_t reversed = 0;
+              for (int bit = 0; bit < length; bit++) {
+                  reversed = static_cast<uint16_t>((reversed << 1) | ((value >> bit) & 1));
+              }
+              codes[i] = reversed;
+          }
+      }
+
+      class BitWriter
+      {
+      public:
+          explicit BitWriter(std::vector<uint8_t>& out) noexcept : m_out(out) {}
+
+          void Put(uint32_t value, int bitCount) {
+              m_bits |= uint64_t(value) << m_bitCount;
+              m_bitCount += bitCount;
+              if (m_bitCount >= 32) {
+                  uint8_t bytes[4] = { uint8_t(m_bits), uint8_t(m_bits >> 8), uint8_t(m_bits >> 16), uint8_t(m_bits >> 24) };
+                  m_out.insert(m_out.end(), bytes, bytes + 4);
+                  m_bits >>= 32;
+                  m_bitCount -= 32;
+              }
+          }
+
+          // Moves whole bytes to the output, leaving at most 7 bits pending
+          void FlushBytes() {
+              while (m_bitCount >= 8) {
+                  m_out.push_back(static_cast<uint8_t>(m_bits));
+                  m_bits >>= 8;
+                  m_bitCount -= 8;
+              }
+          }
+
+          void AlignToByte() {
+              if (m_bitCount % 8 != 0) {
+                  Put(0, 8 - m_bitCount % 8);
+              }
+              FlushBytes();
+          }
+
+      private:
+          std::vector<uint8_t>& m_out;
+          uint64_t m_bits = 0;
+          int m_bitCount = 0;
+      };
+    }
+
+    // Streaming deflate (RFC 1951) compressor, gzip framed unless asked otherwise. Input is fed in pieces of any size; compressed
+    // bytes are handed to `onOutput(const uint8_t*, size_t)` one 64 KiB block at a time, so
+    // memory stays at about 200 KiB whatever the stream length. Each block is written with
+    // whichever of a dynamic Huffman, fixed Huffman or stored block is smallest, which keeps
+    // incompressible data within a few bytes per block of its original size.
+    class DeflateEncoder
+    {
+    public:
+        explicit DeflateEncoder(Level level = Level::Fast, Framing framing = Framing::Gzip)
+            : m_framing(framing),
+              m_maxChain(level == Level::Fast ? 8 : 64),
+              m_niceLength(level == Level::Fast ? 32 : 128),
+              m_lazy(level == Level::Default),
+              m_window(detail::kWindowSize + detail::kBlockSize),
+              m_head(size_t(1) << detail::kHashBits, -1),
+              m_previous(detail::kWindowSize, -1),
+              m_writer(m_out) {
+            m_symbols.reserve(detail::kBlockSize);
+            m_out.reserve(detail::kBlockSize + detail::kBlockSize / 8);
+        }
+
+        DeflateEncoder(DeflateEncoder const&) = delete;
+        DeflateEncoder& operator=(DeflateEncoder const&) = delete;
+
+        template <typename OnOutput>
+        void Write(const uint8_t* data, size_t length, OnOutput&& onOutput) {
+            if (m_framing == Framing::Zlib) {
+                m_adler = Adler32(m_adler, data, length);
+            } else {
+                m_crc = Crc32(m_crc, data, length);
+            }
+            m_inputBytes += length;
+            while (length > 0) {
+                size_t take = std::min(length, m_window.size() - m_filled);
+                std::memcpy(m_window.data() + m_filled, data, take);
+                m_filled += take;
+                data += take;
+                length -= take;
+                if (m_filled == m_window.size()) {
+                    CompressBlock(false);
+                    Emit(onOutput);
+                }
+            }
+        }
+
+        // Compresses what is left and writes the gzip trailer; the encoder is done afterwards
+        template <typename OnOutput>
+        void Finish(OnOutput&& onOutput) {
+            CompressBlock(true);
+            m_writer.AlignToByte();
+            if (m_framing == Framing::Gzip) {
+                for (uint32_t value : { m_crc, static_cast<uint32_t>(m_inputBytes) }) {
+                    uint8_t bytes[4] = { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24) };
+                    m_out.insert(m_out.end(), bytes, bytes + 4);
+                }
+            } else if (m_framing == Framing::Zlib) {
+                uint8_t bytes[4] = { uint8_t(m_adler >> 24), uint8_t(m_adler >> 16), uint8_t(m_adler >> 8), uint8_t(m_adler) };
+                m_out.insert(m_out.end(), bytes, bytes + 4);
+            }
+            Emit(onOutput);
+        }
+
+        // CRC-32 of the input so far; not kept for zlib framing, which uses Adler-32 instead
+        uint32_t Crc() const noexcept {
+            return m_crc;
+        }
+
+        uint64_t InputBytes() const noexcept {
+            return m_inputBytes;
+        }
+
+        uint64_t OutputBytes() const noexcept {
+            return m_outputBytes;
+        }
+
+    private:
+        struct Match
+        {
+            size_t length = 0;
+            size_t distance = 0;
+        };
+
+        template <typename OnOutput>
+        void Emit(OnOutput& onOutput) {
+            if (!m_headerWritten && m_framing == Framing::Gzip) {
+                // Deflate, no name or timestamp, unknown OS
+                static constexpr uint8_t kHeader[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+                m_out.insert(m_out.begin(), kHeader, kHeader + sizeof(kHeader));
+                m_headerWritten = true;
+            } else if (!m_headerWritten && m_framing == Framing::Zlib) {
+                // Deflate with a 32 KiB window, no dictionary, and the level as a hint
+                uint8_t header[2] = { 0x78, uint8_t(m_lazy ? 0x9C : 0x01) };
+                m_out.insert(m_out.begin(), header, header + sizeof(header));
+                m_headerWritten = true;
+            }
+            if (!m_out.empty()) {
+                onOutput(static_cast<const uint8_t*>(m_out.data()), m_out.size());
+                m_outputBytes += m_out.size();
+                m_out.clear();
+            }
+        }
+
+        uint32_t Hash(size_t position) const noexcept {
+            const uint8_t* p = m_window.data() + position;
+            uint32_t value = uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16;
+            return (value * 2654435761u) >> (32 - detail::kHashBits);
+        }
+
+        void Insert(size_t position) noexcept {
+            uint32_t hash = Hash(position);
+            m_previous[position & (detail::kWindowSize - 1)] = m_head[hash];
+            m_head[hash] = static_cast<int32_t>(position);
+        }
+
+        size_t MatchLength(size_t candidate, size_t position, size_t maxLength) const noexcept {
+            const uint8_t* a = m_window.data() + candidate;
+            const uint8_t* b = m_window.data() + position;
+            size_t length = 0;
+            if constexpr (std::endian::native == std::endian::little) {
+                while (length + 8 <= maxLength) {
+                    uint64_t x;
+                    uint64_t y;
+                    std::memcpy(&x, a + length, 8);
+                    std::memcpy(&y, b + length, 8);
+                    if (x != y) {
+                        return length + static_cast<size_t>(std::countr_zero(x ^ y) / 8);
+                    }
+                    length += 8;
+                }
+            }
+            while (length < maxLength && a[length] == b[length]) {
+                length++;
+            }
+            return length;
+        }
+
+        // Inserts `position` and returns the longest earlier match within the window
+        Match FindMatch(size_t position, size_t end) noexcept {
+            Match best;
+            if (end - position < detail::kMinMatch) {
+                return best;
+            }
+            uint32_t hash = Hash(position);
+            int32_t candidate = m_head[hash];
+            m_previous[position & (detail::kWindowSize - 1)] = candidate;
+            m_head[hash] = static_cast<int32_t>(position);
+
+            size_t maxLength = std::min(detail::kMaxMatch, end - position);
+            size_t limit = position > detail::kWindowSize ? position - detail::kWindowSize : 0;
+            int chain = m_maxChain;
+            while (candidate >= 0 && static_cast<size_t>(candidate) >= limit && chain-- > 0) {
+                size_t from = static_cast<size_t>(candidate);
+                // A candidate can only beat the best match if it agrees on the byte that would extend it
+                if (best.length == 0 || m_window[from + best.length] == m_window[position + best.length]) {
+                    size_t length = MatchLength(from, position, maxLength);
+                    if (length > best.length) {
+                        best = { length, position - from };
+                        if (length >= m_niceLength || length == maxLength) {
+                            break;
+                        }
+                    }
+                }
+                int32_t older = m_previous[from & (detail::kWindowSize - 1)];
+                // The ring slot may already hold a newer position; chains only go backwards
+                if (older >= candidate) {
+                    break;
+                }
+                candidate = older;
+            }
+            if (best.length < detail::kMinMatch) {
+                best = {};
+            }
+            return best;
+        }
+
+        void AddLiteral(uint8_t value) {
+            m_symbols.push_back({ value, 0 });
+            m_literalFrequencies[value]++;
+        }
+
+        void AddMatch(Match match) {
+            m_symbols.push_back({ static_cast<uint16_t>(match.length), static_cast<uint16_t>(match.distance) });
+            m_literalFrequencies[detail::CodeForLength(match.length).code]++;
+            m_distanceFrequencies[detail::CodeForDistance(match.distance).code]++;
+        }
+
+        void InsertRange(size_t from, size_t to, size_t end) noexcept {
+            for (size_t position = from; position < to && end - position >= detail::kMinMatch; position++) {
+                Insert(position);
+            }
+        }
+
+        // Parses [m_start, m_filled) into literals and matches, greedily or with one byte of lookahead
+        void Parse() {
+            size_t end = m_filled;
+            size_t position = m_start;
+            size_t misses = 0;
+            Match current = position < end ? FindMatch(position, end) : Match{};
+            while (position < end) {
+                if (current.length == 0) {
+                    // Fast mode searches less often the longer it goes without a match, so data
+                    // that does not compress passes at several times the speed
+                    size_t step = m_lazy ? 1 : std::min<size_t>(1 + misses++ / 32, end - position);
+                    for (size_t i = 0; i < step; i++) {
+                        AddLiteral(m_window[position + i]);
+                    }
+                    position += step;
+                    current = position < end ? FindMatch(position, end) : Match{};
+                    continue;
+                }
+                misses = 0;
+                if (m_lazy && current.length < m_niceLength && position + 1 < end) {
+                    Match next = FindMatch(position + 1, end);
+                    if (next.length > current.length) {
+                        AddLiteral(m_window[position]);
+                        position++;
+                        current = next;
+                        continue;
+                    }
+                    AddMatch(current);
+                    InsertRange(position + 2, position + current.length, end);
+                } else {
+                    AddMatch(current);
+                    // Fast mode skips indexing the inside of long matches, as zlib's level 1 does
+                    if (m_lazy || current.length <= 8) {
+                        InsertRange(position + 1, position + current.length, end);
+                    }
+                }
+                position += current.length;
+                current = position < end ? FindMatch(position, end) : Match{};
+            }
+        }
+
+        void CompressBlock(bool final) {
+            m_symbols.clear();
+            m_literalFrequencies.fill(0);
+            m_distanceFrequencies.fill(0);
+            Parse();
+            m_literalFrequencies[detail::kEndOfBlock]++;
+            WriteBlock(final);
+            Slide();
+        }
+
+        // Keeps the last window of input as history for the next block and rebases positions
+        void Slide() {
+            size_t keep = std::min(m_filled, detail::kWindowSize);
+            size_t delta = m_filled - keep;
+            if (delta > 0) {
+                std::memmove(m_window.data(), m_window.data() + delta, keep);
+                auto rebase = [delta](int32_t& position) {
+                    position = position >= static_cast<int32_t>(delta) ? position - static_cast<int32_t>(delta) : -1;
+                };
+                std::for_each(m_head.begin(), m_head.end(), rebase);
+                std::for_each(m_previous.begin(), m_previous.end(), rebase);
+                // Ring slots are indexed by position, which the shift moved
+                std::vector<int32_t> shifted(m_previous.size());
+                for (size_t i = 0; i < m_previous.size(); i++) {
+                    shifted[(i - delta) & (detail::kWindowSize - 1)] = m_previous[i];
+                }
+                m_previous.swap(shifted);
+            }
+            m_filled = keep;
+            m_start = keep;
+        }
+
+        void WriteBlock(bool final) {
+            using namespace detail;
+            std::array<uint8_t, kLiteralCodes> literalLengths;
+            std::array<uint8_t, kDistanceCodes> distanceLengths;
+            BuildCodeLengths(m_literalFrequencies.data(), kLiteralCodes, 15, literalLengths.data());
+            BuildCodeLengths(m_distanceFrequencies.data(), kDistanceCodes, 15, distanceLengths.data());
+            // A block without matches still declares one distance code
+            if (std::all_of(distanceLengths.begin(), distanceLengths.end(), [](uint8_t length) { return length == 0; })) {
+                distanceLengths[0] = 1;
+            }
+
+            size_t literalCount = kLiteralCodes;
+            while (literalCount > 257 && literalLengths[literalCount - 1] == 0) {
+                literalCount--;
+            }
+            size_t distanceCount = kDistanceCodes;
+            while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0) {
+                distanceCount--;
+            }
+
+            // Run-length code the two length tables as one sequence with symbols 16, 17 and 18
+            std::vector<uint8_t> combined(literalLengths.begin(), literalLengths.begin() + literalCount);
+            combined.insert(combined.end(), distanceLengths.begin(), distanceLengths.begin() + distanceCount);
+            std::vector<std::pair<uint8_t, uint8_t>> runs;
+            std::array<uint32_t, kCodeLengthCodes> codeLengthFrequencies{};
+            for (size_t i = 0; i < combined.size();) {
+                uint8_t value = combined[i];
+                size_t run = 1;
+                while (i + run < combined.size() && combined[i + run] == value) {
+                    run++;
+                }
+                size_t remaining = run;
+                if (value == 0) {
+                    while (remaining >= 11) {
+                        size_t take = std::min<size_t>(remaining, 138);
+                        runs.push_back({ 18, static_cast<uint8_t>(take - 11) });
+                        remaining -= take;
+                    }
+                    if (remaining >= 3) {
+                        runs.push_back({ 17, static_cast<uint8_t>(remaining - 3) });
+                        remaining = 0;
+                    }
+                } else {
+                    runs.push_back({ value, 0 });
+                    remaining--;
+                    while (remaining >= 3) {
+                        size_t take = std::min<size_t>(remaining, 6);
+                        runs.push_back({ 16, static_cast<uint8_t>(take - 3) });
+                        remaining -= take;
+                    }
+                }
+                for (; remaining > 0; remaining--) {
+                    runs.push_back({ value, 0 });
+                }
+                i += run;
+            }
+            for (auto const& run : runs) {
+                codeLengthFrequencies[run.first]++;
+            }
+            std::array<uint8_t, kCodeLengthCodes> codeLengthLengths;
+            BuildCodeLengths(codeLengthFrequencies.data(), kCodeLengthCodes, 7, codeLengthLengths.data());
+            size_t codeLengthCount = kCodeLengthCodes;
+            while (codeLengthCount > 4 && codeLengthLengths[kCodeLengthOrder[codeLengthCount - 1]] == 0) {
+                codeLengthCount--;
+            }
+
+            // Sizes in bits of the three block types, the smallest one is written
+            auto dataBits = [&](auto literalLength, auto distanceLength) {
+                uint64_t bits = 0;
+                for (size_t s = 0; s < kLiteralCodes; s++) {
+                    uint32_t extra = s >= 265 && s < 285 ? uint32_t((s - 261) / 4) : 0;
+                    bits += uint64_t(m_literalFrequencies[s]) * (literalLength(s) + extra);
+                }
+                for (size_t s = 0; s < kDistanceCodes; s++) {
+                    uint32_t extra = s >= 4 ? uint32_t(s / 2 - 1) : 0;
+                    bits += uint64_t(m_distanceFrequencies[s]) * (distanceLength(s) + extra);
+                }
+                return bits;
+            };
+            uint64_t dynamicBits = 3 + 14 + 3 * codeLengthCount + dataBits([&](size_t s) { return literalLengths[s]; }, [&](size_t s) { return distanceLengths[s]; });
+            for (size_t s = 0; s < kCodeLengthCodes; s++) {
+                dynamicBits += uint64_t(codeLengthFrequencies[s]) * (codeLengthLengths[s] + ExtraBitsForCodeLengthSymbol(s));
+            }
+            uint64_t fixedBits = 3 + dataBits([](size_t s) { return FixedLiteralLength(s); }, [](size_t) { return 5u; });
+            size_t rawLength = m_filled - m_start;
+            uint64_t storedBits = (std::max<size_t>((rawLength + 65534) / 65535, 1)) * (3 + 7 + 32) + uint64_t(rawLength) * 8;
+
+            if (storedBits <= fixedBits && storedBits <= dynamicBits) {
+                WriteStored(final);
+                return;
+            }
+            std::array<uint16_t, kLiteralCodes> literalCodes;
+            std::array<uint16_t, kDistanceCodes> distanceCodes;
+            if (fixedBits <= dynamicBits) {
+                std::array<uint8_t, 288> fixedLiteral;
+                for (size_t s = 0; s < fixedLiteral.size(); s++) {
+                    fixedLiteral[s] = static_cast<uint8_t>(FixedLiteralLength(s));
+                }
+                std::array<uint16_t, 288> fixedLiteralCodes;
+                BuildCodes(fixedLiteral.data(), fixedLiteral.size(), fixedLiteralCodes.data());
+                std::copy_n(fixedLiteral.begin(), kLiteralCodes, literalLengths.begin());
+                std::copy_n(fixedLiteralCodes.begin(), kLiteralCodes, literalCodes.begin());
+                distanceLengths.fill(5);
+                BuildCodes(distanceLengths.data(), kDistanceCodes, distanceCodes.data());
+                m_writer.Put(final ? 1 : 0, 1);
+                m_writer.Put(1, 2);
+            } else {
+                BuildCodes(literalLengths.data(), kLiteralCodes, literalCodes.data());
+                BuildCodes(distanceLengths.data(), kDistanceCodes, distanceCodes.data());
+                std::array<uint16_t, kCodeLengthCodes> codeLengthCodes;
+                BuildCodes(codeLengthLengths.data(), kCodeLengthCodes, codeLengthCodes.data());
+                m_writer.Put(final ? 1 : 0, 1);
+                m_writer.Put(2, 2);
+                m_writer.Put(static_cast<uint32_t>(literalCount - 257), 5);
+                m_writer.Put(static_cast<uint32_t>(distanceCount - 1), 5);
+                m_writer.Put(static_cast<uint32_t>(codeLengthCount - 4), 4);
+                for (size_t i = 0; i < codeLengthCount; i++) {
+                    m_writer.Put(codeLengthLengths[kCodeLengthOrder[i]], 3);
+                }
+                for (auto const& run : runs) {
+                    m_writer.Put(codeLengthCodes[run.first], codeLengthLengths[run.first]);
+                    if (run.first >= 16) {
+                        m_writer.Put(run.second, ExtraBitsForCodeLengthSymbol(run.first));
+                    }
+                }
+            }
+
+            for (Symbol const& symbol : m_symbols) {
+                if (symbol.distance == 0) {
+                    m_writer.Put(literalCodes[symbol.value], literalLengths[symbol.value]);
+                    continue;
+                }
+                LengthCode length = CodeForLength(symbol.value);
+                m_writer.Put(literalCodes[length.code], literalLengths[length.code]);
+                if (length.extraBits != 0) {
+                    m_writer.Put(length.extraValue, length.extraBits);
+                }
+                LengthCode distance = CodeForDistance(symbol.distance);
+                m_writer.Put(distanceCodes[distance.code], distanceLengths[distance.code]);
+                if (distance.extraBits != 0) {
+                    m_writer.Put(distance.extraValue, distance.extraBits);
+                }
+            }
+            m_writer.Put(literalCodes[kEndOfBlock], literalLengths[kEndOfBlock]);
+            m_writer.FlushBytes();
+        }
+
+        void WriteStored(bool final) {
+            size_t position = m_start;
+            do {
+                size_t length = std::min<size_t>(m_filled - position, 65535);
+                bool last = position + length == m_filled;
+                m_writer.Put(final && last ? 1 : 0, 1);
+                m_writer.Put(0, 2);
+                m_writer.AlignToByte();
+                uint8_t header[4] = { uint8_t(length), uint8_t(length >> 8), uint8_t(~length), uint8_t(~length >> 8) };
+                m_out.insert(m_out.end(), header, header + 4);
+                m_out.insert(m_out.end(), m_window.begin() + static_cast<ptrdiff_t>(position), m_window.begin() + static_cast<ptrdiff_t>(position + length));
+                position += length;
+            } while (position < m_filled);
+        }
+
+        static constexpr uint32_t FixedLiteralLength(size_t symbol) noexcept {
+            return symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+        }
+
+        const Framing m_framing;
+        const int m_maxChain;
+        const size_t m_niceLength;
+        const bool m_lazy;
+        std::vector<uint8_t> m_window;
+        std::vector<int32_t> m_head;
+        std::vector<int32_t> m_previous;
+        size_t m_start = 0;
+        size_t m_filled = 0;
+        std::vector<detail::Symbol> m_symbols;
+        std::array<uint32_t, detail::kLiteralCodes> m_literalFrequencies{};
+        std::array<uint32_t, detail::kDistanceCodes> m_distanceFrequencies{};
+        std::vector<uint8_t> m_out;
+        detail::BitWriter m_writer;
+        bool m_headerWritten = false;
+        uint32_t m_crc = 0;
+        uint32_t m_adler = 1;
+        uint64_t m_inputBytes = 0;
+        uint64_t m_outputBytes = 0;
+    };
+
+    // Gzip is the default framing; the name says what uploads send
+    using GzipEncoder = DeflateEncoder;
+  }
+}
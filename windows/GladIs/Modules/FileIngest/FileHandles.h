@@ -0,0 +1,184 @@
+#pragma once
+
+#include "BufferPool.h"
+#include "RangeSource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace FileIngest
+{
+  // Thrown for a handle that was never opened, already closed, or expired
+  struct InvalidHandle : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  struct HandleLimitReached : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  struct InvalidRange : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  struct FileHandleInfo
+  {
+      uint32_t handle = 0;
+      std::string name;
+      std::string mimeType;
+      uint64_t size = 0;
+  };
+
+  // Open files handed to JS as small integers. An entry holds only the open source and its
+  // metadata, never file content, so memory stays flat however many handles are open and
+  // however large the files are; each read allocates just the range it returns.
+  class FileHandleTable
+  {
+  public:
+      using Clock = std::chrono::steady_clock;
+
+      // Handles unused for `idleTimeout` are reclaimed when the table is full, in case JS lost them
+      FileHandleTable(size_t maxOpen, Clock::duration idleTimeout) : m_maxOpen(maxOpen), m_idleTimeout(idleTimeout) {}
+
+      FileHandleTable(FileHandleTable const&) = delete;
+      FileHandleTable& operator=(FileHandleTable const&) = delete;
+
+      FileHandleInfo Open(std::unique_ptr<RangeSource> source, std::string name, std::string mimeType) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (m_entries.size() >= m_maxOpen) {
+              CloseIdleLocked(Clock::now());
+          }
+          if (m_entries.size() >= m_maxOpen) {
+              throw HandleLimitReached("Too many open files");
+          }
+          uint32_t handle = NextHandleLocked();
+          Entry& entry = m_entries[handle];
+          entry.info = { handle, std::move(name), std::move(mimeType), source->Size() };
+          entry.source = std::move(source);
+          entry.lastUse = Clock::now();
+          return entry.info;
+      }
+
+      FileHandleInfo Info(uint32_t handle) const {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return FindLocked(handle).info;
+      }
+
+      // Reads [offset, offset + length) clipped to the end of the file into `out`. A length
+      // above maxLength is refused rather than clipped, so callers notice they asked too much.
+      void ReadRange(uint32_t handle, uint64_t offset, uint64_t length, size_t maxLength, std::vector<uint8_t>& out) {
+          size_t clipped = 0;
+          std::shared_ptr<RangeSource> source = SourceForRange(handle, offset, length, maxLength, clipped);
+          // Read outside the lock; a concurrent Close only releases the source once this read is done
+          out.resize(clipped);
+          out.resize(source->ReadAt(offset, out.data(), out.size()));
+      }
+
+      // Same, into a buffer taken from `pool`
+      PooledBuffer ReadRange(uint32_t handle, uint64_t offset, uint64_t length, size_t maxLength, BufferPool& pool) {
+          size_t clipped = 0;
+          std::shared_ptr<RangeSource> source = SourceForRange(handle, offset, length, maxLength, clipped);
+          PooledBuffer out = pool.Acquire(clipped);
+          out.Resize(source->ReadAt(offset, out.Data(), out.Size()));
+          return out;
+      }
+
+      // The source itself, for readers that seek around the file on their own. A concurrent Close
+      // only releases it once the caller lets go.
+      std::shared_ptr<RangeSource> Source(uint32_t handle) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          Entry& entry = FindLocked(handle);
+          entry.lastUse = Clock::now();
+          return entry.source;
+      }
+
+      // Returns false when the handle was not open
+      bool Close(uint32_t handle) {
+          std::shared_ptr<RangeSource> released;
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto it = m_entries.find(handle);
+          if (it == m_entries.end()) {
+              return false;
+          }
+          released = std::move(it->second.source);
+          m_entries.erase(it);
+          return true;
+      }
+
+      size_t Count() const {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_entries.size();
+      }
+
+  private:
+      struct Entry
+      {
+          FileHandleInfo info;
+          std::shared_ptr<RangeSource> source;
+          Clock::time_point lastUse;
+      };
+
+      Entry& FindLocked(uint32_t handle) {
+          auto it = m_entries.find(handle);
+          if (it == m_entries.end()) {
+              throw InvalidHandle("Invalid file handle");
+          }
+          return it->second;
+      }
+
+      Entry const& FindLocked(uint32_t handle) const {
+          return const_cast<FileHandleTable*>(this)->FindLocked(handle);
+      }
+
+      std::shared_ptr<RangeSource> SourceForRange(uint32_t handle, uint64_t offset, uint64_t length, size_t maxLength, size_t& clipped) {
+          if (length > maxLength) {
+              throw InvalidRange("Range is too large");
+          }
+          std::shared_ptr<RangeSource> source;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              Entry& entry = FindLocked(handle);
+              entry.lastUse = Clock::now();
+              source = entry.source;
+          }
+          uint64_t size = source->Size();
+          if (offset > size) {
+              throw InvalidRange("Offset is past the end of the file");
+          }
+          clipped = static_cast<size_t>(std::min(length, size - offset));
+          return source;
+      }
+
+      // Never hands out 0, and skips ids still in use once the counter wraps
+      uint32_t NextHandleLocked() noexcept {
+          do {
+              m_nextHandle++;
+          } while (m_nextHandle == 0 || m_entries.count(m_nextHandle) != 0);
+          return m_nextHandle;
+      }
+
+      void CloseIdleLocked(Clock::time_point now) {
+          for (auto it = m_entries.begin(); it != m_entries.end();) {
+              it = now - it->second.lastUse >= m_idleTimeout ? m_entries.erase(it) : std::next(it);
+          }
+      }
+
+      const size_t m_maxOpen;
+      const Clock::duration m_idleTimeout;
+      mutable std::mutex m_mutex;
+      std::unordered_map<uint32_t, Entry> m_entries;
+      uint32_t m_nextHandle = 0;
+  };
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+namespace FileIngest
+{
+  // Thrown when a picked file fails the size or content check, before it is read in full
+  struct FileRejected : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  // Number of leading bytes loaded to identify a file
+  inline constexpr size_t kSniffLength = 1024;
+
+  struct MagicSignature
+  {
+      std::string_view magic;
+      // How far into the file the magic may start, 0 for an exact prefix
+      size_t searchWindow;
+      // Matches the values of the MimeType enum on the JS side
+      std::string_view mimeType;
+  };
+
+  // One JS-side file type ("pdf", "image", "csv") with everything needed to pick and check it.
+  // A type without signatures is text and is checked for binary content instead.
+  struct FileTypeDescriptor
+  {
+      std::string_view name;
+      std::span<const std::string_view> extensions;
+      std::span<const MagicSignature> signatures;
+      std::string_view textMimeType;
+      uint64_t maxBytes;
+      // Resolved by the pick methods when the dialog is dismissed
+      std::string_view noSelectionMessage;
+  };
+
+  namespace detail
+  {
+    inline constexpr std::string_view kPdfExtensions[] = { ".pdf" };
+    inline constexpr std::string_view kImageExtensions[] = { ".png", ".jpg", ".jpeg" };
+    inline constexpr std::string_view kCsvExtensions[] = { ".csv" };
+
+    // Readers accept a PDF header anywhere in the first kilobyte, some generators prepend junk
+    inline constexpr MagicSignature kPdfSignatures[] = {
+        { "%PDF-", 1024 - 5, "application/pdf" },
+    };
+
+    inline constexpr MagicSignature kImageSignatures[] = {
+        { "\x89PNG\r\n\x1A\n", 0, "image/png" },
+        { "\xFF\xD8\xFF", 0, "image/jpeg" },
+    };
+  }
+
+  inline constexpr std::array<FileTypeDescriptor, 3> kFileTypes = { {
+      { "pdf", detail::kPdfExtensions, detail::kPdfSignatures, {}, 100ull * 1024 * 1024, "No file selected" },
+      { "image", detail::kImageExtensions, detail::kImageSignatures, {}, 20ull * 1024 * 1024, "No image selected" },
+      { "csv", detail::kCsvExtensions, {}, "text/csv", 50ull * 1024 * 1024, "No file selected" },
+  } };
+
+  constexpr const FileTypeDescriptor* FindFileType(std::string_view name) noexcept {
+      for (auto const& descriptor : kFileTypes) {
+          if (descriptor.name == name) {
+              return &descriptor;
+          }
+      }
+      return nullptr;
+  }
+
+  static_assert(FindFileType("pdf")->name == "pdf" && FindFileType("image")->name == "image" && FindFileType("csv")->name == "csv");
+
+  namespace detail
+  {
+    constexpr bool MatchesSignature(MagicSignature const& signature, std::string_view head) noexcept {
+        size_t lastStart = std::min(signature.searchWindow, head.size());
+        for (size_t start = 0; start <= lastStart && start + signature.magic.size() <= head.size(); start++) {
+            if (head.substr(start, signature.magic.size()) == signature.magic) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Text files may hold any 8-bit encoding, but never NUL or other C0 controls besides whitespace
+    constexpr bool LooksLikeText(std::string_view head) noexcept {
+        for (char c : head) {
+            auto value = static_cast<unsigned char>(c);
+            if (value < 0x20 && value != '\t' && value != '\n' && value != '\r' && value != '\f') {
+                return false;
+            }
+        }
+        return true;
+    }
+  }
+
+  // Identifies a file from its size and first bytes. Returns the MIME type of the matched
+  // format, or an empty view when the file does not belong to the descriptor's type.
+  constexpr std::string_view SniffMimeType(FileTypeDescriptor const& descriptor, std::string_view head) noexcept {
+      if (descriptor.signatures.empty()) {
+          return detail::LooksLikeText(head) ? descriptor.textMimeType : std::string_view();
+      }
+      for (auto const& signature : descriptor.signatures) {
+          if (detail::MatchesSignature(signature, head)) {
+              return signature.mimeType;
+          }
+      }
+      return {};
+  }
+
+  // Throws FileRejected with a message suitable for the JS promise
+  inline std::string_view CheckFile(FileTypeDescriptor const& descriptor, uint64_t size, const uint8_t* head, size_t headLength) {
+      if (size == 0) {
+          throw FileRejected("File is empty");
+      }
+      if (size > descriptor.maxBytes) {
+          throw FileRejected("File is too large");
+      }
+      std::string_view mimeType = SniffMimeType(descriptor, std::string_view(reinterpret_cast<const char*>(head), headLength));
+      if (mimeType.empty()) {
+          throw FileRejected("File content does not match its type");
+      }
+      return mimeType;
+  }
+
+  static_assert(SniffMimeType(kFileTypes[0], "%PDF-1.7\n") == "application/pdf");
+  static_assert(SniffMimeType(kFileTypes[0], "\r\n%PDF-1.4") == "application/pdf");
+  static_assert(SniffMimeType(kFileTypes[1], "\xFF\xD8\xFF\xE0") == "image/jpeg");
+  static_assert(SniffMimeType(kFileTypes[1], "%PDF-1.7").empty());
+  static_assert(SniffMimeType(kFileTypes[2], "a;b\r\n1;2\n") == "text/csv");
+  static_assert(SniffMimeType(kFileTypes[2], std::string_view("PK\x03\x04\0\0", 6)).empty());
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace FileIngest
+{
+  struct ImageSize
+  {
+      uint32_t width = 0;
+      uint32_t height = 0;
+  };
+
+  // Resampling of 8-bit, 4-channel pixels (BGRA or RGBA, premultiplied so transparent pixels do not
+  // bleed their colour). Every output pixel is the coverage-weighted mean of the source pixels under
+  // it, which keeps large downscales free of the aliasing bilinear sampling gives.
+  namespace ImageResize
+  {
+    enum class Kernel
+    {
+        Scalar,
+        Sse41,
+    };
+
+    inline constexpr size_t kChannels = 4;
+
+    // Largest size within the bounds that keeps the source aspect ratio. Never upscales;
+    // a zero bound leaves that axis unconstrained.
+    constexpr ImageSize FitWithin(ImageSize source, uint32_t maxWidth, uint32_t maxHeight) noexcept {
+        uint64_t width = source.width;
+        uint64_t height = source.height;
+        if (width == 0 || height == 0) {
+            return source;
+        }
+        bool widthBound = maxWidth != 0 && (maxHeight == 0 || width * maxHeight >= height * maxWidth);
+        if (widthBound && width > maxWidth) {
+            return { maxWidth, static_cast<uint32_t>(std::max<uint64_t>(1, (height * maxWidth + width / 2) / width)) };
+        }
+        if (!widthBound && maxHeight != 0 && height > maxHeight) {
+            return { static_cast<uint32_t>(std::max<uint64_t>(1, (width * maxHeight + height / 2) / height)), maxHeight };
+        }
+        return source;
+    }
+
+    static_assert(FitWithin({ 4032, 3024 }, 512, 512).width == 512 && FitWithin({ 4032, 3024 }, 512, 512).height == 384);
+    static_assert(FitWithin({ 3024, 4032 }, 512, 0).width == 512 && FitWithin({ 3024, 4032 }, 512, 0).height == 683);
+    static_assert(FitWithin({ 300, 200 }, 512, 512).width == 300);
+
+    namespace detail
+    {
+      // Source span and weights of every output sample along one axis. The weights of a sample sum to one.
+      struct AxisWeights
+      {
+          std::vector<uint32_t> first;
+          std::vector<uint32_t> count;
+          std::vector<uint32_t> offset;
+          std::vector<float> weights;
+      };
+
+      inline AxisWeights ComputeAxisWeights(uint32_t sourceLength, uint32_t targetLength) {
+          AxisWeights axis;
+          axis.first.reserve(targetLength);
+          axis.count.reserve(targetLength);
+          axis.offset.reserve(targetLength);
+          double scale = double(sourceLength) / targetLength;
+          for (uint32_t i = 0; i < targetLength; i++) {
+              double start = i * scale;
+              double end = std::min<double>((i + 1) * scale, sourceLength);
+              uint32_t first = static_cast<uint32_t>(start);
+              uint32_t last = std::min<uint32_t>(static_cast<uint32_t>(std::ceil(end)), sourceLength);
+              axis.first.push_back(first);
+              axis.count.push_back(last - first);
+              axis.offset.push_back(static_cast<uint32_t>(axis.weights.size()));
+              for (uint32_t j = first; j < last; j++) {
+                  double coverage = std::min<double>(end, j + 1.0) - std::max<double>(start, j);
+                  axis.weights.push_back(static_cast<float>(coverage / scale));
+              }
+          }
+          return axis;
+      }
+
+      inline void FilterRowScalar(const uint8_t* source, AxisWeights const& columns, float* out) noexcept {
+          for (size_t x = 0; x < columns.first.size(); x++) {
+              const uint8_t* pixel = source + size_t(columns.first[x]) * kChannels;
+              const float* weight = columns.weights.data() + columns.offset[x];
+              float sum[kChannels] = {};
+              for (uint32_t k = 0; k < columns.count[x]; k++) {
+                  for (size_t c = 0; c < kChannels; c++) {
+                      sum[c] += float(pixel[k * kChannels + c]) * weight[k];
+                  }
+              }
+              std::memcpy(out + x * kChannels, sum, sizeof(sum));
+          }
+      }
+
+      inline void AccumulateScalar(const float* row, float weight, float* accumulator, size_t length) noexcept {
+          for (size_t i = 0; i < length; i++) {
+              accumulator[i] += row[i] * weight;
+          }
+      }
+
+      inline void StoreScalar(const float* accumulator, uint8_t* out, size_t length) noexcept {
+          for (size_t i = 0; i < length; i++) {
+              // nearbyint rounds half to even like _mm_cvtps_epi32, so both kernels agree
+              out[i] = static_cast<uint8_t>(std::clamp(std::nearbyint(accumulator[i]), 0.0f, 255.0f));
+          }
+      }
+
+#if defined(FILEINGEST_X86)
+      // One pixel is one vector: the four channels are widened to floats and weighted together
+      FILEINGEST_TARGET("sse4.1")
+      inline void FilterRowSse41(const uint8_t* source, AxisWeights const& columns, float* out) noexcept {
+          for (size_t x = 0; x < columns.first.size(); x++) {
+              const uint8_t* pixel = source + size_t(columns.first[x]) * kChannels;
+              const float* weight = columns.weights.data() + columns.offset[x];
+              __m128 sum = _mm_setzero_ps();
+              for (uint32_t k = 0; k < columns.count[x]; k++) {
+                  int32_t packed;
+                  std::memcpy(&packed, pixel + k * kChannels, sizeof(packed));
+                  __m128 value = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+                  sum = _mm_add_ps(sum, _mm_mul_ps(value, _mm_set1_ps(weight[k])));
+              }
+              _mm_storeu_ps(out + x * kChannels, sum);
+          }
+      }
+
+      FILEINGEST_TARGET("sse4.1")
+      inline void AccumulateSse41(const float* row, float weight, float* accumulator, size_t length) noexcept {
+          const __m128 factor = _mm_set1_ps(weight);
+          size_t i = 0;
+          for (; i + 4 <= length; i += 4) {
+              __m128 sum = _mm_add_ps(_mm_loadu_ps(accumulator + i), _mm_mul_ps(_mm_loadu_ps(row + i), factor));
+              _mm_storeu_ps(accumulator + i, sum);
+          }
+          AccumulateScalar(row + i, weight, accumulator + i, length - i);
+      }
+
+      FILEINGEST_TARGET("sse4.1")
+      inline void StoreSse41(const float* accumulator, uint8_t* out, size_t length) noexcept {
+          size_t i = 0;
+          for (; i + 16 <= length; i += 16) {
+              __m128i a = _mm_cvtps_epi32(_mm_loadu_ps(accumulator + i));
+              __m128i b = _mm_cvtps_epi32(_mm_loadu_ps(accumulator + i + 4));
+              __m128i c = _mm_cvtps_epi32(_mm_loadu_ps(accumulator + i + 8));
+              __m128i d = _mm_cvtps_epi32(_mm_loadu_ps(accumulator + i + 12));
+              // Saturating packs clamp to 0..255 on the way down
+              __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+              _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+          }
+          StoreScalar(accumulator + i, out + i, length - i);
+      }
+#endif
+
+      inline Kernel SelectKernel() noexcept {
+          return DetectCpuFeatures().sse41 ? Kernel::Sse41 : Kernel::Scalar;
+      }
+    }
+
+    // Best kernel for this machine, resolved once
+    inline Kernel ActiveKernel() noexcept {
+        static const Kernel kernel = detail::SelectKernel();
+        return kernel;
+    }
+
+    // Resamples `source` into `target`, both tightly packed 4-channel pixels with the given row strides
+    // in bytes. Source rows are filtered horizontally once each and folded into an accumulator row,
+    // so the working memory is two target rows of floats whatever the source size.
+    inline void Resize(const uint8_t* source, ImageSize sourceSize, size_t sourceStride, uint8_t* target, ImageSize targetSize, size_t targetStride, Kernel kernel = ActiveKernel()) {
+        if (sourceSize.width == 0 || sourceSize.height == 0 || targetSize.width == 0 || targetSize.height == 0) {
+            return;
+        }
+        detail::AxisWeights columns = detail::ComputeAxisWeights(sourceSize.width, targetSize.width);
+        detail::AxisWeights rows = detail::ComputeAxisWeights(sourceSize.height, targetSize.height);
+        size_t rowLength = size_t(targetSize.width) * kChannels;
+        std::vector<float> filtered(rowLength);
+        std::vector<float> accumulator(rowLength);
+
+        auto filterRow = detail::FilterRowScalar;
+        auto accumulate = detail::AccumulateScalar;
+        auto store = detail::StoreScalar;
+#if defined(FILEINGEST_X86)
+        if (kernel == Kernel::Sse41) {
+            filterRow = detail::FilterRowSse41;
+            accumulate = detail::AccumulateSse41;
+            store = detail::StoreSse41;
+        }
+#else
+        (void)kernel;
+#endif
+
+        // Consecutive output rows share at most their boundary source row, so caching one row is enough
+        uint32_t filteredRow = UINT32_MAX;
+        for (uint32_t y = 0; y < targetSize.height; y++) {
+            std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+            for (uint32_t k = 0; k < rows.count[y]; k++) {
+                uint32_t sourceRow = rows.first[y] + k;
+                if (sourceRow != filteredRow) {
+                    filterRow(source + size_t(sourceRow) * sourceStride, columns, filtered.data());
+                    filteredRow = sourceRow;
+                }
+                accumulate(filtered.data(), rows.weights[rows.offset[y] + k], accumulator.data(), rowLength);
+            }
+            store(accumulator.data(), target + size_t(y) * targetStride, rowLength);
+        }
+    }
+
+    // Composites premultiplied pixels over an opaque grey level, for encoders without alpha such as JPEG
+    inline void FlattenPremultiplied(uint8_t* pixels, size_t pixelCount, uint8_t background) noexcept {
+        for (size_t i = 0; i < pixelCount; i++) {
+            uint8_t* pixel = pixels + i * kChannels;
+            uint32_t cover = (255u - pixel[3]) * background;
+            for (size_t c = 0; c < 3; c++) {
+                pixel[c] = static_cast<uint8_t>(pixel[c] + (cover + 127) / 255);
+            }
+            pixel[3] = 255;
+        }
+    }
+  }
+}
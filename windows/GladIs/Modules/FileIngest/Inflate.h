@@ -0,0 +1,387 @@
+#pragma once
+
+#include "Crc32.h"
+#include "Deflate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace FileIngest
+{
+  // The compressed data is malformed, truncated, fails its checksum or inflates past the limit
+  struct InflateError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  namespace Deflate
+  {
+    namespace detail
+    {
+      inline constexpr uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+      inline constexpr uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+      inline constexpr uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+      inline constexpr uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+      // Least-significant-bit-first reader over the whole input, refilled a byte at a time into
+      // a 64-bit buffer. Peeking past the end sees zero bits; consuming them is an error.
+      class BitReader
+      {
+      public:
+          BitReader(const uint8_t* data, size_t length) noexcept : m_next(data), m_end(data + length) {}
+
+          void Refill() noexcept {
+              while (m_count <= 56 && m_next < m_end) {
+                  m_bits |= uint64_t(*m_next++) << m_count;
+                  m_count += 8;
+              }
+          }
+
+          uint32_t Peek(int count) noexcept {
+              if (m_count < count) {
+                  Refill();
+              }
+              return static_cast<uint32_t>(m_bits & ((uint64_t(1) << count) - 1));
+          }
+
+          void Consume(int count) {
+              if (m_count < count) {
+                  throw InflateError("Deflate stream is truncated");
+              }
+              m_bits >>= count;
+              m_count -= count;
+          }
+
+          uint32_t Read(int count) {
+              uint32_t value = Peek(count);
+              Consume(count);
+              return value;
+          }
+
+          void AlignToByte() noexcept {
+              m_bits >>= m_count % 8;
+              m_count -= m_count % 8;
+          }
+
+          // After AlignToByte: copies `length` bytes straight from the input
+          void CopyBytes(uint8_t* out, size_t length) {
+              for (; length > 0 && m_count >= 8; length--) {
+                  *out++ = static_cast<uint8_t>(m_bits);
+                  m_bits >>= 8;
+                  m_count -= 8;
+              }
+              if (static_cast<size_t>(m_end - m_next) < length) {
+                  throw InflateError("Deflate stream is truncated");
+              }
+              std::memcpy(out, m_next, length);
+              m_next += length;
+          }
+
+          // After AlignToByte: bytes left, including those already in the bit buffer
+          size_t RemainingBytes() const noexcept {
+              return static_cast<size_t>(m_end - m_next) + m_count / 8;
+          }
+
+      private:
+          const uint8_t* m_next;
+          const uint8_t* m_end;
+          uint64_t m_bits = 0;
+          int m_count = 0;
+      };
+
+      // Decoder for one canonical Huffman code. Codes of up to kFastBits bits resolve with one
+      // table lookup on the next input bits; longer ones, rare in practice, walk the code one
+      // bit at a time from the counts per length.
+      class HuffmanDecoder
+      {
+      public:
+          static constexpr int kFastBits = 10;
+
+          // Incomplete codes are accepted, as zlib does for single-distance streams; an
+          // over-subscribed code cannot be decoded and throws
+          void Build(const uint8_t* lengths, size_t count) {
+              std::memset(m_counts, 0, sizeof(m_counts));
+              for (size_t i = 0; i < count; i++) {
+                  m_counts[lengths[i]]++;
+              }
+              m_counts[0] = 0;
+              int left = 1;
+              for (int length = 1; length < 16; length++) {
+                  left = (left << 1) - m_counts[length];
+                  if (left < 0) {
+                      throw InflateError("Deflate stream has an invalid Huffman code");
+                  }
+              }
+              uint16_t offsets[16] = {};
+              for (int length = 1; length < 15; length++) {
+                  offsets[length + 1] = static_cast<uint16_t>(offsets[length] + m_counts[length]);
+              }
+              for (size_t i = 0; i < count; i++) {
+                  if (lengths[i] != 0) {
+                      m_symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+                  }
+              }
+              uint16_t codes[kLiteralCodes + 2];
+              BuildCodes(lengths, count, codes);
+              std::memset(m_fast, 0, sizeof(m_fast));
+              for (size_t i = 0; i < count; i++) {
+                  int length = lengths[i];
+                  if (length == 0 || length > kFastBits) {
+                      continue;
+                  }
+                  for (uint32_t index = codes[i]; index < (1u << kFastBits); index += 1u << length) {
+                      m_fast[index] = static_cast<uint16_t>(i << 4 | length);
+                  }
+              }
+          }
+
+          uint32_t Decode(BitReader& in) const {
+              uint16_t entry = m_fast[in.Peek(kFastBits)];
+              if (entry != 0) {
+                  in.Consume(entry & 15);
+                  return entry >> 4;
+              }
+              int code = 0;
+              int first = 0;
+              int index = 0;
+              for (int length = 1; length < 16; length++) {
+                  code |= static_cast<int>(in.Read(1));
+                  int count = m_counts[length];
+                  if (code - first < count) {
+                      return m_symbols[index + code - first];
+                  }
+                  index += count;
+                  first = (first + count) << 1;
+                  code <<= 1;
+              }
+              throw InflateError("Deflate stream has an invalid Huffman code");
+          }
+
+      private:
+          // (symbol << 4) | length, 0 when the code is longer than kFastBits or unused
+          uint16_t m_fast[1 << kFastBits];
+          uint16_t m_counts[16];
+          uint16_t m_symbols[kLiteralCodes + 2];
+      };
+
+      struct FixedDecoders
+      {
+          HuffmanDecoder literal;
+          HuffmanDecoder distance;
+
+          FixedDecoders() {
+              uint8_t lengths[288];
+              std::memset(lengths, 8, 144);
+              std::memset(lengths + 144, 9, 112);
+              std::memset(lengths + 256, 7, 24);
+              std::memset(lengths + 280, 8, 8);
+              literal.Build(lengths, 288);
+              std::memset(lengths, 5, 30);
+              distance.Build(lengths, 30);
+          }
+      };
+
+      inline void ReadDynamicCodes(BitReader& in, HuffmanDecoder& literal, HuffmanDecoder& distance) {
+          size_t literalCount = in.Read(5) + 257;
+          size_t distanceCount = in.Read(5) + 1;
+          size_t codeLengthCount = in.Read(4) + 4;
+          if (literalCount > kLiteralCodes || distanceCount > kDistanceCodes) {
+              throw InflateError("Deflate stream has too many codes");
+          }
+          uint8_t codeLengthLengths[kCodeLengthCodes] = {};
+          for (size_t i = 0; i < codeLengthCount; i++) {
+              codeLengthLengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(in.Read(3));
+          }
+          HuffmanDecoder codeLengths;
+          codeLengths.Build(codeLengthLengths, kCodeLengthCodes);
+
+          uint8_t lengths[kLiteralCodes + kDistanceCodes] = {};
+          size_t total = literalCount + distanceCount;
+          for (size_t i = 0; i < total;) {
+              uint32_t symbol = codeLengths.Decode(in);
+              if (symbol < 16) {
+                  lengths[i++] = static_cast<uint8_t>(symbol);
+                  continue;
+              }
+              uint8_t value = 0;
+              size_t repeat;
+              if (symbol == 16) {
+                  if (i == 0) {
+                      throw InflateError("Deflate stream repeats a missing code length");
+                  }
+                  value = lengths[i - 1];
+                  repeat = 3 + in.Read(2);
+              } else if (symbol == 17) {
+                  repeat = 3 + in.Read(3);
+              } else {
+                  repeat = 11 + in.Read(7);
+              }
+              if (i + repeat > total) {
+                  throw InflateError("Deflate stream has too many code lengths");
+              }
+              std::memset(lengths + i, value, repeat);
+              i += repeat;
+          }
+          if (lengths[kEndOfBlock] == 0) {
+              throw InflateError("Deflate stream has no end-of-block code");
+          }
+          literal.Build(lengths, literalCount);
+          distance.Build(lengths + literalCount, distanceCount);
+      }
+
+      // Decodes blocks until the final one, appending to `out` after `start`
+      inline void InflateBlocks(BitReader& in, std::vector<uint8_t>& out, size_t start, size_t maxOutput) {
+          static const FixedDecoders fixed;
+          HuffmanDecoder dynamicLiteral;
+          HuffmanDecoder dynamicDistance;
+          bool final = false;
+          while (!final) {
+              final = in.Read(1) != 0;
+              uint32_t type = in.Read(2);
+              if (type == 0) {
+                  in.AlignToByte();
+                  uint32_t length = in.Read(16);
+                  uint32_t complement = in.Read(16);
+                  if ((length ^ 0xFFFF) != complement) {
+                      throw InflateError("Deflate stored block has a bad length");
+                  }
+                  if (out.size() - start + length > maxOutput) {
+                      throw InflateError("Inflated data exceeds the limit");
+                  }
+                  size_t at = out.size();
+                  out.resize(at + length);
+                  in.CopyBytes(out.data() + at, length);
+                  continue;
+              }
+              if (type == 3) {
+                  throw InflateError("Deflate stream has an invalid block type");
+              }
+              const HuffmanDecoder* literal = &fixed.literal;
+              const HuffmanDecoder* distance = &fixed.distance;
+              if (type == 2) {
+                  ReadDynamicCodes(in, dynamicLiteral, dynamicDistance);
+                  literal = &dynamicLiteral;
+                  distance = &dynamicDistance;
+              }
+              for (;;) {
+                  uint32_t symbol = literal->Decode(in);
+                  if (symbol < 256) {
+                      if (out.size() - start >= maxOutput) {
+                          throw InflateError("Inflated data exceeds the limit");
+                      }
+                      out.push_back(static_cast<uint8_t>(symbol));
+                      continue;
+                  }
+                  if (symbol == kEndOfBlock) {
+                      break;
+                  }
+                  symbol -= 257;
+                  if (symbol >= 29) {
+                      throw InflateError("Deflate stream has an invalid length code");
+                  }
+                  size_t length = kLengthBase[symbol] + in.Read(kLengthExtra[symbol]);
+                  uint32_t code = distance->Decode(in);
+                  if (code >= 30) {
+                      throw InflateError("Deflate stream has an invalid distance code");
+                  }
+                  size_t back = kDistanceBase[code] + in.Read(kDistanceExtra[code]);
+                  size_t at = out.size();
+                  if (back > at - start) {
+                      throw InflateError("Deflate stream refers back before its start");
+                  }
+                  if (at - start + length > maxOutput) {
+                      throw InflateError("Inflated data exceeds the limit");
+                  }
+                  out.resize(at + length);
+                  uint8_t* to = out.data() + at;
+                  const uint8_t* from = to - back;
+                  if (back >= length) {
+                      std::memcpy(to, from, length);
+                  } else {
+                      // Overlapping runs repeat the last `back` bytes
+                      for (size_t i = 0; i < length; i++) {
+                          to[i] = from[i];
+                      }
+                  }
+              }
+          }
+      }
+
+      inline uint32_t ReadBigEndian32(BitReader& in) {
+          uint32_t value = 0;
+          for (int i = 0; i < 4; i++) {
+              value = value << 8 | in.Read(8);
+          }
+          return value;
+      }
+
+      inline uint32_t ReadLittleEndian32(BitReader& in) {
+          uint32_t value = 0;
+          for (int i = 0; i < 4; i++) {
+              value |= in.Read(8) << (8 * i);
+          }
+          return value;
+      }
+    }
+
+    // Decompresses one deflate stream in `framing`, appending at most `maxOutput` bytes to
+    // `out`. Throws InflateError on anything malformed or when the checksum does not match;
+    // what was decoded up to that point stays in `out`, for callers that would rather keep a
+    // damaged stream's readable part, as PDF readers do.
+    inline void Inflate(const uint8_t* data, size_t length, Framing framing, std::vector<uint8_t>& out, size_t maxOutput = SIZE_MAX) {
+        detail::BitReader in(data, length);
+        if (framing == Framing::Zlib) {
+            uint32_t method = in.Read(8);
+            uint32_t flags = in.Read(8);
+            if ((method & 0x0F) != 8 || (method >> 4) > 7 || (method << 8 | flags) % 31 != 0) {
+                throw InflateError("Zlib header is invalid");
+            }
+            if (flags & 0x20) {
+                throw InflateError("Zlib streams with a preset dictionary are not supported");
+            }
+        } else if (framing == Framing::Gzip) {
+            if (in.Read(8) != 0x1F || in.Read(8) != 0x8B || in.Read(8) != 8) {
+                throw InflateError("Gzip header is invalid");
+            }
+            uint32_t flags = in.Read(8);
+            in.Read(16);
+            in.Read(16);
+            in.Read(16);
+            if (flags & 0x04) {
+                for (uint32_t extra = in.Read(16); extra > 0; extra--) {
+                    in.Read(8);
+                }
+            }
+            // File name, then comment, each zero-terminated
+            for (uint32_t flag : { 0x08u, 0x10u }) {
+                if (flags & flag) {
+                    while (in.Read(8) != 0) {
+                    }
+                }
+            }
+            if (flags & 0x02) {
+                in.Read(16);
+            }
+        }
+
+        size_t start = out.size();
+        detail::InflateBlocks(in, out, start, maxOutput);
+        in.AlignToByte();
+        if (framing == Framing::Zlib) {
+            uint32_t expected = detail::ReadBigEndian32(in);
+            if (expected != Adler32(1, out.data() + start, out.size() - start)) {
+                throw InflateError("Zlib stream fails its Adler-32 check");
+            }
+        } else if (framing == Framing::Gzip) {
+            uint32_t expected = detail::ReadLittleEndian32(in);
+            uint32_t size = detail::ReadLittleEndian32(in);
+            if (expected != Crc32(0, out.data() + start, out.size() - start) || size != static_cast<uint32_t>(out.size() - start)) {
+                throw InflateError("Gzip stream fails its CRC-32 check");
+            }
+        }
+    }
+  }
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  using Clock = std::chrono::steady_clock;
+
+  struct OperationCancelled : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  struct ExecutorBusy : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  struct DuplicateRequest : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  namespace detail
+  {
+    struct CancellationState
+    {
+        std::atomic<bool> cancelled{ false };
+        Clock::time_point deadline = Clock::time_point::max();
+    };
+  }
+
+  // Cheap to copy, checked between units of work. A default token is never cancelled.
+  class CancellationToken
+  {
+  public:
+      CancellationToken() = default;
+      explicit CancellationToken(std::shared_ptr<detail::CancellationState> state) noexcept : m_state(std::move(state)) {}
+
+      bool IsCancelled() const noexcept {
+          return m_state && (m_state->cancelled.load(std::memory_order_relaxed) || IsExpired());
+      }
+
+      bool IsExpired() const noexcept {
+          return m_state && Clock::now() >= m_state->deadline;
+      }
+
+      void ThrowIfCancelled() const {
+          if (IsExpired()) {
+              throw OperationCancelled("Read timed out");
+          }
+          if (IsCancelled()) {
+              throw OperationCancelled("Read cancelled");
+          }
+      }
+
+  private:
+      std::shared_ptr<detail::CancellationState> m_state;
+  };
+
+  class CancellationSource
+  {
+  public:
+      explicit CancellationSource(Clock::duration timeout = Clock::duration::max())
+          : m_state(std::make_shared<detail::CancellationState>()) {
+          if (timeout != Clock::duration::max()) {
+              m_state->deadline = Clock::now() + timeout;
+          }
+      }
+
+      CancellationToken Token() const noexcept {
+          return CancellationToken(m_state);
+      }
+
+      void Cancel() noexcept {
+          m_state->cancelled.store(true, std::memory_order_relaxed);
+      }
+
+  private:
+      std::shared_ptr<detail::CancellationState> m_state;
+  };
+
+  // Maps JS request ids to their cancellation sources
+  class CancellationRegistry
+  {
+  public:
+      // Throws DuplicateRequest while the id is still registered: replacing the source would let
+      // the first request's Release drop the second one's, and Cancel could only reach one of them
+      CancellationToken Register(std::string const& requestId, Clock::duration timeout) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto [it, inserted] = m_sources.try_emplace(requestId, timeout);
+          if (!inserted) {
+              throw DuplicateRequest("Request already in progress: " + requestId);
+          }
+          return it->second.Token();
+      }
+
+      // Returns false when the request is unknown or already finished
+      bool Cancel(std::string const& requestId) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto it = m_sources.find(requestId);
+          if (it == m_sources.end()) {
+              return false;
+          }
+          it->second.Cancel();
+          return true;
+      }
+
+      void Release(std::string const& requestId) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_sources.erase(requestId);
+      }
+
+  private:
+      std::mutex m_mutex;
+      std::unordered_map<std::string, CancellationSource> m_sources;
+  };
+
+  // Fixed pool of worker threads with a bounded queue. Coroutines hop onto it with
+  // `co_await executor.Schedule(token)`; work that would overflow the queue is refused
+  // instead of piling up.
+  class IoExecutor
+  {
+  public:
+      IoExecutor(size_t workerCount, size_t maxPending) : m_maxPending(maxPending) {
+          m_workers.reserve(workerCount);
+          for (size_t i = 0; i < workerCount; i++) {
+              m_workers.emplace_back([this]() { Run(); });
+          }
+      }
+
+      ~IoExecutor() {
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              m_stopping = true;
+          }
+          m_condition.notify_all();
+          for (auto& worker : m_workers) {
+              worker.join();
+          }
+      }
+
+      IoExecutor(IoExecutor const&) = delete;
+      IoExecutor& operator=(IoExecutor const&) = delete;
+
+      bool TryPost(std::function<void()> job) {
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              if (m_stopping || m_queue.size() >= m_maxPending) {
+                  return false;
+              }
+              m_queue.push_back(std::move(job));
+          }
+          m_condition.notify_one();
+          return true;
+      }
+
+      // Always queues the job. Reserved for continuations of work that was already admitted
+      // through TryPost, which must not be dropped when the queue is full.
+      void Post(std::function<void()> job) {
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              m_queue.push_back(std::move(job));
+          }
+          m_condition.notify_one();
+      }
+
+      size_t PendingCount() {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_queue.size();
+      }
+
+      size_t WorkerCount() const noexcept {
+          return m_workers.size();
+      }
+
+      struct ScheduleAwaiter
+      {
+          IoExecutor& executor;
+          CancellationToken token;
+          bool rejected = false;
+
+          bool await_ready() const noexcept {
+              return false;
+          }
+
+          bool await_suspend(std::coroutine_handle<> handle) {
+              if (executor.TryPost([handle]() { handle.resume(); })) {
+                  // The coroutine may already be running on a worker, leave the frame alone
+                  return true;
+              }
+              // Resume inline so await_resume can report the rejection
+              rejected = true;
+              return false;
+          }
+
+          void await_resume() const {
+              if (rejected) {
+                  throw ExecutorBusy("Too many file reads in progress");
+              }
+              token.ThrowIfCancelled();
+          }
+      };
+
+      // Resumes the awaiting coroutine on a worker, then throws if the token was cancelled meanwhile
+      ScheduleAwaiter Schedule(CancellationToken token = {}) noexcept {
+          return ScheduleAwaiter{ *this, std::move(token) };
+      }
+
+  private:
+      void Run() {
+          for (;;) {
+              std::function<void()> job;
+              {
+                  std::unique_lock<std::mutex> lock(m_mutex);
+                  m_condition.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+                  if (m_queue.empty()) {
+                      return;
+                  }
+                  job = std::move(m_queue.front());
+                  m_queue.pop_front();
+              }
+              job();
+          }
+      }
+
+      const size_t m_maxPending;
+      std::mutex m_mutex;
+      std::condition_variable m_condition;
+      std::deque<std::function<void()>> m_queue;
+      bool m_stopping = false;
+      std::vector<std::thread> m_workers;
+  };
+}
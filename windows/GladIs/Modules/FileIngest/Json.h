@@ -0,0 +1,343 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace FileIngest
+{
+  struct JsonError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  namespace detail
+  {
+    inline void AppendUtf8(std::string& out, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            out.push_back(static_cast<char>(codePoint));
+        } else if (codePoint < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else if (codePoint < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+  }
+
+  // Single-pass reader of one JSON document (RFC 8259) that reports what it finds to a handler
+  // instead of building a tree, so the caller builds the tree it needs, e.g. a JSValue, without
+  // an intermediate copy. The handler provides:
+  //
+  //   void Null(); void Bool(bool); void Int(int64_t); void Double(double);
+  //   void String(std::string&&); void Key(std::string&&);
+  //   void StartObject(); void EndObject(); void StartArray(); void EndArray();
+  //
+  // Numbers without a fraction or exponent that fit an int64_t arrive through Int, the others
+  // through Double. Nesting deeper than maxDepth is refused rather than recursed into.
+  template <typename Handler>
+  class JsonReader
+  {
+  public:
+      static constexpr size_t kDefaultMaxDepth = 256;
+
+      JsonReader(std::string_view text, Handler& handler, size_t maxDepth = kDefaultMaxDepth) noexcept
+          : m_text(text), m_handler(handler), m_maxDepth(maxDepth) {}
+
+      void Parse() {
+          SkipSpace();
+          ParseValue(0);
+          SkipSpace();
+          if (m_position != m_text.size()) {
+              Fail("Unexpected data after the JSON value");
+          }
+      }
+
+  private:
+      [[noreturn]] void Fail(const char* what) const {
+          throw JsonError(std::string(what) + " at offset " + std::to_string(m_position));
+      }
+
+      void SkipSpace() noexcept {
+          while (m_position < m_text.size()) {
+              char c = m_text[m_position];
+              if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+                  return;
+              }
+              m_position++;
+          }
+      }
+
+      char Peek() const {
+          if (m_position == m_text.size()) {
+              Fail("Unexpected end of JSON");
+          }
+          return m_text[m_position];
+      }
+
+      void Expect(std::string_view literal) {
+          if (m_text.compare(m_position, literal.size(), literal) != 0) {
+              Fail("Invalid JSON literal");
+          }
+          m_position += literal.size();
+      }
+
+      void ParseValue(size_t depth) {
+          switch (Peek()) {
+          case '{':
+              ParseObject(depth + 1);
+              break;
+          case '[':
+              ParseArray(depth + 1);
+              break;
+          case '"':
+              m_handler.String(ParseString());
+              break;
+          case 't':
+              Expect("true");
+              m_handler.Bool(true);
+              break;
+          case 'f':
+              Expect("false");
+              m_handler.Bool(false);
+              break;
+          case 'n':
+              Expect("null");
+              m_handler.Null();
+              break;
+          default:
+              ParseNumber();
+              break;
+          }
+      }
+
+      void ParseObject(size_t depth) {
+          if (depth > m_maxDepth) {
+              Fail("JSON nested too deeply");
+          }
+          m_position++;
+          m_handler.StartObject();
+          SkipSpace();
+          if (Peek() == '}') {
+              m_position++;
+              m_handler.EndObject();
+              return;
+          }
+          for (;;) {
+              if (Peek() != '"') {
+                  Fail("Expected a key");
+              }
+              m_handler.Key(ParseString());
+              SkipSpace();
+              if (Peek() != ':') {
+                  Fail("Expected ':'");
+              }
+              m_position++;
+              SkipSpace();
+              ParseValue(depth);
+              SkipSpace();
+              char next = Peek();
+              m_position++;
+              if (next == '}') {
+                  m_handler.EndObject();
+                  return;
+              }
+              if (next != ',') {
+                  Fail("Expected ',' or '}'");
+              }
+              SkipSpace();
+          }
+      }
+
+      void ParseArray(size_t depth) {
+          if (depth > m_maxDepth) {
+              Fail("JSON nested too deeply");
+          }
+          m_position++;
+          m_handler.StartArray();
+          SkipSpace();
+          if (Peek() == ']') {
+              m_position++;
+              m_handler.EndArray();
+              return;
+          }
+          for (;;) {
+              ParseValue(depth);
+              SkipSpace();
+              char next = Peek();
+              m_position++;
+              if (next == ']') {
+                  m_handler.EndArray();
+                  return;
+              }
+              if (next != ',') {
+                  Fail("Expected ',' or ']'");
+              }
+              SkipSpace();
+          }
+      }
+
+      uint32_t ParseHex4() {
+          if (m_text.size() - m_position < 4) {
+              Fail("Truncated \\u escape");
+          }
+          uint32_t value = 0;
+          for (int i = 0; i < 4; i++) {
+              char c = m_text[m_position++];
+              value <<= 4;
+              if (c >= '0' && c <= '9') {
+                  value |= static_cast<uint32_t>(c - '0');
+              } else if (c >= 'a' && c <= 'f') {
+                  value |= static_cast<uint32_t>(c - 'a' + 10);
+              } else if (c >= 'A' && c <= 'F') {
+                  value |= static_cast<uint32_t>(c - 'A' + 10);
+              } else {
+                  Fail("Invalid \\u escape");
+              }
+          }
+          return value;
+      }
+
+      // Copies runs without escapes in one go; escapes are decoded to UTF-8 with surrogate pairs
+      // joined. A lone surrogate, which UTF-8 cannot carry, becomes U+FFFD.
+      std::string ParseString() {
+          m_position++;
+          std::string out;
+          for (;;) {
+              size_t start = m_position;
+              while (m_position < m_text.size()) {
+                  unsigned char c = static_cast<unsigned char>(m_text[m_position]);
+                  if (c == '"' || c == '\\' || c < 0x20) {
+                      break;
+                  }
+                  m_position++;
+              }
+              out.append(m_text.data() + start, m_position - start);
+              char c = Peek();
+              m_position++;
+              if (c == '"') {
+                  return out;
+              }
+              if (c != '\\') {
+                  Fail("Control character in string");
+              }
+              char escape = Peek();
+              m_position++;
+              switch (escape) {
+              case '"': out.push_back('"'); break;
+              case '\\': out.push_back('\\'); break;
+              case '/': out.push_back('/'); break;
+              case 'b': out.push_back('\b'); break;
+              case 'f': out.push_back('\f'); break;
+              case 'n': out.push_back('\n'); break;
+              case 'r': out.push_back('\r'); break;
+              case 't': out.push_back('\t'); break;
+              case 'u': {
+                  uint32_t codePoint = ParseHex4();
+                  if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                      if (m_text.compare(m_position, 2, "\\u") == 0) {
+                          size_t mark = m_position;
+                          m_position += 2;
+                          uint32_t low = ParseHex4();
+                          if (low >= 0xDC00 && low < 0xE000) {
+                              codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                          } else {
+                              m_position = mark;
+                              codePoint = 0xFFFD;
+                          }
+                      } else {
+                          codePoint = 0xFFFD;
+                      }
+                  } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                      codePoint = 0xFFFD;
+                  }
+                  detail::AppendUtf8(out, codePoint);
+                  break;
+              }
+              default:
+                  Fail("Invalid escape");
+              }
+          }
+      }
+
+      void ParseNumber() {
+          size_t start = m_position;
+          bool integral = true;
+          if (m_position < m_text.size() && m_text[m_position] == '-') {
+              m_position++;
+          }
+          size_t digits = m_position;
+          while (m_position < m_text.size() && m_text[m_position] >= '0' && m_text[m_position] <= '9') {
+              m_position++;
+          }
+          if (m_position == digits || (m_text[digits] == '0' && m_position - digits > 1)) {
+              m_position = start;
+              Fail("Invalid number");
+          }
+          if (m_position < m_text.size() && m_text[m_position] == '.') {
+              integral = false;
+              size_t fraction = ++m_position;
+              while (m_position < m_text.size() && m_text[m_position] >= '0' && m_text[m_position] <= '9') {
+                  m_position++;
+              }
+              if (m_position == fraction) {
+                  Fail("Invalid number");
+              }
+          }
+          if (m_position < m_text.size() && (m_text[m_position] == 'e' || m_text[m_position] == 'E')) {
+              integral = false;
+              m_position++;
+              if (m_position < m_text.size() && (m_text[m_position] == '+' || m_text[m_position] == '-')) {
+                  m_position++;
+              }
+              size_t exponent = m_position;
+              while (m_position < m_text.size() && m_text[m_position] >= '0' && m_text[m_position] <= '9') {
+                  m_position++;
+              }
+              if (m_position == exponent) {
+                  Fail("Invalid number");
+              }
+          }
+          const char* first = m_text.data() + start;
+          const char* last = m_text.data() + m_position;
+          if (integral) {
+              int64_t value;
+              auto [end, error] = std::from_chars(first, last, value);
+              if (error == std::errc() && end == last) {
+                  m_handler.Int(value);
+                  return;
+              }
+          }
+          double value;
+          auto [end, error] = std::from_chars(first, last, value);
+          if (error == std::errc::result_out_of_range) {
+              // strtod rounds to an infinity or to zero, as JSON.parse does
+              value = std::strtod(std::string(first, last).c_str(), nullptr);
+          } else if (error != std::errc() || end != last) {
+              Fail("Invalid number");
+          }
+          m_handler.Double(value);
+      }
+
+      std::string_view m_text;
+      Handler& m_handler;
+      const size_t m_maxDepth;
+      size_t m_position = 0;
+  };
+
+  template <typename Handler>
+  void ParseJson(std::string_view text, Handler& handler, size_t maxDepth = JsonReader<Handler>::kDefaultMaxDepth) {
+      JsonReader<Handler>(text, handler, maxDepth).Parse();
+  }
+}
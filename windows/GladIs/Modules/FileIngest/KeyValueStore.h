@@ -0,0 +1,855 @@
+#pragma once
+
+#include "Crc32.h"
+#include "LogFile.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  struct KeyValueError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  namespace detail
+  {
+    struct LogHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t logId;
+        uint8_t reserved[16];
+    };
+
+    // Followed by the key and the value. The CRC covers everything after itself.
+    struct LogRecordHeader
+    {
+        uint32_t crc;
+        uint32_t keyLength;
+        uint32_t valueLength;
+        uint32_t type;
+        // Milliseconds since the Unix epoch, 0 for no expiry
+        uint64_t expiresAt;
+    };
+
+    struct KeyIndexHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+        uint64_t count;
+        uint64_t tombstones;
+        uint64_t logId;
+        // Log length the table matches exactly, 0 while it is being changed
+        uint64_t cleanLength;
+        uint64_t liveBytes;
+        uint64_t clock;
+    };
+
+    struct KeyIndexSlot
+    {
+        uint64_t keyHash;
+        uint64_t offset;
+        uint64_t expiresAt;
+        uint64_t lastAccess;
+        uint32_t recordLength;
+        uint32_t keyLength;
+        uint32_t state;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(LogHeader) == 32);
+    static_assert(sizeof(LogRecordHeader) == 24);
+    static_assert(sizeof(KeyIndexHeader) == 64);
+    static_assert(sizeof(KeyIndexSlot) == 48);
+
+    // FNV-1a with a final avalanche, so keys that differ only at the end spread over the table
+    inline uint64_t HashKey(std::string_view key) noexcept {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (char c : key) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+  }
+
+  // Open-addressing table of key hash -> log record in a memory-mapped file, the same layout
+  // as ContentIndex. Keys themselves stay in the log; callers confirm a hash match by reading
+  // the record. The table is only trusted after a clean close: while it is being changed its
+  // header says so on disk, and KeyValueStore rebuilds it from the log after a crash.
+  class KeyIndex
+  {
+  public:
+      using Slot = detail::KeyIndexSlot;
+
+      KeyIndex() = default;
+
+      explicit KeyIndex(std::filesystem::path path) : m_path(std::move(path)) {
+          m_file = MappedFile(m_path, MappedFile::Mode::ReadWrite, FileSizeFor(kMinCapacity));
+          if (!IsValid()) {
+              m_file.Close();
+              std::filesystem::remove(m_path);
+              Create(m_path, kMinCapacity, 0);
+              m_file = MappedFile(m_path, MappedFile::Mode::ReadWrite);
+          }
+      }
+
+      uint64_t LogId() const noexcept {
+          return Header().logId;
+      }
+
+      uint64_t CleanLength() const noexcept {
+          return Header().cleanLength;
+      }
+
+      size_t Count() const noexcept {
+          return static_cast<size_t>(Header().count);
+      }
+
+      uint64_t Capacity() const noexcept {
+          return Header().capacity;
+      }
+
+      uint64_t LiveBytes() const noexcept {
+          return Header().liveBytes;
+      }
+
+      // Empties the table for a new log
+      void Reset(uint64_t logId) {
+          m_file.Close();
+          std::filesystem::remove(m_path);
+          Create(m_path, kMinCapacity, logId);
+          m_file = MappedFile(m_path, MappedFile::Mode::ReadWrite);
+      }
+
+      // Records on disk that the table is about to diverge from the log, before any slot changes
+      void MarkDirty() {
+          if (Header().cleanLength != 0) {
+              Header().cleanLength = 0;
+              m_file.Flush();
+          }
+      }
+
+      // Writes every slot out, then the header saying they match `logLength` bytes of log
+      void MarkClean(uint64_t logLength) {
+          m_file.Flush();
+          Header().cleanLength = logLength;
+          m_file.Flush();
+      }
+
+      // Recency stamp for LRU eviction; readers call it concurrently
+      uint64_t Tick() noexcept {
+          return std::atomic_ref<uint64_t>(Header().clock).fetch_add(1, std::memory_order_relaxed) + 1;
+      }
+
+      // First occupied slot with `keyHash` for which `matches(slot)` holds
+      template <typename Matches>
+      Slot* Find(uint64_t keyHash, Matches&& matches) {
+          Slot* slots = Slots();
+          uint64_t mask = Header().capacity - 1;
+          for (uint64_t i = keyHash & mask;; i = (i + 1) & mask) {
+              if (slots[i].state == kEmpty) {
+                  return nullptr;
+              }
+              if (slots[i].state == kOccupied && slots[i].keyHash == keyHash && matches(slots[i])) {
+                  return &slots[i];
+              }
+          }
+      }
+
+      // Adds a slot for a key known not to be present; `slot.keyHash` places it
+      void Insert(Slot const& slot) {
+          detail::KeyIndexHeader& header = Header();
+          if ((header.count + header.tombstones + 1) * 10 > header.capacity * 7) {
+              Rehash(std::max(header.capacity, RoundCapacity((header.count + 1) * 2)));
+          }
+          if (Place(Slots(), Header().capacity, slot, true)) {
+              Header().tombstones--;
+          }
+          Header().count++;
+          Header().liveBytes += slot.recordLength;
+      }
+
+      // Points an existing slot at a newer record of the same key
+      void Replace(Slot& existing, Slot const& slot) noexcept {
+          Header().liveBytes += slot.recordLength;
+          Header().liveBytes -= existing.recordLength;
+          existing = slot;
+          existing.state = kOccupied;
+      }
+
+      void Erase(Slot& slot) noexcept {
+          slot.state = kTombstone;
+          Header().count--;
+          Header().tombstones++;
+          Header().liveBytes -= slot.recordLength;
+      }
+
+      template <typename Visit>
+      void ForEach(Visit&& visit) {
+          Slot* slots = Slots();
+          for (uint64_t i = 0; i < Header().capacity; i++) {
+              if (slots[i].state == kOccupied) {
+                  visit(slots[i]);
+              }
+          }
+      }
+
+      // Writes `slots` as a new table for `logId` at `path`, clean up to `logLength`
+      static void Write(std::filesystem::path const& path, uint64_t logId, std::vector<Slot> const& slots, uint64_t clock, uint64_t logLength) {
+          uint64_t capacity = RoundCapacity(slots.size() * 2);
+          Create(path, capacity, logId);
+          MappedFile file(path, MappedFile::Mode::ReadWrite);
+          auto* header = reinterpret_cast<detail::KeyIndexHeader*>(file.Data());
+          auto* table = reinterpret_cast<Slot*>(file.Data() + sizeof(detail::KeyIndexHeader));
+          for (Slot const& slot : slots) {
+              Place(table, capacity, slot, false);
+              header->liveBytes += slot.recordLength;
+          }
+          header->count = slots.size();
+          header->clock = clock;
+          file.Flush();
+          header->cleanLength = logLength;
+          file.Flush();
+      }
+
+      void Close() noexcept {
+          m_file.Close();
+      }
+
+  private:
+      static constexpr uint32_t kMagic = 0x5849564B; // "KVIX"
+      static constexpr uint32_t kVersion = 1;
+      static constexpr uint64_t kMinCapacity = 64;
+      static constexpr uint32_t kEmpty = 0;
+      static constexpr uint32_t kOccupied = 1;
+      static constexpr uint32_t kTombstone = 2;
+
+      static constexpr uint64_t FileSizeFor(uint64_t capacity) noexcept {
+          return sizeof(detail::KeyIndexHeader) + capacity * sizeof(Slot);
+      }
+
+      static uint64_t RoundCapacity(uint64_t capacity) noexcept {
+          uint64_t rounded = kMinCapacity;
+          while (rounded < capacity) {
+              rounded *= 2;
+          }
+          return rounded;
+      }
+
+      // Returns whether the slot taken was a tombstone
+      static bool Place(Slot* slots, uint64_t capacity, Slot const& slot, bool reuseTombstones) noexcept {
+          uint64_t mask = capacity - 1;
+          for (uint64_t i = slot.keyHash & mask;; i = (i + 1) & mask) {
+              if (slots[i].state == kEmpty || (reuseTombstones && slots[i].state == kTombstone)) {
+                  bool tombstone = slots[i].state == kTombstone;
+                  slots[i] = slot;
+                  slots[i].state = kOccupied;
+                  return tombstone;
+              }
+          }
+      }
+
+      static void Create(std::filesystem::path const& path, uint64_t capacity, uint64_t logId) {
+          MappedFile file(path, MappedFile::Mode::ReadWrite, FileSizeFor(capacity));
+          auto* header = reinterpret_cast<detail::KeyIndexHeader*>(file.Data());
+          std::memset(header, 0, sizeof(*header));
+          header->magic = kMagic;
+          header->version = kVersion;
+          header->capacity = capacity;
+          header->logId = logId;
+          file.Flush();
+      }
+
+      bool IsValid() const noexcept {
+          const detail::KeyIndexHeader& header = Header();
+          return header.magic == kMagic
+              && header.version == kVersion
+              && header.capacity >= kMinCapacity
+              && (header.capacity & (header.capacity - 1)) == 0
+              && m_file.Size() == FileSizeFor(header.capacity);
+      }
+
+      detail::KeyIndexHeader& Header() noexcept {
+          return *reinterpret_cast<detail::KeyIndexHeader*>(m_file.Data());
+      }
+
+      const detail::KeyIndexHeader& Header() const noexcept {
+          return *reinterpret_cast<const detail::KeyIndexHeader*>(m_file.Data());
+      }
+
+      Slot* Slots() noexcept {
+          return reinterpret_cast<Slot*>(m_file.Data() + sizeof(detail::KeyIndexHeader));
+      }
+
+      // Rebuilds the table into a new file and swaps it in with a rename, dropping tombstones.
+      // The table is dirty at this point, so a crash mid-way only means a rebuild from the log.
+      void Rehash(uint64_t capacity) {
+          std::vector<Slot> live;
+          live.reserve(Count());
+          ForEach([&](Slot const& slot) { live.push_back(slot); });
+          std::filesystem::path temporary = m_path;
+          temporary += ".rehash";
+          std::filesystem::remove(temporary);
+          Create(temporary, capacity, LogId());
+          {
+              MappedFile next(temporary, MappedFile::Mode::ReadWrite);
+              auto* header = reinterpret_cast<detail::KeyIndexHeader*>(next.Data());
+              auto* table = reinterpret_cast<Slot*>(next.Data() + sizeof(detail::KeyIndexHeader));
+              for (Slot const& slot : live) {
+                  Place(table, capacity, slot, false);
+              }
+              header->count = Header().count;
+              header->liveBytes = Header().liveBytes;
+              header->clock = Header().clock;
+              next.Flush();
+          }
+          m_file.Close();
+          std::filesystem::rename(temporary, m_path);
+          m_file = MappedFile(m_path, MappedFile::Mode::ReadWrite);
+      }
+
+      std::filesystem::path m_path;
+      MappedFile m_file;
+  };
+
+  enum class Durability
+  {
+      // Each commit is written to the OS before the writers return; it survives the app being
+      // killed, not a power cut
+      Buffered,
+      // Each commit is also synced to disk, once for every writer that joined it
+      Synced,
+  };
+
+  struct KeyValueOptions
+  {
+      // Live record bytes above which least recently used entries are evicted, down to 90%
+      uint64_t maxLiveBytes = 64ull * 1024 * 1024;
+      // The log is compacted once dead records outweigh live ones and it is at least this big
+      uint64_t minCompactionBytes = 4ull * 1024 * 1024;
+      Durability durability = Durability::Buffered;
+  };
+
+  struct KeyValueStats
+  {
+      uint64_t count = 0;
+      uint64_t liveBytes = 0;
+      uint64_t logBytes = 0;
+      uint64_t gets = 0;
+      uint64_t hits = 0;
+      uint64_t expired = 0;
+      uint64_t puts = 0;
+      uint64_t removes = 0;
+      uint64_t evictions = 0;
+      // Writes of the log, each carrying every record queued while the previous one ran
+      uint64_t commits = 0;
+      uint64_t committedRecords = 0;
+      uint64_t compactions = 0;
+      // Records replayed into a fresh index at open, and bytes of torn records dropped
+      uint64_t recoveredRecords = 0;
+      uint64_t truncatedBytes = 0;
+  };
+
+  // One entry of a batched write; an empty `value` with `remove` set deletes the key
+  struct KeyValueWrite
+  {
+      std::string_view key;
+      std::span<const uint8_t> value;
+      // Milliseconds until the entry expires, 0 for never
+      uint64_t ttlMillis = 0;
+      bool remove = false;
+  };
+
+  // Log-structured key-value store: <root>/cache.log holds every write as a checksummed record
+  // and <root>/cache.idx maps each live key to its latest record. Writers queue their records
+  // and one of them appends everything queued in a single write, so concurrent writers share
+  // the cost of a commit. Readers run in parallel with each other and with the next append.
+  // Expired and evicted records stay in the log until compaction copies the live ones to a new
+  // log. After a crash the index is rebuilt from the log, dropping a torn last record.
+  class KeyValueStore
+  {
+  public:
+      static constexpr size_t kMaxKeyLength = 64 * 1024;
+
+      KeyValueStore(std::filesystem::path root, KeyValueOptions options = {}) : m_root(std::move(root)), m_options(options) {
+          std::filesystem::create_directories(m_root);
+          std::error_code ignored;
+          std::filesystem::remove(LogPath().concat(".compact"), ignored);
+          std::filesystem::remove(IndexPath().concat(".compact"), ignored);
+          m_log = LogFile(LogPath());
+          m_index = KeyIndex(IndexPath());
+          Open();
+      }
+
+      // Leaves the index clean so the next open skips the rebuild
+      ~KeyValueStore() {
+          try {
+              Flush();
+          } catch (...) {
+          }
+      }
+
+      KeyValueStore(KeyValueStore const&) = delete;
+      KeyValueStore& operator=(KeyValueStore const&) = delete;
+
+      // Copies the value of a live, unexpired key into `value`
+      bool Get(std::string_view key, std::vector<uint8_t>& value) {
+          uint64_t keyHash = detail::HashKey(key);
+          uint64_t now = NowMillis();
+          m_gets.fetch_add(1, std::memory_order_relaxed);
+          std::shared_lock<std::shared_mutex> lock(m_indexMutex);
+          std::vector<uint8_t> record;
+          KeyIndex::Slot* slot = m_index.Find(keyHash, [&](KeyIndex::Slot const& candidate) {
+              if (candidate.keyLength != key.size()) {
+                  return false;
+              }
+              record.resize(candidate.recordLength);
+              return m_log.ReadAt(candidate.offset, record.data(), record.size()) == record.size() && RecordKey(record) == key;
+          });
+          if (slot == nullptr) {
+              return false;
+          }
+          if (slot->expiresAt != 0 && slot->expiresAt <= now) {
+              m_expired.fetch_add(1, std::memory_order_relaxed);
+              return false;
+          }
+          if (!RecordIsIntact(record)) {
+              throw KeyValueError("Cache record is corrupted");
+          }
+          std::atomic_ref<uint64_t>(slot->lastAccess).store(m_index.Tick(), std::memory_order_relaxed);
+          size_t valueOffset = sizeof(detail::LogRecordHeader) + key.size();
+          value.assign(record.begin() + static_cast<ptrdiff_t>(valueOffset), record.end());
+          m_hits.fetch_add(1, std::memory_order_relaxed);
+          return true;
+      }
+
+      void Put(std::string_view key, std::span<const uint8_t> value, uint64_t ttlMillis = 0) {
+          KeyValueWrite write{ key, value, ttlMillis, false };
+          Write(std::span<const KeyValueWrite>(&write, 1));
+      }
+
+      void Remove(std::string_view key) {
+          KeyValueWrite write{ key, {}, 0, true };
+          Write(std::span<const KeyValueWrite>(&write, 1));
+      }
+
+      // Applies the writes in order and returns once they are committed. A crash keeps a prefix.
+      void Write(std::span<const KeyValueWrite> writes) {
+          uint64_t expiresBase = NowMillis();
+          std::unique_lock<std::mutex> lock(m_queueMutex);
+          ThrowIfFailedLocked();
+          for (KeyValueWrite const& write : writes) {
+              if (write.key.empty() || write.key.size() > kMaxKeyLength) {
+                  throw KeyValueError("Invalid cache key");
+              }
+              if (write.value.size() > m_options.maxLiveBytes / 2) {
+                  throw KeyValueError("Value is too large for the cache");
+              }
+          }
+          for (KeyValueWrite const& write : writes) {
+              AppendRecord(m_queued, write, write.ttlMillis == 0 ? 0 : expiresBase + write.ttlMillis);
+          }
+          uint64_t ticket = ++m_enqueued;
+          while (m_committed < ticket) {
+              if (m_committing) {
+                  m_queueChanged.wait(lock);
+                  continue;
+              }
+              m_committing = true;
+              CommitQueuedLocked(lock);
+              m_committing = false;
+              m_queueChanged.notify_all();
+          }
+          ThrowIfFailedLocked();
+      }
+
+      // Drops every entry and starts a new log
+      void Clear() {
+          std::lock_guard<std::mutex> commit(m_commitMutex);
+          std::unique_lock<std::shared_mutex> lock(m_indexMutex);
+          StartNewLogLocked();
+          std::lock_guard<std::mutex> queue(m_queueMutex);
+          m_failure = nullptr;
+      }
+
+      // Copies the live records to a new log now, whatever the dead to live ratio
+      void Compact() {
+          std::lock_guard<std::mutex> commit(m_commitMutex);
+          CompactLocked();
+      }
+
+      // Syncs the log and leaves the index clean, e.g. before the app is suspended
+      void Flush() {
+          std::lock_guard<std::mutex> commit(m_commitMutex);
+          std::unique_lock<std::shared_mutex> lock(m_indexMutex);
+          m_log.Sync();
+          m_index.MarkClean(m_log.Size());
+      }
+
+      KeyValueStats Stats() {
+          std::lock_guard<std::mutex> commit(m_commitMutex);
+          std::shared_lock<std::shared_mutex> lock(m_indexMutex);
+          KeyValueStats stats = m_stats;
+          stats.count = m_index.Count();
+          stats.liveBytes = m_index.LiveBytes();
+          stats.logBytes = m_log.Size();
+          stats.gets = m_gets.load(std::memory_order_relaxed);
+          stats.hits = m_hits.load(std::memory_order_relaxed);
+          stats.expired = m_expired.load(std::memory_order_relaxed);
+          return stats;
+      }
+
+  private:
+      static constexpr uint32_t kLogMagic = 0x474C564B; // "KVLG"
+      static constexpr uint32_t kLogVersion = 1;
+      static constexpr uint32_t kPut = 1;
+      static constexpr uint32_t kRemove = 2;
+      // Records are read back in chunks of this size when the index is rebuilt or compacted
+      static constexpr size_t kScanChunkSize = 1024 * 1024;
+
+      std::filesystem::path LogPath() const {
+          return m_root / "cache.log";
+      }
+
+      std::filesystem::path IndexPath() const {
+          return m_root / "cache.idx";
+      }
+
+      static uint64_t NowMillis() noexcept {
+          return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+      }
+
+      static uint64_t NewLogId() {
+          std::random_device device;
+          uint64_t id = (uint64_t(device()) << 32) | device();
+          return id == 0 ? 1 : id;
+      }
+
+      static std::string_view RecordKey(std::vector<uint8_t> const& record) noexcept {
+          detail::LogRecordHeader header;
+          std::memcpy(&header, record.data(), sizeof(header));
+          return std::string_view(reinterpret_cast<const char*>(record.data() + sizeof(header)), header.keyLength);
+      }
+
+      static bool RecordIsIntact(std::vector<uint8_t> const& record) noexcept {
+          detail::LogRecordHeader header;
+          std::memcpy(&header, record.data(), sizeof(header));
+          return header.crc == Crc32(0, record.data() + sizeof(header.crc), record.size() - sizeof(header.crc));
+      }
+
+      static void AppendRecord(std::vector<uint8_t>& out, KeyValueWrite const& write, uint64_t expiresAt) {
+          detail::LogRecordHeader header{ 0, static_cast<uint32_t>(write.key.size()), static_cast<uint32_t>(write.remove ? 0 : write.value.size()), write.remove ? kRemove : kPut, expiresAt };
+          size_t start = out.size();
+          out.resize(start + sizeof(header) + header.keyLength + header.valueLength);
+          uint8_t* record = out.data() + start;
+          std::memcpy(record + sizeof(header), write.key.data(), header.keyLength);
+          if (header.valueLength != 0) {
+              std::memcpy(record + sizeof(header) + header.keyLength, write.value.data(), header.valueLength);
+          }
+          std::memcpy(record, &header, sizeof(header));
+          header.crc = Crc32(0, record + sizeof(header.crc), out.size() - start - sizeof(header.crc));
+          std::memcpy(record, &header.crc, sizeof(header.crc));
+      }
+
+      void ThrowIfFailedLocked() const {
+          if (m_failure) {
+              std::rethrow_exception(m_failure);
+          }
+      }
+
+      // Uses the index when it was left clean for this exact log, otherwise rebuilds it
+      void Open() {
+          detail::LogHeader header{};
+          if (m_log.Size() < sizeof(header) || m_log.ReadAt(0, reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header) || header.magic != kLogMagic || header.version != kLogVersion) {
+              StartNewLogLocked();
+              return;
+          }
+          if (m_index.LogId() == header.logId && m_index.CleanLength() == m_log.Size()) {
+              return;
+          }
+          m_index.Reset(header.logId);
+          m_index.MarkDirty();
+          uint64_t end = ScanLog([&](uint64_t offset, detail::LogRecordHeader const& record, std::string_view key) {
+              ApplyRecord(offset, record, key);
+              m_stats.recoveredRecords++;
+          });
+          if (end < m_log.Size()) {
+              m_stats.truncatedBytes = m_log.Size() - end;
+              m_log.Truncate(end);
+          }
+          m_log.Sync();
+          m_index.MarkClean(m_log.Size());
+      }
+
+      void StartNewLogLocked() {
+          detail::LogHeader header{};
+          header.magic = kLogMagic;
+          header.version = kLogVersion;
+          header.logId = NewLogId();
+          m_log.Truncate(0);
+          m_log.Append(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+          m_log.Sync();
+          m_index.Reset(header.logId);
+          m_index.MarkClean(m_log.Size());
+      }
+
+      // Calls `visit(offset, header, key)` for each intact record in order and returns the
+      // offset after the last one; anything past it is a torn or corrupted tail
+      template <typename Visit>
+      uint64_t ScanLog(Visit&& visit) {
+          std::vector<uint8_t> chunk;
+          uint64_t chunkStart = 0;
+          uint64_t offset = sizeof(detail::LogHeader);
+          uint64_t size = m_log.Size();
+          while (offset + sizeof(detail::LogRecordHeader) <= size) {
+              auto load = [&](uint64_t length) {
+                  if (offset < chunkStart || offset + length > chunkStart + chunk.size()) {
+                      chunkStart = offset;
+                      chunk.resize(static_cast<size_t>(std::min<uint64_t>(std::max<uint64_t>(length, kScanChunkSize), size - offset)));
+                      chunk.resize(m_log.ReadAt(offset, chunk.data(), chunk.size()));
+                  }
+                  return offset + length <= chunkStart + chunk.size() ? chunk.data() + (offset - chunkStart) : nullptr;
+              };
+              const uint8_t* bytes = load(sizeof(detail::LogRecordHeader));
+              if (bytes == nullptr) {
+                  break;
+              }
+              detail::LogRecordHeader header;
+              std::memcpy(&header, bytes, sizeof(header));
+              uint64_t length = sizeof(header) + uint64_t(header.keyLength) + header.valueLength;
+              if ((header.type != kPut && header.type != kRemove) || header.keyLength == 0 || header.keyLength > kMaxKeyLength || offset + length > size) {
+                  break;
+              }
+              bytes = load(length);
+              if (bytes == nullptr || header.crc != Crc32(0, bytes + sizeof(header.crc), static_cast<size_t>(length) - sizeof(header.crc))) {
+                  break;
+              }
+              visit(offset, header, std::string_view(reinterpret_cast<const char*>(bytes + sizeof(header)), header.keyLength));
+              offset += length;
+          }
+          return offset;
+      }
+
+      bool SlotHasKey(KeyIndex::Slot const& slot, std::string_view key) const {
+          if (slot.keyLength != key.size()) {
+              return false;
+          }
+          std::string stored(key.size(), '\0');
+          return m_log.ReadAt(slot.offset + sizeof(detail::LogRecordHeader), reinterpret_cast<uint8_t*>(stored.data()), stored.size()) == stored.size() && stored == key;
+      }
+
+      // Points the key at the record at `offset`, or forgets it for a removal. Index lock held.
+      void ApplyRecord(uint64_t offset, detail::LogRecordHeader const& record, std::string_view key) {
+          uint64_t keyHash = detail::HashKey(key);
+          KeyIndex::Slot* existing = m_index.Find(keyHash, [&](KeyIndex::Slot const& slot) { return SlotHasKey(slot, key); });
+          if (record.type == kRemove) {
+              if (existing != nullptr) {
+                  m_index.Erase(*existing);
+              }
+              return;
+          }
+          KeyIndex::Slot slot{};
+          slot.keyHash = keyHash;
+          slot.offset = offset;
+          slot.expiresAt = record.expiresAt;
+          slot.lastAccess = m_index.Tick();
+          slot.recordLength = static_cast<uint32_t>(sizeof(record) + record.keyLength + record.valueLength);
+          slot.keyLength = record.keyLength;
+          if (existing != nullptr) {
+              m_index.Replace(*existing, slot);
+          } else {
+              m_index.Insert(slot);
+          }
+      }
+
+      // Runs with m_committing set: commits what is queued, round after round, until the queue
+      // is empty. Writers that queue meanwhile are picked up by the next round.
+      void CommitQueuedLocked(std::unique_lock<std::mutex>& lock) {
+          while (m_committed < m_enqueued && !m_failure) {
+              std::vector<uint8_t> batch;
+              batch.swap(m_queued);
+              uint64_t through = m_enqueued;
+              lock.unlock();
+              try {
+                  std::lock_guard<std::mutex> commit(m_commitMutex);
+                  Commit(batch);
+                  batch.clear();
+              } catch (...) {
+                  lock.lock();
+                  m_failure = std::current_exception();
+                  break;
+              }
+              lock.lock();
+              m_committed = through;
+              // Hand the buffer back so the next round reuses its capacity
+              if (m_queued.empty()) {
+                  m_queued.swap(batch);
+              }
+              m_queueChanged.notify_all();
+          }
+          // Everyone still waiting gets the failure
+          if (m_failure) {
+              m_queued.clear();
+              m_committed = m_enqueued;
+          }
+      }
+
+      // One append for the whole batch, then the index updates. Commit mutex held.
+      void Commit(std::vector<uint8_t> const& batch) {
+          uint64_t base = m_log.Size();
+          {
+              std::unique_lock<std::shared_mutex> lock(m_indexMutex);
+              m_index.MarkDirty();
+          }
+          m_log.Append(batch.data(), batch.size());
+          if (m_options.durability == Durability::Synced) {
+              m_log.Sync();
+          }
+          {
+              std::unique_lock<std::shared_mutex> lock(m_indexMutex);
+              for (size_t position = 0; position < batch.size();) {
+                  detail::LogRecordHeader header;
+                  std::memcpy(&header, batch.data() + position, sizeof(header));
+                  ApplyRecord(base + position, header, std::string_view(reinterpret_cast<const char*>(batch.data() + position + sizeof(header)), header.keyLength));
+                  (header.type == kPut ? m_stats.puts : m_stats.removes)++;
+                  m_stats.committedRecords++;
+                  position += sizeof(header) + header.keyLength + header.valueLength;
+              }
+              EvictLocked();
+          }
+          m_stats.commits++;
+          uint64_t live = m_index.LiveBytes();
+          uint64_t dead = m_log.Size() - sizeof(detail::LogHeader) - live;
+          if (m_log.Size() >= m_options.minCompactionBytes && dead > live) {
+              CompactLocked();
+          }
+      }
+
+      // Drops expired entries, then least recently used ones until 90% of the budget is left.
+      // Only the index forgets them; the log records become dead and go at the next compaction.
+      void EvictLocked() {
+          if (m_index.LiveBytes() <= m_options.maxLiveBytes) {
+              return;
+          }
+          uint64_t now = NowMillis();
+          std::vector<KeyIndex::Slot*> slots;
+          slots.reserve(m_index.Count());
+          m_index.ForEach([&](KeyIndex::Slot& slot) { slots.push_back(&slot); });
+          auto age = [now](KeyIndex::Slot const* slot) {
+              return slot->expiresAt != 0 && slot->expiresAt <= now ? 0 : slot->lastAccess;
+          };
+          std::sort(slots.begin(), slots.end(), [&](KeyIndex::Slot const* a, KeyIndex::Slot const* b) { return age(a) < age(b); });
+          uint64_t target = m_options.maxLiveBytes / 10 * 9;
+          for (KeyIndex::Slot* slot : slots) {
+              if (m_index.LiveBytes() <= target && age(slot) != 0) {
+                  break;
+              }
+              m_index.Erase(*slot);
+              m_stats.evictions++;
+          }
+      }
+
+      // Copies live, unexpired records in log order to a new log with a clean index, then swaps
+      // both in by rename. Readers keep going until the swap. A crash between the two renames
+      // leaves an index for another log, which the next open rebuilds. Commit mutex held.
+      void CompactLocked() {
+          std::filesystem::path logPath = LogPath().concat(".compact");
+          std::filesystem::path indexPath = IndexPath().concat(".compact");
+          std::filesystem::remove(logPath);
+          std::filesystem::remove(indexPath);
+          uint64_t now = NowMillis();
+          {
+              std::shared_lock<std::shared_mutex> lock(m_indexMutex);
+              std::vector<KeyIndex::Slot> slots;
+              slots.reserve(m_index.Count());
+              m_index.ForEach([&](KeyIndex::Slot const& slot) {
+                  if (slot.expiresAt == 0 || slot.expiresAt > now) {
+                      slots.push_back(slot);
+                  }
+              });
+              std::sort(slots.begin(), slots.end(), [](KeyIndex::Slot const& a, KeyIndex::Slot const& b) { return a.offset < b.offset; });
+
+              detail::LogHeader header{};
+              header.magic = kLogMagic;
+              header.version = kLogVersion;
+              header.logId = NewLogId();
+              LogFile compacted(logPath);
+              std::vector<uint8_t> pending(reinterpret_cast<const uint8_t*>(&header), reinterpret_cast<const uint8_t*>(&header) + sizeof(header));
+              uint64_t written = 0;
+              for (KeyIndex::Slot& slot : slots) {
+                  size_t start = pending.size();
+                  pending.resize(start + slot.recordLength);
+                  if (m_log.ReadAt(slot.offset, pending.data() + start, slot.recordLength) != slot.recordLength) {
+                      throw KeyValueError("Cache log is shorter than its index");
+                  }
+                  slot.offset = written + start;
+                  if (pending.size() >= kScanChunkSize) {
+                      compacted.Append(pending.data(), pending.size());
+                      written += pending.size();
+                      pending.clear();
+                  }
+              }
+              compacted.Append(pending.data(), pending.size());
+              compacted.Sync();
+              KeyIndex::Write(indexPath, header.logId, slots, m_index.Tick(), compacted.Size());
+          }
+          std::unique_lock<std::shared_mutex> lock(m_indexMutex);
+          m_log.Close();
+          m_index.Close();
+          std::filesystem::rename(logPath, LogPath());
+          std::filesystem::rename(indexPath, IndexPath());
+          m_log = LogFile(LogPath());
+          m_index = KeyIndex(IndexPath());
+          m_stats.compactions++;
+      }
+
+      std::filesystem::path m_root;
+      KeyValueOptions m_options;
+      LogFile m_log;
+      KeyIndex m_index;
+
+      // Readers share the index; the committer takes it exclusively to apply a batch
+      std::shared_mutex m_indexMutex;
+      // Serializes commits, compaction and the other whole-store operations
+      std::mutex m_commitMutex;
+
+      // Group commit queue: records waiting for the next commit, and writer tickets
+      std::mutex m_queueMutex;
+      std::condition_variable m_queueChanged;
+      std::vector<uint8_t> m_queued;
+      uint64_t m_enqueued = 0;
+      uint64_t m_committed = 0;
+      bool m_committing = false;
+      // A failed append leaves the log in an unknown state, writes are refused until Clear()
+      std::exception_ptr m_failure;
+
+      KeyValueStats m_stats;
+      std::atomic<uint64_t> m_gets{ 0 };
+      std::atomic<uint64_t> m_hits{ 0 };
+      std::atomic<uint64_t> m_expired{ 0 };
+  };
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace FileIngest
+{
+  struct LogFileError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  // A file that mostly grows at its end, read back at arbitrary offsets. One thread appends while
+  // others read what was appended before; positional reads and writes never share a file pointer.
+  class LogFile
+  {
+  public:
+      LogFile() = default;
+
+      explicit LogFile(std::filesystem::path const& path) {
+          Open(path);
+      }
+
+      ~LogFile() {
+          Close();
+      }
+
+      LogFile(LogFile&& other) noexcept {
+          *this = std::move(other);
+      }
+
+      LogFile& operator=(LogFile&& other) noexcept {
+          if (this != &other) {
+              Close();
+              m_size = std::exchange(other.m_size, 0);
+#if defined(_WIN32)
+              m_file = std::exchange(other.m_file, INVALID_HANDLE_VALUE);
+#else
+              m_file = std::exchange(other.m_file, -1);
+#endif
+          }
+          return *this;
+      }
+
+      LogFile(LogFile const&) = delete;
+      LogFile& operator=(LogFile const&) = delete;
+
+      uint64_t Size() const noexcept {
+          return m_size;
+      }
+
+      void Append(const uint8_t* data, size_t length) {
+          WriteAt(m_size, data, length);
+          m_size += length;
+      }
+
+      // Overwrites bytes within Size(); several threads may write disjoint ranges at once. The file
+      // only grows through Append and Truncate.
+      void WriteAt(uint64_t offset, const uint8_t* data, size_t length) {
+          size_t total = 0;
+          while (total < length) {
+#if defined(_WIN32)
+              OVERLAPPED position{};
+              uint64_t at = offset + total;
+              position.Offset = static_cast<DWORD>(at);
+              position.OffsetHigh = static_cast<DWORD>(at >> 32);
+              DWORD written = 0;
+              if (!::WriteFile(m_file, data + total, static_cast<DWORD>(std::min<size_t>(length - total, 1u << 30)), &written, &position)) {
+                  throw LogFileError("Error writing log");
+              }
+#else
+              ssize_t written = ::pwrite(m_file, data + total, length - total, static_cast<off_t>(offset + total));
+              if (written < 0) {
+                  if (errno == EINTR) {
+                      continue;
+                  }
+                  throw LogFileError("Error writing log");
+              }
+#endif
+              total += static_cast<size_t>(written);
+          }
+      }
+
+      // Reads up to `length` bytes at `offset`, short only at the end of the file
+      size_t ReadAt(uint64_t offset, uint8_t* out, size_t length) const {
+          size_t total = 0;
+          while (total < length) {
+#if defined(_WIN32)
+              OVERLAPPED position{};
+              uint64_t at = offset + total;
+              position.Offset = static_cast<DWORD>(at);
+              position.OffsetHigh = static_cast<DWORD>(at >> 32);
+              DWORD read = 0;
+              if (!::ReadFile(m_file, out + total, static_cast<DWORD>(std::min<size_t>(length - total, 1u << 30)), &read, &position) && ::GetLastError() != ERROR_HANDLE_EOF) {
+                  throw LogFileError("Error reading log");
+              }
+#else
+              ssize_t read = ::pread(m_file, out + total, length - total, static_cast<off_t>(offset + total));
+              if (read < 0) {
+                  if (errno == EINTR) {
+                      continue;
+                  }
+                  throw LogFileError("Error reading log");
+              }
+#endif
+              if (read == 0) {
+                  break;
+              }
+              total += static_cast<size_t>(read);
+          }
+          return total;
+      }
+
+      // Cuts the file back, e.g. to drop a record torn by a crash, or extends it with zeros
+      void Truncate(uint64_t size) {
+#if defined(_WIN32)
+          LARGE_INTEGER target{};
+          target.QuadPart = static_cast<LONGLONG>(size);
+          if (!::SetFilePointerEx(m_file, target, nullptr, FILE_BEGIN) || !::SetEndOfFile(m_file)) {
+              throw LogFileError("Cannot truncate log");
+          }
+#else
+          if (::ftruncate(m_file, static_cast<off_t>(size)) != 0) {
+              throw LogFileError("Cannot truncate log");
+          }
+#endif
+          m_size = size;
+      }
+
+      // Returns once everything appended is on disk
+      void Sync() {
+#if defined(_WIN32)
+          if (!::FlushFileBuffers(m_file)) {
+              throw LogFileError("Cannot sync log");
+          }
+#else
+          if (::fdatasync(m_file) != 0) {
+              throw LogFileError("Cannot sync log");
+          }
+#endif
+      }
+
+      void Close() noexcept {
+#if defined(_WIN32)
+          if (m_file != INVALID_HANDLE_VALUE) {
+              ::CloseHandle(m_file);
+          }
+          m_file = INVALID_HANDLE_VALUE;
+#else
+          if (m_file >= 0) {
+              ::close(m_file);
+          }
+          m_file = -1;
+#endif
+          m_size = 0;
+      }
+
+  private:
+      void Open(std::filesystem::path const& path) {
+#if defined(_WIN32)
+          m_file = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+          if (m_file == INVALID_HANDLE_VALUE) {
+              throw LogFileError("Cannot open " + path.string());
+          }
+          LARGE_INTEGER size{};
+          ::GetFileSizeEx(m_file, &size);
+          m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+          m_file = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+          if (m_file < 0) {
+              throw LogFileError("Cannot open " + path.string());
+          }
+          struct stat info{};
+          ::fstat(m_file, &info);
+          m_size = static_cast<uint64_t>(info.st_size);
+#endif
+      }
+
+      uint64_t m_size = 0;
+#if defined(_WIN32)
+      HANDLE m_file = INVALID_HANDLE_VALUE;
+#else
+      int m_file = -1;
+#endif
+  };
+}
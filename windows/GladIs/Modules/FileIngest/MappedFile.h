@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace FileIngest
+{
+  struct MappedFileError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  // Maps a whole file into memory. Read-write mappings create the file if needed and grow
+  // it to the requested size; writes go straight to the page cache and Flush() syncs them.
+  class MappedFile
+  {
+  public:
+      enum class Mode
+      {
+          ReadOnly,
+          ReadWrite,
+      };
+
+#if defined(_WIN32)
+      using NativeHandle = HANDLE;
+#else
+      using NativeHandle = int;
+#endif
+
+      MappedFile() = default;
+
+      MappedFile(std::filesystem::path const& path, Mode mode, uint64_t minimumSize = 0) : m_mode(mode) {
+          Open(path, minimumSize);
+      }
+
+      // Maps an already open file read-only and takes ownership of its handle, which is closed
+      // here even when the mapping fails
+      explicit MappedFile(NativeHandle file) : m_file(file) {
+          if (!IsFileOpen()) {
+              throw MappedFileError("Invalid file handle");
+          }
+          ReadSize();
+          Map("file");
+      }
+
+      ~MappedFile() {
+          Close();
+      }
+
+      MappedFile(MappedFile&& other) noexcept {
+          *this = std::move(other);
+      }
+
+      MappedFile& operator=(MappedFile&& other) noexcept {
+          if (this != &other) {
+              Close();
+              m_mode = other.m_mode;
+              m_data = std::exchange(other.m_data, nullptr);
+              m_size = std::exchange(other.m_size, 0);
+#if defined(_WIN32)
+              m_file = std::exchange(other.m_file, INVALID_HANDLE_VALUE);
+              m_mapping = std::exchange(other.m_mapping, nullptr);
+#else
+              m_file = std::exchange(other.m_file, -1);
+#endif
+          }
+          return *this;
+      }
+
+      MappedFile(MappedFile const&) = delete;
+      MappedFile& operator=(MappedFile const&) = delete;
+
+      bool IsOpen() const noexcept {
+          return IsFileOpen();
+      }
+
+      uint8_t* Data() noexcept {
+          return m_data;
+      }
+
+      const uint8_t* Data() const noexcept {
+          return m_data;
+      }
+
+      uint64_t Size() const noexcept {
+          return m_size;
+      }
+
+      void Flush() {
+          if (m_data == nullptr || m_mode != Mode::ReadWrite) {
+              return;
+          }
+#if defined(_WIN32)
+          ::FlushViewOfFile(m_data, 0);
+          ::FlushFileBuffers(m_file);
+#else
+          ::msync(m_data, static_cast<size_t>(m_size), MS_SYNC);
+#endif
+      }
+
+      // The whole mapping will be read front to back: the kernel reads further ahead on each
+      // fault and drops pages behind the reader sooner. Windows has no such setting for a view,
+      // readers prefetch each range ahead of them instead.
+      void AdviseSequential() noexcept {
+#if !defined(_WIN32)
+          if (m_data != nullptr) {
+              ::posix_madvise(m_data, static_cast<size_t>(m_size), POSIX_MADV_SEQUENTIAL);
+          }
+#endif
+      }
+
+      // Starts reading [offset, offset + length) into memory without waiting for it, so the
+      // next range is on its way while the current one is processed
+      void Prefetch(uint64_t offset, uint64_t length) noexcept {
+          if (m_data == nullptr || offset >= m_size) {
+              return;
+          }
+          length = std::min(length, m_size - offset);
+#if defined(_WIN32)
+          WIN32_MEMORY_RANGE_ENTRY range{ m_data + offset, static_cast<SIZE_T>(length) };
+          ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+#else
+          // madvise wants a page-aligned start
+          uint64_t pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+          uint64_t start = offset / pageSize * pageSize;
+          ::posix_madvise(m_data + start, static_cast<size_t>(offset + length - start), POSIX_MADV_WILLNEED);
+#endif
+      }
+
+      void Close() noexcept {
+#if defined(_WIN32)
+          if (m_data != nullptr) {
+              ::UnmapViewOfFile(m_data);
+          }
+          if (m_mapping != nullptr) {
+              ::CloseHandle(m_mapping);
+          }
+          if (m_file != INVALID_HANDLE_VALUE) {
+              ::CloseHandle(m_file);
+          }
+          m_mapping = nullptr;
+          m_file = INVALID_HANDLE_VALUE;
+#else
+          if (m_data != nullptr) {
+              ::munmap(m_data, static_cast<size_t>(m_size));
+          }
+          if (m_file >= 0) {
+              ::close(m_file);
+          }
+          m_file = -1;
+#endif
+          m_data = nullptr;
+          m_size = 0;
+      }
+
+  private:
+      bool IsFileOpen() const noexcept {
+#if defined(_WIN32)
+          return m_file != INVALID_HANDLE_VALUE;
+#else
+          return m_file >= 0;
+#endif
+      }
+
+      void Open(std::filesystem::path const& path, uint64_t minimumSize) {
+          bool writable = m_mode == Mode::ReadWrite;
+#if defined(_WIN32)
+          m_file = ::CreateFileW(path.c_str(),
+              writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+              FILE_SHARE_READ | (writable ? 0 : FILE_SHARE_WRITE),
+              nullptr,
+              writable ? OPEN_ALWAYS : OPEN_EXISTING,
+              FILE_ATTRIBUTE_NORMAL,
+              nullptr);
+          if (m_file == INVALID_HANDLE_VALUE) {
+              throw MappedFileError("Cannot open " + path.string());
+          }
+          LARGE_INTEGER size{};
+          ::GetFileSizeEx(m_file, &size);
+          m_size = static_cast<uint64_t>(size.QuadPart);
+          if (writable && m_size < minimumSize) {
+              LARGE_INTEGER target{};
+              target.QuadPart = static_cast<LONGLONG>(minimumSize);
+              if (!::SetFilePointerEx(m_file, target, nullptr, FILE_BEGIN) || !::SetEndOfFile(m_file)) {
+                  Close();
+                  throw MappedFileError("Cannot resize " + path.string());
+              }
+              m_size = minimumSize;
+          }
+#else
+          m_file = ::open(path.c_str(), writable ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+          if (m_file < 0) {
+              throw MappedFileError("Cannot open " + path.string());
+          }
+          struct stat info{};
+          ::fstat(m_file, &info);
+          m_size = static_cast<uint64_t>(info.st_size);
+          if (writable && m_size < minimumSize) {
+              if (::ftruncate(m_file, static_cast<off_t>(minimumSize)) != 0) {
+                  Close();
+                  throw MappedFileError("Cannot resize " + path.string());
+              }
+              m_size = minimumSize;
+          }
+#endif
+          Map(path.string());
+      }
+
+      void ReadSize() {
+#if defined(_WIN32)
+          LARGE_INTEGER size{};
+          bool known = ::GetFileSizeEx(m_file, &size) != 0;
+          m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+          struct stat info{};
+          bool known = ::fstat(m_file, &info) == 0;
+          m_size = static_cast<uint64_t>(info.st_size);
+#endif
+          if (!known) {
+              Close();
+              throw MappedFileError("Cannot read file size");
+          }
+      }
+
+      // Maps m_size bytes of m_file; a file of size zero stays open with no mapping
+      void Map(std::string const& name) {
+          if (m_size == 0) {
+              return;
+          }
+          bool writable = m_mode == Mode::ReadWrite;
+#if defined(_WIN32)
+          m_mapping = ::CreateFileMappingW(m_file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+          if (m_mapping != nullptr) {
+              m_data = static_cast<uint8_t*>(::MapViewOfFile(m_mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+          }
+#else
+          void* address = ::mmap(nullptr, static_cast<size_t>(m_size), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_file, 0);
+          m_data = address == MAP_FAILED ? nullptr : static_cast<uint8_t*>(address);
+#endif
+          if (m_data == nullptr) {
+              Close();
+              throw MappedFileError("Cannot map " + name);
+          }
+      }
+
+      Mode m_mode = Mode::ReadOnly;
+      uint8_t* m_data = nullptr;
+      uint64_t m_size = 0;
+#if defined(_WIN32)
+      HANDLE m_file = INVALID_HANDLE_VALUE;
+      HANDLE m_mapping = nullptr;
+#else
+      int m_file = -1;
+#endif
+  };
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "IoExecutor.h"
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  struct MemoryBudgetExceeded : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  enum class Admission
+  {
+      // Queue until enough memory is released
+      Wait,
+      // Refuse at once when the memory is not available right now
+      FailFast,
+  };
+
+  struct MemoryBudgetStats
+  {
+      uint64_t limit = 0;
+      uint64_t bytesInUse = 0;
+      uint64_t peakBytesInUse = 0;
+      uint64_t admitted = 0;
+      // Admitted after queueing, and refused outright
+      uint64_t waited = 0;
+      uint64_t rejected = 0;
+      uint64_t waiting = 0;
+  };
+
+  // Caps the bytes all in-flight reads may hold at once. A read reserves what it will need
+  // before allocating; reservations are granted in arrival order, so a large read is not
+  // starved by smaller ones. Waiters are resumed on the executor, like AsyncSemaphore.
+  class MemoryBudget
+  {
+  public:
+      MemoryBudget(IoExecutor& executor, uint64_t limit) noexcept : m_executor(executor) {
+          m_stats.limit = limit;
+      }
+
+      MemoryBudget(MemoryBudget const&) = delete;
+      MemoryBudget& operator=(MemoryBudget const&) = delete;
+
+      // Gives its bytes back when it goes out of scope
+      class Reservation
+      {
+      public:
+          Reservation() noexcept = default;
+
+          Reservation(MemoryBudget& budget, uint64_t bytes) noexcept : m_budget(&budget), m_bytes(bytes) {}
+
+          Reservation(Reservation&& other) noexcept : m_budget(std::exchange(other.m_budget, nullptr)), m_bytes(std::exchange(other.m_bytes, 0)) {}
+
+          Reservation& operator=(Reservation&& other) noexcept {
+              if (this != &other) {
+                  Reset();
+                  m_budget = std::exchange(other.m_budget, nullptr);
+                  m_bytes = std::exchange(other.m_bytes, 0);
+              }
+              return *this;
+          }
+
+          Reservation(Reservation const&) = delete;
+          Reservation& operator=(Reservation const&) = delete;
+
+          ~Reservation() {
+              Reset();
+          }
+
+          uint64_t Bytes() const noexcept {
+              return m_bytes;
+          }
+
+          void Reset() noexcept {
+              if (m_budget != nullptr) {
+                  m_budget->Release(m_bytes);
+              }
+              m_budget = nullptr;
+              m_bytes = 0;
+          }
+
+      private:
+          MemoryBudget* m_budget = nullptr;
+          uint64_t m_bytes = 0;
+      };
+
+      struct ReserveAwaiter
+      {
+          MemoryBudget& budget;
+          uint64_t bytes;
+          Admission admission;
+          const char* refusal = nullptr;
+
+          bool await_ready() const noexcept {
+              return false;
+          }
+
+          bool await_suspend(std::coroutine_handle<> handle) {
+              std::lock_guard<std::mutex> lock(budget.m_mutex);
+              refusal = budget.CheckLocked(bytes, admission);
+              if (refusal != nullptr || budget.TryGrantLocked(bytes)) {
+                  return false;
+              }
+              budget.m_waiters.push_back(Waiter{ handle, bytes, &refusal });
+              budget.m_stats.waiting++;
+              return true;
+          }
+
+          [[nodiscard]] Reservation await_resume() {
+              if (refusal != nullptr) {
+                  budget.ThrowRefusal(refusal, bytes);
+              }
+              return Reservation(budget, bytes);
+          }
+      };
+
+      // co_await yields a Reservation of `bytes`, or throws MemoryBudgetExceeded when the bytes
+      // can never fit, or are not free right now and `admission` is FailFast
+      ReserveAwaiter Reserve(uint64_t bytes, Admission admission = Admission::Wait) noexcept {
+          return ReserveAwaiter{ *this, bytes, admission };
+      }
+
+      // Same as Reserve with FailFast, for callers that are not coroutines
+      Reservation TryReserve(uint64_t bytes) {
+          const char* refusal = nullptr;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              refusal = CheckLocked(bytes, Admission::FailFast);
+              if (refusal == nullptr && !TryGrantLocked(bytes)) {
+                  refusal = kBusy;
+              }
+          }
+          if (refusal != nullptr) {
+              ThrowRefusal(refusal, bytes);
+          }
+          return Reservation(*this, bytes);
+      }
+
+      // Raising the limit admits waiters that now fit; lowering it refuses those that never will.
+      // Reservations already granted are kept.
+      void SetLimit(uint64_t limit) {
+          std::vector<std::coroutine_handle<>> ready;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              m_stats.limit = limit;
+              for (auto it = m_waiters.begin(); it != m_waiters.end();) {
+                  if (it->bytes > limit) {
+                      ready.push_back(it->handle);
+                      *it->refusal = kTooLarge;
+                      m_stats.rejected++;
+                      m_stats.waiting--;
+                      it = m_waiters.erase(it);
+                  } else {
+                      ++it;
+                  }
+              }
+              AdmitWaitersLocked(ready);
+          }
+          Resume(ready);
+      }
+
+      MemoryBudgetStats Stats() const {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_stats;
+      }
+
+  private:
+      static constexpr const char* kTooLarge = "too large";
+      static constexpr const char* kBusy = "busy";
+
+      struct Waiter
+      {
+          std::coroutine_handle<> handle;
+          uint64_t bytes;
+          const char** refusal;
+      };
+
+      const char* CheckLocked(uint64_t bytes, Admission admission) noexcept {
+          if (bytes > m_stats.limit) {
+              m_stats.rejected++;
+              return kTooLarge;
+          }
+          if (admission == Admission::FailFast && (!m_waiters.empty() || m_stats.bytesInUse + bytes > m_stats.limit)) {
+              m_stats.rejected++;
+              return kBusy;
+          }
+          return nullptr;
+      }
+
+      // Only grants when nobody is queued, so arrivals cannot overtake waiters
+      bool TryGrantLocked(uint64_t bytes) noexcept {
+          if (!m_waiters.empty() || m_stats.bytesInUse + bytes > m_stats.limit) {
+              return false;
+          }
+          GrantLocked(bytes);
+          return true;
+      }
+
+      void GrantLocked(uint64_t bytes) noexcept {
+          m_stats.bytesInUse += bytes;
+          m_stats.peakBytesInUse = std::max(m_stats.peakBytesInUse, m_stats.bytesInUse);
+          m_stats.admitted++;
+      }
+
+      void AdmitWaitersLocked(std::vector<std::coroutine_handle<>>& ready) {
+          while (!m_waiters.empty() && m_stats.bytesInUse + m_waiters.front().bytes <= m_stats.limit) {
+              // Queued for resumption first, so a failed push leaves the waiter waiting, not lost
+              ready.push_back(m_waiters.front().handle);
+              GrantLocked(m_waiters.front().bytes);
+              m_stats.waited++;
+              m_stats.waiting--;
+              m_waiters.pop_front();
+          }
+      }
+
+      void Release(uint64_t bytes) noexcept {
+          std::vector<std::coroutine_handle<>> ready;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              m_stats.bytesInUse -= bytes;
+              try {
+                  AdmitWaitersLocked(ready);
+              } catch (...) {
+              }
+          }
+          Resume(ready);
+      }
+
+      void Resume(std::vector<std::coroutine_handle<>> const& ready) noexcept {
+          for (std::coroutine_handle<> handle : ready) {
+              try {
+                  m_executor.Post([handle]() { handle.resume(); });
+              } catch (...) {
+              }
+          }
+      }
+
+      [[noreturn]] void ThrowRefusal(const char* refusal, uint64_t bytes) const {
+          uint64_t limit = Stats().limit;
+          if (refusal == kTooLarge) {
+              throw MemoryBudgetExceeded("File is too large to read: it needs " + std::to_string(bytes / (1024 * 1024) + 1) + " MB and the read memory budget is " + std::to_string(limit / (1024 * 1024)) + " MB");
+          }
+          throw MemoryBudgetExceeded("Not enough memory for another read, try again when the current reads finish");
+      }
+
+      IoExecutor& m_executor;
+      mutable std::mutex m_mutex;
+      std::deque<Waiter> m_waiters;
+      MemoryBudgetStats m_stats;
+  };
+}
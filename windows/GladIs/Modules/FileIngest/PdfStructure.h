@@ -0,0 +1,1131 @@
+#pragma once
+
+#include "PdfText.h"
+#include "RangeSource.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  // What a PDF's structure says about it, from the few objects that hold it
+  struct PdfStructure
+  {
+      // Of the header, or of the catalog's /Version when that is later
+      std::string version;
+      uint64_t fileSize = 0;
+      // -1 when the page tree has no usable /Count
+      int64_t pageCount = -1;
+      bool linearized = false;
+      // Cross-reference sections followed from the end of the file; each incremental update
+      // adds one, and a linearized file has two to begin with
+      uint32_t xrefSections = 0;
+      bool xrefStreams = false;
+
+      bool encrypted = false;
+      std::string encryptionFilter;
+      int64_t encryptionRevision = 0;
+      int64_t encryptionKeyBits = 0;
+      // The /P bits as written, and the permissions they grant
+      int64_t permissions = -1;
+      bool canPrint = true;
+      bool canModify = true;
+      bool canCopy = true;
+
+      // From the /Info dictionary, with the XMP metadata stream filling the gaps. Dates are ISO
+      // 8601 where they parse, and as written otherwise. Empty when absent or encrypted.
+      std::string title;
+      std::string author;
+      std::string subject;
+      std::string keywords;
+      std::string creator;
+      std::string producer;
+      std::string creationDate;
+      std::string modificationDate;
+      bool hasXmpMetadata = false;
+
+      // The cross-reference data could not be followed, and objects were found by scanning the
+      // whole file instead
+      bool repaired = false;
+      // What is wrong with the file; empty for a sound one
+      std::vector<std::string> problems;
+      // Read from the source, to show how little of a sound file that takes
+      uint64_t bytesRead = 0;
+  };
+
+  namespace detail
+  {
+    // PDFDocEncoding, the single-byte encoding of text strings without a byte order mark:
+    // Latin-1 with accents in 0x18-0x1F and typographic signs in 0x80-0xA0
+    inline uint32_t PdfDocEncodingToUnicode(uint8_t c) noexcept {
+        static constexpr uint16_t kLow[8] = { 0x02D8, 0x02C7, 0x02C6, 0x02D9, 0x02DD, 0x02DB, 0x02DA, 0x02DC };
+        static constexpr uint16_t kHigh[33] = {
+            0x2022, 0x2020, 0x2021, 0x2026, 0x2014, 0x2013, 0x0192, 0x2044, 0x2039, 0x203A, 0x2212, 0x2030, 0x201E, 0x201C, 0x201D, 0x2018,
+            0x2019, 0x201A, 0x2122, 0xFB01, 0xFB02, 0x0141, 0x0152, 0x0160, 0x0178, 0x017D, 0x0131, 0x0142, 0x0153, 0x0161, 0x017E, 0xFFFD,
+            0x20AC,
+        };
+        if (c >= 0x18 && c < 0x20) {
+            return kLow[c - 0x18];
+        }
+        if (c >= 0x80 && c <= 0xA0) {
+            return kHigh[c - 0x80];
+        }
+        return c;
+    }
+
+    // A text string as UTF-8: UTF-16BE or UTF-8 after their byte order marks, PDFDocEncoding
+    // otherwise
+    inline std::string PdfTextStringToUtf8(std::string_view bytes) {
+        if (bytes.size() >= 2 && uint8_t(bytes[0]) == 0xFE && uint8_t(bytes[1]) == 0xFF) {
+            return Utf16BeToUtf8(bytes.substr(2));
+        }
+        if (bytes.size() >= 3 && uint8_t(bytes[0]) == 0xEF && uint8_t(bytes[1]) == 0xBB && uint8_t(bytes[2]) == 0xBF) {
+            return std::string(bytes.substr(3));
+        }
+        std::string out;
+        for (char c : bytes) {
+            AppendUtf8(out, PdfDocEncodingToUnicode(static_cast<uint8_t>(c)));
+        }
+        return out;
+    }
+
+    // "D:YYYYMMDDHHmmSSOHH'mm'" as ISO 8601, keeping the fields present. Returns the string as
+    // written when it does not parse.
+    inline std::string PdfDateToIso(std::string_view date) {
+        std::string_view rest = date.substr(0, 2) == "D:" ? date.substr(2) : date;
+        auto digits = [&rest](size_t count, std::string& out) {
+            if (rest.size() < count || !std::all_of(rest.begin(), rest.begin() + count, [](char c) { return c >= '0' && c <= '9'; })) {
+                return false;
+            }
+            out.append(rest.substr(0, count));
+            rest.remove_prefix(count);
+            return true;
+        };
+        std::string iso;
+        if (!digits(4, iso)) {
+            return std::string(date);
+        }
+        static constexpr const char* kSeparators[] = { "-", "-", "T", ":", ":" };
+        size_t fields = 0;
+        for (const char* separator : kSeparators) {
+            std::string field;
+            if (!digits(2, field)) {
+                break;
+            }
+            iso += separator + field;
+            fields++;
+        }
+        if (fields == 3) {
+            // An hour needs its minutes to be a time
+            iso += ":00";
+        }
+        if (fields >= 3 && !rest.empty()) {
+            if (rest[0] == 'Z') {
+                iso += 'Z';
+            } else if (rest[0] == '+' || rest[0] == '-') {
+                std::string zone(1, rest[0]);
+                rest.remove_prefix(1);
+                std::string hours;
+                std::string minutes = "00";
+                if (digits(2, hours)) {
+                    if (!rest.empty() && rest[0] == '\'') {
+                        rest.remove_prefix(1);
+                    }
+                    std::string written;
+                    if (digits(2, written)) {
+                        minutes = written;
+                    }
+                    iso += zone + hours + ":" + minutes;
+                }
+            }
+        }
+        return iso;
+    }
+
+    inline std::string DecodeXmlEntities(std::string_view text) {
+        std::string out;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] != '&') {
+                out.push_back(text[i]);
+                continue;
+            }
+            size_t end = text.find(';', i);
+            if (end == std::string_view::npos || end - i > 10) {
+                out.push_back('&');
+                continue;
+            }
+            std::string_view entity = text.substr(i + 1, end - i - 1);
+            if (entity == "amp") {
+                out.push_back('&');
+            } else if (entity == "lt") {
+                out.push_back('<');
+            } else if (entity == "gt") {
+                out.push_back('>');
+            } else if (entity == "quot") {
+                out.push_back('"');
+            } else if (entity == "apos") {
+                out.push_back('\'');
+            } else if (entity.size() > 1 && entity[0] == '#') {
+                bool hex = entity[1] == 'x' || entity[1] == 'X';
+                uint32_t value = 0;
+                for (char c : entity.substr(hex ? 2 : 1)) {
+                    int digit = hex ? HexDigitValue(static_cast<uint8_t>(c)) : (c >= '0' && c <= '9' ? c - '0' : -1);
+                    if (digit < 0 || value > 0x10FFFF) {
+                        value = 0xFFFD;
+                        break;
+                    }
+                    value = value * (hex ? 16 : 10) + static_cast<uint32_t>(digit);
+                }
+                AppendUtf8(out, value <= 0x10FFFF ? value : 0xFFFD);
+            } else {
+                out.append(text.substr(i, end - i + 1));
+            }
+            i = end;
+        }
+        return out;
+    }
+
+    // The value of an XMP property, written either as an element, whose rdf:li items are
+    // joined with ", " (the first only for a language alternative), or as an attribute of
+    // rdf:Description. Empty when the packet does not have it.
+    inline std::string XmpProperty(std::string_view xmp, std::string_view name) {
+        auto trim = [](std::string_view text) {
+            size_t start = text.find_first_not_of(" \t\r\n");
+            size_t end = text.find_last_not_of(" \t\r\n");
+            return start == std::string_view::npos ? std::string_view() : text.substr(start, end - start + 1);
+        };
+        std::string open = "<" + std::string(name);
+        for (size_t at = xmp.find(open); at != std::string_view::npos; at = xmp.find(open, at + 1)) {
+            size_t after = at + open.size();
+            if (after >= xmp.size() || (xmp[after] != '>' && xmp[after] != ' ' && xmp[after] != '/' && xmp[after] != '\t' && xmp[after] != '\r' && xmp[after] != '\n')) {
+                continue;
+            }
+            size_t tagEnd = xmp.find('>', after);
+            if (tagEnd == std::string_view::npos || xmp[tagEnd - 1] == '/') {
+                return std::string();
+            }
+            size_t close = xmp.find("</" + std::string(name), tagEnd);
+            std::string_view body = xmp.substr(tagEnd + 1, close == std::string_view::npos ? std::string_view::npos : close - tagEnd - 1);
+            if (body.find("<rdf:li") == std::string_view::npos) {
+                return DecodeXmlEntities(trim(body));
+            }
+            bool alternative = body.find("<rdf:Alt") != std::string_view::npos;
+            std::string joined;
+            for (size_t item = body.find("<rdf:li"); item != std::string_view::npos; item = body.find("<rdf:li", item + 1)) {
+                size_t start = body.find('>', item);
+                size_t end = start == std::string_view::npos ? start : body.find("</rdf:li", start);
+                if (end == std::string_view::npos || body[start - 1] == '/') {
+                    continue;
+                }
+                std::string value = DecodeXmlEntities(trim(body.substr(start + 1, end - start - 1)));
+                if (value.empty()) {
+                    continue;
+                }
+                if (alternative) {
+                    return value;
+                }
+                joined += (joined.empty() ? "" : ", ") + value;
+            }
+            return joined;
+        }
+        std::string attribute = std::string(name) + "=";
+        for (size_t at = xmp.find(attribute); at != std::string_view::npos; at = xmp.find(attribute, at + 1)) {
+            if (at == 0 || !IsPdfWhitespace(static_cast<uint8_t>(xmp[at - 1])) || at + attribute.size() >= xmp.size()) {
+                continue;
+            }
+            char quote = xmp[at + attribute.size()];
+            size_t start = at + attribute.size() + 1;
+            size_t end = xmp.find(quote, start);
+            if ((quote != '"' && quote != '\'') || end == std::string_view::npos) {
+                continue;
+            }
+            return DecodeXmlEntities(trim(xmp.substr(start, end - start)));
+        }
+        return std::string();
+    }
+  }
+
+  // Reads a PDF's structure through a RangeSource without loading the file: the trailer and
+  // cross-reference sections from the end of the file, classic tables, cross-reference streams
+  // and both in one file, following /Prev through incremental updates; then only the objects
+  // that hold the page count, metadata and encryption. A classic table is never read whole:
+  // entries have a fixed size, so the one an object needs is read on its own. Sound files of
+  // any size take a handful of small reads.
+  //
+  // When the cross-reference data is missing or points at the wrong objects, the file is read
+  // whole and repaired by scanning for objects, as viewers do, and the result says so.
+  class PdfStructureReader
+  {
+  public:
+      // Reads are made, and cached, in blocks of this size
+      static constexpr size_t kBlockSize = 16 * 1024;
+      // Where startxref is looked for; the format asks for the last 1 KiB, some writers pad more
+      static constexpr size_t kTailLength = 4096;
+      static constexpr size_t kMaxObjectLength = 4 * 1024 * 1024;
+      // Cross-reference streams, object streams and XMP packets, before and after decoding
+      static constexpr size_t kMaxStreamLength = 64 * 1024 * 1024;
+      static constexpr uint32_t kMaxXrefSections = 256;
+      static constexpr uint32_t kMaxSubsections = 65536;
+      // Larger files are not loaded to be repaired; their problems are reported as found
+      static constexpr uint64_t kMaxRepairSize = 512ull * 1024 * 1024;
+
+      explicit PdfStructureReader(RangeSource& source) : m_source(source), m_size(source.Size()) {}
+
+      PdfStructureReader(PdfStructureReader const&) = delete;
+      PdfStructureReader& operator=(PdfStructureReader const&) = delete;
+
+      // Throws PdfError when the source is not a PDF at all; any other damage is reported in
+      // PdfStructure::problems
+      PdfStructure Read() {
+          PdfStructure result;
+          result.fileSize = m_size;
+          ReadHeader(result);
+          ReadLinearization(result);
+          try {
+              ReadXrefChain(result);
+          } catch (PdfError const& e) {
+              AddProblem(e.what());
+              Repair();
+          } catch (RangeReadError const& e) {
+              AddProblem(e.what());
+              Repair();
+          }
+          try {
+              ReadDocument(result);
+          } catch (PdfError const& e) {
+              if (m_table != nullptr) {
+                  throw;
+              }
+              AddProblem(e.what());
+              if (Repair()) {
+                  ReadDocument(result);
+              }
+          }
+          result.repaired = m_table != nullptr;
+          result.problems = m_problems;
+          result.bytesRead = m_bytesRead;
+          return result;
+      }
+
+  private:
+      struct XrefEntry
+      {
+          enum class Kind
+          {
+              // Not in this section; look in older ones
+              Missing,
+              Free,
+              InFile,
+              Compressed,
+          };
+          Kind kind = Kind::Missing;
+          uint64_t offset = 0;
+          uint32_t objectStream = 0;
+          uint32_t index = 0;
+      };
+
+      struct XrefSubsection
+      {
+          uint32_t first;
+          uint32_t count;
+          uint64_t entries;
+          uint32_t entryLength;
+      };
+
+      struct XrefSection
+      {
+          uint64_t offset = 0;
+          bool stream = false;
+          // A table whose trailer has /XRefStm lists the objects in object streams as free
+          bool hybrid = false;
+          std::vector<XrefSubsection> subsections;
+          // Of a cross-reference stream: the decoded rows, their field widths and the object
+          // number ranges they cover, in order
+          std::vector<uint8_t> rows;
+          uint32_t widths[3] = { 0, 0, 0 };
+          std::vector<std::pair<uint32_t, uint32_t>> ranges;
+          PdfObject trailer;
+      };
+
+      // An indirect object, with a stream's data alongside, so streamOffset is 0
+      struct LoadedObject
+      {
+          PdfObject object;
+          std::vector<uint8_t> data;
+      };
+
+      struct ObjectStream
+      {
+          std::vector<uint8_t> data;
+          std::vector<size_t> offsets;
+      };
+
+      void AddProblem(std::string problem) {
+          if (std::find(m_problems.begin(), m_problems.end(), problem) == m_problems.end()) {
+              m_problems.push_back(std::move(problem));
+          }
+      }
+
+      // [offset, offset + length) clipped to the end of the file, through the block cache
+      std::vector<uint8_t> ReadBytes(uint64_t offset, size_t length) {
+          std::vector<uint8_t> out;
+          if (offset >= m_size) {
+              return out;
+          }
+          length = static_cast<size_t>(std::min<uint64_t>(length, m_size - offset));
+          out.resize(length);
+          size_t copied = 0;
+          while (copied < length) {
+              uint64_t at = offset + copied;
+              uint64_t block = at / kBlockSize;
+              auto found = m_blocks.find(block);
+              if (found == m_blocks.end()) {
+                  std::vector<uint8_t> bytes(static_cast<size_t>(std::min<uint64_t>(kBlockSize, m_size - block * kBlockSize)));
+                  bytes.resize(m_source.ReadAt(block * kBlockSize, bytes.data(), bytes.size()));
+                  m_bytesRead += bytes.size();
+                  found = m_blocks.emplace(block, std::move(bytes)).first;
+              }
+              size_t within = static_cast<size_t>(at - block * kBlockSize);
+              if (within >= found->second.size()) {
+                  // The source ended early
+                  out.resize(copied);
+                  break;
+              }
+              size_t take = std::min(length - copied, found->second.size() - within);
+              std::memcpy(out.data() + copied, found->second.data() + within, take);
+              copied += take;
+          }
+          return out;
+      }
+
+      void ReadHeader(PdfStructure& result) {
+          std::vector<uint8_t> head = ReadBytes(0, 1024);
+          size_t at = detail::FindBytes(head.data(), 0, head.size(), "%PDF-");
+          if (at >= head.size()) {
+              throw PdfError("File is not a PDF");
+          }
+          m_headerOffset = at;
+          size_t end = at + 5;
+          while (end < head.size() && end < at + 12 && ((head[end] >= '0' && head[end] <= '9') || head[end] == '.')) {
+              end++;
+          }
+          result.version.assign(reinterpret_cast<const char*>(head.data() + at + 5), end - at - 5);
+          if (result.version.empty()) {
+              AddProblem("PDF header has no version");
+          }
+      }
+
+      // A linearized file starts with a dictionary giving its length and page count, within
+      // its first KiB
+      void ReadLinearization(PdfStructure& result) {
+          std::vector<uint8_t> head = ReadBytes(m_headerOffset, 1024);
+          try {
+              PdfParser parser(head.data(), head.size());
+              PdfLexer& lexer = parser.Lexer();
+              PdfToken number = lexer.Next();
+              PdfToken generation = lexer.Next();
+              if (number.type != PdfToken::Type::Integer || generation.type != PdfToken::Type::Integer || !lexer.Next().IsKeyword("obj")) {
+                  return;
+              }
+              PdfObject first = parser.ReadObject();
+              if (first.Find("Linearized") == nullptr) {
+                  return;
+              }
+              result.linearized = true;
+              const PdfObject* pages = first.Find("N");
+              if (pages != nullptr && pages->type == PdfObject::Type::Integer && pages->integer >= 0) {
+                  m_linearizedPageCount = pages->integer;
+              }
+              // Updates appended later make the file longer, never shorter
+              const PdfObject* length = first.Find("L");
+              if (length != nullptr && length->type == PdfObject::Type::Integer && length->integer > 0 && static_cast<uint64_t>(length->integer) > m_size) {
+                  AddProblem("PDF is shorter than its linearization dictionary says");
+              }
+          } catch (PdfError const&) {
+              // Not a complete object: not a linearization dictionary either
+          }
+      }
+
+      void ReadXrefChain(PdfStructure& result) {
+          uint64_t tailStart = m_size > kTailLength ? m_size - kTailLength : 0;
+          std::vector<uint8_t> tail = ReadBytes(tailStart, kTailLength);
+          std::string_view text(reinterpret_cast<const char*>(tail.data()), tail.size());
+          size_t at = text.rfind("startxref");
+          if (at == std::string_view::npos) {
+              throw PdfError("PDF has no startxref");
+          }
+          if (text.find("%%EOF", at) == std::string_view::npos) {
+              AddProblem("PDF does not end with %%EOF");
+          }
+          PdfLexer lexer(tail.data(), tail.size(), at + 9);
+          PdfToken offset = lexer.Next();
+          if (offset.type != PdfToken::Type::Integer || offset.integer < 0 || static_cast<uint64_t>(offset.integer) >= m_size) {
+              throw PdfError("PDF startxref is out of bounds");
+          }
+
+          std::vector<uint64_t> pending = { static_cast<uint64_t>(offset.integer) };
+          std::unordered_set<uint64_t> seen;
+          while (!pending.empty()) {
+              uint64_t next = pending.back();
+              pending.pop_back();
+              if (!seen.insert(next).second) {
+                  AddProblem("PDF cross-reference sections form a loop");
+                  continue;
+              }
+              if (m_sections.size() >= kMaxXrefSections) {
+                  throw PdfError("PDF has too many cross-reference sections");
+              }
+              m_sections.push_back(ReadXrefSection(next));
+              XrefSection const& section = m_sections.back();
+              result.xrefStreams = result.xrefStreams || section.stream;
+              auto offsetOf = [this](PdfObject const& trailer, std::string_view key) -> std::optional<uint64_t> {
+                  const PdfObject* value = trailer.Find(key);
+                  if (value == nullptr || value->type != PdfObject::Type::Integer || value->integer < 0 || static_cast<uint64_t>(value->integer) >= m_size) {
+                      if (value != nullptr) {
+                          AddProblem("PDF /" + std::string(key) + " is out of bounds");
+                      }
+                      return std::nullopt;
+                  }
+                  return static_cast<uint64_t>(value->integer);
+              };
+              // The older section is pushed first, so a hybrid file's stream is read before it
+              if (auto previous = offsetOf(section.trailer, "Prev")) {
+                  pending.push_back(*previous);
+              }
+              if (!section.stream) {
+                  if (auto hybrid = offsetOf(section.trailer, "XRefStm")) {
+                      pending.push_back(*hybrid);
+                  }
+              }
+          }
+          // The newest trailer wins, older ones fill in what it lacks
+          for (XrefSection const& section : m_sections) {
+              for (size_t i = 0; i < section.trailer.keys.size(); i++) {
+                  if (m_trailer.Find(section.trailer.keys[i]) == nullptr) {
+                      m_trailer.keys.push_back(section.trailer.keys[i]);
+                      m_trailer.items.push_back(section.trailer.items[i]);
+                  }
+              }
+          }
+          m_trailer.type = PdfObject::Type::Dictionary;
+          result.xrefSections = static_cast<uint32_t>(m_sections.size());
+      }
+
+      // The section at `offset`, or, when nothing is there but the file has bytes before its
+      // header, at `offset` counted from the header as some writers do
+      XrefSection ReadXrefSection(uint64_t offset) {
+          try {
+              return ReadXrefSectionAt(offset);
+          } catch (PdfError const&) {
+              if (m_headerOffset == 0 || offset + m_headerOffset >= m_size) {
+                  throw;
+              }
+              m_offsetShift = m_headerOffset;
+              return ReadXrefSectionAt(offset + m_headerOffset);
+          }
+      }
+
+      XrefSection ReadXrefSectionAt(uint64_t offset) {
+          std::vector<uint8_t> window = ReadBytes(offset, 64);
+          PdfLexer lexer(window.data(), window.size());
+          PdfToken first = lexer.Next();
+          if (first.IsKeyword("xref")) {
+              return ReadXrefTable(offset + lexer.Position());
+          }
+          if (first.type != PdfToken::Type::Integer) {
+              throw PdfError("PDF cross-reference section is missing");
+          }
+          std::unique_ptr<LoadedObject> loaded = LoadObjectAt(offset, std::nullopt);
+          PdfObject& object = loaded->object;
+          const PdfObject* type = object.Find("Type");
+          if (object.type != PdfObject::Type::Stream || type == nullptr || !type->IsName("XRef")) {
+              throw PdfError("PDF cross-reference stream is malformed");
+          }
+          XrefSection section;
+          section.offset = offset;
+          section.stream = true;
+          const PdfObject* widths = object.Find("W");
+          if (widths == nullptr || widths->type != PdfObject::Type::Array || widths->items.size() < 3) {
+              throw PdfError("PDF cross-reference stream has no /W");
+          }
+          for (size_t i = 0; i < 3; i++) {
+              PdfObject const& width = widths->items[i];
+              if (width.type != PdfObject::Type::Integer || width.integer < 0 || width.integer > 8) {
+                  throw PdfError("PDF cross-reference stream /W is invalid");
+              }
+              section.widths[i] = static_cast<uint32_t>(width.integer);
+          }
+          const PdfObject* index = object.Find("Index");
+          if (index != nullptr && index->type == PdfObject::Type::Array) {
+              for (size_t i = 0; i + 1 < index->items.size(); i += 2) {
+                  PdfObject const& start = index->items[i];
+                  PdfObject const& count = index->items[i + 1];
+                  if (start.type != PdfObject::Type::Integer || count.type != PdfObject::Type::Integer || start.integer < 0 || count.integer < 0 || start.integer + count.integer > UINT32_MAX) {
+                      throw PdfError("PDF cross-reference stream /Index is invalid");
+                  }
+                  section.ranges.emplace_back(static_cast<uint32_t>(start.integer), static_cast<uint32_t>(count.integer));
+              }
+          } else {
+              const PdfObject* size = object.Find("Size");
+              if (size == nullptr || size->type != PdfObject::Type::Integer || size->integer < 0 || size->integer > UINT32_MAX) {
+                  throw PdfError("PDF cross-reference stream has no /Size");
+              }
+              section.ranges.emplace_back(0, static_cast<uint32_t>(size->integer));
+          }
+          DecodePdfStream(loaded->data.data(), loaded->data.size(), object, section.rows, kMaxStreamLength);
+          uint64_t rowLength = section.widths[0] + section.widths[1] + section.widths[2];
+          uint64_t rows = 0;
+          for (auto const& range : section.ranges) {
+              rows += range.second;
+          }
+          if (rowLength == 0 || rows * rowLength > section.rows.size()) {
+              AddProblem("PDF cross-reference stream is shorter than its /Index");
+          }
+          object.type = PdfObject::Type::Dictionary;
+          section.trailer = std::move(object);
+          return section;
+      }
+
+      // Reads only the subsection headers and the trailer: the entries of a subsection are
+      // skipped by their fixed length
+      XrefSection ReadXrefTable(uint64_t position) {
+          XrefSection section;
+          section.offset = position;
+          for (;;) {
+              std::vector<uint8_t> window = ReadBytes(position, 256);
+              PdfLexer lexer(window.data(), window.size());
+              PdfToken first = lexer.Next();
+              if (first.IsKeyword("trailer")) {
+                  std::unique_ptr<LoadedObject> trailer = LoadDirectAt(position + lexer.Position());
+                  if (trailer->object.type != PdfObject::Type::Dictionary) {
+                      throw PdfError("PDF trailer is malformed");
+                  }
+                  section.trailer = std::move(trailer->object);
+                  section.hybrid = section.trailer.Find("XRefStm") != nullptr;
+                  return section;
+              }
+              PdfToken count = lexer.Next();
+              if (first.type != PdfToken::Type::Integer || count.type != PdfToken::Type::Integer || first.integer < 0 || count.integer < 0 || first.integer + count.integer > UINT32_MAX) {
+                  throw PdfError("PDF cross-reference table is malformed");
+              }
+              if (section.subsections.size() >= kMaxSubsections) {
+                  throw PdfError("PDF cross-reference table has too many subsections");
+              }
+              lexer.SkipWhitespace();
+              XrefSubsection subsection{ static_cast<uint32_t>(first.integer), static_cast<uint32_t>(count.integer), position + lexer.Position(), 20 };
+              if (subsection.count > 0) {
+                  subsection.entryLength = EntryLength(subsection.entries);
+              }
+              uint64_t end = subsection.entries + uint64_t(subsection.count) * subsection.entryLength;
+              if (end > m_size) {
+                  throw PdfError("PDF cross-reference table runs past the end of the file");
+              }
+              section.subsections.push_back(subsection);
+              position = end;
+          }
+      }
+
+      // Entries are 20 bytes, ending in " \r", " \n" or "\r\n"; some writers drop to 19 with a
+      // lone end of line
+      uint32_t EntryLength(uint64_t entries) {
+          std::vector<uint8_t> entry = ReadBytes(entries, 21);
+          if (entry.size() < 19 || entry[10] != ' ' || entry[16] != ' ' || (entry[17] != 'n' && entry[17] != 'f')) {
+              throw PdfError("PDF cross-reference entry is malformed");
+          }
+          if (entry.size() >= 20 && (entry[18] == ' ' || entry[18] == '\r') && (entry[19] == '\r' || entry[19] == '\n')) {
+              return 20;
+          }
+          if (entry[18] == '\r' || entry[18] == '\n') {
+              return 19;
+          }
+          throw PdfError("PDF cross-reference entry is malformed");
+      }
+
+      XrefEntry Lookup(uint32_t number) {
+          for (XrefSection const& section : m_sections) {
+              XrefEntry entry = section.stream ? LookupInStream(section, number) : LookupInTable(section, number);
+              if (entry.kind != XrefEntry::Kind::Missing && !(entry.kind == XrefEntry::Kind::Free && section.hybrid)) {
+                  return entry;
+              }
+          }
+          return XrefEntry{};
+      }
+
+      XrefEntry LookupInTable(XrefSection const& section, uint32_t number) {
+          XrefEntry entry;
+          // Later subsections of a section take precedence, as viewers read them in order
+          for (auto it = section.subsections.rbegin(); it != section.subsections.rend(); ++it) {
+              if (number < it->first || number - it->first >= it->count) {
+                  continue;
+              }
+              std::vector<uint8_t> line = ReadBytes(it->entries + uint64_t(number - it->first) * it->entryLength, 18);
+              if (line.size() < 18 || line[10] != ' ' || line[16] != ' ') {
+                  throw PdfError("PDF cross-reference entry is malformed");
+              }
+              uint64_t offset = 0;
+              for (size_t i = 0; i < 10; i++) {
+                  if (line[i] < '0' || line[i] > '9') {
+                      throw PdfError("PDF cross-reference entry is malformed");
+                  }
+                  offset = offset * 10 + (line[i] - '0');
+              }
+              if (line[17] == 'f') {
+                  entry.kind = XrefEntry::Kind::Free;
+              } else if (line[17] == 'n') {
+                  entry.kind = XrefEntry::Kind::InFile;
+                  entry.offset = offset + m_offsetShift;
+              } else {
+                  throw PdfError("PDF cross-reference entry is malformed");
+              }
+              return entry;
+          }
+          return entry;
+      }
+
+      static XrefEntry LookupInStream(XrefSection const& section, uint32_t number) {
+          XrefEntry entry;
+          uint64_t row = 0;
+          for (auto const& range : section.ranges) {
+              if (number >= range.first && number - range.first < range.second) {
+                  row += number - range.first;
+                  size_t rowLength = section.widths[0] + section.widths[1] + section.widths[2];
+                  if (rowLength == 0 || (row + 1) * rowLength > section.rows.size()) {
+                      return entry;
+                  }
+                  const uint8_t* bytes = section.rows.data() + row * rowLength;
+                  uint64_t fields[3] = { 1, 0, 0 };
+                  for (size_t f = 0; f < 3; f++) {
+                      if (section.widths[f] == 0) {
+                          continue;
+                      }
+                      fields[f] = 0;
+                      for (uint32_t b = 0; b < section.widths[f]; b++) {
+                          fields[f] = fields[f] << 8 | *bytes++;
+                      }
+                  }
+                  if (fields[0] == 0) {
+                      entry.kind = XrefEntry::Kind::Free;
+                  } else if (fields[0] == 1) {
+                      entry.kind = XrefEntry::Kind::InFile;
+                      entry.offset = fields[1];
+                  } else if (fields[0] == 2 && fields[1] <= UINT32_MAX && fields[2] <= UINT32_MAX) {
+                      entry.kind = XrefEntry::Kind::Compressed;
+                      entry.objectStream = static_cast<uint32_t>(fields[1]);
+                      entry.index = static_cast<uint32_t>(fields[2]);
+                  } else {
+                      // Types above 2 are reserved and read as null
+                      entry.kind = XrefEntry::Kind::Free;
+                  }
+                  return entry;
+              }
+              row += range.second;
+          }
+          return entry;
+      }
+
+      // A direct object, such as a trailer dictionary, at an absolute offset
+      std::unique_ptr<LoadedObject> LoadDirectAt(uint64_t offset) {
+          for (size_t window = 4096;; window *= 4) {
+              std::vector<uint8_t> bytes = ReadBytes(offset, window);
+              try {
+                  PdfParser parser(bytes.data(), bytes.size());
+                  auto loaded = std::make_unique<LoadedObject>();
+                  loaded->object = parser.ReadObject();
+                  return loaded;
+              } catch (PdfError const&) {
+                  if (bytes.size() < window || window >= kMaxObjectLength) {
+                      throw;
+                  }
+              }
+          }
+      }
+
+      // "N G obj ... endobj" at an absolute offset, growing the window read until the object
+      // fits. A stream's data is read by its /Length, checked against the endstream after it.
+      std::unique_ptr<LoadedObject> LoadObjectAt(uint64_t offset, std::optional<uint32_t> expected) {
+          for (size_t window = 4096;; window *= 4) {
+              std::vector<uint8_t> bytes = ReadBytes(offset, window);
+              bool complete = bytes.size() < window;
+              try {
+                  PdfParser parser(bytes.data(), bytes.size());
+                  PdfLexer& lexer = parser.Lexer();
+                  PdfToken number = lexer.Next();
+                  PdfToken generation = lexer.Next();
+                  PdfToken keyword = lexer.Next();
+                  if (number.type != PdfToken::Type::Integer || generation.type != PdfToken::Type::Integer || !keyword.IsKeyword("obj")) {
+                      throw PdfError("PDF object header is malformed");
+                  }
+                  if (expected && number.integer != *expected) {
+                      throw PdfError("PDF object " + std::to_string(*expected) + " is not where the cross-reference data says");
+                  }
+                  auto loaded = std::make_unique<LoadedObject>();
+                  loaded->object = parser.ReadObject();
+                  if (loaded->object.type != PdfObject::Type::Dictionary) {
+                      return loaded;
+                  }
+                  size_t afterDictionary = lexer.Position();
+                  PdfToken next = lexer.Next();
+                  if (next.type == PdfToken::Type::End && !complete) {
+                      throw PdfError("PDF object is truncated");
+                  }
+                  if (!next.IsKeyword("stream")) {
+                      lexer.Seek(afterDictionary);
+                      return loaded;
+                  }
+                  size_t start = lexer.Position();
+                  if (start < bytes.size() && bytes[start] == '\r') {
+                      start++;
+                  }
+                  if (start < bytes.size() && bytes[start] == '\n') {
+                      start++;
+                  }
+                  ReadStreamData(*loaded, offset + start, number.integer);
+                  return loaded;
+              } catch (PdfError const&) {
+                  if (complete || window >= kMaxObjectLength) {
+                      throw;
+                  }
+              }
+          }
+      }
+
+      void ReadStreamData(LoadedObject& loaded, uint64_t start, int64_t number) {
+          PdfObject& object = loaded.object;
+          object.type = PdfObject::Type::Stream;
+          object.streamOffset = 0;
+          int64_t length = -1;
+          if (const PdfObject* value = object.Find("Length")) {
+              if (value->type == PdfObject::Type::Integer) {
+                  length = value->integer;
+              } else if (value->type == PdfObject::Type::Reference && m_lengthDepth < 4 && static_cast<int64_t>(value->reference.number) != number) {
+                  // The length of a stream written before its size was known
+                  m_lengthDepth++;
+                  const PdfObject* resolved = nullptr;
+                  try {
+                      resolved = Get(value->reference.number);
+                  } catch (...) {
+                      m_lengthDepth--;
+                      throw;
+                  }
+                  m_lengthDepth--;
+                  if (resolved != nullptr && resolved->type == PdfObject::Type::Integer) {
+                      length = resolved->integer;
+                  }
+              }
+          }
+          if (length >= 0 && static_cast<uint64_t>(length) <= kMaxStreamLength && start + static_cast<uint64_t>(length) <= m_size) {
+              std::vector<uint8_t> after = ReadBytes(start + static_cast<uint64_t>(length), 32);
+              PdfLexer check(after.data(), after.size());
+              if (check.Next().IsKeyword("endstream")) {
+                  loaded.data = ReadBytes(start, static_cast<size_t>(length));
+                  object.streamLength = loaded.data.size();
+                  return;
+              }
+          }
+          AddProblem("PDF stream length of object " + std::to_string(number) + " is wrong");
+          // Looks for endstream instead, a block at a time
+          std::vector<uint8_t> data;
+          for (uint64_t at = start; at < m_size && data.size() <= kMaxStreamLength; at += kBlockSize) {
+              std::vector<uint8_t> block = ReadBytes(at, kBlockSize);
+              size_t keep = data.size();
+              data.insert(data.end(), block.begin(), block.end());
+              size_t end = detail::FindBytes(data.data(), keep >= 8 ? keep - 8 : 0, data.size(), "endstream");
+              if (end < data.size()) {
+                  while (end > 0 && (data[end - 1] == '\n' || data[end - 1] == '\r')) {
+                      end--;
+                  }
+                  data.resize(end);
+                  loaded.data = std::move(data);
+                  object.streamLength = loaded.data.size();
+                  return;
+              }
+          }
+          throw PdfError("PDF stream of object " + std::to_string(number) + " has no end");
+      }
+
+      // nullptr for free, unknown and, once repaired, unreadable objects. Before a repair, throws
+      // PdfError when the cross-reference data leads somewhere wrong.
+      const PdfObject* Get(uint32_t number) {
+          if (m_table != nullptr) {
+              return m_table->Get(number);
+          }
+          auto cached = m_cache.find(number);
+          if (cached != m_cache.end()) {
+              return cached->second ? &cached->second->object : nullptr;
+          }
+          XrefEntry entry = Lookup(number);
+          std::unique_ptr<LoadedObject> loaded;
+          if (entry.kind == XrefEntry::Kind::InFile) {
+              if (entry.offset >= m_size) {
+                  throw PdfError("PDF object " + std::to_string(number) + " is out of bounds");
+              }
+              loaded = LoadObjectAt(entry.offset, number);
+          } else if (entry.kind == XrefEntry::Kind::Compressed) {
+              loaded = LoadCompressed(number, entry);
+          }
+          const PdfObject* result = loaded ? &loaded->object : nullptr;
+          m_cache[number] = std::move(loaded);
+          return result;
+      }
+
+      std::unique_ptr<LoadedObject> LoadCompressed(uint32_t number, XrefEntry const& entry) {
+          auto found = m_objectStreams.find(entry.objectStream);
+          if (found == m_objectStreams.end()) {
+              // Object streams are never compressed themselves, which also rules out loops
+              if (entry.objectStream == number || m_objectStreams.size() > 1024 || Lookup(entry.objectStream).kind != XrefEntry::Kind::InFile) {
+                  throw PdfError("PDF object stream " + std::to_string(entry.objectStream) + " is invalid");
+              }
+              const PdfObject* stream = Get(entry.objectStream);
+              const PdfObject* type = stream != nullptr ? stream->Find("Type") : nullptr;
+              const PdfObject* count = stream != nullptr ? stream->Find("N") : nullptr;
+              const PdfObject* first = stream != nullptr ? stream->Find("First") : nullptr;
+              if (stream == nullptr || stream->type != PdfObject::Type::Stream || type == nullptr || !type->IsName("ObjStm") || count == nullptr || first == nullptr
+                  || count->type != PdfObject::Type::Integer || first->type != PdfObject::Type::Integer || count->integer < 0 || first->integer < 0) {
+                  throw PdfError("PDF object stream " + std::to_string(entry.objectStream) + " is invalid");
+              }
+              ObjectStream decoded;
+              std::vector<uint8_t> const& data = m_cache[entry.objectStream]->data;
+              DecodePdfStream(data.data(), data.size(), *stream, decoded.data, kMaxStreamLength);
+              PdfLexer header(decoded.data.data(), decoded.data.size());
+              for (int64_t i = 0; i < count->integer; i++) {
+                  PdfToken objectNumber = header.Next();
+                  PdfToken offset = header.Next();
+                  if (objectNumber.type != PdfToken::Type::Integer || offset.type != PdfToken::Type::Integer || offset.integer < 0) {
+                      break;
+                  }
+                  decoded.offsets.push_back(static_cast<size_t>(std::min<uint64_t>(decoded.data.size(), static_cast<uint64_t>(first->integer) + static_cast<uint64_t>(offset.integer))));
+              }
+              found = m_objectStreams.emplace(entry.objectStream, std::move(decoded)).first;
+          }
+          ObjectStream const& stream = found->second;
+          if (entry.index >= stream.offsets.size()) {
+              throw PdfError("PDF object " + std::to_string(number) + " is missing from its object stream");
+          }
+          PdfParser parser(stream.data.data(), stream.data.size(), stream.offsets[entry.index]);
+          auto loaded = std::make_unique<LoadedObject>();
+          loaded->object = parser.ReadObject();
+          return loaded;
+      }
+
+      static PdfObject const& Null() noexcept {
+          static const PdfObject kNull;
+          return kNull;
+      }
+
+      PdfObject const& Resolve(PdfObject const& object) {
+          if (object.type != PdfObject::Type::Reference) {
+              return object;
+          }
+          const PdfObject* target = Get(object.reference.number);
+          return target != nullptr ? *target : Null();
+      }
+
+      // The decoded data of the stream `reference` points to
+      void DecodeReferencedStream(PdfObject const& reference, std::vector<uint8_t>& out) {
+          PdfObject const& stream = Resolve(reference);
+          if (stream.type != PdfObject::Type::Stream) {
+              throw PdfError("PDF stream is missing");
+          }
+          if (m_table != nullptr) {
+              DecodePdfStream(m_table->Data(), m_table->Size(), stream, out, kMaxStreamLength);
+              return;
+          }
+          // Read through the cross-reference data, so the cache holds its bytes
+          std::vector<uint8_t> const& data = m_cache.at(reference.reference.number)->data;
+          DecodePdfStream(data.data(), data.size(), stream, out, kMaxStreamLength);
+      }
+
+      PdfObject const& Trailer() const noexcept {
+          return m_table != nullptr ? m_table->Trailer() : m_trailer;
+      }
+
+      // Reads the whole file and finds its objects by scanning. Returns false when the file is
+      // too large to load.
+      bool Repair() {
+          if (m_size > kMaxRepairSize) {
+              AddProblem("PDF is too large to repair");
+              return false;
+          }
+          m_whole.resize(static_cast<size_t>(m_size));
+          m_whole.resize(m_source.ReadAt(0, m_whole.data(), m_whole.size()));
+          m_bytesRead += m_whole.size();
+          m_table = std::make_unique<PdfObjectTable>(m_whole.data(), m_whole.size());
+          m_table->Scan();
+          return true;
+      }
+
+      // A truncated file loses its trailer, and with it /Root; after a repair the catalog is
+      // the last object typed as one
+      PdfObject const& FindCatalog() {
+          if (m_table == nullptr) {
+              return Null();
+          }
+          std::vector<uint32_t> numbers = m_table->Numbers();
+          for (auto number = numbers.rbegin(); number != numbers.rend(); ++number) {
+              const PdfObject* object = m_table->Get(*number);
+              const PdfObject* type = object != nullptr ? object->Find("Type") : nullptr;
+              if (type != nullptr && type->type == PdfObject::Type::Name && type->text == "Catalog") {
+                  return *object;
+              }
+          }
+          return Null();
+      }
+
+      void ReadDocument(PdfStructure& result) {
+          PdfObject const& trailer = Trailer();
+          if (const PdfObject* encrypt = trailer.Find("Encrypt")) {
+              ReadEncryption(Resolve(*encrypt), result);
+          }
+
+          const PdfObject* rootReference = trailer.Find("Root");
+          PdfObject const& root = rootReference != nullptr ? Resolve(*rootReference) : FindCatalog();
+          if (!root.IsDictionary()) {
+              if (m_table == nullptr) {
+                  throw PdfError("PDF catalog is missing");
+              }
+              AddProblem("PDF catalog is missing");
+          }
+          if (const PdfObject* version = root.Find("Version"); version != nullptr && version->type == PdfObject::Type::Name && version->text > result.version && version->text.size() <= 8) {
+              result.version = version->text;
+          }
+
+          const PdfObject* pagesReference = root.Find("Pages");
+          PdfObject const& pages = pagesReference != nullptr ? Resolve(*pagesReference) : Null();
+          const PdfObject* count = pages.Find("Count");
+          if (count != nullptr && count->type == PdfObject::Type::Integer && count->integer >= 0) {
+              result.pageCount = count->integer;
+          } else if (root.IsDictionary()) {
+              if (m_table == nullptr) {
+                  throw PdfError("PDF page tree has no page count");
+              }
+              AddProblem("PDF page tree has no page count");
+          }
+          if (result.pageCount < 0 && m_linearizedPageCount >= 0) {
+              result.pageCount = m_linearizedPageCount;
+          } else if (result.pageCount >= 0 && m_linearizedPageCount >= 0 && result.pageCount != m_linearizedPageCount && m_sections.size() <= 2) {
+              AddProblem("PDF page count disagrees with its linearization dictionary");
+          }
+
+          // Strings of an encrypted file are ciphertext
+          bool metadataEncrypted = result.encrypted;
+          if (!result.encrypted) {
+              if (const PdfObject* infoReference = trailer.Find("Info")) {
+                  PdfObject const& info = Resolve(*infoReference);
+                  auto text = [&info, this](std::string_view key, bool date = false) {
+                      const PdfObject* value = info.Find(key);
+                      if (value == nullptr) {
+                          return std::string();
+                      }
+                      PdfObject const& resolved = Resolve(*value);
+                      if (resolved.type != PdfObject::Type::String) {
+                          return std::string();
+                      }
+                      std::string utf8 = detail::PdfTextStringToUtf8(resolved.text);
+                      return date ? detail::PdfDateToIso(utf8) : utf8;
+                  };
+                  result.title = text("Title");
+                  result.author = text("Author");
+                  result.subject = text("Subject");
+                  result.keywords = text("Keywords");
+                  result.creator = text("Creator");
+                  result.producer = text("Producer");
+                  result.creationDate = text("CreationDate", true);
+                  result.modificationDate = text("ModDate", true);
+              }
+          } else {
+              const PdfObject* encrypt = trailer.Find("Encrypt");
+              const PdfObject* encryptMetadata = encrypt != nullptr ? Resolve(*encrypt).Find("EncryptMetadata") : nullptr;
+              metadataEncrypted = encryptMetadata == nullptr || encryptMetadata->type != PdfObject::Type::Boolean || encryptMetadata->boolean;
+          }
+          if (const PdfObject* metadata = root.Find("Metadata"); metadata != nullptr && !metadataEncrypted) {
+              ReadXmp(*metadata, result);
+          }
+      }
+
+      void ReadEncryption(PdfObject const& encrypt, PdfStructure& result) {
+          result.encrypted = true;
+          if (!encrypt.IsDictionary()) {
+              AddProblem("PDF encryption dictionary is missing");
+              return;
+          }
+          auto integer = [&encrypt](std::string_view key, int64_t fallback) {
+              const PdfObject* value = encrypt.Find(key);
+              return value != nullptr && value->type == PdfObject::Type::Integer ? value->integer : fallback;
+          };
+          if (const PdfObject* filter = encrypt.Find("Filter"); filter != nullptr && filter->type == PdfObject::Type::Name) {
+              result.encryptionFilter = filter->text;
+          }
+          result.encryptionRevision = integer("R", 0);
+          result.encryptionKeyBits = integer("Length", integer("V", 0) >= 5 ? 256 : 40);
+          if (encrypt.Find("P") != nullptr) {
+              // A 32-bit mask, written signed or unsigned
+              uint32_t bits = static_cast<uint32_t>(integer("P", -1));
+              result.permissions = static_cast<int32_t>(bits);
+              result.canPrint = (bits & 0x4) != 0;
+              result.canModify = (bits & 0x8) != 0;
+              result.canCopy = (bits & 0x10) != 0;
+          }
+      }
+
+      void ReadXmp(PdfObject const& reference, PdfStructure& result) {
+          std::vector<uint8_t> xml;
+          try {
+              DecodeReferencedStream(reference, xml);
+          } catch (PdfError const&) {
+              AddProblem("PDF XMP metadata cannot be read");
+              return;
+          }
+          std::string_view xmp(reinterpret_cast<const char*>(xml.data()), xml.size());
+          if (xmp.find("<x:xmpmeta") == std::string_view::npos && xmp.find("<rdf:RDF") == std::string_view::npos) {
+              return;
+          }
+          result.hasXmpMetadata = true;
+          auto fill = [&xmp](std::string& field, std::string_view name) {
+              if (field.empty()) {
+                  field = detail::XmpProperty(xmp, name);
+              }
+          };
+          fill(result.title, "dc:title");
+          fill(result.author, "dc:creator");
+          fill(result.subject, "dc:description");
+          fill(result.keywords, "pdf:Keywords");
+          fill(result.creator, "xmp:CreatorTool");
+          fill(result.producer, "pdf:Producer");
+          fill(result.creationDate, "xmp:CreateDate");
+          fill(result.modificationDate, "xmp:ModifyDate");
+      }
+
+      RangeSource& m_source;
+      uint64_t m_size;
+      uint64_t m_bytesRead = 0;
+      std::unordered_map<uint64_t, std::vector<uint8_t>> m_blocks;
+      size_t m_headerOffset = 0;
+      // Added to table offsets when the file has bytes before its header and counts from it
+      uint64_t m_offsetShift = 0;
+      int64_t m_linearizedPageCount = -1;
+      // Newest first
+      std::vector<XrefSection> m_sections;
+      PdfObject m_trailer;
+      std::unordered_map<uint32_t, std::unique_ptr<LoadedObject>> m_cache;
+      std::unordered_map<uint32_t, ObjectStream> m_objectStreams;
+      int m_lengthDepth = 0;
+      std::vector<std::string> m_problems;
+      // Set once repaired: the whole file, and its objects as found by scanning
+      std::vector<uint8_t> m_whole;
+      std::unique_ptr<PdfObjectTable> m_table;
+  };
+
+  inline PdfStructure ReadPdfStructure(RangeSource& source) {
+      return PdfStructureReader(source).Read();
+  }
+}
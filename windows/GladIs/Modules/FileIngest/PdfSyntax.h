@@ -0,0 +1,890 @@
+#pragma once
+
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  // The file is not a PDF, or a part that was needed cannot be read
+  struct PdfError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  struct PdfReference
+  {
+      uint32_t number = 0;
+      uint32_t generation = 0;
+  };
+
+  // One PDF object. Dictionaries keep their keys in `keys` and the values at the same index of
+  // `items`. A stream is a dictionary whose data lies at [streamOffset, streamOffset +
+  // streamLength) of the buffer it was parsed from.
+  struct PdfObject
+  {
+      enum class Type
+      {
+          Null,
+          Boolean,
+          Integer,
+          Real,
+          // Bytes as stored, after escapes; the encoding is up to the reader
+          String,
+          // Without the slash, # escapes decoded
+          Name,
+          Array,
+          Dictionary,
+          Stream,
+          Reference,
+      };
+
+      Type type = Type::Null;
+      bool boolean = false;
+      int64_t integer = 0;
+      double real = 0;
+      std::string text;
+      std::vector<std::string> keys;
+      std::vector<PdfObject> items;
+      PdfReference reference;
+      size_t streamOffset = 0;
+      size_t streamLength = 0;
+
+      bool IsNull() const noexcept {
+          return type == Type::Null;
+      }
+
+      bool IsNumber() const noexcept {
+          return type == Type::Integer || type == Type::Real;
+      }
+
+      double Number() const noexcept {
+          return type == Type::Integer ? static_cast<double>(integer) : type == Type::Real ? real : 0;
+      }
+
+      bool IsName(std::string_view name) const noexcept {
+          return type == Type::Name && text == name;
+      }
+
+      bool IsDictionary() const noexcept {
+          return type == Type::Dictionary || type == Type::Stream;
+      }
+
+      // Value of `key` in a dictionary or stream; nullptr when absent or not a dictionary
+      const PdfObject* Find(std::string_view key) const noexcept {
+          if (!IsDictionary()) {
+              return nullptr;
+          }
+          for (size_t i = 0; i < keys.size(); i++) {
+              if (keys[i] == key) {
+                  return &items[i];
+              }
+          }
+          return nullptr;
+      }
+  };
+
+  struct PdfToken
+  {
+      enum class Type
+      {
+          End,
+          Integer,
+          Real,
+          String,
+          Name,
+          // Bare words: true, false, null, R, obj, stream, content stream operators...
+          Keyword,
+          ArrayStart,
+          ArrayEnd,
+          DictionaryStart,
+          DictionaryEnd,
+      };
+
+      Type type = Type::End;
+      int64_t integer = 0;
+      double real = 0;
+      std::string text;
+      // Where the token starts in the buffer
+      size_t offset = 0;
+
+      bool IsKeyword(std::string_view keyword) const noexcept {
+          return type == Type::Keyword && text == keyword;
+      }
+  };
+
+  namespace detail
+  {
+    inline bool IsPdfWhitespace(uint8_t c) noexcept {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == 0;
+    }
+
+    inline bool IsPdfDelimiter(uint8_t c) noexcept {
+        return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' || c == ']' || c == '{' || c == '}' || c == '/' || c == '%';
+    }
+
+    inline int HexDigitValue(uint8_t c) noexcept {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    // First occurrence of `needle` in [from, to) of `data`, or `to`
+    inline size_t FindBytes(const uint8_t* data, size_t from, size_t to, std::string_view needle) noexcept {
+        if (needle.empty() || to < needle.size()) {
+            return to;
+        }
+        size_t last = to - needle.size();
+        for (size_t i = from; i <= last;) {
+            auto* hit = static_cast<const uint8_t*>(std::memchr(data + i, needle[0], last - i + 1));
+            if (hit == nullptr) {
+                return to;
+            }
+            i = static_cast<size_t>(hit - data);
+            if (std::memcmp(data + i, needle.data(), needle.size()) == 0) {
+                return i;
+            }
+            i++;
+        }
+        return to;
+    }
+  }
+
+  // Splits PDF syntax, file structure and content streams alike, into tokens. Malformed input
+  // never throws: stray bytes come out as keywords and unterminated strings end at the buffer.
+  class PdfLexer
+  {
+  public:
+      PdfLexer(const uint8_t* data, size_t size, size_t position = 0) noexcept : m_data(data), m_size(size), m_position(std::min(position, size)) {}
+
+      size_t Position() const noexcept {
+          return m_position;
+      }
+
+      void Seek(size_t position) noexcept {
+          m_position = std::min(position, m_size);
+      }
+
+      const uint8_t* Data() const noexcept {
+          return m_data;
+      }
+
+      size_t Size() const noexcept {
+          return m_size;
+      }
+
+      void SkipWhitespace() noexcept {
+          while (m_position < m_size) {
+              uint8_t c = m_data[m_position];
+              if (detail::IsPdfWhitespace(c)) {
+                  m_position++;
+              } else if (c == '%') {
+                  while (m_position < m_size && m_data[m_position] != '\n' && m_data[m_position] != '\r') {
+                      m_position++;
+                  }
+              } else {
+                  break;
+              }
+          }
+      }
+
+      PdfToken Next() {
+          PdfToken token;
+          SkipWhitespace();
+          token.offset = m_position;
+          if (m_position >= m_size) {
+              return token;
+          }
+          uint8_t c = m_data[m_position];
+          if (c == '(') {
+              token.type = PdfToken::Type::String;
+              ReadLiteralString(token.text);
+          } else if (c == '<' && m_position + 1 < m_size && m_data[m_position + 1] == '<') {
+              token.type = PdfToken::Type::DictionaryStart;
+              m_position += 2;
+          } else if (c == '<') {
+              token.type = PdfToken::Type::String;
+              ReadHexString(token.text);
+          } else if (c == '>' && m_position + 1 < m_size && m_data[m_position + 1] == '>') {
+              token.type = PdfToken::Type::DictionaryEnd;
+              m_position += 2;
+          } else if (c == '[') {
+              token.type = PdfToken::Type::ArrayStart;
+              m_position++;
+          } else if (c == ']') {
+              token.type = PdfToken::Type::ArrayEnd;
+              m_position++;
+          } else if (c == '/') {
+              token.type = PdfToken::Type::Name;
+              m_position++;
+              ReadName(token.text);
+          } else if ((c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.') {
+              ReadNumber(token);
+          } else if (detail::IsPdfDelimiter(c)) {
+              // { } of PostScript functions, or a stray ) or >
+              token.type = PdfToken::Type::Keyword;
+              token.text.assign(1, static_cast<char>(c));
+              m_position++;
+          } else {
+              token.type = PdfToken::Type::Keyword;
+              size_t start = m_position;
+              while (m_position < m_size && !detail::IsPdfWhitespace(m_data[m_position]) && !detail::IsPdfDelimiter(m_data[m_position])) {
+                  m_position++;
+              }
+              token.text.assign(reinterpret_cast<const char*>(m_data + start), m_position - start);
+          }
+          return token;
+      }
+
+  private:
+      void ReadLiteralString(std::string& out) {
+          m_position++;
+          int depth = 1;
+          while (m_position < m_size) {
+              uint8_t c = m_data[m_position++];
+              if (c == '(') {
+                  depth++;
+              } else if (c == ')') {
+                  if (--depth == 0) {
+                      return;
+                  }
+              } else if (c == '\\' && m_position < m_size) {
+                  uint8_t escaped = m_data[m_position++];
+                  switch (escaped) {
+                  case 'n': out.push_back('\n'); continue;
+                  case 'r': out.push_back('\r'); continue;
+                  case 't': out.push_back('\t'); continue;
+                  case 'b': out.push_back('\b'); continue;
+                  case 'f': out.push_back('\f'); continue;
+                  case '\r':
+                      if (m_position < m_size && m_data[m_position] == '\n') {
+                          m_position++;
+                      }
+                      continue;
+                  case '\n':
+                      continue;
+                  default:
+                      break;
+                  }
+                  if (escaped >= '0' && escaped <= '7') {
+                      int value = escaped - '0';
+                      for (int digits = 1; digits < 3 && m_position < m_size && m_data[m_position] >= '0' && m_data[m_position] <= '7'; digits++) {
+                          value = value * 8 + (m_data[m_position++] - '0');
+                      }
+                      out.push_back(static_cast<char>(value & 0xFF));
+                  } else {
+                      out.push_back(static_cast<char>(escaped));
+                  }
+                  continue;
+              }
+              out.push_back(static_cast<char>(c));
+          }
+      }
+
+      void ReadHexString(std::string& out) {
+          m_position++;
+          int high = -1;
+          while (m_position < m_size) {
+              uint8_t c = m_data[m_position++];
+              if (c == '>') {
+                  break;
+              }
+              int value = detail::HexDigitValue(c);
+              if (value < 0) {
+                  continue;
+              }
+              if (high < 0) {
+                  high = value;
+              } else {
+                  out.push_back(static_cast<char>(high << 4 | value));
+                  high = -1;
+              }
+          }
+          if (high >= 0) {
+              out.push_back(static_cast<char>(high << 4));
+          }
+      }
+
+      void ReadName(std::string& out) {
+          while (m_position < m_size && !detail::IsPdfWhitespace(m_data[m_position]) && !detail::IsPdfDelimiter(m_data[m_position])) {
+              uint8_t c = m_data[m_position++];
+              if (c == '#' && m_position + 1 < m_size) {
+                  int high = detail::HexDigitValue(m_data[m_position]);
+                  int low = detail::HexDigitValue(m_data[m_position + 1]);
+                  if (high >= 0 && low >= 0) {
+                      out.push_back(static_cast<char>(high << 4 | low));
+                      m_position += 2;
+                      continue;
+                  }
+              }
+              out.push_back(static_cast<char>(c));
+          }
+      }
+
+      void ReadNumber(PdfToken& token) {
+          size_t start = m_position;
+          m_position++;
+          while (m_position < m_size && ((m_data[m_position] >= '0' && m_data[m_position] <= '9') || m_data[m_position] == '.')) {
+              m_position++;
+          }
+          std::string text(reinterpret_cast<const char*>(m_data + start), m_position - start);
+          bool real = text.find('.') != std::string::npos;
+          if (!real) {
+              char* end = nullptr;
+              errno = 0;
+              long long value = std::strtoll(text.c_str(), &end, 10);
+              if (errno == 0 && end != text.c_str() && *end == 0) {
+                  token.type = PdfToken::Type::Integer;
+                  token.integer = value;
+                  return;
+              }
+          }
+          // Reals, integers too large for 64 bits, and malformed numbers such as "--1" or "1.2.3",
+          // read as far as they make sense, as viewers do
+          token.type = PdfToken::Type::Real;
+          token.real = std::strtod(text.c_str(), nullptr);
+      }
+
+      const uint8_t* m_data;
+      size_t m_size;
+      size_t m_position;
+  };
+
+  // Builds objects from tokens. Nesting is limited so that hostile files cannot exhaust the stack.
+  class PdfParser
+  {
+  public:
+      static constexpr int kMaxDepth = 64;
+
+      PdfParser(const uint8_t* data, size_t size, size_t position = 0) noexcept : m_lexer(data, size, position) {}
+
+      PdfLexer& Lexer() noexcept {
+          return m_lexer;
+      }
+
+      PdfObject ReadObject() {
+          return ReadObject(m_lexer.Next(), 0);
+      }
+
+      // Continues an object whose first token the caller already read
+      PdfObject ReadObject(PdfToken token) {
+          return ReadObject(std::move(token), 0);
+      }
+
+      // "N G obj <object> endobj" at the current position. A stream's data is found from its
+      // /Length when that is direct and correct, and by looking for endstream otherwise.
+      PdfObject ReadIndirect(PdfReference* reference = nullptr) {
+          PdfToken number = m_lexer.Next();
+          PdfToken generation = m_lexer.Next();
+          PdfToken keyword = m_lexer.Next();
+          if (number.type != PdfToken::Type::Integer || generation.type != PdfToken::Type::Integer || !keyword.IsKeyword("obj")) {
+              throw PdfError("PDF object header is malformed");
+          }
+          if (reference != nullptr) {
+              reference->number = static_cast<uint32_t>(number.integer);
+              reference->generation = static_cast<uint32_t>(generation.integer);
+          }
+          PdfObject object = ReadObject();
+          if (object.type != PdfObject::Type::Dictionary) {
+              return object;
+          }
+          size_t afterDictionary = m_lexer.Position();
+          PdfToken next = m_lexer.Next();
+          if (!next.IsKeyword("stream")) {
+              m_lexer.Seek(afterDictionary);
+              return object;
+          }
+          const uint8_t* data = m_lexer.Data();
+          size_t size = m_lexer.Size();
+          size_t start = m_lexer.Position();
+          if (start < size && data[start] == '\r') {
+              start++;
+          }
+          if (start < size && data[start] == '\n') {
+              start++;
+          }
+          object.type = PdfObject::Type::Stream;
+          object.streamOffset = start;
+          const PdfObject* length = object.Find("Length");
+          if (length != nullptr && length->type == PdfObject::Type::Integer && length->integer >= 0 && static_cast<uint64_t>(length->integer) <= size - start) {
+              PdfLexer check(data, size, start + static_cast<size_t>(length->integer));
+              if (check.Next().IsKeyword("endstream")) {
+                  object.streamLength = static_cast<size_t>(length->integer);
+                  m_lexer.Seek(check.Position());
+                  return object;
+              }
+          }
+          size_t end = detail::FindBytes(data, start, size, "endstream");
+          size_t dataEnd = end;
+          if (dataEnd > start && data[dataEnd - 1] == '\n') {
+              dataEnd--;
+          }
+          if (dataEnd > start && data[dataEnd - 1] == '\r') {
+              dataEnd--;
+          }
+          object.streamLength = dataEnd - start;
+          m_lexer.Seek(std::min(size, end + 9));
+          return object;
+      }
+
+  private:
+      PdfObject ReadObject(PdfToken token, int depth) {
+          if (depth > kMaxDepth) {
+              throw PdfError("PDF objects are nested too deeply");
+          }
+          PdfObject object;
+          switch (token.type) {
+          case PdfToken::Type::End:
+              throw PdfError("PDF object is truncated");
+          case PdfToken::Type::Integer:
+              object.type = PdfObject::Type::Integer;
+              object.integer = token.integer;
+              ReadReference(object);
+              return object;
+          case PdfToken::Type::Real:
+              object.type = PdfObject::Type::Real;
+              object.real = token.real;
+              return object;
+          case PdfToken::Type::String:
+              object.type = PdfObject::Type::String;
+              object.text = std::move(token.text);
+              return object;
+          case PdfToken::Type::Name:
+              object.type = PdfObject::Type::Name;
+              object.text = std::move(token.text);
+              return object;
+          case PdfToken::Type::ArrayStart:
+              object.type = PdfObject::Type::Array;
+              for (;;) {
+                  PdfToken next = m_lexer.Next();
+                  if (next.type == PdfToken::Type::ArrayEnd) {
+                      return object;
+                  }
+                  if (next.type == PdfToken::Type::DictionaryEnd) {
+                      // Unbalanced; give the >> back to the enclosing dictionary
+                      m_lexer.Seek(next.offset);
+                      return object;
+                  }
+                  object.items.push_back(ReadObject(std::move(next), depth + 1));
+              }
+          case PdfToken::Type::DictionaryStart:
+              object.type = PdfObject::Type::Dictionary;
+              for (;;) {
+                  PdfToken key = m_lexer.Next();
+                  if (key.type == PdfToken::Type::DictionaryEnd) {
+                      return object;
+                  }
+                  if (key.type == PdfToken::Type::End) {
+                      throw PdfError("PDF dictionary is truncated");
+                  }
+                  if (key.type != PdfToken::Type::Name) {
+                      // Not a key: skip it, as viewers do
+                      continue;
+                  }
+                  PdfToken value = m_lexer.Next();
+                  if (value.type == PdfToken::Type::DictionaryEnd) {
+                      return object;
+                  }
+                  object.keys.push_back(std::move(key.text));
+                  object.items.push_back(ReadObject(std::move(value), depth + 1));
+              }
+          case PdfToken::Type::Keyword:
+              if (token.text == "true" || token.text == "false") {
+                  object.type = PdfObject::Type::Boolean;
+                  object.boolean = token.text == "true";
+              }
+              // null, and any other bare word where an object belongs, reads as null
+              return object;
+          default:
+              // A stray ] or >>
+              return object;
+          }
+      }
+
+      // "N G R" turns the integer just read into a reference
+      void ReadReference(PdfObject& object) {
+          if (object.integer < 0 || object.integer > UINT32_MAX) {
+              return;
+          }
+          size_t position = m_lexer.Position();
+          PdfToken generation = m_lexer.Next();
+          if (generation.type == PdfToken::Type::Integer && generation.integer >= 0 && generation.integer <= 65535) {
+              PdfToken keyword = m_lexer.Next();
+              if (keyword.IsKeyword("R")) {
+                  object.type = PdfObject::Type::Reference;
+                  object.reference.number = static_cast<uint32_t>(object.integer);
+                  object.reference.generation = static_cast<uint32_t>(generation.integer);
+                  return;
+              }
+          }
+          m_lexer.Seek(position);
+      }
+
+      PdfLexer m_lexer;
+  };
+
+  namespace detail
+  {
+    // Undoes the PNG row filters of /Predictor 10 to 15 in place: each row starts with a byte
+    // naming its filter, which reconstructs bytes from the ones left of and above them
+    inline void UndoPngPredictor(std::vector<uint8_t>& data, size_t columns, size_t colors, size_t bitsPerComponent) {
+        size_t bitsPerPixel = colors * bitsPerComponent;
+        size_t pixelBytes = std::max<size_t>(1, (bitsPerPixel + 7) / 8);
+        if (columns == 0 || bitsPerPixel == 0 || columns > (SIZE_MAX - 7) / bitsPerPixel) {
+            throw PdfError("PDF predictor parameters are invalid");
+        }
+        size_t rowLength = (columns * bitsPerPixel + 7) / 8;
+        size_t written = 0;
+        for (size_t at = 0; at < data.size(); at += rowLength + 1) {
+            uint8_t filter = data[at];
+            size_t length = std::min(rowLength, data.size() - at - 1);
+            // Rows move down by one byte as their filter bytes are dropped, so the row above
+            // is already in its final place
+            uint8_t* row = data.data() + written;
+            const uint8_t* above = written >= rowLength ? row - rowLength : nullptr;
+            std::memmove(row, data.data() + at + 1, length);
+            for (size_t i = 0; i < length; i++) {
+                int left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+                int up = above != nullptr ? above[i] : 0;
+                int upLeft = above != nullptr && i >= pixelBytes ? above[i - pixelBytes] : 0;
+                switch (filter) {
+                case 0:
+                    break;
+                case 1:
+                    row[i] = static_cast<uint8_t>(row[i] + left);
+                    break;
+                case 2:
+                    row[i] = static_cast<uint8_t>(row[i] + up);
+                    break;
+                case 3:
+                    row[i] = static_cast<uint8_t>(row[i] + (left + up) / 2);
+                    break;
+                case 4: {
+                    int estimate = left + up - upLeft;
+                    int toLeft = std::abs(estimate - left);
+                    int toUp = std::abs(estimate - up);
+                    int toUpLeft = std::abs(estimate - upLeft);
+                    row[i] = static_cast<uint8_t>(row[i] + (toLeft <= toUp && toLeft <= toUpLeft ? left : toUp <= toUpLeft ? up : upLeft));
+                    break;
+                }
+                default:
+                    throw PdfError("PDF predictor row filter is invalid");
+                }
+            }
+            written += length;
+        }
+        data.resize(written);
+    }
+
+    // The stream data through its /Filter, before any predictor
+    inline void DecodePdfFilters(const uint8_t* bytes, size_t length, PdfObject const& stream, std::vector<uint8_t>& out, size_t maxOutput) {
+        std::vector<std::string> filters;
+        if (const PdfObject* filter = stream.Find("Filter")) {
+            if (filter->type == PdfObject::Type::Name) {
+                filters.push_back(filter->text);
+            } else if (filter->type == PdfObject::Type::Array) {
+                for (PdfObject const& item : filter->items) {
+                    filters.push_back(item.text);
+                }
+            }
+        }
+        if (filters.empty()) {
+            out.assign(bytes, bytes + std::min(length, maxOutput));
+            return;
+        }
+        if (filters.size() > 1 || (filters[0] != "FlateDecode" && filters[0] != "Fl")) {
+            throw PdfError("PDF stream filter is not supported: " + filters[0]);
+        }
+        try {
+            Deflate::Inflate(bytes, length, Deflate::Framing::Zlib, out, maxOutput);
+        } catch (InflateError const&) {
+            if (!out.empty()) {
+                return;
+            }
+            try {
+                Deflate::Inflate(bytes, length, Deflate::Framing::Raw, out, maxOutput);
+            } catch (InflateError const& e) {
+                if (out.empty()) {
+                    throw PdfError(std::string("PDF stream cannot be decoded: ") + e.what());
+                }
+            }
+        }
+    }
+  }
+
+  // Decodes a stream's data into `out`. Only FlateDecode is supported, the filter of nearly every
+  // stream a PDF writer produces, with the PNG predictors of its /DecodeParms. A damaged stream
+  // keeps what could be decoded, and a stream missing its zlib wrapper is read as raw deflate, as
+  // viewers do. Throws PdfError for other filters and when nothing at all could be decoded.
+  inline void DecodePdfStream(const uint8_t* data, size_t size, PdfObject const& stream, std::vector<uint8_t>& out, size_t maxOutput = SIZE_MAX) {
+      out.clear();
+      if (stream.type != PdfObject::Type::Stream || stream.streamOffset > size || stream.streamLength > size - stream.streamOffset) {
+          throw PdfError("PDF stream is out of bounds");
+      }
+      detail::DecodePdfFilters(data + stream.streamOffset, stream.streamLength, stream, out, maxOutput);
+      const PdfObject* parameters = stream.Find("DecodeParms");
+      if (parameters != nullptr && parameters->type == PdfObject::Type::Array && parameters->items.size() == 1) {
+          parameters = &parameters->items[0];
+      }
+      const PdfObject* predictor = parameters != nullptr ? parameters->Find("Predictor") : nullptr;
+      if (predictor == nullptr || !predictor->IsNumber() || predictor->Number() <= 1) {
+          return;
+      }
+      if (predictor->Number() < 10) {
+          throw PdfError("PDF stream predictor is not supported");
+      }
+      auto parameter = [parameters](std::string_view key, double fallback) {
+          const PdfObject* value = parameters->Find(key);
+          return static_cast<size_t>(value != nullptr && value->IsNumber() && value->Number() >= 0 && value->Number() <= 1e6 ? value->Number() : fallback);
+      };
+      detail::UndoPngPredictor(out, parameter("Columns", 1), parameter("Colors", 1), parameter("BitsPerComponent", 8));
+  }
+
+  // Where each object of a file is and, once read, the object itself. The table is built by
+  // scanning the whole file for "N G obj", which also recovers files whose cross-reference
+  // table is missing or wrong. Later definitions of a number replace earlier ones, as
+  // incremental updates do. Objects packed in object streams are listed too.
+  class PdfObjectTable
+  {
+  public:
+      // Object streams inflate to at most this much each
+      static constexpr size_t kMaxObjectStreamSize = 64 * 1024 * 1024;
+
+      PdfObjectTable(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+      PdfObjectTable(PdfObjectTable const&) = delete;
+      PdfObjectTable& operator=(PdfObjectTable const&) = delete;
+
+      const uint8_t* Data() const noexcept {
+          return m_data;
+      }
+
+      size_t Size() const noexcept {
+          return m_size;
+      }
+
+      void Scan() {
+          std::vector<uint32_t> objectStreams;
+          for (size_t at = detail::FindBytes(m_data, 0, m_size, "obj"); at < m_size; at = detail::FindBytes(m_data, at + 3, m_size, "obj")) {
+              size_t start = 0;
+              uint32_t number = 0;
+              if (!ParseHeaderBefore(at, start, number)) {
+                  continue;
+              }
+              Location& location = m_locations[number];
+              location = Location{ start, 0, 0, false };
+              m_cache.erase(number);
+              // Cheap look at the dictionary before parsing objects that may matter for the structure
+              size_t window = std::min(m_size, at + 1024);
+              size_t streamAt = detail::FindBytes(m_data, at, window, "stream");
+              if (detail::FindBytes(m_data, at, streamAt, "/ObjStm") < streamAt) {
+                  objectStreams.push_back(number);
+              } else if (detail::FindBytes(m_data, at, streamAt, "/XRef") < streamAt) {
+                  if (const PdfObject* object = Get(number)) {
+                      m_trailer = *object;
+                      m_trailer.type = PdfObject::Type::Dictionary;
+                  }
+              }
+          }
+          for (size_t at = detail::FindBytes(m_data, 0, m_size, "trailer"); at < m_size; at = detail::FindBytes(m_data, at + 7, m_size, "trailer")) {
+              try {
+                  PdfParser parser(m_data, m_size, at + 7);
+                  PdfObject trailer = parser.ReadObject();
+                  if (trailer.type == PdfObject::Type::Dictionary) {
+                      m_trailer = std::move(trailer);
+                  }
+              } catch (PdfError const&) {
+              }
+          }
+          for (uint32_t number : objectStreams) {
+              IndexObjectStream(number);
+          }
+      }
+
+      // The last trailer dictionary, or cross-reference stream dictionary, of the file
+      PdfObject const& Trailer() const noexcept {
+          return m_trailer;
+      }
+
+      // nullptr when the number is unknown or the object cannot be read
+      const PdfObject* Get(uint32_t number) {
+          auto cached = m_cache.find(number);
+          if (cached != m_cache.end()) {
+              return cached->second.get();
+          }
+          auto found = m_locations.find(number);
+          if (found == m_locations.end()) {
+              return nullptr;
+          }
+          std::unique_ptr<PdfObject> object;
+          try {
+              object = std::make_unique<PdfObject>(Load(found->second));
+          } catch (PdfError const&) {
+          } catch (InflateError const&) {
+          }
+          const PdfObject* result = object.get();
+          m_cache[number] = std::move(object);
+          return result;
+      }
+
+      // The object a reference points to, or `object` itself when it is not a reference
+      PdfObject const& Resolve(PdfObject const& object) {
+          static const PdfObject kNull;
+          if (object.type != PdfObject::Type::Reference) {
+              return object;
+          }
+          const PdfObject* target = Get(object.reference.number);
+          return target != nullptr ? *target : kNull;
+      }
+
+      // Every object number found, in ascending order
+      std::vector<uint32_t> Numbers() const {
+          std::vector<uint32_t> numbers;
+          numbers.reserve(m_locations.size());
+          for (auto const& entry : m_locations) {
+              numbers.push_back(entry.first);
+          }
+          std::sort(numbers.begin(), numbers.end());
+          return numbers;
+      }
+
+  private:
+      struct Location
+      {
+          // Of the object's header, or of the object stream holding it
+          size_t offset;
+          uint32_t objectStream;
+          uint32_t index;
+          bool compressed;
+      };
+
+      struct ObjectStream
+      {
+          std::vector<uint8_t> data;
+          // Where each packed object starts in `data`
+          std::vector<size_t> offsets;
+      };
+
+      // Looks back from "obj" at `at` for "<number> <generation> " at the start of a line or
+      // after whitespace
+      bool ParseHeaderBefore(size_t at, size_t& start, uint32_t& number) const noexcept {
+          if (at + 3 < m_size && !detail::IsPdfWhitespace(m_data[at + 3]) && !detail::IsPdfDelimiter(m_data[at + 3])) {
+              return false;
+          }
+          size_t i = at;
+          auto skipSpaces = [&]() {
+              size_t before = i;
+              while (i > 0 && detail::IsPdfWhitespace(m_data[i - 1])) {
+                  i--;
+              }
+              return i < before;
+          };
+          auto digits = [&]() {
+              size_t end = i;
+              while (i > 0 && m_data[i - 1] >= '0' && m_data[i - 1] <= '9' && end - i < 10) {
+                  i--;
+              }
+              return end - i;
+          };
+          if (!skipSpaces() || digits() == 0 || !skipSpaces()) {
+              return false;
+          }
+          size_t numberEnd = i;
+          size_t numberLength = digits();
+          if (numberLength == 0 || (i > 0 && !detail::IsPdfWhitespace(m_data[i - 1]) && !detail::IsPdfDelimiter(m_data[i - 1]))) {
+              return false;
+          }
+          uint64_t value = 0;
+          for (size_t k = i; k < numberEnd; k++) {
+              value = value * 10 + (m_data[k] - '0');
+          }
+          if (value > UINT32_MAX) {
+              return false;
+          }
+          start = i;
+          number = static_cast<uint32_t>(value);
+          return true;
+      }
+
+      PdfObject Load(Location const& location) {
+          if (!location.compressed) {
+              PdfParser parser(m_data, m_size, location.offset);
+              return parser.ReadIndirect();
+          }
+          ObjectStream const& stream = m_objectStreams.at(location.objectStream);
+          if (location.index >= stream.offsets.size()) {
+              throw PdfError("PDF object stream index is out of range");
+          }
+          PdfParser parser(stream.data.data(), stream.data.size(), stream.offsets[location.index]);
+          return parser.ReadObject();
+      }
+
+      void IndexObjectStream(uint32_t number) {
+          auto found = m_locations.find(number);
+          if (found == m_locations.end() || found->second.compressed) {
+              return;
+          }
+          size_t position = found->second.offset;
+          ObjectStream stream;
+          std::vector<uint32_t> numbers;
+          try {
+              PdfParser parser(m_data, m_size, position);
+              PdfObject object = parser.ReadIndirect();
+              const PdfObject* count = object.Find("N");
+              const PdfObject* first = object.Find("First");
+              if (!object.Find("Type") || !object.Find("Type")->IsName("ObjStm") || count == nullptr || first == nullptr || count->integer < 0 || first->integer < 0) {
+                  return;
+              }
+              DecodePdfStream(m_data, m_size, object, stream.data, kMaxObjectStreamSize);
+              PdfLexer header(stream.data.data(), stream.data.size());
+              for (int64_t i = 0; i < count->integer; i++) {
+                  PdfToken objectNumber = header.Next();
+                  PdfToken offset = header.Next();
+                  if (objectNumber.type != PdfToken::Type::Integer || offset.type != PdfToken::Type::Integer || objectNumber.integer < 0 || objectNumber.integer > UINT32_MAX || offset.integer < 0) {
+                      break;
+                  }
+                  numbers.push_back(static_cast<uint32_t>(objectNumber.integer));
+                  stream.offsets.push_back(std::min(stream.data.size(), static_cast<size_t>(first->integer + offset.integer)));
+              }
+          } catch (PdfError const&) {
+              return;
+          }
+          for (uint32_t index = 0; index < numbers.size(); index++) {
+              // A direct definition after the object stream belongs to a later update
+              auto existing = m_locations.find(numbers[index]);
+              if (existing != m_locations.end() && existing->second.offset > position) {
+                  continue;
+              }
+              m_locations[numbers[index]] = Location{ position, number, index, true };
+              m_cache.erase(numbers[index]);
+          }
+          m_objectStreams[number] = std::move(stream);
+      }
+
+      const uint8_t* m_data;
+      size_t m_size;
+      std::unordered_map<uint32_t, Location> m_locations;
+      std::unordered_map<uint32_t, ObjectStream> m_objectStreams;
+      std::unordered_map<uint32_t, std::unique_ptr<PdfObject>> m_cache;
+      PdfObject m_trailer;
+  };
+}
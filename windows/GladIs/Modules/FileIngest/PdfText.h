@@ -0,0 +1,522 @@
+#pragma once
+
+#include "Json.h"
+#include "PdfSyntax.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace FileIngest
+{
+  namespace detail
+  {
+    // UTF-16BE, as ToUnicode maps and text strings with a byte order mark hold it
+    inline std::string Utf16BeToUtf8(std::string_view bytes) {
+        std::string out;
+        for (size_t i = 0; i + 1 < bytes.size(); i += 2) {
+            uint32_t unit = uint32_t(uint8_t(bytes[i])) << 8 | uint8_t(bytes[i + 1]);
+            if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < bytes.size()) {
+                uint32_t low = uint32_t(uint8_t(bytes[i + 2])) << 8 | uint8_t(bytes[i + 3]);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    AppendUtf8(out, 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+                    i += 2;
+                    continue;
+                }
+            }
+            AppendUtf8(out, unit >= 0xD800 && unit < 0xE000 ? 0xFFFD : unit);
+        }
+        return out;
+    }
+
+    // WinAnsiEncoding, the encoding of standard fonts without an /Encoding of their own in
+    // practice: Latin-1 with typographic punctuation and a few letters in 0x80-0x9F
+    inline uint32_t WinAnsiToUnicode(uint8_t c) noexcept {
+        static constexpr uint16_t kHigh[32] = {
+            0x20AC, 0x0020, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x0020, 0x017D, 0x0020,
+            0x0020, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x0020, 0x017E, 0x0178,
+        };
+        if (c >= 0x80 && c < 0xA0) {
+            return kHigh[c - 0x80];
+        }
+        return c < 0x20 ? 0x20 : c;
+    }
+
+    // Unicode for the glyph names /Differences arrays commonly use: plain letters and digits,
+    // uniXXXX, punctuation, and accented letters, which come out as the letter followed by a
+    // combining mark
+    inline std::string GlyphNameToUtf8(std::string_view name) {
+        static const std::unordered_map<std::string_view, uint32_t> kNamed = {
+            { "space", ' ' }, { "period", '.' }, { "comma", ',' }, { "colon", ':' }, { "semicolon", ';' },
+            { "hyphen", '-' }, { "quoteright", 0x2019 }, { "quotesingle", '\'' }, { "quoteleft", 0x2018 },
+            { "parenleft", '(' }, { "parenright", ')' }, { "slash", '/' }, { "question", '?' }, { "exclam", '!' },
+            { "zero", '0' }, { "one", '1' }, { "two", '2' }, { "three", '3' }, { "four", '4' },
+            { "five", '5' }, { "six", '6' }, { "seven", '7' }, { "eight", '8' }, { "nine", '9' },
+            { "oe", 0x0153 }, { "OE", 0x0152 }, { "ae", 0x00E6 }, { "AE", 0x00C6 }, { "germandbls", 0x00DF },
+            { "fi", 0xFB01 }, { "fl", 0xFB02 }, { "endash", 0x2013 }, { "emdash", 0x2014 }, { "Euro", 0x20AC },
+        };
+        static const std::pair<std::string_view, uint32_t> kMarks[] = {
+            { "acute", 0x0301 }, { "grave", 0x0300 }, { "circumflex", 0x0302 }, { "dieresis", 0x0308 },
+            { "cedilla", 0x0327 }, { "tilde", 0x0303 }, { "ring", 0x030A }, { "caron", 0x030C },
+        };
+        std::string out;
+        if (name.size() == 1 && ((name[0] >= 'a' && name[0] <= 'z') || (name[0] >= 'A' && name[0] <= 'Z'))) {
+            out.push_back(name[0]);
+            return out;
+        }
+        auto named = kNamed.find(name);
+        if (named != kNamed.end()) {
+            AppendUtf8(out, named->second);
+            return out;
+        }
+        if (name.size() == 7 && name.substr(0, 3) == "uni") {
+            uint32_t value = 0;
+            for (char c : name.substr(3)) {
+                int digit = HexDigitValue(static_cast<uint8_t>(c));
+                if (digit < 0) {
+                    return out;
+                }
+                value = value << 4 | static_cast<uint32_t>(digit);
+            }
+            AppendUtf8(out, value);
+            return out;
+        }
+        for (auto const& mark : kMarks) {
+            if (name.size() == mark.first.size() + 1 && name.substr(1) == mark.first) {
+                out.push_back(name[0]);
+                AppendUtf8(out, mark.second);
+                return out;
+            }
+        }
+        return out;
+    }
+
+    // How one font's character codes become text: a ToUnicode CMap when the font has one,
+    // otherwise its /Differences over WinAnsi for simple fonts. Composite fonts without a
+    // ToUnicode map use glyph ids that carry no text and produce nothing.
+    class PdfFontDecoder
+    {
+    public:
+        static constexpr size_t kMaxRangeLength = 1 << 16;
+
+        void Load(PdfObjectTable& objects, PdfObject const& font) {
+            if (const PdfObject* subtype = font.Find("Subtype"); subtype != nullptr && subtype->IsName("Type0")) {
+                m_codeBytes = 2;
+                m_composite = true;
+            }
+            if (const PdfObject* toUnicode = font.Find("ToUnicode")) {
+                PdfObject const& stream = objects.Resolve(*toUnicode);
+                if (stream.type == PdfObject::Type::Stream) {
+                    try {
+                        std::vector<uint8_t> data;
+                        DecodePdfStream(objects.Data(), objects.Size(), stream, data, 16 * 1024 * 1024);
+                        LoadCMap(data);
+                    } catch (PdfError const&) {
+                    }
+                }
+            }
+            if (m_composite || m_hasCMap) {
+                return;
+            }
+            if (const PdfObject* encoding = font.Find("Encoding")) {
+                PdfObject const& resolved = objects.Resolve(*encoding);
+                if (const PdfObject* differences = resolved.Find("Differences"); differences != nullptr && differences->type == PdfObject::Type::Array) {
+                    int64_t code = 0;
+                    for (PdfObject const& item : differences->items) {
+                        if (item.type == PdfObject::Type::Integer) {
+                            code = item.integer;
+                        } else if (item.type == PdfObject::Type::Name && code >= 0 && code < 256) {
+                            std::string text = GlyphNameToUtf8(item.text);
+                            if (!text.empty()) {
+                                m_codes[static_cast<uint32_t>(code)] = std::move(text);
+                            }
+                            code++;
+                        }
+                    }
+                }
+            }
+        }
+
+        void Append(std::string_view bytes, std::string& out) const {
+            for (size_t i = 0; i + m_codeBytes <= bytes.size(); i += m_codeBytes) {
+                uint32_t code = 0;
+                for (int k = 0; k < m_codeBytes; k++) {
+                    code = code << 8 | static_cast<uint8_t>(bytes[i + k]);
+                }
+                auto found = m_codes.find(code);
+                if (found != m_codes.end()) {
+                    out += found->second;
+                    continue;
+                }
+                if (m_hasCMap) {
+                    AppendFromRanges(code, out);
+                } else if (!m_composite) {
+                    AppendUtf8(out, WinAnsiToUnicode(static_cast<uint8_t>(code)));
+                }
+            }
+        }
+
+    private:
+        struct Range
+        {
+            uint32_t low;
+            uint32_t high;
+            // UTF-16BE of `low`; later codes add to its last unit
+            std::string start;
+        };
+
+        void LoadCMap(std::vector<uint8_t> const& data) {
+            PdfParser parser(data.data(), data.size());
+            PdfLexer& lexer = parser.Lexer();
+            std::vector<PdfObject> operands;
+            bool codeBytesSet = false;
+            for (PdfToken token = lexer.Next(); token.type != PdfToken::Type::End; token = lexer.Next()) {
+                if (token.type != PdfToken::Type::Keyword) {
+                    operands.push_back(parser.ReadObject(std::move(token)));
+                    continue;
+                }
+                if (token.text == "endcodespacerange" && !codeBytesSet && !operands.empty() && operands[0].type == PdfObject::Type::String) {
+                    m_codeBytes = static_cast<int>(std::clamp<size_t>(operands[0].text.size(), 1, 4));
+                    codeBytesSet = true;
+                } else if (token.text == "endbfchar") {
+                    for (size_t i = 0; i + 1 < operands.size(); i += 2) {
+                        if (operands[i].type == PdfObject::Type::String && operands[i + 1].type == PdfObject::Type::String) {
+                            m_codes[CodeOf(operands[i].text)] = Utf16BeToUtf8(operands[i + 1].text);
+                        }
+                    }
+                    m_hasCMap = true;
+                } else if (token.text == "endbfrange") {
+                    for (size_t i = 0; i + 2 < operands.size(); i += 3) {
+                        if (operands[i].type != PdfObject::Type::String || operands[i + 1].type != PdfObject::Type::String) {
+                            continue;
+                        }
+                        uint32_t low = CodeOf(operands[i].text);
+                        uint32_t high = CodeOf(operands[i + 1].text);
+                        if (high < low) {
+                            continue;
+                        }
+                        PdfObject const& target = operands[i + 2];
+                        if (target.type == PdfObject::Type::String) {
+                            m_ranges.push_back(Range{ low, high, target.text });
+                        } else if (target.type == PdfObject::Type::Array) {
+                            for (size_t k = 0; k < target.items.size() && k <= high - low && k < kMaxRangeLength; k++) {
+                                m_codes[low + static_cast<uint32_t>(k)] = Utf16BeToUtf8(target.items[k].text);
+                            }
+                        }
+                    }
+                    m_hasCMap = true;
+                }
+                if (token.text.rfind("begin", 0) == 0 || token.text.rfind("end", 0) == 0) {
+                    operands.clear();
+                }
+            }
+            std::sort(m_ranges.begin(), m_ranges.end(), [](Range const& a, Range const& b) { return a.low < b.low; });
+        }
+
+        void AppendFromRanges(uint32_t code, std::string& out) const {
+            auto after = std::upper_bound(m_ranges.begin(), m_ranges.end(), code, [](uint32_t value, Range const& range) { return value < range.low; });
+            if (after == m_ranges.begin()) {
+                return;
+            }
+            Range const& range = *(after - 1);
+            if (code > range.high || range.start.size() < 2) {
+                return;
+            }
+            std::string units = range.start;
+            uint32_t last = uint32_t(uint8_t(units[units.size() - 2])) << 8 | uint8_t(units[units.size() - 1]);
+            last += code - range.low;
+            units[units.size() - 2] = static_cast<char>(last >> 8 & 0xFF);
+            units[units.size() - 1] = static_cast<char>(last & 0xFF);
+            out += Utf16BeToUtf8(units);
+        }
+
+        static uint32_t CodeOf(std::string const& bytes) noexcept {
+            uint32_t code = 0;
+            for (size_t i = 0; i < bytes.size() && i < 4; i++) {
+                code = code << 8 | static_cast<uint8_t>(bytes[i]);
+            }
+            return code;
+        }
+
+        int m_codeBytes = 1;
+        bool m_composite = false;
+        bool m_hasCMap = false;
+        std::unordered_map<uint32_t, std::string> m_codes;
+        std::vector<Range> m_ranges;
+    };
+
+    // Walks content streams and collects the text their show-text operators draw, in stream
+    // order. Line moves become line breaks and wide TJ gaps become spaces, which is what word
+    // search needs; layout is not reconstructed.
+    class PdfTextCollector
+    {
+    public:
+        static constexpr int kMaxFormDepth = 8;
+        static constexpr size_t kMaxStreamSize = 64 * 1024 * 1024;
+
+        PdfTextCollector(PdfObjectTable& objects, std::string& out, size_t maxText) : m_objects(objects), m_out(out), m_maxText(maxText) {}
+
+        bool Full() const noexcept {
+            return m_out.size() >= m_maxText;
+        }
+
+        void Run(PdfObject const& contents, PdfObject const* resources, int depth) {
+            PdfObject const& resolved = m_objects.Resolve(contents);
+            std::vector<const PdfObject*> streams;
+            if (resolved.type == PdfObject::Type::Stream) {
+                streams.push_back(&resolved);
+            } else if (resolved.type == PdfObject::Type::Array) {
+                for (PdfObject const& item : resolved.items) {
+                    PdfObject const& part = m_objects.Resolve(item);
+                    if (part.type == PdfObject::Type::Stream) {
+                        streams.push_back(&part);
+                    }
+                }
+            }
+            // A page's content may be split across streams at any token, so they are joined first
+            std::vector<uint8_t> joined;
+            std::vector<uint8_t> decoded;
+            for (const PdfObject* stream : streams) {
+                try {
+                    DecodePdfStream(m_objects.Data(), m_objects.Size(), *stream, decoded, kMaxStreamSize);
+                } catch (PdfError const&) {
+                    continue;
+                }
+                joined.insert(joined.end(), decoded.begin(), decoded.end());
+                joined.push_back('\n');
+            }
+            Interpret(joined, resources, depth);
+        }
+
+    private:
+        void Interpret(std::vector<uint8_t> const& content, PdfObject const* resources, int depth) {
+            PdfParser parser(content.data(), content.size());
+            PdfLexer& lexer = parser.Lexer();
+            std::vector<PdfObject> operands;
+            const PdfFontDecoder* font = nullptr;
+            try {
+                for (PdfToken token = lexer.Next(); token.type != PdfToken::Type::End && !Full(); token = lexer.Next()) {
+                    if (token.type != PdfToken::Type::Keyword) {
+                        if (operands.size() < 64) {
+                            operands.push_back(parser.ReadObject(std::move(token)));
+                        } else {
+                            parser.ReadObject(std::move(token));
+                        }
+                        continue;
+                    }
+                    std::string const& op = token.text;
+                    if (op == "Tj" && !operands.empty()) {
+                        Show(font, operands.back());
+                    } else if (op == "TJ" && !operands.empty() && operands.back().type == PdfObject::Type::Array) {
+                        for (PdfObject const& item : operands.back().items) {
+                            if (item.type == PdfObject::Type::String) {
+                                Show(font, item);
+                            } else if (item.IsNumber() && item.Number() < -180) {
+                                // A gap of more than about a fifth of the font size separates words
+                                Separate(' ');
+                            }
+                        }
+                    } else if ((op == "'" || op == "\"") && !operands.empty()) {
+                        Separate('\n');
+                        Show(font, operands.back());
+                    } else if (op == "Td" || op == "TD") {
+                        Separate(operands.size() == 2 && operands[1].Number() != 0 ? '\n' : ' ');
+                    } else if (op == "T*" || op == "Tm" || op == "BT" || op == "ET") {
+                        Separate('\n');
+                    } else if (op == "Tf" && operands.size() == 2 && operands[0].type == PdfObject::Type::Name) {
+                        font = FontFor(resources, operands[0].text);
+                    } else if (op == "Do" && operands.size() == 1 && operands[0].type == PdfObject::Type::Name && depth < kMaxFormDepth) {
+                        RunForm(resources, operands[0].text, depth);
+                    } else if (op == "BI") {
+                        SkipInlineImage(lexer, content);
+                    }
+                    operands.clear();
+                }
+            } catch (PdfError const&) {
+                // A broken content stream keeps the text read before the damage
+            }
+        }
+
+        void Show(const PdfFontDecoder* font, PdfObject const& string) {
+            if (string.type != PdfObject::Type::String) {
+                return;
+            }
+            if (font != nullptr) {
+                font->Append(string.text, m_out);
+            } else {
+                for (char c : string.text) {
+                    AppendUtf8(m_out, WinAnsiToUnicode(static_cast<uint8_t>(c)));
+                }
+            }
+        }
+
+        void Separate(char separator) {
+            if (m_out.empty() || m_out.back() == '\n' || (m_out.back() == ' ' && separator == ' ')) {
+                return;
+            }
+            if (m_out.back() == ' ') {
+                m_out.back() = separator;
+                return;
+            }
+            m_out.push_back(separator);
+        }
+
+        const PdfObject* ResourceEntry(PdfObject const* resources, std::string_view category, std::string const& name) {
+            if (resources == nullptr) {
+                return nullptr;
+            }
+            const PdfObject* entries = resources->Find(category);
+            if (entries == nullptr) {
+                return nullptr;
+            }
+            const PdfObject* entry = m_objects.Resolve(*entries).Find(name);
+            return entry != nullptr ? &m_objects.Resolve(*entry) : nullptr;
+        }
+
+        const PdfFontDecoder* FontFor(PdfObject const* resources, std::string const& name) {
+            const PdfObject* font = ResourceEntry(resources, "Font", name);
+            if (font == nullptr || !font->IsDictionary()) {
+                return nullptr;
+            }
+            auto found = m_fonts.find(font);
+            if (found == m_fonts.end()) {
+                found = m_fonts.emplace(font, PdfFontDecoder()).first;
+                found->second.Load(m_objects, *font);
+            }
+            return &found->second;
+        }
+
+        void RunForm(PdfObject const* resources, std::string const& name, int depth) {
+            const PdfObject* form = ResourceEntry(resources, "XObject", name);
+            if (form == nullptr || form->type != PdfObject::Type::Stream) {
+                return;
+            }
+            const PdfObject* subtype = form->Find("Subtype");
+            if (subtype == nullptr || !subtype->IsName("Form") || !m_running.insert(form).second) {
+                return;
+            }
+            const PdfObject* formResources = resources;
+            if (const PdfObject* own = form->Find("Resources")) {
+                formResources = &m_objects.Resolve(*own);
+            }
+            std::vector<uint8_t> decoded;
+            try {
+                DecodePdfStream(m_objects.Data(), m_objects.Size(), *form, decoded, kMaxStreamSize);
+                Separate('\n');
+                Interpret(decoded, formResources, depth + 1);
+            } catch (PdfError const&) {
+            }
+            m_running.erase(form);
+        }
+
+        // Inline image data follows ID and runs to an EI surrounded by whitespace
+        static void SkipInlineImage(PdfLexer& lexer, std::vector<uint8_t> const& content) {
+            for (PdfToken token = lexer.Next(); token.type != PdfToken::Type::End; token = lexer.Next()) {
+                if (token.IsKeyword("ID")) {
+                    break;
+                }
+            }
+            size_t at = lexer.Position() + 1;
+            while (at < content.size()) {
+                at = FindBytes(content.data(), at, content.size(), "EI");
+                if (at >= content.size()) {
+                    break;
+                }
+                bool before = IsPdfWhitespace(content[at - 1]);
+                bool after = at + 2 >= content.size() || IsPdfWhitespace(content[at + 2]);
+                if (before && after) {
+                    lexer.Seek(at + 2);
+                    return;
+                }
+                at += 2;
+            }
+            lexer.Seek(content.size());
+        }
+
+        PdfObjectTable& m_objects;
+        std::string& m_out;
+        size_t m_maxText;
+        std::unordered_map<const PdfObject*, PdfFontDecoder> m_fonts;
+        std::unordered_set<const PdfObject*> m_running;
+    };
+
+    struct PdfPage
+    {
+        const PdfObject* page;
+        const PdfObject* resources;
+    };
+
+    inline void CollectPdfPages(PdfObjectTable& objects, PdfObject const& node, const PdfObject* resources, int depth, std::unordered_set<const PdfObject*>& seen, std::vector<PdfPage>& pages) {
+        if (depth > 64 || !node.IsDictionary() || !seen.insert(&node).second) {
+            return;
+        }
+        if (const PdfObject* own = node.Find("Resources")) {
+            resources = &objects.Resolve(*own);
+        }
+        const PdfObject* kids = node.Find("Kids");
+        if (kids == nullptr) {
+            pages.push_back(PdfPage{ &node, resources });
+            return;
+        }
+        PdfObject const& list = objects.Resolve(*kids);
+        for (PdfObject const& kid : list.items) {
+            CollectPdfPages(objects, objects.Resolve(kid), resources, depth + 1, seen, pages);
+        }
+    }
+  }
+
+  // Text of a PDF's pages in order, as UTF-8, pages separated by a blank line, for indexing
+  // rather than display. Pages come from the page tree, or from every /Type /Page object
+  // when the tree cannot be followed. Throws PdfError when the data is not a PDF or is
+  // encrypted; anything unreadable further in is skipped, so a damaged file yields what text
+  // could be read. Stops once the text reaches about `maxText` bytes.
+  inline std::string ExtractPdfText(const uint8_t* data, size_t size, size_t maxText = 16 * 1024 * 1024) {
+      if (detail::FindBytes(data, 0, std::min<size_t>(size, 1024), "%PDF-") >= std::min<size_t>(size, 1024)) {
+          throw PdfError("File is not a PDF");
+      }
+      PdfObjectTable objects(data, size);
+      objects.Scan();
+      if (objects.Trailer().Find("Encrypt") != nullptr) {
+          throw PdfError("PDF is encrypted");
+      }
+
+      std::vector<detail::PdfPage> pages;
+      std::unordered_set<const PdfObject*> seen;
+      if (const PdfObject* root = objects.Trailer().Find("Root")) {
+          if (const PdfObject* tree = objects.Resolve(*root).Find("Pages")) {
+              detail::CollectPdfPages(objects, objects.Resolve(*tree), nullptr, 0, seen, pages);
+          }
+      }
+      if (pages.empty()) {
+          for (uint32_t number : objects.Numbers()) {
+              const PdfObject* object = objects.Get(number);
+              const PdfObject* type = object != nullptr ? object->Find("Type") : nullptr;
+              if (type != nullptr && type->IsName("Page")) {
+                  const PdfObject* resources = object->Find("Resources");
+                  pages.push_back(detail::PdfPage{ object, resources != nullptr ? &objects.Resolve(*resources) : nullptr });
+              }
+          }
+      }
+
+      std::string text;
+      detail::PdfTextCollector collector(objects, text, maxText);
+      for (detail::PdfPage const& page : pages) {
+          if (collector.Full()) {
+              break;
+          }
+          if (const PdfObject* contents = page.page->Find("Contents")) {
+              collector.Run(*contents, page.resources, 0);
+          }
+          if (!text.empty() && text.back() != '\n') {
+              text.push_back('\n');
+          }
+          text.push_back('\n');
+      }
+      return text;
+  }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "IoExecutor.h"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace FileIngest
+{
+  // Bounds how many coroutines are inside a pipeline at once. Acquire() completes inline while
+  // permits are left; otherwise the coroutine waits and Release() resumes it on the executor,
+  // so a batch of any size keeps at most `permits` files in memory.
+  class AsyncSemaphore
+  {
+  public:
+      AsyncSemaphore(IoExecutor& executor, size_t permits) noexcept : m_executor(executor), m_available(permits) {}
+
+      AsyncSemaphore(AsyncSemaphore const&) = delete;
+      AsyncSemaphore& operator=(AsyncSemaphore const&) = delete;
+
+      // Gives its permit back when it goes out of scope, including when the holder throws
+      class Permit
+      {
+      public:
+          explicit Permit(AsyncSemaphore& semaphore) noexcept : m_semaphore(&semaphore) {}
+
+          Permit(Permit&& other) noexcept : m_semaphore(std::exchange(other.m_semaphore, nullptr)) {}
+
+          Permit(Permit const&) = delete;
+          Permit& operator=(Permit const&) = delete;
+          Permit& operator=(Permit&&) = delete;
+
+          ~Permit() {
+              if (m_semaphore != nullptr) {
+                  m_semaphore->Release();
+              }
+          }
+
+      private:
+          AsyncSemaphore* m_semaphore;
+      };
+
+      struct AcquireAwaiter
+      {
+          AsyncSemaphore& semaphore;
+
+          bool await_ready() const noexcept {
+              return false;
+          }
+
+          bool await_suspend(std::coroutine_handle<> handle) {
+              std::lock_guard<std::mutex> lock(semaphore.m_mutex);
+              if (semaphore.m_available > 0) {
+                  semaphore.m_available--;
+                  return false;
+              }
+              semaphore.m_waiters.push_back(handle);
+              return true;
+          }
+
+          [[nodiscard]] Permit await_resume() const noexcept {
+              return Permit(semaphore);
+          }
+      };
+
+      // co_await yields the Permit that holds the acquired slot
+      AcquireAwaiter Acquire() noexcept {
+          return AcquireAwaiter{ *this };
+      }
+
+  private:
+      // Hands the permit straight to the oldest waiter, if any
+      void Release() {
+          std::coroutine_handle<> next;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              if (m_waiters.empty()) {
+                  m_available++;
+                  return;
+              }
+              next = m_waiters.front();
+              m_waiters.pop_front();
+          }
+          m_executor.Post([next]() { next.resume(); });
+      }
+
+      IoExecutor& m_executor;
+      std::mutex m_mutex;
+      size_t m_available;
+      std::deque<std::coroutine_handle<>> m_waiters;
+  };
+
+  // Counts the items of a batch down and tells the caller which one finished last
+  class BatchCountdown
+  {
+  public:
+      explicit BatchCountdown(size_t count) noexcept : m_remaining(count) {}
+
+      // Returns true exactly once, for the last item
+      bool Complete() noexcept {
+          return m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+      }
+
+  private:
+      std::atomic<size_t> m_remaining;
+  };
+}
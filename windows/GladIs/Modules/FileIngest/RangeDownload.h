@@ -0,0 +1,426 @@
+#pragma once
+
+#include "Base64.h"
+#include "LogFile.h"
+#include "Sha256.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  struct DownloadError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  // One chunk of a download, fetched with a single Range request
+  struct DownloadRange
+  {
+      uint32_t index = 0;
+      uint64_t offset = 0;
+      uint64_t length = 0;
+  };
+
+  namespace detail
+  {
+    inline std::string_view TrimHeader(std::string_view value) noexcept {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+
+    inline bool EqualsIgnoreCase(std::string_view a, std::string_view b) noexcept {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            char x = a[i] >= 'A' && a[i] <= 'Z' ? static_cast<char>(a[i] + 32) : a[i];
+            char y = b[i] >= 'A' && b[i] <= 'Z' ? static_cast<char>(b[i] + 32) : b[i];
+            if (x != y) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Digits only, no sign or spaces; false on overflow
+    inline bool ParseDecimal(std::string_view text, uint64_t& value) noexcept {
+        if (text.empty() || text.size() > 19) {
+            return false;
+        }
+        value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            value = value * 10 + static_cast<uint64_t>(c - '0');
+        }
+        return true;
+    }
+  }
+
+  // The value of the Range header asking for `range`
+  inline std::string RangeHeader(DownloadRange const& range) {
+      return "bytes=" + std::to_string(range.offset) + "-" + std::to_string(range.offset + range.length - 1);
+  }
+
+  // Parses a 206 answer's Content-Range, "bytes <first>-<last>/<total>". A 416 answer's
+  // "bytes */<total>" and an unknown total, "/*", are rejected: a download needs both.
+  inline bool ParseContentRange(std::string_view value, uint64_t& first, uint64_t& last, uint64_t& total) noexcept {
+      value = detail::TrimHeader(value);
+      if (value.size() < 6 || !detail::EqualsIgnoreCase(value.substr(0, 6), "bytes ")) {
+          return false;
+      }
+      value = detail::TrimHeader(value.substr(6));
+      size_t dash = value.find('-');
+      size_t slash = value.find('/');
+      if (dash == std::string_view::npos || slash == std::string_view::npos || dash > slash) {
+          return false;
+      }
+      return detail::ParseDecimal(value.substr(0, dash), first) && detail::ParseDecimal(value.substr(dash + 1, slash - dash - 1), last)
+          && detail::ParseDecimal(value.substr(slash + 1), total) && first <= last && last < total;
+  }
+
+  // Whether the answer to a download's first request, which asks for chunk 0, starts a ranged
+  // download, and then its total size. Only a 200 carries the whole file in one body; a 206
+  // without "bytes 0-<last>/<total>" or any other status throws, since storing its body as the
+  // whole file would keep a fragment under the document's name.
+  inline bool IsRangedFirstAnswer(int status, std::string_view contentRange, uint64_t& total) {
+      if (status == 206) {
+          uint64_t first = 0, last = 0;
+          if (!ParseContentRange(contentRange, first, last, total) || first != 0) {
+              throw DownloadError("Partial answer without a usable Content-Range");
+          }
+          return true;
+      }
+      if (status != 200) {
+          throw DownloadError("Unexpected status " + std::to_string(status));
+      }
+      return false;
+  }
+
+  // Reads the SHA-256 out of a Repr-Digest header, "sha-256=:<base64>:", or the older Digest
+  // header, "SHA-256=<base64>". Other algorithms in the list are skipped.
+  inline bool ParseDigestHeader(std::string_view value, Sha256Digest& digest) {
+      while (!value.empty()) {
+          size_t comma = value.find(',');
+          std::string_view item = detail::TrimHeader(value.substr(0, comma));
+          value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+          size_t equals = item.find('=');
+          if (equals == std::string_view::npos || !detail::EqualsIgnoreCase(detail::TrimHeader(item.substr(0, equals)), "sha-256")) {
+              continue;
+          }
+          std::string_view encoded = detail::TrimHeader(item.substr(equals + 1));
+          if (encoded.size() >= 2 && encoded.front() == ':' && encoded.back() == ':') {
+              encoded = encoded.substr(1, encoded.size() - 2);
+          }
+          std::vector<uint8_t> bytes;
+          if (Base64::DecodeTo(encoded.data(), encoded.size(), bytes) && bytes.size() == digest.size()) {
+              std::copy(bytes.begin(), bytes.end(), digest.begin());
+              return true;
+          }
+      }
+      return false;
+  }
+
+  // What If-Range can carry: a strong ETag, else Last-Modified. Weak ETags never match in
+  // If-Range, so the whole file would come back on every request. Empty when neither fits,
+  // and then nothing can be resumed.
+  inline std::string ChooseValidator(std::string_view etag, std::string_view lastModified) {
+      etag = detail::TrimHeader(etag);
+      if (!etag.empty() && etag.substr(0, 2) != "W/") {
+          return std::string(etag);
+      }
+      return std::string(detail::TrimHeader(lastModified));
+  }
+
+  // A file downloaded as fixed-size chunks, fetched in any order by several connections and
+  // written straight to their offsets in `path`. Which chunks are on disk is kept in a bitmap
+  // saved next to it as <path>.state, only ever after the data it covers was flushed, so a
+  // download cut short at any point resumes with the chunks it had. Saved progress is used only
+  // for the same size, chunk size and validator; a file changed on the server starts over.
+  //
+  // The state file is little-endian: "RDLS", a version, the validator length, the chunk size, 4
+  // reserved bytes and the file size, then the validator and one bit per chunk.
+  class RangeDownload
+  {
+  public:
+      static constexpr uint32_t kMagic = 0x534C4452;
+      static constexpr uint16_t kVersion = 1;
+      static constexpr size_t kHeaderSize = 24;
+      // Chunks completed between two saves of the bitmap; at most this many are fetched again
+      // after a crash
+      static constexpr uint32_t kCheckpointInterval = 8;
+      // Attempts at one chunk before the download gives up
+      static constexpr uint32_t kMaxAttempts = 4;
+
+      RangeDownload(std::filesystem::path path, uint64_t size, uint32_t chunkSize, std::string validator)
+          : m_path(std::move(path)), m_statePath(StatePath(m_path)), m_size(size), m_chunkSize(chunkSize), m_validator(std::move(validator)) {
+          if (chunkSize == 0) {
+              throw DownloadError("Invalid chunk size");
+          }
+          uint64_t count = (size + chunkSize - 1) / chunkSize;
+          if (count > UINT32_MAX) {
+              throw DownloadError("File too large for the chunk size");
+          }
+          m_done.assign(static_cast<size_t>(count), 0);
+          m_inFlight.assign(m_done.size(), 0);
+          m_attempts.assign(m_done.size(), 0);
+          m_file = LogFile(m_path);
+          if (!LoadState()) {
+              std::error_code ignored;
+              std::filesystem::remove(m_statePath, ignored);
+              m_file.Truncate(0);
+              m_file.Truncate(m_size);
+          }
+          m_resumedBytes = m_completedBytes;
+      }
+
+      RangeDownload(RangeDownload const&) = delete;
+      RangeDownload& operator=(RangeDownload const&) = delete;
+
+      static std::filesystem::path StatePath(std::filesystem::path const& path) {
+          std::filesystem::path state = path;
+          state += ".state";
+          return state;
+      }
+
+      std::filesystem::path const& Path() const noexcept {
+          return m_path;
+      }
+
+      uint64_t Size() const noexcept {
+          return m_size;
+      }
+
+      uint32_t ChunkCount() const noexcept {
+          return static_cast<uint32_t>(m_done.size());
+      }
+
+      // Bytes already on disk when the download was opened
+      uint64_t ResumedBytes() const noexcept {
+          return m_resumedBytes;
+      }
+
+      uint64_t CompletedBytes() {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_completedBytes;
+      }
+
+      bool IsComplete() {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_completedBytes == m_size;
+      }
+
+      // Hands out the lowest chunk neither on disk nor being fetched, so connections move
+      // through the file together; false when there is none left
+      bool Next(DownloadRange& range) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          for (uint32_t i = 0; i < m_done.size(); i++) {
+              if (!m_done[i] && !m_inFlight[i]) {
+                  m_inFlight[i] = 1;
+                  range = RangeOf(i);
+                  return true;
+              }
+          }
+          return false;
+      }
+
+      // Claims chunk `index` if it still has to be fetched, e.g. for bytes that arrived in
+      // answer to the request that discovered the file's size
+      bool Claim(uint32_t index, DownloadRange& range) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (index >= m_done.size() || m_done[index] || m_inFlight[index]) {
+              return false;
+          }
+          m_inFlight[index] = 1;
+          range = RangeOf(index);
+          return true;
+      }
+
+      // Writes bytes of a claimed chunk as they arrive, `at` bytes into it
+      void Write(DownloadRange const& range, uint64_t at, const uint8_t* data, size_t length) {
+          if (at > range.length || length > range.length - at) {
+              throw DownloadError("Server sent more than the requested range");
+          }
+          m_file.WriteAt(range.offset + at, data, length);
+      }
+
+      // Marks a claimed chunk as written in full
+      void Complete(DownloadRange const& range) {
+          bool checkpoint = false;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              m_inFlight[range.index] = 0;
+              if (!m_done[range.index]) {
+                  m_done[range.index] = 1;
+                  m_completedBytes += range.length;
+                  checkpoint = ++m_sinceCheckpoint >= kCheckpointInterval;
+              }
+          }
+          if (checkpoint) {
+              Checkpoint();
+          }
+      }
+
+      // Returns a claimed chunk whose fetch failed; false once it failed kMaxAttempts times
+      bool Fail(DownloadRange const& range) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_inFlight[range.index] = 0;
+          return ++m_attempts[range.index] < kMaxAttempts;
+      }
+
+      // Flushes the data, then saves the bitmap of what the flush made durable
+      void Checkpoint() {
+          std::lock_guard<std::mutex> checkpointLock(m_checkpointMutex);
+          std::vector<uint8_t> done;
+          {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              done = m_done;
+              m_sinceCheckpoint = 0;
+          }
+          if (m_validator.empty()) {
+              return;
+          }
+          m_file.Sync();
+          SaveState(done);
+      }
+
+      // Hashes the finished file through `buffer`, whose length sets the read size
+      Sha256Digest Digest(uint8_t* buffer, size_t bufferLength) {
+          Sha256 hash;
+          for (uint64_t offset = 0; offset < m_size;) {
+              size_t read = m_file.ReadAt(offset, buffer, static_cast<size_t>(std::min<uint64_t>(bufferLength, m_size - offset)));
+              if (read == 0) {
+                  throw DownloadError("Downloaded file ended early");
+              }
+              hash.Update(buffer, read);
+              offset += read;
+          }
+          return hash.Final();
+      }
+
+      // Flushes the finished file and forgets its progress; the file stays for the caller
+      void Finish() {
+          m_file.Sync();
+          m_file.Close();
+          std::error_code ignored;
+          std::filesystem::remove(m_statePath, ignored);
+      }
+
+      // Deletes the file and its progress, e.g. after a digest mismatch
+      void Discard() {
+          m_file.Close();
+          std::error_code ignored;
+          std::filesystem::remove(m_statePath, ignored);
+          std::filesystem::remove(m_path, ignored);
+      }
+
+  private:
+      DownloadRange RangeOf(uint32_t index) const noexcept {
+          DownloadRange range;
+          range.index = index;
+          range.offset = uint64_t(index) * m_chunkSize;
+          range.length = std::min<uint64_t>(m_chunkSize, m_size - range.offset);
+          return range;
+      }
+
+      static void PutLittleEndian(std::string& out, uint64_t value, int bytes) {
+          for (int i = 0; i < bytes; i++) {
+              out.push_back(static_cast<char>(value >> (8 * i)));
+          }
+      }
+
+      static uint64_t GetLittleEndian(const char* data, int bytes) noexcept {
+          uint64_t value = 0;
+          for (int i = 0; i < bytes; i++) {
+              value |= uint64_t(static_cast<uint8_t>(data[i])) << (8 * i);
+          }
+          return value;
+      }
+
+      // Written beside the old state and renamed over it, so a crash leaves one or the other
+      void SaveState(std::vector<uint8_t> const& done) {
+          std::string bytes;
+          PutLittleEndian(bytes, kMagic, 4);
+          PutLittleEndian(bytes, kVersion, 2);
+          PutLittleEndian(bytes, m_validator.size(), 2);
+          PutLittleEndian(bytes, m_chunkSize, 4);
+          PutLittleEndian(bytes, 0, 4);
+          PutLittleEndian(bytes, m_size, 8);
+          bytes += m_validator;
+          bytes.resize(bytes.size() + (done.size() + 7) / 8, '\0');
+          char* bitmap = bytes.data() + kHeaderSize + m_validator.size();
+          for (size_t i = 0; i < done.size(); i++) {
+              if (done[i]) {
+                  bitmap[i / 8] = static_cast<char>(bitmap[i / 8] | (1 << (i % 8)));
+              }
+          }
+          std::filesystem::path temporary = m_statePath;
+          temporary += ".tmp";
+          {
+              std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+              output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+              if (!output) {
+                  throw DownloadError("Error saving download progress");
+              }
+          }
+          std::filesystem::rename(temporary, m_statePath);
+      }
+
+      bool LoadState() {
+          if (m_validator.empty() || m_file.Size() != m_size) {
+              return false;
+          }
+          std::ifstream input(m_statePath, std::ios::binary);
+          std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+          if (bytes.size() < kHeaderSize || GetLittleEndian(bytes.data(), 4) != kMagic || GetLittleEndian(bytes.data() + 4, 2) != kVersion) {
+              return false;
+          }
+          size_t validatorLength = static_cast<size_t>(GetLittleEndian(bytes.data() + 6, 2));
+          if (GetLittleEndian(bytes.data() + 8, 4) != m_chunkSize || GetLittleEndian(bytes.data() + 16, 8) != m_size
+              || bytes.size() != kHeaderSize + validatorLength + (m_done.size() + 7) / 8 || bytes.compare(kHeaderSize, validatorLength, m_validator) != 0) {
+              return false;
+          }
+          const char* bitmap = bytes.data() + kHeaderSize + validatorLength;
+          for (uint32_t i = 0; i < m_done.size(); i++) {
+              if (bitmap[i / 8] & (1 << (i % 8))) {
+                  m_done[i] = 1;
+                  m_completedBytes += RangeOf(i).length;
+              }
+          }
+          return true;
+      }
+
+      const std::filesystem::path m_path;
+      const std::filesystem::path m_statePath;
+      const uint64_t m_size;
+      const uint32_t m_chunkSize;
+      const std::string m_validator;
+      LogFile m_file;
+      std::mutex m_mutex;
+      std::mutex m_checkpointMutex;
+      std::vector<uint8_t> m_done;
+      std::vector<uint8_t> m_inFlight;
+      std::vector<uint8_t> m_attempts;
+      uint64_t m_completedBytes = 0;
+      uint64_t m_resumedBytes = 0;
+      uint32_t m_sinceCheckpoint = 0;
+  };
+}
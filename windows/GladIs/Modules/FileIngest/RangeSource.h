@@ -0,0 +1,198 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace FileIngest
+{
+  struct RangeReadError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  // An open file that is read at arbitrary offsets instead of loaded whole
+  class RangeSource
+  {
+  public:
+      virtual ~RangeSource() = default;
+
+      virtual uint64_t Size() const noexcept = 0;
+
+      // Reads up to `length` bytes at `offset` and returns how many were read, which is only
+      // short at the end of the file. Safe to call from several threads at once.
+      virtual size_t ReadAt(uint64_t offset, uint8_t* out, size_t length) = 0;
+  };
+
+  // Positional reads on a native file: pread on POSIX, ReadFile with an explicit offset on Windows,
+  // so concurrent reads never race on a shared file pointer
+  class NativeFileSource final : public RangeSource
+  {
+  public:
+#if defined(_WIN32)
+      using NativeHandle = HANDLE;
+      // INVALID_HANDLE_VALUE is a cast, which rules out constexpr
+      static inline const NativeHandle kInvalidHandle = INVALID_HANDLE_VALUE;
+#else
+      using NativeHandle = int;
+      static constexpr NativeHandle kInvalidHandle = -1;
+#endif
+
+      // Takes ownership of an already open handle, such as one brokered for a picked file
+      explicit NativeFileSource(NativeHandle file) : m_file(file) {
+          if (m_file == kInvalidHandle) {
+              throw RangeReadError("Invalid file handle");
+          }
+#if defined(_WIN32)
+          LARGE_INTEGER size{};
+          if (!::GetFileSizeEx(m_file, &size)) {
+              Close();
+              throw RangeReadError("Cannot read file size");
+          }
+          m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+          struct stat info{};
+          if (::fstat(m_file, &info) != 0) {
+              Close();
+              throw RangeReadError("Cannot read file size");
+          }
+          m_size = static_cast<uint64_t>(info.st_size);
+#endif
+      }
+
+      explicit NativeFileSource(std::filesystem::path const& path) : NativeFileSource(OpenPath(path)) {}
+
+      ~NativeFileSource() override {
+          Close();
+      }
+
+      NativeFileSource(NativeFileSource const&) = delete;
+      NativeFileSource& operator=(NativeFileSource const&) = delete;
+
+      uint64_t Size() const noexcept override {
+          return m_size;
+      }
+
+      size_t ReadAt(uint64_t offset, uint8_t* out, size_t length) override {
+          size_t total = 0;
+          while (total < length && offset + total < m_size) {
+#if defined(_WIN32)
+              OVERLAPPED position{};
+              uint64_t at = offset + total;
+              position.Offset = static_cast<DWORD>(at);
+              position.OffsetHigh = static_cast<DWORD>(at >> 32);
+              DWORD toRead = static_cast<DWORD>(std::min<size_t>(length - total, 1u << 30));
+              DWORD read = 0;
+              if (!::ReadFile(m_file, out + total, toRead, &read, &position) && ::GetLastError() != ERROR_HANDLE_EOF) {
+                  throw RangeReadError("Error reading file");
+              }
+#else
+              ssize_t read = ::pread(m_file, out + total, length - total, static_cast<off_t>(offset + total));
+              if (read < 0) {
+                  if (errno == EINTR) {
+                      continue;
+                  }
+                  throw RangeReadError("Error reading file");
+              }
+#endif
+              if (read == 0) {
+                  break;
+              }
+              total += static_cast<size_t>(read);
+          }
+          return total;
+      }
+
+  private:
+      static NativeHandle OpenPath(std::filesystem::path const& path) {
+#if defined(_WIN32)
+          NativeHandle file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+#else
+          NativeHandle file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+          if (file == kInvalidHandle) {
+              throw RangeReadError("Cannot open " + path.string());
+          }
+          return file;
+      }
+
+      void Close() noexcept {
+          if (m_file != kInvalidHandle) {
+#if defined(_WIN32)
+              ::CloseHandle(m_file);
+#else
+              ::close(m_file);
+#endif
+          }
+          m_file = kInvalidHandle;
+      }
+
+      NativeHandle m_file = kInvalidHandle;
+      uint64_t m_size = 0;
+  };
+
+  // A file mapped read-only, for readers that go through it front to back: Data() hands out the
+  // mapped pages themselves, so hashing, encoding and parsing run on the page cache with no copy
+  // in between. ReadAt serves the same bytes to RangeSource readers.
+  //
+  // A mapped read faults instead of failing when the file shrinks under it, so the file must be
+  // opened without write sharing, as picked files are.
+  class MappedFileSource final : public RangeSource
+  {
+  public:
+      // Takes ownership of an already open handle, which is closed when the mapping fails.
+      // Throws MappedFileError then, and callers fall back to reading the file.
+      explicit MappedFileSource(MappedFile::NativeHandle file) : m_file(file) {
+          m_file.AdviseSequential();
+      }
+
+      explicit MappedFileSource(std::filesystem::path const& path) : m_file(path, MappedFile::Mode::ReadOnly) {
+          m_file.AdviseSequential();
+      }
+
+      uint64_t Size() const noexcept override {
+          return m_file.Size();
+      }
+
+      // nullptr for an empty file
+      const uint8_t* Data() const noexcept {
+          return m_file.Data();
+      }
+
+      // See MappedFile::Prefetch
+      void Prefetch(uint64_t offset, uint64_t length) noexcept {
+          m_file.Prefetch(offset, length);
+      }
+
+      size_t ReadAt(uint64_t offset, uint8_t* out, size_t length) override {
+          if (offset >= m_file.Size()) {
+              return 0;
+          }
+          size_t take = static_cast<size_t>(std::min<uint64_t>(length, m_file.Size() - offset));
+          std::memcpy(out, m_file.Data() + offset, take);
+          return take;
+      }
+
+  private:
+      MappedFile m_file;
+  };
+}
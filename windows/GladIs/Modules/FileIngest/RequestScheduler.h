@@ -0,0 +1,275 @@
+#pragma once
+
+#include "IoExecutor.h"
+#include "Pipeline.h"
+
+#include <algorithm>
+#include <cctype>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  // The leader of a coalesced request went away without an answer for the others
+  struct RequestAbandoned : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  // "scheme://host:port" of a URL in lower case, without user info, path or query. Requests to
+  // the same key share connections and a concurrency limit.
+  inline std::string HostKey(std::string_view url) {
+      size_t scheme = url.find("://");
+      if (scheme == std::string_view::npos) {
+          return std::string();
+      }
+      size_t start = scheme + 3;
+      size_t end = url.find_first_of("/?#", start);
+      std::string_view authority = url.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+      size_t at = authority.rfind('@');
+      if (at != std::string_view::npos) {
+          authority.remove_prefix(at + 1);
+      }
+      std::string key;
+      key.reserve(start + authority.size());
+      key.append(url.substr(0, start));
+      key.append(authority);
+      std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+      return key;
+  }
+
+  // Identical GETs may share one answer; anything else must reach the server itself. The
+  // credentials are part of the key so that users never see each other's answers. Returns an
+  // empty key when the request cannot be coalesced.
+  inline std::string CoalescingKey(std::string_view method, std::string_view url, std::string_view authorization) {
+      if (method != "GET") {
+          return std::string();
+      }
+      std::string key;
+      key.reserve(url.size() + 1 + authorization.size());
+      key.append(url);
+      key.push_back('\n');
+      key.append(authorization);
+      return key;
+  }
+
+  // At most `perHost` requests in flight to each host; the others wait their turn in order
+  // without holding a thread. Hosts are few and long-lived, so their semaphores are kept.
+  class HostLimiter
+  {
+  public:
+      HostLimiter(IoExecutor& executor, size_t perHost) noexcept : m_executor(executor), m_perHost(perHost) {}
+
+      HostLimiter(HostLimiter const&) = delete;
+      HostLimiter& operator=(HostLimiter const&) = delete;
+
+      // `co_await limiter.For(HostKey(url)).Acquire()` holds a slot until the permit is dropped
+      AsyncSemaphore& For(std::string const& host) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto& semaphore = m_hosts[host];
+          if (!semaphore) {
+              semaphore = std::make_unique<AsyncSemaphore>(m_executor, m_perHost);
+          }
+          return *semaphore;
+      }
+
+      size_t PerHost() const noexcept {
+          return m_perHost;
+      }
+
+  private:
+      IoExecutor& m_executor;
+      const size_t m_perHost;
+      std::mutex m_mutex;
+      std::map<std::string, std::unique_ptr<AsyncSemaphore>> m_hosts;
+  };
+
+  struct CoalescerStats
+  {
+      uint64_t leaders = 0;
+      uint64_t followers = 0;
+      uint64_t inFlight = 0;
+  };
+
+  // Lets identical requests that overlap in time share one trip to the server. The first to
+  // Join a key leads: it sends the request and publishes the answer, or its failure, through its
+  // Ticket. Whoever joins the key before then follows and awaits that answer on an executor
+  // worker. A key is forgotten as soon as its answer is published, so later requests always go
+  // to the server again and never see a stale answer. The leader keeps its own answer and only
+  // makes a copy for the followers when there are any.
+  template <typename T>
+  class RequestCoalescer
+  {
+      struct Flight
+      {
+          std::mutex mutex;
+          bool done = false;
+          std::optional<T> value;
+          std::exception_ptr failure;
+          std::vector<std::coroutine_handle<>> waiters;
+          // Guarded by the coalescer's mutex, final once the key is forgotten
+          size_t followers = 0;
+      };
+
+  public:
+      explicit RequestCoalescer(IoExecutor& executor) noexcept : m_executor(executor) {}
+
+      RequestCoalescer(RequestCoalescer const&) = delete;
+      RequestCoalescer& operator=(RequestCoalescer const&) = delete;
+
+      class Ticket
+      {
+      public:
+          Ticket(Ticket&& other) noexcept
+              : m_owner(std::exchange(other.m_owner, nullptr)), m_key(std::move(other.m_key)), m_flight(std::move(other.m_flight)), m_leader(other.m_leader) {}
+
+          Ticket(Ticket const&) = delete;
+          Ticket& operator=(Ticket const&) = delete;
+          Ticket& operator=(Ticket&&) = delete;
+
+          // A leader that throws before publishing fails its followers rather than strand them
+          ~Ticket() {
+              if (m_owner != nullptr && m_leader) {
+                  Fail(std::make_exception_ptr(RequestAbandoned("Coalesced request was abandoned")));
+              }
+          }
+
+          bool IsLeader() const noexcept {
+              return m_leader;
+          }
+
+          // Leader only: hands the followers the answer `share()` returns, which is not called
+          // when nobody followed
+          template <typename Share>
+          void Complete(Share&& share) {
+              if (m_owner == nullptr || !m_leader) {
+                  return;
+              }
+              if (m_owner->Forget(m_key, m_flight) == 0) {
+                  m_owner = nullptr;
+                  return;
+              }
+              Publish(std::optional<T>(share()), nullptr);
+          }
+
+          void Fail(std::exception_ptr failure) {
+              if (m_owner == nullptr || !m_leader) {
+                  return;
+              }
+              m_owner->Forget(m_key, m_flight);
+              Publish(std::nullopt, std::move(failure));
+          }
+
+          struct WaitAwaiter
+          {
+              Ticket& ticket;
+
+              bool await_ready() const {
+                  std::lock_guard<std::mutex> lock(ticket.m_flight->mutex);
+                  return ticket.m_flight->done;
+              }
+
+              bool await_suspend(std::coroutine_handle<> handle) {
+                  std::lock_guard<std::mutex> lock(ticket.m_flight->mutex);
+                  if (ticket.m_flight->done) {
+                      return false;
+                  }
+                  ticket.m_flight->waiters.push_back(handle);
+                  return true;
+              }
+
+              // Shared by all followers and valid as long as the ticket
+              T const& await_resume() const {
+                  if (ticket.m_flight->failure) {
+                      std::rethrow_exception(ticket.m_flight->failure);
+                  }
+                  return *ticket.m_flight->value;
+              }
+          };
+
+          // Follower only: co_await yields the leader's answer or rethrows its failure
+          WaitAwaiter Wait() noexcept {
+              return WaitAwaiter{ *this };
+          }
+
+      private:
+          friend class RequestCoalescer;
+
+          Ticket(RequestCoalescer* owner, std::string key, std::shared_ptr<Flight> flight, bool leader)
+              : m_owner(owner), m_key(std::move(key)), m_flight(std::move(flight)), m_leader(leader) {}
+
+          void Publish(std::optional<T> value, std::exception_ptr failure) {
+              std::vector<std::coroutine_handle<>> waiters;
+              {
+                  std::lock_guard<std::mutex> lock(m_flight->mutex);
+                  m_flight->value = std::move(value);
+                  m_flight->failure = std::move(failure);
+                  m_flight->done = true;
+                  waiters.swap(m_flight->waiters);
+              }
+              for (std::coroutine_handle<> waiter : waiters) {
+                  m_owner->m_executor.Post([waiter]() { waiter.resume(); });
+              }
+              m_owner = nullptr;
+          }
+
+          RequestCoalescer* m_owner;
+          std::string m_key;
+          std::shared_ptr<Flight> m_flight;
+          bool m_leader;
+      };
+
+      // An empty key never coalesces: the caller leads a flight of its own
+      Ticket Join(std::string const& key) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (!key.empty()) {
+              auto found = m_flights.find(key);
+              if (found != m_flights.end()) {
+                  m_stats.followers++;
+                  found->second->followers++;
+                  return Ticket(this, key, found->second, false);
+              }
+          }
+          auto flight = std::make_shared<Flight>();
+          if (!key.empty()) {
+              m_flights.emplace(key, flight);
+          }
+          m_stats.leaders++;
+          return Ticket(this, key, std::move(flight), true);
+      }
+
+      CoalescerStats Stats() {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          CoalescerStats stats = m_stats;
+          stats.inFlight = m_flights.size();
+          return stats;
+      }
+
+  private:
+      // Returns how many followed the flight; no one can join it any more
+      size_t Forget(std::string const& key, std::shared_ptr<Flight> const& flight) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto found = m_flights.find(key);
+          if (!key.empty() && found != m_flights.end() && found->second == flight) {
+              m_flights.erase(found);
+          }
+          return flight->followers;
+      }
+
+      IoExecutor& m_executor;
+      std::mutex m_mutex;
+      std::unordered_map<std::string, std::shared_ptr<Flight>> m_flights;
+      CoalescerStats m_stats;
+  };
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace FileIngest
+{
+  using Sha256Digest = std::array<uint8_t, 32>;
+
+  // Incremental SHA-256 (FIPS 180-4). Update() can be called with pieces of any size,
+  // so a file can be hashed chunk by chunk while it is being read.
+  class Sha256
+  {
+  public:
+      Sha256() noexcept {
+          Reset();
+      }
+
+      void Reset() noexcept {
+          m_state = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+          m_length = 0;
+          m_buffered = 0;
+      }
+
+      void Update(const uint8_t* data, size_t length) noexcept {
+          m_length += length;
+          if (m_buffered > 0) {
+              size_t take = std::min(length, kBlockSize - m_buffered);
+              std::memcpy(m_buffer + m_buffered, data, take);
+              m_buffered += take;
+              data += take;
+              length -= take;
+              if (m_buffered < kBlockSize) {
+                  return;
+              }
+              Compress(m_buffer);
+              m_buffered = 0;
+          }
+          for (; length >= kBlockSize; data += kBlockSize, length -= kBlockSize) {
+              Compress(data);
+          }
+          if (length > 0) {
+              std::memcpy(m_buffer, data, length);
+              m_buffered = length;
+          }
+      }
+
+      Sha256Digest Final() noexcept {
+          uint64_t bitLength = m_length * 8;
+          uint8_t padding[kBlockSize * 2] = { 0x80 };
+          size_t padLength = (m_buffered < 56 ? 56 : 120) - m_buffered;
+          for (int i = 0; i < 8; i++) {
+              padding[padLength + i] = static_cast<uint8_t>(bitLength >> (56 - 8 * i));
+          }
+          Update(padding, padLength + 8);
+
+          Sha256Digest digest;
+          for (size_t i = 0; i < 8; i++) {
+              digest[i * 4] = static_cast<uint8_t>(m_state[i] >> 24);
+              digest[i * 4 + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+              digest[i * 4 + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+              digest[i * 4 + 3] = static_cast<uint8_t>(m_state[i]);
+          }
+          Reset();
+          return digest;
+      }
+
+      static Sha256Digest Hash(const uint8_t* data, size_t length) noexcept {
+          Sha256 hasher;
+          hasher.Update(data, length);
+          return hasher.Final();
+      }
+
+  private:
+      static constexpr size_t kBlockSize = 64;
+
+      static constexpr uint32_t kRoundConstants[64] = {
+          0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+          0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+          0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+          0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+          0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+          0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+          0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+          0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+      };
+
+      static constexpr uint32_t Rotr(uint32_t value, int bits) noexcept {
+          return (value >> bits) | (value << (32 - bits));
+      }
+
+      void Compress(const uint8_t* block) noexcept {
+          uint32_t w[64];
+          for (int i = 0; i < 16; i++) {
+              w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) | (uint32_t(block[i * 4 + 2]) << 8) | block[i * 4 + 3];
+          }
+          for (int i = 16; i < 64; i++) {
+              uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+              uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+              w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+          }
+
+          uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+          uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+          for (int i = 0; i < 64; i++) {
+              uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRoundConstants[i] + w[i];
+              uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+              h = g;
+              g = f;
+              f = e;
+              e = d + t1;
+              d = c;
+              c = b;
+              b = a;
+              a = t1 + t2;
+          }
+          m_state[0] += a;
+          m_state[1] += b;
+          m_state[2] += c;
+          m_state[3] += d;
+          m_state[4] += e;
+          m_state[5] += f;
+          m_state[6] += g;
+          m_state[7] += h;
+      }
+
+      std::array<uint32_t, 8> m_state;
+      uint64_t m_length;
+      size_t m_buffered;
+      uint8_t m_buffer[kBlockSize];
+  };
+
+  inline std::string ToHex(Sha256Digest const& digest) {
+      static constexpr char kHex[] = "0123456789abcdef";
+      std::string hex(digest.size() * 2, '0');
+      for (size_t i = 0; i < digest.size(); i++) {
+          hex[i * 2] = kHex[digest[i] >> 4];
+          hex[i * 2 + 1] = kHex[digest[i] & 0xF];
+      }
+      return hex;
+  }
+
+  // Accepts lower or upper case; returns false for anything that is not 64 hex digits
+  inline bool ParseHex(std::string const& hex, Sha256Digest& digest) noexcept {
+      if (hex.size() != digest.size() * 2) {
+          return false;
+      }
+      auto nibble = [](char c) -> int {
+          if (c >= '0' && c <= '9') return c - '0';
+          if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+          if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+          return -1;
+      };
+      for (size_t i = 0; i < digest.size(); i++) {
+          int high = nibble(hex[i * 2]);
+          int low = nibble(hex[i * 2 + 1]);
+          if (high < 0 || low < 0) {
+              return false;
+          }
+          digest[i] = static_cast<uint8_t>((high << 4) | low);
+      }
+      return true;
+  }
+}
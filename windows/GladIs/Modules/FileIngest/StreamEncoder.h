@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Base64.h"
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace FileIngest
+{
+  // 768 KiB of input, i.e. exactly 1 MiB of base64 per chunk
+  inline constexpr size_t kDefaultChunkSize = 768 * 1024;
+  inline constexpr size_t kMinChunkSize = 3 * 1024;
+  inline constexpr size_t kMaxChunkSize = 48 * 1024 * 1024;
+
+  // Clamps a requested chunk size and rounds it down to a multiple of 3 so that
+  // every chunk but the last encodes without padding and can be decoded on its own.
+  constexpr size_t NormalizeChunkSize(size_t requested) noexcept {
+      if (requested == 0) {
+          return kDefaultChunkSize;
+      }
+      size_t clamped = std::clamp(requested, kMinChunkSize, kMaxChunkSize);
+      return clamped - (clamped % 3);
+  }
+
+  struct EncodedChunk
+  {
+      uint32_t index;
+      uint64_t offset;
+      size_t byteLength;
+      const std::string& data;
+  };
+
+  struct StreamSummary
+  {
+      uint64_t totalBytes = 0;
+      uint64_t encodedLength = 0;
+      uint32_t chunkCount = 0;
+  };
+
+  // Accumulates bytes into fixed-size chunks and encodes each one as soon as it is full.
+  // Callers write into WritePointer() and Commit() what they read, which lets coroutine
+  // code await its own I/O between chunks.
+  class ChunkedStreamEncoder
+  {
+  public:
+      explicit ChunkedStreamEncoder(size_t chunkSize)
+          : m_chunkSize(NormalizeChunkSize(chunkSize)), m_buffer(m_chunkSize) {
+          m_encoded.reserve(Base64::EncodedLength(m_chunkSize));
+      }
+
+      // Takes the chunk buffer from `pool`, it goes back when the encoder is destroyed
+      ChunkedStreamEncoder(size_t chunkSize, BufferPool& pool)
+          : m_chunkSize(NormalizeChunkSize(chunkSize)), m_buffer(pool.Acquire(m_chunkSize)) {
+          m_encoded.reserve(Base64::EncodedLength(m_chunkSize));
+      }
+
+      uint8_t* WritePointer() noexcept {
+          return m_buffer.Data() + m_filled;
+      }
+
+      size_t WritableBytes() const noexcept {
+          return m_chunkSize - m_filled;
+      }
+
+      // Records `length` bytes written at WritePointer() and emits the chunk once full
+      template <typename OnChunk>
+      void Commit(size_t length, OnChunk&& onChunk) {
+          m_filled += length;
+          if (m_filled == m_chunkSize) {
+              Flush(onChunk);
+          }
+      }
+
+      // Encodes bytes that are already in memory, such as a mapped file. Whole chunks are
+      // encoded where they lie and only a partial one is copied into the chunk buffer, so the
+      // chunks are the same as those Commit would have produced.
+      template <typename OnChunk>
+      void Append(const uint8_t* data, size_t length, OnChunk&& onChunk) {
+          while (length > 0) {
+              if (m_filled == 0 && length >= m_chunkSize) {
+                  Emit(data, m_chunkSize, onChunk);
+                  data += m_chunkSize;
+                  length -= m_chunkSize;
+                  continue;
+              }
+              size_t take = std::min(length, WritableBytes());
+              std::memcpy(WritePointer(), data, take);
+              Commit(take, onChunk);
+              data += take;
+              length -= take;
+          }
+      }
+
+      // Emits the last partial chunk, if any
+      template <typename OnChunk>
+      StreamSummary Finish(OnChunk&& onChunk) {
+          if (m_filled > 0) {
+              Flush(onChunk);
+          }
+          return m_summary;
+      }
+
+  private:
+      template <typename OnChunk>
+      void Flush(OnChunk& onChunk) {
+          Emit(m_buffer.Data(), m_filled, onChunk);
+          m_filled = 0;
+      }
+
+      template <typename OnChunk>
+      void Emit(const uint8_t* data, size_t length, OnChunk& onChunk) {
+          Base64::EncodeTo(data, length, m_encoded);
+          onChunk(EncodedChunk{ m_summary.chunkCount, m_summary.totalBytes, length, m_encoded });
+
+          m_summary.totalBytes += length;
+          m_summary.encodedLength += m_encoded.size();
+          m_summary.chunkCount++;
+      }
+
+      const size_t m_chunkSize;
+      PooledBuffer m_buffer;
+      std::string m_encoded;
+      size_t m_filled = 0;
+      StreamSummary m_summary;
+  };
+
+  // Reads `source` chunk by chunk and hands each base64-encoded chunk to `onChunk`.
+  // `source` is called as `size_t(uint8_t* destination, size_t capacity)` and returns 0 once exhausted.
+  // Only one raw chunk and one encoded chunk are alive at any time, whatever the file size.
+  template <typename Source, typename OnChunk>
+  StreamSummary StreamEncode(Source&& source, size_t chunkSize, OnChunk&& onChunk) {
+      ChunkedStreamEncoder encoder(chunkSize);
+      for (;;) {
+          size_t read = source(encoder.WritePointer(), encoder.WritableBytes());
+          if (read == 0) {
+              break;
+          }
+          encoder.Commit(read, onChunk);
+      }
+      return encoder.Finish(onChunk);
+  }
+}
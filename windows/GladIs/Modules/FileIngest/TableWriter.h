@@ -0,0 +1,166 @@
+#pragma once
+
+#include "CsvParser.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace FileIngest
+{
+  struct ExportError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  enum class ExportFormat
+  {
+      Csv,
+      Xlsx,
+  };
+
+  constexpr bool ParseExportFormat(std::string_view name, ExportFormat& format) noexcept {
+      if (name == "csv") {
+          format = ExportFormat::Csv;
+      } else if (name == "xlsx") {
+          format = ExportFormat::Xlsx;
+      } else {
+          return false;
+      }
+      return true;
+  }
+
+  constexpr std::string_view ExportExtension(ExportFormat format) noexcept {
+      return format == ExportFormat::Xlsx ? ".xlsx" : ".csv";
+  }
+
+  // One cell of an exported row. Text is only referenced, it must outlive WriteRow.
+  struct TableCell
+  {
+      enum class Kind
+      {
+          Empty,
+          Text,
+          Number,
+      };
+
+      Kind kind = Kind::Empty;
+      std::string_view text;
+      double number = 0;
+
+      static TableCell Text(std::string_view text) noexcept {
+          return { Kind::Text, text, 0 };
+      }
+
+      static TableCell Number(double number) noexcept {
+          return { Kind::Number, {}, number };
+      }
+  };
+
+  // Serializes rows into Output(), which the caller drains to the file as it sees fit: the writer
+  // never holds more than what was produced since the last drain, so exports of any length run
+  // in constant memory.
+  class TableWriter
+  {
+  public:
+      virtual ~TableWriter() = default;
+
+      virtual void WriteRow(std::span<const TableCell> cells) = 0;
+
+      // Writes whatever ends the file; no row may follow
+      virtual void Finish() = 0;
+
+      // Serialized bytes not yet taken; clear it once written out
+      std::vector<uint8_t>& Output() noexcept {
+          return m_output;
+      }
+
+      uint64_t Rows() const noexcept {
+          return m_rows;
+      }
+
+  protected:
+      void Append(const char* data, size_t length) {
+          size_t size = m_output.size();
+          m_output.resize(size + length);
+          std::memcpy(m_output.data() + size, data, length);
+      }
+
+      void Append(std::string_view text) {
+          Append(text.data(), text.size());
+      }
+
+      // Shortest text that reads back as the same double; NaN and infinities have no cell form
+      static std::string_view FormatNumber(double value, char (&buffer)[32]) noexcept {
+          if (!std::isfinite(value)) {
+              return {};
+          }
+          auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+          return std::string_view(buffer, static_cast<size_t>(result.ptr - buffer));
+      }
+
+      std::vector<uint8_t> m_output;
+      uint64_t m_rows = 0;
+  };
+
+  // RFC 4180 CSV with CRLF line ends, as DataUtils.convertJSONToCSV produced. Fields are quoted
+  // only when they hold the delimiter, a quote or a line break, found 16 bytes at a time.
+  class CsvWriter final : public TableWriter
+  {
+  public:
+      // The byte order mark makes Excel read the file as UTF-8 rather than the ANSI code page.
+      // French Excel expects ';' between fields.
+      explicit CsvWriter(char delimiter = ',', bool byteOrderMark = true) : m_delimiter(delimiter) {
+          if (byteOrderMark) {
+              Append("\xEF\xBB\xBF");
+          }
+      }
+
+      void WriteRow(std::span<const TableCell> cells) override {
+          for (size_t i = 0; i < cells.size(); i++) {
+              if (i != 0) {
+                  m_output.push_back(static_cast<uint8_t>(m_delimiter));
+              }
+              if (cells[i].kind == TableCell::Kind::Text) {
+                  AppendField(cells[i].text);
+              } else if (cells[i].kind == TableCell::Kind::Number) {
+                  char buffer[32];
+                  Append(FormatNumber(cells[i].number, buffer));
+              }
+          }
+          Append("\r\n");
+          m_rows++;
+      }
+
+      void Finish() override {}
+
+  private:
+      void AppendField(std::string_view text) {
+          const char* begin = text.data();
+          const char* end = begin + text.size();
+          if (detail::FindAnyOf(begin, end, m_delimiter, '"', '\r', '\n') == end) {
+              Append(begin, text.size());
+              return;
+          }
+          m_output.push_back('"');
+          for (const char* cursor = begin; cursor < end;) {
+              const char* quote = static_cast<const char*>(std::memchr(cursor, '"', static_cast<size_t>(end - cursor)));
+              const char* stop = quote == nullptr ? end : quote + 1;
+              Append(cursor, static_cast<size_t>(stop - cursor));
+              if (quote != nullptr) {
+                  m_output.push_back('"');
+              }
+              cursor = stop;
+          }
+          m_output.push_back('"');
+      }
+
+      char m_delimiter;
+  };
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace FileIngest
+{
+  template <typename T>
+  class Task;
+
+  namespace detail
+  {
+    // Resumes whoever awaited the task once it finishes, without growing the stack
+    struct TaskFinalAwaiter
+    {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct TaskPromiseBase
+    {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+
+        std::suspend_always initial_suspend() const noexcept {
+            return {};
+        }
+
+        TaskFinalAwaiter final_suspend() const noexcept {
+            return {};
+        }
+
+        void unhandled_exception() noexcept {
+            exception = std::current_exception();
+        }
+
+        void RethrowIfFailed() const {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+    };
+
+    template <typename T>
+    struct TaskPromise : TaskPromiseBase
+    {
+        std::optional<T> value;
+
+        Task<T> get_return_object() noexcept;
+
+        template <typename U>
+        void return_value(U&& result) {
+            value.emplace(std::forward<U>(result));
+        }
+
+        T TakeResult() {
+            RethrowIfFailed();
+            return std::move(*value);
+        }
+    };
+
+    template <>
+    struct TaskPromise<void> : TaskPromiseBase
+    {
+        Task<void> get_return_object() noexcept;
+
+        void return_void() const noexcept {}
+
+        void TakeResult() const {
+            RethrowIfFailed();
+        }
+    };
+  }
+
+  // Lazily started coroutine whose result, or exception, is delivered to the coroutine awaiting it.
+  // Unlike winrt::fire_and_forget it lets coroutine helpers return values and throw FileIngest
+  // exceptions with their type intact, which IAsyncOperation would flatten into an HRESULT.
+  template <typename T = void>
+  class Task
+  {
+  public:
+      using promise_type = detail::TaskPromise<T>;
+
+      explicit Task(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle) {}
+
+      Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+
+      Task& operator=(Task&& other) noexcept {
+          if (this != &other) {
+              if (m_handle) {
+                  m_handle.destroy();
+              }
+              m_handle = std::exchange(other.m_handle, {});
+          }
+          return *this;
+      }
+
+      Task(Task const&) = delete;
+      Task& operator=(Task const&) = delete;
+
+      ~Task() {
+          if (m_handle) {
+              m_handle.destroy();
+          }
+      }
+
+      struct Awaiter
+      {
+          std::coroutine_handle<promise_type> handle;
+
+          bool await_ready() const noexcept {
+              return false;
+          }
+
+          std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+              handle.promise().continuation = awaiting;
+              return handle;
+          }
+
+          T await_resume() {
+              return handle.promise().TakeResult();
+          }
+      };
+
+      Awaiter operator co_await() && noexcept {
+          return Awaiter{ m_handle };
+      }
+
+  private:
+      std::coroutine_handle<promise_type> m_handle;
+  };
+
+  namespace detail
+  {
+    template <typename T>
+    Task<T> TaskPromise<T>::get_return_object() noexcept {
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+  }
+}
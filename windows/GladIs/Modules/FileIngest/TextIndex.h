@@ -0,0 +1,994 @@
+#pragma once
+
+#include "Crc32.h"
+#include "Json.h"
+#include "LogFile.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace FileIngest
+{
+  struct TextIndexError : std::runtime_error
+  {
+      using std::runtime_error::runtime_error;
+  };
+
+  namespace detail
+  {
+    // ASCII base letters of U+0100-U+017F; '*' marks Œ and œ, which become "oe"
+    inline constexpr char kLatinExtendedA[129] =
+        "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiiiiijjkkkllllllllllnnnnnnnnnoooooo**rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+    // Elided French articles and pronouns: l', d', qu'... are dropped with their apostrophe
+    inline bool IsFrenchElision(std::string_view token) noexcept {
+        static constexpr std::string_view kElisions[] = { "c", "d", "j", "l", "m", "n", "s", "t", "qu", "jusqu", "lorsqu", "puisqu", "quoiqu" };
+        return std::find(std::begin(kElisions), std::end(kElisions), token) != std::end(kElisions);
+    }
+
+    // Words too common in French or English to tell documents apart, already folded
+    inline bool IsStopWord(std::string_view token) noexcept {
+        static const std::unordered_set<std::string_view> kStopWords = {
+            "au", "aux", "avec", "car", "ce", "ces", "cet", "cette", "dans", "de", "des", "donc", "du", "elle", "elles",
+            "en", "est", "et", "etre", "ete", "il", "ils", "la", "le", "les", "leur", "leurs", "mais", "ne", "nous", "on",
+            "ou", "par", "pas", "pour", "qui", "que", "quoi", "sa", "se", "ses", "son", "sont", "sur", "un", "une", "vous",
+            "an", "and", "are", "as", "at", "be", "but", "by", "for", "from", "had", "has", "have", "if", "in", "into",
+            "is", "it", "its", "no", "not", "of", "on", "or", "our", "that", "the", "their", "they", "this", "to", "was",
+            "we", "were", "will", "with", "you", "your",
+        };
+        return kStopWords.count(token) != 0;
+    }
+
+    // Decodes one UTF-8 sequence at `i`, advancing past it; invalid bytes read as U+FFFD
+    inline uint32_t NextCodePoint(std::string_view text, size_t& i) noexcept {
+        uint8_t lead = static_cast<uint8_t>(text[i++]);
+        if (lead < 0x80) {
+            return lead;
+        }
+        int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+        if (extra < 0 || lead >= 0xF8) {
+            return 0xFFFD;
+        }
+        uint32_t value = lead & (0x3F >> extra);
+        for (int k = 0; k < extra; k++) {
+            if (i >= text.size() || (static_cast<uint8_t>(text[i]) & 0xC0) != 0x80) {
+                return 0xFFFD;
+            }
+            value = value << 6 | (static_cast<uint8_t>(text[i++]) & 0x3F);
+        }
+        return value;
+    }
+
+    // Appends the folded form of a word character and returns true, or returns false for a
+    // character that separates words. Letters lose case and diacritics and ligatures are
+    // spelt out, so "Œuvre", "oeuvre" and "ŒUVRE" all read "oeuvre". Scripts other than Latin
+    // are kept as they are.
+    inline bool FoldCodePoint(uint32_t c, std::string& out) {
+        if (c < 0x80) {
+            if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+                out.push_back(static_cast<char>(c));
+                return true;
+            }
+            if (c >= 'A' && c <= 'Z') {
+                out.push_back(static_cast<char>(c - 'A' + 'a'));
+                return true;
+            }
+            return false;
+        }
+        if (c >= 0xC0 && c <= 0xFF) {
+            static constexpr char kLatin1[65] = "aaaaaaaceeeeiiiidnooooo_ouuuuyt_aaaaaaaceeeeiiiidnooooo_ouuuuyty";
+            if (c == 0xC6 || c == 0xE6) {
+                out += "ae";
+            } else if (c == 0xDF) {
+                out += "ss";
+            } else if (c == 0xDE || c == 0xFE) {
+                out += "th";
+            } else if (kLatin1[c - 0xC0] == '_') {
+                return false;
+            } else {
+                out.push_back(kLatin1[c - 0xC0]);
+            }
+            return true;
+        }
+        if (c >= 0x100 && c <= 0x17F) {
+            char base = kLatinExtendedA[c - 0x100];
+            if (base == '*') {
+                out += "oe";
+            } else {
+                out.push_back(base);
+            }
+            return true;
+        }
+        if (c >= 0x300 && c <= 0x36F) {
+            // Combining marks, as in decomposed accented letters, belong to the word and are dropped
+            return true;
+        }
+        if (c >= 0xFB00 && c <= 0xFB06) {
+            static constexpr std::string_view kLigatures[] = { "ff", "fi", "fl", "ffi", "ffl", "st", "st" };
+            out += kLigatures[c - 0xFB00];
+            return true;
+        }
+        bool separator = c < 0xC0 // Latin-1 punctuation, symbols and spaces
+            || (c >= 0x2000 && c <= 0x2BFF) // general punctuation, symbols, arrows, shapes
+            || (c >= 0x3000 && c <= 0x303F)
+            || (c >= 0xFE00 && c <= 0xFE0F)
+            || (c >= 0xFF00 && c <= 0xFF0F)
+            || c == 0xFFFD
+            || c >= 0x1F000; // emoji
+        if (separator) {
+            return false;
+        }
+        AppendUtf8(out, c);
+        return true;
+    }
+
+    // Light plural removal, the same for both languages: "procédures" and "procedure" match,
+    // as do "policies" and "policy", "bateaux" and "bateau", "journaux" and "journal"
+    inline void StripPlural(std::string& token) {
+        size_t n = token.size();
+        auto endsWith = [&](std::string_view suffix) {
+            return n >= suffix.size() && token.compare(n - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        if (n <= 3) {
+            return;
+        }
+        if (endsWith("eaux")) {
+            token.pop_back();
+        } else if (n > 4 && endsWith("ies")) {
+            token.replace(n - 3, 3, "y");
+        } else if (n > 4 && endsWith("aux")) {
+            token.replace(n - 3, 3, "al");
+        } else if (token[n - 1] == 's' && token[n - 2] != 's' && token[n - 2] != 'u' && token[n - 2] != 'i') {
+            token.pop_back();
+        }
+    }
+  }
+
+  // Splits UTF-8 text into the terms the index stores, calling `onTerm(std::string const&)` for
+  // each in order: folded to lower-case ASCII where the letter is Latin, with French elisions
+  // (l'audit, qu'il, d’une) and single letters dropped, stop words of either language skipped
+  // and plurals reduced. Queries go through the same steps, so a search for "Procédures"
+  // finds "procedure". Returns the number of terms.
+  template <typename OnTerm>
+  size_t TokenizeText(std::string_view text, OnTerm&& onTerm) {
+      static constexpr size_t kMaxTermLength = 48;
+      size_t count = 0;
+      std::string token;
+      auto finish = [&]() {
+          if (token.size() >= 2 && token.size() <= kMaxTermLength && !detail::IsStopWord(token)) {
+              detail::StripPlural(token);
+              onTerm(static_cast<std::string const&>(token));
+              count++;
+          }
+          token.clear();
+      };
+      for (size_t i = 0; i < text.size();) {
+          uint32_t c = detail::NextCodePoint(text, i);
+          if (c == '\'' || c == 0x2019 || c == 0x02BC) {
+              if (detail::IsFrenchElision(token)) {
+                  token.clear();
+              } else {
+                  finish();
+              }
+              continue;
+          }
+          if (!detail::FoldCodePoint(c, token)) {
+              finish();
+          }
+      }
+      finish();
+      return count;
+  }
+
+  namespace detail
+  {
+    struct TextManifestHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        // Of the segment ids that follow
+        uint32_t crc;
+        uint32_t segmentCount;
+        uint64_t nextSegmentId;
+    };
+
+    // Sections follow in this order, each at an offset from the start of the file. The CRC
+    // covers everything after the header.
+    struct TextSegmentHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t crc;
+        uint32_t documentCount;
+        uint32_t removeCount;
+        uint32_t termCount;
+        uint64_t documentsOffset;
+        uint64_t removesOffset;
+        uint64_t termsOffset;
+        uint64_t stringsOffset;
+        uint64_t postingsOffset;
+        uint64_t fileSize;
+    };
+
+    // Keys and term texts live in the strings section, at an offset from its start
+    struct TextSegmentDocument
+    {
+        uint64_t keyOffset;
+        uint32_t keyLength;
+        // Terms the document has, repeats included, for length normalisation
+        uint32_t termCount;
+    };
+
+    // A key removed by the commit that wrote the segment
+    struct TextSegmentRemove
+    {
+        uint64_t keyOffset;
+        uint32_t keyLength;
+        uint32_t reserved;
+    };
+
+    // Sorted by text. Postings are varint pairs (document id delta, term frequency) in
+    // ascending document order, at an offset from the start of the postings section.
+    struct TextSegmentTerm
+    {
+        uint64_t textOffset;
+        uint64_t postingsOffset;
+        uint32_t textLength;
+        uint32_t documentFrequency;
+        uint32_t postingsLength;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(TextManifestHeader) == 24);
+    static_assert(sizeof(TextSegmentHeader) == 72);
+    static_assert(sizeof(TextSegmentDocument) == 16);
+    static_assert(sizeof(TextSegmentRemove) == 16);
+    static_assert(sizeof(TextSegmentTerm) == 32);
+
+    struct TextPosting
+    {
+        uint32_t document;
+        uint32_t frequency;
+    };
+
+    inline void AppendVarint(std::vector<uint8_t>& out, uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    // Returns false at the end of the data or on a varint longer than 32 bits
+    inline bool ReadVarint(const uint8_t*& next, const uint8_t* end, uint32_t& value) noexcept {
+        value = 0;
+        for (int shift = 0; shift < 35 && next < end; shift += 7) {
+            uint8_t byte = *next++;
+            value |= uint32_t(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // One segment's content before it is written: documents in id order, removed keys, and
+    // each term's postings in document order
+    struct TextSegmentBuilder
+    {
+        std::vector<std::pair<std::string, uint32_t>> documents;
+        std::vector<std::string> removes;
+        std::map<std::string, std::vector<TextPosting>> terms;
+
+        std::vector<uint8_t> Build() const {
+            std::vector<uint8_t> strings;
+            std::vector<uint8_t> postings;
+            auto addString = [&strings](std::string const& text) {
+                uint64_t offset = strings.size();
+                strings.insert(strings.end(), text.begin(), text.end());
+                return offset;
+            };
+            std::vector<TextSegmentDocument> documentTable;
+            documentTable.reserve(documents.size());
+            for (auto const& document : documents) {
+                documentTable.push_back(TextSegmentDocument{ addString(document.first), static_cast<uint32_t>(document.first.size()), document.second });
+            }
+            std::vector<TextSegmentRemove> removeTable;
+            removeTable.reserve(removes.size());
+            for (std::string const& key : removes) {
+                removeTable.push_back(TextSegmentRemove{ addString(key), static_cast<uint32_t>(key.size()), 0 });
+            }
+            std::vector<TextSegmentTerm> termTable;
+            termTable.reserve(terms.size());
+            for (auto const& [text, list] : terms) {
+                TextSegmentTerm term{};
+                term.textOffset = addString(text);
+                term.textLength = static_cast<uint32_t>(text.size());
+                term.documentFrequency = static_cast<uint32_t>(list.size());
+                term.postingsOffset = postings.size();
+                uint32_t previous = 0;
+                for (TextPosting const& posting : list) {
+                    AppendVarint(postings, posting.document - previous);
+                    AppendVarint(postings, posting.frequency);
+                    previous = posting.document;
+                }
+                term.postingsLength = static_cast<uint32_t>(postings.size() - term.postingsOffset);
+                termTable.push_back(term);
+            }
+
+            TextSegmentHeader header{};
+            header.magic = kTextSegmentMagic;
+            header.version = kTextSegmentVersion;
+            header.documentCount = static_cast<uint32_t>(documentTable.size());
+            header.removeCount = static_cast<uint32_t>(removeTable.size());
+            header.termCount = static_cast<uint32_t>(termTable.size());
+            header.documentsOffset = sizeof(header);
+            header.removesOffset = header.documentsOffset + documentTable.size() * sizeof(TextSegmentDocument);
+            header.termsOffset = header.removesOffset + removeTable.size() * sizeof(TextSegmentRemove);
+            header.stringsOffset = header.termsOffset + termTable.size() * sizeof(TextSegmentTerm);
+            header.postingsOffset = header.stringsOffset + strings.size();
+            header.fileSize = header.postingsOffset + postings.size();
+
+            std::vector<uint8_t> file(static_cast<size_t>(header.fileSize));
+            auto put = [&file](uint64_t offset, const void* data, size_t length) {
+                if (length > 0) {
+                    std::memcpy(file.data() + offset, data, length);
+                }
+            };
+            put(header.documentsOffset, documentTable.data(), documentTable.size() * sizeof(TextSegmentDocument));
+            put(header.removesOffset, removeTable.data(), removeTable.size() * sizeof(TextSegmentRemove));
+            put(header.termsOffset, termTable.data(), termTable.size() * sizeof(TextSegmentTerm));
+            put(header.stringsOffset, strings.data(), strings.size());
+            put(header.postingsOffset, postings.data(), postings.size());
+            header.crc = Crc32(0, file.data() + sizeof(header), file.size() - sizeof(header));
+            put(0, &header, sizeof(header));
+            return file;
+        }
+
+        static constexpr uint32_t kTextSegmentMagic = 0x53584954; // "TIXS"
+        static constexpr uint32_t kTextSegmentVersion = 1;
+    };
+
+    // A segment file mapped read-only, checked in full when opened. Which of its documents are
+    // still live depends on the segments written after it and is kept here in memory.
+    class TextSegment
+    {
+    public:
+        TextSegment(std::filesystem::path path, uint64_t id) : m_path(std::move(path)), m_id(id), m_file(m_path, MappedFile::Mode::ReadOnly) {
+            const uint8_t* data = m_file.Data();
+            uint64_t size = m_file.Size();
+            if (size < sizeof(TextSegmentHeader)) {
+                throw TextIndexError("Text index segment is truncated: " + m_path.filename().string());
+            }
+            std::memcpy(&m_header, data, sizeof(m_header));
+            bool valid = m_header.magic == TextSegmentBuilder::kTextSegmentMagic
+                && m_header.version == TextSegmentBuilder::kTextSegmentVersion
+                && m_header.fileSize == size
+                && m_header.documentsOffset == sizeof(TextSegmentHeader)
+                && m_header.removesOffset == m_header.documentsOffset + uint64_t(m_header.documentCount) * sizeof(TextSegmentDocument)
+                && m_header.termsOffset == m_header.removesOffset + uint64_t(m_header.removeCount) * sizeof(TextSegmentRemove)
+                && m_header.stringsOffset == m_header.termsOffset + uint64_t(m_header.termCount) * sizeof(TextSegmentTerm)
+                && m_header.postingsOffset >= m_header.stringsOffset
+                && m_header.postingsOffset <= size
+                && m_header.crc == Crc32(0, data + sizeof(TextSegmentHeader), static_cast<size_t>(size - sizeof(TextSegmentHeader)));
+            if (!valid) {
+                throw TextIndexError("Text index segment is corrupted: " + m_path.filename().string());
+            }
+            m_documents = reinterpret_cast<const TextSegmentDocument*>(data + m_header.documentsOffset);
+            m_removes = reinterpret_cast<const TextSegmentRemove*>(data + m_header.removesOffset);
+            m_terms = reinterpret_cast<const TextSegmentTerm*>(data + m_header.termsOffset);
+            m_strings = reinterpret_cast<const char*>(data + m_header.stringsOffset);
+            m_postings = data + m_header.postingsOffset;
+            uint64_t stringsSize = m_header.postingsOffset - m_header.stringsOffset;
+            uint64_t postingsSize = size - m_header.postingsOffset;
+            for (uint32_t i = 0; i < m_header.documentCount; i++) {
+                valid = valid && m_documents[i].keyOffset + m_documents[i].keyLength <= stringsSize;
+            }
+            for (uint32_t i = 0; i < m_header.removeCount; i++) {
+                valid = valid && m_removes[i].keyOffset + m_removes[i].keyLength <= stringsSize;
+            }
+            for (uint32_t i = 0; i < m_header.termCount; i++) {
+                valid = valid && m_terms[i].textOffset + m_terms[i].textLength <= stringsSize
+                    && m_terms[i].postingsOffset + m_terms[i].postingsLength <= postingsSize;
+            }
+            if (!valid) {
+                throw TextIndexError("Text index segment is corrupted: " + m_path.filename().string());
+            }
+            m_live.assign(m_header.documentCount, 0);
+        }
+
+        std::filesystem::path const& Path() const noexcept {
+            return m_path;
+        }
+
+        uint64_t Id() const noexcept {
+            return m_id;
+        }
+
+        uint64_t FileSize() const noexcept {
+            return m_header.fileSize;
+        }
+
+        uint32_t DocumentCount() const noexcept {
+            return m_header.documentCount;
+        }
+
+        uint32_t RemoveCount() const noexcept {
+            return m_header.removeCount;
+        }
+
+        uint32_t TermCount() const noexcept {
+            return m_header.termCount;
+        }
+
+        std::string_view Key(uint32_t document) const noexcept {
+            return std::string_view(m_strings + m_documents[document].keyOffset, m_documents[document].keyLength);
+        }
+
+        uint32_t DocumentTermCount(uint32_t document) const noexcept {
+            return m_documents[document].termCount;
+        }
+
+        std::string_view RemovedKey(uint32_t index) const noexcept {
+            return std::string_view(m_strings + m_removes[index].keyOffset, m_removes[index].keyLength);
+        }
+
+        std::string_view TermText(uint32_t term) const noexcept {
+            return std::string_view(m_strings + m_terms[term].textOffset, m_terms[term].textLength);
+        }
+
+        uint32_t DocumentFrequency(uint32_t term) const noexcept {
+            return m_terms[term].documentFrequency;
+        }
+
+        // Index of the first term not less than `text`
+        uint32_t LowerBound(std::string_view text) const noexcept {
+            uint32_t low = 0;
+            uint32_t high = m_header.termCount;
+            while (low < high) {
+                uint32_t middle = low + (high - low) / 2;
+                if (TermText(middle) < text) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            return low;
+        }
+
+        // Calls `visit(document, frequency)` for each posting of `term`; stops at damage
+        template <typename Visit>
+        void ForEachPosting(uint32_t term, Visit&& visit) const {
+            const uint8_t* next = m_postings + m_terms[term].postingsOffset;
+            const uint8_t* end = next + m_terms[term].postingsLength;
+            uint32_t document = 0;
+            uint32_t delta = 0;
+            uint32_t frequency = 0;
+            while (next < end && ReadVarint(next, end, delta) && ReadVarint(next, end, frequency)) {
+                document += delta;
+                if (document >= m_header.documentCount) {
+                    return;
+                }
+                visit(document, frequency);
+            }
+        }
+
+        bool IsLive(uint32_t document) const noexcept {
+            return m_live[document] != 0;
+        }
+
+        void SetLive(uint32_t document, bool live) noexcept {
+            m_live[document] = live ? 1 : 0;
+        }
+
+        // Unmaps the file, which Windows requires before it can be deleted
+        void Close() noexcept {
+            m_file.Close();
+        }
+
+    private:
+        std::filesystem::path m_path;
+        uint64_t m_id;
+        MappedFile m_file;
+        TextSegmentHeader m_header{};
+        const TextSegmentDocument* m_documents = nullptr;
+        const TextSegmentRemove* m_removes = nullptr;
+        const TextSegmentTerm* m_terms = nullptr;
+        const char* m_strings = nullptr;
+        const uint8_t* m_postings = nullptr;
+        std::vector<uint8_t> m_live;
+    };
+  }
+
+  struct TextIndexStats
+  {
+      // Live documents, as a search sees them
+      uint64_t documents = 0;
+      uint64_t segments = 0;
+      // Summed over segments, so a term in several segments counts once for each
+      uint64_t terms = 0;
+      uint64_t diskBytes = 0;
+      uint64_t pendingAdds = 0;
+      uint64_t pendingRemoves = 0;
+      uint64_t commits = 0;
+      uint64_t merges = 0;
+      uint64_t searches = 0;
+  };
+
+  struct TextSearchHit
+  {
+      std::string key;
+      double score = 0;
+      // Query terms the document contains
+      uint32_t matchedTerms = 0;
+  };
+
+  // Incremental inverted index of text documents, each under a caller's key, in a directory of
+  // immutable segment files. Add and Remove queue changes in memory; Commit writes them as one
+  // new segment and then the MANIFEST listing the segments in order, swapped in with a rename, so
+  // a crash loses at most the uncommitted changes. A later segment's document replaces any
+  // earlier one with the same key. Once there are more than kMaxSegments segments, they are
+  // merged into one holding only live documents.
+  //
+  // Search ranks documents first by how many query terms they contain, then by BM25 (k1 = 1.2,
+  // b = 0.75). Document frequencies count replaced documents until the next merge, as other
+  // segment-based engines do. Searches run in parallel with each other and with everything
+  // but the moment a commit or merge swaps its segment in.
+  class TextIndex
+  {
+  public:
+      static constexpr size_t kMaxSegments = 8;
+      static constexpr size_t kMaxKeyLength = 1024;
+      static constexpr size_t kMaxQueryTerms = 32;
+      // Terms a prefix may stand for in each segment
+      static constexpr size_t kMaxPrefixExpansions = 64;
+
+      // Throws TextIndexError when the MANIFEST or a segment it lists is corrupted; the index is
+      // derived data, so callers may delete the directory and index again
+      explicit TextIndex(std::filesystem::path root) : m_root(std::move(root)) {
+          std::filesystem::create_directories(m_root);
+          std::vector<uint64_t> ids = ReadManifest();
+          std::unordered_set<std::string> listed;
+          for (uint64_t id : ids) {
+              listed.insert(SegmentName(id));
+          }
+          // Segments of a commit that crashed before its MANIFEST, and leftover temporaries
+          std::error_code ignored;
+          for (auto const& entry : std::filesystem::directory_iterator(m_root)) {
+              std::string name = entry.path().filename().string();
+              if (name != kManifestName && listed.count(name) == 0) {
+                  std::filesystem::remove(entry.path(), ignored);
+              }
+          }
+          for (uint64_t id : ids) {
+              m_segments.push_back(std::make_unique<detail::TextSegment>(m_root / SegmentName(id), id));
+              Apply(*m_segments.back());
+          }
+      }
+
+      TextIndex(TextIndex const&) = delete;
+      TextIndex& operator=(TextIndex const&) = delete;
+
+      // Queues `text` as the document of `key`, replacing what an earlier Add gave it
+      void Add(std::string_view key, std::string_view text) {
+          CheckKey(key);
+          PendingDocument document;
+          std::unordered_map<std::string, uint32_t> frequencies;
+          document.termCount = static_cast<uint32_t>(TokenizeText(text, [&frequencies](std::string const& term) { frequencies[term]++; }));
+          document.terms.assign(frequencies.begin(), frequencies.end());
+          std::lock_guard<std::mutex> lock(m_pendingMutex);
+          m_pendingRemoves.erase(std::string(key));
+          m_pendingAdds[std::string(key)] = std::move(document);
+      }
+
+      void Remove(std::string_view key) {
+          CheckKey(key);
+          std::lock_guard<std::mutex> lock(m_pendingMutex);
+          m_pendingAdds.erase(std::string(key));
+          m_pendingRemoves.insert(std::string(key));
+      }
+
+      // Writes the queued changes as a new segment and makes them visible to searches. Returns
+      // false when nothing was queued.
+      bool Commit() {
+          std::lock_guard<std::mutex> commit(m_commitMutex);
+          detail::TextSegmentBuilder builder;
+          {
+              std::lock_guard<std::mutex> lock(m_pendingMutex);
+              if (m_pendingAdds.empty() && m_pendingRemoves.empty()) {
+                  return false;
+              }
+              std::vector<std::pair<std::string, PendingDocument>> adds(std::make_move_iterator(m_pendingAdds.begin()), std::make_move_iterator(m_pendingAdds.end()));
+              std::sort(adds.begin(), adds.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+              builder.removes.assign(m_pendingRemoves.begin(), m_pendingRemoves.end());
+              std::sort(builder.removes.begin(), builder.removes.end());
+              m_pendingAdds.clear();
+              m_pendingRemoves.clear();
+              for (auto& [key, document] : adds) {
+                  uint32_t id = static_cast<uint32_t>(builder.documents.size());
+                  builder.documents.emplace_back(std::move(key), document.termCount);
+                  for (auto& [term, frequency] : document.terms) {
+                      builder.terms[term].push_back(detail::TextPosting{ id, frequency });
+                  }
+              }
+          }
+          auto segment = WriteSegment(builder);
+          std::vector<uint64_t> ids = SegmentIds();
+          ids.push_back(segment->Id());
+          WriteManifest(ids);
+          {
+              std::unique_lock<std::shared_mutex> lock(m_mutex);
+              m_segments.push_back(std::move(segment));
+              Apply(*m_segments.back());
+          }
+          m_commits.fetch_add(1, std::memory_order_relaxed);
+          if (m_segments.size() > kMaxSegments) {
+              MergeLocked();
+          }
+          return true;
+      }
+
+      // Merges every segment into one now, dropping replaced and removed documents
+      void Merge() {
+          std::lock_guard<std::mutex> commit(m_commitMutex);
+          if (!m_segments.empty()) {
+              MergeLocked();
+          }
+      }
+
+      // Whether a committed, live document has `key`
+      bool Contains(std::string_view key) {
+          std::shared_lock<std::shared_mutex> lock(m_mutex);
+          return m_latest.count(std::string(key)) != 0;
+      }
+
+      // The best `limit` documents for `query`. With `prefix` set and the query not ending in a
+      // space, its last term also matches longer terms it starts, for search as you type.
+      std::vector<TextSearchHit> Search(std::string_view query, size_t limit, bool prefix = true) {
+          m_searches.fetch_add(1, std::memory_order_relaxed);
+          std::vector<std::string> terms;
+          TokenizeText(query, [&terms](std::string const& term) {
+              if (terms.size() < kMaxQueryTerms && std::find(terms.begin(), terms.end(), term) == terms.end()) {
+                  terms.push_back(term);
+              }
+          });
+          std::vector<TextSearchHit> hits;
+          if (terms.empty() || limit == 0) {
+              return hits;
+          }
+          bool expandLast = prefix && !query.empty() && query.back() != ' ';
+          std::string lastTerm = LastQueryTerm(query);
+
+          std::shared_lock<std::shared_mutex> lock(m_mutex);
+          if (m_liveDocuments == 0) {
+              return hits;
+          }
+          // Each match is a term of one segment that stands for one query term
+          struct Match
+          {
+              size_t segment;
+              uint32_t term;
+              uint32_t queryTerm;
+          };
+          std::vector<Match> matches;
+          std::unordered_map<std::string_view, uint64_t> frequencies;
+          for (size_t s = 0; s < m_segments.size(); s++) {
+              detail::TextSegment const& segment = *m_segments[s];
+              for (uint32_t q = 0; q < terms.size(); q++) {
+                  std::string const& term = terms[q];
+                  uint32_t first = segment.LowerBound(term);
+                  bool expand = expandLast && term == lastTerm;
+                  for (uint32_t t = first, expansions = 0; t < segment.TermCount(); t++) {
+                      std::string_view text = segment.TermText(t);
+                      bool exact = text == term;
+                      if (!exact && !(expand && text.substr(0, term.size()) == term && expansions++ < kMaxPrefixExpansions)) {
+                          break;
+                      }
+                      matches.push_back(Match{ s, t, q });
+                      frequencies[text] += segment.DocumentFrequency(t);
+                      if (exact && !expand) {
+                          break;
+                      }
+                  }
+              }
+          }
+
+          constexpr double k1 = 1.2;
+          constexpr double b = 0.75;
+          double documentCount = static_cast<double>(m_liveDocuments);
+          double averageLength = std::max(1.0, static_cast<double>(m_liveTerms) / documentCount);
+          struct Candidate
+          {
+              size_t segment;
+              uint32_t document;
+              double score;
+              uint32_t matched;
+          };
+          std::vector<Candidate> candidates;
+          std::vector<double> scores;
+          std::vector<uint32_t> masks;
+          size_t next = 0;
+          for (size_t s = 0; s < m_segments.size(); s++) {
+              detail::TextSegment const& segment = *m_segments[s];
+              if (next == matches.size() || matches[next].segment != s) {
+                  continue;
+              }
+              scores.assign(segment.DocumentCount(), 0);
+              masks.assign(segment.DocumentCount(), 0);
+              for (; next < matches.size() && matches[next].segment == s; next++) {
+                  Match const& match = matches[next];
+                  double frequency = static_cast<double>(frequencies[segment.TermText(match.term)]);
+                  double idf = std::log(1 + (documentCount - frequency + 0.5) / (frequency + 0.5));
+                  segment.ForEachPosting(match.term, [&](uint32_t document, uint32_t count) {
+                      double tf = count;
+                      double length = segment.DocumentTermCount(document) / averageLength;
+                      scores[document] += std::max(idf, 0.01) * tf * (k1 + 1) / (tf + k1 * (1 - b + b * length));
+                      masks[document] |= 1u << match.queryTerm;
+                  });
+              }
+              for (uint32_t d = 0; d < segment.DocumentCount(); d++) {
+                  if (masks[d] != 0 && segment.IsLive(d)) {
+                      candidates.push_back(Candidate{ s, d, scores[d], static_cast<uint32_t>(std::popcount(masks[d])) });
+                  }
+              }
+          }
+          auto better = [this](Candidate const& a, Candidate const& c) {
+              if (a.matched != c.matched) {
+                  return a.matched > c.matched;
+              }
+              if (a.score != c.score) {
+                  return a.score > c.score;
+              }
+              return m_segments[a.segment]->Key(a.document) < m_segments[c.segment]->Key(c.document);
+          };
+          size_t count = std::min(limit, candidates.size());
+          std::partial_sort(candidates.begin(), candidates.begin() + static_cast<ptrdiff_t>(count), candidates.end(), better);
+          hits.reserve(count);
+          for (size_t i = 0; i < count; i++) {
+              Candidate const& candidate = candidates[i];
+              hits.push_back(TextSearchHit{ std::string(m_segments[candidate.segment]->Key(candidate.document)), candidate.score, candidate.matched });
+          }
+          return hits;
+      }
+
+      TextIndexStats Stats() {
+          TextIndexStats stats;
+          {
+              std::lock_guard<std::mutex> lock(m_pendingMutex);
+              stats.pendingAdds = m_pendingAdds.size();
+              stats.pendingRemoves = m_pendingRemoves.size();
+          }
+          std::shared_lock<std::shared_mutex> lock(m_mutex);
+          stats.documents = m_liveDocuments;
+          stats.segments = m_segments.size();
+          for (auto const& segment : m_segments) {
+              stats.terms += segment->TermCount();
+              stats.diskBytes += segment->FileSize();
+          }
+          stats.commits = m_commits.load(std::memory_order_relaxed);
+          stats.merges = m_merges.load(std::memory_order_relaxed);
+          stats.searches = m_searches.load(std::memory_order_relaxed);
+          return stats;
+      }
+
+  private:
+      static constexpr uint32_t kManifestMagic = 0x4D584954; // "TIXM"
+      static constexpr uint32_t kManifestVersion = 1;
+      static constexpr const char* kManifestName = "MANIFEST";
+
+      struct PendingDocument
+      {
+          uint32_t termCount = 0;
+          std::vector<std::pair<std::string, uint32_t>> terms;
+      };
+
+      struct DocumentRef
+      {
+          detail::TextSegment* segment;
+          uint32_t document;
+      };
+
+      static void CheckKey(std::string_view key) {
+          if (key.empty() || key.size() > kMaxKeyLength) {
+              throw TextIndexError("Invalid text index key");
+          }
+      }
+
+      static std::string SegmentName(uint64_t id) {
+          char name[32];
+          std::snprintf(name, sizeof(name), "%016llx.seg", static_cast<unsigned long long>(id));
+          return name;
+      }
+
+      // The query's last term when the query ends inside it, for prefix matching
+      static std::string LastQueryTerm(std::string_view query) {
+          std::string last;
+          TokenizeText(query, [&last](std::string const& term) { last = term; });
+          return last;
+      }
+
+      std::vector<uint64_t> SegmentIds() const {
+          std::vector<uint64_t> ids;
+          for (auto const& segment : m_segments) {
+              ids.push_back(segment->Id());
+          }
+          return ids;
+      }
+
+      std::vector<uint64_t> ReadManifest() {
+          std::filesystem::path path = m_root / kManifestName;
+          if (!std::filesystem::exists(path)) {
+              return {};
+          }
+          MappedFile file(path, MappedFile::Mode::ReadOnly);
+          detail::TextManifestHeader header{};
+          if (file.Size() >= sizeof(header)) {
+              std::memcpy(&header, file.Data(), sizeof(header));
+          }
+          const uint8_t* ids = file.Data() + sizeof(header);
+          bool valid = file.Size() >= sizeof(header)
+              && header.magic == kManifestMagic
+              && header.version == kManifestVersion
+              && file.Size() == sizeof(header) + uint64_t(header.segmentCount) * sizeof(uint64_t)
+              && header.crc == Crc32(0, ids, header.segmentCount * sizeof(uint64_t));
+          if (!valid) {
+              throw TextIndexError("Text index manifest is corrupted");
+          }
+          std::vector<uint64_t> result(header.segmentCount);
+          std::memcpy(result.data(), ids, result.size() * sizeof(uint64_t));
+          m_nextSegmentId = header.nextSegmentId;
+          return result;
+      }
+
+      void WriteManifest(std::vector<uint64_t> const& ids) {
+          detail::TextManifestHeader header{};
+          header.magic = kManifestMagic;
+          header.version = kManifestVersion;
+          header.segmentCount = static_cast<uint32_t>(ids.size());
+          header.nextSegmentId = m_nextSegmentId;
+          header.crc = Crc32(0, reinterpret_cast<const uint8_t*>(ids.data()), ids.size() * sizeof(uint64_t));
+          std::filesystem::path temporary = m_root / "MANIFEST.tmp";
+          std::filesystem::remove(temporary);
+          {
+              LogFile file(temporary);
+              file.Append(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+              file.Append(reinterpret_cast<const uint8_t*>(ids.data()), ids.size() * sizeof(uint64_t));
+              file.Sync();
+          }
+          std::filesystem::rename(temporary, m_root / kManifestName);
+      }
+
+      std::unique_ptr<detail::TextSegment> WriteSegment(detail::TextSegmentBuilder const& builder) {
+          std::vector<uint8_t> bytes = builder.Build();
+          uint64_t id = m_nextSegmentId++;
+          std::filesystem::path path = m_root / SegmentName(id);
+          std::filesystem::path temporary = path;
+          temporary += ".tmp";
+          std::filesystem::remove(temporary);
+          {
+              LogFile file(temporary);
+              file.Append(bytes.data(), bytes.size());
+              file.Sync();
+          }
+          std::filesystem::rename(temporary, path);
+          return std::make_unique<detail::TextSegment>(path, id);
+      }
+
+      // Makes a segment's documents replace earlier ones with the same keys, and its removes
+      // take effect. Called with m_mutex held exclusively, or while opening.
+      void Apply(detail::TextSegment& segment) {
+          auto retire = [this](DocumentRef const& old) {
+              old.segment->SetLive(old.document, false);
+              m_liveDocuments--;
+              m_liveTerms -= old.segment->DocumentTermCount(old.document);
+          };
+          for (uint32_t r = 0; r < segment.RemoveCount(); r++) {
+              auto found = m_latest.find(std::string(segment.RemovedKey(r)));
+              if (found != m_latest.end()) {
+                  retire(found->second);
+                  m_latest.erase(found);
+              }
+          }
+          for (uint32_t d = 0; d < segment.DocumentCount(); d++) {
+              auto [entry, inserted] = m_latest.try_emplace(std::string(segment.Key(d)), DocumentRef{ &segment, d });
+              if (!inserted) {
+                  retire(entry->second);
+                  entry->second = DocumentRef{ &segment, d };
+              }
+              segment.SetLive(d, true);
+              m_liveDocuments++;
+              m_liveTerms += segment.DocumentTermCount(d);
+          }
+      }
+
+      // Rewrites the live documents of every segment as one. Called with m_commitMutex held,
+      // which is all that changes segments, so reading them here needs no other lock.
+      void MergeLocked() {
+          detail::TextSegmentBuilder builder;
+          std::vector<std::vector<uint32_t>> renumbered(m_segments.size());
+          for (size_t s = 0; s < m_segments.size(); s++) {
+              detail::TextSegment const& segment = *m_segments[s];
+              renumbered[s].assign(segment.DocumentCount(), UINT32_MAX);
+              for (uint32_t d = 0; d < segment.DocumentCount(); d++) {
+                  if (segment.IsLive(d)) {
+                      renumbered[s][d] = static_cast<uint32_t>(builder.documents.size());
+                      builder.documents.emplace_back(std::string(segment.Key(d)), segment.DocumentTermCount(d));
+                  }
+              }
+          }
+          // Segments in order give each term's postings in ascending new ids
+          for (size_t s = 0; s < m_segments.size(); s++) {
+              detail::TextSegment const& segment = *m_segments[s];
+              for (uint32_t t = 0; t < segment.TermCount(); t++) {
+                  std::vector<detail::TextPosting>* list = nullptr;
+                  segment.ForEachPosting(t, [&](uint32_t document, uint32_t frequency) {
+                      if (renumbered[s][document] == UINT32_MAX) {
+                          return;
+                      }
+                      if (list == nullptr) {
+                          list = &builder.terms[std::string(segment.TermText(t))];
+                      }
+                      list->push_back(detail::TextPosting{ renumbered[s][document], frequency });
+                  });
+              }
+          }
+          auto merged = WriteSegment(builder);
+          WriteManifest({ merged->Id() });
+          std::vector<std::unique_ptr<detail::TextSegment>> old;
+          {
+              std::unique_lock<std::shared_mutex> lock(m_mutex);
+              old.swap(m_segments);
+              m_latest.clear();
+              m_liveDocuments = 0;
+              m_liveTerms = 0;
+              m_segments.push_back(std::move(merged));
+              Apply(*m_segments.back());
+          }
+          std::error_code ignored;
+          for (auto& segment : old) {
+              segment->Close();
+              std::filesystem::remove(segment->Path(), ignored);
+          }
+          m_merges.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      std::filesystem::path m_root;
+      // Held by Commit and Merge for their whole run, so there is one writer at a time
+      std::mutex m_commitMutex;
+      // Guards the segments, their liveness and m_latest; searches hold it shared
+      std::shared_mutex m_mutex;
+      std::vector<std::unique_ptr<detail::TextSegment>> m_segments;
+      std::unordered_map<std::string, DocumentRef> m_latest;
+      uint64_t m_liveDocuments = 0;
+      uint64_t m_liveTerms = 0;
+      uint64_t m_nextSegmentId = 1;
+
+      std::mutex m_pendingMutex;
+      std::unordered_map<std::string, PendingDocument> m_pendingAdds;
+      std::unordered_set<std::string> m_pendingRemoves;
+
+      std::atomic<uint64_t> m_commits{ 0 };
+      std::atomic<uint64_t> m_merges{ 0 };
+      std::atomic<uint64_t> m_searches{ 0 };
+  };
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace FileIngest
+{
+  // Steps a file goes through between the picker and the JS promise
+  enum class TraceStage : uint8_t
+  {
+      Pick,
+      Open,
+      Sniff,
+      Load,
+      Decode,
+      Resize,
+      Reencode,
+      Encode,
+      Parse,
+      Store,
+      Compress,
+      Upload,
+      ReadRange,
+      Resolve,
+      Chunk,
+      Download,
+      Count,
+  };
+
+  inline constexpr size_t kTraceStageCount = static_cast<size_t>(TraceStage::Count);
+
+  inline constexpr std::string_view kTraceStageNames[kTraceStageCount] = {
+      "pick", "open", "sniff", "load", "decode", "resize", "reencode", "encode", "parse", "store", "compress", "upload", "readRange", "resolve", "chunk", "download",
+  };
+
+  constexpr std::string_view TraceStageName(TraceStage stage) noexcept {
+      return kTraceStageNames[static_cast<size_t>(stage)];
+  }
+
+  // Latency histograms are split by the number of bytes the stage handled. Class i holds sizes
+  // below kTraceSizeClassLimits[i]; the last class holds everything larger.
+  inline constexpr uint64_t kTraceSizeClassLimits[] = { 64 * 1024, 1024 * 1024, 8 * 1024 * 1024, 64 * 1024 * 1024 };
+  inline constexpr size_t kTraceSizeClassCount = std::size(kTraceSizeClassLimits) + 1;
+
+  // Bucket 0 holds latencies under 1 us, bucket k those in [2^(k-1), 2^k) us, and the last
+  // bucket everything from about 4 s up
+  inline constexpr size_t kTraceLatencyBucketCount = 24;
+
+  constexpr size_t TraceSizeClass(uint64_t bytes) noexcept {
+      size_t sizeClass = 0;
+      while (sizeClass < std::size(kTraceSizeClassLimits) && bytes >= kTraceSizeClassLimits[sizeClass]) {
+          sizeClass++;
+      }
+      return sizeClass;
+  }
+
+  constexpr size_t TraceLatencyBucket(uint64_t nanoseconds) noexcept {
+      return std::min<size_t>(std::bit_width(nanoseconds / 1000), kTraceLatencyBucketCount - 1);
+  }
+
+  static_assert(TraceSizeClass(0) == 0 && TraceSizeClass(64 * 1024) == 1 && TraceSizeClass(1ull << 40) == kTraceSizeClassCount - 1);
+  static_assert(TraceLatencyBucket(999) == 0 && TraceLatencyBucket(1000) == 1 && TraceLatencyBucket(3999) == 2);
+
+  struct TraceEvent
+  {
+      TraceStage stage = TraceStage::Count;
+      bool failed = false;
+      uint16_t thread = 0;
+      uint32_t requestTag = 0;
+      uint64_t startNanos = 0;
+      uint64_t durationNanos = 0;
+      uint64_t bytes = 0;
+  };
+
+  struct StageStats
+  {
+      uint64_t count = 0;
+      uint64_t failures = 0;
+      uint64_t bytes = 0;
+      uint64_t totalNanos = 0;
+      uint64_t maxNanos = 0;
+      std::array<std::array<uint64_t, kTraceLatencyBucketCount>, kTraceSizeClassCount> histogram{};
+  };
+
+  // Collects per-stage counters, latency histograms and a ring of the most recent events.
+  // Recording is wait-free: relaxed atomic adds for the counters and one slot claimed with a
+  // fetch_add in the ring, published with a sequence number so readers skip slots being written.
+  class Tracer
+  {
+  public:
+      explicit Tracer(size_t ringCapacity = 4096) : m_ring(std::bit_ceil(std::max<size_t>(ringCapacity, 2))), m_epoch(std::chrono::steady_clock::now()) {}
+
+      Tracer(Tracer const&) = delete;
+      Tracer& operator=(Tracer const&) = delete;
+
+      // Nanoseconds since the tracer was created, the time base of every event
+      uint64_t Now() const noexcept {
+          return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count());
+      }
+
+      void Record(TraceStage stage, uint32_t requestTag, uint64_t startNanos, uint64_t durationNanos, uint64_t bytes, bool failed) noexcept {
+          StageCounters& counters = m_stages[static_cast<size_t>(stage)];
+          counters.failures.fetch_add(failed ? 1 : 0, std::memory_order_relaxed);
+          counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+          counters.totalNanos.fetch_add(durationNanos, std::memory_order_relaxed);
+          uint64_t max = counters.maxNanos.load(std::memory_order_relaxed);
+          while (durationNanos > max && !counters.maxNanos.compare_exchange_weak(max, durationNanos, std::memory_order_relaxed)) {
+          }
+          counters.histogram[TraceSizeClass(bytes)][TraceLatencyBucket(durationNanos)].fetch_add(1, std::memory_order_relaxed);
+
+          uint64_t index = m_head.fetch_add(1, std::memory_order_relaxed);
+          Slot& slot = m_ring[index & (m_ring.size() - 1)];
+          // Odd while the fields are written, then even and tied to this index once they are complete
+          slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_release);
+          slot.header.store(uint64_t(static_cast<uint8_t>(stage)) | uint64_t(failed) << 8 | uint64_t(CurrentThreadId()) << 16 | uint64_t(requestTag) << 32, std::memory_order_relaxed);
+          slot.startNanos.store(startNanos, std::memory_order_relaxed);
+          slot.durationNanos.store(durationNanos, std::memory_order_relaxed);
+          slot.bytes.store(bytes, std::memory_order_relaxed);
+          slot.sequence.store(index * 2 + 2, std::memory_order_release);
+      }
+
+      StageStats Stats(TraceStage stage) const noexcept {
+          StageCounters const& counters = m_stages[static_cast<size_t>(stage)];
+          StageStats stats;
+          stats.failures = counters.failures.load(std::memory_order_relaxed);
+          stats.bytes = counters.bytes.load(std::memory_order_relaxed);
+          stats.totalNanos = counters.totalNanos.load(std::memory_order_relaxed);
+          stats.maxNanos = counters.maxNanos.load(std::memory_order_relaxed);
+          for (size_t sizeClass = 0; sizeClass < kTraceSizeClassCount; sizeClass++) {
+              for (size_t bucket = 0; bucket < kTraceLatencyBucketCount; bucket++) {
+                  stats.histogram[sizeClass][bucket] = counters.histogram[sizeClass][bucket].load(std::memory_order_relaxed);
+                  stats.count += stats.histogram[sizeClass][bucket];
+              }
+          }
+          return stats;
+      }
+
+      // Events still in the ring, oldest first. Slots overwritten or half-written while they are
+      // copied are left out rather than returned torn.
+      std::vector<TraceEvent> RecentEvents() const {
+          uint64_t head = m_head.load(std::memory_order_acquire);
+          uint64_t first = head > m_ring.size() ? head - m_ring.size() : 0;
+          std::vector<TraceEvent> events;
+          events.reserve(static_cast<size_t>(head - first));
+          for (uint64_t index = first; index < head; index++) {
+              Slot const& slot = m_ring[index & (m_ring.size() - 1)];
+              uint64_t expected = index * 2 + 2;
+              if (slot.sequence.load(std::memory_order_acquire) != expected) {
+                  continue;
+              }
+              uint64_t header = slot.header.load(std::memory_order_relaxed);
+              TraceEvent event;
+              event.stage = static_cast<TraceStage>(header & 0xFF);
+              event.failed = ((header >> 8) & 0xFF) != 0;
+              event.thread = static_cast<uint16_t>(header >> 16);
+              event.requestTag = static_cast<uint32_t>(header >> 32);
+              event.startNanos = slot.startNanos.load(std::memory_order_relaxed);
+              event.durationNanos = slot.durationNanos.load(std::memory_order_relaxed);
+              event.bytes = slot.bytes.load(std::memory_order_relaxed);
+              std::atomic_thread_fence(std::memory_order_acquire);
+              if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+                  events.push_back(event);
+              }
+          }
+          return events;
+      }
+
+      // Events recorded since the tracer was created, including those the ring no longer holds
+      uint64_t RecordedEvents() const noexcept {
+          return m_head.load(std::memory_order_relaxed);
+      }
+
+      // The recent events in the Chrome trace-event format, loadable in chrome://tracing or Perfetto
+      std::string ToChromeTraceJson() const {
+          std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+          char line[256];
+          bool first = true;
+          for (TraceEvent const& event : RecentEvents()) {
+              std::string_view name = TraceStageName(event.stage);
+              int length = std::snprintf(line, sizeof(line),
+                  "%s{\"name\":\"%.*s\",\"cat\":\"FileOpenPicker\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                  "\"args\":{\"request\":\"%08x\",\"bytes\":%llu,\"failed\":%s}}",
+                  first ? "" : ",", static_cast<int>(name.size()), name.data(), unsigned(event.thread), event.startNanos / 1e3, event.durationNanos / 1e3,
+                  event.requestTag, static_cast<unsigned long long>(event.bytes), event.failed ? "true" : "false");
+              json.append(line, static_cast<size_t>(length));
+              first = false;
+          }
+          json += "]}";
+          return json;
+      }
+
+      // Short stable id for a request id string, so events can be grouped without storing strings
+      static uint32_t Tag(std::string_view requestId) noexcept {
+          uint32_t hash = 2166136261u;
+          for (char c : requestId) {
+              hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+          }
+          return hash;
+      }
+
+  private:
+      struct StageCounters
+      {
+          // The event count is the sum of the histogram, one less atomic add per event
+          std::atomic<uint64_t> failures{ 0 };
+          std::atomic<uint64_t> bytes{ 0 };
+          std::atomic<uint64_t> totalNanos{ 0 };
+          std::atomic<uint64_t> maxNanos{ 0 };
+          std::array<std::array<std::atomic<uint64_t>, kTraceLatencyBucketCount>, kTraceSizeClassCount> histogram{};
+      };
+
+      struct Slot
+      {
+          std::atomic<uint64_t> sequence{ 0 };
+          std::atomic<uint64_t> header{ 0 };
+          std::atomic<uint64_t> startNanos{ 0 };
+          std::atomic<uint64_t> durationNanos{ 0 };
+          std::atomic<uint64_t> bytes{ 0 };
+      };
+
+      // Small per-thread numbers read better than OS thread ids in trace viewers
+      static uint16_t CurrentThreadId() noexcept {
+          static std::atomic<uint16_t> next{ 1 };
+          thread_local const uint16_t id = next.fetch_add(1, std::memory_order_relaxed);
+          return id;
+      }
+
+      std::array<StageCounters, kTraceStageCount> m_stages;
+      std::vector<Slot> m_ring;
+      std::atomic<uint64_t> m_head{ 0 };
+      const std::chrono::steady_clock::time_point m_epoch;
+  };
+
+  // Times one stage from construction to Stop(). A timer destroyed without Stop() records the
+  // stage as failed, which is how an exception thrown out of a stage shows up in the stats.
+  class StageTimer
+  {
+  public:
+      StageTimer(Tracer& tracer, TraceStage stage, uint32_t requestTag = 0, uint64_t bytes = 0) noexcept
+          : m_tracer(tracer), m_stage(stage), m_requestTag(requestTag), m_bytes(bytes), m_start(tracer.Now()) {}
+
+      ~StageTimer() {
+          if (!m_stopped) {
+              Finish(true);
+          }
+      }
+
+      StageTimer(StageTimer const&) = delete;
+      StageTimer& operator=(StageTimer const&) = delete;
+
+      void AddBytes(uint64_t bytes) noexcept {
+          m_bytes += bytes;
+      }
+
+      void Stop() noexcept {
+          if (!m_stopped) {
+              Finish(false);
+          }
+      }
+
+  private:
+      void Finish(bool failed) noexcept {
+          m_stopped = true;
+          m_tracer.Record(m_stage, m_requestTag, m_start, m_tracer.Now() - m_start, m_bytes, failed);
+      }
+
+      Tracer& m_tracer;
+      TraceStage m_stage;
+      uint32_t m_requestTag;
+      uint64_t m_bytes;
+      uint64_t m_start;
+      bool m_stopped = false;
+  };
+}
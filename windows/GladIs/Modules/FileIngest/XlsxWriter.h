@@ -0,0 +1,312 @@
+#pragma once
+
+#include "Deflate.h"
+#include "TableWriter.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace FileIngest
+{
+  namespace detail
+  {
+    // Zip archive written strictly front to back: each entry is deflated as it is written and its
+    // CRC and sizes follow the data in a data descriptor, so nothing is ever seeked back to. There
+    // is no zip64 support, the archive has to stay under 4 GiB.
+    class ZipWriter
+    {
+    public:
+        explicit ZipWriter(std::vector<uint8_t>& output) : m_output(output) {
+            // MS-DOS date and time, in UTC since the zip format has no time zone
+            auto now = std::chrono::system_clock::now();
+            auto day = std::chrono::floor<std::chrono::days>(now);
+            std::chrono::year_month_day date(day);
+            std::chrono::hh_mm_ss time(std::chrono::floor<std::chrono::seconds>(now - day));
+            m_dosDate = static_cast<uint16_t>(((int(date.year()) - 1980) << 9) | (unsigned(date.month()) << 5) | unsigned(date.day()));
+            m_dosTime = static_cast<uint16_t>((time.hours().count() << 11) | (time.minutes().count() << 5) | (time.seconds().count() / 2));
+        }
+
+        void BeginEntry(std::string name) {
+            Entry entry;
+            entry.name = std::move(name);
+            entry.offset = m_written;
+            PutU32(0x04034B50);
+            PutU16(20);
+            PutU16(kFlags);
+            PutU16(8);
+            PutU16(m_dosTime);
+            PutU16(m_dosDate);
+            // CRC and sizes come in the data descriptor
+            PutU32(0);
+            PutU32(0);
+            PutU32(0);
+            PutU16(static_cast<uint16_t>(entry.name.size()));
+            PutU16(0);
+            Put(entry.name.data(), entry.name.size());
+            m_entries.push_back(std::move(entry));
+            m_encoder.emplace(Deflate::Level::Fast, Deflate::Framing::Raw);
+        }
+
+        void Write(const char* data, size_t length) {
+            m_encoder->Write(reinterpret_cast<const uint8_t*>(data), length, [this](const uint8_t* bytes, size_t count) { Put(bytes, count); });
+        }
+
+        void Write(std::string_view text) {
+            Write(text.data(), text.size());
+        }
+
+        void EndEntry() {
+            m_encoder->Finish([this](const uint8_t* bytes, size_t count) { Put(bytes, count); });
+            Entry& entry = m_entries.back();
+            entry.crc = m_encoder->Crc();
+            entry.compressedSize = m_encoder->OutputBytes();
+            entry.size = m_encoder->InputBytes();
+            m_encoder.reset();
+            if (entry.compressedSize > UINT32_MAX || entry.size > UINT32_MAX) {
+                throw ExportError("Export is too large for an XLSX file");
+            }
+            PutU32(0x08074B50);
+            PutU32(entry.crc);
+            PutU32(static_cast<uint32_t>(entry.compressedSize));
+            PutU32(static_cast<uint32_t>(entry.size));
+        }
+
+        // Central directory and end record
+        void Finish() {
+            uint64_t directoryOffset = m_written;
+            for (Entry const& entry : m_entries) {
+                PutU32(0x02014B50);
+                PutU16(20);
+                PutU16(20);
+                PutU16(kFlags);
+                PutU16(8);
+                PutU16(m_dosTime);
+                PutU16(m_dosDate);
+                PutU32(entry.crc);
+                PutU32(static_cast<uint32_t>(entry.compressedSize));
+                PutU32(static_cast<uint32_t>(entry.size));
+                PutU16(static_cast<uint16_t>(entry.name.size()));
+                PutU16(0);
+                PutU16(0);
+                PutU16(0);
+                PutU16(0);
+                PutU32(0);
+                PutU32(static_cast<uint32_t>(entry.offset));
+                Put(entry.name.data(), entry.name.size());
+            }
+            uint64_t directorySize = m_written - directoryOffset;
+            if (m_written > UINT32_MAX) {
+                throw ExportError("Export is too large for an XLSX file");
+            }
+            PutU32(0x06054B50);
+            PutU16(0);
+            PutU16(0);
+            PutU16(static_cast<uint16_t>(m_entries.size()));
+            PutU16(static_cast<uint16_t>(m_entries.size()));
+            PutU32(static_cast<uint32_t>(directorySize));
+            PutU32(static_cast<uint32_t>(directoryOffset));
+            PutU16(0);
+        }
+
+        uint64_t BytesWritten() const noexcept {
+            return m_written;
+        }
+
+    private:
+        // Data descriptor follows the data, names are UTF-8
+        static constexpr uint16_t kFlags = 0x0008 | 0x0800;
+
+        struct Entry
+        {
+            std::string name;
+            uint64_t offset = 0;
+            uint32_t crc = 0;
+            uint64_t compressedSize = 0;
+            uint64_t size = 0;
+        };
+
+        void Put(const void* data, size_t length) {
+            size_t size = m_output.size();
+            m_output.resize(size + length);
+            std::memcpy(m_output.data() + size, data, length);
+            m_written += length;
+        }
+
+        void PutU16(uint16_t value) {
+            uint8_t bytes[2] = { uint8_t(value), uint8_t(value >> 8) };
+            Put(bytes, 2);
+        }
+
+        void PutU32(uint32_t value) {
+            uint8_t bytes[4] = { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24) };
+            Put(bytes, 4);
+        }
+
+        std::vector<uint8_t>& m_output;
+        std::vector<Entry> m_entries;
+        std::optional<Deflate::DeflateEncoder> m_encoder;
+        uint64_t m_written = 0;
+        uint16_t m_dosDate = 0;
+        uint16_t m_dosTime = 0;
+    };
+
+    // What XML 1.0 text needs escaped, and the control characters it cannot hold at all
+    struct XmlEscapeTable
+    {
+        std::array<uint8_t, 256> special{};
+
+        constexpr XmlEscapeTable() {
+            for (int c = 0; c < 0x20; c++) {
+                special[c] = c != '\t' && c != '\n';
+            }
+            special['&'] = special['<'] = special['>'] = 1;
+        }
+    };
+
+    inline constexpr XmlEscapeTable kXmlEscapeTable{};
+  }
+
+  // Single-sheet Office Open XML workbook: the smallest package Excel and LibreOffice open
+  // without repair, with text as inline strings so no shared string table has to be held until
+  // the end. The sheet is deflated as rows arrive, about 100 bytes of XML per short row.
+  class XlsxWriter final : public TableWriter
+  {
+  public:
+      // Limits of an Excel sheet; longer text is cut rather than have Excel repair the file
+      static constexpr uint64_t kMaxRows = 1048576;
+      static constexpr size_t kMaxCellLength = 32767;
+
+      explicit XlsxWriter(std::string_view sheetName = "Sheet1") : m_zip(m_output) {
+          AddPart("[Content_Types].xml",
+              R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>)" "\n"
+              R"(<Types xmlns="http://schemas.openxmlformats.org/package/2006/content-types">)"
+              R"(<Default Extension="rels" ContentType="application/vnd.openxmlformats-package.relationships+xml"/>)"
+              R"(<Default Extension="xml" ContentType="application/xml"/>)"
+              R"(<Override PartName="/xl/workbook.xml" ContentType="application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml"/>)"
+              R"(<Override PartName="/xl/worksheets/sheet1.xml" ContentType="application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml"/>)"
+              R"(</Types>)");
+          AddPart("_rels/.rels",
+              R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>)" "\n"
+              R"(<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships">)"
+              R"(<Relationship Id="rId1" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument" Target="xl/workbook.xml"/>)"
+              R"(</Relationships>)");
+          std::string workbook =
+              R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>)" "\n"
+              R"(<workbook xmlns="http://schemas.openxmlformats.org/spreadsheetml/2006/main" xmlns:r="http://schemas.openxmlformats.org/officeDocument/2006/relationships">)"
+              R"(<sheets><sheet name=")";
+          AppendEscaped(workbook, SheetName(sheetName));
+          workbook += R"(" sheetId="1" r:id="rId1"/></sheets></workbook>)";
+          AddPart("xl/workbook.xml", workbook);
+          AddPart("xl/_rels/workbook.xml.rels",
+              R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>)" "\n"
+              R"(<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships">)"
+              R"(<Relationship Id="rId1" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet" Target="worksheets/sheet1.xml"/>)"
+              R"(</Relationships>)");
+          m_zip.BeginEntry("xl/worksheets/sheet1.xml");
+          m_zip.Write(
+              R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>)" "\n"
+              R"(<worksheet xmlns="http://schemas.openxmlformats.org/spreadsheetml/2006/main"><sheetData>)");
+      }
+
+      void WriteRow(std::span<const TableCell> cells) override {
+          if (m_rows >= kMaxRows) {
+              throw ExportError("An XLSX sheet holds at most 1048576 rows");
+          }
+          m_row.clear();
+          char number[32];
+          m_row += "<row r=\"";
+          m_row += FormatNumber(static_cast<double>(m_rows + 1), number);
+          m_row += "\">";
+          for (TableCell const& cell : cells) {
+              if (cell.kind == TableCell::Kind::Text) {
+                  m_row += R"(<c t="inlineStr"><is><t xml:space="preserve">)";
+                  AppendEscaped(m_row, Truncate(cell.text));
+                  m_row += "</t></is></c>";
+              } else if (cell.kind == TableCell::Kind::Number && std::isfinite(cell.number)) {
+                  m_row += "<c><v>";
+                  m_row += FormatNumber(cell.number, number);
+                  m_row += "</v></c>";
+              } else {
+                  m_row += "<c/>";
+              }
+          }
+          m_row += "</row>";
+          m_zip.Write(m_row);
+          m_rows++;
+      }
+
+      void Finish() override {
+          m_zip.Write("</sheetData></worksheet>");
+          m_zip.EndEntry();
+          m_zip.Finish();
+      }
+
+  private:
+      void AddPart(std::string name, std::string_view content) {
+          m_zip.BeginEntry(std::move(name));
+          m_zip.Write(content);
+          m_zip.EndEntry();
+      }
+
+      // Excel refuses sheet names over 31 characters or with any of []:*?/\ in them
+      static std::string SheetName(std::string_view name) {
+          std::string result;
+          for (char c : name.substr(0, 31)) {
+              result += std::string_view("[]:*?/\\").find(c) == std::string_view::npos ? c : '_';
+          }
+          return result.empty() ? "Sheet1" : result;
+      }
+
+      // Cuts at kMaxCellLength bytes, back to the start of a UTF-8 sequence
+      static std::string_view Truncate(std::string_view text) noexcept {
+          if (text.size() <= kMaxCellLength) {
+              return text;
+          }
+          size_t length = kMaxCellLength;
+          while (length > 0 && (static_cast<uint8_t>(text[length]) & 0xC0) == 0x80) {
+              length--;
+          }
+          return text.substr(0, length);
+      }
+
+      // Escapes markup; a CR is kept as a character reference and other control characters,
+      // which XML 1.0 cannot carry, are dropped
+      static void AppendEscaped(std::string& out, std::string_view text) {
+          size_t start = 0;
+          for (size_t i = 0; i < text.size(); i++) {
+              uint8_t c = static_cast<uint8_t>(text[i]);
+              if (!detail::kXmlEscapeTable.special[c]) {
+                  continue;
+              }
+              out.append(text.data() + start, i - start);
+              start = i + 1;
+              switch (c) {
+              case '&':
+                  out += "&amp;";
+                  break;
+              case '<':
+                  out += "&lt;";
+                  break;
+              case '>':
+                  out += "&gt;";
+                  break;
+              case '\r':
+                  out += "&#13;";
+                  break;
+              default:
+                  break;
+              }
+          }
+          out.append(text.data() + start, text.size() - start);
+      }
+
+      detail::ZipWriter m_zip;
+      std::string m_row;
+  };
+}
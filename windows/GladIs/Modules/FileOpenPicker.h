@@ -1,19 +1,154 @@
 #pragma once
 
 #include "pch.h"
+#include <WindowsStorageCOM.h>
 #include <winrt/Windows.Storage.Pickers.h>
 #include <winrt/Windows.Storage.h>
 #include <winrt/Windows.Storage.Streams.h>
 #include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Foundation.Collections.h>
+#include <winrt/Windows.Graphics.Imaging.h>
+#include <winrt/Windows.Web.Http.h>
+#include <winrt/Windows.Web.Http.Filters.h>
+#include <winrt/Windows.Web.Http.Headers.h>
 #include <winrt/Microsoft.ReactNative.h>
-#include <winrt/Windows.Security.Cryptography.h>
+#include "CancelWatch.h"
+#include "FileIngest/Base64.h"
+#include "FileIngest/BufferPool.h"
+#include "FileIngest/ChunkManifest.h"
+#include "FileIngest/Compression.h"
+#include "FileIngest/ContentStore.h"
+#include "FileIngest/CsvParser.h"
+#include "FileIngest/FileHandles.h"
+#include "FileIngest/FileTypes.h"
+#include "FileIngest/ImageResize.h"
+#include "FileIngest/IoExecutor.h"
+#include "FileIngest/MemoryBudget.h"
+#include "FileIngest/PdfStructure.h"
+#include "FileIngest/PdfText.h"
+#include "FileIngest/Pipeline.h"
+#include "FileIngest/RangeDownload.h"
+#include "FileIngest/StreamEncoder.h"
+#include "FileIngest/Task.h"
+#include "FileIngest/TextIndex.h"
+#include "FileIngest/Trace.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <future>
 #include <functional>
 
 namespace FileOpenPickerModule
 {
+  // Gzips another input stream as it is read, so HttpStreamContent sends a compressed body
+  // without the file or its compressed form ever being held in memory as a whole
+  struct GzipInputStream : winrt::implements<GzipInputStream, winrt::Windows::Storage::Streams::IInputStream>
+  {
+      GzipInputStream(winrt::Windows::Storage::Streams::IInputStream source, FileIngest::Tracer& tracer, uint32_t traceTag)
+          : m_source(std::move(source)), m_tracer(tracer), m_traceTag(traceTag) {}
+
+      winrt::Windows::Foundation::IAsyncOperationWithProgress<winrt::Windows::Storage::Streams::IBuffer, uint32_t> ReadAsync(winrt::Windows::Storage::Streams::IBuffer buffer, uint32_t count, winrt::Windows::Storage::Streams::InputStreamOptions) {
+          auto strongThis = get_strong();
+          while (m_pendingOffset == m_pending.size() && !m_finished) {
+              m_pending.clear();
+              m_pendingOffset = 0;
+              winrt::Windows::Storage::Streams::Buffer chunk(kReadSize);
+              auto read = co_await m_source.ReadAsync(chunk, kReadSize, winrt::Windows::Storage::Streams::InputStreamOptions::None);
+              FileIngest::StageTimer timer(m_tracer, FileIngest::TraceStage::Compress, m_traceTag, read.Length());
+              auto append = [this](const uint8_t* data, size_t length) {
+                  m_pending.insert(m_pending.end(), data, data + length);
+              };
+              if (read.Length() == 0) {
+                  m_encoder.Finish(append);
+                  m_finished = true;
+              } else {
+                  m_encoder.Write(read.data(), read.Length(), append);
+              }
+              timer.Stop();
+          }
+          // Zero bytes only once the gzip trailer has been read, which ends the body
+          uint32_t length = static_cast<uint32_t>(std::min<size_t>({ count, buffer.Capacity(), m_pending.size() - m_pendingOffset }));
+          std::copy_n(m_pending.data() + m_pendingOffset, length, buffer.data());
+          m_pendingOffset += length;
+          buffer.Length(length);
+          co_return buffer;
+      }
+
+      void Close() {
+          m_source.Close();
+      }
+
+      uint64_t OutputBytes() const noexcept {
+          return m_encoder.OutputBytes();
+      }
+
+  private:
+      // One deflate block per read of the file
+      static constexpr uint32_t kReadSize = 64 * 1024;
+
+      winrt::Windows::Storage::Streams::IInputStream m_source;
+      FileIngest::Tracer& m_tracer;
+      uint32_t m_traceTag;
+      FileIngest::Deflate::GzipEncoder m_encoder{ FileIngest::Deflate::Level::Fast };
+      std::vector<uint8_t> m_pending;
+      size_t m_pendingOffset = 0;
+      bool m_finished = false;
+  };
+
+  // A delta upload's new version: the picked file, its manifest and the chunks to send
+  struct DeltaUpload
+  {
+      std::unique_ptr<FileIngest::NativeFileSource> source;
+      FileIngest::ChunkManifest manifest;
+      FileIngest::DeltaPlan plan;
+  };
+
+  // Serves the planned chunks of a delta upload as HttpStreamContent reads them, straight from the
+  // file, so only the read in progress is held in memory
+  struct DeltaInputStream : winrt::implements<DeltaInputStream, winrt::Windows::Storage::Streams::IInputStream>
+  {
+      explicit DeltaInputStream(std::shared_ptr<DeltaUpload> upload)
+          : m_upload(std::move(upload)), m_payload(*m_upload->source, m_upload->manifest, m_upload->plan) {}
+
+      winrt::Windows::Foundation::IAsyncOperationWithProgress<winrt::Windows::Storage::Streams::IBuffer, uint32_t> ReadAsync(winrt::Windows::Storage::Streams::IBuffer buffer, uint32_t count, winrt::Windows::Storage::Streams::InputStreamOptions) {
+          auto strongThis = get_strong();
+          // The reads go to disk, off the thread that drives the request
+          co_await winrt::resume_background();
+          uint32_t length = static_cast<uint32_t>(m_payload.Read(buffer.data(), std::min(count, buffer.Capacity())));
+          buffer.Length(length);
+          co_return buffer;
+      }
+
+      void Close() {}
+
+  private:
+      std::shared_ptr<DeltaUpload> m_upload;
+      FileIngest::DeltaPayload m_payload;
+  };
+
+  // A download shared by its connections: each takes chunks from `download` until none are left
+  struct RangeFetch
+  {
+      winrt::Windows::Web::Http::HttpClient client{ nullptr };
+      winrt::Windows::Foundation::Uri uri{ nullptr };
+      std::string validator;
+      std::optional<FileIngest::RangeDownload> download;
+      std::atomic<uint64_t> fetchedBytes{ 0 };
+      std::atomic<uint32_t> requests{ 0 };
+      std::atomic<uint32_t> retries{ 0 };
+      std::atomic<bool> stop{ false };
+  };
+
   REACT_MODULE(FileOpenPicker);
   struct FileOpenPicker final
   {
@@ -24,149 +159,615 @@ namespace FileOpenPickerModule
       m_reactContext = reactContext;
     }
 
-    // Asynchronous method for opening the file dialog
+    // Events emitted while streaming a file with readFileDataStream
+    REACT_EVENT(OnChunk, L"fileOpenPickerChunk");
+    std::function<void(winrt::Microsoft::ReactNative::JSValue)> OnChunk;
+
+    REACT_EVENT(OnProgress, L"fileOpenPickerProgress");
+    std::function<void(winrt::Microsoft::ReactNative::JSValue)> OnProgress;
+
+    // Emitted by readMultipleFileData and uploadMultiplePDFFiles as each file of the batch completes
+    REACT_EVENT(OnFileResult, L"fileOpenPickerFileResult");
+    std::function<void(winrt::Microsoft::ReactNative::JSValue)> OnFileResult;
+
+    // Emitted while uploadPDFFile and uploadMultiplePDFFiles send a file
+    REACT_EVENT(OnUploadProgress, L"fileOpenPickerUploadProgress");
+    std::function<void(winrt::Microsoft::ReactNative::JSValue)> OnUploadProgress;
+
+    // Every pick and read method below is a thin wrapper over one entry of FileIngest::kFileTypes,
+    // which holds the picker extensions, the magic bytes and the size limit of each file type.
     REACT_METHOD(PickPDFFile, L"pickPDFFile");
     void PickPDFFile(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
-        // Run the operation on the UI thread
-        m_reactContext.UIDispatcher().Post([promise, this]() {
-            try {
-                // Create a FileOpenPicker
-                winrt::Windows::Storage::Pickers::FileOpenPicker picker;
-                picker.SuggestedStartLocation(winrt::Windows::Storage::Pickers::PickerLocationId::DocumentsLibrary);
-                picker.FileTypeFilter().Append(L".pdf"); // Set file type filter (e.g., PDF)
+        PickFilePath(kPdf, promise);
+    }
 
-                // Launch the picker (this is asynchronous)
-                picker.PickSingleFileAsync().Completed([promise](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
-                    if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                        winrt::Windows::Storage::StorageFile file = operation.GetResults();
-                        if (file) {
-                            // Resolve the promise with the file path if a file is selected
-                            promise.Resolve(winrt::to_string(file.Path().c_str()));
-                        } else {
-                            // Resolve with a message if no file was selected
-                            promise.Resolve("No file selected");
-                        }
-                    } else {
-                        // Reject the promise if the operation was not completed successfully
-                        promise.Reject("Error opening file dialog");
-                    }
-                });
-            } catch (const std::exception& e) {
-                // Reject the promise in case of exceptions
-                promise.Reject(e.what());
+    REACT_METHOD(PickImageFile, L"pickImageFile");
+    void PickImageFile(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickFilePath(kImage, promise);
+    }
+
+    REACT_METHOD(PickCSVFile, L"pickCSVFile");
+    void PickCSVFile(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickFilePath(kCsv, promise);
+    }
+
+    // The read methods only show the picker on the UI thread. Reading and encoding run as
+    // coroutines on m_executor and can be cancelled from JS with their request id.
+    REACT_METHOD(ReadPDFFileData, L"readPDFFileData");
+    void ReadPDFFileData(std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickSingleFile(kPdf, promise, [this, requestId, promise](winrt::Windows::Storage::StorageFile const& file) {
+            ReadFileDataAsync(file, kPdf, requestId, promise);
+        });
+    }
+
+    REACT_METHOD(ReadImageFileData, L"readImageFileData");
+    void ReadImageFileData(std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickSingleFile(kImage, promise, [this, requestId, promise](winrt::Windows::Storage::StorageFile const& file) {
+            ReadFileDataAsync(file, kImage, requestId, promise);
+        });
+    }
+
+    // Same as readImageFileData, but the image is decoded, scaled down to fit within maxWidth x maxHeight
+    // (0 leaves an axis free) and re-encoded before it is base64 encoded. The EXIF orientation is applied
+    // to the pixels and every metadata block is dropped. `format` is "jpeg", "png" or "auto" to keep the
+    // source format; `quality` goes from 0 to 1 and only applies to JPEG.
+    REACT_METHOD(ReadResizedImageFileData, L"readResizedImageFileData");
+    void ReadResizedImageFileData(std::string requestId, uint32_t maxWidth, uint32_t maxHeight, double quality, std::string format, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        ImageOutput output{ maxWidth, maxHeight, static_cast<float>(std::clamp(quality, 0.0, 1.0)) };
+        if (!ParseImageEncoding(format, output.encoding)) {
+            promise.Reject("Unsupported image format");
+            return;
+        }
+        PickSingleFile(kImage, promise, [this, requestId, output, promise](winrt::Windows::Storage::StorageFile const& file) {
+            ReadResizedImageAsync(file, requestId, output, promise);
+        });
+    }
+
+    REACT_METHOD(ReadCSVFileData, L"readCSVFileData");
+    void ReadCSVFileData(std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickSingleFile(kCsv, promise, [this, requestId, promise](winrt::Windows::Storage::StorageFile const& file) {
+            ReadFileDataAsync(file, kCsv, requestId, promise);
+        });
+    }
+
+    // Resolves with the paths of every picked PDF
+    REACT_METHOD(PickMultiplePDFFiles, L"pickMultiplePDFFiles");
+    void PickMultiplePDFFiles(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickMultipleFiles(kPdf, promise, [promise](winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Storage::StorageFile> const& files) {
+            winrt::Microsoft::ReactNative::JSValueArray paths;
+            for (auto const& file : files) {
+                paths.push_back(winrt::Microsoft::ReactNative::JSValue(winrt::to_string(file.Path())));
             }
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(paths)));
         });
     }
 
-    REACT_METHOD(PickImageFile, L"pickImageFile");
-    void PickImageFile(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
-        // Run the operation on the UI thread
-        m_reactContext.UIDispatcher().Post([promise, this]() {
-            try {
-                // Create a FileOpenPicker
-                winrt::Windows::Storage::Pickers::FileOpenPicker picker;
-                picker.SuggestedStartLocation(winrt::Windows::Storage::Pickers::PickerLocationId::DocumentsLibrary);
-                picker.FileTypeFilter().Append(L".png");
-                picker.FileTypeFilter().Append(L".jpg");
-                picker.FileTypeFilter().Append(L".jpeg");
+    // Picks several files and reads them in parallel. Each file is delivered through a
+    // fileOpenPickerFileResult event as soon as it is encoded, in completion order; the
+    // promise resolves with { requestId, fileCount, failedCount } after the last one.
+    REACT_METHOD(ReadMultipleFileData, L"readMultipleFileData");
+    void ReadMultipleFileData(std::string requestId, std::string fileType, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        const FileIngest::FileTypeDescriptor* descriptor = FileIngest::FindFileType(fileType);
+        if (descriptor == nullptr) {
+            promise.Reject("Unsupported file type");
+            return;
+        }
+        PickMultipleFiles(*descriptor, promise, [this, descriptor, requestId, promise](winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Storage::StorageFile> const& files) {
+            ReadMultipleFileDataAsync(files, *descriptor, requestId, promise);
+        });
+    }
 
-                // Launch the picker (this is asynchronous)
-                picker.PickSingleFileAsync().Completed([promise](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
-                    if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                        winrt::Windows::Storage::StorageFile file = operation.GetResults();
-                        if (file) {
-                            // Resolve the promise with the file path if a file is selected
-                            promise.Resolve(winrt::to_string(file.Path().c_str()));
-                        } else {
-                            // Resolve with a message if no file was selected
-                            promise.Resolve("No image selected");
-                        }
-                    } else {
-                        // Reject the promise if the operation was not completed successfully
-                        promise.Reject("Error opening file dialog");
-                    }
-                });
-            } catch (const std::exception& e) {
-                // Reject the promise in case of exceptions
-                promise.Reject(e.what());
+    // Parses the picked CSV natively and resolves with rows of { id, value, isTitle } cells,
+    // the shape DataUtils.csvToGrid builds on the JS side
+    REACT_METHOD(ReadCSVFileGrid, L"readCSVFileGrid");
+    void ReadCSVFileGrid(std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickSingleFile(kCsv, promise, [this, requestId, promise](winrt::Windows::Storage::StorageFile const& file) {
+            ParseCSVFileAsync(file, requestId, promise);
+        });
+    }
+
+    // Streams the picked file to JS as base64 chunks instead of a single string.
+    // Resolves with a summary once every chunk has been emitted.
+    REACT_METHOD(ReadFileDataStream, L"readFileDataStream");
+    void ReadFileDataStream(std::string requestId, std::string fileType, uint32_t chunkSize, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        const FileIngest::FileTypeDescriptor* descriptor = FileIngest::FindFileType(fileType);
+        if (descriptor == nullptr) {
+            promise.Reject("Unsupported file type");
+            return;
+        }
+        PickSingleFile(*descriptor, promise, [this, descriptor, requestId, chunkSize, promise](winrt::Windows::Storage::StorageFile const& file) {
+            StreamFileDataAsync(file, *descriptor, requestId, chunkSize, promise);
+        });
+    }
+
+    // Picks a PDF and posts it to `url` as multipart/form-data, streaming it from disk.
+    // `compression` is "none", "auto" or "gzip". The request itself is never encoded: only the
+    // file part is gzipped and labelled Content-Encoding: gzip, and the server decodes that part
+    // before storing it, while the uri, name and path fields stay plain. A server that refuses
+    // the part with 415 gets the file again uncompressed; one that ignores the header stores the
+    // gzip bytes, so only ask for compression from a backend known to decode it. Resolves with
+    // { statusCode, body, contentEncoding, fileBytes, encodedBytes } where body is the raw
+    // response text.
+    REACT_METHOD(UploadPDFFile, L"uploadPDFFile");
+    void UploadPDFFile(std::string requestId, std::string url, std::string token, std::string fileName, std::string destinationPath, std::string compression, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CompressionMode mode;
+        if (!FileIngest::ParseCompressionMode(compression, mode)) {
+            promise.Reject("Unsupported compression");
+            return;
+        }
+        PickSingleFile(kPdf, promise, [this, requestId, url, token, fileName, destinationPath, mode, promise](winrt::Windows::Storage::StorageFile const& file) {
+            UploadFileAsync(file, requestId, url, token, fileName, destinationPath, mode, promise);
+        });
+    }
+
+    // Picks several PDFs and uploads each one as uploadPDFFile does, streamed from disk, with
+    // `fileName` for the first and "<name>_2.pdf", "<name>_3.pdf"... for the next ones. Each
+    // file's answer, or the reason it failed, comes as a fileOpenPickerFileResult event with
+    // { requestId, index, fileName, name } and either { statusCode, body, ... } or { error };
+    // the promise resolves with { requestId, fileCount, failedCount } after the last one.
+    REACT_METHOD(UploadMultiplePDFFiles, L"uploadMultiplePDFFiles");
+    void UploadMultiplePDFFiles(std::string requestId, std::string url, std::string token, std::string fileName, std::string destinationPath, std::string compression, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CompressionMode mode;
+        if (!FileIngest::ParseCompressionMode(compression, mode)) {
+            promise.Reject("Unsupported compression");
+            return;
+        }
+        PickMultipleFiles(kPdf, promise, [this, requestId, url, token, fileName, destinationPath, mode, promise](winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Storage::StorageFile> const& files) {
+            UploadMultipleFilesAsync(files, requestId, url, token, fileName, destinationPath, mode, promise);
+        });
+    }
+
+    // Picks a new version of a PDF and uploads only what the server lacks. The file is cut into
+    // content-defined chunks and compared with the manifest of the previous version, the hex
+    // digest `baseManifest` returned by the last upload of that document ("" for none). The
+    // multipart body holds the new manifest, the missing chunks and the name, path and
+    // baseManifest fields. A server without the base answers 409, and the upload is then repeated
+    // with every chunk. Resolves with { statusCode, body, manifest, fileBytes, sentBytes,
+    // chunkCount, sentChunks }; pass `manifest` as baseManifest for the next version.
+    REACT_METHOD(UploadPDFFileDelta, L"uploadPDFFileDelta");
+    void UploadPDFFileDelta(std::string requestId, std::string url, std::string token, std::string fileName, std::string destinationPath, std::string baseManifest, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickSingleFile(kPdf, promise, [this, requestId, url, token, fileName, destinationPath, baseManifest, promise](winrt::Windows::Storage::StorageFile const& file) {
+            UploadDeltaAsync(file, requestId, url, token, fileName, destinationPath, baseManifest, promise);
+        });
+    }
+
+    // Downloads `url` into the content store as Range requests over a few parallel connections,
+    // each chunk written to disk at its offset as it arrives. The file is checked against
+    // `expectedDigest`, a hex SHA-256, or when that is "" against the server's Repr-Digest or
+    // Digest header; a mismatch deletes it. A download cut short resumes the next time the same
+    // url is asked for, unless the file changed on the server. A server without Range support
+    // is read sequentially. Resolves with { digest, bytes, resumedBytes, fetchedBytes, requests,
+    // retries, ranged, verified }; readContent(digest) then returns the file.
+    REACT_METHOD(DownloadFile, L"downloadFile");
+    void DownloadFile(std::string requestId, std::string url, std::string token, std::string expectedDigest, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        std::optional<FileIngest::Sha256Digest> expected;
+        if (!expectedDigest.empty()) {
+            FileIngest::Sha256Digest parsed;
+            if (!FileIngest::ParseHex(expectedDigest, parsed)) {
+                promise.Reject("Invalid digest");
+                return;
             }
+            expected = parsed;
+        }
+        DownloadFileAsync(std::move(requestId), std::move(url), std::move(token), expected, promise);
+    }
+
+    // Content-addressed blob store shared by every read: identical files are kept once,
+    // keyed by the hex SHA-256 of their bytes. storeContent takes raw base64 (no data: prefix).
+    REACT_METHOD(StoreContent, L"storeContent");
+    void StoreContent(std::string data, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        StoreContentAsync(std::move(data), promise);
+    }
+
+    // Resolves with the base64 content, or null when the digest is unknown or was evicted
+    REACT_METHOD(ReadContent, L"readContent");
+    void ReadContent(std::string digest, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        ReadContentAsync(std::move(digest), promise);
+    }
+
+    REACT_METHOD(HasContent, L"hasContent");
+    void HasContent(std::string digest, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        try {
+            FileIngest::Sha256Digest parsed;
+            promise.Resolve(FileIngest::ParseHex(digest, parsed) && Store().Contains(parsed));
+        } catch (...) {
+            promise.Resolve(false);
+        }
+    }
+
+    // Full-text search over PDFs in the content store. indexDocument extracts the text of the
+    // content under `digest` and indexes it as `documentId`, replacing what it had before; it
+    // resolves with false when the digest is unknown or the content is not a readable PDF.
+    // searchDocuments resolves with [{ documentId, score, matchedTerms }], best first; the last
+    // word of the query also matches as a prefix unless the query ends with a space.
+    REACT_METHOD(IndexDocument, L"indexDocument");
+    void IndexDocument(std::string documentId, std::string digest, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        FileIngest::Sha256Digest parsed;
+        if (documentId.empty() || documentId.size() > FileIngest::TextIndex::kMaxKeyLength || !FileIngest::ParseHex(digest, parsed)) {
+            promise.Reject("Invalid document");
+            return;
+        }
+        IndexDocumentAsync(std::move(documentId), parsed, promise);
+    }
+
+    REACT_METHOD(RemoveIndexedDocument, L"removeIndexedDocument");
+    void RemoveIndexedDocument(std::string documentId, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        if (documentId.empty() || documentId.size() > FileIngest::TextIndex::kMaxKeyLength) {
+            promise.Reject("Invalid document");
+            return;
+        }
+        RemoveIndexedDocumentAsync(std::move(documentId), promise);
+    }
+
+    REACT_METHOD(SearchDocuments, L"searchDocuments");
+    void SearchDocuments(std::string query, int64_t limit, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        if (limit <= 0) {
+            promise.Reject("Invalid limit");
+            return;
+        }
+        SearchDocumentsAsync(std::move(query), static_cast<size_t>(std::min<int64_t>(limit, kMaxSearchResults)), promise);
+    }
+
+    // { documents, segments, terms, diskBytes, commits, merges, searches }
+    REACT_METHOD(GetIndexStats, L"getIndexStats");
+    void GetIndexStats(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            FileIngest::TextIndexStats stats = SearchIndex().Stats();
+            winrt::Microsoft::ReactNative::JSValueObject result;
+            result["documents"] = static_cast<int64_t>(stats.documents);
+            result["segments"] = static_cast<int64_t>(stats.segments);
+            result["terms"] = static_cast<int64_t>(stats.terms);
+            result["diskBytes"] = static_cast<int64_t>(stats.diskBytes);
+            result["commits"] = static_cast<int64_t>(stats.commits);
+            result["merges"] = static_cast<int64_t>(stats.merges);
+            result["searches"] = static_cast<int64_t>(stats.searches);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading index stats").c_str());
+        }
+    }
+
+    // Random access to a picked file without loading it: openFile resolves with
+    // { handle, name, mimeType, size }, readFileRange with the base64 bytes of one range, clipped
+    // to the end of the file, and closeFile releases the handle. The bridge has no ArrayBuffer
+    // type on Windows, so ranges travel as base64 strings like every other read.
+    REACT_METHOD(OpenFile, L"openFile");
+    void OpenFile(std::string fileType, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        const FileIngest::FileTypeDescriptor* descriptor = FileIngest::FindFileType(fileType);
+        if (descriptor == nullptr) {
+            promise.Reject("Unsupported file type");
+            return;
+        }
+        PickSingleFile(*descriptor, promise, [this, descriptor, promise](winrt::Windows::Storage::StorageFile const& file) {
+            OpenFileHandleAsync(file, *descriptor, promise);
         });
     }
 
-    REACT_METHOD(PickCSVFile, L"pickCSVFile");
-    void PickCSVFile(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
-        // Run the operation on the UI thread
-        m_reactContext.UIDispatcher().Post([promise, this]() {
+    REACT_METHOD(ReadFileRange, L"readFileRange");
+    void ReadFileRange(uint32_t handle, int64_t offset, int64_t length, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        if (offset < 0 || length < 0) {
+            promise.Reject("Invalid range");
+            return;
+        }
+        ReadFileRangeAsync(handle, static_cast<uint64_t>(offset), static_cast<uint64_t>(length), promise);
+    }
+
+    // Resolves with false when the handle was already closed or expired
+    REACT_METHOD(CloseFile, L"closeFile");
+    void CloseFile(uint32_t handle, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        promise.Resolve(m_fileHandles.Close(handle));
+    }
+
+    // What an open PDF's structure says, read from its tail and the few objects it points to
+    // instead of the whole file: { version, fileSize, pageCount, linearized, xrefSections,
+    // xrefStreams, encryption, metadata, hasXmpMetadata, repaired, problems, bytesRead }. pageCount
+    // is null when the page tree has none, encryption is null for unencrypted files and metadata
+    // holds only the fields the file sets. Damaged files resolve with their problems listed; only
+    // files that are not PDFs reject.
+    REACT_METHOD(ReadPDFStructure, L"readPDFStructure");
+    void ReadPDFStructure(uint32_t handle, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        ReadPDFStructureAsync(handle, promise);
+    }
+
+    // Counters of every stage since the app started: { recordedEvents, stages: { [stage]: { count,
+    // failures, bytes, totalMs, maxMs, histogram } } }. The histogram maps each size class to
+    // event counts per latency bucket, bucket 0 being under 1 us and bucket k under 2^k us.
+    REACT_METHOD(GetStats, L"getStats");
+    void GetStats(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        winrt::Microsoft::ReactNative::JSValueObject stages;
+        for (size_t index = 0; index < FileIngest::kTraceStageCount; index++) {
+            auto stage = static_cast<FileIngest::TraceStage>(index);
+            FileIngest::StageStats stats = m_tracer.Stats(stage);
+            winrt::Microsoft::ReactNative::JSValueObject histogram;
+            for (size_t sizeClass = 0; sizeClass < FileIngest::kTraceSizeClassCount; sizeClass++) {
+                winrt::Microsoft::ReactNative::JSValueArray buckets;
+                for (uint64_t count : stats.histogram[sizeClass]) {
+                    buckets.push_back(winrt::Microsoft::ReactNative::JSValue(static_cast<int64_t>(count)));
+                }
+                histogram[SizeClassLabel(sizeClass)] = std::move(buckets);
+            }
+            winrt::Microsoft::ReactNative::JSValueObject entry;
+            entry["count"] = static_cast<int64_t>(stats.count);
+            entry["failures"] = static_cast<int64_t>(stats.failures);
+            entry["bytes"] = static_cast<int64_t>(stats.bytes);
+            entry["totalMs"] = stats.totalNanos / 1e6;
+            entry["maxMs"] = stats.maxNanos / 1e6;
+            entry["histogram"] = std::move(histogram);
+            stages[std::string(FileIngest::TraceStageName(stage))] = std::move(entry);
+        }
+        FileIngest::MemoryBudgetStats budget = m_memoryBudget.Stats();
+        winrt::Microsoft::ReactNative::JSValueObject budgetStats;
+        budgetStats["limit"] = static_cast<int64_t>(budget.limit);
+        budgetStats["bytesInUse"] = static_cast<int64_t>(budget.bytesInUse);
+        budgetStats["peakBytesInUse"] = static_cast<int64_t>(budget.peakBytesInUse);
+        budgetStats["admitted"] = static_cast<int64_t>(budget.admitted);
+        budgetStats["waited"] = static_cast<int64_t>(budget.waited);
+        budgetStats["rejected"] = static_cast<int64_t>(budget.rejected);
+        budgetStats["waiting"] = static_cast<int64_t>(budget.waiting);
+        FileIngest::BufferPoolStats pool = m_bufferPool.Stats();
+        winrt::Microsoft::ReactNative::JSValueObject poolStats;
+        poolStats["allocations"] = static_cast<int64_t>(pool.allocations);
+        poolStats["reuses"] = static_cast<int64_t>(pool.reuses);
+        poolStats["discards"] = static_cast<int64_t>(pool.discards);
+        poolStats["bytesInUse"] = static_cast<int64_t>(pool.bytesInUse);
+        poolStats["peakBytesInUse"] = static_cast<int64_t>(pool.peakBytesInUse);
+        poolStats["bytesRetained"] = static_cast<int64_t>(pool.bytesRetained);
+        winrt::Microsoft::ReactNative::JSValueObject memory;
+        memory["budget"] = std::move(budgetStats);
+        memory["pool"] = std::move(poolStats);
+
+        winrt::Microsoft::ReactNative::JSValueObject result;
+        result["recordedEvents"] = static_cast<int64_t>(m_tracer.RecordedEvents());
+        result["stages"] = std::move(stages);
+        result["memory"] = std::move(memory);
+        promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+    }
+
+    // Changes the in-flight byte budget of all reads. Reads already running keep their memory;
+    // queued reads that no longer fit are rejected. Idle pooled buffers are freed as well.
+    REACT_METHOD(SetMemoryBudget, L"setMemoryBudget");
+    void SetMemoryBudget(int64_t bytes, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        if (bytes <= 0) {
+            promise.Reject("Invalid memory budget");
+            return;
+        }
+        try {
+            m_memoryBudget.SetLimit(static_cast<uint64_t>(bytes));
+            m_bufferPool.Trim();
+            promise.Resolve(true);
+        } catch (...) {
+            promise.Reject("Error setting memory budget");
+        }
+    }
+
+    // The most recent stage events as Chrome trace-event JSON, for chrome://tracing or Perfetto
+    REACT_METHOD(GetTrace, L"getTrace");
+    void GetTrace(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(m_tracer.ToChromeTraceJson()));
+        } catch (...) {
+            promise.Reject("Error exporting trace");
+        }
+    }
+
+    // Cancels a pending read or upload, resolves with false if it already finished
+    REACT_METHOD(Cancel, L"cancel");
+    void Cancel(std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        promise.Resolve(m_requests.Cancel(requestId));
+    }
+
+  private:
+    static constexpr size_t kReadWorkerCount = 2;
+    static constexpr size_t kMaxPendingReads = 32;
+    static constexpr std::chrono::minutes kReadTimeout{ 5 };
+    static constexpr std::chrono::minutes kUploadTimeout{ 30 };
+    // Files of one batch that may be loaded or encoded at the same time
+    static constexpr size_t kMaxParallelFiles = kReadWorkerCount * 2;
+    // Files of one batch upload on the wire at the same time
+    static constexpr size_t kMaxParallelUploads = 2;
+
+    static constexpr uint64_t kContentStoreBudget = 512ull * 1024 * 1024;
+
+    // An open handle costs a file handle and a few hundred bytes; handles idle for
+    // kFileHandleIdleTimeout are reclaimed once the table is full
+    static constexpr size_t kMaxOpenFiles = 64;
+    static constexpr std::chrono::minutes kFileHandleIdleTimeout{ 10 };
+    static constexpr size_t kMaxRangeLength = 16 * 1024 * 1024;
+    // Read size while chunking a file for a delta upload
+    static constexpr size_t kDeltaReadSize = 1024 * 1024;
+    // Downloads: connections per file, bytes per Range request and per read of an answer. A chunk
+    // is also the most a resumed download fetches twice.
+    static constexpr uint32_t kDownloadConnections = 4;
+    static constexpr uint32_t kDownloadChunkSize = 1024 * 1024;
+    static constexpr uint32_t kDownloadReadSize = 64 * 1024;
+
+    // Bytes all reads may hold at once, raw and base64 together; enough for the largest PDF
+    // allowed. Buffers between 64 KiB and 128 MiB are pooled, with up to 64 MiB kept idle.
+    static constexpr uint64_t kDefaultMemoryBudget = 384ull * 1024 * 1024;
+    static constexpr size_t kPoolMinClassSize = 64 * 1024;
+    static constexpr size_t kPoolMaxClassSize = 128 * 1024 * 1024;
+    static constexpr size_t kPoolMaxRetainedBytes = 64 * 1024 * 1024;
+
+    // Results one search may return, and the text kept of one PDF
+    static constexpr int64_t kMaxSearchResults = 200;
+    static constexpr size_t kMaxIndexedText = 16 * 1024 * 1024;
+
+    FileIngest::IoExecutor m_executor{ kReadWorkerCount, kMaxPendingReads };
+    FileIngest::MemoryBudget m_memoryBudget{ m_executor, kDefaultMemoryBudget };
+    FileIngest::BufferPool m_bufferPool{ kPoolMinClassSize, kPoolMaxClassSize, kPoolMaxRetainedBytes };
+    FileIngest::CancellationRegistry m_requests;
+    FileIngest::FileHandleTable m_fileHandles{ kMaxOpenFiles, kFileHandleIdleTimeout };
+    FileIngest::Tracer m_tracer;
+    std::once_flag m_contentStoreOnce;
+    std::unique_ptr<FileIngest::ContentStore> m_contentStore;
+    std::once_flag m_textIndexOnce;
+    std::unique_ptr<FileIngest::TextIndex> m_textIndex;
+    // Urls being downloaded. Each writes to the partial file named after its url, so a second
+    // download of the same url is refused until the first one ends.
+    std::mutex m_downloadsLock;
+    std::set<std::string> m_downloads;
+
+    // Opened on first use under LocalCacheFolder, which Windows may clear under disk pressure
+    FileIngest::ContentStore& Store() {
+        std::call_once(m_contentStoreOnce, [this]() {
+            std::filesystem::path root(winrt::Windows::Storage::ApplicationData::Current().LocalCacheFolder().Path().c_str());
+            m_contentStore = std::make_unique<FileIngest::ContentStore>(root / L"ContentStore", kContentStoreBudget);
+        });
+        return *m_contentStore;
+    }
+
+    // Opened on first use next to the content store. The index only holds derived data, so a
+    // damaged one is deleted and starts over empty rather than failing every search.
+    FileIngest::TextIndex& SearchIndex() {
+        std::call_once(m_textIndexOnce, [this]() {
+            std::filesystem::path root(winrt::Windows::Storage::ApplicationData::Current().LocalCacheFolder().Path().c_str());
+            try {
+                m_textIndex = std::make_unique<FileIngest::TextIndex>(root / L"TextIndex");
+            } catch (const FileIngest::TextIndexError&) {
+                std::filesystem::remove_all(root / L"TextIndex");
+                m_textIndex = std::make_unique<FileIngest::TextIndex>(root / L"TextIndex");
+            }
+        });
+        return *m_textIndex;
+    }
+
+    // "<64KiB", "<1MiB", ... and ">=64MiB" for the last, unbounded class
+    static std::string SizeClassLabel(size_t sizeClass) {
+        auto describe = [](uint64_t bytes) {
+            return bytes >= 1024 * 1024 ? std::to_string(bytes / (1024 * 1024)) + "MiB" : std::to_string(bytes / 1024) + "KiB";
+        };
+        if (sizeClass < std::size(FileIngest::kTraceSizeClassLimits)) {
+            return "<" + describe(FileIngest::kTraceSizeClassLimits[sizeClass]);
+        }
+        return ">=" + describe(FileIngest::kTraceSizeClassLimits[sizeClass - 1]);
+    }
+
+    // Called from a catch (...) block. Keeps the generic message and appends what the platform
+    // reported, so a failure report says more than "Error reading file".
+    static std::string DescribeFailure(std::string_view fallback) noexcept {
+        std::string message(fallback);
+        try {
+            throw;
+        } catch (const winrt::hresult_error& e) {
+            char code[16];
+            std::snprintf(code, sizeof(code), "0x%08X", static_cast<uint32_t>(e.code().value));
+            message += ": " + winrt::to_string(e.message()) + " (" + code + ")";
+        } catch (const std::exception& e) {
+            message += ": ";
+            message += e.what();
+        } catch (...) {
+        }
+        return message;
+    }
+
+    // Partial downloads live outside the content store until verified, named after their url
+    static std::filesystem::path DownloadPath(std::string const& url) {
+        std::filesystem::path root(winrt::Windows::Storage::ApplicationData::Current().LocalCacheFolder().Path().c_str());
+        std::filesystem::create_directories(root / L"Downloads");
+        return root / L"Downloads" / FileIngest::ToHex(FileIngest::Sha256::Hash(reinterpret_cast<const uint8_t*>(url.data()), url.size()));
+    }
+
+    bool ClaimDownload(std::string const& url) {
+        std::lock_guard<std::mutex> lock(m_downloadsLock);
+        return m_downloads.insert(url).second;
+    }
+
+    void ReleaseDownload(std::string const& url) {
+        std::lock_guard<std::mutex> lock(m_downloadsLock);
+        m_downloads.erase(url);
+    }
+
+    // Looks in the response headers, then in the content headers, where HttpClient files
+    // Content-Range and Last-Modified
+    static std::string ResponseHeader(winrt::Windows::Web::Http::HttpResponseMessage const& response, wchar_t const* name) {
+        if (auto value = response.Headers().TryLookup(name)) {
+            return winrt::to_string(*value);
+        }
+        if (auto value = response.Content().Headers().TryLookup(name)) {
+            return winrt::to_string(*value);
+        }
+        return {};
+    }
+
+    // Random ids in the same format as Utils.generateUUID, only used as React keys for grid cells
+    struct CellIdGenerator
+    {
+        std::mt19937_64 engine{ std::random_device{}() };
+
+        std::string Next() {
+            static constexpr char kHex[] = "0123456789abcdef";
+            static constexpr char kPattern[] = "xxxxxxxx-xxxx-4xxx-yxxx-xxxxxxxxxxxx";
+            uint64_t bits[2] = { engine(), engine() };
+            std::string id(kPattern);
+            size_t nibble = 0;
+            for (char& c : id) {
+                if (c != 'x' && c != 'y') {
+                    continue;
+                }
+                uint64_t value = (bits[nibble / 16] >> ((nibble % 16) * 4)) & 0xF;
+                c = kHex[c == 'x' ? value : (value & 0x3) | 0x8];
+                nibble++;
+            }
+            return id;
+        }
+    };
+
+    static constexpr FileIngest::FileTypeDescriptor const& kPdf = *FileIngest::FindFileType("pdf");
+    static constexpr FileIngest::FileTypeDescriptor const& kImage = *FileIngest::FindFileType("image");
+    static constexpr FileIngest::FileTypeDescriptor const& kCsv = *FileIngest::FindFileType("csv");
+
+    // Shows the picker on the UI thread and hands the picked file to `onPicked`
+    void PickSingleFile(FileIngest::FileTypeDescriptor const& fileType, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise, std::function<void(winrt::Windows::Storage::StorageFile const&)> onPicked) noexcept {
+        uint64_t pickStart = m_tracer.Now();
+        m_reactContext.UIDispatcher().Post([this, &fileType, promise, onPicked, pickStart]() {
             try {
                 // Create a FileOpenPicker
                 winrt::Windows::Storage::Pickers::FileOpenPicker picker;
                 picker.SuggestedStartLocation(winrt::Windows::Storage::Pickers::PickerLocationId::DocumentsLibrary);
-                picker.FileTypeFilter().Append(L".csv"); // Set file type filter to CSV
+                for (std::string_view extension : fileType.extensions) {
+                    picker.FileTypeFilter().Append(winrt::to_hstring(extension));
+                }
 
                 // Launch the picker (this is asynchronous)
-                picker.PickSingleFileAsync().Completed([promise](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
+                picker.PickSingleFileAsync().Completed([this, &fileType, promise, onPicked, pickStart](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
+                    // Includes the time the user spends in the dialog
+                    m_tracer.Record(FileIngest::TraceStage::Pick, 0, pickStart, m_tracer.Now() - pickStart, 0, status == winrt::Windows::Foundation::AsyncStatus::Error);
                     if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
                         winrt::Windows::Storage::StorageFile file = operation.GetResults();
                         if (file) {
-                            // Resolve the promise with the file path if a file is selected
-                            promise.Resolve(winrt::to_string(file.Path().c_str()));
+                            onPicked(file);
                         } else {
-                            // Resolve with a message if no file was selected
-                            promise.Resolve("No file selected");
+                            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::string(fileType.noSelectionMessage)));
                         }
                     } else {
-                        // Reject the promise if the operation was not completed successfully
                         promise.Reject("Error opening file dialog");
                     }
                 });
             } catch (const std::exception& e) {
-                // Reject the promise in case of exceptions
                 promise.Reject(e.what());
             }
         });
     }
 
-    REACT_METHOD(ReadPDFFileData, L"readPDFFileData");
-    void ReadPDFFileData(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
-        // Run the operation on the UI thread
-        m_reactContext.UIDispatcher().Post([promise, this]() {
+    // Same as PickSingleFile with PickMultipleFilesAsync; an empty selection resolves like a dismissed dialog
+    void PickMultipleFiles(FileIngest::FileTypeDescriptor const& fileType, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise, std::function<void(winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Storage::StorageFile> const&)> onPicked) noexcept {
+        uint64_t pickStart = m_tracer.Now();
+        m_reactContext.UIDispatcher().Post([this, &fileType, promise, onPicked, pickStart]() {
             try {
-                // Create a FileOpenPicker
                 winrt::Windows::Storage::Pickers::FileOpenPicker picker;
                 picker.SuggestedStartLocation(winrt::Windows::Storage::Pickers::PickerLocationId::DocumentsLibrary);
-                picker.FileTypeFilter().Append(L".pdf");
+                for (std::string_view extension : fileType.extensions) {
+                    picker.FileTypeFilter().Append(winrt::to_hstring(extension));
+                }
 
-                // Launch the picker (this is asynchronous)
-                picker.PickSingleFileAsync().Completed([promise](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
+                picker.PickMultipleFilesAsync().Completed([this, &fileType, promise, onPicked, pickStart](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Storage::StorageFile>> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
+                    m_tracer.Record(FileIngest::TraceStage::Pick, 0, pickStart, m_tracer.Now() - pickStart, 0, status == winrt::Windows::Foundation::AsyncStatus::Error);
                     if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                        winrt::Windows::Storage::StorageFile file = operation.GetResults();
-                        if (file) {
-                            // Read the file content
-                            auto readOperation = file.OpenReadAsync();
-                            readOperation.Completed([promise](auto const& operation, auto const status) {
-                                if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                                    auto stream = operation.GetResults();
-                                    // Create a DataReader from the stream
-                                    winrt::Windows::Storage::Streams::DataReader dataReader = winrt::Windows::Storage::Streams::DataReader(stream);
-                                    
-                                    // Load the entire stream into the DataReader
-                                    uint32_t bytesLoaded = dataReader.LoadAsync(static_cast<uint32_t>(stream.Size())).get();  // Use get() to wait for completion
-
-                                    // Read the bytes into a buffer
-                                    std::vector<uint8_t> buffer(bytesLoaded);
-                                    dataReader.ReadBytes(buffer);
-
-                                    // Convert buffer to Base64 string
-                                    std::string base64String = winrt::to_string(winrt::Windows::Security::Cryptography::CryptographicBuffer::EncodeToBase64String(winrt::Windows::Security::Cryptography::CryptographicBuffer::CreateFromByteArray(buffer)));
-
-                                    // Resolve with JSValue containing Base64 string
-                                    promise.Resolve(winrt::Microsoft::ReactNative::JSValue(base64String));
-                                } else {
-                                    promise.Reject("Error reading file");
-                                }
-                            });
+                        auto files = operation.GetResults();
+                        if (files.Size() > 0) {
+                            onPicked(files);
                         } else {
-                            promise.Resolve(winrt::Microsoft::ReactNative::JSValue("No file selected"));
+                            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::string(fileType.noSelectionMessage)));
                         }
                     } else {
                         promise.Reject("Error opening file dialog");
@@ -178,110 +779,1500 @@ namespace FileOpenPickerModule
         });
     }
 
-    REACT_METHOD(ReadImageFileData, L"readImageFileData");
-    void ReadImageFileData(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
-        // Run the operation on the UI thread
-        m_reactContext.UIDispatcher().Post([promise, this]() {
+    // Resolves with the path of the picked file, without reading it
+    void PickFilePath(FileIngest::FileTypeDescriptor const& fileType, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        PickSingleFile(fileType, promise, [promise](winrt::Windows::Storage::StorageFile const& file) {
+            promise.Resolve(winrt::to_string(file.Path().c_str()));
+        });
+    }
+
+    using SniffedHead = std::array<uint8_t, FileIngest::kSniffLength>;
+
+    // Takes the first bytes already loaded by `dataReader` and rejects the file from them and its
+    // size, so a mislabelled or oversized file costs one small read instead of a full one.
+    // Returns the MIME type the sniffer matched.
+    static std::string_view CheckPickedFile(FileIngest::FileTypeDescriptor const& fileType, uint64_t size, winrt::Windows::Storage::Streams::DataReader const& dataReader, SniffedHead& head, uint32_t headLength) {
+        dataReader.ReadBytes(winrt::array_view<uint8_t>(head.data(), head.data() + headLength));
+        return FileIngest::CheckFile(fileType, size, head.data(), headLength);
+    }
+
+    // The reservation covers the bytes and their base64, and is released after both. A mapped
+    // file is read where it lies and `bytes` stays empty.
+    struct LoadedFile
+    {
+        FileIngest::MemoryBudget::Reservation reservation;
+        std::unique_ptr<FileIngest::MappedFileSource> mapped;
+        FileIngest::PooledBuffer bytes;
+        FileIngest::Sha256Digest digest;
+        std::string_view mimeType;
+
+        const uint8_t* Data() const noexcept {
+            return mapped ? mapped->Data() : bytes.Data();
+        }
+
+        size_t Size() const noexcept {
+            return mapped ? static_cast<size_t>(mapped->Size()) : bytes.Size();
+        }
+    };
+
+    // Sniffs the file, then loads it chunk by chunk so a cancelled read stops between two loads,
+    // hashing each chunk while it is still hot in cache. Files that can be mapped are hashed in
+    // place instead, and the stream below is the fallback for those that cannot.
+    FileIngest::Task<LoadedFile> LoadFileAsync(winrt::Windows::Storage::StorageFile file, FileIngest::FileTypeDescriptor const& fileType, FileIngest::CancellationToken token, uint32_t traceTag) {
+        FileIngest::StageTimer openTimer(m_tracer, FileIngest::TraceStage::Open, traceTag);
+        if (std::unique_ptr<FileIngest::MappedFileSource> mapped = TryMapFile(file)) {
+            openTimer.Stop();
+            co_return co_await LoadMappedFileAsync(std::move(mapped), fileType, token, traceTag);
+        }
+        auto stream = co_await file.OpenReadAsync();
+        winrt::Windows::Storage::Streams::DataReader dataReader = winrt::Windows::Storage::Streams::DataReader(stream);
+        openTimer.Stop();
+
+        LoadedFile loaded;
+        SniffedHead head;
+        FileIngest::StageTimer sniffTimer(m_tracer, FileIngest::TraceStage::Sniff, traceTag);
+        uint32_t headLength = co_await dataReader.LoadAsync(static_cast<uint32_t>(head.size()));
+        loaded.mimeType = CheckPickedFile(fileType, stream.Size(), dataReader, head, headLength);
+        sniffTimer.AddBytes(headLength);
+        sniffTimer.Stop();
+
+        // Waits here, before anything is allocated, while other reads hold the budget
+        size_t size = static_cast<size_t>(stream.Size());
+        loaded.reservation = co_await m_memoryBudget.Reserve(size + FileIngest::Base64::EncodedLength(size));
+        token.ThrowIfCancelled();
+
+        FileIngest::PooledBuffer& buffer = loaded.bytes;
+        buffer = m_bufferPool.Acquire(size);
+        FileIngest::Sha256 hasher;
+        std::copy_n(head.data(), headLength, buffer.Data());
+        hasher.Update(head.data(), headLength);
+        size_t filled = headLength;
+        FileIngest::StageTimer loadTimer(m_tracer, FileIngest::TraceStage::Load, traceTag);
+        while (filled < buffer.Size()) {
+            token.ThrowIfCancelled();
+            uint32_t toLoad = static_cast<uint32_t>(std::min(buffer.Size() - filled, FileIngest::kDefaultChunkSize));
+            uint32_t chunkLength = co_await dataReader.LoadAsync(toLoad);
+            if (chunkLength == 0) {
+                break;
+            }
+            dataReader.ReadBytes(winrt::array_view<uint8_t>(buffer.Data() + filled, buffer.Data() + filled + chunkLength));
+            hasher.Update(buffer.Data() + filled, chunkLength);
+            filled += chunkLength;
+        }
+        buffer.Resize(filled);
+        loaded.digest = hasher.Final();
+        loadTimer.AddBytes(filled - headLength);
+        loadTimer.Stop();
+        co_return loaded;
+    }
+
+    // Only the base64 is reserved: the mapped pages are page cache the system can reclaim, and
+    // nothing copies them. The next chunk is prefetched while this one is hashed.
+    FileIngest::Task<LoadedFile> LoadMappedFileAsync(std::unique_ptr<FileIngest::MappedFileSource> mapped, FileIngest::FileTypeDescriptor const& fileType, FileIngest::CancellationToken token, uint32_t traceTag) {
+        LoadedFile loaded;
+        size_t size = static_cast<size_t>(mapped->Size());
+        FileIngest::StageTimer sniffTimer(m_tracer, FileIngest::TraceStage::Sniff, traceTag);
+        size_t headLength = std::min(size, FileIngest::kSniffLength);
+        loaded.mimeType = FileIngest::CheckFile(fileType, size, mapped->Data(), headLength);
+        sniffTimer.AddBytes(headLength);
+        sniffTimer.Stop();
+
+        loaded.reservation = co_await m_memoryBudget.Reserve(FileIngest::Base64::EncodedLength(size));
+        token.ThrowIfCancelled();
+
+        FileIngest::Sha256 hasher;
+        FileIngest::StageTimer loadTimer(m_tracer, FileIngest::TraceStage::Load, traceTag, size);
+        for (size_t offset = 0; offset < size; offset += FileIngest::kDefaultChunkSize) {
+            token.ThrowIfCancelled();
+            size_t length = std::min(size - offset, FileIngest::kDefaultChunkSize);
+            mapped->Prefetch(offset + length, FileIngest::kDefaultChunkSize);
+            hasher.Update(mapped->Data() + offset, length);
+        }
+        loaded.digest = hasher.Final();
+        loadTimer.Stop();
+        loaded.mapped = std::move(mapped);
+        co_return loaded;
+    }
+
+    // Reads the whole file and resolves with it as a single base64 string
+    winrt::fire_and_forget ReadFileDataAsync(winrt::Windows::Storage::StorageFile file, FileIngest::FileTypeDescriptor const& fileType, std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken token;
+        try {
+            token = m_requests.Register(requestId, kReadTimeout);
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            co_return;
+        }
+        uint32_t traceTag = FileIngest::Tracer::Tag(requestId);
+        try {
+            co_await m_executor.Schedule(token);
+            LoadedFile loaded = co_await LoadFileAsync(file, fileType, token, traceTag);
+
+            // Loads complete on WinRT threads, hop back onto our workers to encode
+            co_await m_executor.Schedule(token);
+            std::string base64String;
+            EncodeTraced(loaded.Data(), loaded.Size(), base64String, traceTag);
+
+            // Resolve with JSValue containing Base64 string
+            FileIngest::StageTimer resolveTimer(m_tracer, FileIngest::TraceStage::Resolve, traceTag, base64String.size());
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(base64String)));
+            resolveTimer.Stop();
+            auto stored = std::make_shared<LoadedFile>(std::move(loaded));
+            PutContentAsync(stored, stored->digest, stored->Data(), stored->Size(), traceTag);
+        } catch (const FileIngest::OperationCancelled& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::FileRejected& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::MemoryBudgetExceeded& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading file").c_str());
+        }
+        m_requests.Release(requestId);
+    }
+
+    enum class ImageEncoding
+    {
+        Source,
+        Jpeg,
+        Png,
+    };
+
+    struct ImageOutput
+    {
+        uint32_t maxWidth = 0;
+        uint32_t maxHeight = 0;
+        float quality = 0.9f;
+        ImageEncoding encoding = ImageEncoding::Source;
+    };
+
+    // Decoded images are held as 4 bytes per pixel, so this caps the decode at 256 MiB
+    static constexpr uint64_t kMaxImagePixels = 64ull * 1024 * 1024;
+
+    // WebP is refused: Windows ships a WebP decoder but no encoder
+    static bool ParseImageEncoding(std::string_view format, ImageEncoding& encoding) noexcept {
+        if (format == "auto") {
+            encoding = ImageEncoding::Source;
+        } else if (format == "jpeg" || format == "jpg") {
+            encoding = ImageEncoding::Jpeg;
+        } else if (format == "png") {
+            encoding = ImageEncoding::Png;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    struct EncodedImage
+    {
+        std::vector<uint8_t> bytes;
+        std::string_view mimeType;
+    };
+
+    // Decodes and encodes with the platform codecs and resizes with FileIngest::ImageResize in between.
+    // The encoder is fed bare pixels rather than transcoding the source, which is what drops the EXIF.
+    FileIngest::Task<EncodedImage> ResizeImageAsync(LoadedFile const& loaded, ImageOutput output, FileIngest::CancellationToken token, uint32_t traceTag) {
+        namespace Imaging = winrt::Windows::Graphics::Imaging;
+        winrt::Windows::Storage::Streams::InMemoryRandomAccessStream input;
+        winrt::Windows::Storage::Streams::DataWriter writer(input);
+        writer.WriteBytes(winrt::array_view<const uint8_t>(loaded.Data(), loaded.Data() + loaded.Size()));
+        co_await writer.StoreAsync();
+        writer.DetachStream();
+        input.Seek(0);
+
+        FileIngest::StageTimer decodeTimer(m_tracer, FileIngest::TraceStage::Decode, traceTag, loaded.Size());
+        Imaging::BitmapDecoder decoder = co_await Imaging::BitmapDecoder::CreateAsync(input);
+        FileIngest::ImageSize source{ decoder.OrientedPixelWidth(), decoder.OrientedPixelHeight() };
+        if (uint64_t(source.width) * source.height > kMaxImagePixels) {
+            throw FileIngest::FileRejected("Image is too large");
+        }
+        // The decoded and resized pixels on top of the file's own reservation. This request already
+        // holds memory, so it does not wait for more: two such requests could wait on each other.
+        FileIngest::ImageSize target = FileIngest::ImageResize::FitWithin(source, output.maxWidth, output.maxHeight);
+        size_t resizedLength = size_t(target.width) * target.height * FileIngest::ImageResize::kChannels;
+        FileIngest::MemoryBudget::Reservation pixelReservation = m_memoryBudget.TryReserve(uint64_t(source.width) * source.height * FileIngest::ImageResize::kChannels + resizedLength);
+        // Premultiplied so transparent pixels do not bleed into their neighbours while filtering
+        Imaging::PixelDataProvider pixelData = co_await decoder.GetPixelDataAsync(Imaging::BitmapPixelFormat::Bgra8, Imaging::BitmapAlphaMode::Premultiplied, Imaging::BitmapTransform(), Imaging::ExifOrientationMode::RespectExifOrientation, Imaging::ColorManagementMode::ColorManageToSRgb);
+        winrt::com_array<uint8_t> pixels = pixelData.DetachPixelData();
+        decodeTimer.Stop();
+
+        co_await m_executor.Schedule(token);
+        FileIngest::StageTimer resizeTimer(m_tracer, FileIngest::TraceStage::Resize, traceTag, pixels.size());
+        FileIngest::PooledBuffer resized = m_bufferPool.Acquire(resizedLength);
+        FileIngest::ImageResize::Resize(pixels.data(), source, size_t(source.width) * FileIngest::ImageResize::kChannels, resized.Data(), target, size_t(target.width) * FileIngest::ImageResize::kChannels);
+        pixels.clear();
+        resizeTimer.Stop();
+
+        FileIngest::StageTimer reencodeTimer(m_tracer, FileIngest::TraceStage::Reencode, traceTag);
+        bool jpeg = output.encoding == ImageEncoding::Jpeg || (output.encoding == ImageEncoding::Source && loaded.mimeType == "image/jpeg");
+        Imaging::BitmapPropertySet properties;
+        if (jpeg) {
+            // JPEG has no alpha channel, put transparent areas on white instead of black
+            FileIngest::ImageResize::FlattenPremultiplied(resized.Data(), size_t(target.width) * target.height, 255);
+            properties.Insert(L"ImageQuality", Imaging::BitmapTypedValue(winrt::box_value(output.quality), winrt::Windows::Foundation::PropertyType::Single));
+        }
+        winrt::Windows::Storage::Streams::InMemoryRandomAccessStream encoded;
+        Imaging::BitmapEncoder encoder = co_await Imaging::BitmapEncoder::CreateAsync(jpeg ? Imaging::BitmapEncoder::JpegEncoderId() : Imaging::BitmapEncoder::PngEncoderId(), encoded, properties);
+        encoder.SetPixelData(Imaging::BitmapPixelFormat::Bgra8, jpeg ? Imaging::BitmapAlphaMode::Ignore : Imaging::BitmapAlphaMode::Premultiplied, target.width, target.height, decoder.DpiX(), decoder.DpiY(), winrt::array_view<const uint8_t>(resized.Data(), resized.Data() + resized.Size()));
+        co_await encoder.FlushAsync();
+
+        EncodedImage image;
+        image.mimeType = jpeg ? "image/jpeg" : "image/png";
+        image.bytes.resize(static_cast<size_t>(encoded.Size()));
+        winrt::Windows::Storage::Streams::DataReader reader(encoded.GetInputStreamAt(0));
+        co_await reader.LoadAsync(static_cast<uint32_t>(image.bytes.size()));
+        reader.ReadBytes(winrt::array_view<uint8_t>(image.bytes.data(), image.bytes.data() + image.bytes.size()));
+        reencodeTimer.AddBytes(image.bytes.size());
+        reencodeTimer.Stop();
+        co_return image;
+    }
+
+    // readImageFileData with the resize stage between the load and the base64 encode
+    winrt::fire_and_forget ReadResizedImageAsync(winrt::Windows::Storage::StorageFile file, std::string requestId, ImageOutput output, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken token;
+        try {
+            token = m_requests.Register(requestId, kReadTimeout);
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            co_return;
+        }
+        uint32_t traceTag = FileIngest::Tracer::Tag(requestId);
+        try {
+            co_await m_executor.Schedule(token);
+            LoadedFile loaded = co_await LoadFileAsync(file, kImage, token, traceTag);
+            EncodedImage image = co_await ResizeImageAsync(loaded, output, token, traceTag);
+
+            co_await m_executor.Schedule(token);
+            std::string base64String;
+            EncodeTraced(image.bytes.data(), image.bytes.size(), base64String, traceTag);
+            FileIngest::StageTimer resolveTimer(m_tracer, FileIngest::TraceStage::Resolve, traceTag, base64String.size());
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(base64String)));
+            resolveTimer.Stop();
+            auto stored = std::make_shared<EncodedImage>(std::move(image));
+            PutContentAsync(stored, FileIngest::Sha256::Hash(stored->bytes.data(), stored->bytes.size()), stored->bytes.data(), stored->bytes.size(), traceTag);
+        } catch (const FileIngest::OperationCancelled& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::FileRejected& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::MemoryBudgetExceeded& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading image").c_str());
+        }
+        m_requests.Release(requestId);
+    }
+
+    // Shared by the per-file coroutines of one readMultipleFileData call
+    struct FileBatch
+    {
+        FileBatch(FileIngest::IoExecutor& executor, uint32_t fileCount, FileIngest::FileTypeDescriptor const& fileType, std::string requestId, FileIngest::CancellationToken token, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise)
+            : permits(executor, kMaxParallelFiles), countdown(fileCount), fileCount(fileCount), fileType(fileType), requestId(std::move(requestId)), traceTag(FileIngest::Tracer::Tag(this->requestId)), token(std::move(token)), promise(std::move(promise)) {}
+
+        FileIngest::AsyncSemaphore permits;
+        FileIngest::BatchCountdown countdown;
+        std::atomic<uint32_t> failedCount{ 0 };
+        const uint32_t fileCount;
+        FileIngest::FileTypeDescriptor const& fileType;
+        const std::string requestId;
+        const uint32_t traceTag;
+        const FileIngest::CancellationToken token;
+        winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise;
+    };
+
+    // Starts one coroutine per file. At most kMaxParallelFiles are past the semaphore at once,
+    // so while one file is being encoded the next ones are already loading.
+    void ReadMultipleFileDataAsync(winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Storage::StorageFile> files, FileIngest::FileTypeDescriptor const& fileType, std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken token;
+        try {
+            token = m_requests.Register(requestId, kReadTimeout * files.Size());
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            return;
+        }
+        auto batch = std::make_shared<FileBatch>(m_executor, files.Size(), fileType, requestId, token, promise);
+        for (uint32_t index = 0; index < files.Size(); index++) {
+            ReadBatchFileAsync(batch, files.GetAt(index), index);
+        }
+    }
+
+    // Emits one fileResult event per file, with either its data or the reason it failed, and
+    // resolves the batch promise once the last file is done
+    winrt::fire_and_forget ReadBatchFileAsync(std::shared_ptr<FileBatch> batch, winrt::Windows::Storage::StorageFile file, uint32_t index) noexcept {
+        winrt::Microsoft::ReactNative::JSValueObject result;
+        result["requestId"] = batch->requestId;
+        result["index"] = static_cast<int64_t>(index);
+        std::shared_ptr<LoadedFile> stored;
+        try {
+            result["fileName"] = winrt::to_string(file.Name());
+            auto permit = co_await batch->permits.Acquire();
+            co_await m_executor.Schedule(batch->token);
+            LoadedFile loaded = co_await LoadFileAsync(file, batch->fileType, batch->token, batch->traceTag);
+
+            co_await m_executor.Schedule(batch->token);
+            std::string base64String;
+            EncodeTraced(loaded.Data(), loaded.Size(), base64String, batch->traceTag);
+            result["data"] = std::move(base64String);
+            result["digest"] = FileIngest::ToHex(loaded.digest);
+            result["mimeType"] = std::string(loaded.mimeType);
+            stored = std::make_shared<LoadedFile>(std::move(loaded));
+        } catch (const FileIngest::OperationCancelled& e) {
+            result["error"] = std::string(e.what());
+        } catch (const FileIngest::FileRejected& e) {
+            result["error"] = std::string(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            result["error"] = std::string(e.what());
+        } catch (const FileIngest::MemoryBudgetExceeded& e) {
+            result["error"] = std::string(e.what());
+        } catch (...) {
+            result["error"] = DescribeFailure("Error reading file");
+        }
+        if (result.find("error") != result.end()) {
+            batch->failedCount++;
+        }
+        OnFileResult(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+        if (stored) {
+            PutContentAsync(stored, stored->digest, stored->Data(), stored->Size(), batch->traceTag);
+        }
+
+        if (batch->countdown.Complete()) {
+            winrt::Microsoft::ReactNative::JSValueObject summary;
+            summary["requestId"] = batch->requestId;
+            summary["fileCount"] = static_cast<int64_t>(batch->fileCount);
+            summary["failedCount"] = static_cast<int64_t>(batch->failedCount.load());
+            batch->promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(summary)));
+            m_requests.Release(batch->requestId);
+        }
+    }
+
+    // Keeping a copy in the store is best effort and never fails or delays the read that
+    // produced it: the write runs on a worker once the read has been answered, and `owner` keeps
+    // `data` alive, with its memory reservation, until it is written.
+    winrt::fire_and_forget PutContentAsync(std::shared_ptr<void> owner, FileIngest::Sha256Digest digest, const uint8_t* data, size_t length, uint32_t traceTag) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            FileIngest::StageTimer timer(m_tracer, FileIngest::TraceStage::Store, traceTag, length);
+            Store().Put(digest, data, length);
+            timer.Stop();
+        } catch (...) {
+        }
+    }
+
+    void EncodeTraced(const uint8_t* data, size_t length, std::string& out, uint32_t traceTag) {
+        FileIngest::StageTimer timer(m_tracer, FileIngest::TraceStage::Encode, traceTag, length);
+        FileIngest::Base64::EncodeTo(data, length, out);
+        timer.Stop();
+    }
+
+    winrt::fire_and_forget StoreContentAsync(std::string data, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            std::vector<uint8_t> bytes;
+            if (!FileIngest::Base64::DecodeTo(data.data(), data.size(), bytes)) {
+                promise.Reject("Invalid base64 data");
+                co_return;
+            }
+            FileIngest::Sha256Digest digest = FileIngest::Sha256::Hash(bytes.data(), bytes.size());
+            Store().Put(digest, bytes.data(), bytes.size());
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(FileIngest::ToHex(digest)));
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error storing content").c_str());
+        }
+    }
+
+    winrt::fire_and_forget ReadContentAsync(std::string digest, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            FileIngest::Sha256Digest parsed;
+            std::vector<uint8_t> bytes;
+            if (!FileIngest::ParseHex(digest, parsed) || !Store().Get(parsed, bytes)) {
+                promise.Resolve(winrt::Microsoft::ReactNative::JSValue());
+                co_return;
+            }
+            std::string base64String;
+            EncodeTraced(bytes.data(), bytes.size(), base64String, 0);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(base64String)));
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading content").c_str());
+        }
+    }
+
+    winrt::fire_and_forget IndexDocumentAsync(std::string documentId, FileIngest::Sha256Digest digest, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            std::vector<uint8_t> bytes;
+            if (!Store().Get(digest, bytes)) {
+                promise.Resolve(false);
+                co_return;
+            }
+            std::string text;
             try {
-                // Create a FileOpenPicker
-                winrt::Windows::Storage::Pickers::FileOpenPicker picker;
-                picker.SuggestedStartLocation(winrt::Windows::Storage::Pickers::PickerLocationId::DocumentsLibrary);
-                picker.FileTypeFilter().Append(L".png");
-                picker.FileTypeFilter().Append(L".jpg");
-                picker.FileTypeFilter().Append(L".jpeg");
+                text = FileIngest::ExtractPdfText(bytes.data(), bytes.size(), kMaxIndexedText);
+            } catch (const FileIngest::PdfError&) {
+                promise.Resolve(false);
+                co_return;
+            }
+            FileIngest::TextIndex& index = SearchIndex();
+            index.Add(documentId, text);
+            index.Commit();
+            promise.Resolve(true);
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::TextIndexError& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error indexing document").c_str());
+        }
+    }
 
-                // Launch the picker (this is asynchronous)
-                picker.PickSingleFileAsync().Completed([promise](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
-                    if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                        winrt::Windows::Storage::StorageFile file = operation.GetResults();
-                        if (file) {
-                            // Read the file content
-                            auto readOperation = file.OpenReadAsync();
-                            readOperation.Completed([promise](auto const& operation, auto const status) {
-                                if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                                    auto stream = operation.GetResults();
-                                    // Create a DataReader from the stream
-                                    winrt::Windows::Storage::Streams::DataReader dataReader = winrt::Windows::Storage::Streams::DataReader(stream);
-                                    
-                                    // Load the entire stream into the DataReader
-                                    uint32_t bytesLoaded = dataReader.LoadAsync(static_cast<uint32_t>(stream.Size())).get();  // Use get() to wait for completion
-
-                                    // Read the bytes into a buffer
-                                    std::vector<uint8_t> buffer(bytesLoaded);
-                                    dataReader.ReadBytes(buffer);
-
-                                    // Convert buffer to Base64 string
-                                    std::string base64String = winrt::to_string(winrt::Windows::Security::Cryptography::CryptographicBuffer::EncodeToBase64String(winrt::Windows::Security::Cryptography::CryptographicBuffer::CreateFromByteArray(buffer)));
-
-                                    // Resolve with JSValue containing Base64 string
-                                    promise.Resolve(winrt::Microsoft::ReactNative::JSValue(base64String));
-                                } else {
-                                    promise.Reject("Error reading file");
-                                }
-                            });
-                        } else {
-                            promise.Resolve(winrt::Microsoft::ReactNative::JSValue("No file selected"));
-                        }
-                    } else {
-                        promise.Reject("Error opening file dialog");
+    winrt::fire_and_forget RemoveIndexedDocumentAsync(std::string documentId, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            FileIngest::TextIndex& index = SearchIndex();
+            bool indexed = index.Contains(documentId);
+            index.Remove(documentId);
+            index.Commit();
+            promise.Resolve(indexed);
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error removing indexed document").c_str());
+        }
+    }
+
+    winrt::fire_and_forget SearchDocumentsAsync(std::string query, size_t limit, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            winrt::Microsoft::ReactNative::JSValueArray hits;
+            for (FileIngest::TextSearchHit const& hit : SearchIndex().Search(query, limit)) {
+                winrt::Microsoft::ReactNative::JSValueObject entry;
+                entry["documentId"] = hit.key;
+                entry["score"] = hit.score;
+                entry["matchedTerms"] = static_cast<int64_t>(hit.matchedTerms);
+                hits.push_back(winrt::Microsoft::ReactNative::JSValue(std::move(entry)));
+            }
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(hits)));
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error searching documents").c_str());
+        }
+    }
+
+    // Picked files can live where the app has no path access, the storage broker hands out a
+    // Win32 handle for them instead
+    static HANDLE OpenBrokeredHandle(winrt::Windows::Storage::StorageFile const& file, HANDLE_OPTIONS options = HO_RANDOM_ACCESS) {
+        HANDLE handle = INVALID_HANDLE_VALUE;
+        winrt::check_hresult(file.as<IStorageItemHandleAccess>()->Create(HAO_READ, HSO_SHARE_READ, options, nullptr, &handle));
+        return handle;
+    }
+
+    // Maps a picked file for reading front to back. The handle shares reads only, so no one can
+    // truncate the file under the mapping. nullptr when the file cannot be opened that way, such
+    // as one another process has open for writing, or cannot be mapped; callers then read it
+    // through its StorageFile stream.
+    static std::unique_ptr<FileIngest::MappedFileSource> TryMapFile(winrt::Windows::Storage::StorageFile const& file) noexcept {
+        try {
+            return std::make_unique<FileIngest::MappedFileSource>(OpenBrokeredHandle(file, HO_SEQUENTIAL_SCAN));
+        } catch (...) {
+            return nullptr;
+        }
+    }
+
+    winrt::fire_and_forget OpenFileHandleAsync(winrt::Windows::Storage::StorageFile file, FileIngest::FileTypeDescriptor const& fileType, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            FileIngest::StageTimer openTimer(m_tracer, FileIngest::TraceStage::Open);
+            auto source = std::make_unique<FileIngest::NativeFileSource>(OpenBrokeredHandle(file));
+            openTimer.Stop();
+            FileIngest::StageTimer sniffTimer(m_tracer, FileIngest::TraceStage::Sniff);
+            SniffedHead head;
+            size_t headLength = source->ReadAt(0, head.data(), head.size());
+            std::string_view mimeType = FileIngest::CheckFile(fileType, source->Size(), head.data(), headLength);
+            sniffTimer.AddBytes(headLength);
+            sniffTimer.Stop();
+            FileIngest::FileHandleInfo info = m_fileHandles.Open(std::move(source), winrt::to_string(file.Name()), std::string(mimeType));
+
+            winrt::Microsoft::ReactNative::JSValueObject result;
+            result["handle"] = static_cast<int64_t>(info.handle);
+            result["name"] = info.name;
+            result["mimeType"] = info.mimeType;
+            result["size"] = static_cast<int64_t>(info.size);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+        } catch (const FileIngest::FileRejected& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::HandleLimitReached& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error opening file").c_str());
+        }
+    }
+
+    // Only the requested range is ever in memory, once as bytes and once as base64
+    winrt::fire_and_forget ReadFileRangeAsync(uint32_t handle, uint64_t offset, uint64_t length, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            // Reserved for the requested length, the clipped range can only be smaller
+            uint64_t reserved = std::min<uint64_t>(length, kMaxRangeLength);
+            auto reservation = co_await m_memoryBudget.Reserve(reserved + FileIngest::Base64::EncodedLength(static_cast<size_t>(reserved)));
+            FileIngest::StageTimer readTimer(m_tracer, FileIngest::TraceStage::ReadRange, handle);
+            FileIngest::PooledBuffer bytes = m_fileHandles.ReadRange(handle, offset, length, kMaxRangeLength, m_bufferPool);
+            readTimer.AddBytes(bytes.Size());
+            readTimer.Stop();
+            std::string base64String;
+            EncodeTraced(bytes.Data(), bytes.Size(), base64String, handle);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(base64String)));
+        } catch (const FileIngest::InvalidHandle& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::InvalidRange& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::MemoryBudgetExceeded& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading file").c_str());
+        }
+    }
+
+    winrt::fire_and_forget ReadPDFStructureAsync(uint32_t handle, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            std::shared_ptr<FileIngest::RangeSource> source = m_fileHandles.Source(handle);
+            FileIngest::StageTimer parseTimer(m_tracer, FileIngest::TraceStage::Parse, handle);
+            FileIngest::PdfStructure structure = FileIngest::ReadPdfStructure(*source);
+            parseTimer.AddBytes(structure.bytesRead);
+            parseTimer.Stop();
+
+            winrt::Microsoft::ReactNative::JSValueObject result;
+            result["version"] = structure.version;
+            result["fileSize"] = static_cast<int64_t>(structure.fileSize);
+            result["pageCount"] = structure.pageCount >= 0 ? winrt::Microsoft::ReactNative::JSValue(structure.pageCount) : winrt::Microsoft::ReactNative::JSValue(nullptr);
+            result["linearized"] = structure.linearized;
+            result["xrefSections"] = static_cast<int64_t>(structure.xrefSections);
+            result["xrefStreams"] = structure.xrefStreams;
+            if (structure.encrypted) {
+                winrt::Microsoft::ReactNative::JSValueObject encryption;
+                encryption["filter"] = structure.encryptionFilter;
+                encryption["revision"] = structure.encryptionRevision;
+                encryption["keyBits"] = structure.encryptionKeyBits;
+                encryption["permissions"] = structure.permissions;
+                encryption["canPrint"] = structure.canPrint;
+                encryption["canModify"] = structure.canModify;
+                encryption["canCopy"] = structure.canCopy;
+                result["encryption"] = winrt::Microsoft::ReactNative::JSValue(std::move(encryption));
+            } else {
+                result["encryption"] = winrt::Microsoft::ReactNative::JSValue(nullptr);
+            }
+            winrt::Microsoft::ReactNative::JSValueObject metadata;
+            auto set = [&metadata](const char* key, std::string const& value) {
+                if (!value.empty()) {
+                    metadata[key] = value;
+                }
+            };
+            set("title", structure.title);
+            set("author", structure.author);
+            set("subject", structure.subject);
+            set("keywords", structure.keywords);
+            set("creator", structure.creator);
+            set("producer", structure.producer);
+            set("creationDate", structure.creationDate);
+            set("modificationDate", structure.modificationDate);
+            result["metadata"] = winrt::Microsoft::ReactNative::JSValue(std::move(metadata));
+            result["hasXmpMetadata"] = structure.hasXmpMetadata;
+            result["repaired"] = structure.repaired;
+            winrt::Microsoft::ReactNative::JSValueArray problems;
+            for (std::string const& problem : structure.problems) {
+                problems.push_back(winrt::Microsoft::ReactNative::JSValue(problem));
+            }
+            result["problems"] = winrt::Microsoft::ReactNative::JSValue(std::move(problems));
+            result["bytesRead"] = static_cast<int64_t>(structure.bytesRead);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+        } catch (const FileIngest::InvalidHandle& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::PdfError& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading PDF structure").c_str());
+        }
+    }
+
+    // Emits the file as chunk/progress events and resolves with a summary
+    winrt::fire_and_forget StreamFileDataAsync(winrt::Windows::Storage::StorageFile file, FileIngest::FileTypeDescriptor const& fileType, std::string requestId, uint32_t chunkSize, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken token;
+        try {
+            token = m_requests.Register(requestId, kReadTimeout);
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            co_return;
+        }
+        uint32_t traceTag = FileIngest::Tracer::Tag(requestId);
+        try {
+            co_await m_executor.Schedule(token);
+            std::string fileName = winrt::to_string(file.Name());
+            FileIngest::StageTimer openTimer(m_tracer, FileIngest::TraceStage::Open, traceTag);
+            std::unique_ptr<FileIngest::MappedFileSource> mapped = TryMapFile(file);
+            winrt::Windows::Storage::Streams::IRandomAccessStreamWithContentType stream{ nullptr };
+            if (!mapped) {
+                stream = co_await file.OpenReadAsync();
+            }
+            uint64_t totalBytes = mapped ? mapped->Size() : stream.Size();
+            openTimer.Stop();
+
+            auto emit = [&](FileIngest::EncodedChunk const& chunk) {
+                winrt::Microsoft::ReactNative::JSValueObject chunkEvent;
+                chunkEvent["requestId"] = requestId;
+                chunkEvent["index"] = static_cast<int64_t>(chunk.index);
+                chunkEvent["offset"] = static_cast<int64_t>(chunk.offset);
+                chunkEvent["data"] = chunk.data;
+                OnChunk(winrt::Microsoft::ReactNative::JSValue(std::move(chunkEvent)));
+
+                winrt::Microsoft::ReactNative::JSValueObject progressEvent;
+                progressEvent["requestId"] = requestId;
+                progressEvent["bytesRead"] = static_cast<int64_t>(chunk.offset + chunk.byteLength);
+                progressEvent["totalBytes"] = static_cast<int64_t>(totalBytes);
+                OnProgress(winrt::Microsoft::ReactNative::JSValue(std::move(progressEvent)));
+            };
+
+            // Pull at most one chunk at a time from the stream. Encode times include emitting
+            // the chunk events, which is where the JSValue strings are built.
+            size_t normalizedChunkSize = FileIngest::NormalizeChunkSize(chunkSize);
+            FileIngest::StreamSummary summary;
+            if (mapped) {
+                FileIngest::StageTimer sniffTimer(m_tracer, FileIngest::TraceStage::Sniff, traceTag);
+                size_t headLength = static_cast<size_t>(std::min<uint64_t>(totalBytes, FileIngest::kSniffLength));
+                FileIngest::CheckFile(fileType, totalBytes, mapped->Data(), headLength);
+                sniffTimer.AddBytes(headLength);
+                sniffTimer.Stop();
+
+                // Whole chunks are encoded straight from the mapped pages, only the last partial
+                // one goes through the encoder's buffer
+                auto reservation = co_await m_memoryBudget.Reserve(normalizedChunkSize + FileIngest::Base64::EncodedLength(normalizedChunkSize));
+                token.ThrowIfCancelled();
+                FileIngest::ChunkedStreamEncoder encoder(normalizedChunkSize, m_bufferPool);
+                for (uint64_t offset = 0; offset < totalBytes; offset += normalizedChunkSize) {
+                    token.ThrowIfCancelled();
+                    size_t length = static_cast<size_t>(std::min<uint64_t>(totalBytes - offset, normalizedChunkSize));
+                    mapped->Prefetch(offset + length, normalizedChunkSize);
+                    FileIngest::StageTimer encodeTimer(m_tracer, FileIngest::TraceStage::Encode, traceTag, length);
+                    encoder.Append(mapped->Data() + offset, length, emit);
+                    encodeTimer.Stop();
+                }
+                summary = encoder.Finish(emit);
+            } else {
+                winrt::Windows::Storage::Streams::DataReader dataReader = winrt::Windows::Storage::Streams::DataReader(stream);
+                FileIngest::StageTimer sniffTimer(m_tracer, FileIngest::TraceStage::Sniff, traceTag);
+                SniffedHead head;
+                uint32_t headLength = co_await dataReader.LoadAsync(static_cast<uint32_t>(head.size()));
+                CheckPickedFile(fileType, totalBytes, dataReader, head, headLength);
+                sniffTimer.AddBytes(headLength);
+                sniffTimer.Stop();
+
+                auto reservation = co_await m_memoryBudget.Reserve(normalizedChunkSize + FileIngest::Base64::EncodedLength(normalizedChunkSize));
+                token.ThrowIfCancelled();
+                FileIngest::ChunkedStreamEncoder encoder(normalizedChunkSize, m_bufferPool);
+                std::copy_n(head.data(), headLength, encoder.WritePointer());
+                encoder.Commit(headLength, emit);
+                for (;;) {
+                    token.ThrowIfCancelled();
+                    FileIngest::StageTimer loadTimer(m_tracer, FileIngest::TraceStage::Load, traceTag);
+                    uint32_t loaded = co_await dataReader.LoadAsync(static_cast<uint32_t>(encoder.WritableBytes()));
+                    if (loaded == 0) {
+                        loadTimer.Stop();
+                        break;
                     }
-                });
-            } catch (const std::exception& e) {
-                promise.Reject(e.what());
+                    dataReader.ReadBytes(winrt::array_view<uint8_t>(encoder.WritePointer(), encoder.WritePointer() + loaded));
+                    loadTimer.AddBytes(loaded);
+                    loadTimer.Stop();
+                    FileIngest::StageTimer encodeTimer(m_tracer, FileIngest::TraceStage::Encode, traceTag, loaded);
+                    encoder.Commit(loaded, emit);
+                    encodeTimer.Stop();
+                }
+                summary = encoder.Finish(emit);
+            }
+
+            // Resolve with a summary, the data itself went through the chunk events
+            winrt::Microsoft::ReactNative::JSValueObject result;
+            result["requestId"] = requestId;
+            result["fileName"] = fileName;
+            result["totalBytes"] = static_cast<int64_t>(summary.totalBytes);
+            result["encodedLength"] = static_cast<int64_t>(summary.encodedLength);
+            result["chunkCount"] = static_cast<int64_t>(summary.chunkCount);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+        } catch (const FileIngest::OperationCancelled& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::FileRejected& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::MemoryBudgetExceeded& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading file").c_str());
+        }
+        m_requests.Release(requestId);
+    }
+
+    // Feeds the file to the CSV parser chunk by chunk and builds the form grid as it goes
+    winrt::fire_and_forget ParseCSVFileAsync(winrt::Windows::Storage::StorageFile file, std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken token;
+        try {
+            token = m_requests.Register(requestId, kReadTimeout);
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            co_return;
+        }
+        uint32_t traceTag = FileIngest::Tracer::Tag(requestId);
+        try {
+            co_await m_executor.Schedule(token);
+            FileIngest::StageTimer openTimer(m_tracer, FileIngest::TraceStage::Open, traceTag);
+            std::unique_ptr<FileIngest::MappedFileSource> mapped = TryMapFile(file);
+            winrt::Windows::Storage::Streams::IRandomAccessStreamWithContentType stream{ nullptr };
+            if (!mapped) {
+                stream = co_await file.OpenReadAsync();
             }
+            uint64_t totalBytes = mapped ? mapped->Size() : stream.Size();
+            openTimer.Stop();
+
+            FileIngest::CsvParser parser;
+            CellIdGenerator cellIds;
+            winrt::Microsoft::ReactNative::JSValueArray grid;
+            auto appendRow = [&](std::vector<std::string>& fields) {
+                bool isTitle = grid.empty();
+                winrt::Microsoft::ReactNative::JSValueArray row;
+                row.reserve(fields.size());
+                for (std::string& field : fields) {
+                    winrt::Microsoft::ReactNative::JSValueObject cell;
+                    cell["id"] = cellIds.Next();
+                    cell["value"] = std::move(field);
+                    cell["isTitle"] = isTitle;
+                    row.push_back(winrt::Microsoft::ReactNative::JSValue(std::move(cell)));
+                }
+                grid.push_back(winrt::Microsoft::ReactNative::JSValue(std::move(row)));
+            };
+
+            if (mapped) {
+                FileIngest::CheckFile(kCsv, totalBytes, mapped->Data(), static_cast<size_t>(std::min<uint64_t>(totalBytes, FileIngest::kSniffLength)));
+
+                // The parser reads the mapped pages in place, so only the grid is reserved
+                auto reservation = co_await m_memoryBudget.Reserve(totalBytes);
+                token.ThrowIfCancelled();
+                FileIngest::StageTimer parseTimer(m_tracer, FileIngest::TraceStage::Parse, traceTag, totalBytes);
+                for (uint64_t offset = 0; offset < totalBytes; offset += FileIngest::kDefaultChunkSize) {
+                    token.ThrowIfCancelled();
+                    size_t length = static_cast<size_t>(std::min<uint64_t>(totalBytes - offset, FileIngest::kDefaultChunkSize));
+                    mapped->Prefetch(offset + length, FileIngest::kDefaultChunkSize);
+                    parser.Feed(reinterpret_cast<const char*>(mapped->Data() + offset), length, appendRow);
+                }
+                parser.Finish(appendRow);
+                parseTimer.Stop();
+            } else {
+                winrt::Windows::Storage::Streams::DataReader dataReader = winrt::Windows::Storage::Streams::DataReader(stream);
+                SniffedHead head;
+                uint32_t headLength = co_await dataReader.LoadAsync(static_cast<uint32_t>(head.size()));
+                CheckPickedFile(kCsv, totalBytes, dataReader, head, headLength);
+
+                // Loads and parses are interleaved, so they are timed together
+                FileIngest::StageTimer parseTimer(m_tracer, FileIngest::TraceStage::Parse, traceTag, headLength);
+                parser.Feed(reinterpret_cast<const char*>(head.data()), headLength, appendRow);
+
+                // The grid holds every field once, so it grows to about the file size
+                auto reservation = co_await m_memoryBudget.Reserve(FileIngest::kDefaultChunkSize + totalBytes);
+                token.ThrowIfCancelled();
+                FileIngest::PooledBuffer buffer = m_bufferPool.Acquire(FileIngest::kDefaultChunkSize);
+                for (;;) {
+                    token.ThrowIfCancelled();
+                    uint32_t loaded = co_await dataReader.LoadAsync(static_cast<uint32_t>(buffer.Size()));
+                    if (loaded == 0) {
+                        break;
+                    }
+                    dataReader.ReadBytes(winrt::array_view<uint8_t>(buffer.Data(), buffer.Data() + loaded));
+                    parser.Feed(reinterpret_cast<const char*>(buffer.Data()), loaded, appendRow);
+                    parseTimer.AddBytes(loaded);
+                }
+                parser.Finish(appendRow);
+                parseTimer.Stop();
+            }
+
+            FileIngest::StageTimer resolveTimer(m_tracer, FileIngest::TraceStage::Resolve, traceTag);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(grid)));
+            resolveTimer.Stop();
+        } catch (const FileIngest::OperationCancelled& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::FileRejected& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::MemoryBudgetExceeded& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error reading file").c_str());
+        }
+        m_requests.Release(requestId);
+    }
+
+    // What the server answered to one upload, and how the file was sent
+    struct UploadedFile
+    {
+        int32_t statusCode = 0;
+        bool succeeded = false;
+        std::string body;
+        FileIngest::ContentCoding coding = FileIngest::ContentCoding::Identity;
+        uint64_t fileBytes = 0;
+        uint64_t encodedBytes = 0;
+    };
+
+    static void WriteUploadResult(UploadedFile const& uploaded, winrt::Microsoft::ReactNative::JSValueObject& result) {
+        result["statusCode"] = static_cast<int64_t>(uploaded.statusCode);
+        result["body"] = uploaded.body;
+        result["contentEncoding"] = std::string(FileIngest::ContentCodingName(uploaded.coding));
+        result["fileBytes"] = static_cast<int64_t>(uploaded.fileBytes);
+        result["encodedBytes"] = static_cast<int64_t>(uploaded.encodedBytes);
+    }
+
+    static std::string DescribeUploadStatus(UploadedFile const& uploaded) {
+        return "HTTP error! Status: " + std::to_string(uploaded.statusCode);
+    }
+
+    winrt::fire_and_forget UploadFileAsync(winrt::Windows::Storage::StorageFile file, std::string requestId, std::string url, std::string token, std::string fileName, std::string destinationPath, FileIngest::CompressionMode compression, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken cancellation;
+        try {
+            cancellation = m_requests.Register(requestId, kUploadTimeout);
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            co_return;
+        }
+        uint32_t traceTag = FileIngest::Tracer::Tag(requestId);
+        try {
+            co_await m_executor.Schedule(cancellation);
+            UploadedFile uploaded = co_await PostFileAsync(file, requestId, std::nullopt, url, token, fileName, destinationPath, compression, cancellation, traceTag);
+            if (!uploaded.succeeded) {
+                promise.Reject(DescribeUploadStatus(uploaded).c_str());
+            } else {
+                winrt::Microsoft::ReactNative::JSValueObject result;
+                WriteUploadResult(uploaded, result);
+                promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+            }
+        } catch (const winrt::hresult_canceled&) {
+            promise.Reject(cancellation.IsExpired() ? "Upload timed out" : "Upload cancelled");
+        } catch (const FileIngest::OperationCancelled& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::FileRejected& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error uploading file").c_str());
+        }
+        m_requests.Release(requestId);
+    }
+
+    // Shared by the per-file coroutines of one uploadMultiplePDFFiles call
+    struct UploadBatch
+    {
+        UploadBatch(FileIngest::IoExecutor& executor, uint32_t fileCount, std::string requestId, std::string url, std::string token, std::string fileName, std::string destinationPath, FileIngest::CompressionMode compression, FileIngest::CancellationToken cancellation, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise)
+            : permits(executor, kMaxParallelUploads), countdown(fileCount), fileCount(fileCount), requestId(std::move(requestId)), url(std::move(url)), token(std::move(token)), fileName(std::move(fileName)), destinationPath(std::move(destinationPath)), compression(compression), traceTag(FileIngest::Tracer::Tag(this->requestId)), cancellation(std::move(cancellation)), promise(std::move(promise)) {}
+
+        FileIngest::AsyncSemaphore permits;
+        FileIngest::BatchCountdown countdown;
+        std::atomic<uint32_t> failedCount{ 0 };
+        const uint32_t fileCount;
+        const std::string requestId;
+        const std::string url;
+        const std::string token;
+        const std::string fileName;
+        const std::string destinationPath;
+        const FileIngest::CompressionMode compression;
+        const uint32_t traceTag;
+        const FileIngest::CancellationToken cancellation;
+        winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise;
+    };
+
+    // The first file keeps `fileName`, the next ones get "_2", "_3"... before the extension so
+    // the documents of one batch do not overwrite each other on the server
+    static std::string BatchFileName(std::string const& fileName, uint32_t index) {
+        if (index == 0) {
+            return fileName;
+        }
+        std::string stem = fileName;
+        std::string extension = stem.size() >= 4 ? stem.substr(stem.size() - 4) : std::string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension == ".pdf") {
+            stem.resize(stem.size() - 4);
+        }
+        return stem + "_" + std::to_string(index + 1) + ".pdf";
+    }
+
+    void UploadMultipleFilesAsync(winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Storage::StorageFile> files, std::string requestId, std::string url, std::string token, std::string fileName, std::string destinationPath, FileIngest::CompressionMode compression, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken cancellation;
+        try {
+            cancellation = m_requests.Register(requestId, kUploadTimeout * files.Size());
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            return;
+        }
+        auto batch = std::make_shared<UploadBatch>(m_executor, files.Size(), requestId, url, token, fileName, destinationPath, compression, cancellation, promise);
+        for (uint32_t index = 0; index < files.Size(); index++) {
+            UploadBatchFileAsync(batch, files.GetAt(index), index);
+        }
+    }
+
+    // Emits one fileResult event per file, with the server's answer or the reason the upload
+    // failed, and resolves the batch promise once the last file is done
+    winrt::fire_and_forget UploadBatchFileAsync(std::shared_ptr<UploadBatch> batch, winrt::Windows::Storage::StorageFile file, uint32_t index) noexcept {
+        winrt::Microsoft::ReactNative::JSValueObject result;
+        result["requestId"] = batch->requestId;
+        result["index"] = static_cast<int64_t>(index);
+        std::string name = BatchFileName(batch->fileName, index);
+        result["name"] = name;
+        try {
+            result["fileName"] = winrt::to_string(file.Name());
+            auto permit = co_await batch->permits.Acquire();
+            co_await m_executor.Schedule(batch->cancellation);
+            UploadedFile uploaded = co_await PostFileAsync(file, batch->requestId, index, batch->url, batch->token, name, batch->destinationPath, batch->compression, batch->cancellation, batch->traceTag);
+            WriteUploadResult(uploaded, result);
+            if (!uploaded.succeeded) {
+                result["error"] = DescribeUploadStatus(uploaded);
+            }
+        } catch (const winrt::hresult_canceled&) {
+            result["error"] = std::string(batch->cancellation.IsExpired() ? "Upload timed out" : "Upload cancelled");
+        } catch (const FileIngest::OperationCancelled& e) {
+            result["error"] = std::string(e.what());
+        } catch (const FileIngest::FileRejected& e) {
+            result["error"] = std::string(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            result["error"] = std::string(e.what());
+        } catch (...) {
+            result["error"] = DescribeFailure("Error uploading file");
+        }
+        if (result.find("error") != result.end()) {
+            batch->failedCount++;
+        }
+        OnFileResult(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+
+        if (batch->countdown.Complete()) {
+            winrt::Microsoft::ReactNative::JSValueObject summary;
+            summary["requestId"] = batch->requestId;
+            summary["fileCount"] = static_cast<int64_t>(batch->fileCount);
+            summary["failedCount"] = static_cast<int64_t>(batch->failedCount.load());
+            batch->promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(summary)));
+            m_requests.Release(batch->requestId);
+        }
+    }
+
+    // The file part is an HttpStreamContent over the file's sequential stream, so the body is
+    // sent with chunked transfer encoding and never held in memory as a whole. When the file is
+    // to be compressed, the stream is gzipped block by block as the request reads it, and a 415
+    // for the gzipped part repeats the upload uncompressed. Progress events carry `index` when
+    // the file is part of a batch. A non-2xx answer is returned, not thrown, so a batch can report
+    // it with the server's body.
+    FileIngest::Task<UploadedFile> PostFileAsync(winrt::Windows::Storage::StorageFile file, std::string requestId, std::optional<uint32_t> index, std::string url, std::string token, std::string fileName, std::string destinationPath, FileIngest::CompressionMode compression, FileIngest::CancellationToken cancellation, uint32_t traceTag) {
+        FileIngest::StageTimer openTimer(m_tracer, FileIngest::TraceStage::Open, traceTag);
+        auto stream = co_await file.OpenReadAsync();
+        winrt::Windows::Storage::Streams::DataReader dataReader = winrt::Windows::Storage::Streams::DataReader(stream);
+        openTimer.Stop();
+        SniffedHead head;
+        uint32_t headLength = co_await dataReader.LoadAsync(static_cast<uint32_t>(head.size()));
+        std::string_view mimeType = CheckPickedFile(kPdf, stream.Size(), dataReader, head, headLength);
+
+        // Auto compresses the file's first bytes to see whether gzip is worth it
+        FileIngest::ContentCoding coding = FileIngest::ChooseContentCoding(compression, mimeType, nullptr, 0);
+        if (FileIngest::NeedsCompressionSample(compression, mimeType)) {
+            FileIngest::PooledBuffer sample = m_bufferPool.Acquire(FileIngest::kCompressionSampleLength);
+            std::copy_n(head.data(), headLength, sample.Data());
+            uint32_t sampleLength = headLength + co_await dataReader.LoadAsync(static_cast<uint32_t>(sample.Size() - headLength));
+            dataReader.ReadBytes(winrt::array_view<uint8_t>(sample.Data() + headLength, sample.Data() + sampleLength));
+            co_await m_executor.Schedule(cancellation);
+            FileIngest::StageTimer sampleTimer(m_tracer, FileIngest::TraceStage::Compress, traceTag, sampleLength);
+            coding = FileIngest::ChooseContentCoding(compression, mimeType, sample.Data(), sampleLength);
+            sampleTimer.Stop();
+        }
+        dataReader.DetachStream();
+
+        // Same fields as DocumentServicePost.createFormData on the other platforms, the
+        // body is read sequentially from the start of the file again
+        winrt::com_ptr<GzipInputStream> gzipStream;
+        winrt::Windows::Storage::Streams::IInputStream fileStream = stream.GetInputStreamAt(0);
+        if (coding == FileIngest::ContentCoding::Gzip) {
+            gzipStream = winrt::make_self<GzipInputStream>(fileStream, m_tracer, traceTag);
+            fileStream = gzipStream.as<winrt::Windows::Storage::Streams::IInputStream>();
+        }
+        winrt::Windows::Web::Http::HttpStreamContent fileContent(fileStream);
+        fileContent.Headers().ContentType(winrt::Windows::Web::Http::Headers::HttpMediaTypeHeaderValue(winrt::to_hstring(mimeType)));
+        if (gzipStream) {
+            fileContent.Headers().ContentEncoding().Append(winrt::Windows::Web::Http::Headers::HttpContentCodingHeaderValue(winrt::to_hstring(FileIngest::ContentCodingName(coding))));
+        }
+        winrt::Windows::Web::Http::HttpMultipartFormDataContent form;
+        form.Add(fileContent, L"file", winrt::to_hstring(fileName));
+        form.Add(winrt::Windows::Web::Http::HttpStringContent(file.Path()), L"uri");
+        form.Add(winrt::Windows::Web::Http::HttpStringContent(winrt::to_hstring(fileName)), L"name");
+        form.Add(winrt::Windows::Web::Http::HttpStringContent(winrt::to_hstring(destinationPath)), L"path");
+
+        winrt::Windows::Web::Http::HttpClient client;
+        if (!token.empty()) {
+            client.DefaultRequestHeaders().Authorization(winrt::Windows::Web::Http::Headers::HttpCredentialsHeaderValue(L"Bearer", winrt::to_hstring(token)));
+        }
+
+        // Covers sending the body and reading the response
+        FileIngest::StageTimer uploadTimer(m_tracer, FileIngest::TraceStage::Upload, traceTag, stream.Size());
+        auto operation = client.PostAsync(winrt::Windows::Foundation::Uri(winrt::to_hstring(url)), form);
+        operation.Progress([this, requestId, index](auto const&, winrt::Windows::Web::Http::HttpProgress const& progress) {
+            winrt::Microsoft::ReactNative::JSValueObject progressEvent;
+            progressEvent["requestId"] = requestId;
+            if (index) {
+                progressEvent["index"] = static_cast<int64_t>(*index);
+            }
+            progressEvent["bytesSent"] = static_cast<int64_t>(progress.BytesSent);
+            progressEvent["totalBytes"] = progress.TotalBytesToSend ? static_cast<int64_t>(progress.TotalBytesToSend.Value()) : int64_t(-1);
+            OnUploadProgress(winrt::Microsoft::ReactNative::JSValue(std::move(progressEvent)));
         });
+
+        // Progress stops once the body is sent, so cancel and the deadline are watched on a timer
+        winrt::Windows::Web::Http::HttpResponseMessage response{ nullptr };
+        {
+            ModuleSupport::CancelWatch watch(operation, cancellation);
+            response = co_await operation;
+        }
+        winrt::hstring body;
+        {
+            auto reading = response.Content().ReadAsStringAsync();
+            ModuleSupport::CancelWatch watch(reading, cancellation);
+            body = co_await reading;
+        }
+        UploadedFile uploaded;
+        uploaded.statusCode = static_cast<int32_t>(response.StatusCode());
+        uploaded.succeeded = response.IsSuccessStatusCode();
+        uploaded.body = winrt::to_string(body);
+        uploaded.coding = coding;
+        uploaded.fileBytes = stream.Size();
+        uploaded.encodedBytes = gzipStream ? gzipStream->OutputBytes() : stream.Size();
+        if (gzipStream && response.StatusCode() == winrt::Windows::Web::Http::HttpStatusCode::UnsupportedMediaType) {
+            co_await m_executor.Schedule(cancellation);
+            co_return co_await PostFileAsync(file, requestId, index, url, token, fileName, destinationPath, FileIngest::CompressionMode::None, cancellation, traceTag);
+        }
+        if (uploaded.succeeded) {
+            uploadTimer.Stop();
+        }
+        co_return uploaded;
     }
 
-    REACT_METHOD(ReadCSVFileData, L"readCSVFileData");
-    void ReadCSVFileData(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
-        // Run the operation on the UI thread
-        m_reactContext.UIDispatcher().Post([promise, this]() {
+    // Chunks the file on a worker, then posts only the chunks missing from the base version; the
+    // manifest is kept in the content store once the server has accepted it
+    winrt::fire_and_forget UploadDeltaAsync(winrt::Windows::Storage::StorageFile file, std::string requestId, std::string url, std::string token, std::string fileName, std::string destinationPath, std::string baseManifest, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken cancellation;
+        try {
+            cancellation = m_requests.Register(requestId, kUploadTimeout);
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            co_return;
+        }
+        uint32_t traceTag = FileIngest::Tracer::Tag(requestId);
+        try {
+            co_await m_executor.Schedule(cancellation);
+            FileIngest::StageTimer openTimer(m_tracer, FileIngest::TraceStage::Open, traceTag);
+            auto upload = std::make_shared<DeltaUpload>();
+            upload->source = std::make_unique<FileIngest::NativeFileSource>(OpenBrokeredHandle(file));
+            openTimer.Stop();
+            FileIngest::StageTimer sniffTimer(m_tracer, FileIngest::TraceStage::Sniff, traceTag);
+            SniffedHead head;
+            size_t headLength = upload->source->ReadAt(0, head.data(), head.size());
+            FileIngest::CheckFile(kPdf, upload->source->Size(), head.data(), headLength);
+            sniffTimer.AddBytes(headLength);
+            sniffTimer.Stop();
+
+            {
+                auto reservation = co_await m_memoryBudget.Reserve(kDeltaReadSize);
+                FileIngest::PooledBuffer buffer = m_bufferPool.Acquire(kDeltaReadSize);
+                FileIngest::StageTimer chunkTimer(m_tracer, FileIngest::TraceStage::Chunk, traceTag, upload->source->Size());
+                upload->manifest = FileIngest::BuildManifest(*upload->source, buffer.Data(), buffer.Size());
+                chunkTimer.Stop();
+            }
+            std::vector<uint8_t> manifestBytes = upload->manifest.Serialize();
+            FileIngest::Sha256Digest manifestDigest = FileIngest::Sha256::Hash(manifestBytes.data(), manifestBytes.size());
+
+            // No base, or one evicted from the store, means every chunk is sent
+            std::optional<FileIngest::ChunkManifest> base;
+            FileIngest::Sha256Digest baseDigest;
+            std::vector<uint8_t> baseBytes;
+            if (FileIngest::ParseHex(baseManifest, baseDigest) && Store().Get(baseDigest, baseBytes)) {
+                try {
+                    base = FileIngest::ChunkManifest::Parse(baseBytes);
+                } catch (const FileIngest::ManifestError&) {
+                }
+            }
+
+            winrt::Windows::Web::Http::HttpClient client;
+            if (!token.empty()) {
+                client.DefaultRequestHeaders().Authorization(winrt::Windows::Web::Http::Headers::HttpCredentialsHeaderValue(L"Bearer", winrt::to_hstring(token)));
+            }
+            winrt::Windows::Web::Http::HttpResponseMessage response{ nullptr };
+            FileIngest::StageTimer uploadTimer(m_tracer, FileIngest::TraceStage::Upload, traceTag);
+            for (bool useBase = base.has_value();; useBase = false) {
+                upload->plan = FileIngest::PlanDelta(upload->manifest, useBase ? &*base : nullptr);
+
+                winrt::Windows::Storage::Streams::Buffer manifestBuffer(static_cast<uint32_t>(manifestBytes.size()));
+                std::copy(manifestBytes.begin(), manifestBytes.end(), manifestBuffer.data());
+                manifestBuffer.Length(static_cast<uint32_t>(manifestBytes.size()));
+                winrt::Windows::Web::Http::HttpBufferContent manifestContent(manifestBuffer);
+                manifestContent.Headers().ContentType(winrt::Windows::Web::Http::Headers::HttpMediaTypeHeaderValue(L"application/octet-stream"));
+                winrt::Windows::Web::Http::HttpStreamContent chunksContent(winrt::make<DeltaInputStream>(upload));
+                chunksContent.Headers().ContentType(winrt::Windows::Web::Http::Headers::HttpMediaTypeHeaderValue(L"application/octet-stream"));
+
+                winrt::Windows::Web::Http::HttpMultipartFormDataContent form;
+                form.Add(manifestContent, L"manifest", L"manifest.bin");
+                form.Add(chunksContent, L"chunks", L"chunks.bin");
+                form.Add(winrt::Windows::Web::Http::HttpStringContent(winrt::to_hstring(useBase ? FileIngest::ToHex(baseDigest) : std::string())), L"baseManifest");
+                form.Add(winrt::Windows::Web::Http::HttpStringContent(winrt::to_hstring(fileName)), L"name");
+                form.Add(winrt::Windows::Web::Http::HttpStringContent(winrt::to_hstring(destinationPath)), L"path");
+
+                auto operation = client.PostAsync(winrt::Windows::Foundation::Uri(winrt::to_hstring(url)), form);
+                operation.Progress([this, requestId](auto const&, winrt::Windows::Web::Http::HttpProgress const& progress) {
+                    winrt::Microsoft::ReactNative::JSValueObject progressEvent;
+                    progressEvent["requestId"] = requestId;
+                    progressEvent["bytesSent"] = static_cast<int64_t>(progress.BytesSent);
+                    progressEvent["totalBytes"] = progress.TotalBytesToSend ? static_cast<int64_t>(progress.TotalBytesToSend.Value()) : int64_t(-1);
+                    OnUploadProgress(winrt::Microsoft::ReactNative::JSValue(std::move(progressEvent)));
+                });
+                {
+                    ModuleSupport::CancelWatch watch(operation, cancellation);
+                    response = co_await operation;
+                }
+                if (!useBase || response.StatusCode() != winrt::Windows::Web::Http::HttpStatusCode::Conflict) {
+                    break;
+                }
+            }
+
+            winrt::hstring body;
+            {
+                auto reading = response.Content().ReadAsStringAsync();
+                ModuleSupport::CancelWatch watch(reading, cancellation);
+                body = co_await reading;
+            }
+            int32_t statusCode = static_cast<int32_t>(response.StatusCode());
+            if (!response.IsSuccessStatusCode()) {
+                promise.Reject(("HTTP error! Status: " + std::to_string(statusCode)).c_str());
+            } else {
+                uint64_t sentBytes = manifestBytes.size() + FileIngest::DeltaPayload(*upload->source, upload->manifest, upload->plan).Size();
+                uploadTimer.AddBytes(sentBytes);
+                uploadTimer.Stop();
+                Store().Put(manifestDigest, manifestBytes.data(), manifestBytes.size());
+                winrt::Microsoft::ReactNative::JSValueObject result;
+                result["statusCode"] = static_cast<int64_t>(statusCode);
+                result["body"] = winrt::to_string(body);
+                result["manifest"] = FileIngest::ToHex(manifestDigest);
+                result["fileBytes"] = static_cast<int64_t>(upload->manifest.fileSize);
+                result["sentBytes"] = static_cast<int64_t>(sentBytes);
+                result["chunkCount"] = static_cast<int64_t>(upload->manifest.chunks.size());
+                result["sentChunks"] = static_cast<int64_t>(upload->plan.send.size());
+                promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+            }
+        } catch (const winrt::hresult_canceled&) {
+            promise.Reject(cancellation.IsExpired() ? "Upload timed out" : "Upload cancelled");
+        } catch (const FileIngest::OperationCancelled& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::FileRejected& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::MemoryBudgetExceeded& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error uploading file").c_str());
+        }
+        m_requests.Release(requestId);
+    }
+
+    // The first request asks for chunk 0 and learns the size, validator and digest from the
+    // answer; then kDownloadConnections connections take the remaining chunks in turn. Progress
+    // is saved on the way and on failure, and the file is hashed on a worker once complete.
+    winrt::fire_and_forget DownloadFileAsync(std::string requestId, std::string url, std::string token, std::optional<FileIngest::Sha256Digest> expected, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken cancellation;
+        try {
+            cancellation = m_requests.Register(requestId, kUploadTimeout);
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            co_return;
+        }
+        if (!ClaimDownload(url)) {
+            promise.Reject("Download already in progress for this url");
+            m_requests.Release(requestId);
+            co_return;
+        }
+        uint32_t traceTag = FileIngest::Tracer::Tag(requestId);
+        try {
+            co_await m_executor.Schedule(cancellation);
+            auto fetch = std::make_shared<RangeFetch>();
+            // Ranges have to address the bytes as sent, so nothing may decode them on the way,
+            // and the HTTP cache would only keep a second copy of the file
+            winrt::Windows::Web::Http::Filters::HttpBaseProtocolFilter filter;
+            filter.AutomaticDecompression(false);
+            filter.MaxConnectionsPerServer(kDownloadConnections);
+            filter.CacheControl().ReadBehavior(winrt::Windows::Web::Http::Filters::HttpCacheReadBehavior::NoCache);
+            filter.CacheControl().WriteBehavior(winrt::Windows::Web::Http::Filters::HttpCacheWriteBehavior::NoCache);
+            fetch->client = winrt::Windows::Web::Http::HttpClient(filter);
+            if (!token.empty()) {
+                fetch->client.DefaultRequestHeaders().Authorization(winrt::Windows::Web::Http::Headers::HttpCredentialsHeaderValue(L"Bearer", winrt::to_hstring(token)));
+            }
+            fetch->uri = winrt::Windows::Foundation::Uri(winrt::to_hstring(url));
+
+            FileIngest::StageTimer downloadTimer(m_tracer, FileIngest::TraceStage::Download, traceTag);
+            winrt::Windows::Web::Http::HttpResponseMessage response{ nullptr };
+            for (uint32_t attempt = 1;; attempt++) {
+                try {
+                    winrt::Windows::Web::Http::HttpRequestMessage request(winrt::Windows::Web::Http::HttpMethod::Get(), fetch->uri);
+                    request.Headers().TryAppendWithoutValidation(L"Range", winrt::to_hstring(FileIngest::RangeHeader({ 0, 0, kDownloadChunkSize })));
+                    fetch->requests++;
+                    response = co_await SendAsync(fetch, request, cancellation);
+                    break;
+                } catch (const winrt::hresult_canceled&) {
+                    throw;
+                } catch (const winrt::hresult_error&) {
+                    fetch->retries++;
+                    if (attempt == FileIngest::RangeDownload::kMaxAttempts) {
+                        throw;
+                    }
+                }
+                cancellation.ThrowIfCancelled();
+            }
+            int32_t statusCode = static_cast<int32_t>(response.StatusCode());
+            if (!response.IsSuccessStatusCode()) {
+                promise.Reject(("HTTP error! Status: " + std::to_string(statusCode)).c_str());
+                ReleaseDownload(url);
+                m_requests.Release(requestId);
+                co_return;
+            }
+            FileIngest::Sha256Digest serverDigest;
+            if (!expected && (FileIngest::ParseDigestHeader(ResponseHeader(response, L"Repr-Digest"), serverDigest) || FileIngest::ParseDigestHeader(ResponseHeader(response, L"Digest"), serverDigest))) {
+                expected = serverDigest;
+            }
+            fetch->validator = FileIngest::ChooseValidator(ResponseHeader(response, L"ETag"), ResponseHeader(response, L"Last-Modified"));
+            uint64_t total = 0;
+            bool ranged = FileIngest::IsRangedFirstAnswer(statusCode, ResponseHeader(response, L"Content-Range"), total);
+            std::filesystem::path path = DownloadPath(url);
+            if (ranged) {
+                fetch->download.emplace(path, total, kDownloadChunkSize, fetch->validator);
+            } else {
+                // No Range support: the whole file arrives in this answer as one chunk, and a
+                // download cut short starts over
+                auto length = response.Content().Headers().ContentLength();
+                if (!length || length.Value() > UINT32_MAX) {
+                    throw FileIngest::DownloadError("Cannot download this file without Range support");
+                }
+                fetch->download.emplace(path, length.Value(), static_cast<uint32_t>(std::max<uint64_t>(length.Value(), 1)), std::string());
+            }
+
+            FileIngest::DownloadRange range;
+            if (!ranged) {
+                co_await ReceiveWholeAsync(fetch, response, cancellation);
+            } else if (fetch->download->Claim(0, range)) {
+                try {
+                    co_await ReceiveRangeAsync(fetch, response, range, cancellation);
+                    fetch->download->Complete(range);
+                } catch (const winrt::hresult_canceled&) {
+                    throw;
+                } catch (const winrt::hresult_error&) {
+                    // Left to the connections below
+                    fetch->retries++;
+                    fetch->download->Fail(range);
+                }
+            }
+            response.Close();
+
+            std::vector<winrt::Windows::Foundation::IAsyncAction> connections;
+            for (uint32_t i = 0; i < kDownloadConnections; i++) {
+                connections.push_back(FetchRangesAsync(fetch, cancellation));
+            }
+            std::exception_ptr failure;
+            for (auto& connection : connections) {
+                try {
+                    co_await connection;
+                } catch (...) {
+                    if (!failure) {
+                        failure = std::current_exception();
+                    }
+                }
+            }
+            if (failure) {
+                fetch->download->Checkpoint();
+                std::rethrow_exception(failure);
+            }
+            downloadTimer.AddBytes(fetch->fetchedBytes);
+            downloadTimer.Stop();
+
+            co_await m_executor.Schedule(cancellation);
+            FileIngest::StageTimer storeTimer(m_tracer, FileIngest::TraceStage::Store, traceTag, fetch->download->Size());
+            FileIngest::Sha256Digest digest;
+            {
+                auto reservation = co_await m_memoryBudget.Reserve(kDeltaReadSize);
+                FileIngest::PooledBuffer buffer = m_bufferPool.Acquire(kDeltaReadSize);
+                digest = fetch->download->Digest(buffer.Data(), buffer.Size());
+            }
+            if (expected && digest != *expected) {
+                fetch->download->Discard();
+                throw FileIngest::DownloadError("Downloaded file does not match its digest");
+            }
+            uint64_t size = fetch->download->Size();
+            fetch->download->Finish();
+            Store().PutFile(digest, path);
+            if (!Store().Contains(digest)) {
+                throw FileIngest::DownloadError("Downloaded file does not fit in the content store");
+            }
+            storeTimer.Stop();
+
+            winrt::Microsoft::ReactNative::JSValueObject result;
+            result["digest"] = FileIngest::ToHex(digest);
+            result["bytes"] = static_cast<int64_t>(size);
+            result["resumedBytes"] = static_cast<int64_t>(fetch->download->ResumedBytes());
+            result["fetchedBytes"] = static_cast<int64_t>(fetch->fetchedBytes.load());
+            result["requests"] = static_cast<int64_t>(fetch->requests.load());
+            result["retries"] = static_cast<int64_t>(fetch->retries.load());
+            result["ranged"] = ranged;
+            result["verified"] = expected.has_value();
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+        } catch (const winrt::hresult_canceled&) {
+            promise.Reject(cancellation.IsExpired() ? "Download timed out" : "Download cancelled");
+        } catch (const FileIngest::OperationCancelled& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::DownloadError& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            promise.Reject(e.what());
+        } catch (const FileIngest::MemoryBudgetExceeded& e) {
+            promise.Reject(e.what());
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error downloading file").c_str());
+        }
+        ReleaseDownload(url);
+        m_requests.Release(requestId);
+    }
+
+    // One connection of a download. A network error hands the chunk back to be retried, up to
+    // RangeDownload::kMaxAttempts times; anything else stops every connection.
+    static winrt::Windows::Foundation::IAsyncAction FetchRangesAsync(std::shared_ptr<RangeFetch> fetch, FileIngest::CancellationToken cancellation) {
+        FileIngest::DownloadRange range;
+        while (!fetch->stop && fetch->download->Next(range)) {
             try {
-                // Create a FileOpenPicker
-                winrt::Windows::Storage::Pickers::FileOpenPicker picker;
-                picker.SuggestedStartLocation(winrt::Windows::Storage::Pickers::PickerLocationId::DocumentsLibrary);
-                picker.FileTypeFilter().Append(L".csv");
+                cancellation.ThrowIfCancelled();
+                winrt::Windows::Web::Http::HttpRequestMessage request(winrt::Windows::Web::Http::HttpMethod::Get(), fetch->uri);
+                request.Headers().TryAppendWithoutValidation(L"Range", winrt::to_hstring(FileIngest::RangeHeader(range)));
+                if (!fetch->validator.empty()) {
+                    request.Headers().TryAppendWithoutValidation(L"If-Range", winrt::to_hstring(fetch->validator));
+                }
+                fetch->requests++;
+                winrt::Windows::Web::Http::HttpResponseMessage response = co_await SendAsync(fetch, request, cancellation);
+                uint64_t first = 0, last = 0, total = 0;
+                if (response.StatusCode() != winrt::Windows::Web::Http::HttpStatusCode::PartialContent
+                    || !FileIngest::ParseContentRange(ResponseHeader(response, L"Content-Range"), first, last, total) || first != range.offset || total != fetch->download->Size()) {
+                    // A 200 is the whole file again: it changed since the first request
+                    throw FileIngest::DownloadError("File changed on the server");
+                }
+                co_await ReceiveRangeAsync(fetch, response, range, cancellation);
+                response.Close();
+                fetch->download->Complete(range);
+            } catch (const winrt::hresult_canceled&) {
+                fetch->download->Fail(range);
+                fetch->stop = true;
+                throw;
+            } catch (const winrt::hresult_error&) {
+                fetch->retries++;
+                if (!fetch->download->Fail(range)) {
+                    fetch->stop = true;
+                    throw FileIngest::DownloadError("Download failed after retries");
+                }
+            } catch (...) {
+                fetch->download->Fail(range);
+                fetch->stop = true;
+                throw;
+            }
+        }
+    }
 
-                // Launch the picker (this is asynchronous)
-                picker.PickSingleFileAsync().Completed([promise](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
-                    if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                        winrt::Windows::Storage::StorageFile file = operation.GetResults();
-                        if (file) {
-                            // Read the file content
-                            auto readOperation = file.OpenReadAsync();
-                            readOperation.Completed([promise](auto const& operation, auto const status) {
-                                if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                                    auto stream = operation.GetResults();
-                                    // Create a DataReader from the stream
-                                    winrt::Windows::Storage::Streams::DataReader dataReader = winrt::Windows::Storage::Streams::DataReader(stream);
-                                    
-                                    // Load the entire stream into the DataReader
-                                    uint32_t bytesLoaded = dataReader.LoadAsync(static_cast<uint32_t>(stream.Size())).get();  // Use get() to wait for completion
-
-                                    // Read the bytes into a buffer
-                                    std::vector<uint8_t> buffer(bytesLoaded);
-                                    dataReader.ReadBytes(buffer);
-
-                                    // Convert buffer to Base64 string
-                                    std::string base64String = winrt::to_string(winrt::Windows::Security::Cryptography::CryptographicBuffer::EncodeToBase64String(winrt::Windows::Security::Cryptography::CryptographicBuffer::CreateFromByteArray(buffer)));
-
-                                    // Resolve with JSValue containing Base64 string
-                                    promise.Resolve(winrt::Microsoft::ReactNative::JSValue(base64String));
-                                } else {
-                                    promise.Reject("Error reading file");
-                                }
-                            });
-                        } else {
-                            promise.Resolve(winrt::Microsoft::ReactNative::JSValue("No file selected"));
-                        }
-                    } else {
-                        promise.Reject("Error opening file dialog");
+    // Sends a download request and waits for its headers; cancel and the deadline stop it even
+    // while the server stalls
+    static winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Web::Http::HttpResponseMessage> SendAsync(std::shared_ptr<RangeFetch> fetch, winrt::Windows::Web::Http::HttpRequestMessage request, FileIngest::CancellationToken cancellation) {
+        auto operation = fetch->client.SendRequestAsync(request, winrt::Windows::Web::Http::HttpCompletionOption::ResponseHeadersRead);
+        ModuleSupport::CancelWatch watch(operation, cancellation);
+        co_return co_await operation;
+    }
+
+    // Reads the answer of a server without Range support, the whole file as the download's one
+    // chunk. A dropped connection asks for the whole file again in place, up to kMaxAttempts
+    // times, since a Range request would only get another 200.
+    static winrt::Windows::Foundation::IAsyncAction ReceiveWholeAsync(std::shared_ptr<RangeFetch> fetch, winrt::Windows::Web::Http::HttpResponseMessage response, FileIngest::CancellationToken cancellation) {
+        FileIngest::DownloadRange range;
+        if (!fetch->download->Claim(0, range)) {
+            co_return;
+        }
+        for (uint32_t attempt = 1;; attempt++) {
+            try {
+                if (attempt > 1) {
+                    response.Close();
+                    winrt::Windows::Web::Http::HttpRequestMessage request(winrt::Windows::Web::Http::HttpMethod::Get(), fetch->uri);
+                    fetch->requests++;
+                    response = co_await SendAsync(fetch, request, cancellation);
+                    if (response.StatusCode() != winrt::Windows::Web::Http::HttpStatusCode::Ok) {
+                        throw FileIngest::DownloadError("Unexpected status " + std::to_string(static_cast<int32_t>(response.StatusCode())));
                     }
-                });
-            } catch (const std::exception& e) {
-                promise.Reject(e.what());
+                }
+                co_await ReceiveRangeAsync(fetch, response, range, cancellation);
+                fetch->download->Complete(range);
+                co_return;
+            } catch (const winrt::hresult_canceled&) {
+                throw;
+            } catch (const winrt::hresult_error&) {
+                fetch->retries++;
+                if (attempt == FileIngest::RangeDownload::kMaxAttempts) {
+                    throw FileIngest::DownloadError("Download failed after retries");
+                }
             }
-        });
+            cancellation.ThrowIfCancelled();
+        }
+    }
+
+    // Streams an answer's body to its chunk's offset, a read at a time
+    static winrt::Windows::Foundation::IAsyncAction ReceiveRangeAsync(std::shared_ptr<RangeFetch> fetch, winrt::Windows::Web::Http::HttpResponseMessage response, FileIngest::DownloadRange range, FileIngest::CancellationToken cancellation) {
+        auto length = response.Content().Headers().ContentLength();
+        if (length && length.Value() != range.length) {
+            throw FileIngest::DownloadError("Server answered a different range");
+        }
+        winrt::Windows::Storage::Streams::IInputStream input{ nullptr };
+        {
+            auto opening = response.Content().ReadAsInputStreamAsync();
+            ModuleSupport::CancelWatch watch(opening, cancellation);
+            input = co_await opening;
+        }
+        winrt::Windows::Storage::Streams::Buffer buffer(kDownloadReadSize);
+        uint64_t at = 0;
+        for (;;) {
+            cancellation.ThrowIfCancelled();
+            winrt::Windows::Storage::Streams::IBuffer read{ nullptr };
+            {
+                auto reading = input.ReadAsync(buffer, buffer.Capacity(), winrt::Windows::Storage::Streams::InputStreamOptions::Partial);
+                ModuleSupport::CancelWatch watch(reading, cancellation);
+                read = co_await reading;
+            }
+            if (read.Length() == 0) {
+                break;
+            }
+            fetch->download->Write(range, at, read.data(), read.Length());
+            at += read.Length();
+            fetch->fetchedBytes += read.Length();
+        }
+        if (at != range.length) {
+            // Cut off early: retried like any other network failure
+            throw winrt::hresult_error(E_FAIL, L"Connection closed early");
+        }
     }
   };
 }
\ No newline at end of file
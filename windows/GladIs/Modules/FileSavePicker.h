@@ -0,0 +1,290 @@
+#pragma once
+
+#include "pch.h"
+#include <winrt/Windows.Storage.Pickers.h>
+#include <winrt/Windows.Storage.h>
+#include <winrt/Windows.Storage.Streams.h>
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Foundation.Collections.h>
+#include <winrt/Microsoft.ReactNative.h>
+#include "FileIngest/IoExecutor.h"
+#include "FileIngest/TableWriter.h"
+#include "FileIngest/XlsxWriter.h"
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace FileSavePickerModule
+{
+  // Save-side counterpart of FileOpenPicker: exports tables of any length to a file the user
+  // picks. JS opens an export, sends its rows in batches and finishes it. Rows are serialized
+  // off the JS thread by FileIngest's table writers and written out every kFlushSize bytes, and
+  // a batch only resolves once that is done, so a caller awaiting each batch keeps at most one
+  // batch and one flush in memory.
+  REACT_MODULE(FileSavePicker);
+  struct FileSavePicker final
+  {
+    React::ReactContext m_reactContext;
+
+    REACT_INIT(Initialize)
+    void Initialize(React::ReactContext const& reactContext) noexcept {
+      m_reactContext = reactContext;
+    }
+
+    // Shows the save dialog for a 'csv' or 'xlsx' file. Resolves with true once the file is open,
+    // or with a message string when the dialog is dismissed. CSV uses `delimiter`, ',' or ';'.
+    REACT_METHOD(BeginExport, L"beginExport");
+    void BeginExport(std::string requestId, std::string format, std::string suggestedName, std::string delimiter, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::ExportFormat exportFormat;
+        if (!FileIngest::ParseExportFormat(format, exportFormat)) {
+            promise.Reject("Unsupported export format");
+            return;
+        }
+        if (delimiter != "," && delimiter != ";") {
+            promise.Reject("Unsupported delimiter");
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_exports.count(requestId) != 0) {
+                promise.Reject("Export already started");
+                return;
+            }
+        }
+        m_reactContext.UIDispatcher().Post([this, requestId, exportFormat, suggestedName, delimiter, promise]() {
+            try {
+                winrt::Windows::Storage::Pickers::FileSavePicker picker;
+                picker.SuggestedStartLocation(winrt::Windows::Storage::Pickers::PickerLocationId::DocumentsLibrary);
+                auto extensions = winrt::single_threaded_vector<winrt::hstring>({ winrt::to_hstring(FileIngest::ExportExtension(exportFormat)) });
+                picker.FileTypeChoices().Insert(exportFormat == FileIngest::ExportFormat::Xlsx ? L"Excel" : L"CSV", extensions);
+                picker.SuggestedFileName(winrt::to_hstring(suggestedName));
+
+                picker.PickSaveFileAsync().Completed([this, requestId, exportFormat, delimiter, promise](winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> const& operation, winrt::Windows::Foundation::AsyncStatus const status) {
+                    if (status != winrt::Windows::Foundation::AsyncStatus::Completed) {
+                        promise.Reject("Error opening file dialog");
+                        return;
+                    }
+                    winrt::Windows::Storage::StorageFile file = operation.GetResults();
+                    if (!file) {
+                        promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::string("No file selected")));
+                        return;
+                    }
+                    OpenExportAsync(requestId, file, exportFormat, delimiter[0], promise);
+                });
+            } catch (const std::exception& e) {
+                promise.Reject(e.what());
+            }
+        });
+    }
+
+    // Appends rows, each an array of strings, numbers and nulls. Calls for one export must not
+    // overlap: a batch sent before the previous one resolved is rejected.
+    REACT_METHOD(WriteExportRows, L"writeExportRows");
+    void WriteExportRows(std::string requestId, winrt::Microsoft::ReactNative::JSValueArray rows, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        std::shared_ptr<Export> target = Acquire(requestId, promise);
+        if (target) {
+            WriteRowsAsync(std::move(target), std::move(rows), promise);
+        }
+    }
+
+    // Ends the file and resolves with { fileName, path, rows, bytes }
+    REACT_METHOD(FinishExport, L"finishExport");
+    void FinishExport(std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        std::shared_ptr<Export> target = Acquire(requestId, promise);
+        if (target) {
+            FinishAsync(requestId, std::move(target), promise);
+        }
+    }
+
+    // Drops an export and deletes its partial file; resolves with false if it is unknown
+    REACT_METHOD(CancelExport, L"cancelExport");
+    void CancelExport(std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        std::shared_ptr<Export> target;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_exports.find(requestId);
+            if (it == m_exports.end()) {
+                promise.Resolve(false);
+                return;
+            }
+            target = std::move(it->second);
+            m_exports.erase(it);
+        }
+        DiscardAsync(std::move(target), promise);
+    }
+
+  private:
+    static constexpr size_t kWorkerCount = 1;
+    static constexpr size_t kMaxPendingCalls = 16;
+    // Serialized bytes gathered before each write to the file
+    static constexpr size_t kFlushSize = 256 * 1024;
+
+    struct Export
+    {
+        winrt::Windows::Storage::StorageFile file{ nullptr };
+        winrt::Windows::Storage::Streams::IRandomAccessStream stream{ nullptr };
+        winrt::Windows::Storage::Streams::IOutputStream output{ nullptr };
+        std::unique_ptr<FileIngest::TableWriter> writer;
+        uint64_t bytesWritten = 0;
+        // Set while a batch or the finish runs
+        std::atomic<bool> busy{ false };
+    };
+
+    FileIngest::IoExecutor m_executor{ kWorkerCount, kMaxPendingCalls };
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Export>> m_exports;
+
+    template <typename Promise>
+    std::shared_ptr<Export> Acquire(std::string const& requestId, Promise& promise) {
+        std::shared_ptr<Export> target;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_exports.find(requestId);
+            if (it != m_exports.end()) {
+                target = it->second;
+            }
+        }
+        if (!target) {
+            promise.Reject("Unknown export");
+            return nullptr;
+        }
+        if (target->busy.exchange(true)) {
+            promise.Reject("Export is busy, wait for the previous batch");
+            return nullptr;
+        }
+        return target;
+    }
+
+    static std::string DescribeFailure(std::string_view fallback) noexcept {
+        std::string message(fallback);
+        try {
+            throw;
+        } catch (const winrt::hresult_error& e) {
+            message += ": " + winrt::to_string(e.message());
+        } catch (const std::exception& e) {
+            message += ": ";
+            message += e.what();
+        } catch (...) {
+        }
+        return message;
+    }
+
+    winrt::fire_and_forget OpenExportAsync(std::string requestId, winrt::Windows::Storage::StorageFile file, FileIngest::ExportFormat format, char delimiter, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            auto target = std::make_shared<Export>();
+            target->file = file;
+            target->stream = co_await file.OpenAsync(winrt::Windows::Storage::FileAccessMode::ReadWrite);
+            // Replacing an existing file must not leave its tail behind
+            target->stream.Size(0);
+            target->output = target->stream.GetOutputStreamAt(0);
+            if (format == FileIngest::ExportFormat::Xlsx) {
+                target->writer = std::make_unique<FileIngest::XlsxWriter>();
+            } else {
+                target->writer = std::make_unique<FileIngest::CsvWriter>(delimiter);
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exports[requestId] = std::move(target);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(true));
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error opening export file").c_str());
+        }
+    }
+
+    // Writes what the writer produced to the file once it reaches kFlushSize, or all of it
+    static winrt::Windows::Foundation::IAsyncAction FlushAsync(Export& target, bool all) {
+        std::vector<uint8_t>& output = target.writer->Output();
+        if (output.empty() || (!all && output.size() < kFlushSize)) {
+            co_return;
+        }
+        winrt::Windows::Storage::Streams::Buffer buffer(static_cast<uint32_t>(output.size()));
+        std::memcpy(buffer.data(), output.data(), output.size());
+        buffer.Length(static_cast<uint32_t>(output.size()));
+        target.bytesWritten += output.size();
+        output.clear();
+        co_await target.output.WriteAsync(buffer);
+    }
+
+    winrt::fire_and_forget WriteRowsAsync(std::shared_ptr<Export> target, winrt::Microsoft::ReactNative::JSValueArray rows, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            std::vector<FileIngest::TableCell> cells;
+            for (auto const& row : rows) {
+                cells.clear();
+                for (auto const& value : row.AsArray()) {
+                    // Strings are referenced in place, not copied
+                    if (std::string const* text = value.TryGetString()) {
+                        cells.push_back(FileIngest::TableCell::Text(*text));
+                    } else if (value.Type() == winrt::Microsoft::ReactNative::JSValueType::Double || value.Type() == winrt::Microsoft::ReactNative::JSValueType::Int64) {
+                        cells.push_back(FileIngest::TableCell::Number(value.AsDouble()));
+                    } else if (bool const* flag = value.TryGetBoolean()) {
+                        cells.push_back(FileIngest::TableCell::Text(*flag ? "true" : "false"));
+                    } else {
+                        cells.push_back({});
+                    }
+                }
+                target->writer->WriteRow(cells);
+                if (target->writer->Output().size() >= kFlushSize) {
+                    co_await FlushAsync(*target, false);
+                    co_await m_executor.Schedule();
+                }
+            }
+            target->busy = false;
+            promise.Resolve(true);
+        } catch (const FileIngest::ExecutorBusy& e) {
+            target->busy = false;
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExportError& e) {
+            target->busy = false;
+            promise.Reject(e.what());
+        } catch (...) {
+            target->busy = false;
+            promise.Reject(DescribeFailure("Error writing export").c_str());
+        }
+    }
+
+    winrt::fire_and_forget FinishAsync(std::string requestId, std::shared_ptr<Export> target, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        try {
+            co_await m_executor.Schedule();
+            target->writer->Finish();
+            co_await FlushAsync(*target, true);
+            co_await target->output.FlushAsync();
+            target->output.Close();
+            target->stream.Close();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_exports.erase(requestId);
+            }
+            winrt::Microsoft::ReactNative::JSValueObject result;
+            result["fileName"] = winrt::to_string(target->file.Name());
+            result["path"] = winrt::to_string(target->file.Path());
+            result["rows"] = static_cast<int64_t>(target->writer->Rows());
+            result["bytes"] = static_cast<int64_t>(target->bytesWritten);
+            promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+        } catch (const FileIngest::ExecutorBusy& e) {
+            target->busy = false;
+            promise.Reject(e.what());
+        } catch (...) {
+            target->busy = false;
+            promise.Reject(DescribeFailure("Error finishing export").c_str());
+        }
+    }
+
+    winrt::fire_and_forget DiscardAsync(std::shared_ptr<Export> target, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        try {
+            // Lets a batch still running on the worker finish with the stream before it closes
+            co_await m_executor.Schedule();
+            target->output.Close();
+            target->stream.Close();
+            co_await target->file.DeleteAsync();
+            promise.Resolve(true);
+        } catch (...) {
+            promise.Reject(DescribeFailure("Error cancelling export").c_str());
+        }
+    }
+  };
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+#include "pch.h"
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Storage.Streams.h>
+#include <winrt/Windows.Web.Http.h>
+#include <winrt/Windows.Web.Http.Filters.h>
+#include <winrt/Windows.Web.Http.Headers.h>
+#include <winrt/Microsoft.ReactNative.h>
+#include "CancelWatch.h"
+#include "FileIngest/IoExecutor.h"
+#include "FileIngest/Json.h"
+#include "FileIngest/RequestScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace NativeHttpModule
+{
+  // Builds a JSValue straight from FileIngest::JsonReader's events, without a JSON string
+  // crossing the bridge for JSON.parse to walk again on the JS thread
+  class JsValueBuilder
+  {
+  public:
+      void Null() {
+          Add(winrt::Microsoft::ReactNative::JSValue());
+      }
+      void Bool(bool value) {
+          Add(winrt::Microsoft::ReactNative::JSValue(value));
+      }
+      void Int(int64_t value) {
+          Add(winrt::Microsoft::ReactNative::JSValue(value));
+      }
+      void Double(double value) {
+          Add(winrt::Microsoft::ReactNative::JSValue(value));
+      }
+      void String(std::string&& value) {
+          Add(winrt::Microsoft::ReactNative::JSValue(std::move(value)));
+      }
+      void Key(std::string&& key) {
+          m_keys.push_back(std::move(key));
+      }
+      void StartObject() {
+          m_frames.emplace_back().isObject = true;
+      }
+      void StartArray() {
+          m_frames.emplace_back();
+      }
+      void EndObject() {
+          Frame frame = std::move(m_frames.back());
+          m_frames.pop_back();
+          Add(winrt::Microsoft::ReactNative::JSValue(std::move(frame.object)));
+      }
+      void EndArray() {
+          Frame frame = std::move(m_frames.back());
+          m_frames.pop_back();
+          Add(winrt::Microsoft::ReactNative::JSValue(std::move(frame.array)));
+      }
+
+      winrt::Microsoft::ReactNative::JSValue Take() {
+          return std::move(m_root);
+      }
+
+  private:
+      struct Frame
+      {
+          bool isObject = false;
+          winrt::Microsoft::ReactNative::JSValueObject object;
+          winrt::Microsoft::ReactNative::JSValueArray array;
+      };
+
+      // A repeated key keeps its last value, as with JSON.parse
+      void Add(winrt::Microsoft::ReactNative::JSValue&& value) {
+          if (m_frames.empty()) {
+              m_root = std::move(value);
+          } else if (!m_frames.back().isObject) {
+              m_frames.back().array.push_back(std::move(value));
+          } else {
+              m_frames.back().object.insert_or_assign(std::move(m_keys.back()), std::move(value));
+              m_keys.pop_back();
+          }
+      }
+
+      std::vector<Frame> m_frames;
+      std::vector<std::string> m_keys;
+      winrt::Microsoft::ReactNative::JSValue m_root;
+  };
+
+  // HTTP for APIService on Windows. Every call goes through one HttpClient, whose keep-alive
+  // connections are reused from call to call instead of paying a TCP and TLS handshake each
+  // time. At most kMaxConnectionsPerHost calls are in flight to a host; the others wait without
+  // holding a thread. Identical GETs in flight with the same credentials share one request and
+  // its answer. JSON answers are parsed on a worker straight into a JSValue.
+  REACT_MODULE(NativeHttp);
+  struct NativeHttp final
+  {
+    // options: { method, url, headers: { [name]: value }, body?: string, responseType: 'json' | 'text' }.
+    // Resolves with { status, ok, contentType, body, coalesced } for any status, as fetch does;
+    // body is parsed when responseType is 'json' and the answer is JSON, and a string otherwise.
+    REACT_METHOD(Request, L"request");
+    void Request(std::string requestId, winrt::Microsoft::ReactNative::JSValue options, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        Call call;
+        call.method = options["method"].IsNull() ? "GET" : options["method"].AsString();
+        std::transform(call.method.begin(), call.method.end(), call.method.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        call.url = options["url"].AsString();
+        if (auto const* headers = options["headers"].TryGetObject()) {
+            for (auto const& [name, value] : *headers) {
+                if (EqualsIgnoreCase(name, "Content-Type")) {
+                    call.contentType = value.AsString();
+                } else {
+                    if (EqualsIgnoreCase(name, "Authorization")) {
+                        call.authorization = value.AsString();
+                    }
+                    call.headers.emplace_back(name, value.AsString());
+                }
+            }
+        }
+        if (auto const* body = options["body"].TryGetString()) {
+            call.body = *body;
+        }
+        call.parseJson = options["responseType"].IsNull() || options["responseType"].AsString() == "json";
+        RequestAsync(std::move(requestId), std::move(call), promise);
+    }
+
+    // Resolves with false when the request is unknown or already finished. Cancelling a GET
+    // that others joined cancels it for them as well.
+    REACT_METHOD(Cancel, L"cancel");
+    void Cancel(std::string requestId, winrt::Microsoft::ReactNative::ReactPromise<bool> promise) noexcept {
+        promise.Resolve(m_requests.Cancel(requestId));
+    }
+
+    REACT_METHOD(GetStats, L"getStats");
+    void GetStats(winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CoalescerStats coalescer = m_coalescer.Stats();
+        winrt::Microsoft::ReactNative::JSValueObject result;
+        result["requests"] = static_cast<int64_t>(coalescer.leaders);
+        result["coalesced"] = static_cast<int64_t>(coalescer.followers);
+        result["inFlight"] = static_cast<int64_t>(coalescer.inFlight);
+        result["failures"] = static_cast<int64_t>(m_failures.load());
+        result["parsedBytes"] = static_cast<int64_t>(m_parsedBytes.load());
+        promise.Resolve(winrt::Microsoft::ReactNative::JSValue(std::move(result)));
+    }
+
+  private:
+    // As many as HttpBaseProtocolFilter opens per server, so no call queues inside it where
+    // it could not be cancelled
+    static constexpr uint32_t kMaxConnectionsPerHost = 6;
+    // Workers only parse answers; the calls themselves wait on the network without a thread
+    static constexpr size_t kWorkerCount = 2;
+    static constexpr size_t kMaxPendingCalls = 256;
+    static constexpr std::chrono::seconds kRequestTimeout{ 60 };
+
+    struct Call
+    {
+        std::string method;
+        std::string url;
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::string authorization;
+        std::string contentType;
+        std::optional<std::string> body;
+        bool parseJson = true;
+    };
+
+    struct Answer
+    {
+        int32_t status = 0;
+        std::string contentType;
+        winrt::Microsoft::ReactNative::JSValue body;
+
+        Answer Copy() const {
+            return Answer{ status, contentType, body.Copy() };
+        }
+    };
+
+    FileIngest::IoExecutor m_executor{ kWorkerCount, kMaxPendingCalls };
+    FileIngest::CancellationRegistry m_requests;
+    FileIngest::HostLimiter m_limiter{ m_executor, kMaxConnectionsPerHost };
+    FileIngest::RequestCoalescer<Answer> m_coalescer{ m_executor };
+    winrt::Windows::Web::Http::HttpClient m_client{ CreateClient() };
+    std::atomic<uint64_t> m_failures{ 0 };
+    std::atomic<uint64_t> m_parsedBytes{ 0 };
+
+    static winrt::Windows::Web::Http::HttpClient CreateClient() {
+        winrt::Windows::Web::Http::Filters::HttpBaseProtocolFilter filter;
+        filter.MaxConnectionsPerServer(kMaxConnectionsPerHost);
+        filter.AllowUI(false);
+        return winrt::Windows::Web::Http::HttpClient(filter);
+    }
+
+    static bool EqualsIgnoreCase(std::string_view a, std::string_view b) noexcept {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+    }
+
+    static bool IsJson(std::string_view contentType) noexcept {
+        std::string lower(contentType);
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return lower.find("application/json") != std::string::npos || lower.find("+json") != std::string::npos;
+    }
+
+    static winrt::Microsoft::ReactNative::JSValue ToResult(Answer&& answer, bool coalesced) {
+        winrt::Microsoft::ReactNative::JSValueObject result;
+        result["status"] = static_cast<int64_t>(answer.status);
+        result["ok"] = answer.status >= 200 && answer.status < 300;
+        result["contentType"] = std::move(answer.contentType);
+        result["body"] = std::move(answer.body);
+        result["coalesced"] = coalesced;
+        return winrt::Microsoft::ReactNative::JSValue(std::move(result));
+    }
+
+    static std::string DescribeFailure(std::string_view fallback) noexcept {
+        std::string message(fallback);
+        try {
+            throw;
+        } catch (const winrt::hresult_error& e) {
+            message += ": " + winrt::to_string(e.message());
+        } catch (const std::exception& e) {
+            message += ": ";
+            message += e.what();
+        } catch (...) {
+        }
+        return message;
+    }
+
+    winrt::fire_and_forget RequestAsync(std::string requestId, Call call, winrt::Microsoft::ReactNative::ReactPromise<winrt::Microsoft::ReactNative::JSValue> promise) noexcept {
+        FileIngest::CancellationToken cancellation;
+        try {
+            cancellation = m_requests.Register(requestId, kRequestTimeout);
+        } catch (const FileIngest::DuplicateRequest& e) {
+            promise.Reject(e.what());
+            co_return;
+        }
+        try {
+            co_await m_executor.Schedule(cancellation);
+            auto ticket = m_coalescer.Join(FileIngest::CoalescingKey(call.method, call.url, call.authorization));
+            if (!ticket.IsLeader()) {
+                Answer const& shared = co_await ticket.Wait();
+                cancellation.ThrowIfCancelled();
+                promise.Resolve(ToResult(shared.Copy(), true));
+            } else {
+                try {
+                    Answer answer;
+                    std::string text;
+                    {
+                        auto permit = co_await m_limiter.For(FileIngest::HostKey(call.url)).Acquire();
+                        cancellation.ThrowIfCancelled();
+                        winrt::Windows::Web::Http::HttpRequestMessage request(winrt::Windows::Web::Http::HttpMethod(winrt::to_hstring(call.method)), winrt::Windows::Foundation::Uri(winrt::to_hstring(call.url)));
+                        for (auto const& [name, value] : call.headers) {
+                            request.Headers().TryAppendWithoutValidation(winrt::to_hstring(name), winrt::to_hstring(value));
+                        }
+                        // Content-Type belongs to the body; a GET has none to carry it
+                        if (call.body) {
+                            std::string_view mediaType = call.contentType.empty() ? std::string_view("application/json") : std::string_view(call.contentType);
+                            mediaType = mediaType.substr(0, mediaType.find(';'));
+                            request.Content(winrt::Windows::Web::Http::HttpStringContent(winrt::to_hstring(*call.body), winrt::Windows::Storage::Streams::UnicodeEncoding::Utf8, winrt::to_hstring(mediaType)));
+                        }
+                        auto operation = m_client.SendRequestAsync(request, winrt::Windows::Web::Http::HttpCompletionOption::ResponseContentRead);
+                        winrt::Windows::Web::Http::HttpResponseMessage response{ nullptr };
+                        {
+                            ModuleSupport::CancelWatch watch(operation, cancellation);
+                            response = co_await operation;
+                        }
+                        answer.status = static_cast<int32_t>(response.StatusCode());
+                        if (auto contentType = response.Content().Headers().ContentType()) {
+                            answer.contentType = winrt::to_string(contentType.ToString());
+                        }
+                        winrt::Windows::Storage::Streams::IBuffer buffer = co_await response.Content().ReadAsBufferAsync();
+                        text.assign(reinterpret_cast<const char*>(buffer.data()), buffer.Length());
+                    }
+
+                    // Off the network thread, so a large answer parses beside other calls
+                    // rather than on the JS thread after them
+                    co_await m_executor.Schedule(cancellation);
+                    // A body that does not parse, such as a proxy's HTML error page labelled as
+                    // JSON, is handed over as text: the caller sees the status first, as with
+                    // fetch, and json() fails on it there
+                    bool parsed = false;
+                    if (call.parseJson && IsJson(answer.contentType) && !text.empty()) {
+                        try {
+                            JsValueBuilder builder;
+                            FileIngest::ParseJson(text, builder);
+                            answer.body = builder.Take();
+                            m_parsedBytes += text.size();
+                            parsed = true;
+                        } catch (const FileIngest::JsonError&) {
+                        }
+                    }
+                    if (!parsed) {
+                        answer.body = winrt::Microsoft::ReactNative::JSValue(std::move(text));
+                    }
+                    ticket.Complete([&answer]() { return answer.Copy(); });
+                    promise.Resolve(ToResult(std::move(answer), false));
+                } catch (...) {
+                    ticket.Fail(std::current_exception());
+                    throw;
+                }
+            }
+        } catch (const winrt::hresult_canceled&) {
+            m_failures++;
+            promise.Reject(cancellation.IsExpired() ? "Request timed out" : "Request cancelled");
+        } catch (const FileIngest::OperationCancelled& e) {
+            m_failures++;
+            promise.Reject(e.what());
+        } catch (const FileIngest::RequestAbandoned& e) {
+            m_failures++;
+            promise.Reject(e.what());
+        } catch (const FileIngest::ExecutorBusy& e) {
+            m_failures++;
+            promise.Reject(e.what());
+        } catch (...) {
+            m_failures++;
+            promise.Reject(DescribeFailure("Error sending request").c_str());
+        }
+        m_requests.Release(requestId);
+    }
+  };
+}
@@ -2,7 +2,10 @@
 #include "ReactPackageProvider.h"
 #include "NativeModules.h"
 
+#include "Modules\CacheStore.h"
 #include "Modules\FileOpenPicker.h"
+#include "Modules\FileSavePicker.h"
+#include "Modules\NativeHttp.h"
 
 using namespace winrt::Microsoft::ReactNative;
 